@@ -4,11 +4,49 @@
 
 #include "stdafx.h"
 #include "Explorer++.h"
+#include "Bookmarks/BookmarkJournal.h"
+#include "Explorer++_internal.h"
 #include "Navigation.h"
 #include "TabContainer.h"
+#include "XMLSettings.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 
+namespace
+{
+
+// The journal files are stored in the same location as the rest of the settings. When the settings
+// are saved to the config file, that's the directory containing the executable. Otherwise, the
+// settings are saved to the user's section of the registry, so the journal files are stored in the
+// user's local application data directory.
+std::optional<std::filesystem::path> GetBookmarkJournalDirectory(bool settingsInConfigFile)
+{
+	if (settingsInConfigFile)
+	{
+		return std::filesystem::path(GetXmlConfigFilePath()).parent_path();
+	}
+
+	wil::unique_cotaskmem_string localAppData;
+	HRESULT hr =
+		SHGetKnownFolderPath(FOLDERID_LocalAppData, KF_FLAG_CREATE, nullptr, &localAppData);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	auto directory = std::filesystem::path(localAppData.get()) / NExplorerplusplus::APP_NAME;
+
+	if (!CreateDirectory(directory.c_str(), nullptr) && GetLastError() != ERROR_ALREADY_EXISTS)
+	{
+		return std::nullopt;
+	}
+
+	return directory;
+}
+
+}
+
 void Explorerplusplus::ExpandAndBrowsePath(const TCHAR *szPath)
 {
 	ExpandAndBrowsePath(szPath, FALSE, FALSE);
@@ -43,3 +81,47 @@ void Explorerplusplus::ExpandAndBrowsePath(const TCHAR *szPath, BOOL bOpenInNewT
 
 	m_navigation->BrowseFolderInCurrentTab(szExpandedPath);
 }
+
+bool Explorerplusplus::LoadBookmarksFromJournal()
+{
+	auto directory = GetBookmarkJournalDirectory(m_bLoadSettingsFromXML);
+
+	if (!directory)
+	{
+		return false;
+	}
+
+	m_bookmarkJournal = std::make_unique<BookmarkJournal>(&m_bookmarkTree,
+		(*directory / NExplorerplusplus::BOOKMARKS_SNAPSHOT_FILENAME).wstring(),
+		(*directory / NExplorerplusplus::BOOKMARKS_JOURNAL_FILENAME).wstring());
+
+	return m_bookmarkJournal->Load();
+}
+
+/* If the journal can't be written (e.g. because the
+directory is read-only, or because another instance
+is already using it), changes will only be saved when
+the bookmarks are saved in full. */
+void Explorerplusplus::StartBookmarkJournal()
+{
+	if (m_bookmarkJournal && !m_bookmarkJournal->Start())
+	{
+		m_bookmarkJournal.reset();
+	}
+}
+
+bool Explorerplusplus::IsBookmarkJournalActive() const
+{
+	return m_bookmarkJournal && m_bookmarkJournal->IsActive();
+}
+
+/* Should only be called once the bookmarks have actually
+been written out, since the journal will then defer to the
+full save the next time the bookmarks are loaded. */
+void Explorerplusplus::OnBookmarksSavedInFull()
+{
+	if (m_bookmarkJournal)
+	{
+		m_bookmarkJournal->OnTreeSaved();
+	}
+}
@@ -8,7 +8,6 @@
 #include "CoreInterface.h"
 #include "Icon.h"
 #include "IconResourceLoader.h"
-#include "../Helper/CachedIcons.h"
 #include "../Helper/IconFetcher.h"
 #include "../Helper/ImageHelper.h"
 
@@ -62,11 +61,11 @@ int BookmarkIconManager::GetIconForBookmark(const BookmarkItem *bookmark)
 {
 	int iconIndex = m_defaultFolderIconIndex;
 
-	auto cachedItr = m_expp->GetCachedIcons()->findByPath(bookmark->GetLocation());
+	auto cachedIconIndex = m_iconFetcher->GetCachedIconIndex(bookmark->GetLocation());
 
-	if (cachedItr != m_expp->GetCachedIcons()->end())
+	if (cachedIconIndex)
 	{
-		iconIndex = AddSystemIconToImageList(cachedItr->iconIndex);
+		iconIndex = AddSystemIconToImageList(*cachedIconIndex);
 	}
 	else if (m_callback)
 	{
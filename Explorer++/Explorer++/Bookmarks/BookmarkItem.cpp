@@ -152,9 +152,11 @@ BookmarkItem *BookmarkItem::AddChild(std::unique_ptr<BookmarkItem> bookmarkItem,
 	assert(index <= m_children.size());
 
 	bookmarkItem->m_parent = this;
+	bookmarkItem->m_positionInParent = index;
 
 	BookmarkItem *rawBookmarkItem = bookmarkItem.get();
 	m_children.insert(m_children.begin() + index, std::move(bookmarkItem));
+	InvalidateChildPositions(index);
 
 	UpdateModificationTime();
 
@@ -175,6 +177,7 @@ std::unique_ptr<BookmarkItem> BookmarkItem::RemoveChild(size_t index)
 	auto erasedItem = std::move(m_children[index]);
 
 	m_children.erase(m_children.begin() + index);
+	InvalidateChildPositions(index);
 
 	UpdateModificationTime();
 
@@ -185,37 +188,25 @@ size_t BookmarkItem::GetChildIndex(const BookmarkItem *bookmarkItem) const
 {
 	assert(m_type == Type::Folder);
 
-	auto itr = std::find_if(m_children.begin(), m_children.end(),
-		[bookmarkItem](const auto &item)
-		{
-			return item.get() == bookmarkItem;
-		});
-
-	if (itr == m_children.end())
+	if (bookmarkItem->m_parent != this)
 	{
 		throw std::invalid_argument("BookmarkItem not found");
 	}
 
-	return itr - m_children.begin();
+	if (bookmarkItem->m_positionInParent >= m_firstStaleChildPosition)
+	{
+		UpdateChildPositions();
+	}
+
+	assert(m_children[bookmarkItem->m_positionInParent].get() == bookmarkItem);
+
+	return bookmarkItem->m_positionInParent;
 }
 
 const std::unique_ptr<BookmarkItem> &BookmarkItem::GetChildOwnedPtr(
 	const BookmarkItem *bookmarkItem) const
 {
-	assert(m_type == Type::Folder);
-
-	auto itr = std::find_if(m_children.begin(), m_children.end(),
-		[bookmarkItem](const auto &item)
-		{
-			return item.get() == bookmarkItem;
-		});
-
-	if (itr == m_children.end())
-	{
-		throw std::invalid_argument("BookmarkItem not found");
-	}
-
-	return *itr;
+	return m_children[GetChildIndex(bookmarkItem)];
 }
 
 bool BookmarkItem::HasChildFolder() const
@@ -243,6 +234,25 @@ void BookmarkItem::UpdateModificationTime()
 	GetSystemTimeAsFileTime(&m_dateModified);
 }
 
+// Inserting or removing a child shifts the position of every child after it. Rather than
+// renumbering those children each time (which would make a series of inserts at the front of a
+// large folder quadratic), the positions are marked as stale and recalculated in one pass the next
+// time a position is requested.
+void BookmarkItem::InvalidateChildPositions(size_t index)
+{
+	m_firstStaleChildPosition = std::min(m_firstStaleChildPosition, index);
+}
+
+void BookmarkItem::UpdateChildPositions() const
+{
+	for (size_t i = m_firstStaleChildPosition; i < m_children.size(); i++)
+	{
+		m_children[i]->m_positionInParent = i;
+	}
+
+	m_firstStaleChildPosition = m_children.size();
+}
+
 void BookmarkItem::VisitRecursively(std::function<void(BookmarkItem *currentItem)> callback)
 {
 	callback(this);
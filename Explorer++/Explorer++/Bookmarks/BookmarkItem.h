@@ -124,6 +124,8 @@ private:
 	static FILETIME GetCurrentDate();
 
 	void UpdateModificationTime();
+	void InvalidateChildPositions(size_t index);
+	void UpdateChildPositions() const;
 
 	const Type m_type;
 	std::wstring m_guid = CreateGUID();
@@ -143,4 +145,11 @@ private:
 	FILETIME m_dateModified = m_dateCreated;
 
 	BookmarkItems m_children;
+
+	// The position of this item within its parent. When a child is inserted or removed, the
+	// positions of the children that follow it aren't updated until one of them is next needed.
+	mutable size_t m_positionInParent = 0;
+
+	// Children at or after this position may have a stale m_positionInParent.
+	mutable size_t m_firstStaleChildPosition = 0;
 };
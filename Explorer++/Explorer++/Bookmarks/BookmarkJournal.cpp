@@ -0,0 +1,813 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Bookmarks/BookmarkJournal.h"
+#include "Bookmarks/BookmarkHelper.h"
+#include "Bookmarks/BookmarkTree.h"
+#include "../Helper/Crc32.h"
+#include "../Helper/Logging.h"
+#include "../Helper/StringHelper.h"
+#include "../ThirdParty/cereal/archives/binary.hpp"
+#include <optional>
+#include <sstream>
+
+namespace
+{
+
+// These values are written to disk, so they shouldn't be changed.
+constexpr uint32_t SNAPSHOT_SIGNATURE = 0x504E5342; // "BSNP"
+constexpr uint32_t JOURNAL_SIGNATURE = 0x4C4E4A42;  // "BJNL"
+constexpr uint32_t FORMAT_VERSION = 1;
+
+enum class RecordType : uint8_t
+{
+	Added = 0,
+	Updated = 1,
+	Moved = 2,
+	Removed = 3,
+
+	// Records that the tree was saved in full at this point.
+	Saved = 4
+};
+
+struct JournalHeader
+{
+	uint32_t signature;
+	uint32_t version;
+	uint64_t generation;
+};
+
+// Each record in the journal is preceded by this header. If the application crashes while a record
+// is being written, the record will either be truncated or have a mismatched checksum. Either way,
+// the record (and anything after it) will be ignored when the journal is loaded.
+struct RecordHeader
+{
+	uint32_t size;
+	uint32_t checksum;
+};
+
+uint64_t FileTimeToUint64(const FILETIME &fileTime)
+{
+	ULARGE_INTEGER value;
+	value.LowPart = fileTime.dwLowDateTime;
+	value.HighPart = fileTime.dwHighDateTime;
+	return value.QuadPart;
+}
+
+FILETIME Uint64ToFileTime(uint64_t value)
+{
+	ULARGE_INTEGER largeValue;
+	largeValue.QuadPart = value;
+	return { largeValue.LowPart, largeValue.HighPart };
+}
+
+uint32_t CalculateChecksum(const std::string &data)
+{
+	Crc32 crc;
+	crc.Update(data.data(), data.size());
+	return crc.GetValue();
+}
+
+std::optional<std::string> ReadFileContents(const std::wstring &path)
+{
+	wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!file)
+	{
+		return std::nullopt;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file.get(), &fileSize) || fileSize.HighPart != 0)
+	{
+		return std::nullopt;
+	}
+
+	std::string contents(fileSize.LowPart, '\0');
+	DWORD numBytesRead;
+
+	if (!ReadFile(file.get(), contents.data(), fileSize.LowPart, &numBytesRead, nullptr)
+		|| numBytesRead != fileSize.LowPart)
+	{
+		return std::nullopt;
+	}
+
+	return contents;
+}
+
+// Returns false if the journal doesn't follow on from the snapshot with the specified generation.
+bool IsJournalValid(const std::string &contents, uint64_t generation)
+{
+	if (contents.size() < sizeof(JournalHeader))
+	{
+		return false;
+	}
+
+	JournalHeader header;
+	memcpy(&header, contents.data(), sizeof(header));
+
+	return header.signature == JOURNAL_SIGNATURE && header.version == FORMAT_VERSION
+		&& header.generation == generation;
+}
+
+bool WriteAndFlush(HANDLE file, const std::string &data)
+{
+	DWORD numBytesWritten;
+
+	if (!WriteFile(file, data.data(), static_cast<DWORD>(data.size()), &numBytesWritten, nullptr)
+		|| numBytesWritten != data.size())
+	{
+		return false;
+	}
+
+	return FlushFileBuffers(file);
+}
+
+}
+
+// The properties of a bookmark item, along with its children. The cereal serialization built into
+// BookmarkItem is designed for copying items (deserialized items are given new GUIDs and dates),
+// whereas the journal needs to save items exactly, so it uses this type instead.
+struct BookmarkJournal::ItemRecord
+{
+	std::wstring guid;
+	BookmarkItem::Type type;
+	std::wstring name;
+	std::wstring location;
+	uint64_t dateCreated;
+	uint64_t dateModified;
+	std::vector<ItemRecord> children;
+
+	static ItemRecord FromItem(const BookmarkItem *bookmarkItem, bool includeChildren)
+	{
+		ItemRecord record;
+		record.guid = bookmarkItem->GetGUID();
+		record.type = bookmarkItem->GetType();
+		record.name = bookmarkItem->GetName();
+		record.location = bookmarkItem->GetLocation();
+		record.dateCreated = FileTimeToUint64(bookmarkItem->GetDateCreated());
+		record.dateModified = FileTimeToUint64(bookmarkItem->GetDateModified());
+
+		if (includeChildren && bookmarkItem->IsFolder())
+		{
+			for (const auto &child : bookmarkItem->GetChildren())
+			{
+				record.children.push_back(FromItem(child.get(), true));
+			}
+		}
+
+		return record;
+	}
+
+	std::unique_ptr<BookmarkItem> ToItem() const
+	{
+		auto bookmarkItem = std::make_unique<BookmarkItem>(guid, name,
+			type == BookmarkItem::Type::Bookmark ? std::make_optional(location) : std::nullopt);
+
+		for (const auto &child : children)
+		{
+			bookmarkItem->AddChild(child.ToItem());
+		}
+
+		ApplyProperties(bookmarkItem.get());
+
+		return bookmarkItem;
+	}
+
+	// Updating an item's name or location also updates its modification date, so the dates are
+	// set last.
+	void ApplyProperties(BookmarkItem *bookmarkItem) const
+	{
+		if (bookmarkItem->GetName() != name)
+		{
+			bookmarkItem->SetName(name);
+		}
+
+		if (bookmarkItem->IsBookmark() && bookmarkItem->GetLocation() != location)
+		{
+			bookmarkItem->SetLocation(location);
+		}
+
+		bookmarkItem->SetDateCreated(Uint64ToFileTime(dateCreated));
+		bookmarkItem->SetDateModified(Uint64ToFileTime(dateModified));
+	}
+
+	template <class Archive>
+	void serialize(Archive &archive)
+	{
+		archive(guid, type, name, dateCreated, dateModified);
+
+		if (type == BookmarkItem::Type::Bookmark)
+		{
+			archive(location);
+		}
+		else
+		{
+			archive(children);
+		}
+	}
+};
+
+struct BookmarkJournal::JournalRecord
+{
+	RecordType type;
+
+	// The item that was moved or removed.
+	std::wstring guid;
+
+	// The new parent of the item that was added or moved.
+	std::wstring parentGuid;
+	uint64_t index = 0;
+
+	// The item that was added (including its children), or the updated properties of an item.
+	ItemRecord item;
+
+	template <class Archive>
+	void serialize(Archive &archive)
+	{
+		archive(type);
+
+		switch (type)
+		{
+		case RecordType::Added:
+			archive(parentGuid, index, item);
+			break;
+
+		case RecordType::Updated:
+			archive(item);
+			break;
+
+		case RecordType::Moved:
+			archive(guid, parentGuid, index);
+			break;
+
+		case RecordType::Removed:
+			archive(guid);
+			break;
+
+		case RecordType::Saved:
+			break;
+
+		default:
+			throw cereal::Exception("Unknown journal record type");
+		}
+	}
+};
+
+struct BookmarkJournal::JournalEntry
+{
+	JournalRecord record;
+
+	// The offset in the journal immediately after this record.
+	size_t endOffset;
+};
+
+struct BookmarkJournal::Snapshot
+{
+	uint64_t generation;
+	bool hasUnsavedChanges;
+	std::vector<ItemRecord> toolbarItems;
+	std::vector<ItemRecord> menuItems;
+	std::vector<ItemRecord> otherItems;
+};
+
+BookmarkJournal::BookmarkJournal(BookmarkTree *bookmarkTree, const std::wstring &snapshotPath,
+	const std::wstring &journalPath, int compactionThreshold) :
+	m_bookmarkTree(bookmarkTree),
+	m_snapshotPath(snapshotPath),
+	m_journalPath(journalPath),
+	m_compactionThreshold(compactionThreshold)
+{
+}
+
+bool BookmarkJournal::Load()
+{
+	if (!AcquireFiles())
+	{
+		return false;
+	}
+
+	auto snapshot = ReadSnapshot();
+
+	if (!snapshot)
+	{
+		return false;
+	}
+
+	// Even if the snapshot isn't loaded, the next snapshot that's written should still use a newer
+	// generation, so that the existing journal can't be mistaken for one that follows on from it.
+	m_generation = snapshot->generation;
+
+	auto journalContents = ReadFileContents(m_journalPath);
+	m_journalValid = journalContents && IsJournalValid(*journalContents, m_generation);
+
+	std::vector<JournalEntry> entries;
+
+	if (m_journalValid)
+	{
+		entries = ReadJournal(*journalContents);
+	}
+
+	bool hasUnsavedChanges = snapshot->hasUnsavedChanges;
+
+	if (!entries.empty())
+	{
+		hasUnsavedChanges = entries.back().record.type != RecordType::Saved;
+	}
+
+	m_validJournalSize = sizeof(JournalHeader);
+
+	// If nothing has changed since the last full save, the tree will be loaded from there instead.
+	// The saved state here matches it, so the existing journal can still be appended to.
+	if (!hasUnsavedChanges)
+	{
+		if (!entries.empty())
+		{
+			m_validJournalSize = entries.back().endOffset;
+			m_numJournalRecords = static_cast<int>(entries.size());
+		}
+
+		return false;
+	}
+
+	ApplySnapshot(*snapshot);
+
+	m_hasUnsavedChanges = true;
+
+	for (const auto &entry : entries)
+	{
+		if (!ApplyRecord(entry.record))
+		{
+			LOG(error) << L"Bookmark journal record couldn't be applied";
+			break;
+		}
+
+		m_validJournalSize = entry.endOffset;
+		m_numJournalRecords++;
+	}
+
+	return true;
+}
+
+// Only a single instance should be recording changes at any one time, otherwise each instance would
+// overwrite the changes recorded by the other. The lock file is deleted automatically once it's
+// closed (including if the application crashes).
+bool BookmarkJournal::AcquireFiles()
+{
+	if (m_lockFile)
+	{
+		return true;
+	}
+
+	m_lockFile.reset(CreateFile((m_journalPath + L".lock").c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr));
+
+	if (!m_lockFile)
+	{
+		LOG(info) << L"Bookmark journal unavailable (it may be in use by another instance)";
+		return false;
+	}
+
+	return true;
+}
+
+std::optional<BookmarkJournal::Snapshot> BookmarkJournal::ReadSnapshot()
+{
+	auto contents = ReadFileContents(m_snapshotPath);
+
+	if (!contents)
+	{
+		return std::nullopt;
+	}
+
+	try
+	{
+		std::stringstream stringstream(*contents);
+		cereal::BinaryInputArchive inputArchive(stringstream);
+
+		uint32_t signature;
+		uint32_t version;
+		inputArchive(signature, version);
+
+		if (signature != SNAPSHOT_SIGNATURE || version != FORMAT_VERSION)
+		{
+			return std::nullopt;
+		}
+
+		Snapshot snapshot;
+		inputArchive(snapshot.generation, snapshot.hasUnsavedChanges, snapshot.toolbarItems,
+			snapshot.menuItems, snapshot.otherItems);
+		return snapshot;
+	}
+	catch (const std::exception &e)
+	{
+		LOG(error) << L"Failed to load bookmark snapshot: " << utf8StrToWstr(e.what());
+		return std::nullopt;
+	}
+}
+
+void BookmarkJournal::ApplySnapshot(const Snapshot &snapshot)
+{
+	auto addItems = [this](BookmarkItem *parentFolder, const std::vector<ItemRecord> &items)
+	{
+		for (const auto &item : items)
+		{
+			m_bookmarkTree->AddBookmarkItem(parentFolder, item.ToItem(),
+				parentFolder->GetChildren().size());
+		}
+	};
+
+	addItems(m_bookmarkTree->GetBookmarksToolbarFolder(), snapshot.toolbarItems);
+	addItems(m_bookmarkTree->GetBookmarksMenuFolder(), snapshot.menuItems);
+	addItems(m_bookmarkTree->GetOtherBookmarksFolder(), snapshot.otherItems);
+}
+
+// Records that were only partially written are expected (if the application crashed while writing
+// them) and are silently ignored, along with anything after them. The journal is expected to have
+// been validated already.
+std::vector<BookmarkJournal::JournalEntry> BookmarkJournal::ReadJournal(const std::string &contents)
+{
+	std::vector<JournalEntry> entries;
+	size_t offset = sizeof(JournalHeader);
+
+	while (contents.size() - offset >= sizeof(RecordHeader))
+	{
+		RecordHeader recordHeader;
+		memcpy(&recordHeader, contents.data() + offset, sizeof(recordHeader));
+
+		if (recordHeader.size > contents.size() - offset - sizeof(RecordHeader))
+		{
+			break;
+		}
+
+		std::string payload = contents.substr(offset + sizeof(RecordHeader), recordHeader.size);
+
+		if (CalculateChecksum(payload) != recordHeader.checksum)
+		{
+			break;
+		}
+
+		JournalRecord record;
+
+		try
+		{
+			std::stringstream stringstream(payload);
+			cereal::BinaryInputArchive inputArchive(stringstream);
+			inputArchive(record);
+		}
+		catch (const std::exception &e)
+		{
+			LOG(error) << L"Failed to read bookmark journal record: " << utf8StrToWstr(e.what());
+			break;
+		}
+
+		offset += sizeof(RecordHeader) + recordHeader.size;
+		entries.push_back({ std::move(record), offset });
+	}
+
+	return entries;
+}
+
+bool BookmarkJournal::ApplyRecord(const JournalRecord &record)
+{
+	switch (record.type)
+	{
+	case RecordType::Added:
+	{
+		BookmarkItem *parent = m_bookmarkTree->GetBookmarkItemById(record.parentGuid);
+
+		if (!parent || !parent->IsFolder() || !m_bookmarkTree->CanAddChildren(parent)
+			|| m_bookmarkTree->GetBookmarkItemById(record.item.guid))
+		{
+			return false;
+		}
+
+		m_bookmarkTree->AddBookmarkItem(parent, record.item.ToItem(),
+			static_cast<size_t>(record.index));
+	}
+	break;
+
+	case RecordType::Updated:
+	{
+		BookmarkItem *bookmarkItem = m_bookmarkTree->GetBookmarkItemById(record.item.guid);
+
+		if (!bookmarkItem || bookmarkItem->GetType() != record.item.type)
+		{
+			return false;
+		}
+
+		record.item.ApplyProperties(bookmarkItem);
+	}
+	break;
+
+	case RecordType::Moved:
+	{
+		BookmarkItem *bookmarkItem = m_bookmarkTree->GetBookmarkItemById(record.guid);
+		BookmarkItem *newParent = m_bookmarkTree->GetBookmarkItemById(record.parentGuid);
+
+		if (!bookmarkItem || !newParent || !newParent->IsFolder()
+			|| m_bookmarkTree->IsPermanentNode(bookmarkItem)
+			|| !m_bookmarkTree->CanAddChildren(newParent)
+			|| BookmarkHelper::IsAncestor(newParent, bookmarkItem))
+		{
+			return false;
+		}
+
+		// The recorded index is the item's final position. When an item is moved further down
+		// within the same folder, MoveBookmarkItem() expects the index the item would be inserted
+		// at before it's removed from its original position.
+		auto index = static_cast<size_t>(record.index);
+		BookmarkItem *oldParent = bookmarkItem->GetParent();
+
+		if (oldParent == newParent && index > oldParent->GetChildIndex(bookmarkItem))
+		{
+			index++;
+		}
+
+		m_bookmarkTree->MoveBookmarkItem(bookmarkItem, newParent, index);
+	}
+	break;
+
+	case RecordType::Removed:
+	{
+		BookmarkItem *bookmarkItem = m_bookmarkTree->GetBookmarkItemById(record.guid);
+
+		if (!bookmarkItem || m_bookmarkTree->IsPermanentNode(bookmarkItem))
+		{
+			return false;
+		}
+
+		m_bookmarkTree->RemoveBookmarkItem(bookmarkItem);
+	}
+	break;
+
+	case RecordType::Saved:
+		break;
+
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+bool BookmarkJournal::Start()
+{
+	if (!AcquireFiles())
+	{
+		return false;
+	}
+
+	bool res;
+
+	if (m_journalValid)
+	{
+		res = OpenJournalForAppend();
+	}
+	else
+	{
+		res = Compact();
+	}
+
+	if (!res)
+	{
+		return false;
+	}
+
+	m_connections.push_back(m_bookmarkTree->bookmarkItemAddedSignal.AddObserver(
+		std::bind_front(&BookmarkJournal::OnBookmarkItemAdded, this)));
+	m_connections.push_back(m_bookmarkTree->bookmarkItemUpdatedSignal.AddObserver(
+		std::bind_front(&BookmarkJournal::OnBookmarkItemUpdated, this)));
+	m_connections.push_back(m_bookmarkTree->bookmarkItemMovedSignal.AddObserver(
+		std::bind_front(&BookmarkJournal::OnBookmarkItemMoved, this)));
+	m_connections.push_back(m_bookmarkTree->bookmarkItemRemovedSignal.AddObserver(
+		std::bind_front(&BookmarkJournal::OnBookmarkItemRemoved, this)));
+
+	return true;
+}
+
+bool BookmarkJournal::IsActive() const
+{
+	return !m_connections.empty() && m_journalFile;
+}
+
+void BookmarkJournal::OnTreeSaved()
+{
+	if (!IsActive() || !m_hasUnsavedChanges)
+	{
+		return;
+	}
+
+	JournalRecord record;
+	record.type = RecordType::Saved;
+	AppendRecord(record);
+}
+
+int BookmarkJournal::GetNumJournalRecords() const
+{
+	return m_numJournalRecords;
+}
+
+// Any records left at the end of the journal that couldn't be loaded are discarded, so that new
+// records directly follow the ones that were applied.
+bool BookmarkJournal::OpenJournalForAppend()
+{
+	m_journalFile.reset(CreateFile(m_journalPath.c_str(), GENERIC_WRITE, 0, nullptr,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!m_journalFile)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER distance;
+	distance.QuadPart = static_cast<LONGLONG>(m_validJournalSize);
+
+	if (!SetFilePointerEx(m_journalFile.get(), distance, nullptr, FILE_BEGIN)
+		|| !SetEndOfFile(m_journalFile.get()))
+	{
+		m_journalFile.reset();
+		return false;
+	}
+
+	return true;
+}
+
+// The snapshot is written to a temporary file, which then replaces the existing snapshot. If the
+// application crashes before the new snapshot is in place, the existing snapshot and journal will
+// still be loaded. If it crashes after that, but before the journal is reset, the journal will
+// refer to the previous generation and will be ignored (the changes it contains are already part
+// of the new snapshot).
+bool BookmarkJournal::Compact()
+{
+	uint64_t generation = m_generation + 1;
+
+	if (!WriteSnapshot(generation))
+	{
+		LOG(error) << L"Failed to write bookmark snapshot";
+		return false;
+	}
+
+	m_generation = generation;
+
+	if (!ResetJournal())
+	{
+		LOG(error) << L"Failed to reset bookmark journal";
+		m_journalFile.reset();
+		return false;
+	}
+
+	return true;
+}
+
+bool BookmarkJournal::WriteSnapshot(uint64_t generation)
+{
+	auto buildRecords = [](const BookmarkItem *folder)
+	{
+		std::vector<ItemRecord> records;
+
+		for (const auto &child : folder->GetChildren())
+		{
+			records.push_back(ItemRecord::FromItem(child.get(), true));
+		}
+
+		return records;
+	};
+
+	std::stringstream stringstream;
+
+	{
+		cereal::BinaryOutputArchive outputArchive(stringstream);
+		outputArchive(SNAPSHOT_SIGNATURE, FORMAT_VERSION, generation, m_hasUnsavedChanges,
+			buildRecords(m_bookmarkTree->GetBookmarksToolbarFolder()),
+			buildRecords(m_bookmarkTree->GetBookmarksMenuFolder()),
+			buildRecords(m_bookmarkTree->GetOtherBookmarksFolder()));
+	}
+
+	std::wstring tempPath = m_snapshotPath + L".tmp";
+
+	{
+		wil::unique_hfile file(CreateFile(tempPath.c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+		if (!file || !WriteAndFlush(file.get(), stringstream.str()))
+		{
+			return false;
+		}
+	}
+
+	return MoveFileEx(tempPath.c_str(), m_snapshotPath.c_str(),
+		MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+}
+
+bool BookmarkJournal::ResetJournal()
+{
+	m_journalFile.reset(CreateFile(m_journalPath.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+
+	if (!m_journalFile)
+	{
+		return false;
+	}
+
+	JournalHeader header = { JOURNAL_SIGNATURE, FORMAT_VERSION, m_generation };
+	std::string data(reinterpret_cast<const char *>(&header), sizeof(header));
+
+	if (!WriteAndFlush(m_journalFile.get(), data))
+	{
+		return false;
+	}
+
+	m_numJournalRecords = 0;
+
+	return true;
+}
+
+void BookmarkJournal::AppendRecord(const JournalRecord &record)
+{
+	if (!m_journalFile)
+	{
+		return;
+	}
+
+	std::stringstream stringstream;
+
+	{
+		cereal::BinaryOutputArchive outputArchive(stringstream);
+		outputArchive(record);
+	}
+
+	std::string payload = stringstream.str();
+	RecordHeader recordHeader = { static_cast<uint32_t>(payload.size()),
+		CalculateChecksum(payload) };
+
+	std::string data(reinterpret_cast<const char *>(&recordHeader), sizeof(recordHeader));
+	data += payload;
+
+	if (!WriteAndFlush(m_journalFile.get(), data))
+	{
+		// It's not safe to append anything further, since the journal may now end with a partial
+		// record.
+		LOG(error) << L"Failed to write to bookmark journal";
+		m_journalFile.reset();
+		return;
+	}
+
+	m_numJournalRecords++;
+	m_hasUnsavedChanges = record.type != RecordType::Saved;
+
+	if (m_numJournalRecords >= m_compactionThreshold)
+	{
+		Compact();
+	}
+}
+
+void BookmarkJournal::OnBookmarkItemAdded(BookmarkItem &bookmarkItem, size_t index)
+{
+	JournalRecord record;
+	record.type = RecordType::Added;
+	record.parentGuid = bookmarkItem.GetParent()->GetGUID();
+	record.index = index;
+	record.item = ItemRecord::FromItem(&bookmarkItem, true);
+	AppendRecord(record);
+}
+
+void BookmarkJournal::OnBookmarkItemUpdated(BookmarkItem &bookmarkItem,
+	BookmarkItem::PropertyType propertyType)
+{
+	UNREFERENCED_PARAMETER(propertyType);
+
+	// All of the item's properties are recorded, since changing one property can also change
+	// another (e.g. renaming an item updates its modification date).
+	JournalRecord record;
+	record.type = RecordType::Updated;
+	record.item = ItemRecord::FromItem(&bookmarkItem, false);
+	AppendRecord(record);
+}
+
+void BookmarkJournal::OnBookmarkItemMoved(BookmarkItem *bookmarkItem,
+	const BookmarkItem *oldParent, size_t oldIndex, const BookmarkItem *newParent,
+	size_t newIndex)
+{
+	UNREFERENCED_PARAMETER(oldParent);
+	UNREFERENCED_PARAMETER(oldIndex);
+
+	JournalRecord record;
+	record.type = RecordType::Moved;
+	record.guid = bookmarkItem->GetGUID();
+	record.parentGuid = newParent->GetGUID();
+	record.index = newIndex;
+	AppendRecord(record);
+}
+
+void BookmarkJournal::OnBookmarkItemRemoved(const std::wstring &guid)
+{
+	JournalRecord record;
+	record.type = RecordType::Removed;
+	record.guid = guid;
+	AppendRecord(record);
+}
@@ -0,0 +1,116 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "Bookmarks/BookmarkItem.h"
+#include <boost/signals2.hpp>
+#include <wil/resource.h>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+class BookmarkTree;
+
+// Saves a bookmark tree incrementally. Rather than writing out the entire tree each time the
+// bookmarks are saved, each change to the tree is appended to a journal file as it's made. The
+// journal is flushed after every change, so the saved state remains consistent with the tree, even
+// if the application crashes.
+//
+// The saved state consists of a snapshot of the tree, plus the changes in the journal that follow
+// it. Once the journal contains enough changes, it's compacted (i.e. a new snapshot is written and
+// the journal is emptied).
+//
+// While the journal is active, it's the authoritative copy of the tree, so the tree doesn't need to
+// be saved in full (e.g. to the registry). If the tree is saved in full anyway, the journal can be
+// told about it, in which case the tree will be loaded from the full save, until it's changed
+// again. Only a single instance can use a given set of files at a time. Any other instance won't be
+// able to load or start the journal.
+class BookmarkJournal
+{
+public:
+	static constexpr int DEFAULT_COMPACTION_THRESHOLD = 1000;
+
+	BookmarkJournal(BookmarkTree *bookmarkTree, const std::wstring &snapshotPath,
+		const std::wstring &journalPath, int compactionThreshold = DEFAULT_COMPACTION_THRESHOLD);
+
+	// Loads the saved state into the tree, which is expected to be empty. Returns false if there's
+	// no saved state, if the saved state doesn't contain any changes made since the last full save
+	// (in which case, the tree should be loaded from the full save instead), or if the files are in
+	// use by another instance.
+	bool Load();
+
+	// Starts recording changes to the tree. Changes are appended to the existing journal if the
+	// tree was either loaded from it, or loaded from a full save that the journal already matches.
+	// Otherwise (e.g. the first time the journal is used), a snapshot of the tree is written first.
+	// Returns false if the files couldn't be written, or are in use by another instance, in which
+	// case no changes will be recorded.
+	bool Start();
+
+	// True if changes to the tree are currently being recorded.
+	bool IsActive() const;
+
+	// Writes a snapshot of the tree and empties the journal.
+	bool Compact();
+
+	// Should be called once a full save of the tree has been written. Any changes recorded up to
+	// this point won't be loaded again, unless further changes are made. This only appends a marker
+	// to the journal; it doesn't write a new snapshot.
+	void OnTreeSaved();
+
+	int GetNumJournalRecords() const;
+
+private:
+	struct ItemRecord;
+	struct JournalRecord;
+	struct JournalEntry;
+	struct Snapshot;
+
+	void OnBookmarkItemAdded(BookmarkItem &bookmarkItem, size_t index);
+	void OnBookmarkItemUpdated(BookmarkItem &bookmarkItem, BookmarkItem::PropertyType propertyType);
+	void OnBookmarkItemMoved(BookmarkItem *bookmarkItem, const BookmarkItem *oldParent,
+		size_t oldIndex, const BookmarkItem *newParent, size_t newIndex);
+	void OnBookmarkItemRemoved(const std::wstring &guid);
+
+	bool AcquireFiles();
+	std::optional<Snapshot> ReadSnapshot();
+	void ApplySnapshot(const Snapshot &snapshot);
+	std::vector<JournalEntry> ReadJournal(const std::string &contents);
+	bool ApplyRecord(const JournalRecord &record);
+	bool WriteSnapshot(uint64_t generation);
+	bool ResetJournal();
+	bool OpenJournalForAppend();
+	void AppendRecord(const JournalRecord &record);
+
+	BookmarkTree *const m_bookmarkTree;
+	const std::wstring m_snapshotPath;
+	const std::wstring m_journalPath;
+	const int m_compactionThreshold;
+
+	// Incremented each time a snapshot is written. The journal records the generation of the
+	// snapshot it follows on from, so that a journal left over from before the most recent snapshot
+	// (e.g. because the application crashed during compaction) is ignored.
+	uint64_t m_generation = 0;
+
+	// True if the tree contains changes that haven't been saved in full yet. This is recorded in
+	// each snapshot, since a snapshot written during compaction can contain such changes, even
+	// though the journal following it is empty. Within the journal, a saved marker clears it and
+	// any other record sets it again.
+	bool m_hasUnsavedChanges = false;
+
+	// Held open for as long as this instance is using the files.
+	wil::unique_hfile m_lockFile;
+
+	// True if the existing journal follows on from the snapshot and matches the tree (whether the
+	// tree was loaded from the journal, or from a full save that the journal matches), so that
+	// further records can be appended to it.
+	bool m_journalValid = false;
+	uint64_t m_validJournalSize = 0;
+
+	wil::unique_hfile m_journalFile;
+	int m_numJournalRecords = 0;
+
+	std::vector<boost::signals2::scoped_connection> m_connections;
+};
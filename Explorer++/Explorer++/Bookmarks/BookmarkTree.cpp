@@ -30,6 +30,8 @@ BookmarkTree::BookmarkTree() :
 		std::nullopt);
 	m_otherBookmarks = otherBookmarksFolder.get();
 	m_root.AddChild(std::move(otherBookmarksFolder));
+
+	m_root.VisitRecursively(std::bind_front(&BookmarkTree::AddToIndex, this));
 }
 
 BookmarkItem *BookmarkTree::GetRoot()
@@ -87,6 +89,8 @@ BookmarkItem *BookmarkTree::AddBookmarkItem(BookmarkItem *parent,
 			currentItem->updatedSignal.AddObserver(
 				std::bind_front(&BookmarkTree::OnBookmarkItemUpdated, this),
 				boost::signals2::at_front);
+
+			AddToIndex(currentItem);
 		});
 
 	if (index > parent->GetChildren().size())
@@ -148,6 +152,12 @@ void BookmarkTree::RemoveBookmarkItem(BookmarkItem *bookmarkItem)
 
 	std::wstring guid = bookmarkItem->GetGUID();
 
+	bookmarkItem->VisitRecursively(
+		[this](BookmarkItem *currentItem)
+		{
+			m_guidIndex.erase(currentItem->GetGUID());
+		});
+
 	size_t childIndex = parent->GetChildIndex(bookmarkItem);
 	parent->RemoveChild(childIndex);
 	bookmarkItemRemovedSignal.m_signal(guid);
@@ -159,6 +169,14 @@ void BookmarkTree::OnBookmarkItemUpdated(BookmarkItem &bookmarkItem,
 	bookmarkItemUpdatedSignal.m_signal(bookmarkItem, propertyType);
 }
 
+void BookmarkTree::AddToIndex(BookmarkItem *bookmarkItem)
+{
+	// GUIDs are generated whenever an item is created, so they should always be unique.
+	assert(!m_guidIndex.contains(bookmarkItem->GetGUID()));
+
+	m_guidIndex.emplace(bookmarkItem->GetGUID(), bookmarkItem);
+}
+
 bool BookmarkTree::CanAddChildren(const BookmarkItem *bookmarkItem) const
 {
 	return bookmarkItem != &m_root;
@@ -174,3 +192,15 @@ bool BookmarkTree::IsPermanentNode(const BookmarkItem *bookmarkItem) const
 
 	return false;
 }
+
+BookmarkItem *BookmarkTree::GetBookmarkItemById(std::wstring_view guid)
+{
+	auto itr = m_guidIndex.find(std::wstring(guid));
+
+	if (itr == m_guidIndex.end())
+	{
+		return nullptr;
+	}
+
+	return itr->second;
+}
@@ -7,6 +7,8 @@
 #include "Bookmarks/BookmarkItem.h"
 #include "SignalWrapper.h"
 #include <tchar.h>
+#include <string>
+#include <unordered_map>
 
 class BookmarkTree
 {
@@ -24,6 +26,8 @@ public:
 	bool CanAddChildren(const BookmarkItem *bookmarkItem) const;
 	bool IsPermanentNode(const BookmarkItem *bookmarkItem) const;
 
+	BookmarkItem *GetBookmarkItemById(std::wstring_view guid);
+
 	BookmarkItem *AddBookmarkItem(BookmarkItem *parent, std::unique_ptr<BookmarkItem> bookmarkItem,
 		size_t index);
 	void MoveBookmarkItem(BookmarkItem *bookmarkItem, BookmarkItem *newParent, size_t index);
@@ -51,9 +55,15 @@ private:
 	static inline const TCHAR *OTHER_FOLDER_GUID = _T("00000000-0000-0000-0000-000000000004");
 
 	void OnBookmarkItemUpdated(BookmarkItem &bookmarkItem, BookmarkItem::PropertyType propertyType);
+	void AddToIndex(BookmarkItem *bookmarkItem);
 
 	BookmarkItem m_root;
 	BookmarkItem *m_bookmarksToolbar;
 	BookmarkItem *m_bookmarksMenu;
 	BookmarkItem *m_otherBookmarks;
+
+	// Maps the GUID of every item in the tree (including the permanent folders) to the item. An
+	// item's GUID never changes, so the index only needs to be updated when items are added or
+	// removed.
+	std::unordered_map<std::wstring, BookmarkItem *> m_guidIndex;
 };
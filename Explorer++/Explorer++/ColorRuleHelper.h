@@ -6,6 +6,8 @@
 
 #include <MsXml2.h>
 #include <objbase.h>
+#include <string>
+#include <vector>
 
 namespace NColorRuleHelper
 {
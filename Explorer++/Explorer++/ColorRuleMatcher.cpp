@@ -0,0 +1,189 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ColorRuleMatcher.h"
+
+namespace
+{
+
+std::wstring ToLowercase(const std::wstring &str)
+{
+	if (str.empty())
+	{
+		return str;
+	}
+
+	int length = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, str.c_str(),
+		static_cast<int>(str.size()), nullptr, 0);
+
+	if (length == 0)
+	{
+		return str;
+	}
+
+	std::wstring lowercaseStr(length, '\0');
+	LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, str.c_str(), static_cast<int>(str.size()),
+		lowercaseStr.data(), length);
+
+	return lowercaseStr;
+}
+
+// Returns true if the pattern is of the form "*.ext", where ext doesn't contain any wildcard
+// characters or periods. A pattern like that matches exactly those files whose extension is ext.
+bool IsExtensionPattern(const std::wstring &pattern)
+{
+	if (pattern.size() < 3 || pattern[0] != '*' || pattern[1] != '.')
+	{
+		return false;
+	}
+
+	return pattern.find_first_of(L"*?.", 2) == std::wstring::npos;
+}
+
+}
+
+int ColorRuleMatcher::idCounter = 0;
+
+ColorRuleMatcher::ColorRuleMatcher(const std::vector<NColorRuleHelper::ColorRule> &colorRules) :
+	m_id(idCounter++)
+{
+	for (const auto &colorRule : colorRules)
+	{
+		m_rules.push_back(CompileRule(colorRule));
+
+		if (m_rules.back().caseInsensitive)
+		{
+			m_hasCaseInsensitiveRule = true;
+		}
+	}
+}
+
+ColorRuleMatcher::CompiledRule ColorRuleMatcher::CompileRule(
+	const NColorRuleHelper::ColorRule &colorRule)
+{
+	CompiledRule compiledRule;
+	compiledRule.caseInsensitive = colorRule.caseInsensitive;
+	compiledRule.attributes = colorRule.dwFilterAttributes;
+	compiledRule.color = colorRule.rgbColour;
+
+	if (colorRule.strFilterPattern.empty())
+	{
+		compiledRule.matchAllNames = true;
+		return compiledRule;
+	}
+
+	std::wstring filterPattern = colorRule.strFilterPattern;
+
+	if (compiledRule.caseInsensitive)
+	{
+		filterPattern = ToLowercase(filterPattern);
+	}
+
+	auto addPattern = [&compiledRule](const std::wstring &pattern)
+	{
+		if (IsExtensionPattern(pattern))
+		{
+			compiledRule.extensions.insert(pattern.substr(2));
+		}
+		else
+		{
+			compiledRule.patterns.emplace_back(pattern, !compiledRule.caseInsensitive);
+		}
+	};
+
+	// Multiple patterns can be specified by separating them with ':' (e.g. "*.h: *.cpp"). In that
+	// case, whitespace around each of the individual patterns is ignored and empty patterns are
+	// skipped.
+	if (filterPattern.find(':') == std::wstring::npos)
+	{
+		addPattern(filterPattern);
+		return compiledRule;
+	}
+
+	size_t start = 0;
+
+	while (start <= filterPattern.size())
+	{
+		size_t end = filterPattern.find(':', start);
+
+		if (end == std::wstring::npos)
+		{
+			end = filterPattern.size();
+		}
+
+		std::wstring pattern = filterPattern.substr(start, end - start);
+		TrimString(pattern, L" ");
+
+		if (!pattern.empty())
+		{
+			addPattern(pattern);
+		}
+
+		start = end + 1;
+	}
+
+	return compiledRule;
+}
+
+int ColorRuleMatcher::GetId() const
+{
+	return m_id;
+}
+
+std::optional<COLORREF> ColorRuleMatcher::GetMatchingColor(const std::wstring &fileName,
+	DWORD attributes) const
+{
+	std::wstring extension = GetExtension(fileName);
+	std::wstring lowercaseExtension;
+
+	if (m_hasCaseInsensitiveRule)
+	{
+		lowercaseExtension = ToLowercase(extension);
+	}
+
+	for (const auto &rule : m_rules)
+	{
+		if (rule.attributes != 0 && (rule.attributes & attributes) == 0)
+		{
+			continue;
+		}
+
+		if (rule.matchAllNames)
+		{
+			return rule.color;
+		}
+
+		const std::wstring &ext = rule.caseInsensitive ? lowercaseExtension : extension;
+
+		if (!rule.extensions.empty() && rule.extensions.contains(ext))
+		{
+			return rule.color;
+		}
+
+		for (const auto &pattern : rule.patterns)
+		{
+			if (pattern.Matches(fileName))
+			{
+				return rule.color;
+			}
+		}
+	}
+
+	return std::nullopt;
+}
+
+// Returns the text after the final period in the filename, or an empty string if there is no
+// period.
+std::wstring ColorRuleMatcher::GetExtension(const std::wstring &fileName)
+{
+	auto index = fileName.find_last_of('.');
+
+	if (index == std::wstring::npos)
+	{
+		return {};
+	}
+
+	return fileName.substr(index + 1);
+}
@@ -0,0 +1,51 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ColorRuleHelper.h"
+#include "../Helper/StringHelper.h"
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// Color rules are checked every time an item in the listview is drawn, so they're converted into a
+// form that can be matched quickly. Each rule's filename pattern is split into its individual
+// subpatterns once, rather than each time an item is checked. Subpatterns that simply match a file
+// extension (e.g. "*.txt") are placed in a hash set, so that they can be checked with a single
+// lookup. The remaining subpatterns are precompiled into wildcard patterns.
+class ColorRuleMatcher
+{
+public:
+	ColorRuleMatcher(const std::vector<NColorRuleHelper::ColorRule> &colorRules);
+
+	// Each matcher is assigned a unique ID. That allows the result of a match to be cached
+	// alongside the ID of the matcher that produced it. If the color rules change, a new matcher
+	// will be created and any previously cached results will no longer be used.
+	int GetId() const;
+
+	// Returns the color of the first rule that matches the specified file, if any.
+	std::optional<COLORREF> GetMatchingColor(const std::wstring &fileName, DWORD attributes) const;
+
+private:
+	struct CompiledRule
+	{
+		bool matchAllNames = false;
+		bool caseInsensitive = false;
+		std::unordered_set<std::wstring> extensions;
+		std::vector<WildcardPattern> patterns;
+		DWORD attributes = 0;
+		COLORREF color = 0;
+	};
+
+	static CompiledRule CompileRule(const NColorRuleHelper::ColorRule &colorRule);
+	static std::wstring GetExtension(const std::wstring &fileName);
+
+	static int idCounter;
+
+	const int m_id;
+	std::vector<CompiledRule> m_rules;
+	bool m_hasCaseInsensitiveRule = false;
+};
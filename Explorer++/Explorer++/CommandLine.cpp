@@ -157,6 +157,18 @@ std::variant<CommandLine::Settings, CommandLine::ExitInfo> CommandLine::ProcessC
 			{ "all", ShellChangeNotificationType::All } }))
 		->default_val("non-filesystem");
 
+	settings.tabHibernationTimeout = 0;
+	app.add_option("--hibernate-tabs-after", settings.tabHibernationTimeout,
+		   "Release the contents of tabs that haven't been selected for the specified number of "
+		   "minutes. The contents are reloaded when the tab is next selected.")
+		->check(CLI::NonNegativeNumber);
+
+	settings.virtualListView = false;
+	app.add_flag("--virtual-list-view", settings.virtualListView,
+		"Only retrieve the details of the items that are currently visible in each tab. Intended "
+		"for folders that contain a very large number of items. Grouping and manually positioning "
+		"items aren't supported in this mode.");
+
 	app.add_option("--language", settings.language,
 		"Allows you to select your desired language. Should be a two-letter language code (e.g. "
 		"FR, RU, etc).");
@@ -13,6 +13,8 @@ namespace CommandLine
 	{
 		bool enablePlugins;
 		ShellChangeNotificationType shellChangeNotificationType;
+		int tabHibernationTimeout;
+		bool virtualListView;
 		std::wstring language;
 		std::vector<std::wstring> directories;
 	};
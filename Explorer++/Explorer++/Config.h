@@ -12,6 +12,7 @@
 #include "../Helper/SetDefaultFileManager.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/StringHelper.h"
+#include <chrono>
 
 static const int DEFAULT_LISTVIEW_HOVER_TIME = 500;
 
@@ -76,6 +77,8 @@ struct Config
 		treeViewWidth = DEFAULT_TREEVIEW_WIDTH;
 		checkPinnedToNamespaceTreeProperty = false;
 		shellChangeNotificationType = ShellChangeNotificationType::Disabled;
+		tabHibernationTimeout = std::chrono::minutes::zero();
+		virtualListView = false;
 
 		replaceExplorerMode = DefaultFileManager::ReplaceExplorerMode::None;
 
@@ -184,6 +187,15 @@ struct Config
 	bool checkPinnedToNamespaceTreeProperty;
 	ShellChangeNotificationType shellChangeNotificationType;
 
+	// Tabs that haven't been selected for this period of time will be hibernated. A value of zero
+	// means that tabs will never be hibernated.
+	std::chrono::minutes tabHibernationTimeout;
+
+	// If set, the listview in each tab is created in owner data mode, so that the listview itself
+	// doesn't store any data for the items it contains. This can't be changed once the application
+	// has started, since the mode is determined by the style the listview is created with.
+	bool virtualListView;
+
 	DefaultFileManager::ReplaceExplorerMode replaceExplorerMode;
 
 	BOOL showInfoTips;
@@ -35,9 +35,9 @@ using ToolbarContextMenuSignal =
 using FocusChangedSignal = boost::signals2::signal<void(WindowFocusSource windowFocusSource)>;
 using ApplicationShuttingDownSignal = boost::signals2::signal<void()>;
 
-class CachedIcons;
 struct Config;
 class IconResourceLoader;
+class IconService;
 __interface IDirectoryMonitor;
 class ShellBrowser;
 class StatusBar;
@@ -63,7 +63,7 @@ __interface IExplorerplusplus
 	IDirectoryMonitor *GetDirectoryMonitor() const;
 
 	IconResourceLoader *GetIconResourceLoader() const;
-	CachedIcons *GetCachedIcons();
+	IconService *GetIconService();
 
 	HWND GetTreeView() const;
 
@@ -6,11 +6,14 @@
 #include "DestroyFilesDialog.h"
 #include "Explorer++_internal.h"
 #include "MainResource.h"
+#include "ResourceHelper.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/StringHelper.h"
 #include "../Helper/XMLSettings.h"
+#include <algorithm>
+#include <thread>
 
 const TCHAR DestroyFilesDialogPersistentSettings::SETTINGS_KEY[] = _T("DestroyFiles");
 
@@ -19,7 +22,8 @@ const TCHAR DestroyFilesDialogPersistentSettings::SETTING_OVERWRITE_METHOD[] =
 
 DestroyFilesDialog::DestroyFilesDialog(HINSTANCE hInstance, HWND hParent,
 	const std::list<std::wstring> &FullFilenameList, BOOL bShowFriendlyDates) :
-	DarkModeDialogBase(hInstance, IDD_DESTROYFILES, hParent, true)
+	DarkModeDialogBase(hInstance, IDD_DESTROYFILES, hParent, true),
+	m_numFilesRemaining(0)
 {
 	m_FullFilenameList = FullFilenameList;
 	m_bShowFriendlyDates = bShowFriendlyDates;
@@ -163,6 +167,16 @@ void DestroyFilesDialog::GetResizableControlInformation(BaseDialog::DialogSizeCo
 	control.Constraint = ResizableDialog::ControlConstraint::Y;
 	ControlList.push_back(control);
 
+	control.iID = IDC_DESTROYFILES_PROGRESS;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::Y;
+	ControlList.push_back(control);
+
+	control.iID = IDC_DESTROYFILES_PROGRESS;
+	control.Type = ResizableDialog::ControlType::Resize;
+	control.Constraint = ResizableDialog::ControlConstraint::X;
+	ControlList.push_back(control);
+
 	control.iID = IDC_DESTROYFILES_STATIC_WARNING_MESSAGE;
 	control.Type = ResizableDialog::ControlType::Move;
 	control.Constraint = ResizableDialog::ControlConstraint::Y;
@@ -214,12 +228,40 @@ INT_PTR DestroyFilesDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 	return 0;
 }
 
+INT_PTR DestroyFilesDialog::OnTimer(int iTimerID)
+{
+	if (iTimerID == PROGRESS_TIMER_ID)
+	{
+		UpdateProgress();
+	}
+
+	return 0;
+}
+
 INT_PTR DestroyFilesDialog::OnClose()
 {
+	if (m_destroyOperation)
+	{
+		CancelDestroying();
+		return 0;
+	}
+
 	EndDialog(m_hDlg, 0);
 	return 0;
 }
 
+INT_PTR DestroyFilesDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+	switch (uMsg)
+	{
+	case WM_APP_FILE_DESTROYED:
+		OnFileDestroyed(static_cast<int>(wParam), static_cast<HRESULT>(lParam));
+		break;
+	}
+
+	return 0;
+}
+
 void DestroyFilesDialog::SaveState()
 {
 	m_pdfdps->SaveDialogPosition(m_hDlg);
@@ -261,6 +303,12 @@ void DestroyFilesDialog::OnOk()
 
 void DestroyFilesDialog::OnCancel()
 {
+	if (m_destroyOperation)
+	{
+		CancelDestroying();
+		return;
+	}
+
 	EndDialog(m_hDlg, 0);
 }
 
@@ -277,13 +325,142 @@ void DestroyFilesDialog::OnConfirmDestroy()
 		overwriteMethod = NFileOperations::OverwriteMethod::ThreePass;
 	}
 
-	/* TODO: Perform in background thread. */
+	StartDestroying(overwriteMethod);
+}
+
+void DestroyFilesDialog::StartDestroying(NFileOperations::OverwriteMethod overwriteMethod)
+{
+	if (m_FullFilenameList.empty())
+	{
+		EndDialog(m_hDlg, 1);
+		return;
+	}
+
+	m_destroyOperation = std::make_shared<DestroyOperation>();
+
 	for (const auto &strFullFilename : m_FullFilenameList)
 	{
-		DeleteFileSecurely(strFullFilename, overwriteMethod);
+		m_destroyOperation->totalBytes +=
+			NFileOperations::GetSecureDeleteSize(strFullFilename, overwriteMethod);
 	}
 
-	EndDialog(m_hDlg, 1);
+	EnableWindow(GetDlgItem(m_hDlg, IDOK), FALSE);
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DESTROYFILES_RADIO_ONEPASS), FALSE);
+	EnableWindow(GetDlgItem(m_hDlg, IDC_DESTROYFILES_RADIO_THREEPASS), FALSE);
+
+	SendDlgItemMessage(m_hDlg, IDC_DESTROYFILES_PROGRESS, PBM_SETRANGE32, 0, PROGRESS_RANGE);
+	SendDlgItemMessage(m_hDlg, IDC_DESTROYFILES_PROGRESS, PBM_SETPOS, 0, 0);
+
+	int numFiles = static_cast<int>(m_FullFilenameList.size());
+	int numThreads = std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1,
+		MAX_DESTROY_THREADS);
+	numThreads = (std::min)(numThreads, numFiles);
+	m_destroyThreadPool = std::make_unique<ctpl::thread_pool>(numThreads);
+
+	m_numFilesRemaining = numFiles;
+	m_failedFiles.clear();
+
+	int fileIndex = 0;
+
+	for (const auto &strFullFilename : m_FullFilenameList)
+	{
+		m_destroyThreadPool->push(
+			[hDlg = m_hDlg, operation = m_destroyOperation, strFullFilename, overwriteMethod,
+				fileIndex](int id)
+			{
+				UNREFERENCED_PARAMETER(id);
+
+				HRESULT hr = E_ABORT;
+
+				if (!operation->cancelled)
+				{
+					ULONGLONG previousBytesWritten = 0;
+
+					hr = NFileOperations::DeleteFileSecurely(strFullFilename, overwriteMethod,
+						[&operation, &previousBytesWritten](ULONGLONG bytesWritten,
+							ULONGLONG totalBytes)
+						{
+							UNREFERENCED_PARAMETER(totalBytes);
+
+							operation->bytesWritten += bytesWritten - previousBytesWritten;
+							previousBytesWritten = bytesWritten;
+
+							return !operation->cancelled;
+						});
+				}
+
+				PostMessage(hDlg, WM_APP_FILE_DESTROYED, fileIndex, hr);
+			});
+
+		fileIndex++;
+	}
+
+	SetTimer(m_hDlg, PROGRESS_TIMER_ID, PROGRESS_TIMER_ELAPSE, nullptr);
+}
+
+// Any files that are currently being overwritten will be left in place, partially overwritten.
+// Files that haven't been started yet will be left untouched.
+void DestroyFilesDialog::CancelDestroying()
+{
+	m_destroyOperation->cancelled = true;
+
+	EnableWindow(GetDlgItem(m_hDlg, IDCANCEL), FALSE);
+}
+
+void DestroyFilesDialog::OnFileDestroyed(int fileIndex, HRESULT hr)
+{
+	// Files that were skipped or stopped part way through because the operation was cancelled
+	// aren't treated as failures.
+	if (FAILED(hr) && hr != E_ABORT)
+	{
+		m_failedFiles.push_back(*std::next(m_FullFilenameList.begin(), fileIndex));
+	}
+
+	m_numFilesRemaining--;
+
+	if (m_numFilesRemaining > 0)
+	{
+		return;
+	}
+
+	KillTimer(m_hDlg, PROGRESS_TIMER_ID);
+	UpdateProgress();
+
+	bool cancelled = m_destroyOperation->cancelled;
+
+	// All of the tasks have finished at this point, so this won't block.
+	m_destroyThreadPool.reset();
+	m_destroyOperation.reset();
+
+	if (!m_failedFiles.empty())
+	{
+		std::wstring message =
+			ResourceHelper::LoadString(GetInstance(), IDS_DESTROY_FILES_FAILED) + L"\n";
+
+		for (const auto &failedFile : m_failedFiles)
+		{
+			message += L"\n" + failedFile;
+		}
+
+		MessageBox(m_hDlg, message.c_str(), NExplorerplusplus::APP_NAME, MB_ICONWARNING | MB_OK);
+	}
+
+	EndDialog(m_hDlg, (cancelled || !m_failedFiles.empty()) ? 0 : 1);
+}
+
+void DestroyFilesDialog::UpdateProgress()
+{
+	if (!m_destroyOperation || m_destroyOperation->totalBytes == 0)
+	{
+		return;
+	}
+
+	ULONGLONG bytesWritten =
+		(std::min)(m_destroyOperation->bytesWritten.load(), m_destroyOperation->totalBytes);
+	auto position =
+		static_cast<int>((bytesWritten * PROGRESS_RANGE) / m_destroyOperation->totalBytes);
+
+	SendDlgItemMessage(m_hDlg, IDC_DESTROYFILES_PROGRESS, PBM_SETPOS, position, 0);
 }
 
 DestroyFilesDialogPersistentSettings::DestroyFilesDialogPersistentSettings() :
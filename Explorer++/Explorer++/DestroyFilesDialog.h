@@ -8,7 +8,11 @@
 #include "../Helper/DialogSettings.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/ResizableDialog.h"
+#include "../ThirdParty/CTPL/cpl_stl.h"
 #include <wil/resource.h>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 class DestroyFilesDialog;
 
@@ -48,9 +52,30 @@ protected:
 	INT_PTR OnInitDialog() override;
 	INT_PTR OnCtlColorStaticExtra(HWND hwnd, HDC hdc) override;
 	INT_PTR OnCommand(WPARAM wParam, LPARAM lParam) override;
+	INT_PTR OnTimer(int iTimerID) override;
 	INT_PTR OnClose() override;
+	INT_PTR OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam) override;
 
 private:
+	// State shared between the dialog and the tasks that overwrite each file.
+	struct DestroyOperation
+	{
+		std::atomic_bool cancelled = false;
+		std::atomic<ULONGLONG> bytesWritten = 0;
+		ULONGLONG totalBytes = 0;
+	};
+
+	static const UINT WM_APP_FILE_DESTROYED = WM_APP + 1;
+
+	static const UINT_PTR PROGRESS_TIMER_ID = 1;
+	static const UINT PROGRESS_TIMER_ELAPSE = 100;
+
+	static const int PROGRESS_RANGE = 1000;
+
+	// Files are overwritten in parallel, up to this limit. Using more threads than this is
+	// unlikely to improve throughput, since the operation is bound by the speed of the disk.
+	static const int MAX_DESTROY_THREADS = 4;
+
 	void GetResizableControlInformation(BaseDialog::DialogSizeConstraint &dsc,
 		std::list<ResizableDialog::Control> &ControlList) override;
 	void SaveState() override;
@@ -58,6 +83,10 @@ private:
 	void OnOk();
 	void OnCancel();
 	void OnConfirmDestroy();
+	void StartDestroying(NFileOperations::OverwriteMethod overwriteMethod);
+	void CancelDestroying();
+	void OnFileDestroyed(int fileIndex, HRESULT hr);
+	void UpdateProgress();
 
 	std::list<std::wstring> m_FullFilenameList;
 
@@ -66,4 +95,9 @@ private:
 	DestroyFilesDialogPersistentSettings *m_pdfdps;
 
 	BOOL m_bShowFriendlyDates;
+
+	std::unique_ptr<ctpl::thread_pool> m_destroyThreadPool;
+	std::shared_ptr<DestroyOperation> m_destroyOperation;
+	int m_numFilesRemaining;
+	std::vector<std::wstring> m_failedFiles;
 };
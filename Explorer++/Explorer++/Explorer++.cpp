@@ -5,9 +5,11 @@
 #include "stdafx.h"
 #include "Explorer++.h"
 #include "Bookmarks/BookmarkIconManager.h"
+#include "Bookmarks/BookmarkJournal.h"
 #include "Bookmarks/UI/BookmarksMainMenu.h"
 #include "Bookmarks/UI/BookmarksToolbar.h"
 #include "ColorRuleHelper.h"
+#include "ColorRuleMatcher.h"
 #include "Config.h"
 #include "Explorer++_internal.h"
 #include "MenuRanges.h"
@@ -33,10 +35,11 @@ Explorerplusplus::Explorerplusplus(HWND hwnd, CommandLine::Settings *commandLine
 	m_hContainer(hwnd),
 	m_commandLineSettings(*commandLineSettings),
 	m_cachedIcons(MAX_CACHED_ICONS),
+	m_iconService(hwnd, &m_cachedIcons),
 	m_pluginMenuManager(hwnd, MENU_PLUGIN_STARTID, MENU_PLUGIN_ENDID),
 	m_acceleratorUpdater(&g_hAccl),
 	m_pluginCommandManager(&g_hAccl, ACCELERATOR_PLUGIN_STARTID, ACCELERATOR_PLUGIN_ENDID),
-	m_bookmarkIconFetcher(hwnd, &m_cachedIcons),
+	m_bookmarkIconFetcher(&m_iconService),
 	m_tabBarBackgroundBrush(CreateSolidBrush(TAB_BAR_DARK_MODE_BACKGROUND_COLOR))
 {
 	m_hLanguageModule = nullptr;
@@ -22,6 +22,8 @@
 #include "../Helper/FileActionHandler.h"
 #include "../Helper/FileContextMenuManager.h"
 #include "../Helper/IconFetcher.h"
+#include "../Helper/IconService.h"
+#include "../Helper/XmlStreamReader.h"
 #include <boost/signals2.hpp>
 #include <wil/resource.h>
 #include <optional>
@@ -29,6 +31,10 @@
 /* Sent when a folder size calculation has finished. */
 #define WM_APP_FOLDERSIZECOMPLETED WM_APP + 3
 
+/* Sent when an item changes anywhere in the filesystem, so that
+any cached folder sizes can be discarded. */
+#define WM_APP_FOLDERSIZECHANGED WM_APP + 4
+
 /* Private definitions. */
 #define FROM_LISTVIEW 0
 #define FROM_TREEVIEW 1
@@ -36,10 +42,13 @@
 // Forward declarations.
 class AddressBar;
 class ApplicationToolbar;
+class BookmarkJournal;
 class BookmarksMainMenu;
 class BookmarksToolbar;
+class ColorRuleMatcher;
 struct ColumnWidth;
 struct Config;
+struct DirectoryChange;
 class DrivesToolbar;
 class IconResourceLoader;
 __interface IDirectoryMonitor;
@@ -89,7 +98,7 @@ public:
 	LRESULT CALLBACK TreeViewSubclass(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 	/* Directory modification. */
-	static void DirectoryAlteredCallback(const TCHAR *szFileName, DWORD dwAction, void *pData);
+	static void DirectoryAlteredCallback(const std::vector<DirectoryChange> &changes, void *pData);
 
 private:
 	static const int MIN_SHELL_MENU_ID = 1;
@@ -184,6 +193,8 @@ private:
 	void OnRightClick(NMHDR *nmhdr);
 	void OnSetFocus();
 	LRESULT OnDeviceChange(WPARAM wParam, LPARAM lParam);
+	void OnFolderSizeShellNotify(WPARAM wParam, LPARAM lParam);
+	void UpdateFolderSizeChangeNotifications();
 	void OnPreviousWindow();
 	void OnNextWindow();
 	void OnAppCommand(UINT cmd);
@@ -361,7 +372,7 @@ private:
 	void LoadDialogStatesFromRegistry();
 
 	/* XML Settings. */
-	void LoadGenericSettingsFromXML(IXMLDOMDocument *pXMLDom);
+	void LoadGenericSettingsFromXML(const std::vector<XmlStreamReader::Element> &settings);
 	void SaveGenericSettingsToXML(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pRoot);
 	int LoadTabSettingsFromXML(IXMLDOMDocument *pXMLDom);
 	void SaveTabSettingsToXML(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pRoot);
@@ -383,7 +394,7 @@ private:
 	void SaveToolbarInformationToXMLnternal(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pe);
 	void LoadDialogStatesFromXML(IXMLDOMDocument *pXMLDom);
 	void SaveDialogStatesToXML(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pRoot);
-	void MapAttributeToValue(IXMLDOMNode *pNode, WCHAR *wszName, WCHAR *wszValue);
+	void MapAttributeToValue(const XmlStreamReader::Element &setting);
 	void MapTabAttributeValue(WCHAR *wszName, WCHAR *wszValue, TabSettings &tabSettings,
 		FolderSettings &folderSettings);
 
@@ -470,6 +481,10 @@ private:
 	/* Bookmark handling. */
 	void ExpandAndBrowsePath(const TCHAR *szPath);
 	void ExpandAndBrowsePath(const TCHAR *szPath, BOOL bOpenInNewTab, BOOL bSwitchToNewTab);
+	bool LoadBookmarksFromJournal();
+	void StartBookmarkJournal();
+	bool IsBookmarkJournalActive() const;
+	void OnBookmarksSavedInFull();
 
 	/* IExplorerplusplus methods. */
 	const Config *GetConfig() const override;
@@ -483,7 +498,7 @@ private:
 	HWND GetTreeView() const override;
 	IDirectoryMonitor *GetDirectoryMonitor() const override;
 	IconResourceLoader *GetIconResourceLoader() const override;
-	CachedIcons *GetCachedIcons() override;
+	IconService *GetIconService() override;
 	BOOL GetSavePreferencesToXmlFile() const override;
 	void SetSavePreferencesToXmlFile(BOOL savePreferencesToXmlFile) override;
 	void FocusChanged(WindowFocusSource windowFocusSource) override;
@@ -552,6 +567,7 @@ private:
 	bool m_bShowTabBar;
 	int m_iLastSelectedTab;
 	ULONG m_SHChangeNotifyID;
+	ULONG m_folderSizeChangeNotifyId = 0;
 	ValueWrapper<bool> m_InitializationFinished;
 
 	/* Initialization. */
@@ -565,6 +581,7 @@ private:
 	std::unique_ptr<IconResourceLoader> m_iconResourceLoader;
 
 	CachedIcons m_cachedIcons;
+	IconService m_iconService;
 
 	MainMenuPreShowSignal m_mainMenuPreShowSignal;
 	FocusChangedSignal m_focusChangedSignal;
@@ -602,29 +619,19 @@ private:
 
 	/* Bookmarks. */
 	BookmarkTree m_bookmarkTree;
+	std::unique_ptr<BookmarkJournal> m_bookmarkJournal;
 	std::unique_ptr<BookmarksMainMenu> m_bookmarksMainMenu;
 	BookmarksToolbar *m_pBookmarksToolbar;
 
-	// IconFetcher retrieves file icons in a background thread. A queue of requests is maintained
-	// and that queue is cleared when the instance is destroyed. However, any current request that's
-	// running in the background thread will continue to run and the main thread will wait for it to
-	// finish.
-	// This, however, could cause problems if the IconFetcher instance is held by an object that
-	// only exists for a specific period of time. For example, if the instance were being managed by
-	// the manage bookmark dialog, and the dialog was closed, the instance would be destroyed and
-	// the main thread would wait for any operation in the background thread to finish. That could
-	// then cause the application to appear to hang.
-	// Since this class exists for the entire lifetime of the application, it means that the
-	// IconFetcher instance will only be destroyed at application shutdown and that's the only point
-	// at which the main thread will wait. While the application is running, the most that would
-	// happen is that the process of retrieving other icons would be delayed.
-	// Ideally, it would be better to cancel operations that are running in the background thread,
-	// but as far as I'm aware, it's not possible to cancel SHGetFileInfo (which is what's
-	// ultimately used to retrieve the icons).
+	// Shared by the bookmark menu, toolbar and dialogs. Since the icon lookups themselves are
+	// performed by m_iconService, this could be held by shorter-lived objects as well, though
+	// sharing it means the same icons don't have to be requested again each time a bookmark dialog
+	// is shown.
 	IconFetcher m_bookmarkIconFetcher;
 
 	/* Customize colors. */
 	std::vector<NColorRuleHelper::ColorRule> m_ColorRules;
+	std::unique_ptr<ColorRuleMatcher> m_colorRuleMatcher;
 
 	/* Undo support. */
 	FileActionHandler m_FileActionHandler;
@@ -21,6 +21,11 @@ namespace NExplorerplusplus
 	saved to/loaded from. */
 	const TCHAR XML_FILENAME[] = _T("config.xml");
 
+	/* The files that bookmark changes are saved to as
+	they're made. */
+	const TCHAR BOOKMARKS_SNAPSHOT_FILENAME[] = _T("bookmarks.snapshot");
+	const TCHAR BOOKMARKS_JOURNAL_FILENAME[] = _T("bookmarks.journal");
+
 	const TCHAR LOG_FILENAME[] = _T("Explorer++.log");
 
 	// Internal command line arguments.
@@ -36,6 +41,12 @@ static const TCHAR SHELL_DEFAULT_INTERNAL_COMMAND_NAME[] = _T("openinexplorer++"
 
 #define WM_APP_ASSOCCHANGED (WM_APP + 54)
 
+/* Sent when the folder size cache starts or stops being
+used, or folder sizes are shown or hidden, so that the
+change notifications the cache relies on can be
+registered or removed as needed. */
+#define WM_APP_FOLDERSIZECACHEUSAGECHANGED (WM_APP + 55)
+
 /* Rebar menu id's. */
 #define ID_REBAR_MENU_BACK_START 2000
 #define ID_REBAR_MENU_BACK_END 2999
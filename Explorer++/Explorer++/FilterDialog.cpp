@@ -40,6 +40,13 @@ INT_PTR FilterDialog::OnInitDialog()
 
 	std::wstring filter = m_pexpp->GetActiveShellBrowser()->GetFilter();
 
+	// The filter is previewed as it's typed, so the original settings need to be saved, in order
+	// to be able to restore them if the dialog is cancelled.
+	m_originalFilter = filter;
+	m_originalFilterCaseSensitive = m_pexpp->GetActiveShellBrowser()->GetFilterCaseSensitive();
+	m_originalFilterStatus = m_pexpp->GetActiveShellBrowser()->GetFilterStatus();
+	m_filterPreviewed = false;
+
 	ComboBox_SelectString(hComboBox, -1, filter.c_str());
 
 	SendMessage(hComboBox, CB_SETEDITSEL, 0, MAKELPARAM(0, -1));
@@ -90,15 +97,41 @@ INT_PTR FilterDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 {
 	UNREFERENCED_PARAMETER(lParam);
 
-	switch (LOWORD(wParam))
+	if (HIWORD(wParam) != 0)
 	{
-	case IDOK:
-		OnOk();
-		break;
+		switch (HIWORD(wParam))
+		{
+		case CBN_EDITCHANGE:
+			if (LOWORD(wParam) == IDC_FILTER_COMBOBOX)
+			{
+				OnFilterChanged(GetWindowString(GetDlgItem(m_hDlg, IDC_FILTER_COMBOBOX)));
+			}
+			break;
 
-	case IDCANCEL:
-		OnCancel();
-		break;
+		case CBN_SELCHANGE:
+			if (LOWORD(wParam) == IDC_FILTER_COMBOBOX)
+			{
+				OnFilterChanged(GetSelectedFilter());
+			}
+			break;
+		}
+	}
+	else
+	{
+		switch (LOWORD(wParam))
+		{
+		case IDC_FILTERS_CASESENSITIVE:
+			OnFilterChanged(GetWindowString(GetDlgItem(m_hDlg, IDC_FILTER_COMBOBOX)));
+			break;
+
+		case IDOK:
+			OnOk();
+			break;
+
+		case IDCANCEL:
+			OnCancel();
+			break;
+		}
 	}
 
 	return 0;
@@ -106,10 +139,76 @@ INT_PTR FilterDialog::OnCommand(WPARAM wParam, LPARAM lParam)
 
 INT_PTR FilterDialog::OnClose()
 {
+	RestoreOriginalFilter();
 	EndDialog(m_hDlg, 0);
 	return 0;
 }
 
+// Applies the filter to the current tab as it's typed. Each change only cancels and restarts the
+// filter evaluation in the tab, so typing quickly doesn't result in the listview being repeatedly
+// updated.
+void FilterDialog::OnFilterChanged(const std::wstring &filter)
+{
+	auto *shellBrowser = m_pexpp->GetActiveShellBrowser();
+
+	shellBrowser->SetFilterCaseSensitive(
+		IsDlgButtonChecked(m_hDlg, IDC_FILTERS_CASESENSITIVE) == BST_CHECKED);
+	shellBrowser->SetFilter(filter);
+
+	if (!shellBrowser->GetFilterStatus())
+	{
+		shellBrowser->SetFilterStatus(TRUE);
+	}
+
+	m_filterPreviewed = true;
+}
+
+// When the selection changes, the notification is sent before the text in the edit control is
+// updated, so the filter has to be read from the list instead.
+std::wstring FilterDialog::GetSelectedFilter() const
+{
+	HWND comboBox = GetDlgItem(m_hDlg, IDC_FILTER_COMBOBOX);
+	int selectedIndex = ComboBox_GetCurSel(comboBox);
+
+	if (selectedIndex == CB_ERR)
+	{
+		return GetWindowString(comboBox);
+	}
+
+	int length = ComboBox_GetLBTextLen(comboBox, selectedIndex);
+
+	if (length == CB_ERR)
+	{
+		return GetWindowString(comboBox);
+	}
+
+	std::wstring filter(length + 1, '\0');
+	ComboBox_GetLBText(comboBox, selectedIndex, filter.data());
+	filter.resize(length);
+
+	return filter;
+}
+
+void FilterDialog::RestoreOriginalFilter()
+{
+	if (!m_filterPreviewed)
+	{
+		return;
+	}
+
+	auto *shellBrowser = m_pexpp->GetActiveShellBrowser();
+
+	shellBrowser->SetFilterCaseSensitive(m_originalFilterCaseSensitive);
+	shellBrowser->SetFilter(m_originalFilter);
+
+	if (shellBrowser->GetFilterStatus() != m_originalFilterStatus)
+	{
+		shellBrowser->SetFilterStatus(m_originalFilterStatus);
+	}
+
+	m_filterPreviewed = false;
+}
+
 void FilterDialog::OnOk()
 {
 	HWND hComboBox = GetDlgItem(m_hDlg, IDC_FILTER_COMBOBOX);
@@ -153,6 +252,7 @@ void FilterDialog::OnOk()
 
 void FilterDialog::OnCancel()
 {
+	RestoreOriginalFilter();
 	EndDialog(m_hDlg, 0);
 }
 
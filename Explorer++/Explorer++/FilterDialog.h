@@ -9,6 +9,7 @@
 #include "../Helper/ResizableDialog.h"
 #include <MsXml2.h>
 #include <objbase.h>
+#include <string>
 
 class FilterDialog;
 __interface IExplorerplusplus;
@@ -56,10 +57,18 @@ private:
 		std::list<ResizableDialog::Control> &ControlList) override;
 	void SaveState() override;
 
+	void OnFilterChanged(const std::wstring &filter);
+	std::wstring GetSelectedFilter() const;
+	void RestoreOriginalFilter();
 	void OnOk();
 	void OnCancel();
 
 	IExplorerplusplus *m_pexpp;
 
 	FilterDialogPersistentSettings *m_persistentSettings;
+
+	std::wstring m_originalFilter;
+	BOOL m_originalFilterCaseSensitive;
+	BOOL m_originalFilterStatus;
+	bool m_filterPreviewed;
 };
@@ -24,6 +24,7 @@
 #include "UiTheming.h"
 #include "ViewModeHelper.h"
 #include "../Helper/CustomGripper.h"
+#include "../Helper/FolderSizeCache.h"
 #include "../Helper/iDirectoryMonitor.h"
 
 /*
@@ -40,6 +41,9 @@ void Explorerplusplus::OnCreate()
 	ApplyToolbarSettings();
 
 	m_config->shellChangeNotificationType = m_commandLineSettings.shellChangeNotificationType;
+	m_config->tabHibernationTimeout =
+		std::chrono::minutes(m_commandLineSettings.tabHibernationTimeout);
+	m_config->virtualListView = m_commandLineSettings.virtualListView;
 
 	m_iconResourceLoader = std::make_unique<IconResourceLoader>(m_config->iconTheme);
 
@@ -80,6 +84,21 @@ void Explorerplusplus::OnCreate()
 	m_taskbarThumbnails =
 		TaskbarThumbnails::Create(this, m_tabContainer, m_hLanguageModule, m_config);
 
+	// Cached folder sizes need to be discarded when anything within the folder changes, which
+	// requires monitoring changes across the entire namespace. That's only done while folder sizes
+	// are shown, or the cache is otherwise in use. This is set up before any tabs are created, so
+	// that no folder is scanned before then.
+	auto &folderSizeCache = FolderSizeCache::GetInstance();
+	folderSizeCache.SetChangesMonitored(false);
+	folderSizeCache.SetInUseCallback(
+		[hwnd = m_hContainer](bool inUse)
+		{
+			UNREFERENCED_PARAMETER(inUse);
+
+			PostMessage(hwnd, WM_APP_FOLDERSIZECACHEUSAGECHANGED, 0, 0);
+		});
+	UpdateFolderSizeChangeNotifications();
+
 	RestoreTabs(pLoadSave);
 	delete pLoadSave;
 
@@ -9,6 +9,7 @@
 #include "Explorer++.h"
 // clang-format on
 #include "Explorer++_internal.h"
+#include "XMLSettings.h"
 #include "../Helper/ProcessHelper.h"
 #include "../Helper/XMLSettings.h"
 #include <wil/com.h>
@@ -41,26 +42,58 @@ LoadSaveXML::~LoadSaveXML()
 
 void LoadSaveXML::InitializeLoadEnvironment()
 {
-	m_pXMLDom.attach(NXMLSettings::DomFromCOM());
-
-	if (!m_pXMLDom)
+	/* The configuration file is read in a single pass.
+	The generic settings are read directly from the file,
+	while the remaining sections are split off into
+	separate documents, which are only loaded into a DOM
+	when needed. The bookmarks can make up the bulk of the
+	file and won't be needed at all if they've already
+	been loaded from the bookmark journal, so they're
+	kept separate from everything else. */
+	XmlStreamReader reader;
+	reader.ReadSection(L"Settings",
+		[this](const XmlStreamReader::Element &element)
+		{
+			m_genericSettings.push_back(element);
+			return true;
+		});
+	reader.CaptureSections({ L"Bookmarksv2", L"Bookmarks" }, &m_bookmarksDocument.xml);
+	reader.CaptureRemainingSections(&m_mainDocument.xml);
+
+	HRESULT hr = reader.ReadFile(GetXmlConfigFilePath());
+
+	if (FAILED(hr))
 	{
-		return;
+		/* As when the file is loaded directly into a DOM,
+		a file that can't be parsed is ignored entirely. */
+		m_genericSettings.clear();
+		m_bookmarksDocument.xml.clear();
+		m_mainDocument.xml.clear();
 	}
+}
 
-	TCHAR szConfigFile[MAX_PATH];
-	GetProcessImageName(GetCurrentProcessId(), szConfigFile, SIZEOF_ARRAY(szConfigFile));
-	PathRemoveFileSpec(szConfigFile);
-	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
+IXMLDOMDocument *LoadSaveXML::GetDocument(LazyDocument &lazyDocument)
+{
+	if (lazyDocument.loaded)
+	{
+		return lazyDocument.document.get();
+	}
 
-	wil::unique_variant var(NXMLSettings::VariantString(NExplorerplusplus::XML_FILENAME));
-	VARIANT_BOOL status;
-	m_pXMLDom->load(var, &status);
+	lazyDocument.loaded = true;
+	lazyDocument.document.attach(NXMLSettings::DomFromCOM());
 
-	if (status != VARIANT_TRUE)
+	if (lazyDocument.document && !lazyDocument.xml.empty())
 	{
-		return;
+		auto xml = wil::make_bstr_nothrow(lazyDocument.xml.c_str());
+		VARIANT_BOOL status;
+		lazyDocument.document->loadXML(xml.get(), &status);
 	}
+
+	/* The text is no longer needed once it's been parsed. */
+	lazyDocument.xml.clear();
+	lazyDocument.xml.shrink_to_fit();
+
+	return lazyDocument.document.get();
 }
 
 void LoadSaveXML::InitializeSaveEnvironment()
@@ -104,60 +137,54 @@ void LoadSaveXML::ReleaseSaveEnvironment()
 	wil::unique_bstr bstr;
 	m_pXMLDom->get_xml(&bstr);
 
-	/* To ensure the configuration file is saved to the same directory
-	as the executable, determine the fully qualified path of the executable,
-	then save the configuration file in that directory. */
-	TCHAR szConfigFile[MAX_PATH];
-	DWORD dwProcessId = GetCurrentProcessId();
-	wil::unique_process_handle process(
-		OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, dwProcessId));
-	GetModuleFileNameEx(process.get(), nullptr, szConfigFile, SIZEOF_ARRAY(szConfigFile));
-
-	PathRemoveFileSpec(szConfigFile);
-	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
+	wil::unique_variant var(NXMLSettings::VariantString(GetXmlConfigFilePath().c_str()));
+	HRESULT hr = m_pXMLDom->save(var);
 
-	wil::unique_variant var(NXMLSettings::VariantString(szConfigFile));
-	m_pXMLDom->save(var);
+	if (SUCCEEDED(hr) && m_bookmarksSaved)
+	{
+		m_pContainer->OnBookmarksSavedInFull();
+	}
 }
 
 void LoadSaveXML::LoadGenericSettings()
 {
-	m_pContainer->LoadGenericSettingsFromXML(m_pXMLDom.get());
+	m_pContainer->LoadGenericSettingsFromXML(m_genericSettings);
 }
 
 void LoadSaveXML::LoadBookmarks()
 {
-	m_pContainer->LoadBookmarksFromXML(m_pXMLDom.get());
+	m_pContainer->LoadBookmarksFromXML(GetDocument(m_bookmarksDocument));
 }
 
 int LoadSaveXML::LoadPreviousTabs()
 {
-	return m_pContainer->LoadTabSettingsFromXML(m_pXMLDom.get());
+	return m_pContainer->LoadTabSettingsFromXML(GetDocument(m_mainDocument));
 }
 
 void LoadSaveXML::LoadDefaultColumns()
 {
-	m_pContainer->LoadDefaultColumnsFromXML(m_pXMLDom.get());
+	m_pContainer->LoadDefaultColumnsFromXML(GetDocument(m_mainDocument));
 }
 
 void LoadSaveXML::LoadApplicationToolbar()
 {
-	m_pContainer->LoadApplicationToolbarFromXML(m_pXMLDom.get());
+	m_pContainer->LoadApplicationToolbarFromXML(GetDocument(m_mainDocument));
 }
 
 void LoadSaveXML::LoadToolbarInformation()
 {
-	m_pContainer->LoadToolbarInformationFromXML(m_pXMLDom.get());
+	m_pContainer->LoadToolbarInformationFromXML(GetDocument(m_mainDocument));
 }
 
 void LoadSaveXML::LoadColorRules()
 {
-	NColorRuleHelper::LoadColorRulesFromXML(m_pXMLDom.get(), m_pContainer->m_ColorRules);
+	NColorRuleHelper::LoadColorRulesFromXML(GetDocument(m_mainDocument),
+		m_pContainer->m_ColorRules);
 }
 
 void LoadSaveXML::LoadDialogStates()
 {
-	m_pContainer->LoadDialogStatesFromXML(m_pXMLDom.get());
+	m_pContainer->LoadDialogStatesFromXML(GetDocument(m_mainDocument));
 }
 
 void LoadSaveXML::SaveGenericSettings()
@@ -168,6 +195,7 @@ void LoadSaveXML::SaveGenericSettings()
 void LoadSaveXML::SaveBookmarks()
 {
 	m_pContainer->SaveBookmarksToXML(m_pXMLDom.get(), m_pRoot.get());
+	m_bookmarksSaved = true;
 }
 
 void LoadSaveXML::SaveTabs()
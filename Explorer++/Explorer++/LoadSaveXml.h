@@ -5,9 +5,12 @@
 #pragma once
 
 #include "LoadSaveInterface.h"
+#include "../Helper/XmlStreamReader.h"
 #include <wil/com.h>
 #include <MsXml2.h>
 #include <objbase.h>
+#include <string>
+#include <vector>
 
 class Explorerplusplus;
 
@@ -38,17 +41,32 @@ public:
 	void SaveDialogStates() override;
 
 private:
+	/* A set of sections from the configuration file
+	that's only loaded into a DOM the first time one of
+	the sections is needed. */
+	struct LazyDocument
+	{
+		std::wstring xml;
+		wil::com_ptr_nothrow<IXMLDOMDocument> document;
+		bool loaded = false;
+	};
+
 	void InitializeLoadEnvironment();
 	void ReleaseLoadEnvironment();
 	void InitializeSaveEnvironment();
 	void ReleaseSaveEnvironment();
+	IXMLDOMDocument *GetDocument(LazyDocument &lazyDocument);
 
 	Explorerplusplus *m_pContainer;
 	BOOL m_bLoad;
 
-	/* Used for saving + loading. */
-	wil::com_ptr_nothrow<IXMLDOMDocument> m_pXMLDom;
+	/* Used exclusively for loading. */
+	std::vector<XmlStreamReader::Element> m_genericSettings;
+	LazyDocument m_bookmarksDocument;
+	LazyDocument m_mainDocument;
 
 	/* Used exclusively for saving. */
+	wil::com_ptr_nothrow<IXMLDOMDocument> m_pXMLDom;
 	wil::com_ptr_nothrow<IXMLDOMElement> m_pRoot;
+	bool m_bookmarksSaved = false;
 };
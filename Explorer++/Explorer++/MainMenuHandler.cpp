@@ -5,6 +5,7 @@
 #include "stdafx.h"
 #include "Explorer++.h"
 #include "AboutDialog.h"
+#include "ColorRuleMatcher.h"
 #include "Config.h"
 #include "CustomizeColorsDialog.h"
 #include "DestroyFilesDialog.h"
@@ -121,6 +122,9 @@ void Explorerplusplus::OnCustomizeColors()
 		&m_ColorRules);
 	customizeColorsDialog.ShowModalDialog();
 
+	// The color rules may have changed, so the matcher will need to be rebuilt.
+	m_colorRuleMatcher.reset();
+
 	/* Causes the active listview to redraw (therefore
 	applying any updated color schemes). */
 	InvalidateRect(m_hActiveListView, nullptr, FALSE);
@@ -275,26 +279,30 @@ void Explorerplusplus::OnResolveLink()
 			m_tabContainer->CreateNewTab(szPath, TabSettings(_selected = true), nullptr, nullptr,
 				&newTabId);
 
-			Tab &tab = m_tabContainer->GetTab(newTabId);
+			// The new tab won't have finished loading the directory at this point, so the target
+			// is selected once the navigation completes.
+			unique_pidl_absolute pidlDirectory;
+			hr = SHParseDisplayName(szPath, nullptr, wil::out_param(pidlDirectory), 0, nullptr);
+
+			wil::com_ptr_nothrow<IShellFolder> parent;
 
-			if (tab.GetShellBrowser()->GetDirectory() == szPath)
+			if (SUCCEEDED(hr))
 			{
-				wil::com_ptr_nothrow<IShellFolder> parent;
-				hr = SHBindToObject(nullptr, tab.GetShellBrowser()->GetDirectoryIdl().get(),
-					nullptr, IID_PPV_ARGS(&parent));
+				hr = SHBindToObject(nullptr, pidlDirectory.get(), nullptr, IID_PPV_ARGS(&parent));
+			}
 
-				if (hr == S_OK)
-				{
-					auto *filename = PathFindFileName(szFullFileName);
-					assert(filename != szFullFileName);
+			if (hr == S_OK)
+			{
+				auto *filename = PathFindFileName(szFullFileName);
+				assert(filename != szFullFileName);
 
-					unique_pidl_absolute pidl;
-					hr = CreateSimplePidl(filename, wil::out_param(pidl), parent.get());
+				unique_pidl_absolute pidl;
+				hr = CreateSimplePidl(filename, wil::out_param(pidl), parent.get());
 
-					if (SUCCEEDED(hr))
-					{
-						m_pActiveShellBrowser->SelectItems({ pidl.get() });
-					}
+				if (SUCCEEDED(hr))
+				{
+					const Tab &tab = m_tabContainer->GetTab(newTabId);
+					tab.GetShellBrowser()->SelectItemsOnNavigationCompleted({ pidl.get() });
 				}
 			}
 
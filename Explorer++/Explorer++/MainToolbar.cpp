@@ -1013,25 +1013,13 @@ MainToolbarPersistentSettings &MainToolbarPersistentSettings::GetInstance()
 	return persistentSettings;
 }
 
-void MainToolbarPersistentSettings::LoadXMLSettings(IXMLDOMNode *pNode)
+void MainToolbarPersistentSettings::LoadXMLSettings(const XmlStreamReader::Element &element)
 {
 	std::vector<ToolbarButton> toolbarButtons;
 
-	wil::com_ptr_nothrow<IXMLDOMNamedNodeMap> am;
-	pNode->get_attributes(&am);
-
-	long lChildNodes;
-	am->get_length(&lChildNodes);
-
-	for (long j = 1; j < lChildNodes; j++)
+	for (size_t j = 1; j < element.attributes.size(); j++)
 	{
-		wil::com_ptr_nothrow<IXMLDOMNode> pChildNode;
-		am->get_item(j, &pChildNode);
-
-		wil::unique_bstr bstrValue;
-		pChildNode->get_text(&bstrValue);
-
-		auto itr = TOOLBAR_BUTTON_XML_NAME_MAPPINGS.right.find(bstrValue.get());
+		auto itr = TOOLBAR_BUTTON_XML_NAME_MAPPINGS.right.find(element.attributes[j].second);
 
 		if (itr == TOOLBAR_BUTTON_XML_NAME_MAPPINGS.right.end())
 		{
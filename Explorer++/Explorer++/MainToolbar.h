@@ -10,6 +10,7 @@
 #include "Tab.h"
 #include "../Helper/BaseWindow.h"
 #include "../Helper/WindowSubclassWrapper.h"
+#include "../Helper/XmlStreamReader.h"
 #include <wil/com.h>
 #include <wil/resource.h>
 #include <optional>
@@ -23,7 +24,7 @@ class MainToolbarPersistentSettings
 public:
 	static MainToolbarPersistentSettings &GetInstance();
 
-	void LoadXMLSettings(IXMLDOMNode *pNode);
+	void LoadXMLSettings(const XmlStreamReader::Element &element);
 	void SaveXMLSettings(IXMLDOMDocument *pXMLDom, IXMLDOMElement *pe);
 
 private:
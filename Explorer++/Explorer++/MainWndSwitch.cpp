@@ -165,6 +165,14 @@ LRESULT CALLBACK Explorerplusplus::WindowProcedure(HWND hwnd, UINT Msg, WPARAM w
 	}
 	break;
 
+	case WM_APP_FOLDERSIZECHANGED:
+		OnFolderSizeShellNotify(wParam, lParam);
+		break;
+
+	case WM_APP_FOLDERSIZECACHEUSAGECHANGED:
+		UpdateFolderSizeChangeNotifications();
+		break;
+
 	case WM_APP_FOLDERSIZECOMPLETED:
 	{
 		DWFolderSizeCompletion *pDWFolderSizeCompletion = nullptr;
@@ -9,23 +9,29 @@
 #include "IconResourceLoader.h"
 #include "MainResource.h"
 #include "ResourceHelper.h"
+#include "../Helper/Crc32.h"
 #include "../Helper/FileOperations.h"
 #include "../Helper/Helper.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
+#include "../Helper/SequentialFileReader.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/StringHelper.h"
 #include "../Helper/WindowHelper.h"
 #include <wil/resource.h>
 #include <regex>
+#include <vector>
 
 namespace NMergeFilesDialog
 {
-	const int WM_APP_SETTOTALMERGECOUNT = WM_APP + 1;
-	const int WM_APP_SETCURRENTMERGECOUNT = WM_APP + 2;
+	const int WM_APP_SETMERGEPROGRESS = WM_APP + 1;
 	const int WM_APP_MERGINGFINISHED = WM_APP + 3;
 	const int WM_APP_OUTPUTFILEINVALID = WM_APP + 4;
 
+	// Progress is tracked in bytes, but reported in units of this size, so that the progress bar
+	// range doesn't overflow for large files and the dialog isn't sent a message for every chunk.
+	const int PROGRESS_RANGE = 1000;
+
 	DWORD WINAPI MergeFilesThread(LPVOID pParam);
 }
 
@@ -242,6 +248,11 @@ void MergeFilesDialog::GetResizableControlInformation(BaseDialog::DialogSizeCons
 	control.Constraint = ResizableDialog::ControlConstraint::None;
 	ControlList.push_back(control);
 
+	control.iID = IDC_MERGE_CHECK_CHECKSUM;
+	control.Type = ResizableDialog::ControlType::Move;
+	control.Constraint = ResizableDialog::ControlConstraint::Y;
+	ControlList.push_back(control);
+
 	control.iID = IDC_MERGE_PROGRESS;
 	control.Type = ResizableDialog::ControlType::Move;
 	control.Constraint = ResizableDialog::ControlConstraint::Y;
@@ -311,20 +322,14 @@ INT_PTR MergeFilesDialog::OnClose()
 
 INT_PTR MergeFilesDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
-	UNREFERENCED_PARAMETER(lParam);
-
 	switch (uMsg)
 	{
-	case NMergeFilesDialog::WM_APP_SETTOTALMERGECOUNT:
-		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETRANGE32, 0, wParam);
-		break;
-
-	case NMergeFilesDialog::WM_APP_SETCURRENTMERGECOUNT:
+	case NMergeFilesDialog::WM_APP_SETMERGEPROGRESS:
 		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, wParam, 0);
 		break;
 
 	case NMergeFilesDialog::WM_APP_MERGINGFINISHED:
-		OnFinished();
+		OnFinished(*reinterpret_cast<const MergeFiles::Result *>(lParam));
 		break;
 
 	case NMergeFilesDialog::WM_APP_OUTPUTFILEINVALID:
@@ -342,6 +347,7 @@ INT_PTR MergeFilesDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lPar
 		m_bStopMerging = false;
 
 		SetDlgItemText(m_hDlg, IDOK, m_szOk);
+		EnableWindow(GetDlgItem(m_hDlg, IDC_MERGE_CHECK_CHECKSUM), TRUE);
 	}
 	break;
 	}
@@ -372,9 +378,16 @@ void MergeFilesDialog::OnOk()
 
 		std::wstring outputFileName = GetWindowString(hOutputFileName);
 
-		m_pMergeFiles = new MergeFiles(m_hDlg, outputFileName, m_FullFilenameList);
+		bool calculateChecksum =
+			(IsDlgButtonChecked(m_hDlg, IDC_MERGE_CHECK_CHECKSUM) == BST_CHECKED);
+
+		m_pMergeFiles =
+			new MergeFiles(m_hDlg, outputFileName, m_FullFilenameList, calculateChecksum);
 
+		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETRANGE32, 0,
+			NMergeFilesDialog::PROGRESS_RANGE);
 		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, 0, 0);
+		EnableWindow(GetDlgItem(m_hDlg, IDC_MERGE_CHECK_CHECKSUM), FALSE);
 
 		GetDlgItemText(m_hDlg, IDOK, m_szOk, SIZEOF_ARRAY(m_szOk));
 
@@ -384,6 +397,11 @@ void MergeFilesDialog::OnOk()
 
 		m_bMergingFiles = true;
 
+		/* The background thread holds its own reference, so
+		that the object remains valid even if the dialog is
+		closed before merging has finished. */
+		m_pMergeFiles->AddRef();
+
 		HANDLE hThread = CreateThread(nullptr, 0, NMergeFilesDialog::MergeFilesThread,
 			reinterpret_cast<LPVOID>(m_pMergeFiles), 0, nullptr);
 		SetThreadPriority(hThread, THREAD_PRIORITY_LOWEST);
@@ -405,6 +423,11 @@ void MergeFilesDialog::OnCancel()
 	if (m_bMergingFiles)
 	{
 		m_bStopMerging = true;
+
+		if (m_pMergeFiles != nullptr)
+		{
+			m_pMergeFiles->StopMerging();
+		}
 	}
 	else
 	{
@@ -476,7 +499,7 @@ void MergeFilesDialog::OnMove(bool bUp)
 	}
 }
 
-void MergeFilesDialog::OnFinished()
+void MergeFilesDialog::OnFinished(const MergeFiles::Result &result)
 {
 	assert(m_pMergeFiles != nullptr);
 
@@ -486,12 +509,47 @@ void MergeFilesDialog::OnFinished()
 	m_bMergingFiles = false;
 	m_bStopMerging = false;
 
+	SetDlgItemText(m_hDlg, IDOK, m_szOk);
+	EnableWindow(GetDlgItem(m_hDlg, IDC_MERGE_CHECK_CHECKSUM), TRUE);
+
+	if (result.hr == E_ABORT)
+	{
+		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, 0, 0);
+		return;
+	}
+
+	if (FAILED(result.hr))
+	{
+		SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, 0, 0);
+
+		std::wstring message;
+
+		if (!result.failedInputFile.empty())
+		{
+			message = ResourceHelper::LoadString(GetInstance(), IDS_MERGE_FILES_INPUTFILEINVALID)
+				+ L"\n\n" + result.failedInputFile;
+		}
+		else
+		{
+			message = ResourceHelper::LoadString(GetInstance(), IDS_MERGE_FILES_FAILED);
+		}
+
+		MessageBox(m_hDlg, message.c_str(), NExplorerplusplus::APP_NAME, MB_ICONWARNING | MB_OK);
+		return;
+	}
+
 	/* Set the progress bar position to the end. */
-	int iHighLimit =
-		static_cast<int>(SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_GETRANGE, FALSE, 0));
-	SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, iHighLimit, 0);
+	SendDlgItemMessage(m_hDlg, IDC_MERGE_PROGRESS, PBM_SETPOS, NMergeFilesDialog::PROGRESS_RANGE,
+		0);
 
-	SetDlgItemText(m_hDlg, IDOK, m_szOk);
+	if (result.checksum)
+	{
+		TCHAR checksumText[64];
+		StringCchPrintf(checksumText, SIZEOF_ARRAY(checksumText),
+			ResourceHelper::LoadString(GetInstance(), IDS_MERGE_FILES_CHECKSUM).c_str(),
+			*result.checksum);
+		MessageBox(m_hDlg, checksumText, NExplorerplusplus::APP_NAME, MB_ICONINFORMATION | MB_OK);
+	}
 }
 
 DWORD WINAPI NMergeFilesDialog::MergeFilesThread(LPVOID pParam)
@@ -500,16 +558,18 @@ DWORD WINAPI NMergeFilesDialog::MergeFilesThread(LPVOID pParam)
 
 	auto *pMergeFiles = reinterpret_cast<MergeFiles *>(pParam);
 	pMergeFiles->StartMerging();
+	pMergeFiles->Release();
 
 	return 0;
 }
 
 MergeFiles::MergeFiles(HWND hDlg, const std::wstring &strOutputFilename,
-	const std::list<std::wstring> &FullFilenameList)
+	const std::list<std::wstring> &FullFilenameList, bool calculateChecksum)
 {
 	m_hDlg = hDlg;
 	m_strOutputFilename = strOutputFilename;
 	m_FullFilenameList = FullFilenameList;
+	m_calculateChecksum = calculateChecksum;
 
 	m_bstopMerging = false;
 
@@ -523,67 +583,122 @@ MergeFiles::~MergeFiles()
 
 void MergeFiles::StartMerging()
 {
-	LARGE_INTEGER lMergeFileSize;
-	int nFilesMerged = 1;
-	bool bStop = false;
-
-	HANDLE hOutputFile = CreateFile(m_strOutputFilename.c_str(), GENERIC_WRITE, 0, nullptr,
-		CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+	wil::unique_hfile outputFile(CreateFile(m_strOutputFilename.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_NEW, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
 
-	if (hOutputFile == INVALID_HANDLE_VALUE)
+	if (!outputFile)
 	{
 		PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_OUTPUTFILEINVALID, 0, 0);
 		return;
 	}
 
-	PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETTOTALMERGECOUNT,
-		static_cast<WPARAM>(m_FullFilenameList.size()), 0);
+	Result result = {};
+	result.hr = MergeInputFiles(outputFile.get(), result);
 
-	for (const auto &strFullFilename : m_FullFilenameList)
+	outputFile.reset();
+
+	/* A partially merged file isn't of any use, so remove
+	it if the merge didn't complete. */
+	if (FAILED(result.hr))
+	{
+		DeleteFile(m_strOutputFilename.c_str());
+	}
+
+	SendMessage(m_hDlg, NMergeFilesDialog::WM_APP_MERGINGFINISHED, 0,
+		reinterpret_cast<LPARAM>(&result));
+}
+
+HRESULT MergeFiles::MergeInputFiles(HANDLE hOutputFile, Result &result)
+{
+	std::vector<std::wstring> inputFiles(m_FullFilenameList.begin(), m_FullFilenameList.end());
+	SequentialFileReader reader(inputFiles, MERGE_CHUNK_SIZE);
+
+	size_t failedFileIndex;
+	HRESULT hr = reader.Open(&failedFileIndex);
+
+	if (FAILED(hr))
+	{
+		result.failedInputFile = inputFiles[failedFileIndex];
+		return hr;
+	}
+
+	ULONGLONG totalSize = reader.GetTotalSize();
+
+	/* Allocating the space for the output file up front
+	allows it to be laid out contiguously on disk. This is
+	only a hint, so it doesn't matter if it fails. */
+	FILE_ALLOCATION_INFO allocationInfo;
+	allocationInfo.AllocationSize.QuadPart = totalSize;
+	SetFileInformationByHandle(hOutputFile, FileAllocationInfo, &allocationInfo,
+		sizeof(allocationInfo));
+
+	Crc32 crc;
+	ULONGLONG totalBytesWritten = 0;
+	int lastProgressPosition = 0;
+
+	while (true)
 	{
-		if (bStop)
+		if (IsStopRequested())
 		{
-			break;
+			return E_ABORT;
 		}
 
-		HANDLE hInputFile = CreateFile(strFullFilename.c_str(), GENERIC_READ, FILE_SHARE_READ,
-			nullptr, OPEN_EXISTING, 0, nullptr);
+		/* While this chunk is being checksummed and written,
+		the reader will be reading the next chunk. */
+		const BYTE *data;
+		DWORD size;
+		RETURN_IF_FAILED(reader.ReadNextChunk(&data, &size));
 
-		if (hInputFile != INVALID_HANDLE_VALUE)
+		if (size == 0)
 		{
-			GetFileSizeEx(hInputFile, &lMergeFileSize);
+			break;
+		}
 
-			if (lMergeFileSize.QuadPart != 0)
-			{
-				auto buffer = std::make_unique<char[]>(lMergeFileSize.LowPart);
+		if (m_calculateChecksum)
+		{
+			crc.Update(data, size);
+		}
 
-				DWORD dwNumberOfBytesRead;
-				ReadFile(hInputFile, reinterpret_cast<LPVOID>(buffer.get()),
-					static_cast<DWORD>(lMergeFileSize.LowPart), &dwNumberOfBytesRead, nullptr);
+		DWORD numBytesWritten;
+		BOOL res = WriteFile(hOutputFile, data, size, &numBytesWritten, nullptr);
 
-				DWORD dwNumberOfBytesWritten;
-				WriteFile(hOutputFile, reinterpret_cast<LPCVOID>(buffer.get()), dwNumberOfBytesRead,
-					&dwNumberOfBytesWritten, nullptr);
-			}
+		if (!res)
+		{
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
 
-			CloseHandle(hInputFile);
+		if (numBytesWritten != size)
+		{
+			return E_FAIL;
+		}
 
-			PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETCURRENTMERGECOUNT, nFilesMerged, 0);
+		totalBytesWritten += size;
 
-			nFilesMerged++;
+		int progressPosition = static_cast<int>(
+			(totalBytesWritten * NMergeFilesDialog::PROGRESS_RANGE) / totalSize);
 
-			EnterCriticalSection(&m_csStop);
-			if (m_bstopMerging)
-			{
-				bStop = true;
-			}
-			LeaveCriticalSection(&m_csStop);
+		if (progressPosition != lastProgressPosition)
+		{
+			PostMessage(m_hDlg, NMergeFilesDialog::WM_APP_SETMERGEPROGRESS, progressPosition, 0);
+			lastProgressPosition = progressPosition;
 		}
 	}
 
-	CloseHandle(hOutputFile);
+	if (m_calculateChecksum)
+	{
+		result.checksum = crc.GetValue();
+	}
+
+	return S_OK;
+}
+
+bool MergeFiles::IsStopRequested()
+{
+	EnterCriticalSection(&m_csStop);
+	bool stopRequested = m_bstopMerging;
+	LeaveCriticalSection(&m_csStop);
 
-	SendMessage(m_hDlg, NMergeFilesDialog::WM_APP_MERGINGFINISHED, 0, 0);
+	return stopRequested;
 }
 
 void MergeFiles::StopMerging()
@@ -8,6 +8,7 @@
 #include "../Helper/DialogSettings.h"
 #include "../Helper/ReferenceCount.h"
 #include "../Helper/ResizableDialog.h"
+#include <optional>
 
 __interface IExplorerplusplus;
 class MergeFilesDialog;
@@ -31,18 +32,38 @@ private:
 class MergeFiles : public ReferenceCount
 {
 public:
+	struct Result
+	{
+		// E_ABORT if the merge was cancelled.
+		HRESULT hr;
+
+		// Set if one of the input files couldn't be opened.
+		std::wstring failedInputFile;
+
+		// Only set if the merge succeeded and a checksum was requested.
+		std::optional<uint32_t> checksum;
+	};
+
 	MergeFiles(HWND hDlg, const std::wstring &strOutputFilename,
-		const std::list<std::wstring> &FullFilenameList);
+		const std::list<std::wstring> &FullFilenameList, bool calculateChecksum);
 	~MergeFiles();
 
 	void StartMerging();
 	void StopMerging();
 
 private:
+	// The input files are read in chunks of this size, so the amount of memory used doesn't depend
+	// on the size of the files being merged.
+	static constexpr DWORD MERGE_CHUNK_SIZE = 4 * 1024 * 1024;
+
+	HRESULT MergeInputFiles(HANDLE hOutputFile, Result &result);
+	bool IsStopRequested();
+
 	HWND m_hDlg;
 
 	std::wstring m_strOutputFilename;
 	std::list<std::wstring> m_FullFilenameList;
+	bool m_calculateChecksum;
 
 	CRITICAL_SECTION m_csStop;
 	bool m_bstopMerging;
@@ -74,7 +95,7 @@ private:
 	void OnCancel();
 	void OnChangeOutputDirectory();
 	void OnMove(bool bUp);
-	void OnFinished();
+	void OnFinished(const MergeFiles::Result &result);
 
 	IExplorerplusplus *m_expp;
 
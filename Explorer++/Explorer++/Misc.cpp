@@ -15,9 +15,12 @@
 #include "TabContainer.h"
 #include "../Helper/Controls.h"
 #include "../Helper/FileOperations.h"
+#include "../Helper/FolderSizeCache.h"
 #include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
+#include "../Helper/ShellHelper.h"
 #include "../Helper/WindowHelper.h"
+#include "../Helper/iDirectoryMonitor.h"
 #include <boost/range/adaptor/map.hpp>
 
 void Explorerplusplus::ValidateLoadedSettings()
@@ -277,6 +280,77 @@ void Explorerplusplus::CopyToFolder(bool move)
 	NFileOperations::CopyFilesToFolder(m_hContainer, szTemp, pidls, move);
 }
 
+void Explorerplusplus::OnFolderSizeShellNotify(WPARAM wParam, LPARAM lParam)
+{
+	PIDLIST_ABSOLUTE *pidls;
+	LONG event;
+	HANDLE lock = SHChangeNotification_Lock(reinterpret_cast<HANDLE>(wParam),
+		static_cast<DWORD>(lParam), &pidls, &event);
+
+	// When a folder is removed or renamed, any cached sizes for folders within it will no longer
+	// be valid. The same is true when the shell indicates that an entire directory has changed.
+	bool includeDescendants =
+		(event == SHCNE_RMDIR || event == SHCNE_RENAMEFOLDER || event == SHCNE_UPDATEDIR);
+
+	for (int i = 0; i < 2; i++)
+	{
+		if (!pidls[i])
+		{
+			continue;
+		}
+
+		std::wstring path;
+		HRESULT hr = GetDisplayName(pidls[i], SHGDN_FORPARSING, path);
+
+		if (SUCCEEDED(hr))
+		{
+			FolderSizeCache::GetInstance().InvalidatePath(path, includeDescendants);
+		}
+	}
+
+	SHChangeNotification_Unlock(lock);
+}
+
+// Changes are monitored across the entire namespace, rather than just within the current
+// directory, so this is only done while the folder size cache actually needs it.
+void Explorerplusplus::UpdateFolderSizeChangeNotifications()
+{
+	auto &folderSizeCache = FolderSizeCache::GetInstance();
+	bool required = m_config->globalFolderSettings.showFolderSizes || folderSizeCache.IsInUse();
+
+	if (required && m_folderSizeChangeNotifyId == 0)
+	{
+		SHChangeNotifyEntry shcne;
+		shcne.fRecursive = TRUE;
+		shcne.pidl = nullptr;
+		m_folderSizeChangeNotifyId = SHChangeNotifyRegister(m_hContainer,
+			SHCNRF_ShellLevel | SHCNRF_InterruptLevel | SHCNRF_NewDelivery,
+			SHCNE_CREATE | SHCNE_DELETE | SHCNE_MKDIR | SHCNE_RMDIR | SHCNE_RENAMEITEM
+				| SHCNE_RENAMEFOLDER | SHCNE_UPDATEITEM | SHCNE_UPDATEDIR,
+			WM_APP_FOLDERSIZECHANGED, 1, &shcne);
+
+		if (m_folderSizeChangeNotifyId != 0)
+		{
+			folderSizeCache.SetChangesMonitored(true);
+		}
+	}
+	else if (!required && m_folderSizeChangeNotifyId != 0)
+	{
+		// A scan may have started since the check above. Any scan that starts after this point
+		// won't be cached, so it's safe to stop monitoring changes if there still isn't one.
+		folderSizeCache.SetChangesMonitored(false);
+
+		if (folderSizeCache.IsInUse())
+		{
+			folderSizeCache.SetChangesMonitored(true);
+			return;
+		}
+
+		SHChangeNotifyDeregister(m_folderSizeChangeNotifyId);
+		m_folderSizeChangeNotifyId = 0;
+	}
+}
+
 LRESULT Explorerplusplus::OnDeviceChange(WPARAM wParam, LPARAM lParam)
 {
 	/* Forward this notification out to all tabs (if a
@@ -322,7 +396,7 @@ Possible bugs:
    If this runs after the tab is freed, the tab existence
    check will fail, and the shell browser function won't be called.
 */
-void Explorerplusplus::DirectoryAlteredCallback(const TCHAR *szFileName, DWORD dwAction,
+void Explorerplusplus::DirectoryAlteredCallback(const std::vector<DirectoryChange> &changes,
 	void *pData)
 {
 	DirectoryAltered *pDirectoryAltered = nullptr;
@@ -336,11 +410,10 @@ void Explorerplusplus::DirectoryAlteredCallback(const TCHAR *szFileName, DWORD d
 	if (tab)
 	{
 		std::wstring directory = tab->GetShellBrowser()->GetDirectory();
-		LOG(debug) << _T("Directory change notification received for \"") << directory
-				   << _T("\", Action = ") << dwAction << _T(", Filename = \"") << szFileName
-				   << _T("\"");
+		LOG(debug) << _T("Directory change notifications received for \"") << directory
+				   << _T("\", Count = ") << changes.size();
 
-		tab->GetShellBrowser()->FilesModified(dwAction, szFileName, pDirectoryAltered->iIndex,
+		tab->GetShellBrowser()->FilesModified(changes, pDirectoryAltered->iIndex,
 			pDirectoryAltered->iFolderIndex);
 	}
 }
@@ -6,6 +6,7 @@
 #include "Explorer++.h"
 #include "AddressBar.h"
 #include "ColorRuleHelper.h"
+#include "ColorRuleMatcher.h"
 #include "Config.h"
 #include "DarkModeHelper.h"
 #include "Explorer++_internal.h"
@@ -21,10 +22,12 @@
 #include "ShellBrowser/ViewModes.h"
 #include "ShellTreeView/ShellTreeView.h"
 #include "TabContainer.h"
+#include "XMLSettings.h"
 #include "../Helper/BulkClipboardWriter.h"
 #include "../Helper/Controls.h"
 #include "../Helper/DpiCompatibility.h"
 #include "../Helper/FileOperations.h"
+#include "../Helper/FolderSizeCache.h"
 #include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
 #include "../Helper/MenuHelper.h"
@@ -56,19 +59,10 @@ void Explorerplusplus::TestConfigFile()
 BOOL TestConfigFileInternal()
 {
 	HANDLE hConfigFile;
-	TCHAR szConfigFile[MAX_PATH];
 	BOOL bLoadSettingsFromXML = FALSE;
 
-	/* To ensure the configuration file is loaded from the same directory
-	as the executable, determine the fully qualified path of the executable,
-	then save the configuration file in that directory. */
-	GetProcessImageName(GetCurrentProcessId(), szConfigFile, SIZEOF_ARRAY(szConfigFile));
-
-	PathRemoveFileSpec(szConfigFile);
-	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
-
-	hConfigFile =
-		CreateFile(szConfigFile, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, 0, nullptr);
+	hConfigFile = CreateFile(GetXmlConfigFilePath().c_str(), GENERIC_READ, FILE_SHARE_READ,
+		nullptr, OPEN_EXISTING, 0, nullptr);
 
 	if (hConfigFile != INVALID_HANDLE_VALUE)
 	{
@@ -105,7 +99,16 @@ void Explorerplusplus::LoadAllSettings(ILoadSave **pLoadSave)
 		*pLoadSave = new LoadSaveRegistry(this);
 	}
 
-	(*pLoadSave)->LoadBookmarks();
+	/* Bookmarks are only loaded from the registry/config
+	file if the journal doesn't contain changes that were
+	made after they were last saved there. */
+	if (!LoadBookmarksFromJournal())
+	{
+		(*pLoadSave)->LoadBookmarks();
+	}
+
+	StartBookmarkJournal();
+
 	(*pLoadSave)->LoadGenericSettings();
 	(*pLoadSave)->LoadDefaultColumns();
 	(*pLoadSave)->LoadApplicationToolbar();
@@ -571,6 +574,13 @@ int Explorerplusplus::OnDestroy()
 		SHChangeNotifyDeregister(m_SHChangeNotifyID);
 	}
 
+	FolderSizeCache::GetInstance().SetInUseCallback(nullptr);
+
+	if (m_folderSizeChangeNotifyId != 0)
+	{
+		SHChangeNotifyDeregister(m_folderSizeChangeNotifyId);
+	}
+
 	delete m_pStatusBar;
 
 	PostQuitMessage(0);
@@ -1210,56 +1220,19 @@ LRESULT Explorerplusplus::OnCustomDraw(LPARAM lParam)
 
 		case CDDS_ITEMPREPAINT:
 		{
-			DWORD dwAttributes =
-				m_pActiveShellBrowser->GetItemFileFindData(static_cast<int>(pnmcd->dwItemSpec))
-					.dwFileAttributes;
-
-			std::wstring fullFileName =
-				m_pActiveShellBrowser->GetItemFullName(static_cast<int>(pnmcd->dwItemSpec));
-
-			TCHAR fileName[MAX_PATH];
-			StringCchCopy(fileName, SIZEOF_ARRAY(fileName), fullFileName.c_str());
-			PathStripPath(fileName);
-
-			/* Loop through each filter. Decide whether to change the font of the
-			current item based on its filename and/or attributes. */
-			for (const auto &colorRule : m_ColorRules)
+			// The matcher is rebuilt whenever the color rules change.
+			if (!m_colorRuleMatcher)
 			{
-				BOOL bMatchFileName = FALSE;
-				BOOL bMatchAttributes = FALSE;
-
-				/* Only match against the filename if it's not empty. */
-				if (!colorRule.strFilterPattern.empty())
-				{
-					if (CheckWildcardMatch(colorRule.strFilterPattern.c_str(), fileName,
-							!colorRule.caseInsensitive)
-						== 1)
-					{
-						bMatchFileName = TRUE;
-					}
-				}
-				else
-				{
-					bMatchFileName = TRUE;
-				}
+				m_colorRuleMatcher = std::make_unique<ColorRuleMatcher>(m_ColorRules);
+			}
 
-				if (colorRule.dwFilterAttributes != 0)
-				{
-					if (colorRule.dwFilterAttributes & dwAttributes)
-					{
-						bMatchAttributes = TRUE;
-					}
-				}
-				else
-				{
-					bMatchAttributes = TRUE;
-				}
+			auto color = m_pActiveShellBrowser->GetItemColor(static_cast<int>(pnmcd->dwItemSpec),
+				*m_colorRuleMatcher);
 
-				if (bMatchFileName && bMatchAttributes)
-				{
-					pnmlvcd->clrText = colorRule.rgbColour;
-					return CDRF_NEWFONT;
-				}
+			if (color)
+			{
+				pnmlvcd->clrText = *color;
+				return CDRF_NEWFONT;
 			}
 		}
 		break;
@@ -1324,7 +1297,18 @@ void Explorerplusplus::SaveAllSettings()
 	pLoadSave->SaveGenericSettings();
 	pLoadSave->SaveTabs();
 	pLoadSave->SaveDefaultColumns();
-	pLoadSave->SaveBookmarks();
+
+	/* While the bookmark journal is active, bookmarks are
+	saved as they're changed, so there's no need to write
+	them out again here. The config file still receives a
+	full copy, so that it remains self-contained. The
+	journal is told about that copy once the file has been
+	written (see LoadSaveXML). */
+	if (!IsBookmarkJournalActive() || m_bSavePreferencesToXMLFile)
+	{
+		pLoadSave->SaveBookmarks();
+	}
+
 	pLoadSave->SaveApplicationToolbar();
 	pLoadSave->SaveToolbarInformation();
 	pLoadSave->SaveColorRules();
@@ -1393,9 +1377,9 @@ IconResourceLoader *Explorerplusplus::GetIconResourceLoader() const
 	return m_iconResourceLoader.get();
 }
 
-CachedIcons *Explorerplusplus::GetCachedIcons()
+IconService *Explorerplusplus::GetIconService()
 {
-	return &m_cachedIcons;
+	return &m_iconService;
 }
 
 BOOL Explorerplusplus::GetSavePreferencesToXmlFile() const
@@ -49,7 +49,7 @@ void Navigation::OnNavigateUp()
 	if (SUCCEEDED(hr))
 	{
 		const Tab &resultingTab = m_tabContainer->GetTab(resultingTabId);
-		resultingTab.GetShellBrowser()->SelectItems({ directory.get() });
+		resultingTab.GetShellBrowser()->SelectItemsOnNavigationCompleted({ directory.get() });
 	}
 }
 
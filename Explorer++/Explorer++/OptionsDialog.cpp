@@ -28,6 +28,7 @@
 #include "ViewModeHelper.h"
 #include "../Helper/Controls.h"
 #include "../Helper/DpiCompatibility.h"
+#include "../Helper/FolderSizeCache.h"
 #include "../Helper/Helper.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
@@ -857,6 +858,15 @@ INT_PTR CALLBACK OptionsDialog::FilesFoldersProc(HWND hDlg, UINT uMsg, WPARAM wP
 			m_config->globalFolderSettings.showFolderSizes =
 				(IsDlgButtonChecked(hDlg, IDC_SETTINGS_CHECK_FOLDERSIZES) == BST_CHECKED);
 
+			// Cached folder sizes are only used while folder sizes are shown, so there's no need
+			// to keep them (or to keep monitoring changes for them) once they're hidden.
+			if (!m_config->globalFolderSettings.showFolderSizes)
+			{
+				FolderSizeCache::GetInstance().Clear();
+			}
+
+			SendMessage(m_expp->GetMainWindow(), WM_APP_FOLDERSIZECACHEUSAGECHANGED, 0, 0);
+
 			m_config->globalFolderSettings.disableFolderSizesNetworkRemovable =
 				(IsDlgButtonChecked(hDlg, IDC_SETTINGS_CHECK_FOLDERSIZESNETWORKREMOVABLE)
 					== BST_CHECKED);
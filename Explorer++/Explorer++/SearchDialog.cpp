@@ -18,16 +18,19 @@
 #include "../Helper/DpiCompatibility.h"
 #include "../Helper/FileContextMenuManager.h"
 #include "../Helper/Helper.h"
+#include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
 #include "../Helper/RegistrySettings.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WindowHelper.h"
 #include "../Helper/XMLSettings.h"
+#include <algorithm>
 #include <regex>
+#include <thread>
 
 namespace NSearchDialog
 {
-	const int WM_APP_SEARCHITEMFOUND = WM_APP + 1;
+	const int WM_APP_SEARCHITEMSFOUND = WM_APP + 1;
 	const int WM_APP_SEARCHFINISHED = WM_APP + 2;
 	const int WM_APP_SEARCHCHANGEDDIRECTORY = WM_APP + 3;
 	const int WM_APP_REGULAREXPRESSIONINVALID = WM_APP + 4;
@@ -677,10 +680,13 @@ void SearchDialog::HandleCustomMenuItem(PCIDLIST_ABSOLUTE pidlParent,
 	{
 	case MENU_ID_OPEN_FILE_LOCATION:
 	{
-		m_tabContainer->CreateNewTab(pidlParent, TabSettings(_selected = true));
+		int newTabId;
+		m_tabContainer->CreateNewTab(pidlParent, TabSettings(_selected = true), nullptr, nullptr,
+			&newTabId);
 
 		unique_pidl_absolute pidlComplete(ILCombine(pidlParent, pidlItems.front()));
-		m_pexpp->GetActiveShellBrowser()->SelectItems({ pidlComplete.get() });
+		const Tab &tab = m_tabContainer->GetTab(newTabId);
+		tab.GetShellBrowser()->SelectItemsOnNavigationCompleted({ pidlComplete.get() });
 	}
 	break;
 	}
@@ -828,17 +834,27 @@ INT_PTR SearchDialog::OnNotify(NMHDR *pnmhdr)
 
 INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
+	UNREFERENCED_PARAMETER(wParam);
+	UNREFERENCED_PARAMETER(lParam);
+
 	switch (uMsg)
 	{
 	/* We won't actually process the item here. Instead, we'll
 	add it onto the list of current items, which will be processed
 	in batch. This is done to stop this message from blocking the
 	main GUI (also see http://www.flounder.com/iocompletion.htm). */
-	case NSearchDialog::WM_APP_SEARCHITEMFOUND:
+	case NSearchDialog::WM_APP_SEARCHITEMSFOUND:
 	{
-		m_AwaitingSearchItems.push_back(reinterpret_cast<PIDLIST_ABSOLUTE>(wParam));
+		if (m_pSearch == nullptr)
+		{
+			break;
+		}
+
+		auto foundItems = m_pSearch->TakeFoundItems();
+		m_AwaitingSearchItems.insert(m_AwaitingSearchItems.end(), foundItems.begin(),
+			foundItems.end());
 
-		if (m_bSetSearchTimer)
+		if (m_bSetSearchTimer && !m_AwaitingSearchItems.empty())
 		{
 			SetTimer(m_hDlg, SEARCH_PROCESSITEMS_TIMER_ID, SEARCH_PROCESSITEMS_TIMER_ELAPSED,
 				nullptr);
@@ -850,12 +866,27 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 	case NSearchDialog::WM_APP_SEARCHFINISHED:
 	{
+		assert(m_pSearch != nullptr);
+
+		// Any items found after the last notification was sent still need to be added.
+		auto foundItems = m_pSearch->TakeFoundItems();
+		m_AwaitingSearchItems.insert(m_AwaitingSearchItems.end(), foundItems.begin(),
+			foundItems.end());
+
+		if (m_bSetSearchTimer && !m_AwaitingSearchItems.empty())
+		{
+			SetTimer(m_hDlg, SEARCH_PROCESSITEMS_TIMER_ID, SEARCH_PROCESSITEMS_TIMER_ELAPSED,
+				nullptr);
+
+			m_bSetSearchTimer = FALSE;
+		}
+
 		TCHAR szStatus[512];
 
 		if (!m_bStopSearching)
 		{
-			int iFoldersFound = LOWORD(lParam);
-			int iFilesFound = HIWORD(lParam);
+			int iFoldersFound = m_pSearch->GetNumFoldersFound();
+			int iFilesFound = m_pSearch->GetNumFilesFound();
 
 			TCHAR szTemp[128];
 			LoadString(GetInstance(), IDS_SEARCH_FINISHED_MESSAGE, szTemp, SIZEOF_ARRAY(szTemp));
@@ -869,8 +900,6 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 			SetDlgItemText(m_hDlg, IDC_STATIC_STATUS, szTemp);
 		}
 
-		assert(m_pSearch != nullptr);
-
 		m_pSearch->Release();
 		m_pSearch = nullptr;
 
@@ -882,14 +911,17 @@ INT_PTR SearchDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 	case NSearchDialog::WM_APP_SEARCHCHANGEDDIRECTORY:
 	{
-		TCHAR szStatus[512];
-		TCHAR *pszDirectory = nullptr;
+		if (m_pSearch == nullptr)
+		{
+			break;
+		}
 
-		pszDirectory = reinterpret_cast<TCHAR *>(wParam);
+		std::wstring directory = m_pSearch->GetDirectoryBeingSearched();
 
+		TCHAR szStatus[512];
 		TCHAR szTemp[64];
 		LoadString(GetInstance(), IDS_SEARCHING, szTemp, SIZEOF_ARRAY(szTemp));
-		StringCchPrintf(szStatus, SIZEOF_ARRAY(szStatus), szTemp, pszDirectory);
+		StringCchPrintf(szStatus, SIZEOF_ARRAY(szStatus), szTemp, directory.c_str());
 		SetDlgItemText(m_hDlg, IDC_STATIC_STATUS, szStatus);
 	}
 	break;
@@ -1010,7 +1042,15 @@ DWORD WINAPI NSearchDialog::SearchThread(LPVOID pParam)
 }
 
 Search::Search(HWND hDlg, TCHAR *szBaseDirectory, TCHAR *szPattern, DWORD dwAttributes,
-	BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders)
+	BOOL bUseRegularExpressions, BOOL bCaseInsensitive, BOOL bSearchSubFolders) :
+	m_wildcardPattern(szPattern, !bCaseInsensitive),
+	m_walker(
+		std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, MAX_SEARCH_THREADS),
+		bSearchSubFolders),
+	m_foundItemsNotificationPending(false),
+	m_lastDirectoryUpdateTime(0),
+	m_iFoldersFound(0),
+	m_iFilesFound(0)
 {
 	m_hDlg = hDlg;
 	m_dwAttributes = dwAttributes;
@@ -1020,21 +1060,18 @@ Search::Search(HWND hDlg, TCHAR *szBaseDirectory, TCHAR *szPattern, DWORD dwAttr
 
 	StringCchCopy(m_szBaseDirectory, SIZEOF_ARRAY(m_szBaseDirectory), szBaseDirectory);
 	StringCchCopy(m_szSearchPattern, SIZEOF_ARRAY(m_szSearchPattern), szPattern);
-
-	InitializeCriticalSection(&m_csStop);
-	m_bStopSearching = FALSE;
 }
 
 Search::~Search()
 {
-	DeleteCriticalSection(&m_csStop);
+	for (PIDLIST_ABSOLUTE pidl : m_foundItems)
+	{
+		CoTaskMemFree(pidl);
+	}
 }
 
 void Search::StartSearching()
 {
-	m_iFoldersFound = 0;
-	m_iFilesFound = 0;
-
 	if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0 && m_bUseRegularExpressions)
 	{
 		try
@@ -1056,159 +1093,175 @@ void Search::StartSearching()
 		}
 	}
 
-	SearchDirectory(m_szBaseDirectory);
+	m_walker.Walk(
+		m_szBaseDirectory,
+		[this](int threadIndex, const std::wstring &directory)
+		{
+			UNREFERENCED_PARAMETER(threadIndex);
 
-	SendMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHFINISHED, 0,
-		MAKELPARAM(m_iFoldersFound, m_iFilesFound));
+			OnDirectoryEntered(directory);
+		},
+		[this](int threadIndex, const std::wstring &directory, const WIN32_FIND_DATA &findData)
+		{
+			UNREFERENCED_PARAMETER(threadIndex);
+
+			OnItemFound(directory, findData);
+		});
+
+	LogThreadStats();
+
+	SendMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHFINISHED, 0, 0);
 
 	Release();
 }
 
-void Search::SearchDirectory(const TCHAR *szDirectory)
+// Called concurrently from each of the search threads.
+void Search::OnDirectoryEntered(const std::wstring &directory)
 {
-	SendMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHCHANGEDDIRECTORY,
-		reinterpret_cast<WPARAM>(szDirectory), 0);
+	// Updating the status text for every directory would result in the dialog being flooded with
+	// messages (and the text would change too quickly to read anyway).
+	ULONGLONG now = GetTickCount64();
+	ULONGLONG lastUpdateTime = m_lastDirectoryUpdateTime.load();
+
+	if (now - lastUpdateTime < DIRECTORY_UPDATE_INTERVAL
+		|| !m_lastDirectoryUpdateTime.compare_exchange_strong(lastUpdateTime, now))
+	{
+		return;
+	}
 
-	std::list<std::wstring> subFolderList;
+	{
+		std::scoped_lock lock(m_currentDirectoryMutex);
+		m_currentDirectory = directory;
+	}
 
-	SearchDirectoryInternal(szDirectory, &subFolderList);
+	PostMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHCHANGEDDIRECTORY, 0, 0);
+}
 
-	bool bStop = false;
+// Called concurrently from each of the search threads.
+void Search::OnItemFound(const std::wstring &directory, const WIN32_FIND_DATA &findData)
+{
+	if (!DoesItemMatch(findData))
+	{
+		return;
+	}
 
-	EnterCriticalSection(&m_csStop);
-	if (m_bStopSearching)
+	if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
 	{
-		bStop = true;
+		m_iFoldersFound++;
 	}
-	LeaveCriticalSection(&m_csStop);
+	else
+	{
+		m_iFilesFound++;
+	}
+
+	TCHAR szFullFileName[MAX_PATH];
+	PathCombine(szFullFileName, directory.c_str(), findData.cFileName);
+
+	unique_pidl_absolute pidl;
+	HRESULT hr =
+		SHParseDisplayName(szFullFileName, nullptr, wil::out_param(pidl), 0, nullptr);
 
-	if (bStop)
+	if (FAILED(hr))
 	{
 		return;
 	}
 
-	if (m_bSearchSubFolders)
+	bool postNotification = false;
+
 	{
-		for (const auto &strSubFolder : subFolderList)
+		std::scoped_lock lock(m_foundItemsMutex);
+		m_foundItems.push_back(pidl.release());
+
+		if (!m_foundItemsNotificationPending)
 		{
-			SearchDirectory(strSubFolder.c_str());
+			m_foundItemsNotificationPending = true;
+			postNotification = true;
 		}
 	}
+
+	if (postNotification)
+	{
+		PostMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHITEMSFOUND, 0, 0);
+	}
 }
 
-/* Can't recurse, as it would overflow the stack. */
-void Search::SearchDirectoryInternal(const TCHAR *szSearchDirectory,
-	std::list<std::wstring> *pSubFolderList)
+bool Search::DoesItemMatch(const WIN32_FIND_DATA &findData) const
 {
-	assert(szSearchDirectory != nullptr);
-	assert(pSubFolderList != nullptr);
-
-	WIN32_FIND_DATA wfd;
-	TCHAR szSearchTerm[MAX_PATH];
-
-	PathCombine(szSearchTerm, szSearchDirectory, _T("*"));
-
-	HANDLE hFindFile = FindFirstFile(szSearchTerm, &wfd);
-
-	if (hFindFile != INVALID_HANDLE_VALUE)
+	/* Only match against the filename if it's not empty. */
+	if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0)
 	{
-		bool bStop = false;
-
-		while (FindNextFile(hFindFile, &wfd) != 0 && !bStop)
+		if (m_bUseRegularExpressions)
 		{
-			if (lstrcmpi(wfd.cFileName, _T(".")) != 0 && lstrcmpi(wfd.cFileName, _T("..")) != 0)
+			if (!std::regex_match(findData.cFileName, m_rxPattern))
 			{
-				BOOL bMatchFileName = FALSE;
-				BOOL bMatchAttributes = FALSE;
-
-				/* Only match against the filename if it's not empty. */
-				if (lstrcmp(m_szSearchPattern, EMPTY_STRING) != 0)
-				{
-					if (m_bUseRegularExpressions)
-					{
-						if (std::regex_match(wfd.cFileName, m_rxPattern))
-						{
-							bMatchFileName = TRUE;
-						}
-					}
-					else
-					{
-						if (CheckWildcardMatch(m_szSearchPattern, wfd.cFileName,
-								!m_bCaseInsensitive))
-						{
-							bMatchFileName = TRUE;
-						}
-					}
-				}
-				else
-				{
-					/* No filename constraint, so all filenames match. */
-					bMatchFileName = TRUE;
-				}
+				return false;
+			}
+		}
+		else
+		{
+			if (!m_wildcardPattern.Matches(findData.cFileName))
+			{
+				return false;
+			}
+		}
+	}
 
-				if (m_dwAttributes != 0)
-				{
-					if ((wfd.dwFileAttributes & m_dwAttributes) == m_dwAttributes)
-					{
-						bMatchAttributes = TRUE;
-					}
-				}
-				else
-				{
-					bMatchAttributes = TRUE;
-				}
+	if (m_dwAttributes != 0 && (findData.dwFileAttributes & m_dwAttributes) != m_dwAttributes)
+	{
+		return false;
+	}
 
-				BOOL bItemMatch = bMatchFileName && bMatchAttributes;
+	return true;
+}
 
-				if (bItemMatch)
-				{
-					if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-						== FILE_ATTRIBUTE_DIRECTORY)
-					{
-						m_iFoldersFound++;
-					}
-					else
-					{
-						m_iFilesFound++;
-					}
+void Search::LogThreadStats() const
+{
+	const auto &threadStats = m_walker.GetThreadStats();
 
-					TCHAR szFullFileName[MAX_PATH];
-					PathCombine(szFullFileName, szSearchDirectory, wfd.cFileName);
+	for (size_t i = 0; i < threadStats.size(); i++)
+	{
+		const auto &stats = threadStats[i];
+		auto busyMilliseconds =
+			std::chrono::duration_cast<std::chrono::milliseconds>(stats.busyTime).count();
 
-					unique_pidl_absolute pidl;
-					SHParseDisplayName(szFullFileName, nullptr, wil::out_param(pidl), 0, nullptr);
+		LOG(debug) << L"Search thread " << i << L": " << stats.directoriesEnumerated
+				   << L" directories (" << stats.directoriesStolen << L" stolen), "
+				   << stats.entriesFound << L" entries in " << busyMilliseconds << L" ms ("
+				   << (stats.entriesFound * 1000 / (std::max)(busyMilliseconds, 1LL))
+				   << L" entries/s)";
+	}
+}
 
-					PostMessage(m_hDlg, NSearchDialog::WM_APP_SEARCHITEMFOUND,
-						reinterpret_cast<WPARAM>(ILCloneFull(pidl.get())), 0);
-				}
+void Search::StopSearching()
+{
+	m_walker.Cancel();
+}
 
-				if ((wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY)
-				{
-					TCHAR szSubFolder[MAX_PATH];
+std::vector<PIDLIST_ABSOLUTE> Search::TakeFoundItems()
+{
+	std::scoped_lock lock(m_foundItemsMutex);
 
-					PathCombine(szSubFolder, szSearchDirectory, wfd.cFileName);
+	std::vector<PIDLIST_ABSOLUTE> foundItems;
+	foundItems.swap(m_foundItems);
+	m_foundItemsNotificationPending = false;
 
-					pSubFolderList->push_back(szSubFolder);
-				}
-			}
+	return foundItems;
+}
 
-			EnterCriticalSection(&m_csStop);
-			if (m_bStopSearching)
-			{
-				bStop = true;
-			}
-			LeaveCriticalSection(&m_csStop);
-		}
+std::wstring Search::GetDirectoryBeingSearched()
+{
+	std::scoped_lock lock(m_currentDirectoryMutex);
+	return m_currentDirectory;
+}
 
-		FindClose(hFindFile);
-	}
+int Search::GetNumFoldersFound() const
+{
+	return m_iFoldersFound;
 }
 
-void Search::StopSearching()
+int Search::GetNumFilesFound() const
 {
-	EnterCriticalSection(&m_csStop);
-	m_bStopSearching = TRUE;
-	LeaveCriticalSection(&m_csStop);
+	return m_iFilesFound;
 }
 
 void SearchDialog::SaveState()
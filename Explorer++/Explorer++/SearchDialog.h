@@ -7,11 +7,15 @@
 #include "DarkModeDialogBase.h"
 #include "../Helper/DialogSettings.h"
 #include "../Helper/FileContextMenuManager.h"
+#include "../Helper/ParallelDirectoryWalker.h"
 #include "../Helper/ReferenceCount.h"
+#include "../Helper/StringHelper.h"
 #include <boost/circular_buffer.hpp>
 #include <MsXml2.h>
 #include <objbase.h>
+#include <atomic>
 #include <list>
+#include <mutex>
 #include <regex>
 #include <string>
 #include <unordered_map>
@@ -109,10 +113,23 @@ public:
 	void StartSearching();
 	void StopSearching();
 
+	// Can be called from any thread. Ownership of the returned items passes to the caller.
+	std::vector<PIDLIST_ABSOLUTE> TakeFoundItems();
+	std::wstring GetDirectoryBeingSearched();
+
+	int GetNumFoldersFound() const;
+	int GetNumFilesFound() const;
+
 private:
-	void SearchDirectory(const TCHAR *szDirectory);
-	void SearchDirectoryInternal(const TCHAR *szSearchDirectory,
-		std::list<std::wstring> *pSubFolderList);
+	static const int MAX_SEARCH_THREADS = 8;
+
+	// The minimum amount of time between updates to the directory shown in the dialog.
+	static const ULONGLONG DIRECTORY_UPDATE_INTERVAL = 100;
+
+	void OnDirectoryEntered(const std::wstring &directory);
+	void OnItemFound(const std::wstring &directory, const WIN32_FIND_DATA &findData);
+	bool DoesItemMatch(const WIN32_FIND_DATA &findData) const;
+	void LogThreadStats() const;
 
 	HWND m_hDlg;
 
@@ -124,12 +141,23 @@ private:
 	BOOL m_bSearchSubFolders;
 
 	std::wregex m_rxPattern;
+	WildcardPattern m_wildcardPattern;
 
-	CRITICAL_SECTION m_csStop;
-	BOOL m_bStopSearching;
+	ParallelDirectoryWalker m_walker;
+
+	// Matching items are collected here and handed to the dialog in batches. A notification is
+	// only posted when the first item is added to an empty batch, so the number of messages sent
+	// to the dialog stays small, no matter how many items are found.
+	std::mutex m_foundItemsMutex;
+	std::vector<PIDLIST_ABSOLUTE> m_foundItems;
+	bool m_foundItemsNotificationPending;
+
+	std::mutex m_currentDirectoryMutex;
+	std::wstring m_currentDirectory;
+	std::atomic<ULONGLONG> m_lastDirectoryUpdateTime;
 
-	int m_iFoldersFound;
-	int m_iFilesFound;
+	std::atomic<int> m_iFoldersFound;
+	std::atomic<int> m_iFilesFound;
 };
 
 class SearchDialog : public DarkModeDialogBase, public IFileContextMenuExternal
@@ -15,12 +15,14 @@
 #include "WebBrowserApp.h"
 #include "../Helper/IconFetcher.h"
 #include "../Helper/ListViewHelper.h"
+#include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 #include <wil/com.h>
 #include <winrt/base.h>
 #include <propkey.h>
 #include <propvarutil.h>
+#include <chrono>
 #include <list>
 
 HRESULT ShellBrowser::BrowseFolder(const HistoryEntry &entry)
@@ -29,13 +31,27 @@ HRESULT ShellBrowser::BrowseFolder(const HistoryEntry &entry)
 
 	if (SUCCEEDED(hr))
 	{
-		auto selectedItems = entry.GetSelectedItems();
-		SelectItems(ShallowCopyPidls(selectedItems));
+		// The folder is enumerated asynchronously, so the items can only be selected once the
+		// enumeration has finished.
+		m_enumerationContext->itemsToSelect = entry.GetSelectedItems();
 	}
 
 	return hr;
 }
 
+void ShellBrowser::SelectItemsOnNavigationCompleted(const std::vector<PCIDLIST_ABSOLUTE> &pidls)
+{
+	if (!m_enumerationContext)
+	{
+		return;
+	}
+
+	for (auto pidl : pidls)
+	{
+		m_enumerationContext->itemsToSelect.emplace_back(ILCloneFull(pidl));
+	}
+}
+
 HRESULT ShellBrowser::BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry)
 {
 	SetCursor(LoadCursor(nullptr, IDC_WAIT));
@@ -46,22 +62,42 @@ HRESULT ShellBrowser::BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHist
 			SetCursor(LoadCursor(nullptr, IDC_ARROW));
 		});
 
+	// Any enumeration that's still in progress is for a folder that's no longer going to be
+	// shown. That navigation will never complete, so observers need to be told that it has been
+	// cancelled. That's done before the new navigation starts, so that the notifications for the
+	// two navigations don't overlap.
+	if (m_enumerationContext)
+	{
+		CancelEnumeration();
+
+		m_navigationCancelledSignal();
+	}
+
 	m_navigationStartedSignal(pidlDirectory);
 
-	std::vector<ItemInfo_t> items;
-	HRESULT hr = EnumerateFolder(pidlDirectory, addHistoryEntry, items);
+	HRESULT hr = StartEnumeration(pidlDirectory, addHistoryEntry);
 
 	if (FAILED(hr))
 	{
 		m_navigationFailedSignal();
-		return hr;
 	}
 
-	OnEnumerationCompleted(std::move(items));
-
 	return hr;
 }
 
+void ShellBrowser::CancelEnumeration()
+{
+	if (!m_enumerationContext)
+	{
+		return;
+	}
+
+	m_enumerationContext->stopSource.request_stop();
+	m_enumerationContext.reset();
+
+	m_enumerationTaskGroup.Clear();
+}
+
 void ShellBrowser::PrepareToChangeFolders()
 {
 	if (m_bFolderVisited)
@@ -94,16 +130,24 @@ void ShellBrowser::PrepareToChangeFolders()
 
 void ShellBrowser::ClearPendingResults()
 {
-	m_columnThreadPool.clear_queue();
+	// Any tasks that are currently running will stop early and won't post a result.
+	m_itemTaskScheduler.CancelAll();
+
 	m_columnResults.clear();
+	m_thumbnailResults.clear();
+	m_infoTipResults.clear();
+	m_groupResults.clear();
+	m_filterResults.clear();
 
 	m_iconFetcher->ClearQueue();
 
-	m_thumbnailThreadPool.clear_queue();
-	m_thumbnailResults.clear();
-
-	m_infoTipsThreadPool.clear_queue();
-	m_infoTipResults.clear();
+	auto stats = m_itemTaskScheduler.GetStats();
+	LOG(debug) << L"Item tasks: " << stats.tasksQueued << L" queued, " << stats.tasksStarted
+			   << L" started, " << stats.tasksDropped << L" dropped, " << stats.tasksCancelled
+			   << L" cancelled, max queue latency "
+			   << std::chrono::duration_cast<std::chrono::milliseconds>(stats.maxQueueLatency)
+					  .count()
+			   << L"ms";
 }
 
 void ShellBrowser::ResetFolderState()
@@ -126,11 +170,38 @@ void ShellBrowser::ResetFolderState()
 
 	m_directoryState = DirectoryState();
 
+	// If the folder is reset while an update is in progress (e.g. because the directory was
+	// refreshed while shell changes were being applied), the saved selection refers to items that
+	// no longer exist, so there's nothing to restore.
+	if (m_savedVirtualSelection)
+	{
+		m_savedVirtualSelection = VirtualSelection();
+	}
+
+	// The items have been removed, so the groups will need to be rebuilt once the items in the
+	// new folder have been added.
+	m_listViewGroupsSortMode.reset();
+
+	// Items in the new folder will be hidden if they don't match the current pattern.
+	m_filterPatternHistory = { m_filterPattern };
+
 	EnterCriticalSection(&m_csDirectoryAltered);
 	m_AlteredList.clear();
 	LeaveCriticalSection(&m_csDirectoryAltered);
 
-	m_itemInfoMap.clear();
+	auto memoryUsage = m_itemStore.GetMemoryUsage();
+
+	if (memoryUsage.numItems > 0)
+	{
+		LOG(debug) << L"Item store: " << memoryUsage.numItems << L" items, "
+				   << memoryUsage.GetTotalBytes() / memoryUsage.numItems << L" bytes per item ("
+				   << memoryUsage.columnBytes << L" column, " << memoryUsage.nameBytes << L" name, "
+				   << memoryUsage.pidlBytes << L" pidl)";
+	}
+
+	m_itemStore.Clear();
+
+	m_shellChangeCoalescer.Clear();
 
 	m_renamedItemOldPidl.reset();
 }
@@ -148,8 +219,96 @@ void ShellBrowser::StoreCurrentlySelectedItems()
 	entry->SetSelectedItems(selectedItems);
 }
 
-HRESULT ShellBrowser::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry,
-	std::vector<ShellBrowser::ItemInfo_t> &items)
+std::optional<size_t> ShellBrowser::Hibernate()
+{
+	if (m_hibernated || m_enumerationContext || !m_bFolderVisited)
+	{
+		return std::nullopt;
+	}
+
+	size_t bytesReleased = EstimateFolderMemoryUsage();
+
+	int firstVisibleItem = GetVisibleItemRange().first;
+
+	if (firstVisibleItem < ListView_GetItemCount(m_hListView))
+	{
+		m_hibernatedTopItem = GetItemCompleteIdl(firstVisibleItem);
+	}
+
+	// Only the state that's specific to the items is released. The directory itself is still
+	// needed, so that the tab can continue to report its location while it's hibernated.
+	unique_pidl_absolute pidlDirectory(ILCloneFull(m_directoryState.pidlDirectory.get()));
+	std::wstring directory = m_directoryState.directory;
+	bool virtualFolder = m_directoryState.virtualFolder;
+
+	// The selection is saved to the current history entry here, in the same way it would be if
+	// the user navigated elsewhere.
+	PrepareToChangeFolders();
+
+	m_directoryState.pidlDirectory = std::move(pidlDirectory);
+	m_directoryState.directory = std::move(directory);
+	m_directoryState.virtualFolder = virtualFolder;
+
+	m_hibernated = true;
+
+	return bytesReleased;
+}
+
+void ShellBrowser::Rehydrate()
+{
+	if (!m_hibernated || m_enumerationContext)
+	{
+		return;
+	}
+
+	// The selection is restored from the current history entry.
+	HRESULT hr = m_navigationController->Refresh();
+
+	if (FAILED(hr) || !m_enumerationContext || !m_hibernatedTopItem)
+	{
+		return;
+	}
+
+	m_enumerationContext->itemToScrollTo.reset(ILCloneFull(m_hibernatedTopItem.get()));
+}
+
+bool ShellBrowser::IsHibernated() const
+{
+	return m_hibernated;
+}
+
+// This is only an estimate, since the memory used internally by the listview isn't known. It does,
+// however, cover the bulk of the memory that's used for each item.
+size_t ShellBrowser::EstimateFolderMemoryUsage() const
+{
+	size_t bytes = 0;
+
+	bytes += m_itemStore.GetMemoryUsage().GetTotalBytes();
+
+	for (const auto &[key, internalIndex] : m_directoryState.parsingNameIndex)
+	{
+		bytes += (key.capacity() * sizeof(wchar_t)) + sizeof(internalIndex);
+	}
+
+	for (const auto &[key, internalIndex] : m_directoryState.childPidlIndex)
+	{
+		bytes += key.capacity() + sizeof(internalIndex);
+	}
+
+	if (m_folderSettings.viewMode == +ViewMode::Thumbnails)
+	{
+		auto himl = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
+		bytes += static_cast<size_t>(ImageList_GetImageCount(himl)) * THUMBNAIL_ITEM_WIDTH
+			* THUMBNAIL_ITEM_HEIGHT * 4;
+	}
+
+	return bytes;
+}
+
+// Performs the checks that can be done quickly on the UI thread, then hands the enumeration itself
+// off to a background thread. The navigation is committed once the background thread has been able
+// to successfully start the enumeration.
+HRESULT ShellBrowser::StartEnumeration(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry)
 {
 	wil::com_ptr_nothrow<IShellFolder> parent;
 	PCITEMID_CHILD child;
@@ -176,60 +335,243 @@ HRESULT ShellBrowser::EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addH
 		return hr;
 	}
 
-	wil::com_ptr_nothrow<IShellFolder> shellFolder;
-	hr = BindToIdl(pidlDirectory, IID_PPV_ARGS(&shellFolder));
+	SHCONTF enumFlags = SHCONTF_FOLDERS | SHCONTF_NONFOLDERS;
 
-	if (FAILED(hr))
+	if (m_folderSettings.showHidden)
 	{
-		return hr;
+		WI_SetAllFlags(enumFlags, SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN);
 	}
 
-	SHCONTF enumFlags = SHCONTF_FOLDERS | SHCONTF_NONFOLDERS;
+	auto context = std::make_shared<EnumerationContext>();
+	context->id = m_enumerationIdCounter++;
+	context->pidlDirectory.reset(ILCloneFull(pidlDirectory));
+	context->parsingPath = parsingPath;
+	context->virtualFolder = WI_IsFlagClear(attr, SFGAO_FILESYSTEM);
+	context->isRecycleBin = IsRecycleBin(pidlDirectory);
+	context->addHistoryEntry = addHistoryEntry;
+	context->enumFlags = enumFlags;
 
-	if (m_folderSettings.showHidden)
+	m_enumerationContext = context;
+
+	m_enumerationTaskGroup.Post(
+		[listView = m_hListView, owner = m_hOwner, context,
+			stopToken = context->stopSource.get_token()]()
+		{
+			EnumerateFolderAsync(listView, owner, context, stopToken);
+		});
+
+	return S_OK;
+}
+
+void ShellBrowser::EnumerateFolderAsync(HWND listView, HWND owner,
+	std::shared_ptr<EnumerationContext> context, std::stop_token stopToken)
+{
+	if (stopToken.stop_requested())
 	{
-		WI_SetAllFlags(enumFlags, SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN);
+		return;
+	}
+
+	wil::com_ptr_nothrow<IShellFolder> shellFolder;
+	HRESULT hr = BindToIdl(context->pidlDirectory.get(), IID_PPV_ARGS(&shellFolder));
+
+	if (FAILED(hr))
+	{
+		SetEnumerationStatus(listView, context.get(), EnumerationStatus::Failed);
+		return;
 	}
 
 	wil::com_ptr_nothrow<IEnumIDList> enumerator;
-	hr = shellFolder->EnumObjects(m_hOwner, enumFlags, &enumerator);
+	hr = shellFolder->EnumObjects(owner, context->enumFlags, &enumerator);
 
 	if (FAILED(hr) || !enumerator)
 	{
-		return hr;
+		SetEnumerationStatus(listView, context.get(), EnumerationStatus::Failed);
+		return;
+	}
+
+	SetEnumerationStatus(listView, context.get(), EnumerationStatus::Started);
+
+	std::vector<ItemInfo_t> items;
+	PITEMID_CHILD rawPidls[ENUMERATION_BATCH_SIZE];
+	ULONG numFetched = 0;
+
+	while (!stopToken.stop_requested())
+	{
+		hr = enumerator->Next(ENUMERATION_BATCH_SIZE, rawPidls, &numFetched);
+
+		if (FAILED(hr) || numFetched == 0)
+		{
+			break;
+		}
+
+		for (ULONG i = 0; i < numFetched; i++)
+		{
+			unique_pidl_child pidlItem(rawPidls[i]);
+
+			if (stopToken.stop_requested())
+			{
+				continue;
+			}
+
+			auto item = GetItemInformation(shellFolder.get(), context->pidlDirectory.get(),
+				pidlItem.get(), context->isRecycleBin);
+
+			if (item)
+			{
+				items.push_back(std::move(*item));
+			}
+		}
+
+		AddEnumeratedItems(listView, context.get(), items);
+
+		if (hr != S_OK)
+		{
+			break;
+		}
+	}
+
+	SetEnumerationStatus(listView, context.get(), EnumerationStatus::Finished);
+}
+
+void ShellBrowser::SetEnumerationStatus(HWND listView, EnumerationContext *context,
+	EnumerationStatus status)
+{
+	std::scoped_lock lock(context->mutex);
+
+	context->status = status;
+
+	// Unlike items, status changes are always posted, since the final status change needs to be
+	// seen by the UI thread, even if there are no items left to process.
+	PostMessage(listView, WM_APP_ENUMERATION_PROGRESS, context->id, 0);
+	context->notificationPending = true;
+}
+
+void ShellBrowser::AddEnumeratedItems(HWND listView, EnumerationContext *context,
+	std::vector<ItemInfo_t> &items)
+{
+	if (items.empty())
+	{
+		return;
+	}
+
+	std::scoped_lock lock(context->mutex);
+
+	std::move(items.begin(), items.end(), std::back_inserter(context->pendingItems));
+	items.clear();
+
+	// Only a single notification is needed for any number of pending items. Once the UI thread
+	// has taken the pending items, another notification can be posted. That prevents the message
+	// queue from being flooded when the UI thread is slower than the enumeration.
+	if (!context->notificationPending)
+	{
+		PostMessage(listView, WM_APP_ENUMERATION_PROGRESS, context->id, 0);
+		context->notificationPending = true;
 	}
+}
+
+void ShellBrowser::OnEnumerationProgress(int enumerationId)
+{
+	if (!m_enumerationContext || m_enumerationContext->id != enumerationId)
+	{
+		// This notification is for an enumeration that has since been cancelled.
+		return;
+	}
+
+	// Holding a reference here ensures the context remains valid, even if one of the signals
+	// below results in another navigation.
+	auto context = m_enumerationContext;
+
+	EnumerationStatus status;
+	std::vector<ItemInfo_t> items;
+
+	{
+		std::scoped_lock lock(context->mutex);
+
+		status = context->status;
+		items = std::move(context->pendingItems);
+		context->pendingItems.clear();
+		context->notificationPending = false;
+	}
+
+	if (status == EnumerationStatus::Failed)
+	{
+		m_enumerationContext.reset();
+
+		m_navigationFailedSignal();
+		return;
+	}
+
+	if (!context->committed)
+	{
+		CommitEnumeration(context.get());
+
+		if (context->stopSource.stop_requested())
+		{
+			return;
+		}
+	}
+
+	InsertEnumeratedItems(std::move(items));
+
+	if (status == EnumerationStatus::Finished)
+	{
+		OnEnumerationCompleted();
+	}
+}
+
+// Called once the background thread has been able to start enumerating the folder. At this point,
+// the navigation can no longer fail, so the previous folder can be torn down.
+void ShellBrowser::CommitEnumeration(EnumerationContext *context)
+{
+	context->committed = true;
 
 	PrepareToChangeFolders();
 
-	m_directoryState.pidlDirectory.reset(ILCloneFull(pidlDirectory));
-	m_directoryState.directory = parsingPath;
-	m_directoryState.virtualFolder = WI_IsFlagClear(attr, SFGAO_FILESYSTEM);
+	m_directoryState.pidlDirectory.reset(ILCloneFull(context->pidlDirectory.get()));
+	m_directoryState.directory = context->parsingPath;
+	m_directoryState.virtualFolder = context->virtualFolder;
 	m_uniqueFolderId++;
 
+	// Any navigation (not just the one started when rehydrating) will result in the folder being
+	// loaded again.
+	m_hibernated = false;
+	m_hibernatedTopItem.reset();
+
 	SetActiveColumnSet();
 	VerifySortMode();
 	SetViewModeInternal(m_folderSettings.viewMode);
 
+	// The state for this folder will need to be reset when navigating away, even if the
+	// enumeration never finishes.
+	m_bFolderVisited = TRUE;
+
 	// It makes sense to trigger this here, rather than on navigation completion, since
 	// otherwise requests could still come in for the previous directory.
-	NotifyShellOfNavigation(pidlDirectory);
-
-	m_navigationCommittedSignal(pidlDirectory, addHistoryEntry);
+	NotifyShellOfNavigation(context->pidlDirectory.get());
 
-	ULONG numFetched = 1;
-	unique_pidl_child pidlItem;
+	m_navigationCommittedSignal(context->pidlDirectory.get(), context->addHistoryEntry);
+}
 
-	while (enumerator->Next(1, wil::out_param(pidlItem), &numFetched) == S_OK && (numFetched == 1))
+void ShellBrowser::InsertEnumeratedItems(std::vector<ItemInfo_t> &&items)
+{
+	if (items.empty())
 	{
-		auto item = GetItemInformation(shellFolder.get(), pidlDirectory, pidlItem.get());
+		return;
+	}
 
-		if (item)
-		{
-			items.push_back(std::move(*item));
-		}
+	for (auto &item : items)
+	{
+		AddItemInternal(-1, std::move(item), FALSE);
 	}
 
-	return hr;
+	/* Stop the list view from redrawing itself each time is inserted.
+	Redrawing will be allowed once all items have being inserted.
+	(reduces lag when a large number of items are going to be inserted). */
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+
+	InsertAwaitingItems(FALSE);
+
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 }
 
 void ShellBrowser::NotifyShellOfNavigation(PCIDLIST_ABSOLUTE pidl)
@@ -373,8 +715,8 @@ std::optional<int> ShellBrowser::AddItemInternal(IShellFolder *shellFolder,
 
 int ShellBrowser::AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPosition)
 {
-	int itemId = GenerateUniqueItemId();
-	m_itemInfoMap.insert({ itemId, std::move(itemInfo) });
+	int itemId = m_itemStore.Add(std::move(itemInfo));
+	AddItemToIndexes(itemId);
 
 	AwaitingAdd_t awaitingAdd;
 
@@ -397,15 +739,24 @@ int ShellBrowser::AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPo
 	return itemId;
 }
 
-std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellFolder *shellFolder,
+std::optional<ItemInfo_t> ShellBrowser::GetItemInformation(IShellFolder *shellFolder,
 	PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild)
 {
-	ItemInfo_t itemInfo;
+	return GetItemInformation(shellFolder, pidlDirectory, pidlChild, IsRecycleBin(pidlDirectory));
+}
 
-	unique_pidl_absolute pidlItem(ILCombine(pidlDirectory, pidlChild));
+bool ShellBrowser::IsRecycleBin(PCIDLIST_ABSOLUTE pidl) const
+{
+	return m_recycleBinPidl
+		&& m_desktopFolder->CompareIDs(SHCIDS_CANONICALONLY, pidl, m_recycleBinPidl.get()) == 0;
+}
 
-	itemInfo.pidlComplete.reset(ILCloneFull(pidlItem.get()));
-	itemInfo.pridl.reset(ILCloneChild(pidlChild));
+// Note that this may be called on a background thread, so it shouldn't access any instance state.
+std::optional<ItemInfo_t> ShellBrowser::GetItemInformation(IShellFolder *shellFolder,
+	PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild, bool isRecycleBin)
+{
+	ItemInfo_t itemInfo;
+	itemInfo.pidlComplete.reset(ILCombine(pidlDirectory, pidlChild));
 
 	std::wstring parsingName;
 	HRESULT hr = GetDisplayName(shellFolder, pidlChild, SHGDN_FORPARSING, parsingName);
@@ -428,10 +779,6 @@ std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellF
 
 	SHGDNF displayNameFlags = SHGDN_INFOLDER;
 
-	bool isRecycleBin = m_recycleBinPidl
-		&& m_desktopFolder->CompareIDs(SHCIDS_CANONICALONLY, pidlDirectory, m_recycleBinPidl.get())
-			== 0;
-
 	// SHGDN_INFOLDER | SHGDN_FORPARSING is used to ensure that the name retrieved for a filesystem
 	// file contains an extension, even if extensions are hidden in Windows Explorer. When using
 	// SHGDN_INFOLDER by itself, the resulting name won't contain an extension if extensions are
@@ -464,15 +811,7 @@ std::optional<ShellBrowser::ItemInfo_t> ShellBrowser::GetItemInformation(IShellF
 
 	itemInfo.editingName = editingName;
 
-	if (PathIsRoot(parsingName.c_str()))
-	{
-		itemInfo.bDrive = TRUE;
-		StringCchCopy(itemInfo.szDrive, SIZEOF_ARRAY(itemInfo.szDrive), parsingName.c_str());
-	}
-	else
-	{
-		itemInfo.bDrive = FALSE;
-	}
+	itemInfo.bDrive = PathIsRoot(parsingName.c_str());
 
 	WIN32_FIND_DATA wfd;
 	hr = SHGetDataFromIDList(shellFolder, pidlChild, SHGDFIL_FINDDATA, &wfd, sizeof(wfd));
@@ -548,18 +887,15 @@ HRESULT ShellBrowser::ExtractFindDataUsingPropertyStore(IShellFolder *shellFolde
 	return hr;
 }
 
-void ShellBrowser::OnEnumerationCompleted(std::vector<ShellBrowser::ItemInfo_t> &&items)
+void ShellBrowser::OnEnumerationCompleted()
 {
-	for (auto &item : items)
-	{
-		AddItemInternal(-1, std::move(item), FALSE);
-	}
+	auto itemsToSelect = std::move(m_enumerationContext->itemsToSelect);
+	auto itemToScrollTo = std::move(m_enumerationContext->itemToScrollTo);
+	m_enumerationContext.reset();
 
-	/* Stop the list view from redrawing itself each time is inserted.
-	Redrawing will be allowed once all items have being inserted.
-	(reduces lag when a large number of items are going to be inserted). */
 	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
 
+	// If the folder is empty, this will result in the appropriate background image being shown.
 	InsertAwaitingItems(FALSE);
 
 	SortFolder(m_folderSettings.sortMode);
@@ -579,9 +915,39 @@ void ShellBrowser::OnEnumerationCompleted(std::vector<ShellBrowser::ItemInfo_t>
 		StartDirectoryMonitoring(m_directoryState.pidlDirectory.get());
 	}
 
-	m_bFolderVisited = TRUE;
-
 	m_navigationCompletedSignal(m_directoryState.pidlDirectory.get());
+
+	if (!itemsToSelect.empty())
+	{
+		SelectItems(ShallowCopyPidls(itemsToSelect));
+	}
+
+	if (itemToScrollTo)
+	{
+		auto index = GetItemIndexForPidl(itemToScrollTo.get());
+
+		if (index)
+		{
+			ScrollItemToTop(*index);
+		}
+	}
+}
+
+// Scrolling to the last item first means that the target item is then scrolled into view from
+// below, which results in it being shown at the top of the listview, rather than the bottom.
+void ShellBrowser::ScrollItemToTop(int index)
+{
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	if (numItems == 0)
+	{
+		return;
+	}
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+	ListView_EnsureVisible(m_hListView, numItems - 1, FALSE);
+	ListView_EnsureVisible(m_hListView, index, FALSE);
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 }
 
 void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
@@ -608,10 +974,20 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 		ApplyFolderEmptyBackgroundImage(false);
 	}
 
-	/* Make the listview allocate space (for internal data structures)
-	for all the items at once, rather than individually.
-	Acts as a speed optimization. */
-	ListView_SetItemCount(m_hListView, m_directoryState.awaitingAddList.size() + nPrevItems);
+	if (m_virtualListView)
+	{
+		// In owner data mode, setting the item count is what actually adds the items to the
+		// listview, so that's done once all the items have been inserted below. Since the
+		// selection is tracked by position, it also needs to be moved along with the items.
+		BeginVirtualSelectionUpdate();
+	}
+	else
+	{
+		/* Make the listview allocate space (for internal data structures)
+		for all the items at once, rather than individually.
+		Acts as a speed optimization. */
+		ListView_SetItemCount(m_hListView, m_directoryState.awaitingAddList.size() + nPrevItems);
+	}
 
 	if (m_folderSettings.autoArrange)
 	{
@@ -623,94 +999,37 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 
 	for (const auto &awaitingItem : m_directoryState.awaitingAddList)
 	{
-		const auto &itemInfo = m_itemInfoMap.at(awaitingItem.iItemInternal);
-
-		if (IsFileFiltered(itemInfo))
+		if (IsFileFiltered(awaitingItem.iItemInternal))
 		{
 			m_directoryState.filteredItemsList.insert(awaitingItem.iItemInternal);
 			continue;
 		}
 
-		BasicItemInfo_t basicItemInfo = getBasicItemInfo(awaitingItem.iItemInternal);
-		std::wstring filename = ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
-
-		LVITEM lv;
-		lv.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
+		int iItemIndex;
 
-		if (bInsertIntoGroup)
+		if (m_virtualListView)
 		{
-			int groupId = DetermineItemGroup(awaitingItem.iItemInternal);
-
-			lv.mask |= LVIF_GROUPID;
-			lv.iGroupId = groupId;
-
-			EnsureGroupExistsInListView(groupId);
-		}
-
-		lv.iItem = awaitingItem.iItem;
-		lv.iSubItem = 0;
-
-		auto firstColumn = GetFirstCheckedColumn();
-
-		if ((m_folderSettings.viewMode == +ViewMode::Details)
-			&& firstColumn.type != ColumnType::Name)
-		{
-			lv.pszText = LPSTR_TEXTCALLBACK;
+			// The item will be drawn (and its details retrieved) once it's visible.
+			iItemIndex = m_directoryState.virtualItems.Insert(awaitingItem.iItem,
+				awaitingItem.iItemInternal);
 		}
 		else
 		{
-			lv.pszText = filename.data();
-		}
-
-		lv.iImage = I_IMAGECALLBACK;
-		lv.lParam = awaitingItem.iItemInternal;
-
-		/* Insert the item into the list view control. */
-		int iItemIndex = ListView_InsertItem(m_hListView, &lv);
-
-		if (awaitingItem.bPosition && m_folderSettings.viewMode != +ViewMode::Details)
-		{
-			POINT ptItem;
-
-			if (awaitingItem.iAfter != -1)
-			{
-				ListView_GetItemPosition(m_hListView, awaitingItem.iAfter, &ptItem);
-			}
-			else
-			{
-				ptItem.x = 0;
-				ptItem.y = 0;
-			}
-
-			/* The item will end up in the position AFTER iAfter. */
-			ListView_SetItemPosition32(m_hListView, iItemIndex, ptItem.x, ptItem.y);
-		}
-
-		if (m_folderSettings.viewMode == +ViewMode::Tiles)
-		{
-			SetTileViewItemInfo(iItemIndex, awaitingItem.iItemInternal);
+			iItemIndex = InsertItemIntoListView(awaitingItem, bInsertIntoGroup);
 		}
 
 		if (m_queuedRenameItem
-			&& ArePidlsEquivalent(itemInfo.pidlComplete.get(), m_queuedRenameItem.get()))
+			&& ArePidlsEquivalent(m_itemStore.GetPidl(awaitingItem.iItemInternal),
+				m_queuedRenameItem.get()))
 		{
 			itemToRename = iItemIndex;
 		}
 
-		/* If the file is marked as hidden, ghost it out. */
-		if (itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN)
-		{
-			ListView_SetItemState(m_hListView, iItemIndex, LVIS_CUT, LVIS_CUT);
-		}
-
 		/* Add the current file's size to the running size of the current directory. */
 		/* A folder may or may not have 0 in its high file size member.
 		It should either be zeroed, or never counted. */
-		ULARGE_INTEGER ulFileSize;
-		ulFileSize.LowPart = itemInfo.wfd.nFileSizeLow;
-		ulFileSize.HighPart = itemInfo.wfd.nFileSizeHigh;
-
-		m_directoryState.totalDirSize.QuadPart += ulFileSize.QuadPart;
+		m_directoryState.totalDirSize.QuadPart +=
+			m_itemStore.GetFileSize(awaitingItem.iItemInternal);
 
 		nAdded++;
 	}
@@ -720,8 +1039,19 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 		ListViewHelper::SetAutoArrange(m_hListView, TRUE);
 	}
 
+	if (m_virtualListView)
+	{
+		UpdateVirtualItemCount();
+		EndVirtualSelectionUpdate();
+	}
+
 	m_directoryState.numItems = nPrevItems + nAdded;
 
+	if (nAdded > 0)
+	{
+		m_itemTaskScheduler.InvalidateRows();
+	}
+
 	PositionDroppedItems();
 
 	m_directoryState.awaitingAddList.clear();
@@ -733,6 +1063,76 @@ void ShellBrowser::InsertAwaitingItems(BOOL bInsertIntoGroup)
 	}
 }
 
+int ShellBrowser::InsertItemIntoListView(const AwaitingAdd_t &awaitingItem, BOOL insertIntoGroup)
+{
+	BasicItemInfo_t basicItemInfo = getBasicItemInfo(awaitingItem.iItemInternal);
+	std::wstring filename = ProcessItemFileName(basicItemInfo, m_config->globalFolderSettings);
+
+	LVITEM lv;
+	lv.mask = LVIF_TEXT | LVIF_IMAGE | LVIF_PARAM;
+
+	if (insertIntoGroup)
+	{
+		int groupId = DetermineItemGroup(awaitingItem.iItemInternal);
+
+		lv.mask |= LVIF_GROUPID;
+		lv.iGroupId = groupId;
+
+		EnsureGroupExistsInListView(groupId);
+	}
+
+	lv.iItem = awaitingItem.iItem;
+	lv.iSubItem = 0;
+
+	auto firstColumn = GetFirstCheckedColumn();
+
+	if ((m_folderSettings.viewMode == +ViewMode::Details) && firstColumn.type != ColumnType::Name)
+	{
+		lv.pszText = LPSTR_TEXTCALLBACK;
+	}
+	else
+	{
+		lv.pszText = filename.data();
+	}
+
+	lv.iImage = I_IMAGECALLBACK;
+	lv.lParam = awaitingItem.iItemInternal;
+
+	/* Insert the item into the list view control. */
+	int iItemIndex = ListView_InsertItem(m_hListView, &lv);
+
+	if (awaitingItem.bPosition && m_folderSettings.viewMode != +ViewMode::Details)
+	{
+		POINT ptItem;
+
+		if (awaitingItem.iAfter != -1)
+		{
+			ListView_GetItemPosition(m_hListView, awaitingItem.iAfter, &ptItem);
+		}
+		else
+		{
+			ptItem.x = 0;
+			ptItem.y = 0;
+		}
+
+		/* The item will end up in the position AFTER iAfter. */
+		ListView_SetItemPosition32(m_hListView, iItemIndex, ptItem.x, ptItem.y);
+	}
+
+	if (m_folderSettings.viewMode == +ViewMode::Tiles)
+	{
+		SetTileViewItemInfo(iItemIndex, awaitingItem.iItemInternal);
+	}
+
+	/* If the file is marked as hidden, ghost it out. */
+	if (m_itemStore.GetAttributes(awaitingItem.iItemInternal) & FILE_ATTRIBUTE_HIDDEN)
+	{
+		ListView_SetItemState(m_hListView, iItemIndex, LVIS_CUT, LVIS_CUT);
+	}
+
+	return iItemIndex;
+}
+
 void ShellBrowser::ApplyFolderEmptyBackgroundImage(bool apply)
 {
 	if (apply)
@@ -745,21 +1145,21 @@ void ShellBrowser::ApplyFolderEmptyBackgroundImage(bool apply)
 	}
 }
 
-BOOL ShellBrowser::IsFileFiltered(const ItemInfo_t &itemInfo) const
+BOOL ShellBrowser::IsFileFiltered(int internalIndex) const
 {
 	BOOL bHideSystemFile = FALSE;
 	BOOL bFilenameFiltered = FALSE;
+	DWORD attributes = m_itemStore.GetAttributes(internalIndex);
 
 	if (m_folderSettings.applyFilter
-		&& ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != FILE_ATTRIBUTE_DIRECTORY))
+		&& ((attributes & FILE_ATTRIBUTE_DIRECTORY) != FILE_ATTRIBUTE_DIRECTORY))
 	{
-		bFilenameFiltered = IsFilenameFiltered(itemInfo.displayName.c_str());
+		bFilenameFiltered = IsFilenameFiltered(m_itemStore.GetDisplayName(internalIndex).data());
 	}
 
 	if (m_config->globalFolderSettings.hideSystemFiles)
 	{
-		bHideSystemFile =
-			(itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_SYSTEM) == FILE_ATTRIBUTE_SYSTEM;
+		bHideSystemFile = (attributes & FILE_ATTRIBUTE_SYSTEM) == FILE_ATTRIBUTE_SYSTEM;
 	}
 
 	return bFilenameFiltered || bHideSystemFile;
@@ -767,7 +1167,6 @@ BOOL ShellBrowser::IsFileFiltered(const ItemInfo_t &itemInfo) const
 
 void ShellBrowser::RemoveItem(int iItemInternal)
 {
-	ULARGE_INTEGER ulFileSize;
 	LVFINDINFO lvfi;
 	int iItem;
 	int nItems;
@@ -779,36 +1178,48 @@ void ShellBrowser::RemoveItem(int iItemInternal)
 
 	/* Take the file size of the removed file away from the total
 	directory size. */
-	ulFileSize.LowPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeLow;
-	ulFileSize.HighPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeHigh;
+	m_directoryState.totalDirSize.QuadPart -= m_itemStore.GetFileSize(iItemInternal);
 
-	m_directoryState.totalDirSize.QuadPart -= ulFileSize.QuadPart;
-
-	/* Locate the item within the listview.
-	Could use filename, providing removed
-	items are always deleted before new
-	items are inserted. */
-	lvfi.flags = LVFI_PARAM;
-	lvfi.lParam = iItemInternal;
-	iItem = ListView_FindItem(m_hListView, -1, &lvfi);
-
-	if (iItem != -1)
+	if (m_virtualListView)
+	{
+		RemoveVirtualItem(iItemInternal);
+	}
+	else
 	{
-		if (m_folderSettings.showInGroups)
+		/* Locate the item within the listview.
+		Could use filename, providing removed
+		items are always deleted before new
+		items are inserted. */
+		lvfi.flags = LVFI_PARAM;
+		lvfi.lParam = iItemInternal;
+		iItem = ListView_FindItem(m_hListView, -1, &lvfi);
+
+		if (iItem != -1)
 		{
-			auto groupId = GetItemGroupId(iItem);
-
-			if (groupId)
+			if (m_folderSettings.showInGroups)
 			{
-				OnItemRemovedFromGroup(*groupId);
+				auto groupId = GetItemGroupId(iItem);
+
+				if (groupId)
+				{
+					OnItemRemovedFromGroup(*groupId);
+				}
 			}
-		}
 
-		/* Remove the item from the listview. */
-		ListView_DeleteItem(m_hListView, iItem);
+			/* Remove the item from the listview. */
+			ListView_DeleteItem(m_hListView, iItem);
+		}
 	}
 
-	m_itemInfoMap.erase(iItemInternal);
+	// The item may have been hidden by the filter. Its slot can be reused by a later item, so it
+	// mustn't be left in the list of filtered items.
+	m_directoryState.filteredItemsList.erase(iItemInternal);
+
+	RemoveItemFromIndexes(iItemInternal);
+	RemoveItemGroupInfo(iItemInternal);
+	m_itemStore.Remove(iItemInternal);
+
+	m_itemTaskScheduler.InvalidateRows();
 
 	nItems = ListView_GetItemCount(m_hListView);
 
@@ -850,3 +1261,10 @@ boost::signals2::connection ShellBrowser::AddNavigationFailedObserver(
 {
 	return m_navigationFailedSignal.connect(observer, position);
 }
+
+boost::signals2::connection ShellBrowser::AddNavigationCancelledObserver(
+	const NavigationCancelledSignal::slot_type &observer,
+	boost::signals2::connect_position position)
+{
+	return m_navigationCancelledSignal.connect(observer, position);
+}
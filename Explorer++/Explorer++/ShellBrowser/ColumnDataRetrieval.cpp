@@ -9,7 +9,7 @@
 #include "ItemData.h"
 #include "../Helper/DriveInfo.h"
 #include "../Helper/FileOperations.h"
-#include "../Helper/FolderSize.h"
+#include "../Helper/FolderSizeCache.h"
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/StringHelper.h"
@@ -22,7 +22,7 @@
 BOOL GetPrinterStatusDescription(DWORD dwStatus, TCHAR *szStatus, size_t cchMax);
 
 std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicItemInfo,
-	const GlobalFolderSettings &globalFolderSettings)
+	const GlobalFolderSettings &globalFolderSettings, std::stop_token stopToken)
 {
 	switch (columnType)
 	{
@@ -32,7 +32,7 @@ std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicIt
 	case ColumnType::Type:
 		return GetTypeColumnText(basicItemInfo);
 	case ColumnType::Size:
-		return GetSizeColumnText(basicItemInfo, globalFolderSettings);
+		return GetSizeColumnText(basicItemInfo, globalFolderSettings, stopToken);
 
 	case ColumnType::DateModified:
 		return GetTimeColumnText(basicItemInfo, TimeType::Modified, globalFolderSettings);
@@ -247,7 +247,7 @@ std::wstring GetTypeColumnText(const BasicItemInfo_t &itemInfo)
 }
 
 std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
-	const GlobalFolderSettings &globalFolderSettings)
+	const GlobalFolderSettings &globalFolderSettings, std::stop_token stopToken)
 {
 	if (!itemInfo.isFindDataValid)
 	{
@@ -270,7 +270,7 @@ std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
 		if (globalFolderSettings.showFolderSizes
 			&& !(globalFolderSettings.disableFolderSizesNetworkRemovable && bNetworkRemovable))
 		{
-			return GetFolderSizeColumnText(itemInfo, globalFolderSettings);
+			return GetFolderSizeColumnText(itemInfo, globalFolderSettings, stopToken);
 		}
 		else
 		{
@@ -288,15 +288,10 @@ std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
 }
 
 std::wstring GetFolderSizeColumnText(const BasicItemInfo_t &itemInfo,
-	const GlobalFolderSettings &globalFolderSettings)
+	const GlobalFolderSettings &globalFolderSettings, std::stop_token stopToken)
 {
-	auto folderInfo = GetFolderInfo(itemInfo.getFullPath());
-
-	/* TODO: This should
-	be done some other way.
-	Shouldn't depend on
-	the internal index. */
-	// m_cachedFolderSizes.insert({internalIndex, totalFolderSize.QuadPart});
+	auto folderInfo =
+		FolderSizeCache::GetInstance().GetFolderInfo(itemInfo.getFullPath(), stopToken);
 
 	ULARGE_INTEGER size;
 	size.QuadPart = folderInfo.size;
@@ -308,6 +303,26 @@ std::wstring GetFolderSizeColumnText(const BasicItemInfo_t &itemInfo,
 	return fileSizeText;
 }
 
+// Only returns a size if one has already been calculated, since calculating the size of a folder
+// can take a significant amount of time.
+std::optional<ULONGLONG> GetFolderSizeColumnCachedData(const BasicItemInfo_t &itemInfo,
+	const GlobalFolderSettings &globalFolderSettings)
+{
+	if (!globalFolderSettings.showFolderSizes)
+	{
+		return std::nullopt;
+	}
+
+	auto folderInfo = FolderSizeCache::GetInstance().GetCachedFolderInfo(itemInfo.getFullPath());
+
+	if (!folderInfo)
+	{
+		return std::nullopt;
+	}
+
+	return folderInfo->size;
+}
+
 std::wstring GetTimeColumnText(const BasicItemInfo_t &itemInfo, TimeType timeType,
 	const GlobalFolderSettings &globalFolderSettings)
 {
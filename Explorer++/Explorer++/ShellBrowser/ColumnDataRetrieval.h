@@ -5,6 +5,8 @@
 #pragma once
 
 #include "Columns.h"
+#include <optional>
+#include <stop_token>
 #include <string>
 
 struct BasicItemInfo_t;
@@ -64,7 +66,7 @@ enum class MediaMetadataType
 };
 
 std::wstring GetColumnText(ColumnType columnType, const BasicItemInfo_t &basicItemInfo,
-	const GlobalFolderSettings &globalFolderSettings);
+	const GlobalFolderSettings &globalFolderSettings, std::stop_token stopToken = {});
 std::wstring GetNameColumnText(const BasicItemInfo_t &itemInfo,
 	const GlobalFolderSettings &globalFolderSettings);
 std::wstring ProcessItemFileName(const BasicItemInfo_t &itemInfo,
@@ -103,6 +105,8 @@ std::wstring GetDriveSpaceColumnText(const BasicItemInfo_t &itemInfo, bool Total
 BOOL GetDriveSpaceColumnRawData(const BasicItemInfo_t &itemInfo, bool TotalSize,
 	ULARGE_INTEGER &DriveSpace);
 std::wstring GetSizeColumnText(const BasicItemInfo_t &itemInfo,
-	const GlobalFolderSettings &globalFolderSettings);
+	const GlobalFolderSettings &globalFolderSettings, std::stop_token stopToken = {});
 std::wstring GetFolderSizeColumnText(const BasicItemInfo_t &itemInfo,
+	const GlobalFolderSettings &globalFolderSettings, std::stop_token stopToken = {});
+std::optional<ULONGLONG> GetFolderSizeColumnCachedData(const BasicItemInfo_t &itemInfo,
 	const GlobalFolderSettings &globalFolderSettings);
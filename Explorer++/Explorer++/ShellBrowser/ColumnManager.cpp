@@ -13,23 +13,47 @@
 #include "SortModes.h"
 #include "ViewModes.h"
 #include <cassert>
+#include <future>
 #include <list>
+#include <memory>
 
-void ShellBrowser::QueueColumnTask(int itemInternalIndex, ColumnType columnType)
+void ShellBrowser::QueueColumnTask(int itemInternalIndex, int row, ColumnType columnType)
 {
 	int columnResultID = m_columnResultIDCounter++;
 
 	BasicItemInfo_t basicItemInfo = getBasicItemInfo(itemInternalIndex);
+	uint32_t itemGeneration = m_itemStore.GetGeneration(itemInternalIndex);
 	GlobalFolderSettings globalFolderSettings = m_config->globalFolderSettings;
 
-	auto result = m_columnThreadPool.push(
-		[listView = m_hListView, columnResultID, columnType, itemInternalIndex, basicItemInfo,
-			globalFolderSettings](int id)
+	auto promise = std::make_shared<std::promise<ColumnResult_t>>();
+	auto result = promise->get_future();
+
+	// If the task is dropped, the column text will simply be requested again when the item is next
+	// shown, since the text won't have been set. In owner data mode, the placeholder text stored
+	// for the item needs to be removed for that to happen.
+	m_itemTaskScheduler.QueueTask(
+		static_cast<int>(ItemTaskType::Column),
+		ViewportTaskScheduler::RowItem{ row, itemInternalIndex },
+		[listView = m_hListView, columnResultID, columnType, itemInternalIndex, itemGeneration,
+			basicItemInfo, globalFolderSettings, promise](std::stop_token stopToken)
 		{
-			UNREFERENCED_PARAMETER(id);
+			if (stopToken.stop_requested())
+			{
+				return;
+			}
 
-			return GetColumnTextAsync(listView, columnResultID, columnType, itemInternalIndex,
-				basicItemInfo, globalFolderSettings);
+			promise->set_value(GetColumnTextAsync(listView, columnResultID, columnType,
+				itemInternalIndex, itemGeneration, basicItemInfo, globalFolderSettings,
+				stopToken));
+		},
+		[this, columnResultID, itemInternalIndex, itemGeneration, columnType]()
+		{
+			m_columnResults.erase(columnResultID);
+
+			if (m_virtualListView)
+			{
+				OnVirtualColumnTaskDropped(itemInternalIndex, itemGeneration, columnType);
+			}
 		});
 
 	// The function call above might finish before this line runs,
@@ -40,18 +64,26 @@ void ShellBrowser::QueueColumnTask(int itemInternalIndex, ColumnType columnType)
 }
 
 ShellBrowser::ColumnResult_t ShellBrowser::GetColumnTextAsync(HWND listView, int columnResultId,
-	ColumnType columnType, int internalIndex, const BasicItemInfo_t &basicItemInfo,
-	const GlobalFolderSettings &globalFolderSettings)
+	ColumnType columnType, int internalIndex, uint32_t itemGeneration,
+	const BasicItemInfo_t &basicItemInfo, const GlobalFolderSettings &globalFolderSettings,
+	std::stop_token stopToken)
 {
-	std::wstring columnText = GetColumnText(columnType, basicItemInfo, globalFolderSettings);
+	std::wstring columnText =
+		GetColumnText(columnType, basicItemInfo, globalFolderSettings, stopToken);
 
-	// This message may be delivered before this function has returned.
-	// That doesn't actually matter, since the message handler will
-	// simply wait for the result to be returned.
-	PostMessage(listView, WM_APP_COLUMN_RESULT_READY, columnResultId, 0);
+	// If the task was cancelled, the text may be incomplete (e.g. if a folder size calculation was
+	// stopped partway through). The result is no longer wanted in that case anyway.
+	if (!stopToken.stop_requested())
+	{
+		// This message may be delivered before this function has returned.
+		// That doesn't actually matter, since the message handler will
+		// simply wait for the result to be returned.
+		PostMessage(listView, WM_APP_COLUMN_RESULT_READY, columnResultId, 0);
+	}
 
 	ColumnResult_t result;
 	result.itemInternalIndex = internalIndex;
+	result.itemGeneration = itemGeneration;
 	result.columnType = columnType;
 	result.columnText = columnText;
 
@@ -75,11 +107,16 @@ void ShellBrowser::ProcessColumnResult(int columnResultId)
 
 	auto result = itr->second.get();
 
+	if (!m_itemStore.Contains(result.itemInternalIndex, result.itemGeneration))
+	{
+		// This is a valid state. The item may simply have been deleted.
+		return;
+	}
+
 	auto index = LocateItemByInternalIndex(result.itemInternalIndex);
 
 	if (!index)
 	{
-		// This is a valid state. The item may simply have been deleted.
 		return;
 	}
 
@@ -91,6 +128,16 @@ void ShellBrowser::ProcessColumnResult(int columnResultId)
 		return;
 	}
 
+	if (m_virtualListView)
+	{
+		m_directoryState.virtualItemData[result.itemInternalIndex].columnText[result.columnType] =
+			result.columnText;
+		ListView_RedrawItems(m_hListView, *index, *index);
+
+		m_columnResults.erase(itr);
+		return;
+	}
+
 	auto columnText = std::make_unique<TCHAR[]>(result.columnText.size() + 1);
 	StringCchCopy(columnText.get(), result.columnText.size() + 1, result.columnText.c_str());
 	ListView_SetItemText(m_hListView, *index, *columnIndex, columnText.get());
@@ -12,7 +12,8 @@
 #include "../Helper/Logging.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
-#include <list>
+#include "../Helper/iDirectoryMonitor.h"
+#include <algorithm>
 
 void ShellBrowser::StartDirectoryMonitoring(PCIDLIST_ABSOLUTE pidl)
 {
@@ -62,85 +63,189 @@ void ShellBrowser::OnShellNotify(WPARAM wParam, LPARAM lParam)
 	HANDLE lock = SHChangeNotification_Lock(reinterpret_cast<HANDLE>(wParam),
 		static_cast<DWORD>(lParam), &pidls, &event);
 
-	m_directoryState.shellChangeNotifications.emplace_back(event, pidls[0], pidls[1]);
+	bool changesPending = m_shellChangeCoalescer.HasPendingChanges();
 
-	SHChangeNotification_Unlock(lock);
-
-	SetTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID, PROCESS_SHELL_CHANGES_TIMEOUT, nullptr);
-}
+	QueueShellChangeNotification(event, pidls[0], pidls[1]);
 
-void ShellBrowser::OnProcessShellChangeNotifications()
-{
-	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+	SHChangeNotification_Unlock(lock);
 
-	for (const auto &change : m_directoryState.shellChangeNotifications)
+	// The timer is only started when the first change in a batch arrives. Restarting it for each
+	// notification would mean that changes would never be shown while there was continuous activity
+	// in the directory.
+	if (!changesPending && m_shellChangeCoalescer.HasPendingChanges())
 	{
-		ProcessShellChangeNotification(change);
+		SetTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID,
+			m_shellChangeCoalescer.GetBatchWindow(), nullptr);
 	}
-
-	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
-
-	m_directoryState.shellChangeNotifications.clear();
-
-	KillTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID);
-
-	directoryModified.m_signal();
 }
 
-void ShellBrowser::ProcessShellChangeNotification(const ShellChangeNotification &change)
+void ShellBrowser::QueueShellChangeNotification(LONG event, PCIDLIST_ABSOLUTE pidl1,
+	PCIDLIST_ABSOLUTE pidl2)
 {
-	switch (change.event)
+	// Only the current directory is monitored, so notifications should only arrive for items in
+	// that directory. However, if the user has just changed directories, a notification could still
+	// come in for the previous directory. Therefore, it's important to verify that the item is
+	// actually a child of the current directory.
+	switch (event)
 	{
 	case SHCNE_MKDIR:
 	case SHCNE_CREATE:
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
+		if (ILIsParent(m_directoryState.pidlDirectory.get(), pidl1, TRUE))
 		{
-			OnItemAdded(change.pidl1.get());
+			std::wstring key = GetShellChangeKey(pidl1);
+
+			// A creation notification may be sent for an item that's already shown (e.g. when a
+			// file is overwritten). Treating that as an update means that a subsequent deletion
+			// won't be cancelled out against the creation, which would leave the deleted item in
+			// place.
+			if (!m_shellChangeCoalescer.HasPendingChangeForItem(key)
+				&& m_directoryState.parsingNameIndex.contains(key))
+			{
+				m_shellChangeCoalescer.AddItemUpdated(key, pidl1);
+			}
+			else
+			{
+				m_shellChangeCoalescer.AddItemAdded(key, pidl1);
+			}
 		}
 		break;
 
 	case SHCNE_RENAMEFOLDER:
 	case SHCNE_RENAMEITEM:
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE)
-			&& ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl2.get(), TRUE))
+		if (ILIsParent(m_directoryState.pidlDirectory.get(), pidl1, TRUE)
+			&& ILIsParent(m_directoryState.pidlDirectory.get(), pidl2, TRUE))
 		{
-			OnItemRenamed(change.pidl1.get(), change.pidl2.get());
+			m_shellChangeCoalescer.AddItemRenamed(GetShellChangeKey(pidl1), pidl1,
+				GetShellChangeKey(pidl2), pidl2);
 		}
 		break;
 
 	case SHCNE_UPDATEITEM:
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
+		if (ILIsParent(m_directoryState.pidlDirectory.get(), pidl1, TRUE))
 		{
-			OnItemModified(change.pidl1.get());
+			m_shellChangeCoalescer.AddItemUpdated(GetShellChangeKey(pidl1), pidl1);
 		}
 		break;
 
 	case SHCNE_UPDATEDIR:
-		if (ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), change.pidl1.get()))
+		if (ArePidlsEquivalent(m_directoryState.pidlDirectory.get(), pidl1))
 		{
-			m_navigationController->Refresh();
+			m_shellChangeCoalescer.AddDirectoryUpdated();
 		}
 		break;
 
 	case SHCNE_RMDIR:
 	case SHCNE_DELETE:
-		// Only the current directory is monitored, so notifications should only arrive for items in
-		// that directory. However, if the user has just changed directories, a notification could
-		// still come in for the previous directory. Therefore, it's important to verify that the
-		// item is actually a child of the current directory.
-		if (ILIsParent(m_directoryState.pidlDirectory.get(), change.pidl1.get(), TRUE))
+		if (ILIsParent(m_directoryState.pidlDirectory.get(), pidl1, TRUE))
 		{
-			OnItemRemoved(change.pidl1.get());
+			m_shellChangeCoalescer.AddItemRemoved(GetShellChangeKey(pidl1), pidl1);
 		}
 		break;
 	}
 }
 
+// Items are identified by their parsing name, since the pidls passed in notifications for the same
+// item won't necessarily be identical. The key is normalized in the same way as the keys in the
+// parsing name index, so that the two can be compared directly.
+std::wstring ShellBrowser::GetShellChangeKey(PCIDLIST_ABSOLUTE pidl) const
+{
+	std::wstring parsingName;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, parsingName);
+
+	if (SUCCEEDED(hr))
+	{
+		return GetParsingNameIndexKey(parsingName);
+	}
+
+	// Parsing names never contain a null character, so this key can't collide with one of the keys
+	// above.
+	std::string pidlKey = GetChildPidlIndexKey(ILFindLastID(pidl));
+	std::wstring key(1, '\0');
+	key.append(pidlKey.begin(), pidlKey.end());
+
+	return key;
+}
+
+void ShellBrowser::OnProcessShellChangeNotifications()
+{
+	KillTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID);
+
+	auto changes = m_shellChangeCoalescer.TakeChanges(MAX_SHELL_CHANGES_PER_TICK);
+
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+	BeginVirtualSelectionUpdate();
+
+	for (const auto &change : changes)
+	{
+		ProcessShellChange(change);
+	}
+
+	EndVirtualSelectionUpdate();
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+
+	if (m_shellChangeCoalescer.HasPendingChanges())
+	{
+		SetTimer(m_hListView, PROCESS_SHELL_CHANGES_TIMER_ID,
+			PROCESS_SHELL_CHANGES_CONTINUATION_TIMEOUT, nullptr);
+	}
+
+	const auto &stats = m_shellChangeCoalescer.GetStats();
+	LOG(debug) << L"Applied " << changes.size() << L" shell change(s) (" << stats.appliedChanges
+			   << L" applied from " << stats.rawEvents << L" notifications in total)";
+
+	directoryModified.m_signal();
+}
+
+void ShellBrowser::ProcessShellChange(const ShellChangeCoalescer::Change &change)
+{
+	switch (change.type)
+	{
+	case ShellChangeCoalescer::ChangeType::Added:
+		OnItemAdded(change.pidl1.get());
+		break;
+
+	case ShellChangeCoalescer::ChangeType::Removed:
+		OnItemRemoved(change.pidl1.get());
+		break;
+
+	case ShellChangeCoalescer::ChangeType::Updated:
+		OnItemModified(change.pidl1.get());
+		break;
+
+	case ShellChangeCoalescer::ChangeType::Renamed:
+		OnItemRenamed(change.pidl1.get(), change.pidl2.get());
+		break;
+
+	case ShellChangeCoalescer::ChangeType::DirectoryUpdated:
+		m_navigationController->Refresh();
+		break;
+	}
+}
+
 void ShellBrowser::DirectoryAltered()
 {
 	EnterCriticalSection(&m_csDirectoryAltered);
 
+	// If some of the changes were lost, the folder is simply reloaded, at which point none of the
+	// individual changes need to be processed.
+	bool resyncRequired = std::any_of(m_AlteredList.begin(), m_AlteredList.end(),
+		[this](const AlteredFile_t &af)
+		{
+			return af.dwAction == DIRECTORY_MONITOR_ACTION_RESYNC
+				&& af.iFolderIndex == m_uniqueFolderId;
+		});
+
+	if (resyncRequired)
+	{
+		m_AlteredList.clear();
+		LeaveCriticalSection(&m_csDirectoryAltered);
+
+		m_navigationController->Refresh();
+		return;
+	}
+
 	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
+	BeginVirtualSelectionUpdate();
 
 	// Note that directory change notifications are received asynchronously. That means that, in
 	// each of the cases below, it's not reasonable to assume that the file being referenced
@@ -166,7 +271,7 @@ void ShellBrowser::DirectoryAltered()
 		}
 
 		unique_pidl_absolute simplePidl;
-		hr = CreateSimplePidl(af.szFileName, wil::out_param(simplePidl), parent.get());
+		hr = CreateSimplePidl(af.fileName, wil::out_param(simplePidl), parent.get());
 
 		if (FAILED(hr))
 		{
@@ -200,6 +305,7 @@ void ShellBrowser::DirectoryAltered()
 		}
 	}
 
+	EndVirtualSelectionUpdate();
 	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
 
 	/* Ensure the first dropped item is visible. */
@@ -260,26 +366,24 @@ void CALLBACK TimerProc(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime)
 	SendMessage(hwnd, WM_USER_FILESADDED, idEvent, 0);
 }
 
-void ShellBrowser::FilesModified(DWORD Action, const TCHAR *FileName, int EventId, int iFolderIndex)
+void ShellBrowser::FilesModified(const std::vector<DirectoryChange> &changes, int EventId,
+	int iFolderIndex)
 {
 	EnterCriticalSection(&m_csDirectoryAltered);
 
 	SetTimer(m_hOwner, EventId, 200, TimerProc);
 
-	AlteredFile_t af;
-
-	StringCchCopy(af.szFileName, SIZEOF_ARRAY(af.szFileName), FileName);
-	af.dwAction = Action;
-	af.iFolderIndex = iFolderIndex;
-
-	m_AlteredList.push_back(af);
+	for (const auto &change : changes)
+	{
+		m_AlteredList.push_back({ change.fileName, change.action, iFolderIndex });
+	}
 
 	LeaveCriticalSection(&m_csDirectoryAltered);
 }
 
 void ShellBrowser::OnItemAdded(PCIDLIST_ABSOLUTE simplePidl)
 {
-	auto existingItemInternalIndex = GetItemInternalIndexForPidl(simplePidl);
+	auto existingItemInternalIndex = GetItemInternalIndexForSimplePidl(simplePidl);
 
 	// When adding an item, it makes no sense to add it if it already exists. If the item does
 	// exist, it's an indication of a programming error. That is, it's not expected that this would
@@ -335,7 +439,7 @@ void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl)
 		return;
 	}
 
-	const std::wstring displayName = m_itemInfoMap.at(*itemId).displayName;
+	const std::wstring displayName(m_itemStore.GetDisplayName(*itemId));
 	auto droppedFilesItr = std::find_if(m_droppedFileNameList.begin(), m_droppedFileNameList.end(),
 		[&displayName](const DroppedFile_t &droppedFile)
 		{
@@ -372,7 +476,7 @@ void ShellBrowser::AddItem(PCIDLIST_ABSOLUTE pidl)
 
 void ShellBrowser::OnItemRemoved(PCIDLIST_ABSOLUTE simplePidl)
 {
-	auto internalIndex = GetItemInternalIndexForPidl(simplePidl);
+	auto internalIndex = GetItemInternalIndexForSimplePidl(simplePidl);
 
 	if (internalIndex)
 	{
@@ -407,14 +511,14 @@ void ShellBrowser::OnItemModified(PCIDLIST_ABSOLUTE simplePidl)
 // better than having two very similar methods.
 void ShellBrowser::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedPidl)
 {
-	auto internalIndex = GetItemInternalIndexForPidl(pidl);
+	auto internalIndex = GetItemInternalIndexForSimplePidl(pidl);
 
 	if (!internalIndex)
 	{
 		// When the user renames an item in the listview, the item details will be updated
 		// immediately. That means that when the rename notification is received, the old item will
 		// no longer exist and won't be found. In that case, though, the new item should exist.
-		assert(!updatedPidl || GetItemInternalIndexForPidl(updatedPidl));
+		assert(!updatedPidl || GetItemInternalIndexForSimplePidl(updatedPidl));
 		return;
 	}
 
@@ -442,21 +546,22 @@ void ShellBrowser::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedP
 		return;
 	}
 
-	ULARGE_INTEGER oldFileSize = { m_itemInfoMap[*internalIndex].wfd.nFileSizeLow,
-		m_itemInfoMap[*internalIndex].wfd.nFileSizeHigh };
+	ULARGE_INTEGER oldFileSize;
+	oldFileSize.QuadPart = m_itemStore.GetFileSize(*internalIndex);
 	ULARGE_INTEGER newFileSize = { itemInfo->wfd.nFileSizeLow, itemInfo->wfd.nFileSizeHigh };
 
 	m_directoryState.totalDirSize.QuadPart += newFileSize.QuadPart - oldFileSize.QuadPart;
 
-	m_itemInfoMap[*internalIndex] = std::move(*itemInfo);
-	const ItemInfo_t &updatedItemInfo = m_itemInfoMap[*internalIndex];
+	RemoveItemFromIndexes(*internalIndex);
+	m_itemStore.Replace(*internalIndex, std::move(*itemInfo));
+	AddItemToIndexes(*internalIndex);
 
 	auto itemIndex = LocateItemByInternalIndex(*internalIndex);
 
 	// Items may be filtered out of the listview, so it's valid for an item not to be found.
 	if (!itemIndex)
 	{
-		if (!IsFileFiltered(updatedItemInfo))
+		if (!IsFileFiltered(*internalIndex))
 		{
 			UnfilterItem(*internalIndex);
 		}
@@ -471,7 +576,7 @@ void ShellBrowser::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedP
 		m_directoryState.fileSelectionSize.QuadPart += newFileSize.QuadPart - oldFileSize.QuadPart;
 	}
 
-	if (IsFileFiltered(updatedItemInfo))
+	if (IsFileFiltered(*internalIndex))
 	{
 		RemoveFilteredItem(*itemIndex, *internalIndex);
 		return;
@@ -479,7 +584,7 @@ void ShellBrowser::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedP
 
 	InvalidateIconForItem(*itemIndex);
 
-	if (m_folderSettings.viewMode == +ViewMode::Details)
+	if (m_folderSettings.viewMode == +ViewMode::Details || m_virtualListView)
 	{
 		InvalidateAllColumnsForItem(*itemIndex);
 	}
@@ -490,23 +595,31 @@ void ShellBrowser::UpdateItem(PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE updatedP
 		ListView_SetItemText(m_hListView, *itemIndex, 0, filename.data());
 	}
 
-	if (WI_IsFlagSet(updatedItemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN))
+	// In owner data mode, the hidden state is determined each time the item is drawn.
+	if (!m_virtualListView)
 	{
-		ListView_SetItemState(m_hListView, *itemIndex, LVIS_CUT, LVIS_CUT);
-	}
-	else
-	{
-		ListView_SetItemState(m_hListView, *itemIndex, 0, LVIS_CUT);
+		bool hidden =
+			WI_IsFlagSet(m_itemStore.GetAttributes(*internalIndex), FILE_ATTRIBUTE_HIDDEN);
+		ListView_SetItemState(m_hListView, *itemIndex, hidden ? LVIS_CUT : 0, LVIS_CUT);
 	}
 
 	if (m_folderSettings.showInGroups)
 	{
-		int groupId = DetermineItemGroup(*internalIndex);
-		InsertItemIntoGroup(*itemIndex, groupId);
+		UpdateItemGroup(*itemIndex, *internalIndex);
 	}
 
 	// It's not safe to use itemIndex past this point.
-	ListView_SortItems(m_hListView, SortStub, this);
+	if (m_virtualListView)
+	{
+		RepositionVirtualItem(*internalIndex);
+	}
+	else
+	{
+		ListView_SortItems(m_hListView, SortStub, this);
+	}
+
+	m_itemTaskScheduler.InvalidateRows();
+
 	itemIndex.reset();
 }
 
@@ -544,6 +657,12 @@ void ShellBrowser::OnItemRenamed(PCIDLIST_ABSOLUTE simplePidlOld, PCIDLIST_ABSOL
 
 void ShellBrowser::InvalidateAllColumnsForItem(int itemIndex)
 {
+	if (m_virtualListView)
+	{
+		InvalidateVirtualItemText(itemIndex);
+		return;
+	}
+
 	if (m_folderSettings.viewMode != +ViewMode::Details)
 	{
 		return;
@@ -563,10 +682,5 @@ void ShellBrowser::InvalidateAllColumnsForItem(int itemIndex)
 
 void ShellBrowser::InvalidateIconForItem(int itemIndex)
 {
-	LVITEM lvItem;
-	lvItem.mask = LVIF_IMAGE;
-	lvItem.iItem = itemIndex;
-	lvItem.iSubItem = 0;
-	lvItem.iImage = I_IMAGECALLBACK;
-	ListView_SetItem(m_hListView, &lvItem);
+	SetItemImage(itemIndex, I_IMAGECALLBACK);
 }
@@ -0,0 +1,78 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FilterMatchSet.h"
+#include "../Helper/StringHelper.h"
+
+void FilterMatchSet::Add(int internalIndex)
+{
+	size_t wordIndex = internalIndex / BITS_PER_WORD;
+	uint64_t bit = uint64_t{ 1 } << (internalIndex % BITS_PER_WORD);
+
+	if (wordIndex >= m_words.size())
+	{
+		m_words.resize(wordIndex + 1, 0);
+	}
+
+	if ((m_words[wordIndex] & bit) == 0)
+	{
+		m_words[wordIndex] |= bit;
+		m_count++;
+	}
+}
+
+void FilterMatchSet::Remove(int internalIndex)
+{
+	size_t wordIndex = internalIndex / BITS_PER_WORD;
+	uint64_t bit = uint64_t{ 1 } << (internalIndex % BITS_PER_WORD);
+
+	if (wordIndex < m_words.size() && (m_words[wordIndex] & bit) != 0)
+	{
+		m_words[wordIndex] &= ~bit;
+		m_count--;
+	}
+}
+
+bool FilterMatchSet::Contains(int internalIndex) const
+{
+	size_t wordIndex = internalIndex / BITS_PER_WORD;
+
+	if (internalIndex < 0 || wordIndex >= m_words.size())
+	{
+		return false;
+	}
+
+	return (m_words[wordIndex] & (uint64_t{ 1 } << (internalIndex % BITS_PER_WORD))) != 0;
+}
+
+size_t FilterMatchSet::GetCount() const
+{
+	return m_count;
+}
+
+std::optional<FilterEvaluationResult> EvaluateFilter(const std::vector<FilterItem> &items,
+	const WildcardPattern &pattern, std::stop_token stopToken)
+{
+	FilterEvaluationResult result;
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		if (i % FILTER_STOP_CHECK_INTERVAL == 0 && stopToken.stop_requested())
+		{
+			return std::nullopt;
+		}
+
+		const auto &item = items[i];
+
+		result.evaluated.Add(item.internalIndex);
+
+		if (pattern.Matches(item.name))
+		{
+			result.matches.Add(item.internalIndex);
+		}
+	}
+
+	return result;
+}
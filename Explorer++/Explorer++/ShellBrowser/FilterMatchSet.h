@@ -0,0 +1,56 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+class WildcardPattern;
+
+// A set of items, stored as a bitmap indexed by internal index. Internal indexes are slots that are
+// reused once an item is removed, so the bitmap stays compact, even for folders containing a very
+// large number of items. This is used to record which items match the current filter, so that the
+// visible items can be updated in a single pass once the filter has been evaluated.
+class FilterMatchSet
+{
+public:
+	void Add(int internalIndex);
+	void Remove(int internalIndex);
+	bool Contains(int internalIndex) const;
+	size_t GetCount() const;
+
+private:
+	static const size_t BITS_PER_WORD = 64;
+
+	std::vector<uint64_t> m_words;
+	size_t m_count = 0;
+};
+
+struct FilterItem
+{
+	int internalIndex;
+	std::wstring name;
+};
+
+struct FilterEvaluationResult
+{
+	// The items that were tested against the pattern.
+	FilterMatchSet evaluated;
+
+	// The subset of the evaluated items that matched the pattern.
+	FilterMatchSet matches;
+};
+
+// The number of items that are tested between checks of the stop token.
+const size_t FILTER_STOP_CHECK_INTERVAL = 1024;
+
+// Tests each of the items against the pattern. This is designed to be run on a background thread,
+// with the stop token being used to abandon the evaluation (e.g. because the filter has changed
+// again). Nothing is returned in that case.
+std::optional<FilterEvaluationResult> EvaluateFilter(const std::vector<FilterItem> &items,
+	const WildcardPattern &pattern, std::stop_token stopToken);
@@ -6,6 +6,11 @@
 #include "ShellBrowser.h"
 #include "MainResource.h"
 #include "../Helper/ListViewHelper.h"
+#include "../Helper/Logging.h"
+#include <wil/common.h>
+#include <algorithm>
+#include <future>
+#include <memory>
 
 std::wstring ShellBrowser::GetFilter() const
 {
@@ -15,11 +20,11 @@ std::wstring ShellBrowser::GetFilter() const
 void ShellBrowser::SetFilter(std::wstring_view filter)
 {
 	m_folderSettings.filter = filter;
+	UpdateFilterPattern();
 
 	if (m_folderSettings.applyFilter)
 	{
-		UnfilterAllItems();
-		UpdateFiltering();
+		QueueFilterEvaluation();
 	}
 }
 
@@ -38,6 +43,7 @@ BOOL ShellBrowser::GetFilterStatus() const
 void ShellBrowser::SetFilterCaseSensitive(BOOL filterCaseSensitive)
 {
 	m_folderSettings.filterCaseSensitive = filterCaseSensitive;
+	UpdateFilterPattern();
 }
 
 BOOL ShellBrowser::GetFilterCaseSensitive() const
@@ -45,16 +51,29 @@ BOOL ShellBrowser::GetFilterCaseSensitive() const
 	return m_folderSettings.filterCaseSensitive;
 }
 
+void ShellBrowser::UpdateFilterPattern()
+{
+	m_filterPattern =
+		WildcardPattern(m_folderSettings.filter, m_folderSettings.filterCaseSensitive);
+
+	// Any items hidden from this point on will be hidden because they don't match the new pattern.
+	m_filterPatternHistory.push_back(m_filterPattern);
+
+	// Any evaluation that's in progress is for the previous pattern and is no longer needed.
+	CancelFilterEvaluation();
+}
+
 void ShellBrowser::UpdateFiltering()
 {
 	if (m_folderSettings.applyFilter)
 	{
-		RemoveFilteredItems();
+		QueueFilterEvaluation();
 
 		ApplyFilteringBackgroundImage(true);
 	}
 	else
 	{
+		CancelFilterEvaluation();
 		UnfilterAllItems();
 
 		if (m_directoryState.numItems == 0)
@@ -68,55 +87,244 @@ void ShellBrowser::UpdateFiltering()
 	}
 }
 
-void ShellBrowser::RemoveFilteredItems()
+// Evaluating a filter against a large folder can take a noticeable amount of time, so the
+// evaluation is performed in the background. Each change to the filter (e.g. each character typed)
+// cancels the previous evaluation.
+void ShellBrowser::QueueFilterEvaluation()
+{
+	CancelFilterEvaluation();
+
+	// Every item that's currently hidden by the filter is known not to match at least one of the
+	// patterns in the history. If the new pattern is a refinement of all of those patterns (which
+	// will typically be the case when characters are typed into a filter), the hidden items can't
+	// match the new pattern either. Only the items that are currently visible need to be tested in
+	// that case.
+	bool refinement = std::all_of(m_filterPatternHistory.begin(), m_filterPatternHistory.end(),
+		[this](const WildcardPattern &pattern)
+		{
+			return m_filterPattern.IsRefinementOf(pattern);
+		});
+
+	auto items = std::make_shared<std::vector<FilterItem>>();
+	std::vector<std::pair<int, uint32_t>> itemGenerations;
+
+	auto addItem = [this, &items, &itemGenerations](int internalIndex)
+	{
+		// Folders are never filtered.
+		if (WI_IsFlagSet(m_itemStore.GetAttributes(internalIndex), FILE_ATTRIBUTE_DIRECTORY))
+		{
+			return;
+		}
+
+		std::wstring name(m_itemStore.GetDisplayName(internalIndex));
+		items->push_back({ internalIndex, std::move(name) });
+		itemGenerations.emplace_back(internalIndex, m_itemStore.GetGeneration(internalIndex));
+	};
+
+	int numItems = ListView_GetItemCount(m_hListView);
+	items->reserve(numItems);
+	itemGenerations.reserve(numItems);
+
+	for (int i = 0; i < numItems; i++)
+	{
+		addItem(GetItemInternalIndex(i));
+	}
+
+	if (!refinement)
+	{
+		for (int internalIndex : m_directoryState.filteredItemsList)
+		{
+			addItem(internalIndex);
+		}
+	}
+
+	int filterResultId = m_filterResultIdCounter++;
+
+	auto promise = std::make_shared<std::promise<FilterResult>>();
+	auto result = promise->get_future();
+
+	m_itemTaskScheduler.QueueTask(static_cast<int>(ItemTaskType::Filter), std::nullopt,
+		[listView = m_hListView, filterResultId, items, pattern = m_filterPattern, refinement,
+			itemGenerations = std::move(itemGenerations),
+			promise](std::stop_token stopToken) mutable
+		{
+			auto evaluation = EvaluateFilter(*items, pattern, stopToken);
+
+			if (!evaluation)
+			{
+				return;
+			}
+
+			promise->set_value({ std::move(*evaluation), refinement, std::move(itemGenerations) });
+
+			PostMessage(listView, WM_APP_FILTER_RESULT_READY, filterResultId, 0);
+		});
+
+	m_filterResults.insert({ filterResultId, std::move(result) });
+}
+
+void ShellBrowser::CancelFilterEvaluation()
+{
+	m_itemTaskScheduler.Cancel(static_cast<int>(ItemTaskType::Filter));
+	m_filterResults.clear();
+}
+
+void ShellBrowser::ProcessFilterResult(int filterResultId)
 {
+	auto itr = m_filterResults.find(filterResultId);
+
+	if (itr == m_filterResults.end())
+	{
+		// The filter has changed since this evaluation was started.
+		return;
+	}
+
+	auto result = itr->second.get();
+	m_filterResults.erase(itr);
+
 	if (!m_folderSettings.applyFilter)
 	{
 		return;
 	}
 
-	int nItems = ListView_GetItemCount(m_hListView);
+	// An item that was tested may have been removed since, with its slot then being reused by a
+	// new item. The new item will have already been checked against the filter when it was added,
+	// so the result for the old item mustn't be applied to it.
+	for (const auto &[internalIndex, itemGeneration] : result.itemGenerations)
+	{
+		if (!m_itemStore.Contains(internalIndex, itemGeneration))
+		{
+			result.evaluation.evaluated.Remove(internalIndex);
+			result.evaluation.matches.Remove(internalIndex);
+		}
+	}
+
+	// The changes are all applied together, so that the listview is only redrawn once.
+	SendMessage(m_hListView, WM_SETREDRAW, FALSE, NULL);
 
-	for (int i = nItems - 1; i >= 0; i--)
+	size_t numHidden = HideUnmatchedItems(result.evaluation);
+	size_t numRestored = 0;
+
+	if (!result.refinement)
 	{
-		int internalIndex = GetItemInternalIndex(i);
+		numRestored = RestoreFilteredItems(
+			[&matches = result.evaluation.matches](int internalIndex)
+			{
+				return matches.Contains(internalIndex);
+			});
+	}
 
-		if (!((m_itemInfoMap.at(internalIndex).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-				== FILE_ATTRIBUTE_DIRECTORY))
+	SendMessage(m_hListView, WM_SETREDRAW, TRUE, NULL);
+
+	// Every item that's now hidden by the filter is known not to match the current pattern.
+	m_filterPatternHistory = { m_filterPattern };
+
+	LOG(debug) << L"Filter evaluated against " << result.evaluation.evaluated.GetCount()
+			   << L" items (" << (result.refinement ? L"refinement" : L"full") << L"), "
+			   << numHidden << L" hidden, " << numRestored << L" restored";
+
+	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+}
+
+// Removes each item that was evaluated, but didn't match the filter. Items that weren't part of
+// the evaluation (e.g. because they were added after it started) will have already been checked
+// against the current filter when they were added.
+size_t ShellBrowser::HideUnmatchedItems(const FilterEvaluationResult &evaluation)
+{
+	auto shouldHide = [&evaluation](int internalIndex)
+	{
+		return evaluation.evaluated.Contains(internalIndex)
+			&& !evaluation.matches.Contains(internalIndex);
+	};
+
+	size_t numHidden = 0;
+
+	if (m_virtualListView)
+	{
+		// In owner data mode, the remaining items can be swapped in as a single operation, rather
+		// than removing each hidden item individually.
+		const auto &items = m_directoryState.virtualItems.GetItems();
+		std::vector<int> remainingItems;
+		remainingItems.reserve(items.size());
+
+		for (int i = 0; i < static_cast<int>(items.size()); i++)
 		{
-			if (IsFilenameFiltered(m_itemInfoMap.at(internalIndex).displayName.c_str()))
+			int internalIndex = items[i];
+
+			if (shouldHide(internalIndex))
+			{
+				OnItemFiltered(i, internalIndex);
+				m_directoryState.virtualItemData.erase(internalIndex);
+				numHidden++;
+			}
+			else
 			{
-				RemoveFilteredItem(i, internalIndex);
+				remainingItems.push_back(internalIndex);
 			}
 		}
+
+		if (numHidden > 0)
+		{
+			SetVirtualItemOrder(std::move(remainingItems));
+		}
+
+		return numHidden;
 	}
 
-	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+	for (int i = ListView_GetItemCount(m_hListView) - 1; i >= 0; i--)
+	{
+		int internalIndex = GetItemInternalIndex(i);
+
+		if (shouldHide(internalIndex))
+		{
+			RemoveFilteredItem(i, internalIndex);
+			numHidden++;
+		}
+	}
+
+	return numHidden;
 }
 
 void ShellBrowser::RemoveFilteredItem(int iItem, int iItemInternal)
 {
-	ULARGE_INTEGER ulFileSize;
+	OnItemFiltered(iItem, iItemInternal);
 
-	const auto &item = m_itemInfoMap.at(iItemInternal);
+	/* Remove the item from the m_hListView. */
+	if (m_virtualListView)
+	{
+		RemoveVirtualItem(iItemInternal);
+	}
+	else
+	{
+		if (m_folderSettings.showInGroups)
+		{
+			auto groupId = GetItemGroupId(iItem);
+
+			if (groupId)
+			{
+				OnItemRemovedFromGroup(*groupId);
+			}
+		}
+
+		ListView_DeleteItem(m_hListView, iItem);
+	}
+
+	m_itemTaskScheduler.InvalidateRows();
+}
+
+// Updates the folder state for an item that's about to be hidden by the filter.
+void ShellBrowser::OnItemFiltered(int iItem, int iItemInternal)
+{
+	ULONGLONG fileSize = m_itemStore.GetFileSize(iItemInternal);
 
 	if (ListView_GetItemState(m_hListView, iItem, LVIS_SELECTED) == LVIS_SELECTED)
 	{
-		ulFileSize.LowPart = item.wfd.nFileSizeLow;
-		ulFileSize.HighPart = item.wfd.nFileSizeHigh;
-
-		m_directoryState.fileSelectionSize.QuadPart -= ulFileSize.QuadPart;
+		m_directoryState.fileSelectionSize.QuadPart -= fileSize;
 	}
 
 	/* Take the file size of the removed file away from the total
 	directory size. */
-	ulFileSize.LowPart = item.wfd.nFileSizeLow;
-	ulFileSize.HighPart = item.wfd.nFileSizeHigh;
-
-	m_directoryState.totalDirSize.QuadPart -= ulFileSize.QuadPart;
-
-	/* Remove the item from the m_hListView. */
-	ListView_DeleteItem(m_hListView, iItem);
+	m_directoryState.totalDirSize.QuadPart -= fileSize;
 
 	m_directoryState.numItems--;
 
@@ -126,8 +334,7 @@ void ShellBrowser::RemoveFilteredItem(int iItem, int iItemInternal)
 
 BOOL ShellBrowser::IsFilenameFiltered(const TCHAR *FileName) const
 {
-	if (CheckWildcardMatch(m_folderSettings.filter.c_str(), FileName,
-			m_folderSettings.filterCaseSensitive))
+	if (m_filterPattern.Matches(FileName))
 	{
 		return FALSE;
 	}
@@ -137,13 +344,58 @@ BOOL ShellBrowser::IsFilenameFiltered(const TCHAR *FileName) const
 
 void ShellBrowser::UnfilterAllItems()
 {
-	for (int internalIndex : m_directoryState.filteredItemsList)
+	RestoreFilteredItems(
+		[](int)
+		{
+			return true;
+		});
+
+	// None of the items are hidden by the filter at this point.
+	m_filterPatternHistory.clear();
+
+	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+}
+
+// Restores the filtered items for which the predicate returns true. The items are all appended to
+// the listview in a single batch and the folder is then sorted once, rather than each item being
+// inserted into its sorted position individually.
+size_t ShellBrowser::RestoreFilteredItems(std::function<bool(int internalIndex)> predicate)
+{
+	int numItems = ListView_GetItemCount(m_hListView);
+	size_t numRestored = 0;
+
+	for (auto itr = m_directoryState.filteredItemsList.begin();
+		 itr != m_directoryState.filteredItemsList.end();)
+	{
+		if (!predicate(*itr))
+		{
+			++itr;
+			continue;
+		}
+
+		AwaitingAdd_t awaitingAdd;
+		awaitingAdd.iItem = numItems++;
+		awaitingAdd.bPosition = FALSE;
+		awaitingAdd.iAfter = -1;
+		awaitingAdd.iItemInternal = *itr;
+		m_directoryState.awaitingAddList.push_back(awaitingAdd);
+
+		itr = m_directoryState.filteredItemsList.erase(itr);
+		numRestored++;
+	}
+
+	if (numRestored == 0)
 	{
-		RestoreFilteredItem(internalIndex);
+		return 0;
 	}
 
-	m_directoryState.filteredItemsList.clear();
-	SendMessage(m_hOwner, WM_USER_UPDATEWINDOWS, 0, 0);
+	// Items that are still hidden for some other reason (e.g. because they're system files) will
+	// be added back to the list of filtered items here.
+	InsertAwaitingItems(m_folderSettings.showInGroups);
+
+	SortFolder(m_folderSettings.sortMode);
+
+	return numRestored;
 }
 
 void ShellBrowser::UnfilterItem(int internalIndex)
@@ -20,6 +20,8 @@
 #include <iphlpapi.h>
 #include <propkey.h>
 #include <cassert>
+#include <future>
+#include <memory>
 
 namespace
 {
@@ -37,16 +39,18 @@ BOOL ShellBrowser::GetShowInGroups() const
 items into groups. */
 void ShellBrowser::SetShowInGroupsFlag(BOOL bShowInGroups)
 {
-	m_folderSettings.showInGroups = bShowInGroups;
+	// Groups aren't supported in owner data mode.
+	m_folderSettings.showInGroups = bShowInGroups && !m_virtualListView;
 }
 
 void ShellBrowser::SetShowInGroups(BOOL bShowInGroups)
 {
-	m_folderSettings.showInGroups = bShowInGroups;
+	m_folderSettings.showInGroups = bShowInGroups && !m_virtualListView;
 
 	if (!m_folderSettings.showInGroups)
 	{
 		ListView_EnableGroupView(m_hListView, FALSE);
+		m_listViewGroupsSortMode.reset();
 		SortFolder(m_folderSettings.sortMode);
 		return;
 	}
@@ -144,10 +148,42 @@ const ShellBrowser::ListViewGroup ShellBrowser::GetListViewGroupById(int groupId
 
 int ShellBrowser::DetermineItemGroup(int iItemInternal)
 {
-	BasicItemInfo_t basicItemInfo = getBasicItemInfo(iItemInternal);
+	ValidateGroupInfoCache();
+
+	auto itr = m_directoryState.groupInfoCache.find(iItemInternal);
+
+	if (itr != m_directoryState.groupInfoCache.end())
+	{
+		return GetOrCreateListViewGroup(itr->second);
+	}
+
+	// Retrieving some of the group keys (e.g. the owner of a file, or its version information)
+	// means opening the file, which shouldn't be done on this thread. Those keys are determined in
+	// the background, with the item being placed in a temporary group in the meantime.
+	if (IsGroupInfoExpensive(m_folderSettings.sortMode))
+	{
+		if (!m_directoryState.pendingGroupResultIds.contains(iItemInternal))
+		{
+			QueueGroupTask(iItemInternal);
+		}
+
+		return GetOrCreateListViewGroup(
+			GroupInfo(ResourceHelper::LoadString(m_hResourceModule, IDS_GENERAL_LOADING), INT_MAX));
+	}
+
+	auto groupInfo = DetermineItemGroupInfo(getBasicItemInfo(iItemInternal),
+		m_folderSettings.sortMode, m_config->globalFolderSettings);
+	m_directoryState.groupInfoCache.insert({ iItemInternal, groupInfo });
+
+	return GetOrCreateListViewGroup(groupInfo);
+}
+
+ShellBrowser::GroupInfo ShellBrowser::DetermineItemGroupInfo(const BasicItemInfo_t &basicItemInfo,
+	SortMode sortMode, const GlobalFolderSettings &globalFolderSettings) const
+{
 	std::optional<GroupInfo> groupInfo;
 
-	switch (m_folderSettings.sortMode)
+	switch (sortMode)
 	{
 	case SortMode::Name:
 		groupInfo = DetermineItemNameGroup(basicItemInfo);
@@ -178,7 +214,7 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 
 	case SortMode::OriginalLocation:
 		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &SCID_ORIGINAL_LOCATION,
-			m_config->globalFolderSettings);
+			globalFolderSettings);
 		break;
 
 	case SortMode::Attributes:
@@ -232,28 +268,23 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 		break;
 
 	case SortMode::Title:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Title, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Title, globalFolderSettings);
 		break;
 
 	case SortMode::Subject:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Subject, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Subject, globalFolderSettings);
 		break;
 
 	case SortMode::Authors:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Author, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Author, globalFolderSettings);
 		break;
 
 	case SortMode::Keywords:
-		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Keywords,
-			m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Keywords, globalFolderSettings);
 		break;
 
 	case SortMode::Comments:
-		groupInfo =
-			DetermineItemSummaryGroup(basicItemInfo, &PKEY_Comment, m_config->globalFolderSettings);
+		groupInfo = DetermineItemSummaryGroup(basicItemInfo, &PKEY_Comment, globalFolderSettings);
 		break;
 
 	case SortMode::CameraModel:
@@ -306,7 +337,148 @@ int ShellBrowser::DetermineItemGroup(int iItemInternal)
 			ResourceHelper::LoadString(m_hResourceModule, IDS_GROUPBY_UNSPECIFIED), INT_MIN);
 	}
 
-	return GetOrCreateListViewGroup(*groupInfo);
+	return *groupInfo;
+}
+
+bool ShellBrowser::IsGroupInfoExpensive(SortMode sortMode)
+{
+	switch (sortMode)
+	{
+	case SortMode::Name:
+	case SortMode::ShortName:
+	case SortMode::Type:
+	case SortMode::Size:
+	case SortMode::DateModified:
+	case SortMode::Created:
+	case SortMode::Accessed:
+	case SortMode::Attributes:
+	case SortMode::Extension:
+		return false;
+
+	default:
+		return true;
+	}
+}
+
+// The cached group information is only valid for the sort mode it was determined for. When the
+// sort mode changes, the cache, along with any outstanding requests, is discarded.
+void ShellBrowser::ValidateGroupInfoCache()
+{
+	if (m_directoryState.groupInfoCacheSortMode
+		&& *m_directoryState.groupInfoCacheSortMode == m_folderSettings.sortMode)
+	{
+		return;
+	}
+
+	m_itemTaskScheduler.Cancel(static_cast<int>(ItemTaskType::Group));
+	m_groupResults.clear();
+
+	m_directoryState.groupInfoCache.clear();
+	m_directoryState.pendingGroupResultIds.clear();
+	m_directoryState.groupInfoCacheSortMode = m_folderSettings.sortMode;
+}
+
+void ShellBrowser::QueueGroupTask(int internalIndex)
+{
+	int groupResultId = m_groupResultIdCounter++;
+
+	BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
+	GlobalFolderSettings globalFolderSettings = m_config->globalFolderSettings;
+	SortMode sortMode = m_folderSettings.sortMode;
+
+	auto promise = std::make_shared<std::promise<GroupResult>>();
+	auto result = promise->get_future();
+
+	// The group for every item is needed (not just the ones that are visible), so the task isn't
+	// associated with a row and won't be dropped when the listview is scrolled.
+	m_itemTaskScheduler.QueueTask(static_cast<int>(ItemTaskType::Group), std::nullopt,
+		[this, listView = m_hListView, groupResultId, internalIndex, basicItemInfo,
+			globalFolderSettings, sortMode, promise](std::stop_token stopToken)
+		{
+			if (stopToken.stop_requested())
+			{
+				return;
+			}
+
+			auto groupInfo = DetermineItemGroupInfo(basicItemInfo, sortMode, globalFolderSettings);
+			promise->set_value({ internalIndex, groupInfo });
+
+			if (!stopToken.stop_requested())
+			{
+				PostMessage(listView, WM_APP_GROUP_RESULT_READY, groupResultId, 0);
+			}
+		});
+
+	m_groupResults.insert({ groupResultId, std::move(result) });
+
+	// If a request is already outstanding for this item (e.g. because the item was modified
+	// again), only the result of the most recent request will be used.
+	m_directoryState.pendingGroupResultIds.insert_or_assign(internalIndex, groupResultId);
+}
+
+void ShellBrowser::ProcessGroupResult(int groupResultId)
+{
+	auto itr = m_groupResults.find(groupResultId);
+
+	if (itr == m_groupResults.end())
+	{
+		// This result is for a previous folder or sort mode. It can be ignored.
+		return;
+	}
+
+	auto result = itr->second.get();
+	m_groupResults.erase(itr);
+
+	auto pendingItr = m_directoryState.pendingGroupResultIds.find(result.itemInternalIndex);
+
+	if (pendingItr == m_directoryState.pendingGroupResultIds.end()
+		|| pendingItr->second != groupResultId)
+	{
+		// The item has since been removed, or a more recent request has been made.
+		return;
+	}
+
+	m_directoryState.pendingGroupResultIds.erase(pendingItr);
+	m_directoryState.groupInfoCache.insert_or_assign(result.itemInternalIndex, result.groupInfo);
+
+	if (!m_folderSettings.showInGroups)
+	{
+		return;
+	}
+
+	auto index = LocateItemByInternalIndex(result.itemInternalIndex);
+
+	if (!index)
+	{
+		// The item may have been filtered out.
+		return;
+	}
+
+	InsertItemIntoGroup(*index, GetOrCreateListViewGroup(result.groupInfo));
+}
+
+// Called when an item has been modified. If the item's group has to be determined in the
+// background, the item stays in its current group until the new group is known, rather than
+// moving to the temporary group in between.
+void ShellBrowser::UpdateItemGroup(int index, int internalIndex)
+{
+	ValidateGroupInfoCache();
+
+	RemoveItemGroupInfo(internalIndex);
+
+	if (IsGroupInfoExpensive(m_folderSettings.sortMode) && GetItemGroupId(index))
+	{
+		QueueGroupTask(internalIndex);
+		return;
+	}
+
+	InsertItemIntoGroup(index, DetermineItemGroup(internalIndex));
+}
+
+void ShellBrowser::RemoveItemGroupInfo(int internalIndex)
+{
+	m_directoryState.groupInfoCache.erase(internalIndex);
+	m_directoryState.pendingGroupResultIds.erase(internalIndex);
 }
 
 int ShellBrowser::GetOrCreateListViewGroup(const GroupInfo &groupInfo)
@@ -830,6 +1002,20 @@ std::optional<ShellBrowser::GroupInfo> ShellBrowser::DetermineItemNetworkStatus(
 	return GroupInfo(szStatus);
 }
 
+// Ensures that every item is in the correct group for the current sort mode. If the groups were
+// already created for the current sort mode, the items are in the correct groups and only the
+// order of the groups (which depends on the sort direction) needs to be updated.
+void ShellBrowser::UpdateGroups()
+{
+	if (m_listViewGroupsSortMode && *m_listViewGroupsSortMode == m_folderSettings.sortMode)
+	{
+		ListView_SortGroups(m_hListView, GroupComparisonStub, this);
+		return;
+	}
+
+	MoveItemsIntoGroups();
+}
+
 void ShellBrowser::MoveItemsIntoGroups()
 {
 	LVITEM item;
@@ -837,6 +1023,8 @@ void ShellBrowser::MoveItemsIntoGroups()
 	int iGroupId;
 	int i = 0;
 
+	ValidateGroupInfoCache();
+
 	ListView_RemoveAllGroups(m_hListView);
 	ListView_EnableGroupView(m_hListView, TRUE);
 
@@ -846,6 +1034,7 @@ void ShellBrowser::MoveItemsIntoGroups()
 
 	m_listViewGroups.clear();
 	m_groupIdCounter = 0;
+	m_listViewGroupsSortMode = m_folderSettings.sortMode;
 
 	for (i = 0; i < nItems; i++)
 	{
@@ -933,6 +1122,39 @@ void ShellBrowser::UpdateGroupHeader(const ListViewGroup &listViewGroup)
 	ListView_SetGroupInfo(m_hListView, listViewGroup.id, &lvGroup);
 }
 
+void ShellBrowser::QueueGroupHeaderUpdate(int groupId)
+{
+	// The message only needs to be posted once per batch. Since it's posted, rather than sent, any
+	// other changes that have already been queued will be processed before the headers are
+	// updated.
+	if (m_queuedGroupHeaderUpdates.empty())
+	{
+		PostMessage(m_hListView, WM_APP_UPDATE_GROUP_HEADERS, 0, 0);
+	}
+
+	m_queuedGroupHeaderUpdates.insert(groupId);
+}
+
+void ShellBrowser::UpdateQueuedGroupHeaders()
+{
+	auto &groupIdIndex = m_listViewGroups.get<0>();
+
+	for (int groupId : m_queuedGroupHeaderUpdates)
+	{
+		auto itr = groupIdIndex.find(groupId);
+
+		// The group may have been removed since the update was queued.
+		if (itr == groupIdIndex.end() || itr->numItems == 0)
+		{
+			continue;
+		}
+
+		UpdateGroupHeader(*itr);
+	}
+
+	m_queuedGroupHeaderUpdates.clear();
+}
+
 std::wstring ShellBrowser::GenerateGroupHeader(const ListViewGroup &listViewGroup)
 {
 	return listViewGroup.name + L" (" + std::to_wstring(listViewGroup.numItems) + L")";
@@ -954,7 +1176,7 @@ void ShellBrowser::OnItemRemovedFromGroup(int groupId)
 	}
 	else
 	{
-		UpdateGroupHeader(updatedGroup);
+		QueueGroupHeaderUpdate(groupId);
 	}
 }
 
@@ -968,7 +1190,7 @@ void ShellBrowser::OnItemAddedToGroup(int groupId)
 	updatedGroup.numItems++;
 	m_listViewGroups.replace(itr, updatedGroup);
 
-	UpdateGroupHeader(updatedGroup);
+	QueueGroupHeaderUpdate(groupId);
 }
 
 std::optional<int> ShellBrowser::GetItemGroupId(int index)
@@ -8,20 +8,31 @@
 #include "ViewModes.h"
 #include <wil/com.h>
 #include <thumbcache.h>
+#include <algorithm>
+#include <future>
 #include <list>
+#include <memory>
 
 #define THUMBNAIL_TYPE_ICON 0
 #define THUMBNAIL_TYPE_EXTRACTED 1
 
+// In owner data mode, the folder may contain a very large number of items, only a small number of
+// which will ever have their thumbnail extracted. Reserving space for every item up front would
+// be wasteful, so the imagelist starts at this size and grows as needed.
+constexpr int VIRTUAL_THUMBNAIL_IMAGE_LIST_INITIAL_SIZE = 500;
+
 void ShellBrowser::SetupThumbnailsView()
 {
 	HIMAGELIST himl;
-	LVITEM lvItem;
 	int nItems;
-	int i = 0;
 
 	nItems = ListView_GetItemCount(m_hListView);
 
+	if (m_virtualListView)
+	{
+		nItems = (std::min)(nItems, VIRTUAL_THUMBNAIL_IMAGE_LIST_INITIAL_SIZE);
+	}
+
 	IImageList *pImageList = nullptr;
 
 	/* Need to get the normal (32x32) image list for thumbnails, so that
@@ -37,38 +48,19 @@ void ShellBrowser::SetupThumbnailsView()
 		nItems + 100);
 	ListView_SetImageList(m_hListView, himl, LVSIL_NORMAL);
 
-	for (i = 0; i < nItems; i++)
-	{
-		lvItem.mask = LVIF_IMAGE;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		lvItem.iImage = I_IMAGECALLBACK;
-		ListView_SetItem(m_hListView, &lvItem);
-	}
+	ResetItemImages();
 
 	m_bThumbnailsSetup = TRUE;
 }
 
 void ShellBrowser::RemoveThumbnailsView()
 {
-	LVITEM lvItem;
 	HIMAGELIST himl;
-	int nItems;
-	int i = 0;
 
-	nItems = ListView_GetItemCount(m_hListView);
-
-	m_thumbnailThreadPool.clear_queue();
+	m_itemTaskScheduler.Cancel(static_cast<int>(ItemTaskType::Thumbnail));
 	m_thumbnailResults.clear();
 
-	for (i = 0; i < nItems; i++)
-	{
-		lvItem.mask = LVIF_IMAGE;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		lvItem.iImage = I_IMAGECALLBACK;
-		ListView_SetItem(m_hListView, &lvItem);
-	}
+	ResetItemImages();
 
 	/* Destroy the thumbnails imagelist. */
 	himl = ListView_GetImageList(m_hListView, LVSIL_NORMAL);
@@ -78,42 +70,72 @@ void ShellBrowser::RemoveThumbnailsView()
 	m_bThumbnailsSetup = FALSE;
 }
 
-void ShellBrowser::QueueThumbnailTask(int internalIndex)
+void ShellBrowser::QueueThumbnailTask(int internalIndex, int row)
 {
 	int thumbnailResultID = m_thumbnailResultIDCounter++;
 
 	BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
+	uint32_t itemGeneration = m_itemStore.GetGeneration(internalIndex);
+
+	auto promise = std::make_shared<std::promise<std::optional<ThumbnailResult_t>>>();
+	auto result = promise->get_future();
 
-	auto result = m_thumbnailThreadPool.push(
-		[this, thumbnailResultID, internalIndex, basicItemInfo](
-			int id) -> std::optional<ThumbnailResult_t>
+	m_itemTaskScheduler.QueueTask(
+		static_cast<int>(ItemTaskType::Thumbnail),
+		ViewportTaskScheduler::RowItem{ row, internalIndex },
+		[listView = m_hListView, thumbnailResultID, internalIndex, itemGeneration, basicItemInfo,
+			promise](std::stop_token stopToken)
 		{
-			UNREFERENCED_PARAMETER(id);
+			if (stopToken.stop_requested())
+			{
+				return;
+			}
 
 			auto bitmap = GetThumbnail(basicItemInfo.pidlComplete.get(),
 				WTS_EXTRACT | WTS_SCALETOREQUESTEDSIZE);
 
-			if (!bitmap)
+			if (!bitmap || stopToken.stop_requested())
 			{
-				return std::nullopt;
+				return;
 			}
 
-			PostMessage(m_hListView, WM_APP_THUMBNAIL_RESULT_READY, thumbnailResultID, 0);
+			ThumbnailResult_t thumbnailResult;
+			thumbnailResult.itemInternalIndex = internalIndex;
+			thumbnailResult.itemGeneration = itemGeneration;
+			thumbnailResult.bitmap = std::move(bitmap);
+			promise->set_value(std::move(thumbnailResult));
 
-			ThumbnailResult_t result;
-			result.itemInternalIndex = internalIndex;
-			result.bitmap = std::move(bitmap);
+			PostMessage(listView, WM_APP_THUMBNAIL_RESULT_READY, thumbnailResultID, 0);
+		},
+		[this, thumbnailResultID, internalIndex, itemGeneration]()
+		{
+			m_thumbnailResults.erase(thumbnailResultID);
 
-			return result;
+			if (!m_itemStore.Contains(internalIndex, itemGeneration))
+			{
+				return;
+			}
+
+			// The icon shown for the item is saved by the listview once it's first retrieved. It
+			// needs to be reset, so that the thumbnail will be requested again if the item is
+			// scrolled back into view.
+			auto index = LocateItemByInternalIndex(internalIndex);
+
+			if (!index)
+			{
+				return;
+			}
+
+			SetItemImage(*index, I_IMAGECALLBACK);
 		});
 
 	m_thumbnailResults.insert({ thumbnailResultID, std::move(result) });
 }
 
-std::optional<int> ShellBrowser::GetCachedThumbnailIndex(const ItemInfo_t &itemInfo)
+std::optional<int> ShellBrowser::GetCachedThumbnailIndex(int internalIndex)
 {
-	auto bitmap =
-		GetThumbnail(itemInfo.pidlComplete.get(), WTS_INCACHEONLY | WTS_SCALETOREQUESTEDSIZE);
+	auto bitmap = GetThumbnail(m_itemStore.GetPidl(internalIndex),
+		WTS_INCACHEONLY | WTS_SCALETOREQUESTEDSIZE);
 
 	if (!bitmap)
 	{
@@ -123,7 +145,7 @@ std::optional<int> ShellBrowser::GetCachedThumbnailIndex(const ItemInfo_t &itemI
 	return GetExtractedThumbnail(bitmap.get());
 }
 
-wil::unique_hbitmap ShellBrowser::GetThumbnail(PIDLIST_ABSOLUTE pidl, WTS_FLAGS flags)
+wil::unique_hbitmap ShellBrowser::GetThumbnail(PCIDLIST_ABSOLUTE pidl, WTS_FLAGS flags)
 {
 	wil::com_ptr_nothrow<IShellItem> shellItem;
 	HRESULT hr = SHCreateItemFromIDList(pidl, IID_PPV_ARGS(&shellItem));
@@ -187,6 +209,11 @@ void ShellBrowser::ProcessThumbnailResult(int thumbnailResultId)
 		return;
 	}
 
+	if (!m_itemStore.Contains(result->itemInternalIndex, result->itemGeneration))
+	{
+		return;
+	}
+
 	int imageIndex = GetExtractedThumbnail(result->bitmap.get());
 
 	auto index = LocateItemByInternalIndex(result->itemInternalIndex);
@@ -196,12 +223,7 @@ void ShellBrowser::ProcessThumbnailResult(int thumbnailResultId)
 		return;
 	}
 
-	LVITEM lvItem;
-	lvItem.mask = LVIF_IMAGE;
-	lvItem.iItem = *index;
-	lvItem.iSubItem = 0;
-	lvItem.iImage = imageIndex;
-	ListView_SetItem(m_hListView, &lvItem);
+	SetItemImage(*index, imageIndex);
 }
 
 /* Draws a thumbnail based on an items icon. */
@@ -274,7 +296,7 @@ void ShellBrowser::DrawIconThumbnailInternal(HDC hdcBacking, int iInternalIndex)
 	int iIconWidth;
 	int iIconHeight;
 
-	SHGetFileInfo((LPCTSTR) m_itemInfoMap.at(iInternalIndex).pidlComplete.get(), 0, &shfi,
+	SHGetFileInfo((LPCTSTR) m_itemStore.GetPidl(iInternalIndex), 0, &shfi,
 		sizeof(shfi), SHGFI_PIDL | SHGFI_SYSICONINDEX);
 
 	hIcon = ImageList_GetIcon(m_hListViewImageList, shfi.iIcon, ILD_NORMAL);
@@ -7,6 +7,8 @@
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
 #include <wil/resource.h>
+#include <optional>
+#include <string>
 
 struct BasicItemInfo_t
 {
@@ -42,3 +44,28 @@ struct BasicItemInfo_t
 		return fullPath;
 	}
 };
+
+// The information that's retrieved for an item when it's enumerated (or updated). Note that this
+// may be built on a background thread. Once the item has been added to the folder, the
+// information is held by ItemStore.
+struct ItemInfo_t
+{
+	unique_pidl_absolute pidlComplete;
+	WIN32_FIND_DATA wfd = {};
+	bool isFindDataValid = false;
+	std::wstring parsingName;
+	std::wstring displayName;
+	std::wstring editingName;
+
+	/* Drives are tracked, so that when a drive is
+	removed from the system, the item representing
+	that drive can be found. */
+	BOOL bDrive = FALSE;
+};
+
+// The result of matching an item against the set of color rules.
+struct CachedColor
+{
+	int colorRuleMatcherId;
+	std::optional<COLORREF> color;
+};
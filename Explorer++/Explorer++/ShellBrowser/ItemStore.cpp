@@ -0,0 +1,509 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ItemStore.h"
+#include <wil/common.h>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+size_t ItemStore::MemoryUsage::GetTotalBytes() const
+{
+	return columnBytes + nameBytes + pidlBytes;
+}
+
+int ItemStore::Add(ItemInfo_t itemInfo)
+{
+	// SetItem() sets every field other than the relative sort and cached color, both of which are
+	// reset when an item is removed, so a free slot can be used as-is.
+	if (!m_freeSlots.empty())
+	{
+		int internalIndex = m_freeSlots.back();
+		m_freeSlots.pop_back();
+
+		SetItem(internalIndex, std::move(itemInfo));
+		m_count++;
+
+		return internalIndex;
+	}
+
+	int internalIndex = GetSlotCount();
+
+	m_flags.push_back(0);
+	m_pidls.emplace_back();
+	m_attributes.push_back(0);
+	m_fileSizes.push_back(0);
+	m_creationTimes.push_back({});
+	m_lastAccessTimes.push_back({});
+	m_lastWriteTimes.push_back({});
+	m_fileNames.emplace_back();
+	m_displayNames.emplace_back();
+	m_editingNames.emplace_back();
+	m_parsingNames.emplace_back();
+	m_relativeSorts.push_back(0);
+	m_cachedColors.emplace_back();
+	m_generations.push_back(0);
+
+	SetItem(internalIndex, std::move(itemInfo));
+	m_count++;
+
+	return internalIndex;
+}
+
+void ItemStore::Replace(int internalIndex, ItemInfo_t itemInfo)
+{
+	CheckItem(internalIndex);
+
+	ReleaseNames(internalIndex);
+	SetItem(internalIndex, std::move(itemInfo));
+	m_cachedColors[internalIndex].reset();
+
+	CompactNamesIfNeeded();
+}
+
+void ItemStore::Remove(int internalIndex)
+{
+	CheckItem(internalIndex);
+
+	ReleaseNames(internalIndex);
+
+	m_flags[internalIndex] = 0;
+	m_pidls[internalIndex].reset();
+	m_fileNames[internalIndex] = {};
+	m_displayNames[internalIndex] = {};
+	m_editingNames[internalIndex] = {};
+	m_parsingNames[internalIndex] = {};
+	m_relativeSorts[internalIndex] = 0;
+	m_cachedColors[internalIndex].reset();
+	m_generations[internalIndex]++;
+	m_freeSlots.push_back(internalIndex);
+	m_count--;
+
+	CompactNamesIfNeeded();
+}
+
+void ItemStore::Clear()
+{
+	*this = ItemStore();
+}
+
+bool ItemStore::Contains(int internalIndex) const
+{
+	return internalIndex >= 0 && internalIndex < GetSlotCount()
+		&& WI_IsFlagSet(m_flags[internalIndex], ItemFlags::Present);
+}
+
+bool ItemStore::Contains(int internalIndex, uint32_t generation) const
+{
+	return Contains(internalIndex) && m_generations[internalIndex] == generation;
+}
+
+int ItemStore::GetCount() const
+{
+	return m_count;
+}
+
+int ItemStore::GetSlotCount() const
+{
+	return static_cast<int>(m_flags.size());
+}
+
+uint32_t ItemStore::GetGeneration(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return m_generations[internalIndex];
+}
+
+PCIDLIST_ABSOLUTE ItemStore::GetPidl(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return m_pidls[internalIndex].get();
+}
+
+// The child pidl is simply the last item in the full pidl, so there's no need to store a separate
+// copy.
+PCITEMID_CHILD ItemStore::GetChildPidl(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return ILFindLastID(m_pidls[internalIndex].get());
+}
+
+std::wstring ItemStore::GetParsingName(int internalIndex) const
+{
+	CheckItem(internalIndex);
+
+	const auto &parsingName = m_parsingNames[internalIndex];
+	std::wstring fullParsingName;
+
+	if (parsingName.prefixIndex != NO_PREFIX)
+	{
+		fullParsingName = GetName(m_parsingNamePrefixes[parsingName.prefixIndex]);
+	}
+
+	fullParsingName += GetName(parsingName.suffix);
+
+	return fullParsingName;
+}
+
+std::wstring_view ItemStore::GetDisplayName(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return GetName(m_displayNames[internalIndex]);
+}
+
+std::wstring_view ItemStore::GetEditingName(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return GetName(m_editingNames[internalIndex]);
+}
+
+std::wstring_view ItemStore::GetFileName(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return GetName(m_fileNames[internalIndex]);
+}
+
+DWORD ItemStore::GetAttributes(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return m_attributes[internalIndex];
+}
+
+ULONGLONG ItemStore::GetFileSize(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return m_fileSizes[internalIndex];
+}
+
+FILETIME ItemStore::GetCreationTime(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return m_creationTimes[internalIndex];
+}
+
+FILETIME ItemStore::GetLastAccessTime(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return m_lastAccessTimes[internalIndex];
+}
+
+FILETIME ItemStore::GetLastWriteTime(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return m_lastWriteTimes[internalIndex];
+}
+
+bool ItemStore::IsFindDataValid(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return WI_IsFlagSet(m_flags[internalIndex], ItemFlags::FindDataValid);
+}
+
+bool ItemStore::IsDrive(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return WI_IsFlagSet(m_flags[internalIndex], ItemFlags::Drive);
+}
+
+WIN32_FIND_DATA ItemStore::GetFindData(int internalIndex) const
+{
+	CheckItem(internalIndex);
+
+	WIN32_FIND_DATA wfd = {};
+	wfd.dwFileAttributes = m_attributes[internalIndex];
+	wfd.ftCreationTime = m_creationTimes[internalIndex];
+	wfd.ftLastAccessTime = m_lastAccessTimes[internalIndex];
+	wfd.ftLastWriteTime = m_lastWriteTimes[internalIndex];
+
+	ULARGE_INTEGER fileSize;
+	fileSize.QuadPart = m_fileSizes[internalIndex];
+	wfd.nFileSizeLow = fileSize.LowPart;
+	wfd.nFileSizeHigh = fileSize.HighPart;
+
+	StringCchCopy(wfd.cFileName, SIZEOF_ARRAY(wfd.cFileName),
+		GetName(m_fileNames[internalIndex]).data());
+
+	return wfd;
+}
+
+BasicItemInfo_t ItemStore::GetBasicItemInfo(int internalIndex) const
+{
+	CheckItem(internalIndex);
+
+	BasicItemInfo_t basicItemInfo;
+	basicItemInfo.pidlComplete.reset(ILCloneFull(GetPidl(internalIndex)));
+	basicItemInfo.pridl.reset(ILCloneChild(GetChildPidl(internalIndex)));
+	basicItemInfo.wfd = GetFindData(internalIndex);
+	basicItemInfo.isFindDataValid = IsFindDataValid(internalIndex);
+	StringCchCopy(basicItemInfo.szDisplayName, SIZEOF_ARRAY(basicItemInfo.szDisplayName),
+		GetDisplayName(internalIndex).data());
+	basicItemInfo.isRoot = IsDrive(internalIndex);
+
+	return basicItemInfo;
+}
+
+void ItemStore::SetDisplayName(int internalIndex, std::wstring_view displayName)
+{
+	CheckItem(internalIndex);
+
+	NameRef oldDisplayName = m_displayNames[internalIndex];
+
+	if (GetName(oldDisplayName) == displayName)
+	{
+		return;
+	}
+
+	// The old name is only unused if it wasn't shared with any of the other names.
+	if (oldDisplayName != m_fileNames[internalIndex]
+		&& oldDisplayName != m_editingNames[internalIndex]
+		&& oldDisplayName != m_parsingNames[internalIndex].suffix)
+	{
+		m_unusedNameChars += oldDisplayName.length + 1;
+	}
+
+	m_displayNames[internalIndex] =
+		InternName(displayName, { m_fileNames[internalIndex], m_editingNames[internalIndex] });
+
+	CompactNamesIfNeeded();
+}
+
+int ItemStore::GetRelativeSort(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return m_relativeSorts[internalIndex];
+}
+
+void ItemStore::SetRelativeSort(int internalIndex, int relativeSort)
+{
+	CheckItem(internalIndex);
+	m_relativeSorts[internalIndex] = relativeSort;
+}
+
+const std::optional<CachedColor> &ItemStore::GetCachedColor(int internalIndex) const
+{
+	CheckItem(internalIndex);
+	return m_cachedColors[internalIndex];
+}
+
+void ItemStore::SetCachedColor(int internalIndex, const CachedColor &cachedColor)
+{
+	CheckItem(internalIndex);
+	m_cachedColors[internalIndex] = cachedColor;
+}
+
+ItemStore::MemoryUsage ItemStore::GetMemoryUsage() const
+{
+	MemoryUsage memoryUsage;
+	memoryUsage.numItems = m_count;
+
+	memoryUsage.columnBytes = m_flags.capacity() * sizeof(uint8_t)
+		+ m_pidls.capacity() * sizeof(unique_pidl_absolute)
+		+ m_attributes.capacity() * sizeof(DWORD) + m_fileSizes.capacity() * sizeof(ULONGLONG)
+		+ (m_creationTimes.capacity() + m_lastAccessTimes.capacity()
+			  + m_lastWriteTimes.capacity())
+			* sizeof(FILETIME)
+		+ (m_fileNames.capacity() + m_displayNames.capacity() + m_editingNames.capacity())
+			* sizeof(NameRef)
+		+ m_parsingNames.capacity() * sizeof(ParsingNameRef)
+		+ m_relativeSorts.capacity() * sizeof(int)
+		+ m_cachedColors.capacity() * sizeof(std::optional<CachedColor>)
+		+ m_generations.capacity() * sizeof(uint32_t) + m_freeSlots.capacity() * sizeof(int);
+
+	memoryUsage.nameBytes = m_names.capacity() * sizeof(wchar_t)
+		+ m_parsingNamePrefixes.capacity() * sizeof(NameRef);
+
+	for (const auto &pidl : m_pidls)
+	{
+		if (pidl)
+		{
+			memoryUsage.pidlBytes += ILGetSize(pidl.get());
+		}
+	}
+
+	return memoryUsage;
+}
+
+void ItemStore::CheckItem(int internalIndex) const
+{
+	if (!Contains(internalIndex))
+	{
+		throw std::out_of_range("Item doesn't exist");
+	}
+}
+
+void ItemStore::SetItem(int internalIndex, ItemInfo_t &&itemInfo)
+{
+	uint8_t flags = ItemFlags::Present;
+	WI_SetFlagIf(flags, ItemFlags::FindDataValid, itemInfo.isFindDataValid);
+	WI_SetFlagIf(flags, ItemFlags::Drive, itemInfo.bDrive);
+	m_flags[internalIndex] = flags;
+
+	m_pidls[internalIndex] = std::move(itemInfo.pidlComplete);
+	m_attributes[internalIndex] = itemInfo.wfd.dwFileAttributes;
+	m_creationTimes[internalIndex] = itemInfo.wfd.ftCreationTime;
+	m_lastAccessTimes[internalIndex] = itemInfo.wfd.ftLastAccessTime;
+	m_lastWriteTimes[internalIndex] = itemInfo.wfd.ftLastWriteTime;
+
+	ULARGE_INTEGER fileSize;
+	fileSize.LowPart = itemInfo.wfd.nFileSizeLow;
+	fileSize.HighPart = itemInfo.wfd.nFileSizeHigh;
+	m_fileSizes[internalIndex] = fileSize.QuadPart;
+
+	NameRef fileName = InternName(itemInfo.wfd.cFileName, {});
+	NameRef displayName = InternName(itemInfo.displayName, { fileName });
+	NameRef editingName = InternName(itemInfo.editingName, { fileName, displayName });
+
+	m_fileNames[internalIndex] = fileName;
+	m_displayNames[internalIndex] = displayName;
+	m_editingNames[internalIndex] = editingName;
+	m_parsingNames[internalIndex] = InternParsingName(itemInfo.parsingName, fileName);
+}
+
+void ItemStore::ReleaseNames(int internalIndex)
+{
+	for (const auto &nameRef : GetDistinctNames(internalIndex))
+	{
+		m_unusedNameChars += nameRef.length + 1;
+	}
+}
+
+// Returns the names that are stored for the item. Each name is only returned once, even if it's
+// shared by more than one field.
+std::vector<ItemStore::NameRef> ItemStore::GetDistinctNames(int internalIndex) const
+{
+	std::vector<NameRef> names;
+
+	for (const auto &nameRef : { m_fileNames[internalIndex], m_displayNames[internalIndex],
+			 m_editingNames[internalIndex], m_parsingNames[internalIndex].suffix })
+	{
+		if (std::find(names.begin(), names.end(), nameRef) == names.end())
+		{
+			names.push_back(nameRef);
+		}
+	}
+
+	return names;
+}
+
+ItemStore::NameRef ItemStore::InternName(std::wstring_view name,
+	std::initializer_list<NameRef> existingNames)
+{
+	for (const auto &existingName : existingNames)
+	{
+		if (GetName(existingName) == name)
+		{
+			return existingName;
+		}
+	}
+
+	return AppendName(name);
+}
+
+ItemStore::NameRef ItemStore::AppendName(std::wstring_view name)
+{
+	NameRef nameRef;
+	nameRef.offset = static_cast<uint32_t>(m_names.size());
+	nameRef.length = static_cast<uint32_t>(name.size());
+
+	m_names.insert(m_names.end(), name.begin(), name.end());
+	m_names.push_back('\0');
+
+	return nameRef;
+}
+
+std::wstring_view ItemStore::GetName(NameRef nameRef) const
+{
+	if (m_names.empty())
+	{
+		return L"";
+	}
+
+	return { m_names.data() + nameRef.offset, nameRef.length };
+}
+
+ItemStore::ParsingNameRef ItemStore::InternParsingName(std::wstring_view parsingName,
+	NameRef fileName)
+{
+	std::wstring_view fileNameText = GetName(fileName);
+
+	if (fileName.length == 0 || parsingName.size() <= fileName.length
+		|| parsingName.substr(parsingName.size() - fileName.length) != fileNameText)
+	{
+		return { NO_PREFIX, InternName(parsingName, { fileName }) };
+	}
+
+	std::wstring_view prefix = parsingName.substr(0, parsingName.size() - fileName.length);
+
+	// The most recently added prefix is checked first, since consecutive items will almost always
+	// share the same prefix.
+	for (size_t i = m_parsingNamePrefixes.size(); i > 0; i--)
+	{
+		if (GetName(m_parsingNamePrefixes[i - 1]) == prefix)
+		{
+			return { static_cast<uint32_t>(i - 1), fileName };
+		}
+	}
+
+	if (m_parsingNamePrefixes.size() >= MAX_PARSING_NAME_PREFIXES)
+	{
+		return { NO_PREFIX, AppendName(parsingName) };
+	}
+
+	m_parsingNamePrefixes.push_back(AppendName(prefix));
+
+	return { static_cast<uint32_t>(m_parsingNamePrefixes.size() - 1), fileName };
+}
+
+// Removing or replacing an item leaves its names in place. Once enough of the buffer is unused,
+// the names that are still in use are copied into a new buffer.
+void ItemStore::CompactNamesIfNeeded()
+{
+	if (m_unusedNameChars < MIN_UNUSED_CHARS_TO_COMPACT || m_unusedNameChars < m_names.size() / 2)
+	{
+		return;
+	}
+
+	std::vector<wchar_t> oldNames = std::move(m_names);
+	m_names = {};
+	m_names.reserve(oldNames.size() - m_unusedNameChars);
+
+	// Names can be shared, so each name is only copied once, with any other references then
+	// being updated to point to the same copy.
+	std::unordered_map<uint32_t, uint32_t> movedOffsets;
+
+	auto moveName = [this, &oldNames, &movedOffsets](NameRef &nameRef)
+	{
+		auto [itr, inserted] =
+			movedOffsets.try_emplace(nameRef.offset, static_cast<uint32_t>(m_names.size()));
+
+		if (inserted)
+		{
+			auto start = oldNames.begin() + nameRef.offset;
+			m_names.insert(m_names.end(), start, start + nameRef.length + 1);
+		}
+
+		nameRef.offset = itr->second;
+	};
+
+	for (auto &prefix : m_parsingNamePrefixes)
+	{
+		moveName(prefix);
+	}
+
+	for (int i = 0; i < GetSlotCount(); i++)
+	{
+		if (!Contains(i))
+		{
+			continue;
+		}
+
+		moveName(m_fileNames[i]);
+		moveName(m_displayNames[i]);
+		moveName(m_editingNames[i]);
+		moveName(m_parsingNames[i].suffix);
+	}
+
+	m_unusedNameChars = 0;
+}
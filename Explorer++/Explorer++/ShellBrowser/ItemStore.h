@@ -0,0 +1,178 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ItemData.h"
+#include "../Helper/ShellHelper.h"
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Holds the items in the current folder.
+// Storing a full ItemInfo_t for each item is expensive. The WIN32_FIND_DATA structure alone
+// contains two fixed-size name buffers, the parsing, display and editing names usually all repeat
+// the filename (with the parsing name repeating the folder path as well) and each item is
+// allocated separately.
+// This class instead stores each field in its own contiguous column, indexed by the item's
+// internal index. The names are interned into a single buffer that's shared by all the items in
+// the folder, with a name that's identical to another name for the same item only being stored
+// once.
+class ItemStore
+{
+public:
+	struct MemoryUsage
+	{
+		int numItems = 0;
+		size_t columnBytes = 0;
+		size_t nameBytes = 0;
+		size_t pidlBytes = 0;
+
+		size_t GetTotalBytes() const;
+	};
+
+	// Adds the item and returns its internal index. Internal indexes are slots. The slot of a
+	// removed item will be reused by a later item, so an internal index on its own only refers to
+	// an item for as long as that item exists. Anything that holds on to an internal index past
+	// that point (e.g. the result of an async task) should also hold on to the generation of the
+	// slot and check it before using the index.
+	int Add(ItemInfo_t itemInfo);
+
+	// Replaces the information stored for an existing item. The cached color for the item will be
+	// discarded.
+	void Replace(int internalIndex, ItemInfo_t itemInfo);
+
+	void Remove(int internalIndex);
+	void Clear();
+
+	bool Contains(int internalIndex) const;
+
+	// Returns true if the slot still holds the item it held when the generation was retrieved.
+	bool Contains(int internalIndex, uint32_t generation) const;
+
+	int GetCount() const;
+
+	// Returns the number of slots that have been allocated (i.e. one more than the largest internal
+	// index), including the free slots left by items that have been removed.
+	int GetSlotCount() const;
+
+	// Each of the methods below throws std::out_of_range if the item doesn't exist.
+
+	// The generation of a slot changes each time the item in it is removed.
+	uint32_t GetGeneration(int internalIndex) const;
+
+	PCIDLIST_ABSOLUTE GetPidl(int internalIndex) const;
+	PCITEMID_CHILD GetChildPidl(int internalIndex) const;
+	std::wstring GetParsingName(int internalIndex) const;
+
+	// The views returned by these methods are null-terminated. They remain valid until the next
+	// time an item is added, replaced or removed.
+	std::wstring_view GetDisplayName(int internalIndex) const;
+	std::wstring_view GetEditingName(int internalIndex) const;
+	std::wstring_view GetFileName(int internalIndex) const;
+
+	DWORD GetAttributes(int internalIndex) const;
+	ULONGLONG GetFileSize(int internalIndex) const;
+	FILETIME GetCreationTime(int internalIndex) const;
+	FILETIME GetLastAccessTime(int internalIndex) const;
+	FILETIME GetLastWriteTime(int internalIndex) const;
+	bool IsFindDataValid(int internalIndex) const;
+	bool IsDrive(int internalIndex) const;
+
+	// Rebuilds the WIN32_FIND_DATA structure for the item. Only the fields that are stored (the
+	// attributes, times, size and filename) will be set.
+	WIN32_FIND_DATA GetFindData(int internalIndex) const;
+
+	BasicItemInfo_t GetBasicItemInfo(int internalIndex) const;
+
+	// The display name of some items (e.g. drives) can change without the item itself being
+	// replaced.
+	void SetDisplayName(int internalIndex, std::wstring_view displayName);
+
+	int GetRelativeSort(int internalIndex) const;
+	void SetRelativeSort(int internalIndex, int relativeSort);
+
+	const std::optional<CachedColor> &GetCachedColor(int internalIndex) const;
+	void SetCachedColor(int internalIndex, const CachedColor &cachedColor);
+
+	MemoryUsage GetMemoryUsage() const;
+
+private:
+	// Names are only compacted once at least this many characters are unused.
+	static constexpr size_t MIN_UNUSED_CHARS_TO_COMPACT = 4096;
+
+	// Items in a folder will normally share a single parsing name prefix. Prefixes beyond this
+	// number won't be interned and the parsing name will be stored in full instead.
+	static constexpr size_t MAX_PARSING_NAME_PREFIXES = 16;
+
+	static constexpr uint32_t NO_PREFIX = UINT32_MAX;
+
+	enum ItemFlags : uint8_t
+	{
+		Present = 1 << 0,
+		FindDataValid = 1 << 1,
+		Drive = 1 << 2
+	};
+
+	// A reference to a null-terminated name within the names buffer.
+	struct NameRef
+	{
+		uint32_t offset = 0;
+		uint32_t length = 0;
+
+		bool operator==(const NameRef &other) const
+		{
+			return offset == other.offset && length == other.length;
+		}
+	};
+
+	// Within a filesystem folder, the parsing name of an item is the path of the folder, followed
+	// by the filename. Rather than storing the path again for each item, the prefix is stored once
+	// and the suffix will normally refer to the filename.
+	struct ParsingNameRef
+	{
+		uint32_t prefixIndex = NO_PREFIX;
+		NameRef suffix;
+	};
+
+	void CheckItem(int internalIndex) const;
+	void SetItem(int internalIndex, ItemInfo_t &&itemInfo);
+	void ReleaseNames(int internalIndex);
+	std::vector<NameRef> GetDistinctNames(int internalIndex) const;
+
+	NameRef InternName(std::wstring_view name, std::initializer_list<NameRef> existingNames);
+	NameRef AppendName(std::wstring_view name);
+	std::wstring_view GetName(NameRef nameRef) const;
+	ParsingNameRef InternParsingName(std::wstring_view parsingName, NameRef fileName);
+
+	void CompactNamesIfNeeded();
+
+	std::vector<uint8_t> m_flags;
+	std::vector<unique_pidl_absolute> m_pidls;
+	std::vector<DWORD> m_attributes;
+	std::vector<ULONGLONG> m_fileSizes;
+	std::vector<FILETIME> m_creationTimes;
+	std::vector<FILETIME> m_lastAccessTimes;
+	std::vector<FILETIME> m_lastWriteTimes;
+	std::vector<NameRef> m_fileNames;
+	std::vector<NameRef> m_displayNames;
+	std::vector<NameRef> m_editingNames;
+	std::vector<ParsingNameRef> m_parsingNames;
+	std::vector<int> m_relativeSorts;
+	std::vector<std::optional<CachedColor>> m_cachedColors;
+	std::vector<uint32_t> m_generations;
+
+	// The slots of removed items, which will be reused (most recently freed first) by the next
+	// items that are added.
+	std::vector<int> m_freeSlots;
+
+	std::vector<wchar_t> m_names;
+	size_t m_unusedNameChars = 0;
+	std::vector<NameRef> m_parsingNamePrefixes;
+
+	int m_count = 0;
+};
@@ -13,14 +13,17 @@
 #include "SelectColumnsDialog.h"
 #include "SetFileAttributesDialog.h"
 #include "ShellNavigationController.h"
-#include "../Helper/CachedIcons.h"
 #include "../Helper/DragDropHelper.h"
 #include "../Helper/Helper.h"
 #include "../Helper/IconFetcher.h"
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/WindowHelper.h"
 #include <boost/format.hpp>
 #include <wil/common.h>
+#include <algorithm>
+#include <future>
+#include <memory>
 
 const std::vector<ColumnType> COMMON_REAL_FOLDER_COLUMNS = { ColumnType::Name, ColumnType::Type,
 	ColumnType::Size, ColumnType::DateModified, ColumnType::Authors, ColumnType::Title };
@@ -151,6 +154,22 @@ LRESULT CALLBACK ShellBrowser::ListViewProc(HWND hwnd, UINT uMsg, WPARAM wParam,
 	case WM_APP_SHELL_NOTIFY:
 		OnShellNotify(wParam, lParam);
 		break;
+
+	case WM_APP_ENUMERATION_PROGRESS:
+		OnEnumerationProgress(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_GROUP_RESULT_READY:
+		ProcessGroupResult(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_UPDATE_GROUP_HEADERS:
+		UpdateQueuedGroupHeaders();
+		break;
+
+	case WM_APP_FILTER_RESULT_READY:
+		ProcessFilterResult(static_cast<int>(wParam));
+		break;
 	}
 
 	return DefSubclassProc(hwnd, uMsg, wParam, lParam);
@@ -194,6 +213,13 @@ LRESULT CALLBACK ShellBrowser::ListViewParentProc(HWND hwnd, UINT uMsg, WPARAM w
 				OnListViewItemChanged(reinterpret_cast<NMLISTVIEW *>(lParam));
 				break;
 
+			case LVN_ODSTATECHANGED:
+				OnListViewODStateChanged(reinterpret_cast<NMLVODSTATECHANGE *>(lParam));
+				break;
+
+			case LVN_ODFINDITEM:
+				return OnListViewFindItem(reinterpret_cast<NMLVFINDITEM *>(lParam));
+
 			case LVN_KEYDOWN:
 				OnListViewKeyDown(reinterpret_cast<NMLVKEYDOWN *>(lParam));
 				break;
@@ -268,9 +294,9 @@ void ShellBrowser::OnListViewMButtonUp(const POINT *pt, UINT keysDown)
 		return;
 	}
 
-	const ItemInfo_t &itemInfo = GetItemByIndex(m_middleButtonItem);
+	int internalIndex = GetItemInternalIndex(m_middleButtonItem);
 
-	if (!WI_IsAnyFlagSet(itemInfo.wfd.dwFileAttributes,
+	if (!WI_IsAnyFlagSet(m_itemStore.GetAttributes(internalIndex),
 			FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_ARCHIVE))
 	{
 		return;
@@ -283,7 +309,7 @@ void ShellBrowser::OnListViewMButtonUp(const POINT *pt, UINT keysDown)
 		switchToNewTab = !switchToNewTab;
 	}
 
-	m_tabNavigation->CreateNewTab(itemInfo.pidlComplete.get(), switchToNewTab);
+	m_tabNavigation->CreateNewTab(m_itemStore.GetPidl(internalIndex), switchToNewTab);
 }
 
 void ShellBrowser::OnRButtonDown(HWND hwnd, BOOL doubleClick, int x, int y, UINT keyFlags)
@@ -359,36 +385,21 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 	pnmv = (NMLVDISPINFO *) lParam;
 	plvItem = &pnmv->item;
 
+	UpdateItemTaskViewport();
+
+	if (m_virtualListView)
+	{
+		OnVirtualListViewGetDisplayInfo(plvItem);
+		return;
+	}
+
 	int internalIndex = static_cast<int>(plvItem->lParam);
 
-	/* Construct an image here using the items
-	actual icon. This image will be shown initially.
-	If the item also has a thumbnail image, this
-	will be found later, and will overwrite any
-	image settings made here.
-	Note that the initial icon image MUST be drawn
-	first, or else it may be possible for the
-	thumbnail to be drawn before the initial
-	image. */
 	if (m_folderSettings.viewMode == +ViewMode::Thumbnails
 		&& (plvItem->mask & LVIF_IMAGE) == LVIF_IMAGE)
 	{
-		const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
-		auto cachedThumbnailIndex = GetCachedThumbnailIndex(itemInfo);
-
-		if (cachedThumbnailIndex)
-		{
-			plvItem->iImage = *cachedThumbnailIndex;
-		}
-		else
-		{
-			plvItem->iImage = GetIconThumbnail(internalIndex);
-		}
-
+		plvItem->iImage = GetThumbnailImageForItem(internalIndex, plvItem->iItem);
 		plvItem->mask |= LVIF_DI_SETITEM;
-
-		QueueThumbnailTask(internalIndex);
-
 		return;
 	}
 
@@ -397,70 +408,148 @@ void ShellBrowser::OnListViewGetDisplayInfo(LPARAM lParam)
 		auto columnType = GetColumnTypeByIndex(plvItem->iSubItem);
 		assert(columnType);
 
-		QueueColumnTask(internalIndex, *columnType);
+		QueueColumnTask(internalIndex, plvItem->iItem, *columnType);
 	}
 
 	if ((plvItem->mask & LVIF_IMAGE) == LVIF_IMAGE)
 	{
-		const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
-		auto cachedIconIndex = GetCachedIconIndex(itemInfo);
+		plvItem->iImage = GetIconImageForItem(internalIndex);
+	}
+
+	plvItem->mask |= LVIF_DI_SETITEM;
+}
+
+/* Construct an image here using the items
+actual icon. This image will be shown initially.
+If the item also has a thumbnail image, this
+will be found later, and will overwrite any
+image settings made here.
+Note that the initial icon image MUST be drawn
+first, or else it may be possible for the
+thumbnail to be drawn before the initial
+image. */
+int ShellBrowser::GetThumbnailImageForItem(int internalIndex, int row)
+{
+	auto cachedThumbnailIndex = GetCachedThumbnailIndex(internalIndex);
+
+	QueueThumbnailTask(internalIndex, row);
+
+	if (cachedThumbnailIndex)
+	{
+		return *cachedThumbnailIndex;
+	}
 
-		if (cachedIconIndex)
+	return GetIconThumbnail(internalIndex);
+}
+
+int ShellBrowser::GetIconImageForItem(int internalIndex)
+{
+	auto cachedIconIndex = GetCachedIconIndex(internalIndex);
+	int iconIndex;
+
+	if (cachedIconIndex)
+	{
+		// The icon retrieval method specifies the
+		// SHGFI_OVERLAYINDEX value. That means that cached icons
+		// will have an overlay index stored in the upper eight bits
+		// of the icon value. While setting the icon and
+		// stateMask/state values in one go with ListView_SetItem()
+		// works, there's no direct way to specify the
+		// stateMask/state values here.
+		// If you don't mask out the upper eight bits here, no icon
+		// will be shown. You can call ListView_SetItem() at this
+		// point, but that seemingly doesn't repaint the item
+		// correctly (you have to call ListView_Update() to force
+		// the item to be redrawn).
+		// Rather than doing that, only the icon is set here. Any
+		// overlay will be added by the icon retrieval task
+		// (scheduled below).
+		iconIndex = (*cachedIconIndex & 0x0FFF);
+	}
+	else
+	{
+		if ((m_itemStore.GetAttributes(internalIndex) & FILE_ATTRIBUTE_DIRECTORY)
+			== FILE_ATTRIBUTE_DIRECTORY)
 		{
-			// The icon retrieval method specifies the
-			// SHGFI_OVERLAYINDEX value. That means that cached icons
-			// will have an overlay index stored in the upper eight bits
-			// of the icon value. While setting the icon and
-			// stateMask/state values in one go with ListView_SetItem()
-			// works, there's no direct way to specify the
-			// stateMask/state values here.
-			// If you don't mask out the upper eight bits here, no icon
-			// will be shown. You can call ListView_SetItem() at this
-			// point, but that seemingly doesn't repaint the item
-			// correctly (you have to call ListView_Update() to force
-			// the item to be redrawn).
-			// Rather than doing that, only the icon is set here. Any
-			// overlay will be added by the icon retrieval task
-			// (scheduled below).
-			plvItem->iImage = (*cachedIconIndex & 0x0FFF);
+			iconIndex = m_iFolderIcon;
 		}
 		else
 		{
-			if ((itemInfo.wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
-				== FILE_ATTRIBUTE_DIRECTORY)
-			{
-				plvItem->iImage = m_iFolderIcon;
-			}
-			else
-			{
-				plvItem->iImage = m_iFileIcon;
-			}
+			iconIndex = m_iFileIcon;
 		}
+	}
 
-		m_iconFetcher->QueueIconTask(itemInfo.pidlComplete.get(),
-			[this, internalIndex](int iconIndex)
-			{
-				ProcessIconResult(internalIndex, iconIndex);
-			});
+	m_iconFetcher->QueueIconTask(m_itemStore.GetPidl(internalIndex),
+		[this, internalIndex, itemGeneration = m_itemStore.GetGeneration(internalIndex)](
+			int iconIndex)
+		{
+			ProcessIconResult(internalIndex, itemGeneration, iconIndex);
+		});
+
+	return iconIndex;
+}
+
+void ShellBrowser::SetItemImage(int item, int image)
+{
+	if (m_virtualListView)
+	{
+		auto &itemData = m_directoryState.virtualItemData[GetItemInternalIndex(item)];
+
+		if (image == I_IMAGECALLBACK)
+		{
+			itemData.image.reset();
+		}
+		else
+		{
+			itemData.image = image;
+		}
+
+		ListView_RedrawItems(m_hListView, item, item);
+		return;
 	}
 
-	plvItem->mask |= LVIF_DI_SETITEM;
+	LVITEM lvItem;
+	lvItem.mask = LVIF_IMAGE;
+	lvItem.iItem = item;
+	lvItem.iSubItem = 0;
+	lvItem.iImage = image;
+	ListView_SetItem(m_hListView, &lvItem);
 }
 
-std::optional<int> ShellBrowser::GetCachedIconIndex(const ItemInfo_t &itemInfo)
+// Discards the image set for every item, so that the image for each item will be requested again.
+void ShellBrowser::ResetItemImages()
 {
-	auto cachedItr = m_cachedIcons->findByPath(itemInfo.parsingName);
+	if (m_virtualListView)
+	{
+		for (auto &[internalIndex, itemData] : m_directoryState.virtualItemData)
+		{
+			itemData.image.reset();
+		}
 
-	if (cachedItr == m_cachedIcons->end())
+		InvalidateRect(m_hListView, nullptr, TRUE);
+		return;
+	}
+
+	int numItems = ListView_GetItemCount(m_hListView);
+
+	for (int i = 0; i < numItems; i++)
 	{
-		return std::nullopt;
+		SetItemImage(i, I_IMAGECALLBACK);
 	}
+}
 
-	return cachedItr->iconIndex;
+std::optional<int> ShellBrowser::GetCachedIconIndex(int internalIndex)
+{
+	return m_iconFetcher->GetCachedIconIndex(m_itemStore.GetParsingName(internalIndex));
 }
 
-void ShellBrowser::ProcessIconResult(int internalIndex, int iconIndex)
+void ShellBrowser::ProcessIconResult(int internalIndex, uint32_t itemGeneration, int iconIndex)
 {
+	if (!m_itemStore.Contains(internalIndex, itemGeneration))
+	{
+		return;
+	}
+
 	auto index = LocateItemByInternalIndex(internalIndex);
 
 	if (!index)
@@ -468,6 +557,24 @@ void ShellBrowser::ProcessIconResult(int internalIndex, int iconIndex)
 		return;
 	}
 
+	if (m_virtualListView)
+	{
+		// The icon is only used outside of thumbnails view. In thumbnails view, the image refers
+		// to the thumbnail imagelist instead.
+		if (m_folderSettings.viewMode == +ViewMode::Thumbnails)
+		{
+			return;
+		}
+
+		auto &itemData = m_directoryState.virtualItemData[internalIndex];
+		itemData.image = iconIndex & 0x00FFFFFF;
+		WI_UpdateFlagsInMask(itemData.state, LVIS_OVERLAYMASK,
+			INDEXTOOVERLAYMASK(iconIndex >> 24));
+
+		ListView_RedrawItems(m_hListView, *index, *index);
+		return;
+	}
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_IMAGE | LVIF_STATE;
 	lvItem.iItem = *index;
@@ -478,6 +585,48 @@ void ShellBrowser::ProcessIconResult(int internalIndex, int iconIndex)
 	ListView_SetItem(m_hListView, &lvItem);
 }
 
+// Display information is requested as items are scrolled into view, so this is a convenient point
+// at which to let the scheduler know which items are visible.
+void ShellBrowser::UpdateItemTaskViewport()
+{
+	auto [firstVisibleItem, lastVisibleItem] = GetVisibleItemRange();
+	m_itemTaskScheduler.SetViewport(firstVisibleItem, lastVisibleItem);
+}
+
+std::pair<int, int> ShellBrowser::GetVisibleItemRange() const
+{
+	if (m_folderSettings.viewMode == +ViewMode::Details
+		|| m_folderSettings.viewMode == +ViewMode::List)
+	{
+		int topIndex = ListView_GetTopIndex(m_hListView);
+		int countPerPage = ListView_GetCountPerPage(m_hListView);
+
+		// The count only includes items that are fully visible, so the extra item here accounts
+		// for an item that may be partially visible at the end.
+		return { topIndex, topIndex + countPerPage };
+	}
+
+	// In the other views, the top index isn't available, so the range is estimated based on the
+	// scroll position and item spacing. Items are laid out in rows, from left to right.
+	POINT origin;
+	ListView_GetOrigin(m_hListView, &origin);
+
+	DWORD spacing = ListView_GetItemSpacing(m_hListView,
+		m_folderSettings.viewMode == +ViewMode::SmallIcons);
+	int itemWidth = (std::max)(static_cast<int>(LOWORD(spacing)), 1);
+	int itemHeight = (std::max)(static_cast<int>(HIWORD(spacing)), 1);
+
+	RECT clientRect;
+	GetClientRect(m_hListView, &clientRect);
+
+	int itemsPerRow = (std::max)(GetRectWidth(&clientRect) / itemWidth, 1);
+	int firstRow = (std::max)(static_cast<int>(origin.y), 0) / itemHeight;
+	int lastRow = ((std::max)(static_cast<int>(origin.y), 0) + GetRectHeight(&clientRect))
+		/ itemHeight;
+
+	return { firstRow * itemsPerRow, ((lastRow + 1) * itemsPerRow) - 1 };
+}
+
 LRESULT ShellBrowser::OnListViewGetInfoTip(NMLVGETINFOTIP *getInfoTip)
 {
 	if (m_config->showInfoTips)
@@ -496,17 +645,27 @@ void ShellBrowser::QueueInfoTipTask(int internalIndex, const std::wstring &exist
 	int infoTipResultId = m_infoTipResultIDCounter++;
 
 	BasicItemInfo_t basicItemInfo = getBasicItemInfo(internalIndex);
+	uint32_t itemGeneration = m_itemStore.GetGeneration(internalIndex);
 	Config configCopy = *m_config;
 	bool virtualFolder = InVirtualFolder();
 
-	auto result = m_infoTipsThreadPool.push(
-		[this, infoTipResultId, internalIndex, basicItemInfo, configCopy, virtualFolder,
-			existingInfoTip](int id)
+	auto promise = std::make_shared<std::promise<std::optional<InfoTipResult>>>();
+	auto result = promise->get_future();
+
+	// Info tips are requested for the item under the cursor, so they're always wanted as soon as
+	// possible. They're not tied to a row and so will be run ahead of column and thumbnail tasks.
+	m_itemTaskScheduler.QueueTask(static_cast<int>(ItemTaskType::InfoTip), std::nullopt,
+		[listView = m_hListView, instance = m_hResourceModule, infoTipResultId, internalIndex,
+			itemGeneration, basicItemInfo, configCopy, virtualFolder, existingInfoTip,
+			promise](std::stop_token stopToken)
 		{
-			UNREFERENCED_PARAMETER(id);
+			if (stopToken.stop_requested())
+			{
+				return;
+			}
 
-			auto result = GetInfoTipAsync(m_hListView, infoTipResultId, internalIndex,
-				basicItemInfo, configCopy, m_hResourceModule, virtualFolder);
+			auto result = GetInfoTipAsync(listView, infoTipResultId, internalIndex,
+				itemGeneration, basicItemInfo, configCopy, instance, virtualFolder);
 
 			// If the item name is truncated in the listview,
 			// existingInfoTip will contain that value. Therefore, it's
@@ -517,15 +676,16 @@ void ShellBrowser::QueueInfoTipTask(int internalIndex, const std::wstring &exist
 				result->infoTip = existingInfoTip + L"\n" + result->infoTip;
 			}
 
-			return result;
+			promise->set_value(std::move(result));
 		});
 
 	m_infoTipResults.insert({ infoTipResultId, std::move(result) });
 }
 
 std::optional<ShellBrowser::InfoTipResult> ShellBrowser::GetInfoTipAsync(HWND listView,
-	int infoTipResultId, int internalIndex, const BasicItemInfo_t &basicItemInfo,
-	const Config &config, HINSTANCE instance, bool virtualFolder)
+	int infoTipResultId, int internalIndex, uint32_t itemGeneration,
+	const BasicItemInfo_t &basicItemInfo, const Config &config, HINSTANCE instance,
+	bool virtualFolder)
 {
 	std::wstring infoTip;
 
@@ -566,6 +726,7 @@ std::optional<ShellBrowser::InfoTipResult> ShellBrowser::GetInfoTipAsync(HWND li
 
 	InfoTipResult result;
 	result.itemInternalIndex = internalIndex;
+	result.itemGeneration = itemGeneration;
 	result.infoTip = infoTip;
 
 	return result;
@@ -583,7 +744,7 @@ void ShellBrowser::ProcessInfoTipResult(int infoTipResultId)
 	auto result = itr->second.get();
 	m_infoTipResults.erase(itr);
 
-	if (!result)
+	if (!result || !m_itemStore.Contains(result->itemInternalIndex, result->itemGeneration))
 	{
 		return;
 	}
@@ -627,6 +788,15 @@ void ShellBrowser::OnListViewItemChanged(const NMLISTVIEW *changeData)
 		return;
 	}
 
+	// In owner data mode, a change to the state of every item (e.g. when every item is selected or
+	// deselected) is reported through a single notification.
+	if (changeData->iItem == -1)
+	{
+		RecalculateFileSelectionInfo();
+		listViewSelectionChanged.m_signal();
+		return;
+	}
+
 	if (m_config->checkBoxSelection && (LVIS_STATEIMAGEMASK & changeData->uNewState) != 0)
 	{
 		bool checked = ((changeData->uNewState & LVIS_STATEIMAGEMASK) >> 12) == 2;
@@ -653,7 +823,25 @@ void ShellBrowser::OnListViewItemChanged(const NMLISTVIEW *changeData)
 		}
 	}
 
-	UpdateFileSelectionInfo(static_cast<int>(changeData->lParam), currentlySelected);
+	// The lParam value isn't set in owner data mode.
+	int internalIndex = m_virtualListView ? GetItemInternalIndex(changeData->iItem)
+										  : static_cast<int>(changeData->lParam);
+	UpdateFileSelectionInfo(internalIndex, currentlySelected);
+
+	listViewSelectionChanged.m_signal();
+}
+
+// Sent in owner data mode when the state of a range of items changes (e.g. when a range of items is
+// selected using the shift key).
+void ShellBrowser::OnListViewODStateChanged(const NMLVODSTATECHANGE *stateChange)
+{
+	if (WI_IsFlagSet(stateChange->uOldState, LVIS_SELECTED)
+		== WI_IsFlagSet(stateChange->uNewState, LVIS_SELECTED))
+	{
+		return;
+	}
+
+	RecalculateFileSelectionInfo();
 
 	listViewSelectionChanged.m_signal();
 }
@@ -663,11 +851,10 @@ void ShellBrowser::UpdateFileSelectionInfo(int internalIndex, BOOL selected)
 	ULARGE_INTEGER ulFileSize;
 	BOOL isFolder;
 
-	isFolder = (m_itemInfoMap.at(internalIndex).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+	isFolder = (m_itemStore.GetAttributes(internalIndex) & FILE_ATTRIBUTE_DIRECTORY)
 		== FILE_ATTRIBUTE_DIRECTORY;
 
-	ulFileSize.LowPart = m_itemInfoMap.at(internalIndex).wfd.nFileSizeLow;
-	ulFileSize.HighPart = m_itemInfoMap.at(internalIndex).wfd.nFileSizeHigh;
+	ulFileSize.QuadPart = m_itemStore.GetFileSize(internalIndex);
 
 	if (selected)
 	{
@@ -697,6 +884,20 @@ void ShellBrowser::UpdateFileSelectionInfo(int internalIndex, BOOL selected)
 	}
 }
 
+void ShellBrowser::RecalculateFileSelectionInfo()
+{
+	m_directoryState.numFilesSelected = 0;
+	m_directoryState.numFoldersSelected = 0;
+	m_directoryState.fileSelectionSize.QuadPart = 0;
+
+	int item = -1;
+
+	while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
+	{
+		UpdateFileSelectionInfo(GetItemInternalIndex(item), TRUE);
+	}
+}
+
 void ShellBrowser::OnListViewKeyDown(const NMLVKEYDOWN *lvKeyDown)
 {
 	switch (lvKeyDown->wVKey)
@@ -767,20 +968,13 @@ void ShellBrowser::OnListViewKeyDown(const NMLVKEYDOWN *lvKeyDown)
 	}
 }
 
-const ShellBrowser::ItemInfo_t &ShellBrowser::GetItemByIndex(int index) const
-{
-	int internalIndex = GetItemInternalIndex(index);
-	return m_itemInfoMap.at(internalIndex);
-}
-
-ShellBrowser::ItemInfo_t &ShellBrowser::GetItemByIndex(int index)
-{
-	int internalIndex = GetItemInternalIndex(index);
-	return m_itemInfoMap.at(internalIndex);
-}
-
 int ShellBrowser::GetItemInternalIndex(int item) const
 {
+	if (m_virtualListView)
+	{
+		return m_directoryState.virtualItems.GetInternalIndex(item);
+	}
+
 	LVITEM lvItem;
 	lvItem.mask = LVIF_PARAM;
 	lvItem.iItem = item;
@@ -797,11 +991,17 @@ int ShellBrowser::GetItemInternalIndex(int item) const
 
 void ShellBrowser::MarkItemAsCut(int item, bool cut)
 {
-	const auto &itemInfo = GetItemByIndex(item);
-
 	// If the file is hidden, prevent changes to its visibility state.
-	if (WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_HIDDEN))
+	if (WI_IsFlagSet(m_itemStore.GetAttributes(GetItemInternalIndex(item)), FILE_ATTRIBUTE_HIDDEN))
+	{
+		return;
+	}
+
+	if (m_virtualListView)
 	{
+		auto &itemData = m_directoryState.virtualItemData[GetItemInternalIndex(item)];
+		WI_UpdateFlag(itemData.state, LVIS_CUT, cut);
+		ListView_RedrawItems(m_hListView, item, item);
 		return;
 	}
 
@@ -998,10 +1198,10 @@ void ShellBrowser::SetFileAttributesForSelection()
 	{
 		NSetFileAttributesDialogExternal::SetFileAttributesInfo sfai;
 
-		const ItemInfo_t &item = GetItemByIndex(index);
-		sfai.wfd = item.wfd;
+		int internalIndex = GetItemInternalIndex(index);
+		sfai.wfd = m_itemStore.GetFindData(internalIndex);
 		StringCchCopy(sfai.szFullFileName, SIZEOF_ARRAY(sfai.szFullFileName),
-			item.parsingName.c_str());
+			m_itemStore.GetParsingName(internalIndex).c_str());
 
 		sfaiList.push_back(sfai);
 	}
@@ -1040,8 +1240,7 @@ HRESULT ShellBrowser::GetListViewSelectionAttributes(SFGAOF *attributes) const
 
 HRESULT ShellBrowser::GetListViewItemAttributes(int item, SFGAOF *attributes) const
 {
-	const auto &itemInfo = GetItemByIndex(item);
-	return GetItemAttributes(itemInfo.pidlComplete.get(), attributes);
+	return GetItemAttributes(m_itemStore.GetPidl(GetItemInternalIndex(item)), attributes);
 }
 
 std::vector<PCIDLIST_ABSOLUTE> ShellBrowser::GetSelectedItemPidls()
@@ -1051,8 +1250,7 @@ std::vector<PCIDLIST_ABSOLUTE> ShellBrowser::GetSelectedItemPidls()
 
 	while ((index = ListView_GetNextItem(m_hListView, index, LVNI_SELECTED)) != -1)
 	{
-		const auto &item = GetItemByIndex(index);
-		selectedItemPidls.push_back(item.pidlComplete.get());
+		selectedItemPidls.push_back(m_itemStore.GetPidl(GetItemInternalIndex(index)));
 	}
 
 	return selectedItemPidls;
@@ -1122,10 +1320,13 @@ void ShellBrowser::AutoSizeColumns()
 
 BOOL ShellBrowser::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 {
-	const auto &item = GetItemByIndex(dispInfo->item.iItem);
+	int internalIndex = GetItemInternalIndex(dispInfo->item.iItem);
+	bool isFolder =
+		WI_IsFlagSet(m_itemStore.GetAttributes(internalIndex), FILE_ATTRIBUTE_DIRECTORY);
+	std::wstring editingName(m_itemStore.GetEditingName(internalIndex));
 
 	SFGAOF attributes = SFGAO_CANRENAME;
-	HRESULT hr = GetItemAttributes(item.pidlComplete.get(), &attributes);
+	HRESULT hr = GetItemAttributes(m_itemStore.GetPidl(internalIndex), &attributes);
 
 	if (FAILED(hr) || WI_IsFlagClear(attributes, SFGAO_CANRENAME))
 	{
@@ -1144,7 +1345,7 @@ BOOL ShellBrowser::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 	// - Extensions are shown in Explorer, but hidden in Explorer++ (since the editing name would
 	//   contain an extension). Note that this case is handled when editing is finished - if
 	//   extensions are hidden, the extension will be manually re-added when renaming an item.
-	if (!WI_IsFlagSet(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	if (!isFolder)
 	{
 		std::wstring displayName = GetItemDisplayName(dispInfo->item.iItem);
 
@@ -1154,17 +1355,17 @@ BOOL ShellBrowser::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 			auto *extension = PathFindExtension(displayName.c_str());
 
 			if (*extension != '\0'
-				&& lstrcmp((item.editingName + extension).c_str(), displayName.c_str()) == 0)
+				&& lstrcmp((editingName + extension).c_str(), displayName.c_str()) == 0)
 			{
 				useEditingName = false;
 			}
 		}
 		else
 		{
-			auto *extension = PathFindExtension(item.editingName.c_str());
+			auto *extension = PathFindExtension(editingName.c_str());
 
 			if (*extension != '\0'
-				&& lstrcmp((displayName + extension).c_str(), item.editingName.c_str()) == 0)
+				&& lstrcmp((displayName + extension).c_str(), editingName.c_str()) == 0)
 			{
 				useEditingName = false;
 			}
@@ -1188,11 +1389,10 @@ BOOL ShellBrowser::OnListViewBeginLabelEdit(const NMLVDISPINFO *dispInfo)
 	// nothing that needs to be changed if editing is canceled.
 	if (useEditingName)
 	{
-		SetWindowText(editControl, item.editingName.c_str());
+		SetWindowText(editControl, editingName.c_str());
 	}
 
-	ListViewEdit::CreateNew(editControl, m_acceleratorTable,
-		WI_IsFlagClear(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY));
+	ListViewEdit::CreateNew(editControl, m_acceleratorTable, !isFolder);
 
 	return FALSE;
 }
@@ -1212,16 +1412,18 @@ BOOL ShellBrowser::OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo)
 		return FALSE;
 	}
 
-	const auto &item = GetItemByIndex(dispInfo->item.iItem);
+	int internalIndex = GetItemInternalIndex(dispInfo->item.iItem);
+	bool isFolder =
+		WI_IsFlagSet(m_itemStore.GetAttributes(internalIndex), FILE_ATTRIBUTE_DIRECTORY);
 
-	if (newFilename == item.editingName)
+	if (newFilename == m_itemStore.GetEditingName(internalIndex))
 	{
 		return FALSE;
 	}
 
-	if (!WI_IsFlagSet(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	if (!isFolder)
 	{
-		auto *extension = PathFindExtension(item.wfd.cFileName);
+		auto *extension = PathFindExtension(m_itemStore.GetFileName(internalIndex).data());
 
 		bool extensionHidden = !m_config->globalFolderSettings.showExtensions
 			|| (m_config->globalFolderSettings.hideLinkExtension
@@ -1237,7 +1439,8 @@ BOOL ShellBrowser::OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo)
 
 	wil::com_ptr_nothrow<IShellFolder> parent;
 	PCITEMID_CHILD child;
-	HRESULT hr = SHBindToParent(item.pidlComplete.get(), IID_PPV_ARGS(&parent), &child);
+	HRESULT hr =
+		SHBindToParent(m_itemStore.GetPidl(internalIndex), IID_PPV_ARGS(&parent), &child);
 
 	if (FAILED(hr))
 	{
@@ -1257,8 +1460,7 @@ BOOL ShellBrowser::OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo)
 	// extension would always be re-added by the shell.
 	// Therefore, if a file is being edited, the parsing name (which will always contain an
 	// extension) will be updated.
-	if (!m_directoryState.virtualFolder
-		&& !WI_IsFlagSet(item.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	if (!m_directoryState.virtualFolder && !isFolder)
 	{
 		flags |= SHGDN_FORPARSING;
 	}
@@ -1291,7 +1493,7 @@ BOOL ShellBrowser::OnListViewEndLabelEdit(const NMLVDISPINFO *dispInfo)
 	// Performing an immediate update here means that the user can continue to interact with the
 	// item, without having to wait for the rename notification to be processed.
 	unique_pidl_absolute pidlNew(ILCombine(m_directoryState.pidlDirectory.get(), newChild.get()));
-	UpdateItem(item.pidlComplete.get(), pidlNew.get());
+	UpdateItem(m_itemStore.GetPidl(internalIndex), pidlNew.get());
 
 	// The text will be set by UpdateItem. It's not safe to return true here, since items can sorted
 	// by UpdateItem, which can result in the index of this item being changed.
@@ -13,7 +13,12 @@ using NavigationCommittedSignal =
 	boost::signals2::signal<void(PCIDLIST_ABSOLUTE pidl, bool addHistoryEntry)>;
 using NavigationCompletedSignal = boost::signals2::signal<void(PCIDLIST_ABSOLUTE pidlDirectory)>;
 using NavigationFailedSignal = boost::signals2::signal<void()>;
+using NavigationCancelledSignal = boost::signals2::signal<void()>;
 
+// Navigations complete asynchronously. A successful return value from BrowseFolder() only means
+// that the navigation has started. Once it finishes, one of the completed, failed or cancelled
+// signals will be emitted. A navigation is cancelled if another navigation starts before it has
+// completed.
 __interface NavigatorInterface
 {
 	HRESULT BrowseFolder(const HistoryEntry &entry);
@@ -30,4 +35,7 @@ __interface NavigatorInterface
 	boost::signals2::connection AddNavigationFailedObserver(
 		const NavigationFailedSignal::slot_type &observer,
 		boost::signals2::connect_position position = boost::signals2::at_back);
+	boost::signals2::connection AddNavigationCancelledObserver(
+		const NavigationCancelledSignal::slot_type &observer,
+		boost::signals2::connect_position position = boost::signals2::at_back);
 };
@@ -4,6 +4,7 @@
 
 #include "stdafx.h"
 #include "ShellBrowser.h"
+#include "ColorRuleMatcher.h"
 #include "Config.h"
 #include "CoreInterface.h"
 #include "DarkModeHelper.h"
@@ -25,8 +26,11 @@
 #include "../Helper/ListViewHelper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/StringHelper.h"
 #include <wil/com.h>
+#include <wil/common.h>
 #include <winrt/base.h>
+#include <algorithm>
 #include <list>
 
 void CALLBACK TimerProc(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime);
@@ -66,37 +70,48 @@ ShellBrowser::ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface
 ShellBrowser::ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface,
 	TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
 	const FolderSettings &folderSettings, const FolderColumns *initialColumns) :
-	ShellDropTargetWindow(CreateListView(hOwner)),
+	ShellDropTargetWindow(CreateListView(hOwner, coreInterface->GetConfig()->virtualListView)),
 	m_hListView(GetHWND()),
 	m_ID(id),
 	m_shChangeNotifyId(0),
 	m_hResourceModule(coreInterface->GetLanguageModule()),
 	m_acceleratorTable(coreInterface->GetAcceleratorTable()),
 	m_hOwner(hOwner),
-	m_cachedIcons(coreInterface->GetCachedIcons()),
 	m_iconResourceLoader(coreInterface->GetIconResourceLoader()),
 	m_config(coreInterface->GetConfig()),
+	m_virtualListView(m_config->virtualListView),
+	m_virtualSelectionUpdateDepth(0),
 	m_tabNavigation(tabNavigation),
 	m_fileActionHandler(fileActionHandler),
 	m_folderSettings(folderSettings),
+	m_filterPattern(folderSettings.filter, folderSettings.filterCaseSensitive),
+	m_filterPatternHistory({ m_filterPattern }),
 	m_folderColumns(initialColumns
 			? *initialColumns
 			: coreInterface->GetConfig()->globalFolderSettings.folderColumns),
-	m_columnThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
+	m_enumerationTaskGroup(WorkerPool::GetInstance(), WorkerPool::Priority::Background),
+	m_enumerationIdCounter(0),
+	m_hibernated(false),
+	m_itemTaskScheduler(WorkerPool::GetInstance(), WorkerPool::Priority::Background,
+		std::bind_front(&ShellBrowser::LocateItemByInternalIndex, this)),
 	m_columnResultIDCounter(0),
-	m_thumbnailThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
 	m_thumbnailResultIDCounter(0),
-	m_infoTipsThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
 	m_infoTipResultIDCounter(0),
+	m_groupResultIdCounter(0),
+	m_filterResultIdCounter(0),
 	m_rightClickDragAllowed(false),
 	m_draggedDataObject(nullptr),
 	m_shellWindowRegistered(false)
 {
+	// Groups can't be used in owner data mode.
+	if (m_virtualListView)
+	{
+		m_folderSettings.showInGroups = FALSE;
+	}
+
 	InitializeListView();
-	m_iconFetcher = std::make_unique<IconFetcher>(m_hListView, m_cachedIcons);
+	m_iconFetcher = std::make_unique<IconFetcher>(coreInterface->GetIconService(),
+		WorkerPool::Priority::Background);
 	m_navigationController =
 		std::make_unique<ShellNavigationController>(this, tabNavigation, m_iconFetcher.get());
 
@@ -151,25 +166,32 @@ ShellBrowser::~ShellBrowser()
 
 	DestroyWindow(m_hListView);
 
-	m_columnThreadPool.clear_queue();
-	m_thumbnailThreadPool.clear_queue();
-	m_infoTipsThreadPool.clear_queue();
+	CancelEnumeration();
+
+	m_itemTaskScheduler.CancelAll();
 
 	DeleteCriticalSection(&m_csDirectoryAltered);
 
 	/* TODO: Also destroy the thumbnails imagelist. */
 }
 
-HWND ShellBrowser::CreateListView(HWND parent)
+HWND ShellBrowser::CreateListView(HWND parent, bool virtualListView)
 {
 	// Note that the only reason LVS_REPORT is specified here is so that the listview header theme
 	// can be set immediately when in dark mode. Without this style, ListView_GetHeader() will
 	// return NULL. The actual view mode set here doesn't matter, since it will be updated when
 	// navigating to a folder.
-	return ::CreateListView(parent,
-		WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN | LVS_REPORT | LVS_EDITLABELS
-			| LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS | LVS_AUTOARRANGE | WS_TABSTOP
-			| LVS_ALIGNTOP);
+	DWORD style = WS_CHILD | WS_VISIBLE | WS_CLIPSIBLINGS | WS_CLIPCHILDREN | LVS_REPORT
+		| LVS_EDITLABELS | LVS_SHOWSELALWAYS | LVS_SHAREIMAGELISTS | LVS_AUTOARRANGE | WS_TABSTOP
+		| LVS_ALIGNTOP;
+
+	// Note that this style can't be added or removed once the listview has been created.
+	if (virtualListView)
+	{
+		WI_SetFlag(style, LVS_OWNERDATA);
+	}
+
+	return ::CreateListView(parent, style);
 }
 
 void ShellBrowser::InitializeListView()
@@ -181,13 +203,22 @@ void ShellBrowser::InitializeListView()
 		dwExtendedStyle |= LVS_EX_FULLROWSELECT;
 	}
 
-	if (m_config->checkBoxSelection)
+	// In owner data mode, the check state of each item would have to be stored separately, so
+	// check box selection isn't supported.
+	if (m_config->checkBoxSelection && !m_virtualListView)
 	{
 		dwExtendedStyle |= LVS_EX_CHECKBOXES;
 	}
 
 	ListView_SetExtendedListViewStyle(m_hListView, dwExtendedStyle);
 
+	// The listview only stores the selection and focus state of each item in owner data mode. The
+	// other states that are used are provided when each item is drawn.
+	if (m_virtualListView)
+	{
+		ListView_SetCallbackMask(m_hListView, LVIS_CUT | LVIS_OVERLAYMASK);
+	}
+
 	ListViewHelper::SetAutoArrange(m_hListView, m_folderSettings.autoArrange);
 	ListViewHelper::SetGridlines(m_hListView, m_config->globalFolderSettings.showGridlines);
 
@@ -365,7 +396,7 @@ void ShellBrowser::SetViewModeInternal(ViewMode viewMode)
 
 	if (viewMode != +ViewMode::Details)
 	{
-		m_columnThreadPool.clear_queue();
+		m_itemTaskScheduler.Cancel(static_cast<int>(ItemTaskType::Column));
 		m_columnResults.clear();
 	}
 
@@ -377,6 +408,12 @@ void ShellBrowser::SetViewModeInternal(ViewMode viewMode)
 	ViewMode previousViewMode = m_folderSettings.viewMode;
 	m_folderSettings.viewMode = viewMode;
 
+	// The images and text that have been retrieved are specific to the previous view mode.
+	if (m_virtualListView)
+	{
+		ResetVirtualItemData();
+	}
+
 	SendMessage(m_hListView, LVM_SETVIEW, dwStyle, 0);
 
 	if (previousViewMode != +ViewMode::Details && viewMode == +ViewMode::Details)
@@ -402,6 +439,12 @@ void ShellBrowser::SetViewModeInternal(ViewMode viewMode)
 
 void ShellBrowser::SetFirstColumnTextToCallback()
 {
+	// In owner data mode, the item text is always retrieved when it's needed.
+	if (m_virtualListView)
+	{
+		return;
+	}
+
 	int numItems = ListView_GetItemCount(m_hListView);
 
 	for (int i = 0; i < numItems; i++)
@@ -412,6 +455,11 @@ void ShellBrowser::SetFirstColumnTextToCallback()
 
 void ShellBrowser::SetFirstColumnTextToFilename()
 {
+	if (m_virtualListView)
+	{
+		return;
+	}
+
 	int numItems = ListView_GetItemCount(m_hListView);
 
 	for (int i = 0; i < numItems; i++)
@@ -456,6 +504,13 @@ int ShellBrowser::GetId() const
 	return m_ID;
 }
 
+void ShellBrowser::SetTaskPriority(WorkerPool::Priority priority)
+{
+	m_itemTaskScheduler.SetPriority(priority);
+	m_iconFetcher->SetPriority(priority);
+	m_enumerationTaskGroup.SetPriority(priority);
+}
+
 void ShellBrowser::OnGridlinesSettingChanged()
 {
 	ListViewHelper::SetGridlines(m_hListView, m_config->globalFolderSettings.showGridlines);
@@ -463,7 +518,7 @@ void ShellBrowser::OnGridlinesSettingChanged()
 
 std::wstring ShellBrowser::GetItemName(int index) const
 {
-	return GetItemByIndex(index).wfd.cFileName;
+	return std::wstring(m_itemStore.GetFileName(GetItemInternalIndex(index)));
 }
 
 // Returns the name of the item as it's shown to the user. Note that this name may not be unique.
@@ -483,7 +538,29 @@ std::wstring ShellBrowser::GetItemDisplayName(int index) const
 
 std::wstring ShellBrowser::GetItemFullName(int index) const
 {
-	return GetItemByIndex(index).parsingName;
+	return m_itemStore.GetParsingName(GetItemInternalIndex(index));
+}
+
+// This is called each time an item is drawn, so the result is cached. The cached result will only
+// be used if it was produced by the same matcher (i.e. the color rules haven't changed since).
+std::optional<COLORREF> ShellBrowser::GetItemColor(int index,
+	const ColorRuleMatcher &colorRuleMatcher)
+{
+	int internalIndex = GetItemInternalIndex(index);
+	const auto &cachedColor = m_itemStore.GetCachedColor(internalIndex);
+
+	if (cachedColor && cachedColor->colorRuleMatcherId == colorRuleMatcher.GetId())
+	{
+		return cachedColor->color;
+	}
+
+	std::wstring parsingName = m_itemStore.GetParsingName(internalIndex);
+	std::wstring fileName = PathFindFileName(parsingName.c_str());
+	auto color =
+		colorRuleMatcher.GetMatchingColor(fileName, m_itemStore.GetAttributes(internalIndex));
+	m_itemStore.SetCachedColor(internalIndex, { colorRuleMatcher.GetId(), color });
+
+	return color;
 }
 
 std::wstring ShellBrowser::GetDirectory() const
@@ -505,7 +582,7 @@ void ShellBrowser::SelectItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls)
 
 	for (auto &pidl : pidls)
 	{
-		auto internalIndex = GetItemInternalIndexForPidl(pidl);
+		auto internalIndex = GetItemInternalIndexForSimplePidl(pidl);
 
 		if (!internalIndex)
 		{
@@ -536,19 +613,11 @@ void ShellBrowser::SelectItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls)
 
 int ShellBrowser::LocateFileItemIndex(const TCHAR *szFileName) const
 {
-	LV_FINDINFO lvFind;
-	int iItem;
-	int iInternalIndex;
-
-	iInternalIndex = LocateFileItemInternalIndex(szFileName);
+	int iInternalIndex = LocateFileItemInternalIndex(szFileName);
 
 	if (iInternalIndex != -1)
 	{
-		lvFind.flags = LVFI_PARAM;
-		lvFind.lParam = iInternalIndex;
-		iItem = ListView_FindItem(m_hListView, -1, &lvFind);
-
-		return iItem;
+		return LocateItemByInternalIndex(iInternalIndex).value_or(-1);
 	}
 
 	return -1;
@@ -556,13 +625,28 @@ int ShellBrowser::LocateFileItemIndex(const TCHAR *szFileName) const
 
 int ShellBrowser::LocateFileItemInternalIndex(const TCHAR *szFileName) const
 {
+	if (!m_directoryState.virtualFolder)
+	{
+		// Within a filesystem folder, the parsing name of an item is simply its full path.
+		std::wstring parsingName = m_directoryState.directory;
+
+		if (!parsingName.empty() && parsingName.back() != '\\')
+		{
+			parsingName += '\\';
+		}
+
+		parsingName += szFileName;
+
+		return FindItemInternalIndexByParsingName(parsingName).value_or(-1);
+	}
+
 	for (int i = 0; i < m_directoryState.numItems; i++)
 	{
-		const auto &item = GetItemByIndex(i);
+		int internalIndex = GetItemInternalIndex(i);
 
-		if (lstrcmp(item.wfd.cFileName, szFileName) == 0)
+		if (lstrcmp(m_itemStore.GetFileName(internalIndex).data(), szFileName) == 0)
 		{
-			return GetItemInternalIndex(i);
+			return internalIndex;
 		}
 	}
 
@@ -583,22 +667,167 @@ std::optional<int> ShellBrowser::GetItemIndexForPidl(PCIDLIST_ABSOLUTE pidl) con
 
 std::optional<int> ShellBrowser::GetItemInternalIndexForPidl(PCIDLIST_ABSOLUTE pidl) const
 {
-	auto itr = std::find_if(m_itemInfoMap.begin(), m_itemInfoMap.end(),
-		[pidl](const auto &pair)
+	// In the common case, the pidl will have come from the item itself, in which case the child ID
+	// will match exactly. The pidl could still refer to an item in a different folder, so the match
+	// needs to be verified.
+	auto pidlItr = m_directoryState.childPidlIndex.find(GetChildPidlIndexKey(ILFindLastID(pidl)));
+
+	if (pidlItr != m_directoryState.childPidlIndex.end()
+		&& ArePidlsEquivalent(pidl, m_itemStore.GetPidl(pidlItr->second)))
+	{
+		return pidlItr->second;
+	}
+
+	// Within filesystem folders, retrieving the parsing name of the pidl would require a round
+	// trip through the shell, which isn't worth doing for every miss. Callers that have a pidl
+	// which didn't come from the enumeration can use GetItemInternalIndexForSimplePidl() instead.
+	if (!m_directoryState.virtualFolder)
+	{
+		return std::nullopt;
+	}
+
+	// Parsing names within virtual folders aren't guaranteed to be unique, so any item found by
+	// name still needs to be verified. If none of them match, every item is compared.
+	std::wstring parsingName;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, parsingName);
+
+	if (SUCCEEDED(hr))
+	{
+		auto [begin, end] =
+			m_directoryState.parsingNameIndex.equal_range(GetParsingNameIndexKey(parsingName));
+
+		for (auto itr = begin; itr != end; ++itr)
 		{
-			return ArePidlsEquivalent(pidl, pair.second.pidlComplete.get());
-		});
+			if (ArePidlsEquivalent(pidl, m_itemStore.GetPidl(itr->second)))
+			{
+				return itr->second;
+			}
+		}
+	}
+
+	for (int internalIndex = 0; internalIndex < m_itemStore.GetSlotCount(); internalIndex++)
+	{
+		if (m_itemStore.Contains(internalIndex)
+			&& ArePidlsEquivalent(pidl, m_itemStore.GetPidl(internalIndex)))
+		{
+			return internalIndex;
+		}
+	}
+
+	return std::nullopt;
+}
+
+// Pidls built from a path (e.g. the simple pidls passed in change notifications) won't necessarily
+// contain the same data as the pidl retrieved during enumeration, but they will have the same
+// parsing name. Note that, like filesystem names, parsing names are matched case-insensitively.
+std::optional<int> ShellBrowser::GetItemInternalIndexForSimplePidl(
+	PCIDLIST_ABSOLUTE simplePidl) const
+{
+	auto internalIndex = GetItemInternalIndexForPidl(simplePidl);
+
+	if (internalIndex || m_directoryState.virtualFolder)
+	{
+		return internalIndex;
+	}
+
+	return FindItemInternalIndexByDisplayName(simplePidl);
+}
+
+std::optional<int> ShellBrowser::FindItemInternalIndexByDisplayName(PCIDLIST_ABSOLUTE pidl) const
+{
+	std::wstring parsingName;
+	HRESULT hr = GetDisplayName(pidl, SHGDN_FORPARSING, parsingName);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	return FindItemInternalIndexByParsingName(parsingName);
+}
 
-	if (itr == m_itemInfoMap.end())
+// If several items have names that only differ in case, the item whose name matches exactly is
+// preferred.
+std::optional<int> ShellBrowser::FindItemInternalIndexByParsingName(
+	const std::wstring &parsingName) const
+{
+	auto [begin, end] =
+		m_directoryState.parsingNameIndex.equal_range(GetParsingNameIndexKey(parsingName));
+
+	if (begin == end)
 	{
 		return std::nullopt;
 	}
 
-	return itr->first;
+	for (auto itr = begin; itr != end; ++itr)
+	{
+		if (m_itemStore.GetParsingName(itr->second) == parsingName)
+		{
+			return itr->second;
+		}
+	}
+
+	return begin->second;
+}
+
+void ShellBrowser::AddItemToIndexes(int internalIndex)
+{
+	m_directoryState.parsingNameIndex.emplace(
+		GetParsingNameIndexKey(m_itemStore.GetParsingName(internalIndex)), internalIndex);
+	m_directoryState.childPidlIndex.insert_or_assign(
+		GetChildPidlIndexKey(m_itemStore.GetChildPidl(internalIndex)), internalIndex);
+}
+
+void ShellBrowser::RemoveItemFromIndexes(int internalIndex)
+{
+	// Other items can share the same parsing name key, so only the entry for this item is removed.
+	auto [begin, end] = m_directoryState.parsingNameIndex.equal_range(
+		GetParsingNameIndexKey(m_itemStore.GetParsingName(internalIndex)));
+
+	for (auto itr = begin; itr != end; ++itr)
+	{
+		if (itr->second == internalIndex)
+		{
+			m_directoryState.parsingNameIndex.erase(itr);
+			break;
+		}
+	}
+
+	// An entry is only removed if it still refers to this item. If another item has since been
+	// added with the same key (e.g. an item was renamed to the name of an item that was removed),
+	// the entry will refer to that item instead.
+	auto pidlItr = m_directoryState.childPidlIndex.find(
+		GetChildPidlIndexKey(m_itemStore.GetChildPidl(internalIndex)));
+
+	if (pidlItr != m_directoryState.childPidlIndex.end() && pidlItr->second == internalIndex)
+	{
+		m_directoryState.childPidlIndex.erase(pidlItr);
+	}
+}
+
+// Parsing names are matched case-insensitively, since filesystem names are case-insensitive.
+std::wstring ShellBrowser::GetParsingNameIndexKey(const std::wstring &parsingName)
+{
+	return FoldStringCase(parsingName);
+}
+
+std::string ShellBrowser::GetChildPidlIndexKey(PCUITEMID_CHILD pidlChild)
+{
+	if (!pidlChild)
+	{
+		return {};
+	}
+
+	return std::string(reinterpret_cast<const char *>(pidlChild), ILGetSize(pidlChild));
 }
 
 std::optional<int> ShellBrowser::LocateItemByInternalIndex(int internalIndex) const
 {
+	if (m_virtualListView)
+	{
+		return m_directoryState.virtualItems.GetPosition(internalIndex);
+	}
+
 	LVFINDINFO lvfi;
 	lvfi.flags = LVFI_PARAM;
 	lvfi.lParam = internalIndex;
@@ -614,17 +843,17 @@ std::optional<int> ShellBrowser::LocateItemByInternalIndex(int internalIndex) co
 
 WIN32_FIND_DATA ShellBrowser::GetItemFileFindData(int index) const
 {
-	return GetItemByIndex(index).wfd;
+	return m_itemStore.GetFindData(GetItemInternalIndex(index));
 }
 
 unique_pidl_absolute ShellBrowser::GetItemCompleteIdl(int index) const
 {
-	return unique_pidl_absolute(ILCloneFull(GetItemByIndex(index).pidlComplete.get()));
+	return unique_pidl_absolute(ILCloneFull(m_itemStore.GetPidl(GetItemInternalIndex(index))));
 }
 
 unique_pidl_child ShellBrowser::GetItemChildIdl(int index) const
 {
-	return unique_pidl_child(ILCloneChild(GetItemByIndex(index).pridl.get()));
+	return unique_pidl_child(ILCloneChild(m_itemStore.GetChildPidl(GetItemInternalIndex(index))));
 }
 
 bool ShellBrowser::InVirtualFolder() const
@@ -678,11 +907,6 @@ BOOL ShellBrowser::CompareVirtualFolders(UINT uFolderCSIDL) const
 	return FALSE;
 }
 
-int ShellBrowser::GenerateUniqueItemId()
-{
-	return m_directoryState.itemIDCounter++;
-}
-
 void ShellBrowser::PositionDroppedItems()
 {
 	std::list<DroppedFile_t>::iterator itr;
@@ -690,8 +914,9 @@ void ShellBrowser::PositionDroppedItems()
 	int iItem;
 
 	/* LVNI_TOLEFT and LVNI_TORIGHT cause exceptions
-	in details view. */
-	if (m_folderSettings.viewMode == +ViewMode::Details)
+	in details view. Items also can't be positioned
+	manually in owner data mode. */
+	if (m_folderSettings.viewMode == +ViewMode::Details || m_virtualListView)
 	{
 		m_droppedFileNameList.clear();
 		return;
@@ -872,6 +1097,19 @@ void ShellBrowser::PositionDroppedItems()
 
 int ShellBrowser::DetermineItemSortedPosition(LPARAM lParam) const
 {
+	// This is only used when the existing items are in sorted order, so in owner data mode, where
+	// the order is stored directly, the position can be found using a binary search.
+	if (m_virtualListView)
+	{
+		const auto &items = m_directoryState.virtualItems.GetItems();
+		auto itr = std::partition_point(items.begin(), items.end(),
+			[this, lParam](int internalIndex)
+			{
+				return Sort(static_cast<int>(lParam), internalIndex) > 0;
+			});
+		return static_cast<int>(itr - items.begin());
+	}
+
 	LVITEM lvItem;
 	BOOL bItem;
 	int res = 1;
@@ -1038,9 +1276,7 @@ void ShellBrowser::QueueRename(PCIDLIST_ABSOLUTE pidlItem)
 
 	for (int i = 0; i < numItems; i++)
 	{
-		const auto &item = GetItemByIndex(i);
-
-		if (ArePidlsEquivalent(pidlItem, item.pidlComplete.get()))
+		if (ArePidlsEquivalent(pidlItem, m_itemStore.GetPidl(GetItemInternalIndex(i))))
 		{
 			ListView_EditLabel(m_hListView, i);
 			return;
@@ -1203,16 +1439,12 @@ void ShellBrowser::UpdateDriveIcon(const TCHAR *szDrive)
 	{
 		for (i = 0; i < m_directoryState.numItems; i++)
 		{
-			lvItem.mask = LVIF_PARAM;
-			lvItem.iItem = i;
-			lvItem.iSubItem = 0;
-			ListView_GetItem(m_hListView, &lvItem);
+			int internalIndex = GetItemInternalIndex(i);
 
-			if (ArePidlsEquivalent(pidlDrive.get(),
-					m_itemInfoMap.at((int) lvItem.lParam).pidlComplete.get()))
+			if (ArePidlsEquivalent(pidlDrive.get(), m_itemStore.GetPidl(internalIndex)))
 			{
 				iItem = i;
-				iItemInternal = (int) lvItem.lParam;
+				iItemInternal = internalIndex;
 
 				break;
 			}
@@ -1223,7 +1455,14 @@ void ShellBrowser::UpdateDriveIcon(const TCHAR *szDrive)
 	{
 		SHGetFileInfo(szDrive, 0, &shfi, sizeof(shfi), SHGFI_SYSICONINDEX);
 
-		m_itemInfoMap.at(iItemInternal).displayName = displayName;
+		m_itemStore.SetDisplayName(iItemInternal, displayName);
+
+		if (m_virtualListView)
+		{
+			InvalidateVirtualItemText(iItem);
+			SetItemImage(iItem, shfi.iIcon);
+			return;
+		}
 
 		/* Update the drives icon and display name. */
 		lvItem.mask = LVIF_TEXT | LVIF_IMAGE;
@@ -1237,22 +1476,18 @@ void ShellBrowser::UpdateDriveIcon(const TCHAR *szDrive)
 
 void ShellBrowser::RemoveDrive(const TCHAR *szDrive)
 {
-	LVITEM lvItem;
 	int iItemInternal = -1;
 	int i = 0;
 
 	for (i = 0; i < m_directoryState.numItems; i++)
 	{
-		lvItem.mask = LVIF_PARAM;
-		lvItem.iItem = i;
-		lvItem.iSubItem = 0;
-		ListView_GetItem(m_hListView, &lvItem);
+		int internalIndex = GetItemInternalIndex(i);
 
-		if (m_itemInfoMap.at((int) lvItem.lParam).bDrive)
+		if (m_itemStore.IsDrive(internalIndex))
 		{
-			if (lstrcmp(szDrive, m_itemInfoMap.at((int) lvItem.lParam).szDrive) == 0)
+			if (lstrcmp(szDrive, m_itemStore.GetParsingName(internalIndex).c_str()) == 0)
 			{
-				iItemInternal = (int) lvItem.lParam;
+				iItemInternal = internalIndex;
 				break;
 			}
 		}
@@ -1269,20 +1504,14 @@ int ShellBrowser::GetUniqueFolderId() const
 	return m_uniqueFolderId;
 }
 
-BasicItemInfo_t ShellBrowser::getBasicItemInfo(int internalIndex) const
+const ShellChangeCoalescer::Stats &ShellBrowser::GetShellChangeStats() const
 {
-	const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
-
-	BasicItemInfo_t basicItemInfo;
-	basicItemInfo.pidlComplete.reset(ILCloneFull(itemInfo.pidlComplete.get()));
-	basicItemInfo.pridl.reset(ILCloneChild(itemInfo.pridl.get()));
-	basicItemInfo.wfd = itemInfo.wfd;
-	basicItemInfo.isFindDataValid = itemInfo.isFindDataValid;
-	StringCchCopy(basicItemInfo.szDisplayName, SIZEOF_ARRAY(basicItemInfo.szDisplayName),
-		itemInfo.displayName.c_str());
-	basicItemInfo.isRoot = itemInfo.bDrive;
+	return m_shellChangeCoalescer.GetStats();
+}
 
-	return basicItemInfo;
+BasicItemInfo_t ShellBrowser::getBasicItemInfo(int internalIndex) const
+{
+	return m_itemStore.GetBasicItemInfo(internalIndex);
 }
 
 HWND ShellBrowser::GetListView() const
@@ -1302,8 +1531,7 @@ void ShellBrowser::DeleteSelectedItems(bool permanent)
 
 	while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
 	{
-		auto &itemInfo = GetItemByIndex(item);
-		pidls.push_back(itemInfo.pidlComplete.get());
+		pidls.push_back(m_itemStore.GetPidl(GetItemInternalIndex(item)));
 	}
 
 	if (pidls.empty())
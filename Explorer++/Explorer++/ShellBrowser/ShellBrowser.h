@@ -6,16 +6,22 @@
 
 #include "ColumnDataRetrieval.h"
 #include "Columns.h"
+#include "FilterMatchSet.h"
 #include "FolderSettings.h"
+#include "ItemStore.h"
 #include "NavigatorInterface.h"
 #include "ServiceProvider.h"
+#include "ShellChangeCoalescer.h"
 #include "SignalWrapper.h"
 #include "SortModes.h"
 #include "ViewModes.h"
+#include "VirtualItemList.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellDropTargetWindow.h"
 #include "../Helper/ShellHelper.h"
-#include "../ThirdParty/CTPL/cpl_stl.h"
+#include "../Helper/StringHelper.h"
+#include "../Helper/ViewportTaskScheduler.h"
+#include "../Helper/WorkerPool.h"
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index_container.hpp>
@@ -24,18 +30,23 @@
 #include <wil/resource.h>
 #include <winrt/base.h>
 #include <thumbcache.h>
+#include <functional>
 #include <future>
 #include <list>
+#include <mutex>
 #include <optional>
+#include <stop_token>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
 #define WM_USER_UPDATEWINDOWS (WM_APP + 17)
 #define WM_USER_FILESADDED (WM_APP + 51)
 
 struct BasicItemInfo_t;
-class CachedIcons;
+class ColorRuleMatcher;
 struct Config;
+struct DirectoryChange;
 class FileActionHandler;
 class IconFetcher;
 class IconResourceLoader;
@@ -87,6 +98,9 @@ public:
 	boost::signals2::connection AddNavigationFailedObserver(
 		const NavigationFailedSignal::slot_type &observer,
 		boost::signals2::connect_position position = boost::signals2::at_back) override;
+	boost::signals2::connection AddNavigationCancelledObserver(
+		const NavigationCancelledSignal::slot_type &observer,
+		boost::signals2::connect_position position = boost::signals2::at_back) override;
 
 	/* Get/Set current state. */
 	unique_pidl_absolute GetDirectoryIdl() const;
@@ -111,13 +125,27 @@ public:
 	/* ID. */
 	int GetId() const;
 
+	// Work done on behalf of this tab (e.g. retrieving column text, thumbnails and icons) is run on
+	// the shared WorkerPool. The work for the selected tab should be given a higher priority than
+	// the work for tabs in the background.
+	void SetTaskPriority(WorkerPool::Priority priority);
+
+	// Hibernating a tab releases the items in the current folder, along with the state associated
+	// with them, leaving only the history, selection and scroll position. The folder is reloaded
+	// when the tab is rehydrated. Returns the approximate number of bytes released, or nothing if
+	// the tab can't currently be hibernated (e.g. because the folder is still being loaded).
+	std::optional<size_t> Hibernate();
+	void Rehydrate();
+	bool IsHibernated() const;
+
 	/* Directory modification support. */
-	void FilesModified(DWORD Action, const TCHAR *FileName, int EventId, int iFolderIndex);
+	void FilesModified(const std::vector<DirectoryChange> &changes, int EventId, int iFolderIndex);
 	void DirectoryAltered();
 	void SetDirMonitorId(int dirMonitorId);
 	void ClearDirMonitorId();
 	std::optional<int> GetDirMonitorId() const;
 	int GetUniqueFolderId() const;
+	const ShellChangeCoalescer::Stats &GetShellChangeStats() const;
 
 	/* Item information. */
 	WIN32_FIND_DATA GetItemFileFindData(int index) const;
@@ -126,6 +154,7 @@ public:
 	std::wstring GetItemName(int index) const;
 	std::wstring GetItemDisplayName(int index) const;
 	std::wstring GetItemFullName(int index) const;
+	std::optional<COLORREF> GetItemColor(int index, const ColorRuleMatcher &colorRuleMatcher);
 
 	void ShowPropertiesForSelectedFiles() const;
 
@@ -150,6 +179,12 @@ public:
 	void SetFileAttributesForSelection();
 
 	void SelectItems(const std::vector<PCIDLIST_ABSOLUTE> &pidls);
+
+	// Folders are enumerated asynchronously, so items in the folder being navigated to can only be
+	// selected once the navigation has completed. The items are attached to the navigation that's
+	// currently in progress and are dropped if that navigation fails or is cancelled.
+	void SelectItemsOnNavigationCompleted(const std::vector<PCIDLIST_ABSOLUTE> &pidls);
+
 	void GetFolderInfo(FolderInfo_t *pFolderInfo);
 	int LocateFileItemIndex(const TCHAR *szFileName) const;
 	bool InVirtualFolder() const;
@@ -182,50 +217,62 @@ public:
 private:
 	DISALLOW_COPY_AND_ASSIGN(ShellBrowser);
 
-	struct ItemInfo_t
+	enum class EnumerationStatus
 	{
-		unique_pidl_absolute pidlComplete;
-		unique_pidl_child pridl;
-		WIN32_FIND_DATA wfd;
-		bool isFindDataValid;
-		std::wstring parsingName;
-		std::wstring displayName;
-		std::wstring editingName;
-		int iIcon;
-
-		/* These are only used for drives. They are
-		needed for when a drive is removed from the
-		system, in which case the drive name is needed
-		so that the removed drive can be found. */
-		BOOL bDrive;
-		TCHAR szDrive[4];
-
-		/* Used for temporary sorting in details mode (i.e.
-		when items need to be rearranged). */
-		int iRelativeSort;
-
-		ItemInfo_t() : wfd({}), isFindDataValid(false), iIcon(0), bDrive(FALSE)
-		{
-		}
+		Pending,
+		Started,
+		Failed,
+		Finished
 	};
 
-	struct ShellChangeNotification
+	// Folders are enumerated on a background thread. This structure is shared between that thread
+	// and the UI thread. Items are handed over to the UI thread in batches, so that they can be
+	// inserted into the listview while the enumeration is still in progress.
+	struct EnumerationContext
 	{
-		LONG event;
-		unique_pidl_absolute pidl1;
-		unique_pidl_absolute pidl2;
-
-		ShellChangeNotification(LONG event, PCIDLIST_ABSOLUTE pidl1, PCIDLIST_ABSOLUTE pidl2) :
-			event(event),
-			pidl1(pidl1 ? ILCloneFull(pidl1) : nullptr),
-			pidl2(pidl2 ? ILCloneFull(pidl2) : nullptr)
+		int id;
+		unique_pidl_absolute pidlDirectory;
+		std::wstring parsingPath;
+		bool virtualFolder;
+		bool isRecycleBin;
+		bool addHistoryEntry;
+		SHCONTF enumFlags;
+
+		// Stopped by the UI thread when the enumeration is no longer required (e.g. because the
+		// user has navigated elsewhere). The background thread will stop as soon as it notices
+		// this.
+		std::stop_source stopSource;
+
+		// The following members are shared between threads and protected by the mutex.
+		std::mutex mutex;
+		EnumerationStatus status;
+		std::vector<ItemInfo_t> pendingItems;
+		bool notificationPending;
+
+		// The following members are only accessed on the UI thread.
+		bool committed;
+		std::vector<unique_pidl_absolute> itemsToSelect;
+
+		// If set, the listview will be scrolled so that this item is at the top once the
+		// enumeration has finished.
+		unique_pidl_absolute itemToScrollTo;
+
+		EnumerationContext() :
+			id(0),
+			virtualFolder(false),
+			isRecycleBin(false),
+			addHistoryEntry(false),
+			enumFlags(0),
+			status(EnumerationStatus::Pending),
+			notificationPending(false),
+			committed(false)
 		{
 		}
 	};
 
 	struct AlteredFile_t
 	{
-		TCHAR szFileName[MAX_PATH];
+		std::wstring fileName;
 		DWORD dwAction;
 		int iFolderIndex;
 	};
@@ -250,9 +297,23 @@ private:
 		POINT DropPoint;
 	};
 
+	// Used to tag the tasks run by m_itemTaskScheduler, so that each type of task can be cancelled
+	// independently.
+	enum class ItemTaskType
+	{
+		Column,
+		Thumbnail,
+		InfoTip,
+		Group,
+		Filter
+	};
+
+	// Item slots are reused once an item is removed, so each of the results below records the
+	// generation of the slot as well, so that it's not applied to a different item.
 	struct ColumnResult_t
 	{
 		int itemInternalIndex;
+		uint32_t itemGeneration;
 		ColumnType columnType;
 		std::wstring columnText;
 	};
@@ -260,12 +321,14 @@ private:
 	struct ThumbnailResult_t
 	{
 		int itemInternalIndex;
+		uint32_t itemGeneration;
 		wil::unique_hbitmap bitmap;
 	};
 
 	struct InfoTipResult
 	{
 		int itemInternalIndex;
+		uint32_t itemGeneration;
 		std::wstring infoTip;
 	};
 
@@ -301,6 +364,23 @@ private:
 		}
 	};
 
+	struct GroupResult
+	{
+		int itemInternalIndex;
+		GroupInfo groupInfo;
+	};
+
+	struct FilterResult
+	{
+		FilterEvaluationResult evaluation;
+
+		// True if only the items that were visible when the evaluation started were tested.
+		bool refinement;
+
+		// The internal index and slot generation of each item that was tested.
+		std::vector<std::pair<int, uint32_t>> itemGenerations;
+	};
+
 	enum class GroupByDateType
 	{
 		Created,
@@ -308,12 +388,35 @@ private:
 		Accessed
 	};
 
+	// In owner data mode, the listview doesn't store any item data. The data for each item is
+	// instead requested whenever the item is drawn. The values that have already been retrieved
+	// for an item are stored here, so that they're only retrieved once. Entries are only created
+	// for items that have been shown.
+	struct VirtualItemData
+	{
+		std::optional<int> image;
+
+		// The LVIS_CUT and LVIS_OVERLAYMASK bits.
+		UINT state = 0;
+
+		// An empty entry is added when the text for a column is requested, so that the text will
+		// only be requested a single time.
+		std::unordered_map<ColumnType, std::wstring> columnText;
+	};
+
+	// The listview tracks the selection in owner data mode by position. When the position of an
+	// item changes, the selection needs to be moved along with the item.
+	struct VirtualSelection
+	{
+		std::unordered_set<int> selectedItems;
+		std::optional<int> focusedItem;
+	};
+
 	struct DirectoryState
 	{
 		unique_pidl_absolute pidlDirectory;
 		std::wstring directory;
 		bool virtualFolder;
-		int itemIDCounter;
 
 		/* Stores information on files that have
 		been created and are awaiting insertion
@@ -328,14 +431,32 @@ private:
 		ULARGE_INTEGER totalDirSize;
 		ULARGE_INTEGER fileSelectionSize;
 
-		/* Cached folder size data. */
-		mutable std::unordered_map<int, ULONGLONG> cachedFolderSizes;
-
-		std::vector<ShellChangeNotification> shellChangeNotifications;
+		/* Indexes that map an item's parsing name
+		(case-folded) and the bytes of its child
+		pidl to its internal index. These allow items
+		to be located without comparing against every
+		item in the directory. Names that differ only
+		in case (e.g. in a case-sensitive directory)
+		share a key, so each key can map to several
+		items. */
+		std::unordered_multimap<std::wstring, int> parsingNameIndex;
+		std::unordered_map<std::string, int> childPidlIndex;
+
+		/* The group each item belongs to, keyed by internal
+		index. The entries are only valid for the sort mode
+		they were determined for. Items whose group is still
+		being determined in the background are mapped to the
+		id of the most recent request. */
+		std::unordered_map<int, GroupInfo> groupInfoCache;
+		std::optional<SortMode> groupInfoCacheSortMode;
+		std::unordered_map<int, int> pendingGroupResultIds;
+
+		/* Only used in owner data mode. */
+		VirtualItemList virtualItems;
+		std::unordered_map<int, VirtualItemData> virtualItemData;
 
 		DirectoryState() :
 			virtualFolder(false),
-			itemIDCounter(0),
 			numItems(0),
 			numFilesSelected(0),
 			numFoldersSelected(0),
@@ -364,12 +485,24 @@ private:
 	static const UINT WM_APP_THUMBNAIL_RESULT_READY = WM_APP + 151;
 	static const UINT WM_APP_INFO_TIP_READY = WM_APP + 152;
 	static const UINT WM_APP_SHELL_NOTIFY = WM_APP + 153;
+	static const UINT WM_APP_ENUMERATION_PROGRESS = WM_APP + 154;
+	static const UINT WM_APP_GROUP_RESULT_READY = WM_APP + 155;
+	static const UINT WM_APP_UPDATE_GROUP_HEADERS = WM_APP + 156;
+	static const UINT WM_APP_FILTER_RESULT_READY = WM_APP + 157;
+
+	// The number of items requested from the enumerator in each call to IEnumIDList::Next().
+	static const ULONG ENUMERATION_BATCH_SIZE = 128;
 
 	static const int THUMBNAIL_ITEM_WIDTH = 120;
 	static const int THUMBNAIL_ITEM_HEIGHT = 120;
 
 	static const UINT PROCESS_SHELL_CHANGES_TIMER_ID = 1;
-	static const UINT PROCESS_SHELL_CHANGES_TIMEOUT = 100;
+
+	// The maximum number of (coalesced) shell changes that will be applied in a single timer tick.
+	// Any remaining changes will be applied after PROCESS_SHELL_CHANGES_CONTINUATION_TIMEOUT, so
+	// that the UI remains responsive while a large number of changes are being applied.
+	static const size_t MAX_SHELL_CHANGES_PER_TICK = 500;
+	static const UINT PROCESS_SHELL_CHANGES_CONTINUATION_TIMEOUT = 10;
 
 	ShellBrowser(int id, HWND hOwner, IExplorerplusplus *coreInterface,
 		TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
@@ -379,9 +512,8 @@ private:
 		TabNavigationInterface *tabNavigation, FileActionHandler *fileActionHandler,
 		const FolderSettings &folderSettings, const FolderColumns *initialColumns);
 
-	static HWND CreateListView(HWND parent);
+	static HWND CreateListView(HWND parent, bool virtualListView);
 	void InitializeListView();
-	int GenerateUniqueItemId();
 	void MarkItemAsCut(int item, bool cut);
 	void VerifySortMode();
 
@@ -390,20 +522,35 @@ private:
 	HRESULT BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry = true) override;
 
 	/* Browsing support. */
-	HRESULT EnumerateFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry,
+	HRESULT StartEnumeration(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry);
+	static void EnumerateFolderAsync(HWND listView, HWND owner,
+		std::shared_ptr<EnumerationContext> context, std::stop_token stopToken);
+	static void SetEnumerationStatus(HWND listView, EnumerationContext *context,
+		EnumerationStatus status);
+	static void AddEnumeratedItems(HWND listView, EnumerationContext *context,
 		std::vector<ItemInfo_t> &items);
+	void OnEnumerationProgress(int enumerationId);
+	void CommitEnumeration(EnumerationContext *context);
+	void InsertEnumeratedItems(std::vector<ItemInfo_t> &&items);
+	void CancelEnumeration();
 	void PrepareToChangeFolders();
 	void ClearPendingResults();
 	void ResetFolderState();
 	void StoreCurrentlySelectedItems();
-	void OnEnumerationCompleted(std::vector<ItemInfo_t> &&items);
+	size_t EstimateFolderMemoryUsage() const;
+	void ScrollItemToTop(int index);
+	void OnEnumerationCompleted();
 	void InsertAwaitingItems(BOOL bInsertIntoGroup);
-	BOOL IsFileFiltered(const ItemInfo_t &itemInfo) const;
+	int InsertItemIntoListView(const AwaitingAdd_t &awaitingItem, BOOL insertIntoGroup);
+	BOOL IsFileFiltered(int internalIndex) const;
 	std::optional<int> AddItemInternal(IShellFolder *shellFolder, PCIDLIST_ABSOLUTE pidlDirectory,
 		PCITEMID_CHILD pidlChild, int itemIndex, BOOL setPosition);
 	int AddItemInternal(int itemIndex, ItemInfo_t itemInfo, BOOL setPosition);
 	std::optional<ItemInfo_t> GetItemInformation(IShellFolder *shellFolder,
 		PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild);
+	static std::optional<ItemInfo_t> GetItemInformation(IShellFolder *shellFolder,
+		PCIDLIST_ABSOLUTE pidlDirectory, PCITEMID_CHILD pidlChild, bool isRecycleBin);
+	bool IsRecycleBin(PCIDLIST_ABSOLUTE pidl) const;
 	static HRESULT ExtractFindDataUsingPropertyStore(IShellFolder *shellFolder,
 		PCITEMID_CHILD pidlChild, WIN32_FIND_DATA &output);
 	void SetViewModeInternal(ViewMode viewMode);
@@ -425,6 +572,7 @@ private:
 	LRESULT CALLBACK ListViewParentProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 	static int CALLBACK SortStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
+	static int CALLBACK SortByPositionStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
 
 	/* Message handlers. */
 	void ColumnClicked(int iClickedColumn);
@@ -436,15 +584,23 @@ private:
 	void OnRButtonUp(HWND hwnd, int x, int y, UINT keyFlags);
 	void OnMouseMove(HWND hwnd, int x, int y, UINT keyFlags);
 	void OnListViewGetDisplayInfo(LPARAM lParam);
+	int GetThumbnailImageForItem(int internalIndex, int row);
+	int GetIconImageForItem(int internalIndex);
+	void SetItemImage(int item, int image);
+	void ResetItemImages();
+	void UpdateItemTaskViewport();
+	std::pair<int, int> GetVisibleItemRange() const;
 	LRESULT OnListViewGetInfoTip(NMLVGETINFOTIP *getInfoTip);
 	void QueueInfoTipTask(int internalIndex, const std::wstring &existingInfoTip);
 	static std::optional<InfoTipResult> GetInfoTipAsync(HWND listView, int infoTipResultId,
-		int internalIndex, const BasicItemInfo_t &basicItemInfo, const Config &config,
-		HINSTANCE instance, bool virtualFolder);
+		int internalIndex, uint32_t itemGeneration, const BasicItemInfo_t &basicItemInfo,
+		const Config &config, HINSTANCE instance, bool virtualFolder);
 	void ProcessInfoTipResult(int infoTipResultId);
 	void OnListViewItemInserted(const NMLISTVIEW *itemData);
 	void OnListViewItemChanged(const NMLISTVIEW *changeData);
+	void OnListViewODStateChanged(const NMLVODSTATECHANGE *stateChange);
 	void UpdateFileSelectionInfo(int internalIndex, BOOL selected);
+	void RecalculateFileSelectionInfo();
 	void OnListViewKeyDown(const NMLVKEYDOWN *lvKeyDown);
 	std::vector<PCIDLIST_ABSOLUTE> GetSelectedItemPidls();
 	void OnListViewBeginDrag(const NMLISTVIEW *info);
@@ -465,23 +621,24 @@ private:
 	void OnColumnMenuItemSelected(int menuItemId,
 		const std::unordered_map<int, ColumnType> &menuItemMappings);
 
-	const ItemInfo_t &GetItemByIndex(int index) const;
-	ItemInfo_t &GetItemByIndex(int index);
 	int GetItemInternalIndex(int item) const;
 
 	BasicItemInfo_t getBasicItemInfo(int internalIndex) const;
 
 	/* Sorting. */
 	int CALLBACK Sort(int InternalIndex1, int InternalIndex2) const;
+	void SortUsingKeys();
+	void SortUsingComparison();
 
 	/* Listview column support. */
 	void AddFirstColumn();
 	void SetUpListViewColumns();
 	void DeleteAllColumns();
-	void QueueColumnTask(int itemInternalIndex, ColumnType columnType);
+	void QueueColumnTask(int itemInternalIndex, int row, ColumnType columnType);
 	static ColumnResult_t GetColumnTextAsync(HWND listView, int columnResultId,
-		ColumnType columnType, int internalIndex, const BasicItemInfo_t &basicItemInfo,
-		const GlobalFolderSettings &globalFolderSettings);
+		ColumnType columnType, int internalIndex, uint32_t itemGeneration,
+		const BasicItemInfo_t &basicItemInfo, const GlobalFolderSettings &globalFolderSettings,
+		std::stop_token stopToken);
 	void InsertColumn(ColumnType columnType, int columnIndex, int width);
 	void SetActiveColumnSet();
 	void GetColumnInternal(ColumnType columnType, Column_t *pci) const;
@@ -501,7 +658,9 @@ private:
 	bool IsMonitoringShellChanges();
 	void OnShellNotify(WPARAM wParam, LPARAM lParam);
 	void OnProcessShellChangeNotifications();
-	void ProcessShellChangeNotification(const ShellChangeNotification &change);
+	void QueueShellChangeNotification(LONG event, PCIDLIST_ABSOLUTE pidl1, PCIDLIST_ABSOLUTE pidl2);
+	void ProcessShellChange(const ShellChangeCoalescer::Change &change);
+	std::wstring GetShellChangeKey(PCIDLIST_ABSOLUTE pidl) const;
 	void OnItemAdded(PCIDLIST_ABSOLUTE simplePidl);
 	void AddItem(PCIDLIST_ABSOLUTE pidl);
 	void RemoveItem(int iItemInternal);
@@ -514,9 +673,15 @@ private:
 	int DetermineItemSortedPosition(LPARAM lParam) const;
 
 	/* Filtering support. */
+	void UpdateFilterPattern();
 	void UpdateFiltering();
-	void RemoveFilteredItems();
+	void QueueFilterEvaluation();
+	void CancelFilterEvaluation();
+	void ProcessFilterResult(int filterResultId);
+	size_t HideUnmatchedItems(const FilterEvaluationResult &evaluation);
 	void RemoveFilteredItem(int iItem, int iItemInternal);
+	void OnItemFiltered(int iItem, int iItemInternal);
+	size_t RestoreFilteredItems(std::function<bool(int internalIndex)> predicate);
 	BOOL IsFilenameFiltered(const TCHAR *FileName) const;
 	void UnfilterAllItems();
 	void UnfilterItem(int internalIndex);
@@ -530,6 +695,14 @@ private:
 	int GroupRelativePositionComparison(const ListViewGroup &group1, const ListViewGroup &group2);
 	const ListViewGroup GetListViewGroupById(int groupId);
 	int DetermineItemGroup(int iItemInternal);
+	GroupInfo DetermineItemGroupInfo(const BasicItemInfo_t &basicItemInfo, SortMode sortMode,
+		const GlobalFolderSettings &globalFolderSettings) const;
+	static bool IsGroupInfoExpensive(SortMode sortMode);
+	void ValidateGroupInfoCache();
+	void QueueGroupTask(int internalIndex);
+	void ProcessGroupResult(int groupResultId);
+	void UpdateItemGroup(int index, int internalIndex);
+	void RemoveItemGroupInfo(int internalIndex);
 	std::optional<GroupInfo> DetermineItemNameGroup(const BasicItemInfo_t &itemInfo) const;
 	std::optional<GroupInfo> DetermineItemSizeGroup(const BasicItemInfo_t &itemInfo) const;
 	std::optional<GroupInfo> DetermineItemTotalSizeGroup(const BasicItemInfo_t &itemInfo) const;
@@ -551,25 +724,46 @@ private:
 
 	/* Other grouping support. */
 	int GetOrCreateListViewGroup(const GroupInfo &groupInfo);
+	void UpdateGroups();
 	void MoveItemsIntoGroups();
 	void InsertItemIntoGroup(int index, int groupId);
 	void EnsureGroupExistsInListView(int groupId);
 	void InsertGroupIntoListView(const ListViewGroup &listViewGroup);
 	void RemoveGroupFromListView(const ListViewGroup &listViewGroup);
 	void UpdateGroupHeader(const ListViewGroup &listViewGroup);
+	void QueueGroupHeaderUpdate(int groupId);
+	void UpdateQueuedGroupHeaders();
 	std::wstring GenerateGroupHeader(const ListViewGroup &listViewGroup);
 	void OnItemRemovedFromGroup(int groupId);
 	void OnItemAddedToGroup(int groupId);
 	std::optional<int> GetItemGroupId(int index);
 
+	/* Owner data (virtual) listview support. */
+	void OnVirtualListViewGetDisplayInfo(LVITEM *item);
+	std::wstring GetVirtualItemText(int internalIndex, int row, int subItem,
+		VirtualItemData &itemData);
+	int OnListViewFindItem(const NMLVFINDITEM *findItem) const;
+	void UpdateVirtualItemCount();
+	std::optional<int> RemoveVirtualItem(int internalIndex);
+	void SetVirtualItemOrder(std::vector<int> internalIndexes);
+	void RepositionVirtualItem(int internalIndex);
+	VirtualSelection SaveVirtualSelection() const;
+	void RestoreVirtualSelection(const VirtualSelection &selection);
+	void BeginVirtualSelectionUpdate();
+	void EndVirtualSelectionUpdate();
+	void InvalidateVirtualItemText(int item);
+	void OnVirtualColumnTaskDropped(int internalIndex, uint32_t itemGeneration,
+		ColumnType columnType);
+	void ResetVirtualItemData();
+
 	/* Listview icons. */
-	void ProcessIconResult(int internalIndex, int iconIndex);
-	std::optional<int> GetCachedIconIndex(const ItemInfo_t &itemInfo);
+	void ProcessIconResult(int internalIndex, uint32_t itemGeneration, int iconIndex);
+	std::optional<int> GetCachedIconIndex(int internalIndex);
 
 	/* Thumbnails view. */
-	void QueueThumbnailTask(int internalIndex);
-	std::optional<int> GetCachedThumbnailIndex(const ItemInfo_t &itemInfo);
-	static wil::unique_hbitmap GetThumbnail(PIDLIST_ABSOLUTE pidl, WTS_FLAGS flags);
+	void QueueThumbnailTask(int internalIndex, int row);
+	std::optional<int> GetCachedThumbnailIndex(int internalIndex);
+	static wil::unique_hbitmap GetThumbnail(PCIDLIST_ABSOLUTE pidl, WTS_FLAGS flags);
 	void ProcessThumbnailResult(int thumbnailResultId);
 	void SetupThumbnailsView();
 	void RemoveThumbnailsView();
@@ -608,6 +802,13 @@ private:
 	int LocateFileItemInternalIndex(const TCHAR *szFileName) const;
 	std::optional<int> GetItemIndexForPidl(PCIDLIST_ABSOLUTE pidl) const;
 	std::optional<int> GetItemInternalIndexForPidl(PCIDLIST_ABSOLUTE pidl) const;
+	std::optional<int> GetItemInternalIndexForSimplePidl(PCIDLIST_ABSOLUTE simplePidl) const;
+	std::optional<int> FindItemInternalIndexByDisplayName(PCIDLIST_ABSOLUTE pidl) const;
+	std::optional<int> FindItemInternalIndexByParsingName(const std::wstring &parsingName) const;
+	void AddItemToIndexes(int internalIndex);
+	void RemoveItemFromIndexes(int internalIndex);
+	static std::wstring GetParsingNameIndexKey(const std::wstring &parsingName);
+	static std::string GetChildPidlIndexKey(PCUITEMID_CHILD pidlChild);
 	std::optional<int> LocateItemByInternalIndex(int internalIndex) const;
 	void ApplyHeaderSortArrow();
 
@@ -618,6 +819,7 @@ private:
 	NavigationCommittedSignal m_navigationCommittedSignal;
 	NavigationCompletedSignal m_navigationCompletedSignal;
 	NavigationFailedSignal m_navigationFailedSignal;
+	NavigationCancelledSignal m_navigationCancelledSignal;
 	std::unique_ptr<ShellNavigationController> m_navigationController;
 
 	TabNavigationInterface *m_tabNavigation;
@@ -636,27 +838,43 @@ private:
 
 	DirectoryState m_directoryState;
 
-	/* Stores various extra information on files, such
-	as display name. */
-	std::unordered_map<int, ItemInfo_t> m_itemInfoMap;
+	// Stores the information on each of the items in the current folder, keyed by internal index.
+	ItemStore m_itemStore;
+
+	// Enumerations run on the shared WorkerPool, with the same priority as the other tasks for this
+	// tab.
+	WorkerPool::TaskGroup m_enumerationTaskGroup;
+	std::shared_ptr<EnumerationContext> m_enumerationContext;
+	int m_enumerationIdCounter;
+
+	bool m_hibernated;
+
+	// The item that was at the top of the listview when the tab was hibernated.
+	unique_pidl_absolute m_hibernatedTopItem;
+
+	// Column, thumbnail and info tip tasks all share a single scheduler, so that the tasks for
+	// items currently on screen are run first, regardless of the type of task.
+	ViewportTaskScheduler m_itemTaskScheduler;
 
-	ctpl::thread_pool m_columnThreadPool;
 	std::unordered_map<int, std::future<ColumnResult_t>> m_columnResults;
 	int m_columnResultIDCounter;
 
 	std::unique_ptr<IconFetcher> m_iconFetcher;
-	CachedIcons *m_cachedIcons;
 
 	IconResourceLoader *m_iconResourceLoader;
 
-	ctpl::thread_pool m_thumbnailThreadPool;
 	std::unordered_map<int, std::future<std::optional<ThumbnailResult_t>>> m_thumbnailResults;
 	int m_thumbnailResultIDCounter;
 
-	ctpl::thread_pool m_infoTipsThreadPool;
 	std::unordered_map<int, std::future<std::optional<InfoTipResult>>> m_infoTipResults;
 	int m_infoTipResultIDCounter;
 
+	std::unordered_map<int, std::future<GroupResult>> m_groupResults;
+	int m_groupResultIdCounter;
+
+	std::unordered_map<int, std::future<FilterResult>> m_filterResults;
+	int m_filterResultIdCounter;
+
 	/* Internal state. */
 	const HINSTANCE m_hResourceModule;
 	HACCEL *m_acceleratorTable;
@@ -673,13 +891,29 @@ private:
 	int m_uniqueFolderId;
 
 	const Config *m_config;
+	const bool m_virtualListView;
+
+	// The selection saved by the outermost call to BeginVirtualSelectionUpdate().
+	std::optional<VirtualSelection> m_savedVirtualSelection;
+	int m_virtualSelectionUpdateDepth;
+
 	FolderSettings m_folderSettings;
 
+	/* The filter is checked against every item in the
+	folder, so it's only parsed when it changes. */
+	WildcardPattern m_filterPattern;
+
+	/* The patterns that have been in effect since the
+	filter was last fully applied. Every item hidden by
+	the filter fails to match at least one of these. */
+	std::vector<WildcardPattern> m_filterPatternHistory;
+
 	/* ID. */
 	const int m_ID;
 
 	/* Directory monitoring. */
 	ULONG m_shChangeNotifyId;
+	ShellChangeCoalescer m_shellChangeCoalescer;
 	unique_pidl_absolute m_renamedItemOldPidl;
 
 	wil::com_ptr_nothrow<IShellFolder> m_desktopFolder;
@@ -689,7 +923,7 @@ private:
 	have been modified (i.e. created, deleted,
 	renamed, etc). */
 	CRITICAL_SECTION m_csDirectoryAltered;
-	std::list<AlteredFile_t> m_AlteredList;
+	std::vector<AlteredFile_t> m_AlteredList;
 
 	int m_middleButtonItem;
 
@@ -733,4 +967,14 @@ private:
 
 	ListViewGroupSet m_listViewGroups;
 	int m_groupIdCounter;
+
+	// The sort mode the groups in the listview were created for. If this matches the current sort
+	// mode, the items are already in the correct groups and the groups only need to be reordered
+	// when the folder is sorted.
+	std::optional<SortMode> m_listViewGroupsSortMode;
+
+	// Group headers include the number of items in the group. Rather than updating a header each
+	// time an item is added or removed, the groups are recorded here and each header is updated
+	// once, after the current batch of changes has been processed.
+	std::unordered_set<int> m_queuedGroupHeaderUpdates;
 };
@@ -0,0 +1,392 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShellChangeCoalescer.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+
+unique_pidl_absolute ClonePidl(PCIDLIST_ABSOLUTE pidl)
+{
+	return unique_pidl_absolute(pidl ? ILCloneFull(pidl) : nullptr);
+}
+
+}
+
+void ShellChangeCoalescer::AddItemAdded(const std::wstring &key, PCIDLIST_ABSOLUTE pidl)
+{
+	m_stats.rawEvents++;
+	m_eventsSinceLastBatch++;
+
+	if (m_directoryUpdatePending)
+	{
+		return;
+	}
+
+	auto itr = m_mergeableEntries.find(key);
+
+	if (itr == m_mergeableEntries.end())
+	{
+		AppendEntry(key, EntryType::Added, pidl);
+		return;
+	}
+
+	Entry &entry = *itr->second;
+
+	switch (entry.type)
+	{
+	case EntryType::Added:
+		entry.pidl = ClonePidl(pidl);
+		break;
+
+	case EntryType::Removed:
+		entry.type = EntryType::Replaced;
+		entry.originalPidl = std::move(entry.pidl);
+		entry.pidl = ClonePidl(pidl);
+		break;
+
+	// An item that already exists shouldn't be added again. The change is queued separately, so
+	// that it's handled in exactly the same way it would be if it hadn't been merged.
+	case EntryType::Updated:
+	case EntryType::Renamed:
+	case EntryType::Replaced:
+		StartNewGeneration();
+		AppendEntry(key, EntryType::Added, pidl);
+		break;
+	}
+}
+
+void ShellChangeCoalescer::AddItemRemoved(const std::wstring &key, PCIDLIST_ABSOLUTE pidl)
+{
+	m_stats.rawEvents++;
+	m_eventsSinceLastBatch++;
+
+	if (m_directoryUpdatePending)
+	{
+		return;
+	}
+
+	auto itr = m_mergeableEntries.find(key);
+
+	if (itr == m_mergeableEntries.end())
+	{
+		AppendEntry(key, EntryType::Removed, pidl);
+		return;
+	}
+
+	Entry &entry = *itr->second;
+
+	switch (entry.type)
+	{
+	case EntryType::Added:
+		// The item was never shown, so there's nothing to do.
+		EraseEntry(itr->second);
+		break;
+
+	case EntryType::Removed:
+		break;
+
+	case EntryType::Updated:
+		entry.type = EntryType::Removed;
+		entry.pidl = ClonePidl(pidl);
+		break;
+
+	// In both of these cases, the item that's currently shown is the original item, so that's the
+	// item that needs to be removed.
+	case EntryType::Renamed:
+	case EntryType::Replaced:
+		UpdateKeyCounts(entry, -1);
+		entry.type = EntryType::Removed;
+		entry.pidl = std::move(entry.originalPidl);
+		entry.originalKey.clear();
+		UpdateKeyCounts(entry, 1);
+		break;
+	}
+}
+
+void ShellChangeCoalescer::AddItemUpdated(const std::wstring &key, PCIDLIST_ABSOLUTE pidl)
+{
+	m_stats.rawEvents++;
+	m_eventsSinceLastBatch++;
+
+	if (m_directoryUpdatePending)
+	{
+		return;
+	}
+
+	auto itr = m_mergeableEntries.find(key);
+
+	if (itr == m_mergeableEntries.end())
+	{
+		AppendEntry(key, EntryType::Updated, pidl);
+		return;
+	}
+
+	Entry &entry = *itr->second;
+
+	// Adding, renaming or replacing an item will always result in the latest details for the item
+	// being retrieved, so there's no need to perform a separate update in any of those cases. If
+	// the item has been removed, there's nothing to update.
+	if (entry.type != EntryType::Removed)
+	{
+		entry.pidl = ClonePidl(pidl);
+	}
+}
+
+void ShellChangeCoalescer::AddItemRenamed(const std::wstring &oldKey, PCIDLIST_ABSOLUTE oldPidl,
+	const std::wstring &newKey, PCIDLIST_ABSOLUTE newPidl)
+{
+	m_stats.rawEvents++;
+	m_eventsSinceLastBatch++;
+
+	if (m_directoryUpdatePending)
+	{
+		return;
+	}
+
+	auto itr = m_mergeableEntries.find(oldKey);
+
+	// If there's already a pending change for the destination, the changes can't be merged without
+	// potentially altering their meaning.
+	if (newKey != oldKey && m_mergeableEntries.contains(newKey))
+	{
+		StartNewGeneration();
+		itr = m_mergeableEntries.end();
+	}
+
+	if (itr == m_mergeableEntries.end())
+	{
+		AppendEntry(newKey, EntryType::Renamed, newPidl, oldPidl, oldKey);
+		return;
+	}
+
+	auto entryItr = itr->second;
+	Entry &entry = *entryItr;
+
+	if (entry.type == EntryType::Removed || entry.type == EntryType::Replaced)
+	{
+		StartNewGeneration();
+		AppendEntry(newKey, EntryType::Renamed, newPidl, oldPidl, oldKey);
+		return;
+	}
+
+	UpdateKeyCounts(entry, -1);
+
+	switch (entry.type)
+	{
+	case EntryType::Added:
+		entry.pidl = ClonePidl(newPidl);
+		break;
+
+	case EntryType::Updated:
+		entry.type = EntryType::Renamed;
+		entry.originalPidl = std::move(entry.pidl);
+		entry.originalKey = oldKey;
+		entry.pidl = ClonePidl(newPidl);
+		break;
+
+	case EntryType::Renamed:
+		if (entry.originalKey == newKey)
+		{
+			// The item has been renamed back to its original name.
+			entry.type = EntryType::Updated;
+			entry.originalPidl.reset();
+			entry.originalKey.clear();
+		}
+
+		entry.pidl = ClonePidl(newPidl);
+		break;
+
+	case EntryType::Removed:
+	case EntryType::Replaced:
+		assert(false);
+		break;
+	}
+
+	m_mergeableEntries.erase(itr);
+	entry.key = newKey;
+	m_mergeableEntries.insert({ newKey, entryItr });
+
+	UpdateKeyCounts(entry, 1);
+}
+
+void ShellChangeCoalescer::AddDirectoryUpdated()
+{
+	m_stats.rawEvents++;
+	m_eventsSinceLastBatch++;
+
+	// The directory will be reloaded, at which point any changes to individual items will be
+	// picked up anyway.
+	m_entries.clear();
+	m_mergeableEntries.clear();
+	m_keyCounts.clear();
+	m_directoryUpdatePending = true;
+}
+
+bool ShellChangeCoalescer::HasPendingChanges() const
+{
+	return m_directoryUpdatePending || !m_entries.empty();
+}
+
+bool ShellChangeCoalescer::HasPendingChangeForItem(const std::wstring &key) const
+{
+	if (m_directoryUpdatePending)
+	{
+		return true;
+	}
+
+	return m_keyCounts.contains(key);
+}
+
+std::vector<ShellChangeCoalescer::Change> ShellChangeCoalescer::TakeChanges(size_t maxChanges)
+{
+	UpdateBatchWindow();
+
+	std::vector<Change> changes;
+
+	if (m_directoryUpdatePending)
+	{
+		changes.push_back({ ChangeType::DirectoryUpdated, nullptr, nullptr });
+		m_directoryUpdatePending = false;
+		m_stats.appliedChanges++;
+		return changes;
+	}
+
+	while (!m_entries.empty() && changes.size() < maxChanges)
+	{
+		Entry &entry = m_entries.front();
+
+		switch (entry.type)
+		{
+		case EntryType::Added:
+			changes.push_back({ ChangeType::Added, std::move(entry.pidl), nullptr });
+			break;
+
+		case EntryType::Removed:
+			changes.push_back({ ChangeType::Removed, std::move(entry.pidl), nullptr });
+			break;
+
+		case EntryType::Updated:
+			changes.push_back({ ChangeType::Updated, std::move(entry.pidl), nullptr });
+			break;
+
+		case EntryType::Renamed:
+			changes.push_back(
+				{ ChangeType::Renamed, std::move(entry.originalPidl), std::move(entry.pidl) });
+			break;
+
+		case EntryType::Replaced:
+			changes.push_back({ ChangeType::Removed, std::move(entry.originalPidl), nullptr });
+
+			// If there's only room for the removal, the entry is left queued as a plain addition,
+			// so that the limit is never exceeded.
+			if (changes.size() == maxChanges)
+			{
+				entry.type = EntryType::Added;
+				continue;
+			}
+
+			changes.push_back({ ChangeType::Added, std::move(entry.pidl), nullptr });
+			break;
+		}
+
+		EraseEntry(m_entries.begin());
+	}
+
+	m_stats.appliedChanges += changes.size();
+
+	return changes;
+}
+
+void ShellChangeCoalescer::Clear()
+{
+	m_entries.clear();
+	m_mergeableEntries.clear();
+	m_keyCounts.clear();
+	m_directoryUpdatePending = false;
+	m_batchWindow = MIN_BATCH_WINDOW;
+	m_eventsSinceLastBatch = 0;
+}
+
+UINT ShellChangeCoalescer::GetBatchWindow() const
+{
+	return m_batchWindow;
+}
+
+const ShellChangeCoalescer::Stats &ShellChangeCoalescer::GetStats() const
+{
+	return m_stats;
+}
+
+void ShellChangeCoalescer::AppendEntry(const std::wstring &key, EntryType type,
+	PCIDLIST_ABSOLUTE pidl, PCIDLIST_ABSOLUTE originalPidl, const std::wstring &originalKey)
+{
+	auto itr = m_entries.emplace(m_entries.end(),
+		Entry{ key, type, ClonePidl(pidl), ClonePidl(originalPidl), originalKey });
+	m_mergeableEntries.insert_or_assign(key, itr);
+
+	UpdateKeyCounts(*itr, 1);
+}
+
+void ShellChangeCoalescer::EraseEntry(EntryList::iterator itr)
+{
+	auto mergeableItr = m_mergeableEntries.find(itr->key);
+
+	if (mergeableItr != m_mergeableEntries.end() && mergeableItr->second == itr)
+	{
+		m_mergeableEntries.erase(mergeableItr);
+	}
+
+	UpdateKeyCounts(*itr, -1);
+
+	m_entries.erase(itr);
+}
+
+void ShellChangeCoalescer::UpdateKeyCounts(const Entry &entry, int delta)
+{
+	UpdateKeyCount(entry.key, delta);
+
+	if (!entry.originalKey.empty() && entry.originalKey != entry.key)
+	{
+		UpdateKeyCount(entry.originalKey, delta);
+	}
+}
+
+void ShellChangeCoalescer::UpdateKeyCount(const std::wstring &key, int delta)
+{
+	int &count = m_keyCounts[key];
+	count += delta;
+
+	assert(count >= 0);
+
+	if (count <= 0)
+	{
+		m_keyCounts.erase(key);
+	}
+}
+
+void ShellChangeCoalescer::StartNewGeneration()
+{
+	m_mergeableEntries.clear();
+}
+
+// When there's a large amount of activity, waiting longer before processing notifications means
+// that more of them can be merged (and the listview is updated less often). When there's only
+// occasional activity, changes should be shown as quickly as possible.
+void ShellChangeCoalescer::UpdateBatchWindow()
+{
+	if (m_eventsSinceLastBatch > HIGH_ACTIVITY_THRESHOLD)
+	{
+		m_batchWindow = (std::min)(m_batchWindow * 2, MAX_BATCH_WINDOW);
+	}
+	else if (m_eventsSinceLastBatch < LOW_ACTIVITY_THRESHOLD)
+	{
+		m_batchWindow = (std::max)(m_batchWindow / 2, MIN_BATCH_WINDOW);
+	}
+
+	m_eventsSinceLastBatch = 0;
+}
@@ -0,0 +1,146 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "../Helper/ShellHelper.h"
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Shell change notifications are delivered one at a time and, when a program is rapidly creating
+// and deleting files (e.g. a compiler writing temporary files), there can be thousands of them in
+// a short period. Applying each notification individually means that the listview will be updated
+// for items that may no longer exist by the time the notifications are processed.
+// This class collapses the notifications for each item, so that only the net change is applied:
+//
+// - An item that's created, then deleted, is dropped entirely.
+// - Repeated updates to an item result in a single update.
+// - A chain of renames (a -> b -> c) results in a single rename (a -> c).
+//
+// Items are identified by a key (e.g. the item's parsing name), which is supplied by the caller.
+// The relative order of changes to different items is preserved. If a sequence of changes can't
+// be safely merged, the changes that have already been queued are left as-is and merging starts
+// again from that point, so the changes are still applied in the order they were received.
+class ShellChangeCoalescer
+{
+public:
+	enum class ChangeType
+	{
+		Added,
+		Removed,
+		Updated,
+		Renamed,
+		DirectoryUpdated
+	};
+
+	struct Change
+	{
+		ChangeType type;
+
+		// For renames, this is the item's original pidl. Otherwise, this is the pidl of the item
+		// the change applies to. Not set for directory updates.
+		unique_pidl_absolute pidl1;
+
+		// The item's new pidl. Only set for renames.
+		unique_pidl_absolute pidl2;
+	};
+
+	struct Stats
+	{
+		// The number of notifications that have been passed in.
+		ULONGLONG rawEvents = 0;
+
+		// The number of changes that have been handed back to be applied.
+		ULONGLONG appliedChanges = 0;
+	};
+
+	// The minimum and maximum amount of time (in milliseconds) that notifications will be collected
+	// for before being processed.
+	static constexpr UINT MIN_BATCH_WINDOW = 100;
+	static constexpr UINT MAX_BATCH_WINDOW = 800;
+
+	void AddItemAdded(const std::wstring &key, PCIDLIST_ABSOLUTE pidl);
+	void AddItemRemoved(const std::wstring &key, PCIDLIST_ABSOLUTE pidl);
+	void AddItemUpdated(const std::wstring &key, PCIDLIST_ABSOLUTE pidl);
+	void AddItemRenamed(const std::wstring &oldKey, PCIDLIST_ABSOLUTE oldPidl,
+		const std::wstring &newKey, PCIDLIST_ABSOLUTE newPidl);
+	void AddDirectoryUpdated();
+
+	bool HasPendingChanges() const;
+
+	// Returns true if any pending change refers to the item with the specified key. If there are no
+	// pending changes for an item, the caller can rely on the item's current state.
+	bool HasPendingChangeForItem(const std::wstring &key) const;
+
+	// Returns up to maxChanges of the pending changes, in the order they should be applied. The
+	// remaining changes will stay queued. Each call also adjusts the batch window, based on the
+	// number of notifications that have arrived since the previous call.
+	std::vector<Change> TakeChanges(size_t maxChanges);
+
+	// Discards any pending changes. The stats are retained.
+	void Clear();
+
+	UINT GetBatchWindow() const;
+	const Stats &GetStats() const;
+
+private:
+	enum class EntryType
+	{
+		Added,
+		Removed,
+		Updated,
+		Renamed,
+
+		// The item was removed, then a new item with the same key was added.
+		Replaced
+	};
+
+	struct Entry
+	{
+		std::wstring key;
+		EntryType type;
+
+		// The most recent pidl for the item.
+		unique_pidl_absolute pidl;
+
+		// For renames, the pidl (and key) the item had before it was renamed. For replacements,
+		// the pidl of the item that was removed.
+		unique_pidl_absolute originalPidl;
+		std::wstring originalKey;
+	};
+
+	using EntryList = std::list<Entry>;
+
+	// If more than this number of notifications arrive within a single batch window, the window
+	// will be increased. If fewer than LOW_ACTIVITY_THRESHOLD arrive, it will be decreased.
+	static constexpr ULONGLONG HIGH_ACTIVITY_THRESHOLD = 200;
+	static constexpr ULONGLONG LOW_ACTIVITY_THRESHOLD = 20;
+
+	void AppendEntry(const std::wstring &key, EntryType type, PCIDLIST_ABSOLUTE pidl,
+		PCIDLIST_ABSOLUTE originalPidl = nullptr, const std::wstring &originalKey = {});
+	void EraseEntry(EntryList::iterator itr);
+	void UpdateKeyCounts(const Entry &entry, int delta);
+	void UpdateKeyCount(const std::wstring &key, int delta);
+	void StartNewGeneration();
+	void UpdateBatchWindow();
+
+	EntryList m_entries;
+
+	// Maps an item's key to the entry that can be merged with. Entries that were queued before the
+	// most recent unmergeable change don't appear here.
+	std::unordered_map<std::wstring, EntryList::iterator> m_mergeableEntries;
+
+	// The number of pending entries that refer to each key (either as the item's current key or
+	// its original key).
+	std::unordered_map<std::wstring, int> m_keyCounts;
+
+	bool m_directoryUpdatePending = false;
+
+	UINT m_batchWindow = MIN_BATCH_WINDOW;
+	ULONGLONG m_eventsSinceLastBatch = 0;
+
+	Stats m_stats;
+};
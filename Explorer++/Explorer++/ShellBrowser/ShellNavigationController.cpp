@@ -30,6 +30,10 @@ void ShellNavigationController::Initialize()
 	m_connections.emplace_back(m_navigator->AddNavigationCommittedObserver(
 		std::bind_front(&ShellNavigationController::OnNavigationCommitted, this),
 		boost::signals2::at_front));
+	m_connections.emplace_back(m_navigator->AddNavigationFailedObserver(
+		std::bind_front(&ShellNavigationController::OnNavigationFinishedWithoutCommit, this)));
+	m_connections.emplace_back(m_navigator->AddNavigationCancelledObserver(
+		std::bind_front(&ShellNavigationController::OnNavigationFinishedWithoutCommit, this)));
 }
 
 std::vector<std::unique_ptr<HistoryEntry>> ShellNavigationController::CopyPreservedHistoryEntries(
@@ -49,6 +53,14 @@ std::vector<std::unique_ptr<HistoryEntry>> ShellNavigationController::CopyPreser
 void ShellNavigationController::OnNavigationCommitted(PCIDLIST_ABSOLUTE pidlDirectory,
 	bool addHistoryEntry)
 {
+	if (m_pendingHistoryOffset)
+	{
+		// The navigation checks in GoToOffset() ensure the offset is valid, so there's no need to
+		// re-check it here.
+		SetCurrentIndex(GetCurrentIndex() + *m_pendingHistoryOffset);
+		m_pendingHistoryOffset.reset();
+	}
+
 	if (addHistoryEntry)
 	{
 		std::wstring displayName;
@@ -75,6 +87,12 @@ void ShellNavigationController::OnNavigationCommitted(PCIDLIST_ABSOLUTE pidlDire
 	}
 }
 
+void ShellNavigationController::OnNavigationFinishedWithoutCommit()
+{
+	// The history entry wasn't navigated to, so the current index stays as it is.
+	m_pendingHistoryOffset.reset();
+}
+
 HRESULT ShellNavigationController::GoToOffset(int offset)
 {
 	auto entry = GetEntry(offset);
@@ -84,26 +102,18 @@ HRESULT ShellNavigationController::GoToOffset(int offset)
 		return E_FAIL;
 	}
 
-	auto connection = m_navigator->AddNavigationCommittedObserver(
-		[this, offset](PCIDLIST_ABSOLUTE pidl, bool addHistoryEntry)
-		{
-			UNREFERENCED_PARAMETER(pidl);
-			UNREFERENCED_PARAMETER(addHistoryEntry);
-
-			// The entry retrieval above will fail if the provided offset is invalid, so there's no
-			// need to re-check the offset here.
-			int index = GetCurrentIndex() + offset;
-			SetCurrentIndex(index);
-		},
-		boost::signals2::at_front);
-
-	auto disconnect = wil::scope_exit(
-		[&connection]
-		{
-			connection.disconnect();
-		});
-
-	return BrowseFolder(entry);
+	// The navigation is committed asynchronously, so the current index can only be updated once
+	// that happens (see OnNavigationCommitted()).
+	m_pendingHistoryOffset = offset;
+
+	HRESULT hr = BrowseFolder(entry);
+
+	if (FAILED(hr))
+	{
+		m_pendingHistoryOffset.reset();
+	}
+
+	return hr;
 }
 
 bool ShellNavigationController::CanGoUp() const
@@ -154,6 +164,9 @@ HRESULT ShellNavigationController::BrowseFolder(const HistoryEntry *entry)
 {
 	if (m_navigationMode == NavigationMode::ForceNewTab && GetCurrentEntry() != nullptr)
 	{
+		// The history in this tab isn't affected by a navigation in another tab.
+		m_pendingHistoryOffset.reset();
+
 		m_tabNavigation->CreateNewTab(entry->GetPidl().get(), true);
 		return S_OK;
 	}
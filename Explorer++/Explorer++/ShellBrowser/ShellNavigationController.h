@@ -12,6 +12,7 @@
 #include "../Helper/IconFetcher.h"
 #include "../Helper/Macros.h"
 #include <boost/signals2.hpp>
+#include <optional>
 
 class ShellNavigationController : public NavigationController<HistoryEntry, HRESULT>
 {
@@ -36,6 +37,8 @@ public:
 
 	HRESULT Refresh();
 
+	// As with NavigatorInterface::BrowseFolder(), a successful return value only indicates that the
+	// navigation has started.
 	HRESULT BrowseFolder(const std::wstring &path, bool addHistoryEntry = true);
 	HRESULT BrowseFolder(PCIDLIST_ABSOLUTE pidl, bool addHistoryEntry = true);
 
@@ -53,6 +56,7 @@ private:
 	HRESULT GetFailureValue() override;
 
 	void OnNavigationCommitted(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry);
+	void OnNavigationFinishedWithoutCommit();
 
 	NavigatorInterface *m_navigator;
 
@@ -61,5 +65,8 @@ private:
 
 	IconFetcherInterface *m_iconFetcher;
 
+	// Set while a navigation to an entry in the history is in progress.
+	std::optional<int> m_pendingHistoryOffset;
+
 	std::vector<boost::signals2::scoped_connection> m_connections;
 };
@@ -46,7 +46,21 @@ int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo
 	}
 }
 
-int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2)
+// The size of a folder is only known if it has previously been calculated (e.g. when the size
+// column was shown).
+static std::optional<ULONGLONG> GetSizeSortValue(const BasicItemInfo_t &itemInfo,
+	const GlobalFolderSettings &globalFolderSettings)
+{
+	if (WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+	{
+		return GetFolderSizeColumnCachedData(itemInfo, globalFolderSettings);
+	}
+
+	return ULARGE_INTEGER{ itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh }.QuadPart;
+}
+
+int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
+	const GlobalFolderSettings &globalFolderSettings)
 {
 	if (!itemInfo1.isFindDataValid && itemInfo2.isFindDataValid)
 	{
@@ -61,52 +75,28 @@ int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo
 		return 0;
 	}
 
-	bool isFolder1 = WI_IsFlagSet(itemInfo1.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
-	bool isFolder2 = WI_IsFlagSet(itemInfo2.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
-
-	ULONGLONG size1;
-	ULONGLONG size2;
+	auto size1 = GetSizeSortValue(itemInfo1, globalFolderSettings);
+	auto size2 = GetSizeSortValue(itemInfo2, globalFolderSettings);
 
-	if (isFolder1 && isFolder2)
+	// Folders that don't have a known size are placed before all other items.
+	if (!size1 && size2)
 	{
-		// Temporarily disabled.
-		/*auto itr1 = m_cachedFolderSizes.find(InternalIndex1);
-		auto itr2 = m_cachedFolderSizes.find(InternalIndex2);
-
-		if (itr1 == m_cachedFolderSizes.end() && itr2 == m_cachedFolderSizes.end())
-		{
-			return 0;
-		}
-		else if (itr1 != m_cachedFolderSizes.end() && itr2 == m_cachedFolderSizes.end())
-		{
-			return 1;
-		}
-		else if (itr1 == m_cachedFolderSizes.end() && itr2 != m_cachedFolderSizes.end())
-		{
-			return -1;
-		}
-
-		size1 = itr1->second;
-		size2 = itr2->second;*/
-
-		size1 = 0;
-		size2 = 0;
+		return -1;
 	}
-	else
+	else if (size1 && !size2)
 	{
-		// Both items are files (as opposed to folders).
-		ULARGE_INTEGER fileSize1 = { itemInfo1.wfd.nFileSizeLow, itemInfo1.wfd.nFileSizeHigh };
-		ULARGE_INTEGER fileSize2 = { itemInfo2.wfd.nFileSizeLow, itemInfo2.wfd.nFileSizeHigh };
-
-		size1 = fileSize1.QuadPart;
-		size2 = fileSize2.QuadPart;
+		return 1;
+	}
+	else if (!size1 && !size2)
+	{
+		return 0;
 	}
 
-	if (size1 > size2)
+	if (*size1 > *size2)
 	{
 		return 1;
 	}
-	else if (size1 < size2)
+	else if (*size1 < *size2)
 	{
 		return -1;
 	}
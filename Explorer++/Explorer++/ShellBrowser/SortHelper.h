@@ -18,7 +18,8 @@ enum class DateType
 
 int SortByName(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
 	const GlobalFolderSettings &globalFolderSettings);
-int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
+int SortBySize(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
+	const GlobalFolderSettings &globalFolderSettings);
 int SortByType(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2);
 int SortByDate(const BasicItemInfo_t &itemInfo1, const BasicItemInfo_t &itemInfo2,
 	DateType dateType);
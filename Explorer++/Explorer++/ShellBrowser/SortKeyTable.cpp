@@ -0,0 +1,479 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SortKeyTable.h"
+#include "ItemData.h"
+#include <wil/common.h>
+#include <algorithm>
+#include <numeric>
+
+SortKeyTable::SortKeyTable(SortMode sortMode, bool sortAscending, bool separateFoldersFromFiles,
+	const GlobalFolderSettings &globalFolderSettings) :
+	m_sortMode(sortMode),
+	m_keyType(GetKeyType(sortMode)),
+	m_sortAscending(sortAscending),
+	m_separateFoldersFromFiles(separateFoldersFromFiles),
+	m_globalFolderSettings(globalFolderSettings)
+{
+	assert(IsSortModeSupported(sortMode));
+}
+
+bool SortKeyTable::IsSortModeSupported(SortMode sortMode)
+{
+	switch (sortMode)
+	{
+	// These items are compared using the VARIANT value of a property, which can't be
+	// meaningfully reduced to a single key.
+	case SortMode::DateDeleted:
+	case SortMode::OriginalLocation:
+	case SortMode::Title:
+	case SortMode::Subject:
+	case SortMode::Authors:
+	case SortMode::Keywords:
+	case SortMode::Comments:
+		return false;
+
+	default:
+		return true;
+	}
+}
+
+SortKeyTable::KeyType SortKeyTable::GetKeyType(SortMode sortMode)
+{
+	switch (sortMode)
+	{
+	case SortMode::Name:
+		return KeyType::Name;
+
+	case SortMode::Type:
+		return KeyType::TextRootsFirst;
+
+	case SortMode::Size:
+		return KeyType::Size;
+
+	case SortMode::DateModified:
+	case SortMode::Created:
+	case SortMode::Accessed:
+	case SortMode::TotalSize:
+	case SortMode::FreeSpace:
+	case SortMode::RealSize:
+	case SortMode::HardLinks:
+		return KeyType::Number;
+
+	default:
+		return KeyType::Text;
+	}
+}
+
+void SortKeyTable::Reserve(size_t numItems)
+{
+	m_keys.reserve(numItems);
+
+	// Enough for a short name and display name per item. The arena will grow if necessary.
+	m_stringArena.reserve(numItems * 64);
+}
+
+void SortKeyTable::AddItem(int internalIndex, const BasicItemInfo_t &itemInfo)
+{
+	SortKey key;
+	key.internalIndex = internalIndex;
+	key.isFolder = WI_IsFlagSet(itemInfo.wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY);
+	key.isRoot = itemInfo.isRoot;
+	key.hasValue = false;
+	key.value = 0;
+	key.textOffset = 0;
+
+	switch (m_keyType)
+	{
+	case KeyType::Name:
+		key.textOffset = AddString(itemInfo.isRoot
+				? itemInfo.getFullPath()
+				: GetNameColumnText(itemInfo, m_globalFolderSettings));
+		break;
+
+	case KeyType::TextRootsFirst:
+	case KeyType::Text:
+		key.textOffset = AddString(GetTextValue(itemInfo));
+		break;
+
+	case KeyType::Number:
+		key.hasValue = GetNumericValue(itemInfo, key.value);
+		break;
+
+	case KeyType::Size:
+		if (!itemInfo.isFindDataValid)
+		{
+			break;
+		}
+
+		if (key.isFolder)
+		{
+			auto folderSize = GetFolderSizeColumnCachedData(itemInfo, m_globalFolderSettings);
+			key.hasValue = folderSize.has_value();
+			key.value = folderSize.value_or(0);
+		}
+		else
+		{
+			key.hasValue = true;
+			key.value =
+				ULARGE_INTEGER{ itemInfo.wfd.nFileSizeLow, itemInfo.wfd.nFileSizeHigh }.QuadPart;
+		}
+		break;
+	}
+
+	key.displayNameOffset = AddString(itemInfo.szDisplayName);
+
+	m_keys.push_back(key);
+}
+
+size_t SortKeyTable::AddString(const std::wstring &str)
+{
+	size_t offset = m_stringArena.size();
+	m_stringArena.append(str.c_str(), str.size() + 1);
+	return offset;
+}
+
+const wchar_t *SortKeyTable::GetString(size_t offset) const
+{
+	return m_stringArena.c_str() + offset;
+}
+
+bool SortKeyTable::GetNumericValue(const BasicItemInfo_t &itemInfo, ULONGLONG &value) const
+{
+	switch (m_sortMode)
+	{
+	case SortMode::DateModified:
+	case SortMode::Created:
+	case SortMode::Accessed:
+	{
+		if (!itemInfo.isFindDataValid)
+		{
+			return false;
+		}
+
+		const FILETIME *fileTime = &itemInfo.wfd.ftLastWriteTime;
+
+		if (m_sortMode == +SortMode::Created)
+		{
+			fileTime = &itemInfo.wfd.ftCreationTime;
+		}
+		else if (m_sortMode == +SortMode::Accessed)
+		{
+			fileTime = &itemInfo.wfd.ftLastAccessTime;
+		}
+
+		// Ordering the combined 64-bit value is equivalent to calling CompareFileTime().
+		value = ULARGE_INTEGER{ fileTime->dwLowDateTime, fileTime->dwHighDateTime }.QuadPart;
+		return true;
+	}
+
+	case SortMode::TotalSize:
+	case SortMode::FreeSpace:
+	{
+		ULARGE_INTEGER driveSpace;
+		BOOL res = GetDriveSpaceColumnRawData(itemInfo, m_sortMode == +SortMode::TotalSize,
+			driveSpace);
+
+		if (!res)
+		{
+			return false;
+		}
+
+		value = driveSpace.QuadPart;
+		return true;
+	}
+
+	case SortMode::RealSize:
+	{
+		ULARGE_INTEGER realFileSize;
+		bool res = GetRealSizeColumnRawData(itemInfo, realFileSize);
+
+		if (!res)
+		{
+			return false;
+		}
+
+		value = realFileSize.QuadPart;
+		return true;
+	}
+
+	case SortMode::HardLinks:
+		value = GetHardLinksColumnRawData(itemInfo);
+		return true;
+
+	default:
+		assert(false);
+		break;
+	}
+
+	return false;
+}
+
+std::wstring SortKeyTable::GetTextValue(const BasicItemInfo_t &itemInfo) const
+{
+	switch (m_sortMode)
+	{
+	case SortMode::Type:
+		return GetTypeColumnText(itemInfo);
+
+	case SortMode::Attributes:
+		return GetAttributeColumnText(itemInfo);
+
+	case SortMode::ShortName:
+		return GetShortNameColumnText(itemInfo);
+
+	case SortMode::Owner:
+		return GetOwnerColumnText(itemInfo);
+
+	case SortMode::ProductName:
+		return GetVersionColumnText(itemInfo, VersionInfoType::ProductName);
+
+	case SortMode::Company:
+		return GetVersionColumnText(itemInfo, VersionInfoType::Company);
+
+	case SortMode::Description:
+		return GetVersionColumnText(itemInfo, VersionInfoType::Description);
+
+	case SortMode::FileVersion:
+		return GetVersionColumnText(itemInfo, VersionInfoType::FileVersion);
+
+	case SortMode::ProductVersion:
+		return GetVersionColumnText(itemInfo, VersionInfoType::ProductVersion);
+
+	case SortMode::ShortcutTo:
+		return GetShortcutToColumnText(itemInfo);
+
+	case SortMode::Extension:
+		return GetExtensionColumnText(itemInfo);
+
+	case SortMode::CameraModel:
+		return GetImageColumnText(itemInfo, PropertyTagEquipModel);
+
+	case SortMode::DateTaken:
+		return GetImageColumnText(itemInfo, PropertyTagDateTime);
+
+	case SortMode::Width:
+		return GetImageColumnText(itemInfo, PropertyTagImageWidth);
+
+	case SortMode::Height:
+		return GetImageColumnText(itemInfo, PropertyTagImageHeight);
+
+	case SortMode::VirtualComments:
+		return GetControlPanelCommentsColumnText(itemInfo);
+
+	case SortMode::FileSystem:
+		return GetFileSystemColumnText(itemInfo);
+
+	case SortMode::NumPrinterDocuments:
+		return GetPrinterColumnText(itemInfo, PrinterInformationType::NumJobs);
+
+	case SortMode::PrinterStatus:
+		return GetPrinterColumnText(itemInfo, PrinterInformationType::Status);
+
+	case SortMode::PrinterComments:
+		return GetPrinterColumnText(itemInfo, PrinterInformationType::Comments);
+
+	case SortMode::PrinterLocation:
+		return GetPrinterColumnText(itemInfo, PrinterInformationType::Location);
+
+	case SortMode::NetworkAdapterStatus:
+		return GetNetworkAdapterColumnText(itemInfo);
+
+	case SortMode::MediaBitrate:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Bitrate);
+
+	case SortMode::MediaCopyright:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Copyright);
+
+	case SortMode::MediaDuration:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Duration);
+
+	case SortMode::MediaProtected:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Protected);
+
+	case SortMode::MediaRating:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Rating);
+
+	case SortMode::MediaAlbumArtist:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::AlbumArtist);
+
+	case SortMode::MediaAlbum:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::AlbumTitle);
+
+	case SortMode::MediaBeatsPerMinute:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::BeatsPerMinute);
+
+	case SortMode::MediaComposer:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Composer);
+
+	case SortMode::MediaConductor:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Conductor);
+
+	case SortMode::MediaDirector:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Director);
+
+	case SortMode::MediaGenre:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Genre);
+
+	case SortMode::MediaLanguage:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Language);
+
+	case SortMode::MediaBroadcastDate:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::BroadcastDate);
+
+	case SortMode::MediaChannel:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Channel);
+
+	case SortMode::MediaStationName:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::StationName);
+
+	case SortMode::MediaMood:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Mood);
+
+	case SortMode::MediaParentalRating:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::ParentalRating);
+
+	case SortMode::MediaParentalRatingReason:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::ParentalRatingReason);
+
+	case SortMode::MediaPeriod:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Period);
+
+	case SortMode::MediaProducer:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Producer);
+
+	case SortMode::MediaPublisher:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Publisher);
+
+	case SortMode::MediaWriter:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Writer);
+
+	case SortMode::MediaYear:
+		return GetMediaMetadataColumnText(itemInfo, MediaMetadataType::Year);
+
+	default:
+		assert(false);
+		break;
+	}
+
+	return L"";
+}
+
+std::vector<int> SortKeyTable::Sort() const
+{
+	std::vector<size_t> order(m_keys.size());
+	std::iota(order.begin(), order.end(), 0);
+
+	std::sort(order.begin(), order.end(),
+		[this](size_t index1, size_t index2)
+		{
+			return Compare(m_keys[index1], m_keys[index2]) < 0;
+		});
+
+	std::vector<int> sortedInternalIndexes;
+	sortedInternalIndexes.reserve(order.size());
+
+	for (size_t index : order)
+	{
+		sortedInternalIndexes.push_back(m_keys[index].internalIndex);
+	}
+
+	return sortedInternalIndexes;
+}
+
+int SortKeyTable::CompareItems(size_t index1, size_t index2) const
+{
+	return Compare(m_keys.at(index1), m_keys.at(index2));
+}
+
+int SortKeyTable::CompareStrings(const wchar_t *str1, const wchar_t *str2) const
+{
+	if (m_globalFolderSettings.useNaturalSortOrder)
+	{
+		return StrCmpLogicalW(str1, str2);
+	}
+	else
+	{
+		return StrCmpIW(str1, str2);
+	}
+}
+
+int SortKeyTable::ComparePrimary(const SortKey &key1, const SortKey &key2) const
+{
+	switch (m_keyType)
+	{
+	case KeyType::Name:
+		if (key1.isRoot != key2.isRoot)
+		{
+			return key1.isRoot ? -1 : 1;
+		}
+
+		return CompareStrings(GetString(key1.textOffset), GetString(key2.textOffset));
+
+	case KeyType::TextRootsFirst:
+		if (key1.isRoot != key2.isRoot)
+		{
+			return key1.isRoot ? -1 : 1;
+		}
+
+		return StrCmpLogicalW(GetString(key1.textOffset), GetString(key2.textOffset));
+
+	case KeyType::Text:
+		return StrCmpLogicalW(GetString(key1.textOffset), GetString(key2.textOffset));
+
+	case KeyType::Size:
+	case KeyType::Number:
+		if (key1.hasValue != key2.hasValue)
+		{
+			return key1.hasValue ? 1 : -1;
+		}
+		else if (!key1.hasValue)
+		{
+			return 0;
+		}
+
+		if (key1.value > key2.value)
+		{
+			return 1;
+		}
+		else if (key1.value < key2.value)
+		{
+			return -1;
+		}
+
+		return 0;
+	}
+
+	assert(false);
+	return 0;
+}
+
+/* Also see ShellBrowser::Sort. */
+int SortKeyTable::Compare(const SortKey &key1, const SortKey &key2) const
+{
+	int comparisonResult;
+
+	if (m_separateFoldersFromFiles && key1.isFolder != key2.isFolder)
+	{
+		comparisonResult = key1.isFolder ? -1 : 1;
+	}
+	else
+	{
+		comparisonResult = ComparePrimary(key1, key2);
+	}
+
+	if (comparisonResult == 0)
+	{
+		comparisonResult =
+			CompareStrings(GetString(key1.displayNameOffset), GetString(key2.displayNameOffset));
+	}
+
+	if (!m_sortAscending)
+	{
+		comparisonResult = -comparisonResult;
+	}
+
+	return comparisonResult;
+}
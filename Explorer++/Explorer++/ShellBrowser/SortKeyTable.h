@@ -0,0 +1,93 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ColumnDataRetrieval.h"
+#include "FolderSettings.h"
+#include "SortModes.h"
+#include <string>
+#include <vector>
+
+struct BasicItemInfo_t;
+
+// Sorting through LVM_SORTITEMS means that the data for each item is retrieved (and copied) every
+// time two items are compared. That's O(n log n) retrievals, each of which can be expensive (e.g.
+// retrieving the type or owner of an item).
+// This class instead extracts a compact key for each item a single time. The items can then be
+// ordered by comparing the keys alone. The order produced is the same as the order produced by
+// ShellBrowser::Sort().
+class SortKeyTable
+{
+public:
+	SortKeyTable(SortMode sortMode, bool sortAscending, bool separateFoldersFromFiles,
+		const GlobalFolderSettings &globalFolderSettings);
+
+	// Items in some sort modes (e.g. those that are compared via a VARIANT) can't be represented
+	// by a key and need to be sorted through the regular comparison function instead.
+	static bool IsSortModeSupported(SortMode sortMode);
+
+	void Reserve(size_t numItems);
+	void AddItem(int internalIndex, const BasicItemInfo_t &itemInfo);
+
+	// Returns the internal indexes of the items that were added, in sorted order.
+	std::vector<int> Sort() const;
+
+	// Compares two items by their position within the list of keys (i.e. their order of
+	// insertion). Exposed primarily so that the comparison can be tested directly.
+	int CompareItems(size_t index1, size_t index2) const;
+
+private:
+	enum class KeyType
+	{
+		// Items are ordered by their name (or full path, for drives).
+		Name,
+
+		// Items are ordered by a piece of text, with drives placed first.
+		TextRootsFirst,
+
+		// Items are ordered by a piece of text.
+		Text,
+
+		// Items are ordered by a numeric value. Items without a value are placed first.
+		Number,
+
+		// Items are ordered by size. Folders are only given a value if their size has already been
+		// calculated. Otherwise, they're placed first.
+		Size
+	};
+
+	struct SortKey
+	{
+		int internalIndex;
+		bool isFolder;
+		bool isRoot;
+		bool hasValue;
+		ULONGLONG value;
+
+		// Offsets into m_stringArena. Each string is null-terminated, so that it can be passed
+		// directly to the shell comparison functions.
+		size_t textOffset;
+		size_t displayNameOffset;
+	};
+
+	static KeyType GetKeyType(SortMode sortMode);
+
+	size_t AddString(const std::wstring &str);
+	const wchar_t *GetString(size_t offset) const;
+	bool GetNumericValue(const BasicItemInfo_t &itemInfo, ULONGLONG &value) const;
+	std::wstring GetTextValue(const BasicItemInfo_t &itemInfo) const;
+	int CompareStrings(const wchar_t *str1, const wchar_t *str2) const;
+	int ComparePrimary(const SortKey &key1, const SortKey &key2) const;
+	int Compare(const SortKey &key1, const SortKey &key2) const;
+
+	const SortMode m_sortMode;
+	const KeyType m_keyType;
+	const bool m_sortAscending;
+	const bool m_separateFoldersFromFiles;
+	const GlobalFolderSettings &m_globalFolderSettings;
+
+	std::vector<SortKey> m_keys;
+	std::wstring m_stringArena;
+};
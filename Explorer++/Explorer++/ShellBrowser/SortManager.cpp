@@ -7,9 +7,11 @@
 #include "Config.h"
 #include "ItemData.h"
 #include "SortHelper.h"
+#include "SortKeyTable.h"
 #include "SortModes.h"
 #include "ViewModes.h"
 #include <propkey.h>
+#include <algorithm>
 #include <cassert>
 
 void ShellBrowser::SortFolder(SortMode sortMode)
@@ -18,15 +20,21 @@ void ShellBrowser::SortFolder(SortMode sortMode)
 
 	if (m_folderSettings.showInGroups)
 	{
-		ListView_EnableGroupView(m_hListView, FALSE);
-		ListView_RemoveAllGroups(m_hListView);
-		ListView_EnableGroupView(m_hListView, TRUE);
+		UpdateGroups();
+	}
 
-		SetShowInGroups(TRUE);
+	if (SortKeyTable::IsSortModeSupported(sortMode))
+	{
+		SortUsingKeys();
+	}
+	else
+	{
+		SortUsingComparison();
 	}
 
-	SendMessage(m_hListView, LVM_SORTITEMS, reinterpret_cast<WPARAM>(this),
-		reinterpret_cast<LPARAM>(SortStub));
+	// Any pending item tasks are prioritized by row, so they need to pick up the new order.
+	m_itemTaskScheduler.InvalidateRows();
+	UpdateItemTaskViewport();
 
 	/* If in details view, the column sort
 	arrow will need to be changed to reflect
@@ -37,6 +45,73 @@ void ShellBrowser::SortFolder(SortMode sortMode)
 	}
 }
 
+// Sorts the items in the listview by extracting a key for each item up front, sorting the keys
+// and then applying the resulting order to the listview in a single pass. Each item's data is
+// only retrieved once, rather than once per comparison.
+void ShellBrowser::SortUsingKeys()
+{
+	bool separateFoldersFromFiles = !m_config->globalFolderSettings.displayMixedFilesAndFolders
+		&& !CompareVirtualFolders(CSIDL_BITBUCKET);
+
+	SortKeyTable sortKeyTable(m_folderSettings.sortMode, m_folderSettings.sortAscending,
+		separateFoldersFromFiles, m_config->globalFolderSettings);
+
+	int numItems = ListView_GetItemCount(m_hListView);
+	sortKeyTable.Reserve(numItems);
+
+	for (int i = 0; i < numItems; i++)
+	{
+		int internalIndex = GetItemInternalIndex(i);
+		sortKeyTable.AddItem(internalIndex, getBasicItemInfo(internalIndex));
+	}
+
+	auto sortedInternalIndexes = sortKeyTable.Sort();
+
+	if (m_virtualListView)
+	{
+		SetVirtualItemOrder(std::move(sortedInternalIndexes));
+		return;
+	}
+
+	// Internal indexes are densely packed slots, so the position of each item can be stored
+	// directly in a vector.
+	std::vector<int> sortedPositions(m_itemStore.GetSlotCount(), 0);
+
+	for (int i = 0; i < static_cast<int>(sortedInternalIndexes.size()); i++)
+	{
+		sortedPositions[sortedInternalIndexes[i]] = i;
+	}
+
+	SendMessage(m_hListView, LVM_SORTITEMS, reinterpret_cast<WPARAM>(&sortedPositions),
+		reinterpret_cast<LPARAM>(SortByPositionStub));
+}
+
+void ShellBrowser::SortUsingComparison()
+{
+	if (m_virtualListView)
+	{
+		std::vector<int> internalIndexes = m_directoryState.virtualItems.GetItems();
+
+		std::stable_sort(internalIndexes.begin(), internalIndexes.end(),
+			[this](int internalIndex1, int internalIndex2)
+			{
+				return Sort(internalIndex1, internalIndex2) < 0;
+			});
+
+		SetVirtualItemOrder(std::move(internalIndexes));
+		return;
+	}
+
+	SendMessage(m_hListView, LVM_SORTITEMS, reinterpret_cast<WPARAM>(this),
+		reinterpret_cast<LPARAM>(SortStub));
+}
+
+int CALLBACK ShellBrowser::SortByPositionStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+{
+	const auto *sortedPositions = reinterpret_cast<const std::vector<int> *>(lParamSort);
+	return (*sortedPositions)[lParam1] - (*sortedPositions)[lParam2];
+}
+
 int CALLBACK ShellBrowser::SortStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
 {
 	auto *pShellBrowser = reinterpret_cast<ShellBrowser *>(lParamSort);
@@ -86,7 +161,8 @@ int CALLBACK ShellBrowser::Sort(int InternalIndex1, int InternalIndex2) const
 			break;
 
 		case SortMode::Size:
-			comparisonResult = SortBySize(basicItemInfo1, basicItemInfo2);
+			comparisonResult =
+				SortBySize(basicItemInfo1, basicItemInfo2, m_config->globalFolderSettings);
 			break;
 
 		case SortMode::DateModified:
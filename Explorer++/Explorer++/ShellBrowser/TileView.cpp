@@ -35,6 +35,13 @@ void ShellBrowser::SetTileViewInfo()
 	int nItems;
 	int i = 0;
 
+	// Tile subitems aren't shown in owner data mode, since that would require each item's type
+	// and size to be retrieved up front.
+	if (m_virtualListView)
+	{
+		return;
+	}
+
 	nItems = ListView_GetItemCount(m_hListView);
 
 	for (i = 0; i < nItems; i++)
@@ -72,14 +79,13 @@ void ShellBrowser::SetTileViewItemInfo(int iItem, int iItemInternal)
 
 	ListView_SetItemText(m_hListView, iItem, 1, shfi.szTypeName);
 
-	if ((m_itemInfoMap.at(iItemInternal).wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+	if ((m_itemStore.GetAttributes(iItemInternal) & FILE_ATTRIBUTE_DIRECTORY)
 		!= FILE_ATTRIBUTE_DIRECTORY)
 	{
 		TCHAR lpszFileSize[32];
 		ULARGE_INTEGER lFileSize;
 
-		lFileSize.LowPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeLow;
-		lFileSize.HighPart = m_itemInfoMap.at(iItemInternal).wfd.nFileSizeHigh;
+		lFileSize.QuadPart = m_itemStore.GetFileSize(iItemInternal);
 
 		FormatSizeString(lFileSize, lpszFileSize, SIZEOF_ARRAY(lpszFileSize),
 			m_config->globalFolderSettings.forceSize,
@@ -0,0 +1,101 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "VirtualItemList.h"
+#include <algorithm>
+
+int VirtualItemList::GetCount() const
+{
+	return static_cast<int>(m_items.size());
+}
+
+int VirtualItemList::GetInternalIndex(int position) const
+{
+	return m_items.at(position);
+}
+
+std::optional<int> VirtualItemList::GetPosition(int internalIndex) const
+{
+	UpdatePositions();
+
+	if (internalIndex < 0 || internalIndex >= static_cast<int>(m_positions.size())
+		|| m_positions[internalIndex] == -1)
+	{
+		return std::nullopt;
+	}
+
+	return m_positions[internalIndex];
+}
+
+int VirtualItemList::Insert(int position, int internalIndex)
+{
+	position = std::clamp(position, 0, GetCount());
+
+	m_items.insert(m_items.begin() + position, internalIndex);
+
+	if (internalIndex >= static_cast<int>(m_positions.size()))
+	{
+		m_positions.resize(internalIndex + 1, -1);
+	}
+
+	m_firstStalePosition = (std::min)(m_firstStalePosition, position);
+
+	return position;
+}
+
+std::optional<int> VirtualItemList::Remove(int internalIndex)
+{
+	auto position = GetPosition(internalIndex);
+
+	if (!position)
+	{
+		return std::nullopt;
+	}
+
+	m_items.erase(m_items.begin() + *position);
+	m_positions[internalIndex] = -1;
+	m_firstStalePosition = (std::min)(m_firstStalePosition, *position);
+
+	return position;
+}
+
+void VirtualItemList::SetOrder(std::vector<int> internalIndexes)
+{
+	m_items = std::move(internalIndexes);
+
+	std::fill(m_positions.begin(), m_positions.end(), -1);
+
+	auto maxInternalIndex = std::max_element(m_items.begin(), m_items.end());
+
+	if (maxInternalIndex != m_items.end()
+		&& *maxInternalIndex >= static_cast<int>(m_positions.size()))
+	{
+		m_positions.resize(*maxInternalIndex + 1, -1);
+	}
+
+	m_firstStalePosition = 0;
+}
+
+const std::vector<int> &VirtualItemList::GetItems() const
+{
+	return m_items;
+}
+
+void VirtualItemList::Clear()
+{
+	m_items.clear();
+	m_positions.clear();
+	m_firstStalePosition = 0;
+}
+
+void VirtualItemList::UpdatePositions() const
+{
+	for (int i = m_firstStalePosition; i < GetCount(); i++)
+	{
+		m_positions[m_items[i]] = i;
+	}
+
+	m_firstStalePosition = GetCount();
+}
@@ -0,0 +1,51 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <optional>
+#include <vector>
+
+// In owner data mode, the listview only stores the number of items it contains (along with the
+// selection and focus state of each item). This class maintains the order of the items instead,
+// mapping each position in the listview to the internal index of the item shown at that position
+// (and back again).
+class VirtualItemList
+{
+public:
+	int GetCount() const;
+
+	// Returns the internal index of the item at the specified position. Throws if the position is
+	// out of range.
+	int GetInternalIndex(int position) const;
+
+	std::optional<int> GetPosition(int internalIndex) const;
+
+	// Inserts the item before the item currently at the specified position. Positions past the end
+	// of the list will result in the item being appended. Returns the position of the item.
+	int Insert(int position, int internalIndex);
+
+	// Returns the position the item was removed from, or nothing if the item wasn't in the list.
+	std::optional<int> Remove(int internalIndex);
+
+	// Replaces the current order. Any items not contained in the new order are removed.
+	void SetOrder(std::vector<int> internalIndexes);
+
+	const std::vector<int> &GetItems() const;
+	void Clear();
+
+private:
+	void UpdatePositions() const;
+
+	std::vector<int> m_items;
+
+	// Maps each internal index to its position (or -1, if the item isn't in the list). Internal
+	// indexes are densely packed slots, so a vector can be used, rather than a map.
+	// Inserting or removing an item shifts every item after it, so rather than updating the
+	// positions immediately, only the first position that's out of date is recorded. The
+	// positions are then rebuilt from that point the next time they're needed. That way, items
+	// that are appended (e.g. while a folder is being enumerated) don't result in any extra work.
+	mutable std::vector<int> m_positions;
+	mutable int m_firstStalePosition = 0;
+};
@@ -0,0 +1,361 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ShellBrowser.h"
+#include "Config.h"
+#include "ItemData.h"
+#include "ViewModes.h"
+#include "../Helper/ListViewHelper.h"
+#include <wil/common.h>
+#include <algorithm>
+#include <cassert>
+
+// In owner data mode, the listview doesn't store the text, image or lParam value of any item, so
+// everything about the item is provided here, each time the item is drawn. That means the item
+// text and image need to be stored, so that they're only retrieved once.
+void ShellBrowser::OnVirtualListViewGetDisplayInfo(LVITEM *item)
+{
+	int internalIndex = GetItemInternalIndex(item->iItem);
+	auto &itemData = m_directoryState.virtualItemData[internalIndex];
+
+	if (WI_IsFlagSet(item->mask, LVIF_TEXT))
+	{
+		std::wstring text =
+			GetVirtualItemText(internalIndex, item->iItem, item->iSubItem, itemData);
+		StringCchCopy(item->pszText, item->cchTextMax, text.c_str());
+	}
+
+	if (WI_IsFlagSet(item->mask, LVIF_IMAGE))
+	{
+		if (!itemData.image)
+		{
+			if (m_folderSettings.viewMode == +ViewMode::Thumbnails)
+			{
+				itemData.image = GetThumbnailImageForItem(internalIndex, item->iItem);
+			}
+			else
+			{
+				itemData.image = GetIconImageForItem(internalIndex);
+			}
+		}
+
+		item->iImage = *itemData.image;
+	}
+
+	if (WI_IsFlagSet(item->mask, LVIF_STATE))
+	{
+		UINT state = itemData.state;
+
+		/* If the file is marked as hidden, ghost it out. */
+		if (WI_IsFlagSet(m_itemStore.GetAttributes(internalIndex), FILE_ATTRIBUTE_HIDDEN))
+		{
+			WI_SetFlag(state, LVIS_CUT);
+		}
+
+		item->state = state & item->stateMask;
+	}
+}
+
+std::wstring ShellBrowser::GetVirtualItemText(int internalIndex, int row, int subItem,
+	VirtualItemData &itemData)
+{
+	// The item text in non-details view is always the filename.
+	ColumnType columnType = ColumnType::Name;
+
+	if (m_folderSettings.viewMode == +ViewMode::Details)
+	{
+		auto detailsColumnType = GetColumnTypeByIndex(subItem);
+		assert(detailsColumnType);
+
+		columnType = *detailsColumnType;
+	}
+	else if (subItem != 0)
+	{
+		return {};
+	}
+
+	auto [itr, inserted] = itemData.columnText.try_emplace(columnType);
+
+	if (inserted)
+	{
+		if (columnType == ColumnType::Name)
+		{
+			itr->second = ProcessItemFileName(getBasicItemInfo(internalIndex),
+				m_config->globalFolderSettings);
+		}
+		else
+		{
+			// The text will be set once the task has finished.
+			QueueColumnTask(internalIndex, row, columnType);
+		}
+	}
+
+	return itr->second;
+}
+
+// Sent when the user types the name of an item. The search starts at the item after the one that's
+// currently focused and can wrap around to the start of the list.
+int ShellBrowser::OnListViewFindItem(const NMLVFINDITEM *findItem) const
+{
+	if (WI_AreAllFlagsClear(findItem->lvfi.flags, LVFI_STRING | LVFI_PARTIAL))
+	{
+		return -1;
+	}
+
+	int numItems = m_directoryState.virtualItems.GetCount();
+
+	if (numItems == 0)
+	{
+		return -1;
+	}
+
+	std::wstring_view searchText = findItem->lvfi.psz;
+	bool partialMatch = WI_IsFlagSet(findItem->lvfi.flags, LVFI_PARTIAL);
+	bool wrap = WI_IsFlagSet(findItem->lvfi.flags, LVFI_WRAP);
+	int start = std::clamp(findItem->iStart, 0, numItems);
+
+	for (int i = 0; i < numItems; i++)
+	{
+		int position = start + i;
+
+		if (position >= numItems)
+		{
+			if (!wrap)
+			{
+				break;
+			}
+
+			position -= numItems;
+		}
+
+		// The view is null-terminated, so can be passed directly to the comparison functions.
+		std::wstring_view displayName = m_itemStore.GetDisplayName(GetItemInternalIndex(position));
+
+		if (partialMatch)
+		{
+			if (displayName.size() >= searchText.size()
+				&& StrCmpNIW(displayName.data(), searchText.data(),
+					   static_cast<int>(searchText.size()))
+					== 0)
+			{
+				return position;
+			}
+		}
+		else if (StrCmpIW(displayName.data(), searchText.data()) == 0)
+		{
+			return position;
+		}
+	}
+
+	return -1;
+}
+
+void ShellBrowser::UpdateVirtualItemCount()
+{
+	ListView_SetItemCountEx(m_hListView, m_directoryState.virtualItems.GetCount(),
+		LVSICF_NOSCROLL);
+}
+
+std::optional<int> ShellBrowser::RemoveVirtualItem(int internalIndex)
+{
+	BeginVirtualSelectionUpdate();
+	auto endSelectionUpdate = wil::scope_exit(
+		[this]
+		{
+			EndVirtualSelectionUpdate();
+		});
+
+	auto position = m_directoryState.virtualItems.Remove(internalIndex);
+
+	if (!position)
+	{
+		return std::nullopt;
+	}
+
+	m_directoryState.virtualItemData.erase(internalIndex);
+
+	// The internal index may be reused by an item added later in the same update, so the removed
+	// item shouldn't be selected when the selection is restored.
+	m_savedVirtualSelection->selectedItems.erase(internalIndex);
+
+	if (m_savedVirtualSelection->focusedItem == internalIndex)
+	{
+		m_savedVirtualSelection->focusedItem.reset();
+	}
+
+	UpdateVirtualItemCount();
+
+	return position;
+}
+
+void ShellBrowser::SetVirtualItemOrder(std::vector<int> internalIndexes)
+{
+	BeginVirtualSelectionUpdate();
+
+	m_directoryState.virtualItems.SetOrder(std::move(internalIndexes));
+
+	UpdateVirtualItemCount();
+	EndVirtualSelectionUpdate();
+}
+
+// Moves an item that's been updated to its sorted position. Only the updated item can be out of
+// place, so there's no need to sort the entire list.
+void ShellBrowser::RepositionVirtualItem(int internalIndex)
+{
+	BeginVirtualSelectionUpdate();
+	auto endSelectionUpdate = wil::scope_exit(
+		[this]
+		{
+			EndVirtualSelectionUpdate();
+		});
+
+	if (!m_directoryState.virtualItems.Remove(internalIndex))
+	{
+		return;
+	}
+
+	int position = DetermineItemSortedPosition(internalIndex);
+	m_directoryState.virtualItems.Insert(position, internalIndex);
+
+	InvalidateRect(m_hListView, nullptr, TRUE);
+}
+
+// The listview tracks the selection by position, so any change to the order of the items needs to
+// be bracketed by these calls, which save the selection (by internal index) and then restore it.
+// Outside of owner data mode, they do nothing. The calls can be nested, so that when a batch of
+// changes is applied, the selection is only saved and restored once, rather than once for every
+// change (which would take quadratic time).
+void ShellBrowser::BeginVirtualSelectionUpdate()
+{
+	if (!m_virtualListView)
+	{
+		return;
+	}
+
+	if (m_virtualSelectionUpdateDepth++ == 0)
+	{
+		m_savedVirtualSelection = SaveVirtualSelection();
+	}
+}
+
+void ShellBrowser::EndVirtualSelectionUpdate()
+{
+	if (!m_virtualListView)
+	{
+		return;
+	}
+
+	assert(m_virtualSelectionUpdateDepth > 0);
+
+	if (--m_virtualSelectionUpdateDepth == 0)
+	{
+		RestoreVirtualSelection(*m_savedVirtualSelection);
+		m_savedVirtualSelection.reset();
+	}
+}
+
+ShellBrowser::VirtualSelection ShellBrowser::SaveVirtualSelection() const
+{
+	VirtualSelection selection;
+
+	int item = -1;
+
+	while ((item = ListView_GetNextItem(m_hListView, item, LVNI_SELECTED)) != -1)
+	{
+		selection.selectedItems.insert(GetItemInternalIndex(item));
+	}
+
+	int focusedItem = ListView_GetNextItem(m_hListView, -1, LVNI_FOCUSED);
+
+	if (focusedItem != -1)
+	{
+		selection.focusedItem = GetItemInternalIndex(focusedItem);
+	}
+
+	return selection;
+}
+
+void ShellBrowser::RestoreVirtualSelection(const VirtualSelection &selection)
+{
+	if (selection.selectedItems.empty() && !selection.focusedItem)
+	{
+		return;
+	}
+
+	int numItems = m_directoryState.virtualItems.GetCount();
+
+	if (static_cast<int>(selection.selectedItems.size()) == numItems)
+	{
+		// Every item is still selected, so there's no need to update the selection for each item
+		// individually.
+		ListView_SetItemState(m_hListView, -1, 0, LVIS_FOCUSED);
+	}
+	else
+	{
+		ListView_SetItemState(m_hListView, -1, 0, LVIS_SELECTED | LVIS_FOCUSED);
+
+		for (int internalIndex : selection.selectedItems)
+		{
+			auto position = m_directoryState.virtualItems.GetPosition(internalIndex);
+
+			if (position)
+			{
+				ListViewHelper::SelectItem(m_hListView, *position, TRUE);
+			}
+		}
+	}
+
+	if (selection.focusedItem)
+	{
+		auto position = m_directoryState.virtualItems.GetPosition(*selection.focusedItem);
+
+		if (position)
+		{
+			ListViewHelper::FocusItem(m_hListView, *position, TRUE);
+		}
+	}
+}
+
+void ShellBrowser::InvalidateVirtualItemText(int item)
+{
+	auto itr = m_directoryState.virtualItemData.find(GetItemInternalIndex(item));
+
+	if (itr != m_directoryState.virtualItemData.end())
+	{
+		itr->second.columnText.clear();
+	}
+
+	ListView_RedrawItems(m_hListView, item, item);
+}
+
+// The empty entry for the column was added when the task was queued. It needs to be removed, so
+// that the text will be requested again if the item is scrolled back into view.
+void ShellBrowser::OnVirtualColumnTaskDropped(int internalIndex, uint32_t itemGeneration,
+	ColumnType columnType)
+{
+	// If the slot has since been reused, the placeholder text belongs to the new item.
+	if (!m_itemStore.Contains(internalIndex, itemGeneration))
+	{
+		return;
+	}
+
+	auto itr = m_directoryState.virtualItemData.find(internalIndex);
+
+	if (itr == m_directoryState.virtualItemData.end())
+	{
+		return;
+	}
+
+	itr->second.columnText.erase(columnType);
+}
+
+void ShellBrowser::ResetVirtualItemData()
+{
+	for (auto &[internalIndex, itemData] : m_directoryState.virtualItemData)
+	{
+		itemData.image.reset();
+		itemData.columnText.clear();
+	}
+}
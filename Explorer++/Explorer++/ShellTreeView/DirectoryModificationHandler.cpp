@@ -6,6 +6,7 @@
 #include "ShellTreeView.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
+#include <unordered_set>
 
 void ShellTreeView::DirectoryAltered()
 {
@@ -61,6 +62,10 @@ void ShellTreeView::DirectoryAltered()
 		case FILE_ACTION_RENAMED_NEW_NAME:
 			DirectoryAlteredRenameFile(af.szFileName);
 			break;
+
+		case DIRECTORY_MONITOR_ACTION_RESYNC:
+			ResyncDrive(af.szFileName);
+			break;
 		}
 	}
 
@@ -262,39 +267,212 @@ void ShellTreeView::DirectoryAlteredRenameFile(const TCHAR *szFullFileName)
 	}
 }
 
-void ShellTreeView::DirectoryAlteredCallback(const TCHAR *szFileName, DWORD dwAction, void *pData)
+void ShellTreeView::DirectoryAlteredCallback(const std::vector<DirectoryChange> &changes,
+	void *pData)
 {
 	DirectoryAltered_t *pDirectoryAltered = nullptr;
 	ShellTreeView *shellTreeView = nullptr;
-	TCHAR szFullFileName[MAX_PATH];
 
 	pDirectoryAltered = (DirectoryAltered_t *) pData;
 
 	shellTreeView = pDirectoryAltered->shellTreeView;
 
-	StringCchCopy(szFullFileName, SIZEOF_ARRAY(szFullFileName), pDirectoryAltered->szPath);
-	if (!PathAppend(szFullFileName, szFileName))
+	// The full paths are built here, so that the list only has to be locked once for the entire
+	// batch.
+	std::list<AlteredFile_t> alteredFiles;
+
+	for (const auto &change : changes)
+	{
+		AlteredFile_t af;
+
+		StringCchCopy(af.szFileName, SIZEOF_ARRAY(af.szFileName), pDirectoryAltered->szPath);
+		if (!PathAppend(af.szFileName, change.fileName.c_str()))
+		{
+			continue;
+		}
+
+		af.dwAction = change.action;
+
+		alteredFiles.push_back(af);
+	}
+
+	if (alteredFiles.empty())
 	{
 		return;
 	}
 
-	shellTreeView->DirectoryModified(dwAction, szFullFileName);
+	shellTreeView->DirectoryModified(std::move(alteredFiles));
 }
 
-void ShellTreeView::DirectoryModified(DWORD dwAction, const TCHAR *szFullFileName)
+void ShellTreeView::DirectoryModified(std::list<AlteredFile_t> alteredFiles)
 {
 	EnterCriticalSection(&m_cs);
 
 	SetTimer(m_hTreeView, DIRECTORY_MODIFIED_TIMER_ID, DIRECTORY_MODIFIED_TIMER_ELAPSE, nullptr);
 
-	AlteredFile_t af;
+	m_AlteredList.splice(m_AlteredList.end(), alteredFiles);
 
-	StringCchCopy(af.szFileName, SIZEOF_ARRAY(af.szFileName), szFullFileName);
-	af.dwAction = dwAction;
+	LeaveCriticalSection(&m_cs);
+}
 
-	m_AlteredList.push_back(af);
+// Some of the changes to the drive were lost (because they arrived faster than they could be
+// read). Since the drive is watched recursively, there's no record of its previous contents to
+// compare against. Instead, the children of each expanded folder are compared against the
+// folders that currently exist. Collapsed folders will be enumerated again when they're next
+// expanded, so don't need to be checked.
+//
+// The folders are enumerated in the background, in the same way as when an item is expanded. Each
+// expanded child is then resynced once the children of its parent have been updated.
+void ShellTreeView::ResyncDrive(const TCHAR *szDrive)
+{
+	HTREEITEM hDriveItem = LocateItemByPath(szDrive, FALSE);
 
-	LeaveCriticalSection(&m_cs);
+	if (hDriveItem == nullptr)
+	{
+		return;
+	}
+
+	ResyncExpandedItem(hDriveItem);
+}
+
+void ShellTreeView::ResyncExpandedItem(HTREEITEM hItem)
+{
+	UINT state = TreeView_GetItemState(m_hTreeView, hItem, TVIS_EXPANDED);
+
+	if (WI_IsFlagClear(state, TVIS_EXPANDED))
+	{
+		return;
+	}
+
+	// The enumeration that's pending will pick up the current set of folders once it's
+	// restarted.
+	if (IsExpansionPending(hItem))
+	{
+		ReloadChildItems(hItem, false);
+		return;
+	}
+
+	// Any resync that's already pending for this item is superseded.
+	CancelResync(hItem);
+
+	PendingResync resync;
+	resync.item = hItem;
+
+	BasicItemInfo basicItemInfo;
+	basicItemInfo.pidl = GetItemPidl(hItem);
+
+	int resyncID = m_resyncIDCounter++;
+	ExpansionOptions options = GetExpansionOptions();
+	std::stop_token stopToken = resync.stopSource.get_token();
+
+	resync.result = m_expansionTaskGroup.Push(
+		[this, resyncID, basicItemInfo, options, stopToken]()
+		{
+			return EnumerateChildItemsAsync(m_hTreeView, WM_APP_RESYNC_RESULT_READY, resyncID,
+				basicItemInfo.pidl.get(), options, stopToken);
+		});
+
+	m_pendingResyncs.insert({ resyncID, std::move(resync) });
+}
+
+void ShellTreeView::ProcessResyncResult(int resyncId)
+{
+	auto itr = m_pendingResyncs.find(resyncId);
+
+	if (itr == m_pendingResyncs.end())
+	{
+		// The resync was cancelled.
+		return;
+	}
+
+	HTREEITEM hItem = itr->second.item;
+	auto currentItems = itr->second.result.get();
+	m_pendingResyncs.erase(itr);
+
+	if (!currentItems)
+	{
+		return;
+	}
+
+	ApplyResyncedChildItems(hItem, *currentItems);
+}
+
+void ShellTreeView::ApplyResyncedChildItems(HTREEITEM hItem,
+	const std::vector<ExpandedItem> &currentItems)
+{
+	std::unordered_set<std::wstring> currentKeys;
+
+	for (const auto &currentItem : currentItems)
+	{
+		currentKeys.insert(GetParsingNameIndexKey(currentItem.parsingName));
+	}
+
+	std::unordered_set<std::wstring> existingKeys;
+	std::vector<HTREEITEM> existingChildren;
+	std::vector<std::wstring> removedPaths;
+
+	for (auto hChild = TreeView_GetChild(m_hTreeView, hItem); hChild != nullptr;
+		 hChild = TreeView_GetNextSibling(m_hTreeView, hChild))
+	{
+		auto keyItr = m_itemParsingNameKeys.find(hChild);
+
+		if (keyItr == m_itemParsingNameKeys.end())
+		{
+			continue;
+		}
+
+		existingKeys.insert(keyItr->second);
+
+		if (currentKeys.contains(keyItr->second))
+		{
+			existingChildren.push_back(hChild);
+		}
+		else
+		{
+			std::wstring path;
+			HRESULT hr = GetDisplayName(GetItemPidl(hChild).get(), SHGDN_FORPARSING, path);
+
+			if (SUCCEEDED(hr))
+			{
+				removedPaths.push_back(path);
+			}
+		}
+	}
+
+	for (auto hChild : existingChildren)
+	{
+		ResyncExpandedItem(hChild);
+	}
+
+	for (const auto &path : removedPaths)
+	{
+		DirectoryAlteredRemoveFile(path.c_str());
+	}
+
+	for (const auto &currentItem : currentItems)
+	{
+		if (!existingKeys.contains(GetParsingNameIndexKey(currentItem.parsingName)))
+		{
+			DirectoryAlteredAddFile(currentItem.parsingName.c_str());
+		}
+	}
+}
+
+void ShellTreeView::CancelResync(HTREEITEM hItem)
+{
+	auto itr = std::find_if(m_pendingResyncs.begin(), m_pendingResyncs.end(),
+		[hItem](const auto &entry)
+		{
+			return entry.second.item == hItem;
+		});
+
+	if (itr == m_pendingResyncs.end())
+	{
+		return;
+	}
+
+	itr->second.stopSource.request_stop();
+	m_pendingResyncs.erase(itr);
 }
 
 void ShellTreeView::AddDrive(const TCHAR *szDrive)
@@ -373,6 +551,15 @@ void ShellTreeView::AddItemInternal(HTREEITEM hParent, const TCHAR *szFullFileNa
 	int iItemId;
 	int nChildren = 0;
 
+	// The children of the parent are currently being enumerated, but the enumeration may have
+	// started before this item was created. Restarting the enumeration ensures that the item will
+	// be included.
+	if (hParent != nullptr && IsExpansionPending(hParent))
+	{
+		ReloadChildItems(hParent, false);
+		return;
+	}
+
 	hr = SHParseDisplayName(szFullFileName, nullptr, &pidlComplete, 0, nullptr);
 
 	if (!SUCCEEDED(hr))
@@ -442,7 +629,12 @@ void ShellTreeView::AddItemInternal(HTREEITEM hParent, const TCHAR *szFullFileNa
 						tvis.hInsertAfter = DetermineItemSortedPosition(hParent, szFullFileName);
 						tvis.itemex = tvItem;
 
-						TreeView_InsertItem(m_hTreeView, &tvis);
+						auto hItem = TreeView_InsertItem(m_hTreeView, &tvis);
+
+						if (hItem != nullptr)
+						{
+							AddItemToIndex(hItem, pidlComplete);
+						}
 					}
 				}
 
@@ -497,9 +689,21 @@ void ShellTreeView::RenameItem(HTREEITEM hItem, const TCHAR *szFullFileName)
 			tvItem.iSelectedImage = shfi.iIcon;
 			TreeView_SetItem(m_hTreeView, &tvItem);
 
-			/* Now recursively go through each of this items children and
-			update their pidl's. */
-			UpdateChildren(hItem, pidlParent);
+			AddItemToIndex(hItem, pidlParent);
+
+			if (IsExpansionPending(hItem))
+			{
+				/* The children are still being enumerated, using the
+				previous path. It's simpler to restart the enumeration
+				than it is to update the pending results. */
+				ReloadChildItems(hItem, false);
+			}
+			else
+			{
+				/* Now recursively go through each of this items children and
+				update their pidl's (and their indexed paths). */
+				UpdateChildren(hItem, pidlParent);
+			}
 		}
 	}
 }
@@ -521,9 +725,14 @@ void ShellTreeView::UpdateChildren(HTREEITEM hParent, PCIDLIST_ABSOLUTE pidlPare
 
 		if (bRes)
 		{
-			pidl = UpdateItemInfo(pidlParent, (int) tvItem.lParam);
+			// The loading item (which is always the first child, if present) doesn't have a pidl.
+			if (tvItem.lParam != LOADING_ITEM_ID)
+			{
+				pidl = UpdateItemInfo(pidlParent, (int) tvItem.lParam);
+				AddItemToIndex(hChild, pidl);
 
-			UpdateChildren(hChild, pidl);
+				UpdateChildren(hChild, pidl);
+			}
 
 			while ((hChild = TreeView_GetNextItem(m_hTreeView, hChild, TVGN_NEXT)) != nullptr)
 			{
@@ -534,6 +743,7 @@ void ShellTreeView::UpdateChildren(HTREEITEM hParent, PCIDLIST_ABSOLUTE pidlPare
 				if (bRes)
 				{
 					pidl = UpdateItemInfo(pidlParent, (int) tvItem.lParam);
+					AddItemToIndex(hChild, pidl);
 
 					UpdateChildren(hChild, pidl);
 				}
@@ -19,8 +19,9 @@
 #include "Config.h"
 #include "CoreInterface.h"
 #include "DarkModeHelper.h"
+#include "MainResource.h"
+#include "ResourceHelper.h"
 #include "TabContainer.h"
-#include "../Helper/CachedIcons.h"
 #include "../Helper/ClipboardHelper.h"
 #include "../Helper/Controls.h"
 #include "../Helper/DragDropHelper.h"
@@ -30,29 +31,30 @@
 #include "../Helper/Helper.h"
 #include "../Helper/Macros.h"
 #include "../Helper/ShellHelper.h"
+#include "../Helper/StringHelper.h"
 #include <wil/common.h>
 #include <propkey.h>
+#include <algorithm>
 
-int CALLBACK CompareItemsStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort);
 DWORD WINAPI Thread_MonitorAllDrives(LPVOID pParam);
 
 ShellTreeView::ShellTreeView(HWND hParent, IExplorerplusplus *coreInterface,
 	IDirectoryMonitor *pDirMon, TabContainer *tabContainer, FileActionHandler *fileActionHandler,
-	CachedIcons *cachedIcons) :
+	IconService *iconService) :
 	ShellDropTargetWindow(CreateTreeView(hParent)),
 	m_hTreeView(GetHWND()),
 	m_config(coreInterface->GetConfig()),
 	m_pDirMon(pDirMon),
 	m_tabContainer(tabContainer),
 	m_fileActionHandler(fileActionHandler),
-	m_cachedIcons(cachedIcons),
 	m_itemIDCounter(0),
-	m_iconThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
-	m_iconResultIDCounter(0),
-	m_subfoldersThreadPool(1, std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED),
-		CoUninitialize),
+	m_iconFetcher(iconService),
+	m_subfoldersTaskGroup(WorkerPool::GetInstance(), WorkerPool::Priority::Interactive),
 	m_subfoldersResultIDCounter(0),
+	m_expansionTaskGroup(WorkerPool::GetInstance(), WorkerPool::Priority::Interactive),
+	m_expansionIDCounter(0),
+	m_resyncIDCounter(0),
+	m_expandSynchronously(false),
 	m_cutItem(nullptr),
 	m_dropExpandItem(nullptr)
 {
@@ -82,6 +84,8 @@ ShellTreeView::ShellTreeView(HWND hParent, IExplorerplusplus *coreInterface,
 	InitializeCriticalSection(&m_cs);
 
 	m_iFolderIcon = GetDefaultFolderIconIndex();
+	m_loadingTextFormat =
+		ResourceHelper::LoadString(coreInterface->GetLanguageModule(), IDS_GENERAL_LOADING);
 
 	m_bDragCancelled = FALSE;
 	m_bDragAllowed = FALSE;
@@ -112,7 +116,19 @@ ShellTreeView::~ShellTreeView()
 {
 	DeleteCriticalSection(&m_cs);
 
-	m_iconThreadPool.clear_queue();
+	// Any enumerations that are currently running will stop early, so that the task group doesn't
+	// have to wait for them to finish.
+	m_expansionTaskGroup.Clear();
+
+	for (auto &[expansionId, expansion] : m_pendingExpansions)
+	{
+		expansion.stopSource.request_stop();
+	}
+
+	for (auto &[resyncId, resync] : m_pendingResyncs)
+	{
+		resync.stopSource.request_stop();
+	}
 }
 
 void ShellTreeView::OnApplicationShuttingDown()
@@ -245,14 +261,18 @@ LRESULT CALLBACK ShellTreeView::TreeViewProc(HWND hwnd, UINT msg, WPARAM wParam,
 		OnClipboardUpdate();
 		return 0;
 
-	case WM_APP_ICON_RESULT_READY:
-		ProcessIconResult(static_cast<int>(wParam));
-		break;
-
 	case WM_APP_SUBFOLDERS_RESULT_READY:
 		ProcessSubfoldersResult(static_cast<int>(wParam));
 		break;
 
+	case WM_APP_EXPANSION_RESULT_READY:
+		ProcessExpansionResult(static_cast<int>(wParam));
+		break;
+
+	case WM_APP_RESYNC_RESULT_READY:
+		ProcessResyncResult(static_cast<int>(wParam));
+		break;
+
 	case WM_DESTROY:
 		RemoveClipboardFormatListener(m_hTreeView);
 		break;
@@ -282,7 +302,20 @@ LRESULT CALLBACK ShellTreeView::ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wPara
 			case TVN_BEGINDRAG:
 			{
 				auto *pnmTreeView = reinterpret_cast<NMTREEVIEW *>(lParam);
-				OnBeginDrag(static_cast<int>(pnmTreeView->itemNew.lParam));
+
+				if (pnmTreeView->itemNew.lParam != LOADING_ITEM_ID)
+				{
+					OnBeginDrag(static_cast<int>(pnmTreeView->itemNew.lParam));
+				}
+			}
+			break;
+
+			case TVN_DELETEITEM:
+			{
+				auto *pnmTreeView = reinterpret_cast<NMTREEVIEW *>(lParam);
+				CancelExpansion(pnmTreeView->itemOld.hItem);
+				CancelResync(pnmTreeView->itemOld.hItem);
+				RemoveItemFromIndex(pnmTreeView->itemOld.hItem);
 			}
 			break;
 
@@ -347,7 +380,8 @@ HTREEITEM ShellTreeView::AddRoot()
 
 	if (hDesktop != nullptr)
 	{
-		SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND, reinterpret_cast<LPARAM>(hDesktop));
+		AddItemToIndex(hDesktop, pidl.get());
+		ExpandItemSynchronously(hDesktop);
 	}
 
 	return hDesktop;
@@ -396,100 +430,35 @@ std::optional<int> ShellTreeView::GetCachedIconIndex(const ItemInfo_t &itemInfo)
 		return std::nullopt;
 	}
 
-	auto cachedItr = m_cachedIcons->findByPath(filePath);
-
-	if (cachedItr == m_cachedIcons->end())
-	{
-		return std::nullopt;
-	}
-
-	return cachedItr->iconIndex;
+	return m_iconFetcher.GetCachedIconIndex(filePath);
 }
 
 void ShellTreeView::QueueIconTask(HTREEITEM item, int internalIndex)
 {
 	const ItemInfo_t &itemInfo = m_itemInfoMap.at(internalIndex);
 
-	BasicItemInfo basicItemInfo;
-	basicItemInfo.pidl.reset(ILCloneFull(itemInfo.pidl.get()));
-
-	int iconResultID = m_iconResultIDCounter++;
-
-	auto result = m_iconThreadPool.push(
-		[this, iconResultID, item, internalIndex, basicItemInfo](int id)
+	m_iconFetcher.QueueIconTask(itemInfo.pidl.get(),
+		[this, item, internalIndex](int iconIndex)
 		{
-			UNREFERENCED_PARAMETER(id);
-
-			return FindIconAsync(m_hTreeView, iconResultID, item, internalIndex,
-				basicItemInfo.pidl.get());
+			ProcessIconResult(item, internalIndex, iconIndex);
 		});
-
-	m_iconResults.insert({ iconResultID, std::move(result) });
 }
 
-std::optional<ShellTreeView::IconResult> ShellTreeView::FindIconAsync(HWND treeView,
-	int iconResultId, HTREEITEM item, int internalIndex, PCIDLIST_ABSOLUTE pidl)
+void ShellTreeView::ProcessIconResult(HTREEITEM item, int internalIndex, int iconIndex)
 {
-	SHFILEINFO shfi;
-	DWORD_PTR res = SHGetFileInfo(reinterpret_cast<LPCTSTR>(pidl), 0, &shfi, sizeof(SHFILEINFO),
-		SHGFI_PIDL | SHGFI_ICON | SHGFI_OVERLAYINDEX);
-
-	if (res == 0)
-	{
-		return std::nullopt;
-	}
-
-	DestroyIcon(shfi.hIcon);
-
-	PostMessage(treeView, WM_APP_ICON_RESULT_READY, iconResultId, 0);
-
-	IconResult result;
-	result.item = item;
-	result.internalIndex = internalIndex;
-	result.iconIndex = shfi.iIcon;
-
-	return result;
-}
-
-void ShellTreeView::ProcessIconResult(int iconResultId)
-{
-	auto itr = m_iconResults.find(iconResultId);
-
-	if (itr == m_iconResults.end())
-	{
-		return;
-	}
-
-	auto cleanup = wil::scope_exit(
-		[this, itr]()
-		{
-			m_iconResults.erase(itr);
-		});
-
-	auto result = itr->second.get();
-
-	if (!result)
+	// The item may have been removed while the icon was being retrieved.
+	if (!m_itemInfoMap.contains(internalIndex))
 	{
 		return;
 	}
 
-	const ItemInfo_t &itemInfo = m_itemInfoMap.at(result->internalIndex);
-
-	std::wstring filePath;
-	HRESULT hr = GetDisplayName(itemInfo.pidl.get(), SHGDN_FORPARSING, filePath);
-
-	if (SUCCEEDED(hr))
-	{
-		m_cachedIcons->addOrUpdateFileIcon(filePath, result->iconIndex);
-	}
-
 	TVITEM tvItem;
 	tvItem.mask = TVIF_HANDLE | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_STATE;
-	tvItem.hItem = result->item;
-	tvItem.iImage = result->iconIndex;
-	tvItem.iSelectedImage = result->iconIndex;
+	tvItem.hItem = item;
+	tvItem.iImage = iconIndex;
+	tvItem.iSelectedImage = iconIndex;
 	tvItem.stateMask = TVIS_OVERLAYMASK;
-	tvItem.state = INDEXTOOVERLAYMASK(result->iconIndex >> 24);
+	tvItem.state = INDEXTOOVERLAYMASK(iconIndex >> 24);
 	TreeView_SetItem(m_hTreeView, &tvItem);
 }
 
@@ -500,11 +469,9 @@ void ShellTreeView::QueueSubfoldersTask(HTREEITEM item)
 
 	int subfoldersResultID = m_subfoldersResultIDCounter++;
 
-	auto result = m_subfoldersThreadPool.push(
-		[this, subfoldersResultID, item, basicItemInfo](int id)
+	auto result = m_subfoldersTaskGroup.Push(
+		[this, subfoldersResultID, item, basicItemInfo]()
 		{
-			UNREFERENCED_PARAMETER(id);
-
 			return CheckSubfoldersAsync(m_hTreeView, subfoldersResultID, item,
 				basicItemInfo.pidl.get());
 		});
@@ -583,10 +550,20 @@ void ShellTreeView::OnItemExpanding(const NMTREEVIEW *nmtv)
 
 	if (nmtv->action == TVE_EXPAND)
 	{
-		ExpandDirectory(parentItem);
+		if (m_expandSynchronously)
+		{
+			ExpandDirectory(parentItem);
+		}
+		else
+		{
+			QueueExpansion(parentItem);
+		}
 	}
 	else
 	{
+		CancelExpansion(parentItem);
+		CancelResync(parentItem);
+
 		auto hSelection = TreeView_GetSelection(m_hTreeView);
 
 		if (hSelection != nullptr)
@@ -660,182 +637,472 @@ LRESULT ShellTreeView::OnKeyDown(const NMTVKEYDOWN *keyDown)
 	return 0;
 }
 
-/* Sorts items in the following order:
- - Drives
- - Virtual Items
- - Real Items
-
-Each set is ordered alphabetically. */
-int CALLBACK CompareItemsStub(LPARAM lParam1, LPARAM lParam2, LPARAM lParamSort)
+// Expanding an item can take a long time (e.g. if the folder has a very large number of subfolders,
+// or is on a slow network share), so the children are enumerated in the background. While that's
+// happening, a placeholder item is shown. Once the enumeration has finished, the children are
+// inserted in sorted order, a chunk at a time. Collapsing (or deleting) the item cancels the
+// expansion.
+void ShellTreeView::QueueExpansion(HTREEITEM parentItem)
 {
-	ShellTreeView *shellTreeView = nullptr;
+	TCHAR parentText[MAX_PATH];
+	TVITEMEX parentTvItem;
+	parentTvItem.mask = TVIF_HANDLE | TVIF_TEXT;
+	parentTvItem.hItem = parentItem;
+	parentTvItem.pszText = parentText;
+	parentTvItem.cchTextMax = SIZEOF_ARRAY(parentText);
+	TreeView_GetItem(m_hTreeView, &parentTvItem);
+
+	TCHAR loadingText[MAX_PATH];
+	StringCchPrintf(loadingText, SIZEOF_ARRAY(loadingText), m_loadingTextFormat.c_str(),
+		parentText);
+
+	TVITEMEX tvItem;
+	tvItem.mask = TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_PARAM | TVIF_CHILDREN;
+	tvItem.pszText = loadingText;
+	tvItem.iImage = I_IMAGENONE;
+	tvItem.iSelectedImage = I_IMAGENONE;
+	tvItem.lParam = LOADING_ITEM_ID;
+	tvItem.cChildren = 0;
 
-	shellTreeView = (ShellTreeView *) lParamSort;
+	TVINSERTSTRUCT tvis;
+	tvis.hInsertAfter = TVI_FIRST;
+	tvis.hParent = parentItem;
+	tvis.itemex = tvItem;
+
+	PendingExpansion expansion;
+	expansion.parentItem = parentItem;
+	expansion.loadingItem = TreeView_InsertItem(m_hTreeView, &tvis);
+
+	BasicItemInfo basicItemInfo;
+	basicItemInfo.pidl = GetItemPidl(parentItem);
+
+	int expansionID = m_expansionIDCounter++;
+	ExpansionOptions options = GetExpansionOptions();
+	std::stop_token stopToken = expansion.stopSource.get_token();
 
-	return shellTreeView->CompareItems(lParam1, lParam2);
+	expansion.result = m_expansionTaskGroup.Push(
+		[this, expansionID, basicItemInfo, options, stopToken]()
+		{
+			return EnumerateChildItemsAsync(m_hTreeView, WM_APP_EXPANSION_RESULT_READY, expansionID,
+				basicItemInfo.pidl.get(), options, stopToken);
+		});
+
+	m_pendingExpansions.insert({ expansionID, std::move(expansion) });
 }
 
-int CALLBACK ShellTreeView::CompareItems(LPARAM lParam1, LPARAM lParam2)
+// Once the enumeration has finished, resultMessage is posted to the treeview, with resultId as the
+// wParam.
+std::optional<std::vector<ShellTreeView::ExpandedItem>> ShellTreeView::EnumerateChildItemsAsync(
+	HWND treeView, UINT resultMessage, int resultId, PCIDLIST_ABSOLUTE pidlDirectory,
+	const ExpansionOptions &options, std::stop_token stopToken)
 {
-	TCHAR szTemp[MAX_PATH];
-	int iItemId1 = (int) lParam1;
-	int iItemId2 = (int) lParam2;
+	std::vector<ExpandedItem> items;
+	HRESULT hr = EnumerateChildItems(pidlDirectory, options, stopToken, items);
 
-	const ItemInfo_t &itemInfo1 = m_itemInfoMap.at(iItemId1);
-	const ItemInfo_t &itemInfo2 = m_itemInfoMap.at(iItemId2);
+	if (hr == E_ABORT)
+	{
+		// The expansion was cancelled, so there's nothing waiting on the result.
+		return std::nullopt;
+	}
 
-	std::wstring displayName1;
-	GetDisplayName(itemInfo1.pidl.get(), SHGDN_FORPARSING, displayName1);
+	PostMessage(treeView, resultMessage, resultId, 0);
 
-	std::wstring displayName2;
-	GetDisplayName(itemInfo2.pidl.get(), SHGDN_FORPARSING, displayName2);
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	return items;
+}
 
-	if (PathIsRoot(displayName1.c_str()) && !PathIsRoot(displayName2.c_str()))
+// Returns the children of the specified folder, sorted in the order they should appear in the
+// treeview. Returns E_ABORT if a stop is requested before the enumeration has finished.
+HRESULT ShellTreeView::EnumerateChildItems(PCIDLIST_ABSOLUTE pidlDirectory,
+	const ExpansionOptions &options, std::stop_token stopToken, std::vector<ExpandedItem> &items)
+{
+	wil::com_ptr_nothrow<IShellFolder2> shellFolder2;
+	HRESULT hr = BindToIdl(pidlDirectory, IID_PPV_ARGS(&shellFolder2));
+
+	if (FAILED(hr))
 	{
-		return -1;
+		return hr;
 	}
-	else if (!PathIsRoot(displayName1.c_str()) && PathIsRoot(displayName2.c_str()))
+
+	SHCONTF enumFlags = SHCONTF_FOLDERS;
+
+	if (options.showHidden)
 	{
-		return 1;
+		enumFlags |= SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN;
 	}
-	else if (PathIsRoot(displayName1.c_str()) && PathIsRoot(displayName2.c_str()))
+
+	wil::com_ptr_nothrow<IEnumIDList> pEnumIDList;
+	hr = shellFolder2->EnumObjects(nullptr, enumFlags, &pEnumIDList);
+
+	if (FAILED(hr) || !pEnumIDList)
 	{
-		return lstrcmpi(displayName1.c_str(), displayName2.c_str());
+		return hr;
 	}
-	else
+
+	std::vector<PITEMID_CHILD> batch(EXPANSION_ENUMERATION_BATCH_SIZE);
+	ULONG batchSize = EXPANSION_ENUMERATION_BATCH_SIZE;
+
+	while (true)
 	{
-		if (!SHGetPathFromIDList(itemInfo1.pidl.get(), szTemp)
-			&& SHGetPathFromIDList(itemInfo2.pidl.get(), szTemp))
+		if (stopToken.stop_requested())
 		{
-			return -1;
+			return E_ABORT;
 		}
-		else if (SHGetPathFromIDList(itemInfo1.pidl.get(), szTemp)
-			&& !SHGetPathFromIDList(itemInfo2.pidl.get(), szTemp))
+
+		ULONG numFetched = 0;
+		hr = pEnumIDList->Next(batchSize, batch.data(), &numFetched);
+
+		// Some enumerators only support retrieving a single item at a time.
+		if (hr == E_INVALIDARG && batchSize > 1)
 		{
-			return 1;
+			batchSize = 1;
+			continue;
 		}
-		else
+
+		if (FAILED(hr))
 		{
-			GetDisplayName(itemInfo1.pidl.get(), SHGDN_INFOLDER, displayName1);
-			GetDisplayName(itemInfo2.pidl.get(), SHGDN_INFOLDER, displayName2);
+			break;
+		}
+
+		std::vector<unique_pidl_child> pidls;
 
-			if (m_config->globalFolderSettings.useNaturalSortOrder)
+		for (ULONG i = 0; i < numFetched; i++)
+		{
+			pidls.emplace_back(batch[i]);
+		}
+
+		for (auto &pidl : pidls)
+		{
+			if (stopToken.stop_requested())
 			{
-				return StrCmpLogicalW(displayName1.c_str(), displayName2.c_str());
+				return E_ABORT;
 			}
-			else
+
+			auto item =
+				BuildExpandedItem(shellFolder2.get(), pidlDirectory, std::move(pidl), options);
+
+			if (item)
 			{
-				return StrCmpIW(displayName1.c_str(), displayName2.c_str());
+				items.push_back(std::move(*item));
 			}
 		}
+
+		if (hr != S_OK)
+		{
+			break;
+		}
 	}
+
+	std::sort(items.begin(), items.end(),
+		[&options](const ExpandedItem &item1, const ExpandedItem &item2)
+		{
+			return CompareExpandedItems(item1, item2, options.useNaturalSortOrder) < 0;
+		});
+
+	return S_OK;
 }
 
-HRESULT ShellTreeView::ExpandDirectory(HTREEITEM hParent)
+std::optional<ShellTreeView::ExpandedItem> ShellTreeView::BuildExpandedItem(
+	IShellFolder2 *shellFolder2, PCIDLIST_ABSOLUTE pidlDirectory, unique_pidl_child pidlChild,
+	const ExpansionOptions &options)
 {
-	auto pidlDirectory = GetItemPidl(hParent);
+	if (options.checkPinnedToNamespaceTreeProperty)
+	{
+		BOOL showItem = GetBooleanVariant(shellFolder2, pidlChild.get(),
+			&PKEY_IsPinnedToNameSpaceTree, TRUE);
 
-	wil::com_ptr_nothrow<IShellFolder2> shellFolder2;
-	HRESULT hr = BindToIdl(pidlDirectory.get(), IID_PPV_ARGS(&shellFolder2));
+		if (!showItem)
+		{
+			return std::nullopt;
+		}
+	}
 
-	if (FAILED(hr))
+	if (options.hideSystemFiles && IsSystemItem(shellFolder2, pidlChild.get()))
 	{
-		return hr;
+		return std::nullopt;
 	}
 
-	SHCONTF enumFlags = SHCONTF_FOLDERS;
+	ExpandedItem item;
+	HRESULT hr = GetDisplayName(shellFolder2, pidlChild.get(), SHGDN_NORMAL, item.name);
 
-	if (m_bShowHidden)
+	if (FAILED(hr))
 	{
-		enumFlags |= SHCONTF_INCLUDEHIDDEN | SHCONTF_INCLUDESUPERHIDDEN;
+		return std::nullopt;
 	}
 
-	wil::com_ptr_nothrow<IEnumIDList> pEnumIDList;
-	hr = shellFolder2->EnumObjects(nullptr, enumFlags, &pEnumIDList);
+	unique_pidl_absolute pidlComplete(ILCombine(pidlDirectory, pidlChild.get()));
+	GetDisplayName(pidlComplete.get(), SHGDN_FORPARSING, item.parsingName);
+	GetDisplayName(pidlComplete.get(), SHGDN_INFOLDER, item.inFolderName);
 
-	if (FAILED(hr) || !pEnumIDList)
+	TCHAR path[MAX_PATH];
+	item.isRoot = PathIsRoot(item.parsingName.c_str());
+	item.isFileSystem = SHGetPathFromIDList(pidlComplete.get(), path);
+
+	item.pidl = std::move(pidlChild);
+
+	return item;
+}
+
+// The attributes of a filesystem item are stored within its pidl, so can be retrieved without
+// querying the folder. That avoids a round trip to the folder for each item (which can be
+// particularly slow for network folders). Other items fall back to querying the folder.
+bool ShellTreeView::IsSystemItem(IShellFolder *shellFolder, PCITEMID_CHILD pidlChild)
+{
+	WIN32_FIND_DATA wfd;
+	HRESULT hr = SHGetDataFromIDList(shellFolder, pidlChild, SHGDFIL_FINDDATA, &wfd, sizeof(wfd));
+
+	if (SUCCEEDED(hr))
 	{
-		return hr;
+		return WI_IsFlagSet(wfd.dwFileAttributes, FILE_ATTRIBUTE_SYSTEM);
 	}
 
-	SendMessage(m_hTreeView, WM_SETREDRAW, FALSE, 0);
+	SFGAOF attributes = SFGAO_SYSTEM;
+	hr = shellFolder->GetAttributesOf(1, &pidlChild, &attributes);
 
-	std::vector<EnumeratedItem> items;
+	return FAILED(hr) || WI_IsFlagSet(attributes, SFGAO_SYSTEM);
+}
 
-	unique_pidl_child pidlItem;
-	ULONG uFetched = 1;
+/* Sorts items in the following order:
+ - Drives
+ - Virtual Items
+ - Real Items
 
-	while (pEnumIDList->Next(1, wil::out_param(pidlItem), &uFetched) == S_OK && (uFetched == 1))
+Each set is ordered alphabetically. */
+int ShellTreeView::CompareExpandedItems(const ExpandedItem &item1, const ExpandedItem &item2,
+	bool useNaturalSortOrder)
+{
+	if (item1.isRoot && !item2.isRoot)
 	{
-		if (m_config->checkPinnedToNamespaceTreeProperty)
-		{
-			BOOL showItem = GetBooleanVariant(shellFolder2.get(), pidlItem.get(),
-				&PKEY_IsPinnedToNameSpaceTree, TRUE);
+		return -1;
+	}
+	else if (!item1.isRoot && item2.isRoot)
+	{
+		return 1;
+	}
+	else if (item1.isRoot && item2.isRoot)
+	{
+		return lstrcmpi(item1.parsingName.c_str(), item2.parsingName.c_str());
+	}
+	else if (!item1.isFileSystem && item2.isFileSystem)
+	{
+		return -1;
+	}
+	else if (item1.isFileSystem && !item2.isFileSystem)
+	{
+		return 1;
+	}
+	else if (useNaturalSortOrder)
+	{
+		return StrCmpLogicalW(item1.inFolderName.c_str(), item2.inFolderName.c_str());
+	}
+	else
+	{
+		return StrCmpIW(item1.inFolderName.c_str(), item2.inFolderName.c_str());
+	}
+}
 
-			if (!showItem)
-			{
-				continue;
-			}
-		}
+void ShellTreeView::ProcessExpansionResult(int expansionId)
+{
+	auto itr = m_pendingExpansions.find(expansionId);
 
-		if (m_config->globalFolderSettings.hideSystemFiles)
-		{
-			PCITEMID_CHILD child = pidlItem.get();
-			SFGAOF attributes = SFGAO_SYSTEM;
-			hr = shellFolder2->GetAttributesOf(1, &child, &attributes);
+	if (itr == m_pendingExpansions.end())
+	{
+		// The expansion was cancelled.
+		return;
+	}
 
-			if (FAILED(hr) || (WI_IsFlagSet(attributes, SFGAO_SYSTEM)))
-			{
-				continue;
-			}
-		}
+	auto &expansion = itr->second;
 
-		STRRET str;
-		hr = shellFolder2->GetDisplayNameOf(pidlItem.get(), SHGDN_NORMAL, &str);
+	if (expansion.result.valid())
+	{
+		auto items = expansion.result.get();
 
-		if (SUCCEEDED(hr))
+		if (items)
 		{
-			TCHAR itemName[MAX_PATH];
-			hr = StrRetToBuf(&str, pidlItem.get(), itemName, SIZEOF_ARRAY(itemName));
-
-			if (SUCCEEDED(hr))
-			{
-				int itemId = GenerateUniqueItemId();
-				m_itemInfoMap[itemId].pidl.reset(ILCombine(pidlDirectory.get(), pidlItem.get()));
-				m_itemInfoMap[itemId].pridl.reset(ILCloneChild(pidlItem.get()));
-
-				EnumeratedItem item;
-				item.internalIndex = itemId;
-				item.name = itemName;
-				items.push_back(item);
-			}
+			expansion.items = std::move(*items);
 		}
 	}
 
-	for (auto &item : items)
+	size_t numItemsRemaining = expansion.items.size() - expansion.numItemsInserted;
+	size_t numItemsToInsert = (std::min)(numItemsRemaining, EXPANSION_INSERTION_CHUNK_SIZE);
+	auto first = expansion.items.begin() + expansion.numItemsInserted;
+
+	SendMessage(m_hTreeView, WM_SETREDRAW, FALSE, 0);
+	InsertChildItems(expansion.parentItem, first, first + numItemsToInsert);
+	SendMessage(m_hTreeView, WM_SETREDRAW, TRUE, 0);
+
+	expansion.numItemsInserted += numItemsToInsert;
+
+	if (expansion.numItemsInserted < expansion.items.size())
+	{
+		// Inserting the next chunk is deferred until any other pending messages have been
+		// processed.
+		PostMessage(m_hTreeView, WM_APP_EXPANSION_RESULT_READY, expansionId, 0);
+		return;
+	}
+
+	HTREEITEM loadingItem = expansion.loadingItem;
+	m_pendingExpansions.erase(itr);
+
+	TreeView_DeleteItem(m_hTreeView, loadingItem);
+}
+
+void ShellTreeView::InsertChildItems(HTREEITEM parentItem,
+	std::vector<ExpandedItem>::iterator first, std::vector<ExpandedItem>::iterator last)
+{
+	// The parent may have been renamed since the children were enumerated, so its current pidl is
+	// used.
+	auto pidlParent = GetItemPidl(parentItem);
+
+	for (auto itr = first; itr != last; ++itr)
 	{
+		int itemId = GenerateUniqueItemId();
+		m_itemInfoMap[itemId].pidl.reset(ILCombine(pidlParent.get(), itr->pidl.get()));
+		m_itemInfoMap[itemId].pridl = std::move(itr->pidl);
+
 		TVITEMEX tvItem;
 		tvItem.mask = TVIF_TEXT | TVIF_IMAGE | TVIF_SELECTEDIMAGE | TVIF_PARAM | TVIF_CHILDREN;
-		tvItem.pszText = item.name.data();
+		tvItem.pszText = itr->name.data();
 		tvItem.iImage = I_IMAGECALLBACK;
 		tvItem.iSelectedImage = I_IMAGECALLBACK;
-		tvItem.lParam = item.internalIndex;
+		tvItem.lParam = itemId;
 		tvItem.cChildren = I_CHILDRENCALLBACK;
 
 		TVINSERTSTRUCT tvis;
 		tvis.hInsertAfter = TVI_LAST;
-		tvis.hParent = hParent;
+		tvis.hParent = parentItem;
 		tvis.itemex = tvItem;
 
-		TreeView_InsertItem(m_hTreeView, &tvis);
+		auto item = TreeView_InsertItem(m_hTreeView, &tvis);
+
+		if (item != nullptr)
+		{
+			// The parsing name was already retrieved on the background thread (in order to sort
+			// the items), so there's no need to retrieve it again here.
+			AddItemToIndex(item, itr->parsingName);
+		}
+	}
+}
+
+// Replaces the children of an item that's currently being expanded. The existing children (i.e.
+// the loading item and any items that have already been inserted) are only removed once the
+// replacements have been added, so that the item is never left without children (which would
+// cause it to be collapsed).
+void ShellTreeView::ReloadChildItems(HTREEITEM parentItem, bool synchronous)
+{
+	std::vector<HTREEITEM> existingChildren;
+
+	for (auto child = TreeView_GetChild(m_hTreeView, parentItem); child != nullptr;
+		 child = TreeView_GetNextSibling(m_hTreeView, child))
+	{
+		existingChildren.push_back(child);
+	}
+
+	CancelExpansion(parentItem);
+
+	if (synchronous)
+	{
+		ExpandDirectory(parentItem);
+	}
+	else
+	{
+		QueueExpansion(parentItem);
+	}
+
+	for (auto child : existingChildren)
+	{
+		EraseItems(child);
+
+		TVITEMEX tvItemEx;
+		tvItemEx.mask = TVIF_HANDLE | TVIF_PARAM;
+		tvItemEx.hItem = child;
+		TreeView_GetItem(m_hTreeView, &tvItemEx);
+		m_itemInfoMap.erase(static_cast<int>(tvItemEx.lParam));
+
+		TreeView_DeleteItem(m_hTreeView, child);
+	}
+}
+
+void ShellTreeView::CancelExpansion(HTREEITEM parentItem)
+{
+	auto itr = std::find_if(m_pendingExpansions.begin(), m_pendingExpansions.end(),
+		[parentItem](const auto &entry)
+		{
+			return entry.second.parentItem == parentItem;
+		});
+
+	if (itr == m_pendingExpansions.end())
+	{
+		return;
+	}
+
+	// Any result that's posted for this expansion will be ignored, since the expansion is no
+	// longer pending.
+	itr->second.stopSource.request_stop();
+	m_pendingExpansions.erase(itr);
+}
+
+bool ShellTreeView::IsExpansionPending(HTREEITEM parentItem) const
+{
+	return std::any_of(m_pendingExpansions.begin(), m_pendingExpansions.end(),
+		[parentItem](const auto &entry)
+		{
+			return entry.second.parentItem == parentItem;
+		});
+}
+
+bool ShellTreeView::IsLoadingItem(HTREEITEM item) const
+{
+	TVITEMEX tvItemEx;
+	tvItemEx.mask = TVIF_HANDLE | TVIF_PARAM;
+	tvItemEx.hItem = item;
+	TreeView_GetItem(m_hTreeView, &tvItemEx);
+
+	return tvItemEx.lParam == LOADING_ITEM_ID;
+}
+
+ShellTreeView::ExpansionOptions ShellTreeView::GetExpansionOptions() const
+{
+	ExpansionOptions options;
+	options.showHidden = m_bShowHidden;
+	options.checkPinnedToNamespaceTreeProperty = m_config->checkPinnedToNamespaceTreeProperty;
+	options.hideSystemFiles = m_config->globalFolderSettings.hideSystemFiles;
+	options.useNaturalSortOrder = m_config->globalFolderSettings.useNaturalSortOrder;
+	return options;
+}
+
+// Expands the item and inserts its children before returning.
+void ShellTreeView::ExpandItemSynchronously(HTREEITEM item)
+{
+	if (IsExpansionPending(item))
+	{
+		ReloadChildItems(item, true);
+		return;
 	}
 
-	TVSORTCB tvscb;
-	tvscb.hParent = hParent;
-	tvscb.lpfnCompare = CompareItemsStub;
-	tvscb.lParam = reinterpret_cast<LPARAM>(this);
-	TreeView_SortChildrenCB(m_hTreeView, &tvscb, 0);
+	m_expandSynchronously = true;
+	SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND, reinterpret_cast<LPARAM>(item));
+	m_expandSynchronously = false;
+}
+
+HRESULT ShellTreeView::ExpandDirectory(HTREEITEM hParent)
+{
+	auto pidlDirectory = GetItemPidl(hParent);
+
+	std::vector<ExpandedItem> items;
+	HRESULT hr = EnumerateChildItems(pidlDirectory.get(), GetExpansionOptions(), {}, items);
 
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	SendMessage(m_hTreeView, WM_SETREDRAW, FALSE, 0);
+	InsertChildItems(hParent, items.begin(), items.end());
 	SendMessage(m_hTreeView, WM_SETREDRAW, TRUE, 0);
 
 	return hr;
@@ -987,6 +1254,13 @@ int ShellTreeView::GetItemInternalIndex(HTREEITEM item) const
 	[[maybe_unused]] bool res = TreeView_GetItem(m_hTreeView, &tvItemEx);
 	assert(res);
 
+	// The loading item stands in for the children of its parent, so it's treated as if it were
+	// the parent item itself (e.g. if it's selected).
+	if (tvItemEx.lParam == LOADING_ITEM_ID)
+	{
+		return GetItemInternalIndex(TreeView_GetParent(m_hTreeView, item));
+	}
+
 	return static_cast<int>(tvItemEx.lParam);
 }
 
@@ -998,72 +1272,24 @@ HTREEITEM ShellTreeView::LocateItem(PCIDLIST_ABSOLUTE pidlDirectory)
 /* Finds items that have been deleted or renamed
 (meaning that their pidl's are no longer valid).
 
-Use two basic strategies to find the item:
-1. Find the parent item through its pidl, the child
-through it's name.
-2. Find the item simply by its name.
-The first method would not normally be needed, but
-real folders can have a display name that differs
-from their parsing name.
-For example, the C:\Users\Username\Documents
-folder in Windows 7 has a display name of
-"My Documents". This is an issue, since a
-direct path lookup will fail. */
-/* TODO: Store parsing name with each item, and
-match against that. */
+The parsing path of each item is recorded when the
+item is inserted, so the item can be found directly
+from the path it had before it was deleted. Note that
+matching against the item text wouldn't work in all
+cases, since real folders can have a display name that
+differs from their parsing name (e.g. the
+C:\Users\Username\Documents folder in Windows 7 has
+a display name of "My Documents").
+If the item appears more than once, the instance
+within the drive the item was stored on is
+preferred. */
 HTREEITEM ShellTreeView::LocateDeletedItem(const TCHAR *szFullFileName)
 {
-	HTREEITEM hItem = nullptr;
-	PIDLIST_ABSOLUTE pidl = nullptr;
-	TCHAR szParent[MAX_PATH];
-	BOOL bFound = FALSE;
-	HRESULT hr;
-
-	StringCchCopy(szParent, SIZEOF_ARRAY(szParent), szFullFileName);
-	PathRemoveFileSpec(szParent);
-	hr = SHParseDisplayName(szParent, nullptr, &pidl, 0, nullptr);
-
-	if (SUCCEEDED(hr))
-	{
-		hItem = LocateExistingItem(pidl);
-
-		if (hItem != nullptr)
-		{
-			HTREEITEM hChild;
-			TVITEM tvItem;
-			TCHAR szFileName[MAX_PATH];
-
-			hChild = TreeView_GetChild(m_hTreeView, hItem);
-
-			StringCchCopy(szFileName, SIZEOF_ARRAY(szFileName), szFullFileName);
-			PathStripPath(szFileName);
-
-			/* Now try to find the child folder. */
-			while (hChild != nullptr)
-			{
-				TCHAR szItem[MAX_PATH];
-
-				tvItem.mask = TVIF_TEXT | TVIF_HANDLE;
-				tvItem.hItem = hChild;
-				tvItem.pszText = szItem;
-				tvItem.cchTextMax = SIZEOF_ARRAY(szItem);
-				TreeView_GetItem(m_hTreeView, &tvItem);
-
-				if (lstrcmp(szFileName, szItem) == 0)
-				{
-					hItem = hChild;
-					bFound = TRUE;
-					break;
-				}
-
-				hChild = TreeView_GetNextSibling(m_hTreeView, hChild);
-			}
-		}
-	}
+	HTREEITEM hItem = LocateItemByPath(szFullFileName, FALSE);
 
-	if (!bFound)
+	if (hItem == nullptr)
 	{
-		hItem = LocateItemByPath(szFullFileName, FALSE);
+		hItem = FindIndexedItemByPath(szFullFileName, nullptr);
 	}
 
 	return hItem;
@@ -1090,152 +1316,107 @@ HTREEITEM ShellTreeView::LocateExistingItem(PCIDLIST_ABSOLUTE pidlDirectory)
 HTREEITEM ShellTreeView::LocateItemInternal(PCIDLIST_ABSOLUTE pidlDirectory,
 	BOOL bOnlyLocateExistingItem)
 {
-	HTREEITEM hRoot;
-	HTREEITEM hItem;
-	TVITEMEX item;
-	BOOL bFound = FALSE;
-
-	/* Get the root of the tree (root of namespace). */
-	hRoot = TreeView_GetRoot(m_hTreeView);
-	hItem = hRoot;
-
-	item.mask = TVIF_PARAM | TVIF_HANDLE;
-	item.hItem = hItem;
-	TreeView_GetItem(m_hTreeView, &item);
-
-	/* Keep searching until the specified item
-	is found or it is found the item does not
-	exist in the treeview.
-	Look through each item, once an ancestor is
-	found, look through it's children, expanding
-	the parent node if necessary. */
-	while (!bFound && hItem != nullptr)
-	{
-		if (ArePidlsEquivalent(m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(),
-				pidlDirectory))
-		{
-			bFound = TRUE;
+	HTREEITEM hItem = FindIndexedItem(pidlDirectory);
 
-			break;
-		}
+	if (hItem != nullptr || bOnlyLocateExistingItem)
+	{
+		return hItem;
+	}
 
-		if (ILIsParent(m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(), pidlDirectory,
-				FALSE))
+	/* The item isn't currently in the treeview. Find
+	the closest ancestor that is, then expand each of
+	the missing ancestors in turn. Since each level only
+	requires a single lookup, the number of lookups is
+	proportional to the depth of the item, regardless of
+	how many siblings each ancestor has. */
+	std::vector<unique_pidl_absolute> missingPidls;
+	missingPidls.emplace_back(ILCloneFull(pidlDirectory));
+
+	while (hItem == nullptr)
+	{
+		unique_pidl_absolute pidlParent(ILCloneFull(missingPidls.back().get()));
+
+		if (!ILRemoveLastID(pidlParent.get()))
 		{
-			if ((TreeView_GetChild(m_hTreeView, hItem)) == nullptr)
-			{
-				if (bOnlyLocateExistingItem)
-				{
-					return nullptr;
-				}
-				else
-				{
-					SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND, (LPARAM) hItem);
-				}
-			}
+			return nullptr;
+		}
 
-			hItem = TreeView_GetChild(m_hTreeView, hItem);
+		hItem = FindIndexedItem(pidlParent.get());
+
+		if (hItem == nullptr)
+		{
+			missingPidls.push_back(std::move(pidlParent));
 		}
-		else
+	}
+
+	for (auto itr = missingPidls.rbegin(); itr != missingPidls.rend(); ++itr)
+	{
+		if (TreeView_GetChild(m_hTreeView, hItem) == nullptr || IsExpansionPending(hItem))
 		{
-			hItem = TreeView_GetNextSibling(m_hTreeView, hItem);
+			ExpandItemSynchronously(hItem);
 		}
 
-		item.mask = TVIF_PARAM | TVIF_HANDLE;
-		item.hItem = hItem;
-		TreeView_GetItem(m_hTreeView, &item);
+		hItem = FindIndexedItem(itr->get());
+
+		if (hItem == nullptr)
+		{
+			return nullptr;
+		}
 	}
 
 	return hItem;
 }
 
+/* Finds an item by its parsing path, within the
+drive the item is stored on (i.e. items that appear
+elsewhere in the treeview, such as below the root
+desktop item, are ignored). Unless bExpand is set,
+only items that are already in the treeview will be
+found. */
 HTREEITEM ShellTreeView::LocateItemByPath(const TCHAR *szItemPath, BOOL bExpand)
 {
-	HTREEITEM hMyComputer;
-	HTREEITEM hItem;
-	HTREEITEM hNextItem;
-	TVITEMEX item;
-	TCHAR *ptr = nullptr;
-	TCHAR itemText[MAX_PATH];
 	TCHAR fullItemPathCopy[MAX_PATH];
-	TCHAR *nextToken = nullptr;
-
 	StringCchCopy(fullItemPathCopy, SIZEOF_ARRAY(fullItemPathCopy), szItemPath);
 
+	/* Drives retain their trailing backslash (which is
+	consistent with their parsing name). */
 	PathRemoveBackslash(fullItemPathCopy);
 
-	unique_pidl_absolute pidlMyComputer;
-	SHGetFolderLocation(nullptr, CSIDL_DRIVES, nullptr, 0, wil::out_param(pidlMyComputer));
-
-	hMyComputer = LocateItem(pidlMyComputer.get());
-
-	/* First of drives in system. */
-	hItem = TreeView_GetChild(m_hTreeView, hMyComputer);
-
-	/* My Computer node may not be expanded. */
-	if (hItem == nullptr)
-		return nullptr;
-
-	ptr = wcstok_s(fullItemPathCopy, _T("\\"), &nextToken);
-
-	StringCchCopy(itemText, SIZEOF_ARRAY(itemText), ptr);
-	StringCchCat(itemText, SIZEOF_ARRAY(itemText), _T("\\"));
-	ptr = itemText;
-
-	item.mask = TVIF_HANDLE | TVIF_PARAM;
-	item.hItem = hItem;
-	TreeView_GetItem(m_hTreeView, &item);
-
-	std::wstring itemName;
-	GetDisplayName(m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(), SHGDN_FORPARSING,
-		itemName);
+	unique_pidl_absolute pidlAncestor;
+	HRESULT hr;
 
-	while (StrCmpI(ptr, itemName.c_str()) != 0)
+	if (PathIsRoot(fullItemPathCopy))
 	{
-		hItem = TreeView_GetNextSibling(m_hTreeView, hItem);
+		hr = SHGetFolderLocation(nullptr, CSIDL_DRIVES, nullptr, 0, wil::out_param(pidlAncestor));
+	}
+	else
+	{
+		TCHAR drive[MAX_PATH];
+		StringCchCopy(drive, SIZEOF_ARRAY(drive), fullItemPathCopy);
 
-		if (hItem == nullptr)
+		if (!PathStripToRoot(drive))
+		{
 			return nullptr;
+		}
 
-		item.mask = TVIF_PARAM;
-		item.hItem = hItem;
-		TreeView_GetItem(m_hTreeView, &item);
-
-		GetDisplayName(m_itemInfoMap.at(static_cast<int>(item.lParam)).pidl.get(), SHGDN_FORPARSING,
-			itemName);
+		hr = SHParseDisplayName(drive, nullptr, wil::out_param(pidlAncestor), 0, nullptr);
 	}
 
-	item.mask = TVIF_TEXT;
-
-	while ((ptr = wcstok_s(nullptr, _T("\\"), &nextToken)) != nullptr)
+	if (FAILED(hr))
 	{
-		if (TreeView_GetChild(m_hTreeView, hItem) == nullptr)
-		{
-			if (bExpand)
-				SendMessage(m_hTreeView, TVM_EXPAND, TVE_EXPAND, (LPARAM) hItem);
-			else
-				return nullptr;
-		}
+		return nullptr;
+	}
 
-		hNextItem = TreeView_GetChild(m_hTreeView, hItem);
-		hItem = hNextItem;
+	HTREEITEM hItem = FindIndexedItemByPath(fullItemPathCopy, pidlAncestor.get());
 
-		item.pszText = itemText;
-		item.cchTextMax = SIZEOF_ARRAY(itemText);
-		item.hItem = hItem;
-		TreeView_GetItem(m_hTreeView, &item);
+	if (hItem == nullptr && bExpand)
+	{
+		unique_pidl_absolute pidl;
+		hr = SHParseDisplayName(fullItemPathCopy, nullptr, wil::out_param(pidl), 0, nullptr);
 
-		while (StrCmpI(ptr, itemText) != 0)
+		if (SUCCEEDED(hr))
 		{
-			hItem = TreeView_GetNextSibling(m_hTreeView, hItem);
-
-			if (hItem == nullptr)
-				return nullptr;
-
-			item.pszText = itemText;
-			item.cchTextMax = SIZEOF_ARRAY(itemText);
-			item.hItem = hItem;
-			TreeView_GetItem(m_hTreeView, &item);
+			hItem = LocateItem(pidl.get());
 		}
 	}
 
@@ -1314,6 +1495,106 @@ HTREEITEM ShellTreeView::LocateItemOnDesktopTree(const TCHAR *szFullFileName)
 	return hItem;
 }
 
+void ShellTreeView::AddItemToIndex(HTREEITEM item, const std::wstring &parsingName)
+{
+	// If the item is already indexed (e.g. because it's been renamed), the previous entry is
+	// replaced.
+	RemoveItemFromIndex(item);
+
+	auto key = GetParsingNameIndexKey(parsingName);
+	m_parsingNameIndex.emplace(key, item);
+	m_itemParsingNameKeys.emplace(item, std::move(key));
+}
+
+void ShellTreeView::AddItemToIndex(HTREEITEM item, PCIDLIST_ABSOLUTE pidl)
+{
+	// Items that don't have a parsing name are indexed under an empty key. They can still be
+	// found by their pidl, since every item with a matching key is checked.
+	std::wstring parsingName;
+	GetDisplayName(pidl, SHGDN_FORPARSING, parsingName);
+
+	AddItemToIndex(item, parsingName);
+}
+
+void ShellTreeView::RemoveItemFromIndex(HTREEITEM item)
+{
+	auto keyItr = m_itemParsingNameKeys.find(item);
+
+	if (keyItr == m_itemParsingNameKeys.end())
+	{
+		return;
+	}
+
+	auto [first, last] = m_parsingNameIndex.equal_range(keyItr->second);
+
+	for (auto itr = first; itr != last; ++itr)
+	{
+		if (itr->second == item)
+		{
+			m_parsingNameIndex.erase(itr);
+			break;
+		}
+	}
+
+	m_itemParsingNameKeys.erase(keyItr);
+}
+
+HTREEITEM ShellTreeView::FindIndexedItem(PCIDLIST_ABSOLUTE pidl) const
+{
+	std::wstring parsingName;
+	GetDisplayName(pidl, SHGDN_FORPARSING, parsingName);
+
+	// Distinct items can share a parsing name (e.g. the root desktop item and the desktop folder
+	// within the user's profile), so the pidl of each candidate is compared as well.
+	auto [first, last] = m_parsingNameIndex.equal_range(GetParsingNameIndexKey(parsingName));
+
+	for (auto itr = first; itr != last; ++itr)
+	{
+		auto itemInfo = m_itemInfoMap.find(GetItemInternalIndex(itr->second));
+
+		if (itemInfo != m_itemInfoMap.end()
+			&& ArePidlsEquivalent(itemInfo->second.pidl.get(), pidl))
+		{
+			return itr->second;
+		}
+	}
+
+	return nullptr;
+}
+
+// Finds an item by its parsing path alone. This works even if the item no longer exists, but means
+// there's no pidl to distinguish between items that have the same path. If pidlAncestor is
+// provided, only items below that ancestor will be returned.
+HTREEITEM ShellTreeView::FindIndexedItemByPath(const std::wstring &parsingPath,
+	PCIDLIST_ABSOLUTE pidlAncestor) const
+{
+	auto [first, last] = m_parsingNameIndex.equal_range(GetParsingNameIndexKey(parsingPath));
+
+	for (auto itr = first; itr != last; ++itr)
+	{
+		if (!pidlAncestor)
+		{
+			return itr->second;
+		}
+
+		auto itemInfo = m_itemInfoMap.find(GetItemInternalIndex(itr->second));
+
+		if (itemInfo != m_itemInfoMap.end()
+			&& ILIsParent(pidlAncestor, itemInfo->second.pidl.get(), FALSE))
+		{
+			return itr->second;
+		}
+	}
+
+	return nullptr;
+}
+
+// Parsing paths are matched case-insensitively, since filesystem paths are case-insensitive.
+std::wstring ShellTreeView::GetParsingNameIndexKey(const std::wstring &parsingName)
+{
+	return FoldStringCase(parsingName);
+}
+
 void ShellTreeView::EraseItems(HTREEITEM hParent)
 {
 	auto hItem = TreeView_GetChild(m_hTreeView, hParent);
@@ -1709,15 +1990,19 @@ void ShellTreeView::RefreshAllIconsInternal(HTREEITEM hFirstSibling)
 	tvItem.hItem = hFirstSibling;
 	TreeView_GetItem(m_hTreeView, &tvItem);
 
-	const ItemInfo_t &itemInfo = m_itemInfoMap[static_cast<int>(tvItem.lParam)];
-	SHGetFileInfo(reinterpret_cast<LPCTSTR>(itemInfo.pidl.get()), 0, &shfi, sizeof(shfi),
-		SHGFI_PIDL | SHGFI_SYSICONINDEX);
+	// The loading item (which, if present, is always the first child) doesn't have an icon.
+	if (tvItem.lParam != LOADING_ITEM_ID)
+	{
+		const ItemInfo_t &itemInfo = m_itemInfoMap[static_cast<int>(tvItem.lParam)];
+		SHGetFileInfo(reinterpret_cast<LPCTSTR>(itemInfo.pidl.get()), 0, &shfi, sizeof(shfi),
+			SHGFI_PIDL | SHGFI_SYSICONINDEX);
 
-	tvItem.mask = TVIF_HANDLE | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
-	tvItem.hItem = hFirstSibling;
-	tvItem.iImage = shfi.iIcon;
-	tvItem.iSelectedImage = shfi.iIcon;
-	TreeView_SetItem(m_hTreeView, &tvItem);
+		tvItem.mask = TVIF_HANDLE | TVIF_IMAGE | TVIF_SELECTEDIMAGE;
+		tvItem.hItem = hFirstSibling;
+		tvItem.iImage = shfi.iIcon;
+		tvItem.iSelectedImage = shfi.iIcon;
+		TreeView_SetItem(m_hTreeView, &tvItem);
+	}
 
 	hChild = TreeView_GetChild(m_hTreeView, hFirstSibling);
 
@@ -1819,6 +2104,11 @@ bool ShellTreeView::OnEndLabelEdit(const NMTVDISPINFO *dispInfo)
 		return false;
 	}
 
+	if (IsLoadingItem(dispInfo->item.hItem))
+	{
+		return false;
+	}
+
 	const auto &itemInfo = GetItemByHandle(dispInfo->item.hItem);
 
 	std::wstring oldFileName;
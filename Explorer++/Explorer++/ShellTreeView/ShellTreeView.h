@@ -5,26 +5,31 @@
 #pragma once
 
 #include "../Helper/DropHandler.h"
+#include "../Helper/IconFetcher.h"
 #include "../Helper/ShellDropTargetWindow.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/WindowSubclassWrapper.h"
+#include "../Helper/WorkerPool.h"
 #include "../Helper/iDirectoryMonitor.h"
-#include "../ThirdParty/CTPL/cpl_stl.h"
 #include <boost/signals2.hpp>
 #include <wil/com.h>
+#include <list>
 #include <optional>
+#include <stop_token>
+#include <unordered_map>
+#include <vector>
 
-class CachedIcons;
 struct Config;
 class FileActionHandler;
 __interface IExplorerplusplus;
+class IconService;
 class TabContainer;
 
 class ShellTreeView : public ShellDropTargetWindow<HTREEITEM>
 {
 public:
 	ShellTreeView(HWND hParent, IExplorerplusplus *coreInterface, IDirectoryMonitor *pDirMon,
-		TabContainer *tabContainer, FileActionHandler *fileActionHandler, CachedIcons *cachedIcons);
+		TabContainer *tabContainer, FileActionHandler *fileActionHandler, IconService *iconService);
 	~ShellTreeView();
 
 	/* User functions. */
@@ -33,9 +38,6 @@ public:
 	void SetShowHidden(BOOL bShowHidden);
 	void RefreshAllIcons();
 
-	/* Sorting. */
-	int CALLBACK CompareItems(LPARAM lParam1, LPARAM lParam2);
-
 	void MonitorDrivePublic(const TCHAR *szDrive);
 
 	void StartRenamingSelectedItem();
@@ -49,8 +51,9 @@ private:
 	static const UINT_PTR SUBCLASS_ID = 0;
 	static const UINT_PTR PARENT_SUBCLASS_ID = 0;
 
-	static const UINT WM_APP_ICON_RESULT_READY = WM_APP + 1;
 	static const UINT WM_APP_SUBFOLDERS_RESULT_READY = WM_APP + 2;
+	static const UINT WM_APP_EXPANSION_RESULT_READY = WM_APP + 3;
+	static const UINT WM_APP_RESYNC_RESULT_READY = WM_APP + 4;
 
 	// This is the same background color as used in the Explorer treeview.
 	static inline constexpr COLORREF TREE_VIEW_DARK_MODE_BACKGROUND_COLOR = RGB(25, 25, 25);
@@ -64,17 +67,65 @@ private:
 	static const LONG DROP_SCROLL_MARGIN_X_96DPI = 10;
 	static const LONG DROP_SCROLL_MARGIN_Y_96DPI = 10;
 
+	// The number of items requested from the enumerator at a time when expanding an item.
+	static inline constexpr ULONG EXPANSION_ENUMERATION_BATCH_SIZE = 256;
+
+	// Once the children of an item have been enumerated, they're inserted in chunks of this size,
+	// so that the treeview remains responsive while a very large folder is being expanded.
+	static inline constexpr size_t EXPANSION_INSERTION_CHUNK_SIZE = 500;
+
+	// The lParam value of the placeholder item that's shown while the children of an item are
+	// being enumerated.
+	static const int LOADING_ITEM_ID = -1;
+
 	typedef struct
 	{
 		unique_pidl_absolute pidl;
 		unique_pidl_child pridl;
 	} ItemInfo_t;
 
-	typedef struct
+	// The settings that determine which children are shown when an item is expanded and how
+	// they're sorted. These are copied, since the enumeration runs on a background thread.
+	struct ExpansionOptions
+	{
+		bool showHidden;
+		bool checkPinnedToNamespaceTreeProperty;
+		bool hideSystemFiles;
+		bool useNaturalSortOrder;
+	};
+
+	struct ExpandedItem
 	{
-		int internalIndex;
+		unique_pidl_child pidl;
 		std::wstring name;
-	} EnumeratedItem;
+
+		// The remaining fields are only used to sort the items.
+		std::wstring parsingName;
+		std::wstring inFolderName;
+		bool isRoot;
+		bool isFileSystem;
+	};
+
+	struct PendingExpansion
+	{
+		HTREEITEM parentItem;
+		HTREEITEM loadingItem;
+		std::stop_source stopSource;
+		std::future<std::optional<std::vector<ExpandedItem>>> result;
+
+		// Once the result has been retrieved, the items are inserted in chunks.
+		std::vector<ExpandedItem> items;
+		size_t numItemsInserted = 0;
+	};
+
+	// The current children of an expanded item, which are compared against the children shown in
+	// the treeview once they've been enumerated.
+	struct PendingResync
+	{
+		HTREEITEM item;
+		std::stop_source stopSource;
+		std::future<std::optional<std::vector<ExpandedItem>>> result;
+	};
 
 	typedef struct
 	{
@@ -94,13 +145,6 @@ private:
 		unique_pidl_absolute pidl;
 	};
 
-	struct IconResult
-	{
-		HTREEITEM item;
-		int internalIndex;
-		int iconIndex;
-	};
-
 	struct SubfoldersResult
 	{
 		HTREEITEM item;
@@ -131,7 +175,8 @@ private:
 	LRESULT CALLBACK ParentWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
 	HRESULT ExpandDirectory(HTREEITEM hParent);
-	void DirectoryModified(DWORD dwAction, const TCHAR *szFullFileName);
+	void ExpandItemSynchronously(HTREEITEM item);
+	void DirectoryModified(std::list<AlteredFile_t> alteredFiles);
 	void DirectoryAltered();
 	HTREEITEM AddRoot();
 	void AddItem(const TCHAR *szFullFileName);
@@ -159,7 +204,7 @@ private:
 	void UpdateCurrentClipboardObject(wil::com_ptr_nothrow<IDataObject> clipboardDataObject);
 	void OnClipboardUpdate();
 
-	static void DirectoryAlteredCallback(const TCHAR *szFileName, DWORD dwAction, void *pData);
+	static void DirectoryAlteredCallback(const std::vector<DirectoryChange> &changes, void *pData);
 
 	unique_pidl_absolute GetSelectedItemPidl() const;
 
@@ -167,12 +212,15 @@ private:
 	void DirectoryAlteredAddFile(const TCHAR *szFullFileName);
 	void DirectoryAlteredRemoveFile(const TCHAR *szFullFileName);
 	void DirectoryAlteredRenameFile(const TCHAR *szFullFileName);
+	void ResyncDrive(const TCHAR *szDrive);
+	void ResyncExpandedItem(HTREEITEM hItem);
+	void ProcessResyncResult(int resyncId);
+	void ApplyResyncedChildItems(HTREEITEM hItem, const std::vector<ExpandedItem> &currentItems);
+	void CancelResync(HTREEITEM hItem);
 
 	/* Icons. */
 	void QueueIconTask(HTREEITEM item, int internalIndex);
-	static std::optional<IconResult> FindIconAsync(HWND treeView, int iconResultId, HTREEITEM item,
-		int internalIndex, PCIDLIST_ABSOLUTE pidl);
-	void ProcessIconResult(int iconResultId);
+	void ProcessIconResult(HTREEITEM item, int internalIndex, int iconIndex);
 	std::optional<int> GetCachedIconIndex(const ItemInfo_t &itemInfo);
 
 	void QueueSubfoldersTask(HTREEITEM item);
@@ -180,9 +228,41 @@ private:
 		int subfoldersResultId, HTREEITEM item, PCIDLIST_ABSOLUTE pidl);
 	void ProcessSubfoldersResult(int subfoldersResultId);
 
+	/* Expansion. */
+	void QueueExpansion(HTREEITEM parentItem);
+	static std::optional<std::vector<ExpandedItem>> EnumerateChildItemsAsync(HWND treeView,
+		UINT resultMessage, int resultId, PCIDLIST_ABSOLUTE pidlDirectory,
+		const ExpansionOptions &options, std::stop_token stopToken);
+	static HRESULT EnumerateChildItems(PCIDLIST_ABSOLUTE pidlDirectory,
+		const ExpansionOptions &options, std::stop_token stopToken,
+		std::vector<ExpandedItem> &items);
+	static std::optional<ExpandedItem> BuildExpandedItem(IShellFolder2 *shellFolder2,
+		PCIDLIST_ABSOLUTE pidlDirectory, unique_pidl_child pidlChild,
+		const ExpansionOptions &options);
+	static bool IsSystemItem(IShellFolder *shellFolder, PCITEMID_CHILD pidlChild);
+	static int CompareExpandedItems(const ExpandedItem &item1, const ExpandedItem &item2,
+		bool useNaturalSortOrder);
+	void ProcessExpansionResult(int expansionId);
+	void InsertChildItems(HTREEITEM parentItem, std::vector<ExpandedItem>::iterator first,
+		std::vector<ExpandedItem>::iterator last);
+	void ReloadChildItems(HTREEITEM parentItem, bool synchronous);
+	void CancelExpansion(HTREEITEM parentItem);
+	bool IsExpansionPending(HTREEITEM parentItem) const;
+	bool IsLoadingItem(HTREEITEM item) const;
+	ExpansionOptions GetExpansionOptions() const;
+
 	/* Item id's. */
 	int GenerateUniqueItemId();
 
+	/* Item index. */
+	void AddItemToIndex(HTREEITEM item, const std::wstring &parsingName);
+	void AddItemToIndex(HTREEITEM item, PCIDLIST_ABSOLUTE pidl);
+	void RemoveItemFromIndex(HTREEITEM item);
+	HTREEITEM FindIndexedItem(PCIDLIST_ABSOLUTE pidl) const;
+	HTREEITEM FindIndexedItemByPath(const std::wstring &parsingPath,
+		PCIDLIST_ABSOLUTE pidlAncestor) const;
+	static std::wstring GetParsingNameIndexKey(const std::wstring &parsingName);
+
 	const ItemInfo_t &GetItemByHandle(HTREEITEM item) const;
 	ItemInfo_t &GetItemByHandle(HTREEITEM item);
 	int GetItemInternalIndex(HTREEITEM item) const;
@@ -225,18 +305,37 @@ private:
 	TabContainer *m_tabContainer;
 	FileActionHandler *m_fileActionHandler;
 
-	ctpl::thread_pool m_iconThreadPool;
-	std::unordered_map<int, std::future<std::optional<IconResult>>> m_iconResults;
-	int m_iconResultIDCounter;
+	// The treeview is always visible (when shown at all), so its work is treated as interactive.
+	IconFetcher m_iconFetcher;
 
-	ctpl::thread_pool m_subfoldersThreadPool;
+	WorkerPool::TaskGroup m_subfoldersTaskGroup;
 	std::unordered_map<int, std::future<std::optional<SubfoldersResult>>> m_subfoldersResults;
 	int m_subfoldersResultIDCounter;
 
+	WorkerPool::TaskGroup m_expansionTaskGroup;
+	std::unordered_map<int, PendingExpansion> m_pendingExpansions;
+	int m_expansionIDCounter;
+	std::wstring m_loadingTextFormat;
+
+	std::unordered_map<int, PendingResync> m_pendingResyncs;
+	int m_resyncIDCounter;
+
+	// Expansions started by the user happen in the background. When the treeview is being synced
+	// to a folder, the children of each item are needed immediately, so expansion happens
+	// synchronously instead.
+	bool m_expandSynchronously;
+
 	/* Item id's and info. */
 	std::unordered_map<int, ItemInfo_t> m_itemInfoMap;
 	int m_itemIDCounter;
-	CachedIcons *m_cachedIcons;
+
+	// Maps the parsing path of each item to the item, so that items can be found without walking
+	// the tree. The same folder can appear in the tree more than once (e.g. a folder on the desktop
+	// appears below the root, as well as below the drive it's stored on), so a single path can map
+	// to multiple items. The key each item was indexed under is also stored, so that the entry can
+	// be removed once the item is deleted (by which point its pidl may have been freed).
+	std::unordered_multimap<std::wstring, HTREEITEM> m_parsingNameIndex;
+	std::unordered_map<HTREEITEM, std::wstring> m_itemParsingNameKeys;
 
 	int m_iFolderIcon;
 
@@ -21,11 +21,14 @@
 
 namespace NSplitFileDialog
 {
-	const int WM_APP_SETTOTALSPLITCOUNT = WM_APP + 1;
-	const int WM_APP_SETCURRENTSPLITCOUNT = WM_APP + 2;
+	const int WM_APP_SETSPLITPROGRESS = WM_APP + 1;
 	const int WM_APP_SPLITFINISHED = WM_APP + 3;
 	const int WM_APP_INPUTFILEINVALID = WM_APP + 4;
 
+	// Progress is tracked in bytes, but reported in units of this size, so that the progress bar
+	// range doesn't overflow for large files.
+	const int PROGRESS_RANGE = 1000;
+
 	const TCHAR COUNTER_PATTERN[] = _T("/N");
 
 	DWORD WINAPI SplitFileThreadProcStub(LPVOID pParam);
@@ -290,16 +293,12 @@ INT_PTR SplitFileDialog::OnPrivateMessage(UINT uMsg, WPARAM wParam, LPARAM lPara
 
 	switch (uMsg)
 	{
-	case NSplitFileDialog::WM_APP_SETTOTALSPLITCOUNT:
-		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETRANGE32, 0, wParam);
-		break;
-
-	case NSplitFileDialog::WM_APP_SETCURRENTSPLITCOUNT:
+	case NSplitFileDialog::WM_APP_SETSPLITPROGRESS:
 		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETPOS, wParam, 0);
 		break;
 
 	case NSplitFileDialog::WM_APP_SPLITFINISHED:
-		OnSplitFinished();
+		OnSplitFinished(static_cast<HRESULT>(wParam));
 		break;
 
 	case NSplitFileDialog::WM_APP_INPUTFILEINVALID:
@@ -390,7 +389,7 @@ void SplitFileDialog::OnOk()
 		BOOL bTranslated;
 		UINT uSplitSize = GetDlgItemInt(m_hDlg, IDC_SPLIT_EDIT_SIZE, &bTranslated, FALSE);
 
-		if (!bTranslated)
+		if (!bTranslated || uSplitSize == 0)
 		{
 			TCHAR szTemp[128];
 
@@ -409,6 +408,10 @@ void SplitFileDialog::OnOk()
 
 		auto itr = m_SizeMap.find(iCurSel);
 
+		/* The size is calculated using 64-bit arithmetic, so
+		that split sizes larger than 4GB are supported. */
+		ULONGLONG splitSize = uSplitSize;
+
 		if (itr != m_SizeMap.end())
 		{
 			switch (itr->second)
@@ -419,21 +422,25 @@ void SplitFileDialog::OnOk()
 				break;
 
 			case SizeType::KB:
-				uSplitSize *= KB;
+				splitSize *= KB;
 				break;
 
 			case SizeType::MB:
-				uSplitSize *= MB;
+				splitSize *= MB;
 				break;
 
 			case SizeType::GB:
-				uSplitSize *= GB;
+				splitSize *= GB;
 				break;
 			}
 		}
 
 		m_pSplitFile = new SplitFile(m_hDlg, m_strFullFilename, strOutputFilename,
-			strOutputDirectory, uSplitSize);
+			strOutputDirectory, splitSize);
+
+		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETRANGE32, 0,
+			NSplitFileDialog::PROGRESS_RANGE);
+		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETPOS, 0, 0);
 
 		GetDlgItemText(m_hDlg, IDOK, m_szOk, SIZEOF_ARRAY(m_szOk));
 
@@ -449,6 +456,11 @@ void SplitFileDialog::OnOk()
 		LoadString(GetInstance(), IDS_SPLITFILEDIALOG_SPLITTING, szTemp, SIZEOF_ARRAY(szTemp));
 		SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_MESSAGE, szTemp);
 
+		/* The background thread holds its own reference, so
+		that the object remains valid even if the dialog is
+		closed before splitting has finished. */
+		m_pSplitFile->AddRef();
+
 		HANDLE hThread = CreateThread(nullptr, 0, NSplitFileDialog::SplitFileThreadProcStub,
 			reinterpret_cast<LPVOID>(m_pSplitFile), 0, nullptr);
 		SetThreadPriority(hThread, THREAD_PRIORITY_LOWEST);
@@ -470,6 +482,11 @@ void SplitFileDialog::OnCancel()
 	if (m_bSplittingFile)
 	{
 		m_bStopSplitting = true;
+
+		if (m_pSplitFile != nullptr)
+		{
+			m_pSplitFile->StopSplitting();
+		}
 	}
 	else
 	{
@@ -501,18 +518,23 @@ void SplitFileDialog::OnChangeOutputDirectory()
 	SetDlgItemText(m_hDlg, IDC_SPLIT_EDIT_OUTPUT, parsingName.c_str());
 }
 
-void SplitFileDialog::OnSplitFinished()
+void SplitFileDialog::OnSplitFinished(HRESULT hr)
 {
-	TCHAR szTemp[64];
+	TCHAR szTemp[128];
 
-	if (!m_bStopSplitting)
+	if (SUCCEEDED(hr))
 	{
 		LoadString(GetInstance(), IDS_SPLITFILEDIALOG_FINISHED, szTemp, SIZEOF_ARRAY(szTemp));
 	}
-	else
+	else if (hr == E_ABORT)
 	{
 		LoadString(GetInstance(), IDS_SPLITFILEDIALOG_CANCELLED, szTemp, SIZEOF_ARRAY(szTemp));
 	}
+	else
+	{
+		LoadString(GetInstance(), IDS_SPLITFILEDIALOG_OUTPUTFILEERROR, szTemp,
+			SIZEOF_ARRAY(szTemp));
+	}
 
 	SetDlgItemText(m_hDlg, IDC_SPLIT_STATIC_MESSAGE, szTemp);
 
@@ -526,9 +548,11 @@ void SplitFileDialog::OnSplitFinished()
 
 	KillTimer(m_hDlg, ELPASED_TIMER_ID);
 
-	int iHighLimit =
-		static_cast<int>(SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_GETRANGE, FALSE, 0));
-	SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETPOS, iHighLimit, 0);
+	if (SUCCEEDED(hr))
+	{
+		SendDlgItemMessage(m_hDlg, IDC_SPLIT_PROGRESS, PBM_SETPOS,
+			NSplitFileDialog::PROGRESS_RANGE, 0);
+	}
 
 	SetDlgItemText(m_hDlg, IDOK, m_szOk);
 }
@@ -539,105 +563,50 @@ DWORD WINAPI NSplitFileDialog::SplitFileThreadProcStub(LPVOID pParam)
 
 	auto *pSplitFile = reinterpret_cast<SplitFile *>(pParam);
 	pSplitFile->Split();
+	pSplitFile->Release();
 
 	return 0;
 }
 
 SplitFile::SplitFile(HWND hDlg, const std::wstring &strFullFilename,
-	const std::wstring &strOutputFilename, const std::wstring &strOutputDirectory, UINT uSplitSize)
-{
-	m_hDlg = hDlg;
-	m_strFullFilename = strFullFilename;
-	m_strOutputFilename = strOutputFilename;
-	m_strOutputDirectory = strOutputDirectory;
-	m_uSplitSize = uSplitSize;
-
-	m_bStopSplitting = false;
-
-	InitializeCriticalSection(&m_csStop);
-}
-
-SplitFile::~SplitFile()
+	const std::wstring &strOutputFilename, const std::wstring &strOutputDirectory,
+	ULONGLONG splitSize) :
+	m_hDlg(hDlg),
+	m_strFullFilename(strFullFilename),
+	m_strOutputFilename(strOutputFilename),
+	m_strOutputDirectory(strOutputDirectory),
+	m_fileSplitter(strFullFilename, splitSize,
+		[this](int partNumber)
+		{
+			std::wstring strOutputFullFilename;
+			ProcessFilename(partNumber, strOutputFullFilename);
+			return strOutputFullFilename;
+		})
 {
-	DeleteCriticalSection(&m_csStop);
 }
 
 void SplitFile::Split()
 {
-	HANDLE hInputFile = CreateFile(m_strFullFilename.c_str(), GENERIC_READ, FILE_SHARE_READ,
-		nullptr, OPEN_EXISTING, 0, nullptr);
+	HRESULT hr = m_fileSplitter.Split(
+		[this](ULONGLONG bytesWritten, ULONGLONG totalBytes)
+		{
+			if (totalBytes == 0)
+			{
+				return;
+			}
+
+			auto position = static_cast<int>(
+				(bytesWritten * NSplitFileDialog::PROGRESS_RANGE) / totalBytes);
+			PostMessage(m_hDlg, NSplitFileDialog::WM_APP_SETSPLITPROGRESS, position, 0);
+		});
 
-	if (hInputFile == INVALID_HANDLE_VALUE)
+	if (FAILED(hr) && m_fileSplitter.GetFailedPath() == m_strFullFilename)
 	{
 		PostMessage(m_hDlg, NSplitFileDialog::WM_APP_INPUTFILEINVALID, 0, 0);
 		return;
 	}
 
-	LARGE_INTEGER lFileSize;
-	GetFileSizeEx(hInputFile, &lFileSize);
-
-	LONGLONG nSplits = lFileSize.QuadPart / m_uSplitSize;
-
-	if ((lFileSize.QuadPart % m_uSplitSize) != 0)
-	{
-		nSplits++;
-	}
-
-	PostMessage(m_hDlg, NSplitFileDialog::WM_APP_SETTOTALSPLITCOUNT, static_cast<WPARAM>(nSplits),
-		0);
-
-	SplitInternal(hInputFile, lFileSize);
-
-	CloseHandle(hInputFile);
-
-	SendMessage(m_hDlg, NSplitFileDialog::WM_APP_SPLITFINISHED, 0, 0);
-}
-
-void SplitFile::SplitInternal(HANDLE hInputFile, const LARGE_INTEGER &lFileSize)
-{
-	LARGE_INTEGER lRunningSplitSize = { 0 };
-
-	char *pBuffer = new char[m_uSplitSize];
-	bool bStop = false;
-	int nSplitsMade = 1;
-
-	while (lRunningSplitSize.QuadPart < lFileSize.QuadPart && !bStop)
-	{
-		DWORD dwNumberOfBytesRead;
-		ReadFile(hInputFile, reinterpret_cast<LPVOID>(pBuffer), m_uSplitSize, &dwNumberOfBytesRead,
-			nullptr);
-
-		std::wstring strOutputFullFilename;
-		ProcessFilename(nSplitsMade, strOutputFullFilename);
-
-		HANDLE hOutputFile = CreateFile(strOutputFullFilename.c_str(), GENERIC_WRITE, 0, nullptr,
-			CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
-
-		if (hOutputFile != INVALID_HANDLE_VALUE)
-		{
-			DWORD dwNumberOfBytesWritten;
-			WriteFile(hOutputFile, reinterpret_cast<LPCVOID>(pBuffer), dwNumberOfBytesRead,
-				&dwNumberOfBytesWritten, nullptr);
-
-			CloseHandle(hOutputFile);
-		}
-
-		/* TODO: Wait for a set period of time before sending message
-		(so as not to block the GUI). */
-		PostMessage(m_hDlg, NSplitFileDialog::WM_APP_SETCURRENTSPLITCOUNT, nSplitsMade, 0);
-
-		lRunningSplitSize.QuadPart += dwNumberOfBytesRead;
-		nSplitsMade++;
-
-		EnterCriticalSection(&m_csStop);
-		if (m_bStopSplitting)
-		{
-			bStop = true;
-		}
-		LeaveCriticalSection(&m_csStop);
-	}
-
-	delete[] pBuffer;
+	SendMessage(m_hDlg, NSplitFileDialog::WM_APP_SPLITFINISHED, static_cast<WPARAM>(hr), 0);
 }
 
 void SplitFile::ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFilename)
@@ -654,9 +623,7 @@ void SplitFile::ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFile
 
 void SplitFile::StopSplitting()
 {
-	EnterCriticalSection(&m_csStop);
-	m_bStopSplitting = true;
-	LeaveCriticalSection(&m_csStop);
+	m_fileSplitter.Cancel();
 }
 
 SplitFileDialogPersistentSettings::SplitFileDialogPersistentSettings() :
@@ -6,6 +6,7 @@
 
 #include "DarkModeDialogBase.h"
 #include "../Helper/DialogSettings.h"
+#include "../Helper/FileSplitter.h"
 #include "../Helper/ReferenceCount.h"
 #include <string>
 #include <unordered_map>
@@ -45,14 +46,12 @@ class SplitFile : public ReferenceCount
 {
 public:
 	SplitFile(HWND hDlg, const std::wstring &strFullFilename, const std::wstring &strOutputFilename,
-		const std::wstring &strOutputDirectory, UINT uSplitSize);
-	~SplitFile();
+		const std::wstring &strOutputDirectory, ULONGLONG splitSize);
 
 	void Split();
 	void StopSplitting();
 
 private:
-	void SplitInternal(HANDLE hInputFile, const LARGE_INTEGER &lFileSize);
 	void ProcessFilename(int nSplitsMade, std::wstring &strOutputFullFilename);
 
 	HWND m_hDlg;
@@ -60,10 +59,8 @@ private:
 	std::wstring m_strFullFilename;
 	std::wstring m_strOutputFilename;
 	std::wstring m_strOutputDirectory;
-	UINT m_uSplitSize;
 
-	CRITICAL_SECTION m_csStop;
-	bool m_bStopSplitting;
+	FileSplitter m_fileSplitter;
 };
 
 class SplitFileDialog : public DarkModeDialogBase
@@ -117,7 +114,7 @@ private:
 	void OnOk();
 	void OnCancel();
 	void OnChangeOutputDirectory();
-	void OnSplitFinished();
+	void OnSplitFinished(HRESULT hr);
 
 	IExplorerplusplus *m_expp;
 
@@ -18,15 +18,16 @@
 #include "ShellBrowser/ShellNavigationController.h"
 #include "TabBacking.h"
 #include "TabRestorer.h"
-#include "../Helper/CachedIcons.h"
 #include "../Helper/Controls.h"
 #include "../Helper/DpiCompatibility.h"
 #include "../Helper/IconFetcher.h"
 #include "../Helper/ImageHelper.h"
+#include "../Helper/Logging.h"
 #include "../Helper/MenuHelper.h"
 #include "../Helper/ShellHelper.h"
 #include "../Helper/TabHelper.h"
 #include "../Helper/WindowHelper.h"
+#include "../Helper/WorkerPool.h"
 #include "../Helper/iDirectoryMonitor.h"
 #include <boost/algorithm/string.hpp>
 #include <boost/range/adaptor/map.hpp>
@@ -43,27 +44,26 @@ const std::map<UINT, Icon> TAB_RIGHT_CLICK_MENU_IMAGE_MAPPINGS = {
 // clang-format on
 
 TabContainer *TabContainer::Create(HWND parent, TabNavigationInterface *tabNavigation,
-	IExplorerplusplus *expp, FileActionHandler *fileActionHandler, CachedIcons *cachedIcons,
+	IExplorerplusplus *expp, FileActionHandler *fileActionHandler, IconService *iconService,
 	BookmarkTree *bookmarkTree, HINSTANCE instance, std::shared_ptr<Config> config)
 {
-	return new TabContainer(parent, tabNavigation, expp, fileActionHandler, cachedIcons,
+	return new TabContainer(parent, tabNavigation, expp, fileActionHandler, iconService,
 		bookmarkTree, instance, config);
 }
 
 TabContainer::TabContainer(HWND parent, TabNavigationInterface *tabNavigation,
-	IExplorerplusplus *expp, FileActionHandler *fileActionHandler, CachedIcons *cachedIcons,
+	IExplorerplusplus *expp, FileActionHandler *fileActionHandler, IconService *iconService,
 	BookmarkTree *bookmarkTree, HINSTANCE instance, std::shared_ptr<Config> config) :
 	ShellDropTargetWindow(CreateTabControl(parent, config->forceSameTabWidth.get())),
 	m_tabNavigation(tabNavigation),
 	m_expp(expp),
 	m_fileActionHandler(fileActionHandler),
-	m_cachedIcons(cachedIcons),
 	m_bookmarkTree(bookmarkTree),
 	m_instance(instance),
 	m_config(config),
 	m_bTabBeenDragged(FALSE),
 	m_iPreviousTabSelectionId(-1),
-	m_iconFetcher(m_hwnd, cachedIcons),
+	m_iconFetcher(iconService),
 	m_defaultFolderIconSystemImageListIndex(GetDefaultFolderIconIndex()),
 	m_dropTargetIndex(-1)
 {
@@ -135,6 +135,11 @@ void TabContainer::Initialize(HWND parent)
 		std::bind_front(&TabContainer::OnAlwaysShowTabBarUpdated, this)));
 	m_connections.push_back(m_config->forceSameTabWidth.addObserver(
 		std::bind_front(&TabContainer::OnForceSameTabWidthUpdated, this)));
+
+	if (m_config->tabHibernationTimeout > std::chrono::minutes::zero())
+	{
+		SetTimer(m_hwnd, HIBERNATION_TIMER_ID, HIBERNATION_TIMER_ELAPSE, nullptr);
+	}
 }
 
 void TabContainer::AddDefaultTabIcons(HIMAGELIST himlTab)
@@ -232,6 +237,10 @@ LRESULT CALLBACK TabContainer::WndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPAR
 		{
 			OnDropScrollTimer();
 		}
+		else if (wParam == HIBERNATION_TIMER_ID)
+		{
+			OnHibernationTimer();
+		}
 		break;
 
 	case WM_MENUSELECT:
@@ -737,7 +746,7 @@ void TabContainer::OnTabCreated(int tabId, BOOL switchToNewTab)
 
 void TabContainer::OnTabRemoved(int tabId)
 {
-	UNREFERENCED_PARAMETER(tabId);
+	m_tabDeselectionTimes.erase(tabId);
 
 	if (!m_config->alwaysShowTabBar.get() && (GetNumTabs() == 1))
 	{
@@ -750,11 +759,70 @@ void TabContainer::OnTabSelected(const Tab &tab)
 	if (m_iPreviousTabSelectionId != -1)
 	{
 		m_tabSelectionHistory.push_back(m_iPreviousTabSelectionId);
+
+		// The previous tab may have been closed.
+		Tab *previousTab = GetTabOptional(m_iPreviousTabSelectionId);
+
+		if (previousTab)
+		{
+			previousTab->GetShellBrowser()->SetTaskPriority(WorkerPool::Priority::Background);
+			m_tabDeselectionTimes[previousTab->GetId()] = std::chrono::steady_clock::now();
+		}
+	}
+
+	tab.GetShellBrowser()->SetTaskPriority(WorkerPool::Priority::Interactive);
+	m_tabDeselectionTimes.erase(tab.GetId());
+
+	if (tab.GetShellBrowser()->IsHibernated())
+	{
+		tab.GetShellBrowser()->Rehydrate();
 	}
 
 	m_iPreviousTabSelectionId = tab.GetId();
 }
 
+// Tabs that haven't been selected for the configured period of time are hibernated, so that the
+// memory used by the items they contain is released. A tab will be rehydrated when it's next
+// selected.
+void TabContainer::OnHibernationTimer()
+{
+	auto now = std::chrono::steady_clock::now();
+
+	for (const auto &[tabId, tab] : m_tabs)
+	{
+		if (IsTabSelected(*tab))
+		{
+			continue;
+		}
+
+		// Tabs that have never been selected (e.g. tabs opened in the background) are treated as
+		// having been deselected the first time they're seen here.
+		auto [itr, inserted] = m_tabDeselectionTimes.try_emplace(tabId, now);
+
+		if (inserted || (now - itr->second) < m_config->tabHibernationTimeout)
+		{
+			continue;
+		}
+
+		auto *shellBrowser = tab->GetShellBrowser();
+
+		if (shellBrowser->IsHibernated())
+		{
+			continue;
+		}
+
+		auto bytesReleased = shellBrowser->Hibernate();
+
+		if (!bytesReleased)
+		{
+			continue;
+		}
+
+		LOG(info) << L"Hibernated tab " << tabId << L" (" << shellBrowser->GetDirectory()
+				  << L"), releasing approximately " << (*bytesReleased / 1024) << L" KB";
+	}
+}
+
 void TabContainer::OnAlwaysShowTabBarUpdated(BOOL newValue)
 {
 	if (newValue)
@@ -824,11 +892,12 @@ void TabContainer::SetTabIcon(const Tab &tab)
 	}
 	else
 	{
-		auto itr = m_cachedIcons->findByPath(tab.GetShellBrowser()->GetDirectory());
+		auto cachedIconIndex =
+			m_iconFetcher.GetCachedIconIndex(tab.GetShellBrowser()->GetDirectory());
 
-		if (itr != m_cachedIcons->end())
+		if (cachedIconIndex)
 		{
-			SetTabIconFromSystemImageList(tab, itr->iconIndex);
+			SetTabIconFromSystemImageList(tab, *cachedIconIndex);
 		}
 		else
 		{
@@ -1031,6 +1100,8 @@ void TabContainer::SetUpNewTab(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory,
 	tab.GetShellBrowser()->AddNavigationCommittedObserver(
 		[this, &tab](PCIDLIST_ABSOLUTE pidl, bool addHistoryEntry)
 		{
+			m_initialNavigationFallbacks.erase(tab.GetId());
+
 			tabNavigationCommittedSignal.m_signal(tab, pidl, addHistoryEntry);
 		});
 
@@ -1048,9 +1119,11 @@ void TabContainer::SetUpNewTab(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory,
 		});
 
 	tab.GetShellBrowser()->AddNavigationFailedObserver(
-		[this, &tab]()
+		[this, &tab, addHistoryEntry]()
 		{
 			tabNavigationFailedSignal.m_signal(tab);
+
+			BrowseNextFallbackFolder(tab, addHistoryEntry);
 		});
 
 	tab.GetShellBrowser()->directoryModified.AddObserver(
@@ -1071,21 +1144,14 @@ void TabContainer::SetUpNewTab(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory,
 			tabColumnsChangedSignal.m_signal(tab);
 		});
 
-	HRESULT hr = tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(pidlDirectory,
-		addHistoryEntry);
-
-	if (FAILED(hr))
-	{
-		hr = tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(
-			m_config->defaultTabDirectory, addHistoryEntry);
+	// Navigations complete asynchronously, so the initial navigation can fail either immediately or
+	// once the folder is enumerated. Either way, the failure is reported through the navigation
+	// failed signal, at which point the tab will fall back to the default folder. The computer
+	// folder should always exist, so it's used as the final fallback.
+	m_initialNavigationFallbacks[tab.GetId()] = { m_config->defaultTabDirectoryStatic,
+		m_config->defaultTabDirectory };
 
-		if (FAILED(hr))
-		{
-			// The computer folder should always exist, so this call shouldn't fail.
-			tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(
-				m_config->defaultTabDirectoryStatic, addHistoryEntry);
-		}
-	}
+	tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(pidlDirectory, addHistoryEntry);
 
 	if (selected)
 	{
@@ -1097,6 +1163,13 @@ void TabContainer::SetUpNewTab(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory,
 		}
 	}
 
+	// The first tab is selected automatically, without the selection signal being sent, so the
+	// priority needs to be set here. The priority will be updated as the selection changes.
+	if (TabCtrl_GetCurSel(m_hwnd) == index)
+	{
+		tab.GetShellBrowser()->SetTaskPriority(WorkerPool::Priority::Interactive);
+	}
+
 	if (newTabId)
 	{
 		*newTabId = tab.GetId();
@@ -1111,6 +1184,40 @@ void TabContainer::SetUpNewTab(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory,
 	tabCreatedSignal.m_signal(tab.GetId(), selected);
 }
 
+void TabContainer::BrowseNextFallbackFolder(Tab &tab, bool addHistoryEntry)
+{
+	auto itr = m_initialNavigationFallbacks.find(tab.GetId());
+
+	if (itr == m_initialNavigationFallbacks.end())
+	{
+		// Either the tab has already shown a folder, in which case a failed navigation simply
+		// leaves it where it was, or there are no more folders to try.
+		return;
+	}
+
+	auto &fallbackFolders = itr->second;
+
+	while (!fallbackFolders.empty())
+	{
+		std::wstring folder = fallbackFolders.back();
+		fallbackFolders.pop_back();
+
+		unique_pidl_absolute pidlFolder;
+		HRESULT hr =
+			SHParseDisplayName(folder.c_str(), nullptr, wil::out_param(pidlFolder), 0, nullptr);
+
+		if (SUCCEEDED(hr))
+		{
+			// If this navigation fails, this method will be called again.
+			tab.GetShellBrowser()->GetNavigationController()->BrowseFolder(pidlFolder.get(),
+				addHistoryEntry);
+			return;
+		}
+	}
+
+	m_initialNavigationFallbacks.erase(itr);
+}
+
 void TabContainer::InsertNewTab(int index, int tabId, PCIDLIST_ABSOLUTE pidlDirectory,
 	std::optional<std::wstring> customName)
 {
@@ -1175,6 +1282,7 @@ bool TabContainer::CloseTab(const Tab &tab)
 	int tabId = tab.GetId();
 
 	m_tabs.erase(tab.GetId());
+	m_initialNavigationFallbacks.erase(tabId);
 
 	tabRemovedSignal.m_signal(tabId);
 
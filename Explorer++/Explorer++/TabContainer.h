@@ -14,15 +14,16 @@
 #include <boost/signals2.hpp>
 #include <wil/com.h>
 #include <wil/resource.h>
+#include <chrono>
 #include <functional>
 #include <optional>
 #include <unordered_map>
 
 class BookmarkTree;
-class CachedIcons;
 struct Config;
 class FileActionHandler;
 __interface IExplorerplusplus;
+class IconService;
 class Navigation;
 struct PreservedTab;
 
@@ -74,7 +75,7 @@ class TabContainer : public ShellDropTargetWindow<int>
 {
 public:
 	static TabContainer *Create(HWND parent, TabNavigationInterface *tabNavigation,
-		IExplorerplusplus *expp, FileActionHandler *fileActionHandler, CachedIcons *cachedIcons,
+		IExplorerplusplus *expp, FileActionHandler *fileActionHandler, IconService *iconService,
 		BookmarkTree *bookmarkTree, HINSTANCE instance, std::shared_ptr<Config> config);
 
 	void CreateNewTabInDefaultDirectory(const TabSettings &tabSettings);
@@ -147,10 +148,13 @@ private:
 	static const UINT DROP_SCROLL_TIMER_ID = 2;
 	static const UINT DROP_SCROLL_TIMER_ELAPSE = 1000;
 
+	static const UINT HIBERNATION_TIMER_ID = 3;
+	static const UINT HIBERNATION_TIMER_ELAPSE = 60000;
+
 	static const LONG DROP_SCROLL_MARGIN_X_96DPI = 40;
 
 	TabContainer(HWND parent, TabNavigationInterface *tabNavigation, IExplorerplusplus *expp,
-		FileActionHandler *fileActionHandler, CachedIcons *cachedIcons, BookmarkTree *bookmarkTree,
+		FileActionHandler *fileActionHandler, IconService *iconService, BookmarkTree *bookmarkTree,
 		HINSTANCE instance, std::shared_ptr<Config> config);
 	~TabContainer();
 
@@ -170,6 +174,7 @@ private:
 
 	void SetUpNewTab(Tab &tab, PCIDLIST_ABSOLUTE pidlDirectory, const TabSettings &tabSettings,
 		bool addHistoryEntry, int *newTabId);
+	void BrowseNextFallbackFolder(Tab &tab, bool addHistoryEntry);
 
 	void OnTabCtrlLButtonDown(POINT *pt);
 	void OnTabCtrlLButtonUp();
@@ -201,6 +206,7 @@ private:
 	void OnTabRemoved(int tabId);
 
 	void OnTabSelected(const Tab &tab);
+	void OnHibernationTimer();
 
 	void OnAlwaysShowTabBarUpdated(BOOL newValue);
 	void OnForceSameTabWidthUpdated(BOOL newValue);
@@ -237,7 +243,6 @@ private:
 	std::unordered_map<int, std::unique_ptr<Tab>> m_tabs;
 
 	IconFetcher m_iconFetcher;
-	CachedIcons *m_cachedIcons;
 	wil::com_ptr_nothrow<IImageList> m_systemImageList;
 	int m_defaultFolderIconSystemImageListIndex;
 	int m_defaultFolderIconIndex;
@@ -256,6 +261,13 @@ private:
 	std::vector<int> m_tabSelectionHistory;
 	int m_iPreviousTabSelectionId;
 
+	// Tab hibernation
+	std::unordered_map<int, std::chrono::steady_clock::time_point> m_tabDeselectionTimes;
+
+	// The folders that are still left to try for each tab whose initial navigation hasn't yet
+	// been committed. The last folder in each list is tried next.
+	std::unordered_map<int, std::vector<std::wstring>> m_initialNavigationFallbacks;
+
 	// Tab dragging
 	BOOL m_bTabBeenDragged;
 	int m_draggedTabStartIndex;
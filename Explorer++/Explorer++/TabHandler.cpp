@@ -22,7 +22,7 @@ void Explorerplusplus::InitializeTabs()
 	CreateTabBacking();
 
 	m_tabContainer = TabContainer::Create(m_hTabBacking, this, this, &m_FileActionHandler,
-		&m_cachedIcons, &m_bookmarkTree, m_hLanguageModule, m_config);
+		&m_iconService, &m_bookmarkTree, m_hLanguageModule, m_config);
 	m_tabContainer->tabCreatedSignal.AddObserver(
 		std::bind_front(&Explorerplusplus::OnTabCreated, this), boost::signals2::at_front);
 	m_tabContainer->tabNavigationStartedSignal.AddObserver(
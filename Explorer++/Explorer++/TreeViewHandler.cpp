@@ -49,7 +49,7 @@ void Explorerplusplus::CreateFolderControls()
 	SetWindowSubclass(m_hHolder, TreeViewHolderProcStub, 0, (DWORD_PTR) this);
 
 	m_shellTreeView = new ShellTreeView(m_hHolder, this, m_pDirMon, m_tabContainer,
-		&m_FileActionHandler, &m_cachedIcons);
+		&m_FileActionHandler, &m_iconService);
 
 	/* Now, subclass the treeview again. This is needed for messages
 	such as WM_MOUSEWHEEL, which need to be intercepted before they
@@ -107,6 +107,18 @@ void Explorerplusplus::CreateFolderControls()
 			UpdateTreeViewSelection();
 		});
 
+	// If a navigation started from the treeview fails, the current folder won't have changed, so
+	// the treeview selection needs to be moved back to it. Since navigations complete
+	// asynchronously, that can happen some time after the treeview selection changed.
+	m_tabContainer->tabNavigationFailedSignal.AddObserver(
+		[this](const Tab &tab)
+		{
+			if (m_tabContainer->IsTabSelected(tab))
+			{
+				UpdateTreeViewSelection();
+			}
+		});
+
 	m_tabContainer->tabSelectedSignal.AddObserver(
 		[this](const Tab &tab)
 		{
@@ -311,18 +323,11 @@ void Explorerplusplus::OnTreeViewHolderWindowTimer()
 		HRESULT hr = selectedTab.GetShellBrowser()->GetNavigationController()->BrowseFolder(
 			pidlDirectory.get());
 
-		if (SUCCEEDED(hr))
+		// If the navigation fails (either immediately or later on), the treeview selection will be
+		// reset when the navigation failed signal is received.
+		if (SUCCEEDED(hr) && m_config->treeViewAutoExpandSelected)
 		{
-			if (m_config->treeViewAutoExpandSelected)
-			{
-				TreeView_Expand(m_shellTreeView->GetHWND(), g_newSelectionItem, TVE_EXPAND);
-			}
-		}
-		else
-		{
-			// The navigation failed, so the current folder hasn't changed. All that's needed is to
-			// update the treeview selection back to the current folder.
-			UpdateTreeViewSelection();
+			TreeView_Expand(m_shellTreeView->GetHWND(), g_newSelectionItem, TVE_EXPAND);
 		}
 	}
 }
@@ -15,6 +15,7 @@
 
 #include "stdafx.h"
 #include "Explorer++.h"
+#include "XMLSettings.h"
 #include "ApplicationToolbar.h"
 #include "Bookmarks/BookmarkXmlStorage.h"
 #include "Config.h"
@@ -25,10 +26,15 @@
 #include "ShellBrowser/ShellBrowser.h"
 #include "TabContainer.h"
 #include "../Helper/Macros.h"
+#include "../Helper/PerfectHashTable.h"
 #include "../Helper/ProcessHelper.h"
 #include "../Helper/XMLSettings.h"
+#include "../Helper/XmlStreamReader.h"
 #include <wil/com.h>
 #include <wil/resource.h>
+#include <array>
+#include <optional>
+#include <string_view>
 
 #define COLUMN_TYPE_GENERIC 0
 #define COLUMN_TYPE_MYCOMPUTER 1
@@ -38,83 +44,97 @@
 #define COLUMN_TYPE_NETWORK 5
 #define COLUMN_TYPE_NETWORKPLACES 6
 
-/* These represent the pre-hashed values of attribute
-names. They are used to avoid string comparisons
-on each attribute. If the hash function or any of
-the attribute names change in any way, these values
-will need to be changed correspondingly. */
-#define HASH_ALWAYSOPENINNEWTAB 1123321600
-#define HASH_AUTOARRANGEGLOBAL 151507311
-#define HASH_CONFIRMCLOSETABS 2636757395
-#define HASH_DISPLAYCENTRECOLOR 3404143227
-#define HASH_DISPLAYFONT 362757714
-#define HASH_DISPLAYSURROUNDCOLOR 1807564604
-#define HASH_DISPLAYTEXTCOLOR 4212809823
-#define HASH_DISPLAYWINDOWWIDTH 3332824435
-#define HASH_DISPLAYWINDOWHEIGHT 2017415020
-#define HASH_DISPLAYWINDOWVERTICAL 2262072301
-#define HASH_LANGUAGE 3526403497
-#define HASH_LASTSELECTEDTAB 1712438393
-#define HASH_NEXTTOCURRENT 743165450
-#define HASH_SHOWADDRESSBAR 3302864385
-#define HASH_SHOWBOOKMARKSTOOLBAR 1216493954
-#define HASH_SHOWDRIVESTOOLBAR 899091590
-#define HASH_SHOWDISPLAYWINDOW 351410676
-#define HASH_SHOWEXTENSIONS 3743594966
-#define HASH_SHOWFOLDERS 948345109
-#define HASH_SHOWFOLDERSIZES 3684676528
-#define HASH_SHOWFRIENDLYDATES 467626964
-#define HASH_SHOWFULLTITLEPATH 1871292168
-#define HASH_SHOWGRIDLINESGLOBAL 1707929656
-#define HASH_SHOWHIDDENGLOBAL 558199811
-#define HASH_SHOWSTATUSBAR 3554629247
-#define HASH_SHOWINFOTIPS 3018038962
-#define HASH_SHOWTOOLBAR 1852868921
-#define HASH_SORTASCENDINGGLOBAL 2605638058
-#define HASH_STARTUPMODE 1344265373
-#define HASH_TOOLBARSTATE 3436473849
-#define HASH_TREEVIEWDELAYENABLED 2186637066
-#define HASH_TREEVIEWWIDTH 4257779536
-#define HASH_VIEWMODEGLOBAL 3743629718
-#define HASH_POSITION 3300187802
-#define HASH_LOCKTOOLBARS 3842965076
-#define HASH_NEWTABDIRECTORY 3570078203
-#define HASH_INFOTIPTYPE 3366492864
-#define HASH_SHOWAPPLICATIONTOOLBAR 101571053
-#define HASH_USEFULLROWSELECT 3780943197
-#define HASH_SHOWINGROUPSGLOBAL 4239388334
-#define HASH_EXTENDTABCONTROL 4097866437
-#define HASH_SHOWFILEPREVIEWS 1834921243
-#define HASH_REPLACEEXPLORERMODE 2422294263
-#define HASH_SHOWUSERNAMETITLEBAR 2618183549
-#define HASH_HIDESYSTEMFILESGLOBAL 1667356744
-#define HASH_HIDELINKEXTENSIONGLOBAL 1073100667
-#define HASH_ALLOWMULTIPLEINSTANCES 3463984536
-#define HASH_ONECLICKACTIVATE 1118178238
-#define HASH_ONECLICKACTIVATEHOVERTIME 3023373873
-#define HASH_FORCESAMETABWIDTH 2315576081
-#define HASH_DOUBLECLICKTABCLOSE 1866215987
-#define HASH_HANDLEZIPFILES 1074212343
-#define HASH_INSERTSORTED 1109371947
-#define HASH_SHOWPRIVILEGETITLEBAR 4071561587
-#define HASH_DISABLEFOLDERSIZENETWORKREMOVABLE 2610679594
-#define HASH_ALWAYSSHOWTABBAR 148004675
-#define HASH_CHECKBOXSELECTION 456677010
-#define HASH_FORCESIZE 1918861263
-#define HASH_SIZEDISPLAYFOMRAT 3548127263
-#define HASH_CLOSEMAINWINDOWONTABCLOSE 1151827266
-#define HASH_SHOWTABBARATBOTTOM 4099029340
-#define HASH_SHOWTASKBARTHUMBNAILS 2202555045
-#define HASH_SYNCHRONIZETREEVIEW 1687787660
-#define HASH_TVAUTOEXPAND 1228854897
-#define HASH_OVERWRITEEXISTINGFILESCONFIRMATION 1625342835
-#define HASH_LARGETOOLBARICONS 10895007
-#define HASH_ICON_THEME 3998265761
-#define HASH_CHECK_PINNED_TO_NAMESPACE_TREE_PROPERTY 145831142
-#define HASH_ENABLE_DARK_MODE 1623404723
-#define HASH_DISPLAY_MIXED_FILES_AND_FOLDERS 1168704423
-#define HASH_USE_NATURAL_SORT_ORDER 528323501
-#define HASH_OPEN_TABS_IN_FOREGROUND 2957281235
+/* The names of the settings stored in the Settings
+section. The table built from these names is used to map
+each setting that's loaded back to its name, without
+having to compare the name against each of the entries
+here. */
+// clang-format off
+constexpr auto GENERIC_SETTING_NAMES = std::to_array<std::wstring_view>({
+	L"AlwaysOpenInNewTab",
+	L"AutoArrangeGlobal",
+	L"ConfirmCloseTabs",
+	L"DisplayCentreColor",
+	L"DisplayFont",
+	L"DisplaySurroundColor",
+	L"DisplayTextColor",
+	L"DisplayWindowWidth",
+	L"DisplayWindowHeight",
+	L"DisplayWindowVertical",
+	L"Language",
+	L"LastSelectedTab",
+	L"NextToCurrent",
+	L"ShowAddressBar",
+	L"ShowBookmarksToolbar",
+	L"ShowDrivesToolbar",
+	L"ShowDisplayWindow",
+	L"ShowExtensions",
+	L"ShowFolders",
+	L"ShowFolderSizes",
+	L"ShowFriendlyDates",
+	L"ShowFullTitlePath",
+	L"ShowGridlinesGlobal",
+	L"ShowHiddenGlobal",
+	L"ShowStatusBar",
+	L"ShowInfoTips",
+	L"ShowToolbar",
+	L"SortAscendingGlobal",
+	L"StartupMode",
+	L"ToolbarState",
+	L"TreeViewDelayEnabled",
+	L"TreeViewWidth",
+	L"ViewModeGlobal",
+	L"Position",
+	L"LockToolbars",
+	L"NewTabDirectory",
+	L"InfoTipType",
+	L"ShowApplicationToolbar",
+	L"UseFullRowSelect",
+	L"ShowInGroupsGlobal",
+	L"ExtendTabControl",
+	L"ShowFilePreviews",
+	L"ReplaceExplorerMode",
+	L"ShowUserNameTitleBar",
+	L"HideSystemFilesGlobal",
+	L"HideLinkExtensionGlobal",
+	L"AllowMultipleInstances",
+	L"OneClickActivate",
+	L"OneClickActivateHoverTime",
+	L"ForceSameTabWidth",
+	L"DoubleClickTabClose",
+	L"HandleZipFiles",
+	L"InsertSorted",
+	L"ShowPrivilegeLevelInTitleBar",
+	L"DisableFolderSizesNetworkRemovable",
+	L"AlwaysShowTabBar",
+	L"CheckBoxSelection",
+	L"ForceSize",
+	L"SizeDisplayFormat",
+	L"CloseMainWindowOnTabClose",
+	L"ShowTabBarAtBottom",
+	L"ShowTaskbarThumbnails",
+	L"SynchronizeTreeview",
+	L"TVAutoExpandSelected",
+	L"OverwriteExistingFilesConfirmation",
+	L"LargeToolbarIcons",
+	L"IconTheme",
+	L"CheckPinnedToNamespaceTreeProperty",
+	L"EnableDarkMode",
+	L"DisplayMixedFilesAndFolders",
+	L"UseNaturalSortOrder",
+	L"OpenTabsInForeground",
+});
+// clang-format on
+
+constexpr PerfectHashTable<GENERIC_SETTING_NAMES.size()> GENERIC_SETTINGS_TABLE(
+	GENERIC_SETTING_NAMES);
+
+/* Used for the case labels when dispatching on a setting
+name. Misspelling a name will result in a compile error. */
+consteval size_t GenericSetting(std::wstring_view name)
+{
+	return GENERIC_SETTINGS_TABLE.GetIndex(name);
+}
 
 struct ColumnXMLSaveData
 {
@@ -191,115 +211,89 @@ static ColumnXMLSaveData ColumnData[] = {
 };
 // clang-format on
 
-unsigned long hash_setting(unsigned char *str);
-
-BOOL LoadWindowPositionFromXML(WINDOWPLACEMENT *pwndpl)
+std::wstring GetXmlConfigFilePath()
 {
-	wil::com_ptr_nothrow<IXMLDOMDocument> pXMLDom;
-	pXMLDom.attach(NXMLSettings::DomFromCOM());
-
-	if (!pXMLDom)
-	{
-		return FALSE;
-	}
-
+	/* The configuration file is stored in the same
+	directory as the executable. */
 	TCHAR szConfigFile[MAX_PATH];
 	GetProcessImageName(GetCurrentProcessId(), szConfigFile, SIZEOF_ARRAY(szConfigFile));
 	PathRemoveFileSpec(szConfigFile);
 	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
 
-	wil::unique_variant var(NXMLSettings::VariantString(szConfigFile));
-	VARIANT_BOOL status;
-	pXMLDom->load(var, &status);
-
-	if (status != VARIANT_TRUE)
-	{
-		return FALSE;
-	}
-
-	wil::com_ptr_nothrow<IXMLDOMNodeList> pNodes;
-	auto bstr = wil::make_bstr_nothrow(L"//WindowPosition/*");
-	pXMLDom->selectNodes(bstr.get(), &pNodes);
+	return szConfigFile;
+}
 
-	if (!pNodes)
-	{
-		return FALSE;
-	}
+/* Both the window position and the multiple instances
+setting are needed before the main window is created.
+Rather than loading the entire configuration file into a
+DOM, the file is streamed, with reading stopping as soon as
+the relevant setting has been found. */
+BOOL LoadWindowPositionFromXML(WINDOWPLACEMENT *pwndpl)
+{
+	std::optional<XmlStreamReader::Element> positionSetting;
 
-	pwndpl->length = sizeof(WINDOWPLACEMENT);
+	XmlStreamReader reader;
+	reader.ReadSection(L"WindowPosition",
+		[&positionSetting](const XmlStreamReader::Element &element)
+		{
+			/* There should only be one node
+			under 'WindowPosition'. */
+			positionSetting = element;
+			return false;
+		});
 
-	long length;
-	pNodes->get_length(&length);
+	HRESULT hr = reader.ReadFile(GetXmlConfigFilePath());
 
-	/* There should only be one node
-	under 'WindowPosition'. */
-	if (length != 1)
+	if (FAILED(hr) || !positionSetting)
 	{
 		return FALSE;
 	}
 
-	wil::com_ptr_nothrow<IXMLDOMNode> pNode;
-	pNodes->get_item(0, &pNode);
-
-	wil::com_ptr_nothrow<IXMLDOMNamedNodeMap> am;
-	HRESULT hr = pNode->get_attributes(&am);
+	pwndpl->length = sizeof(WINDOWPLACEMENT);
 
-	if (SUCCEEDED(hr))
+	for (size_t i = 1; i < positionSetting->attributes.size(); i++)
 	{
-		long nChildNodes;
-		am->get_length(&nChildNodes);
+		const auto &[name, value] = positionSetting->attributes[i];
 
-		for (long i = 1; i < nChildNodes; i++)
+		if (name == L"Flags")
 		{
-			wil::com_ptr_nothrow<IXMLDOMNode> pChildNode;
-			am->get_item(i, &pChildNode);
-
-			wil::unique_bstr bstrName;
-			pChildNode->get_nodeName(&bstrName);
-
-			wil::unique_bstr bstrValue;
-			pChildNode->get_text(&bstrValue);
-
-			if (lstrcmp(bstrName.get(), _T("Flags")) == 0)
-			{
-				pwndpl->flags = NXMLSettings::DecodeIntValue(bstrValue.get());
-			}
-			else if (lstrcmp(bstrName.get(), _T("ShowCmd")) == 0)
-			{
-				pwndpl->showCmd = NXMLSettings::DecodeIntValue(bstrValue.get());
-			}
-			else if (lstrcmp(bstrName.get(), _T("MinPositionX")) == 0)
-			{
-				pwndpl->ptMinPosition.x = NXMLSettings::DecodeIntValue(bstrValue.get());
-			}
-			else if (lstrcmp(bstrName.get(), _T("MinPositionY")) == 0)
-			{
-				pwndpl->ptMinPosition.y = NXMLSettings::DecodeIntValue(bstrValue.get());
-			}
-			else if (lstrcmp(bstrName.get(), _T("MaxPositionX")) == 0)
-			{
-				pwndpl->ptMaxPosition.x = NXMLSettings::DecodeIntValue(bstrValue.get());
-			}
-			else if (lstrcmp(bstrName.get(), _T("MaxPositionY")) == 0)
-			{
-				pwndpl->ptMaxPosition.y = NXMLSettings::DecodeIntValue(bstrValue.get());
-			}
-			else if (lstrcmp(bstrName.get(), _T("NormalPositionLeft")) == 0)
-			{
-				pwndpl->rcNormalPosition.left = NXMLSettings::DecodeIntValue(bstrValue.get());
-			}
-			else if (lstrcmp(bstrName.get(), _T("NormalPositionTop")) == 0)
-			{
-				pwndpl->rcNormalPosition.top = NXMLSettings::DecodeIntValue(bstrValue.get());
-			}
-			else if (lstrcmp(bstrName.get(), _T("NormalPositionRight")) == 0)
-			{
-				pwndpl->rcNormalPosition.right = NXMLSettings::DecodeIntValue(bstrValue.get());
-			}
-			else if (lstrcmp(bstrName.get(), _T("NormalPositionBottom")) == 0)
-			{
-				pwndpl->rcNormalPosition.bottom = NXMLSettings::DecodeIntValue(bstrValue.get());
-			}
+			pwndpl->flags = NXMLSettings::DecodeIntValue(value.c_str());
+		}
+		else if (name == L"ShowCmd")
+		{
+			pwndpl->showCmd = NXMLSettings::DecodeIntValue(value.c_str());
+		}
+		else if (name == L"MinPositionX")
+		{
+			pwndpl->ptMinPosition.x = NXMLSettings::DecodeIntValue(value.c_str());
+		}
+		else if (name == L"MinPositionY")
+		{
+			pwndpl->ptMinPosition.y = NXMLSettings::DecodeIntValue(value.c_str());
+		}
+		else if (name == L"MaxPositionX")
+		{
+			pwndpl->ptMaxPosition.x = NXMLSettings::DecodeIntValue(value.c_str());
+		}
+		else if (name == L"MaxPositionY")
+		{
+			pwndpl->ptMaxPosition.y = NXMLSettings::DecodeIntValue(value.c_str());
+		}
+		else if (name == L"NormalPositionLeft")
+		{
+			pwndpl->rcNormalPosition.left = NXMLSettings::DecodeIntValue(value.c_str());
+		}
+		else if (name == L"NormalPositionTop")
+		{
+			pwndpl->rcNormalPosition.top = NXMLSettings::DecodeIntValue(value.c_str());
+		}
+		else if (name == L"NormalPositionRight")
+		{
+			pwndpl->rcNormalPosition.right = NXMLSettings::DecodeIntValue(value.c_str());
+		}
+		else if (name == L"NormalPositionBottom")
+		{
+			pwndpl->rcNormalPosition.bottom = NXMLSettings::DecodeIntValue(value.c_str());
 		}
 	}
 
@@ -310,118 +304,38 @@ BOOL LoadAllowMultipleInstancesFromXML()
 {
 	BOOL bAllowMultipleInstances = TRUE;
 
-	wil::com_ptr_nothrow<IXMLDOMDocument> pXMLDom;
-	pXMLDom.attach(NXMLSettings::DomFromCOM());
-
-	if (!pXMLDom)
-	{
-		return bAllowMultipleInstances;
-	}
-
-	TCHAR szConfigFile[MAX_PATH];
-	GetProcessImageName(GetCurrentProcessId(), szConfigFile, SIZEOF_ARRAY(szConfigFile));
-	PathRemoveFileSpec(szConfigFile);
-	PathAppend(szConfigFile, NExplorerplusplus::XML_FILENAME);
-
-	VARIANT_BOOL status;
-	wil::unique_variant var(NXMLSettings::VariantString(szConfigFile));
-	pXMLDom->load(var, &status);
-
-	if (status != VARIANT_TRUE)
-	{
-		return bAllowMultipleInstances;
-	}
-
-	wil::com_ptr_nothrow<IXMLDOMNodeList> pNodes;
-	auto bstr = wil::make_bstr_nothrow(L"//Settings/*");
-	pXMLDom->selectNodes(bstr.get(), &pNodes);
-
-	if (!pNodes)
-	{
-		return bAllowMultipleInstances;
-	}
-
-	long length;
-	pNodes->get_length(&length);
-
-	for (long i = 0; i < length; i++)
-	{
-		wil::com_ptr_nothrow<IXMLDOMNode> pNode;
-		pNodes->get_item(i, &pNode);
-
-		wil::com_ptr_nothrow<IXMLDOMNamedNodeMap> am;
-		HRESULT hr = pNode->get_attributes(&am);
-
-		if (SUCCEEDED(hr))
+	XmlStreamReader reader;
+	reader.ReadSection(L"Settings",
+		[&bAllowMultipleInstances](const XmlStreamReader::Element &element)
 		{
-			wil::com_ptr_nothrow<IXMLDOMNode> pNodeAttribute;
-			hr = am->get_item(0, &pNodeAttribute);
-
-			if (SUCCEEDED(hr))
+			if (element.attributes.empty()
+				|| element.attributes[0].second != L"AllowMultipleInstances")
 			{
-				wil::unique_bstr bstrName;
-				pNodeAttribute->get_text(&bstrName);
+				return true;
+			}
 
-				wil::unique_bstr bstrValue;
-				pNode->get_text(&bstrValue);
+			bAllowMultipleInstances = NXMLSettings::DecodeBoolValue(element.text.c_str());
+			return false;
+		});
 
-				if (lstrcmp(bstrName.get(), _T("AllowMultipleInstances")) == 0)
-				{
-					bAllowMultipleInstances = NXMLSettings::DecodeBoolValue(bstrValue.get());
-					break;
-				}
-			}
-		}
-	}
+	reader.ReadFile(GetXmlConfigFilePath());
 
 	return bAllowMultipleInstances;
 }
 
-void Explorerplusplus::LoadGenericSettingsFromXML(IXMLDOMDocument *pXMLDom)
+void Explorerplusplus::LoadGenericSettingsFromXML(
+	const std::vector<XmlStreamReader::Element> &settings)
 {
-	if (!pXMLDom)
+	for (const auto &setting : settings)
 	{
-		return;
-	}
-
-	wil::com_ptr_nothrow<IXMLDOMNodeList> pNodes;
-	auto bstr = wil::make_bstr_nothrow(L"//Settings/*");
-	pXMLDom->selectNodes(bstr.get(), &pNodes);
-
-	if (!pNodes)
-	{
-		return;
-	}
-
-	long length;
-	pNodes->get_length(&length);
-
-	for (long i = 0; i < length; i++)
-	{
-		wil::com_ptr_nothrow<IXMLDOMNode> pNode;
-		pNodes->get_item(i, &pNode);
-
-		wil::com_ptr_nothrow<IXMLDOMNamedNodeMap> am;
-		HRESULT hr = pNode->get_attributes(&am);
-
-		if (SUCCEEDED(hr))
+		if (setting.attributes.empty())
 		{
-			wil::com_ptr_nothrow<IXMLDOMNode> pNodeAttribute;
-			hr = am->get_item(0, &pNodeAttribute);
-
-			if (SUCCEEDED(hr))
-			{
-				wil::unique_bstr bstrName;
-				pNodeAttribute->get_text(&bstrName);
-
-				wil::unique_bstr bstrValue;
-				pNode->get_text(&bstrValue);
-
-				/* Map the external attribute and value to an
-				internal variable. */
-				MapAttributeToValue(pNode.get(), bstrName.get(), bstrValue.get());
-			}
+			continue;
 		}
+
+		/* Map the external attribute and value to an
+		internal variable. */
+		MapAttributeToValue(setting);
 	}
 }
 
@@ -1456,331 +1370,308 @@ void Explorerplusplus::SaveApplicationToolbarToXML(IXMLDOMDocument *pXMLDom, IXM
 	NXMLSettings::AppendChildToParent(pe.get(), pRoot);
 }
 
-unsigned long hash_setting(unsigned char *str)
+/* Maps attribute name to their corresponding internal variable. */
+void Explorerplusplus::MapAttributeToValue(const XmlStreamReader::Element &setting)
 {
-	unsigned long hash = 5381;
-	int c;
+	/* The name of the setting is stored in the first
+	attribute, with the value stored as the element text. */
+	auto settingIndex = GENERIC_SETTINGS_TABLE.Find(setting.attributes[0].second);
 
-	while ((c = *str++) != '\0')
+	if (!settingIndex)
 	{
-		hash = ((hash << 5) + hash) + c;
+		return;
 	}
 
-	return hash;
-}
+	const WCHAR *wszValue = setting.text.c_str();
 
-/* Maps attribute name to their corresponding internal variable. */
-void Explorerplusplus::MapAttributeToValue(IXMLDOMNode *pNode, WCHAR *wszName, WCHAR *wszValue)
-{
-	unsigned char szName[512];
-	unsigned long uNameHash;
-
-	WideCharToMultiByte(CP_ACP, 0, wszName, -1, (LPSTR) szName, SIZEOF_ARRAY(szName), nullptr,
-		nullptr);
-
-	uNameHash = hash_setting(szName);
-
-	switch (uNameHash)
+	switch (*settingIndex)
 	{
-	case HASH_ALLOWMULTIPLEINSTANCES:
+	case GenericSetting(L"AllowMultipleInstances"):
 		m_config->allowMultipleInstances = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_ALWAYSOPENINNEWTAB:
+	case GenericSetting(L"AlwaysOpenInNewTab"):
 		m_config->alwaysOpenNewTab = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_ALWAYSSHOWTABBAR:
+	case GenericSetting(L"AlwaysShowTabBar"):
 		m_config->alwaysShowTabBar.set(NXMLSettings::DecodeBoolValue(wszValue));
 		break;
 
-	case HASH_AUTOARRANGEGLOBAL:
+	case GenericSetting(L"AutoArrangeGlobal"):
 		m_config->defaultFolderSettings.autoArrange = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_CHECKBOXSELECTION:
+	case GenericSetting(L"CheckBoxSelection"):
 		m_config->checkBoxSelection = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_CLOSEMAINWINDOWONTABCLOSE:
+	case GenericSetting(L"CloseMainWindowOnTabClose"):
 		m_config->closeMainWindowOnTabClose = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_CONFIRMCLOSETABS:
+	case GenericSetting(L"ConfirmCloseTabs"):
 		m_config->confirmCloseTabs = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_DISABLEFOLDERSIZENETWORKREMOVABLE:
+	case GenericSetting(L"DisableFolderSizesNetworkRemovable"):
 		m_config->globalFolderSettings.disableFolderSizesNetworkRemovable =
 			NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_DISPLAYCENTRECOLOR:
-		m_config->displayWindowCentreColor = NXMLSettings::ReadXMLColorData2(pNode);
+	case GenericSetting(L"DisplayCentreColor"):
+		m_config->displayWindowCentreColor = NXMLSettings::ReadXMLColorData2(setting);
 		break;
 
-	case HASH_DISPLAYFONT:
-		m_config->displayWindowFont = NXMLSettings::ReadXMLFontData(pNode);
+	case GenericSetting(L"DisplayFont"):
+		m_config->displayWindowFont = NXMLSettings::ReadXMLFontData(setting);
 		break;
 
-	case HASH_DISPLAYSURROUNDCOLOR:
-		m_config->displayWindowSurroundColor = NXMLSettings::ReadXMLColorData2(pNode);
+	case GenericSetting(L"DisplaySurroundColor"):
+		m_config->displayWindowSurroundColor = NXMLSettings::ReadXMLColorData2(setting);
 		break;
 
-	case HASH_DISPLAYTEXTCOLOR:
-		m_config->displayWindowTextColor = NXMLSettings::ReadXMLColorData(pNode);
+	case GenericSetting(L"DisplayTextColor"):
+		m_config->displayWindowTextColor = NXMLSettings::ReadXMLColorData(setting);
 		break;
 
-	case HASH_DISPLAYWINDOWWIDTH:
+	case GenericSetting(L"DisplayWindowWidth"):
 		m_config->displayWindowWidth = NXMLSettings::DecodeIntValue(wszValue);
 		break;
 
-	case HASH_DISPLAYWINDOWHEIGHT:
+	case GenericSetting(L"DisplayWindowHeight"):
 		m_config->displayWindowHeight = NXMLSettings::DecodeIntValue(wszValue);
 		break;
 
-	case HASH_DISPLAYWINDOWVERTICAL:
+	case GenericSetting(L"DisplayWindowVertical"):
 		m_config->displayWindowVertical = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_DOUBLECLICKTABCLOSE:
+	case GenericSetting(L"DoubleClickTabClose"):
 		m_config->doubleClickTabClose = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_EXTENDTABCONTROL:
+	case GenericSetting(L"ExtendTabControl"):
 		m_config->extendTabControl.set(NXMLSettings::DecodeBoolValue(wszValue));
 		break;
 
-	case HASH_FORCESAMETABWIDTH:
+	case GenericSetting(L"ForceSameTabWidth"):
 		m_config->forceSameTabWidth.set(NXMLSettings::DecodeBoolValue(wszValue));
 		break;
 
-	case HASH_FORCESIZE:
+	case GenericSetting(L"ForceSize"):
 		m_config->globalFolderSettings.forceSize = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_HANDLEZIPFILES:
+	case GenericSetting(L"HandleZipFiles"):
 		m_config->handleZipFiles = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_HIDELINKEXTENSIONGLOBAL:
+	case GenericSetting(L"HideLinkExtensionGlobal"):
 		m_config->globalFolderSettings.hideLinkExtension = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_HIDESYSTEMFILESGLOBAL:
+	case GenericSetting(L"HideSystemFilesGlobal"):
 		m_config->globalFolderSettings.hideSystemFiles = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_INSERTSORTED:
+	case GenericSetting(L"InsertSorted"):
 		m_config->globalFolderSettings.insertSorted = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_LANGUAGE:
+	case GenericSetting(L"Language"):
 		m_config->language = NXMLSettings::DecodeIntValue(wszValue);
 		m_bLanguageLoaded = true;
 		break;
 
-	case HASH_LARGETOOLBARICONS:
+	case GenericSetting(L"LargeToolbarIcons"):
 		m_config->useLargeToolbarIcons.set(NXMLSettings::DecodeBoolValue(wszValue));
 		break;
 
-	case HASH_LASTSELECTEDTAB:
+	case GenericSetting(L"LastSelectedTab"):
 		m_iLastSelectedTab = NXMLSettings::DecodeIntValue(wszValue);
 		break;
 
-	case HASH_LOCKTOOLBARS:
+	case GenericSetting(L"LockToolbars"):
 		m_config->lockToolbars = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_NEXTTOCURRENT:
+	case GenericSetting(L"NextToCurrent"):
 		m_config->openNewTabNextToCurrent = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_ONECLICKACTIVATE:
+	case GenericSetting(L"OneClickActivate"):
 		m_config->globalFolderSettings.oneClickActivate = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_ONECLICKACTIVATEHOVERTIME:
+	case GenericSetting(L"OneClickActivateHoverTime"):
 		m_config->globalFolderSettings.oneClickActivateHoverTime =
 			NXMLSettings::DecodeIntValue(wszValue);
 		break;
 
-	case HASH_OVERWRITEEXISTINGFILESCONFIRMATION:
+	case GenericSetting(L"OverwriteExistingFilesConfirmation"):
 		m_config->overwriteExistingFilesConfirmation = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_REPLACEEXPLORERMODE:
+	case GenericSetting(L"ReplaceExplorerMode"):
 		m_config->replaceExplorerMode = static_cast<DefaultFileManager::ReplaceExplorerMode>(
 			NXMLSettings::DecodeIntValue(wszValue));
 		break;
 
-	case HASH_SHOWADDRESSBAR:
+	case GenericSetting(L"ShowAddressBar"):
 		m_config->showAddressBar = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWAPPLICATIONTOOLBAR:
+	case GenericSetting(L"ShowApplicationToolbar"):
 		m_config->showApplicationToolbar = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWBOOKMARKSTOOLBAR:
+	case GenericSetting(L"ShowBookmarksToolbar"):
 		m_config->showBookmarksToolbar = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWDRIVESTOOLBAR:
+	case GenericSetting(L"ShowDrivesToolbar"):
 		m_config->showDrivesToolbar = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWDISPLAYWINDOW:
+	case GenericSetting(L"ShowDisplayWindow"):
 		m_config->showDisplayWindow = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWEXTENSIONS:
+	case GenericSetting(L"ShowExtensions"):
 		m_config->globalFolderSettings.showExtensions = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWFILEPREVIEWS:
+	case GenericSetting(L"ShowFilePreviews"):
 		m_config->showFilePreviews = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWFOLDERS:
+	case GenericSetting(L"ShowFolders"):
 		m_config->showFolders = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWFOLDERSIZES:
+	case GenericSetting(L"ShowFolderSizes"):
 		m_config->globalFolderSettings.showFolderSizes = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWFRIENDLYDATES:
+	case GenericSetting(L"ShowFriendlyDates"):
 		m_config->globalFolderSettings.showFriendlyDates = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWFULLTITLEPATH:
+	case GenericSetting(L"ShowFullTitlePath"):
 		m_config->showFullTitlePath.set(NXMLSettings::DecodeBoolValue(wszValue));
 		break;
 
-	case HASH_SHOWGRIDLINESGLOBAL:
+	case GenericSetting(L"ShowGridlinesGlobal"):
 		m_config->globalFolderSettings.showGridlines = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWHIDDENGLOBAL:
+	case GenericSetting(L"ShowHiddenGlobal"):
 		m_config->defaultFolderSettings.showHidden = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWINFOTIPS:
+	case GenericSetting(L"ShowInfoTips"):
 		m_config->showInfoTips = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWINGROUPSGLOBAL:
+	case GenericSetting(L"ShowInGroupsGlobal"):
 		m_config->defaultFolderSettings.showInGroups = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWPRIVILEGETITLEBAR:
+	case GenericSetting(L"ShowPrivilegeLevelInTitleBar"):
 		m_config->showPrivilegeLevelInTitleBar.set(NXMLSettings::DecodeBoolValue(wszValue));
 		break;
 
-	case HASH_SHOWSTATUSBAR:
+	case GenericSetting(L"ShowStatusBar"):
 		m_config->showStatusBar = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWTABBARATBOTTOM:
+	case GenericSetting(L"ShowTabBarAtBottom"):
 		m_config->showTabBarAtBottom.set(NXMLSettings::DecodeBoolValue(wszValue));
 		break;
 
-	case HASH_SHOWTASKBARTHUMBNAILS:
+	case GenericSetting(L"ShowTaskbarThumbnails"):
 		m_config->showTaskbarThumbnails = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWTOOLBAR:
+	case GenericSetting(L"ShowToolbar"):
 		m_config->showMainToolbar = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_SHOWUSERNAMETITLEBAR:
+	case GenericSetting(L"ShowUserNameTitleBar"):
 		m_config->showUserNameInTitleBar.set(NXMLSettings::DecodeBoolValue(wszValue));
 		break;
 
-	case HASH_SIZEDISPLAYFOMRAT:
+	case GenericSetting(L"SizeDisplayFormat"):
 		m_config->globalFolderSettings.sizeDisplayFormat =
 			static_cast<SizeDisplayFormat>(NXMLSettings::DecodeIntValue(wszValue));
 		break;
 
-	case HASH_SORTASCENDINGGLOBAL:
+	case GenericSetting(L"SortAscendingGlobal"):
 		m_config->defaultFolderSettings.sortAscending = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_STARTUPMODE:
+	case GenericSetting(L"StartupMode"):
 		m_config->startupMode = static_cast<StartupMode>(NXMLSettings::DecodeIntValue(wszValue));
 		break;
 
-	case HASH_SYNCHRONIZETREEVIEW:
+	case GenericSetting(L"SynchronizeTreeview"):
 		m_config->synchronizeTreeview = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_TVAUTOEXPAND:
+	case GenericSetting(L"TVAutoExpandSelected"):
 		m_config->treeViewAutoExpandSelected = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_USEFULLROWSELECT:
+	case GenericSetting(L"UseFullRowSelect"):
 		m_config->useFullRowSelect = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_TOOLBARSTATE:
-		MainToolbarPersistentSettings::GetInstance().LoadXMLSettings(pNode);
+	case GenericSetting(L"ToolbarState"):
+		MainToolbarPersistentSettings::GetInstance().LoadXMLSettings(setting);
 		break;
 
-	case HASH_TREEVIEWDELAYENABLED:
+	case GenericSetting(L"TreeViewDelayEnabled"):
 		m_config->treeViewDelayEnabled = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_TREEVIEWWIDTH:
+	case GenericSetting(L"TreeViewWidth"):
 		m_config->treeViewWidth = NXMLSettings::DecodeIntValue(wszValue);
 		break;
 
-	case HASH_VIEWMODEGLOBAL:
+	case GenericSetting(L"ViewModeGlobal"):
 		m_config->defaultFolderSettings.viewMode =
 			ViewMode::_from_integral(NXMLSettings::DecodeIntValue(wszValue));
 		break;
 
-	case HASH_POSITION:
+	case GenericSetting(L"Position"):
 	{
-		wil::com_ptr_nothrow<IXMLDOMNamedNodeMap> am;
-		pNode->get_attributes(&am);
-
 		WINDOWPLACEMENT wndpl;
 		BOOL bMaximized = FALSE;
 
-		long lChildNodes;
-		am->get_length(&lChildNodes);
-
-		for (long j = 1; j < lChildNodes; j++)
+		for (size_t j = 1; j < setting.attributes.size(); j++)
 		{
-			wil::com_ptr_nothrow<IXMLDOMNode> pChildNode;
-			am->get_item(j, &pChildNode);
-
-			wil::unique_bstr bstrName;
-			pChildNode->get_nodeName(&bstrName);
-
-			wil::unique_bstr bstrValue;
-			pChildNode->get_text(&bstrValue);
+			const auto &[name, value] = setting.attributes[j];
 
-			if (lstrcmp(bstrName.get(), L"Left") == 0)
+			if (name == L"Left")
 			{
-				wndpl.rcNormalPosition.left = NXMLSettings::DecodeIntValue(bstrValue.get());
+				wndpl.rcNormalPosition.left = NXMLSettings::DecodeIntValue(value.c_str());
 			}
-			else if (lstrcmp(bstrName.get(), L"Top") == 0)
+			else if (name == L"Top")
 			{
-				wndpl.rcNormalPosition.top = NXMLSettings::DecodeIntValue(bstrValue.get());
+				wndpl.rcNormalPosition.top = NXMLSettings::DecodeIntValue(value.c_str());
 			}
-			else if (lstrcmp(bstrName.get(), L"Right") == 0)
+			else if (name == L"Right")
 			{
-				wndpl.rcNormalPosition.right = NXMLSettings::DecodeIntValue(bstrValue.get());
+				wndpl.rcNormalPosition.right = NXMLSettings::DecodeIntValue(value.c_str());
 			}
-			else if (lstrcmp(bstrName.get(), L"Bottom") == 0)
+			else if (name == L"Bottom")
 			{
-				wndpl.rcNormalPosition.bottom = NXMLSettings::DecodeIntValue(bstrValue.get());
+				wndpl.rcNormalPosition.bottom = NXMLSettings::DecodeIntValue(value.c_str());
 			}
-			else if (lstrcmp(bstrName.get(), L"Maximized") == 0)
+			else if (name == L"Maximized")
 			{
-				bMaximized = NXMLSettings::DecodeBoolValue(bstrValue.get());
+				bMaximized = NXMLSettings::DecodeBoolValue(value.c_str());
 			}
 		}
 
@@ -1796,37 +1687,37 @@ void Explorerplusplus::MapAttributeToValue(IXMLDOMNode *pNode, WCHAR *wszName, W
 	}
 	break;
 
-	case HASH_NEWTABDIRECTORY:
+	case GenericSetting(L"NewTabDirectory"):
 		m_config->defaultTabDirectory = wszValue;
 		break;
 
-	case HASH_INFOTIPTYPE:
+	case GenericSetting(L"InfoTipType"):
 		m_config->infoTipType = static_cast<InfoTipType>(NXMLSettings::DecodeIntValue(wszValue));
 		break;
 
-	case HASH_ICON_THEME:
+	case GenericSetting(L"IconTheme"):
 		m_config->iconTheme = IconTheme::_from_integral(NXMLSettings::DecodeIntValue(wszValue));
 		break;
 
-	case HASH_CHECK_PINNED_TO_NAMESPACE_TREE_PROPERTY:
+	case GenericSetting(L"CheckPinnedToNamespaceTreeProperty"):
 		m_config->checkPinnedToNamespaceTreeProperty = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_ENABLE_DARK_MODE:
+	case GenericSetting(L"EnableDarkMode"):
 		m_config->enableDarkMode = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_DISPLAY_MIXED_FILES_AND_FOLDERS:
+	case GenericSetting(L"DisplayMixedFilesAndFolders"):
 		m_config->globalFolderSettings.displayMixedFilesAndFolders =
 			NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_USE_NATURAL_SORT_ORDER:
+	case GenericSetting(L"UseNaturalSortOrder"):
 		m_config->globalFolderSettings.useNaturalSortOrder =
 			NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 
-	case HASH_OPEN_TABS_IN_FOREGROUND:
+	case GenericSetting(L"OpenTabsInForeground"):
 		m_config->openTabsInForeground = NXMLSettings::DecodeBoolValue(wszValue);
 		break;
 	}
@@ -5,6 +5,8 @@
 #pragma once
 
 #include <Windows.h>
+#include <string>
 
 BOOL LoadWindowPositionFromXML(WINDOWPLACEMENT *pwndpl);
 BOOL LoadAllowMultipleInstancesFromXML(void);
+std::wstring GetXmlConfigFilePath();
@@ -387,6 +387,8 @@
 #define IDC_ADVANCED_OPTION_DESCRIPTION 1346
 #define IDC_DISPLAY_MIXED_FILES_AND_FOLDERS 1347
 #define IDC_USE_NATURAL_SORT_ORDER      1348
+#define IDC_DESTROYFILES_PROGRESS       1349
+#define IDC_MERGE_CHECK_CHECKSUM        1350
 #define IDS_COLUMN_DESCRIPTION_NAME     2000
 #define IDS_COLUMN_DESCRIPTION_TYPE     2001
 #define IDS_COLUMN_DESCRIPTION_SIZE     2002
@@ -540,6 +542,11 @@
 #define IDS_SPLIT_FILE_SIZE_MB          2160
 #define IDS_SPLIT_FILE_SIZE_GB          2161
 #define IDS_GENERAL_TRANSLATION_DLL_VERSION_MISMATCH 2162
+#define IDS_MERGE_FILES_INPUTFILEINVALID 2163
+#define IDS_MERGE_FILES_FAILED          2164
+#define IDS_MERGE_FILES_CHECKSUM        2165
+#define IDS_SPLITFILEDIALOG_OUTPUTFILEERROR 2166
+#define IDS_DESTROY_FILES_FAILED        2167
 #define IDM_FILE_SAVEDIRECTORYLISTING   8002
 #define IDS_MERGE_FILES_COLUMN_FILE     8003
 #define IDS_OK                          8004
@@ -955,7 +962,7 @@
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NEXT_RESOURCE_VALUE        329
 #define _APS_NEXT_COMMAND_VALUE         40544
-#define _APS_NEXT_CONTROL_VALUE         1349
+#define _APS_NEXT_CONTROL_VALUE         1351
 #define _APS_NEXT_SYMED_VALUE           101
 #endif
 #endif
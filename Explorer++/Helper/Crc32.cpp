@@ -0,0 +1,78 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "Crc32.h"
+#include <array>
+
+namespace
+{
+
+constexpr uint32_t CRC32_POLYNOMIAL = 0xEDB88320;
+
+// Four tables are used, so that the data can be processed four bytes at a time (the "slicing-by-4"
+// technique). That's substantially faster than processing a byte at a time.
+constexpr std::array<std::array<uint32_t, 256>, 4> BuildCrcTables()
+{
+	std::array<std::array<uint32_t, 256>, 4> tables = {};
+
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t crc = i;
+
+		for (int bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 1) ? (crc >> 1) ^ CRC32_POLYNOMIAL : crc >> 1;
+		}
+
+		tables[0][i] = crc;
+	}
+
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		for (size_t table = 1; table < tables.size(); table++)
+		{
+			uint32_t previous = tables[table - 1][i];
+			tables[table][i] = (previous >> 8) ^ tables[0][previous & 0xFF];
+		}
+	}
+
+	return tables;
+}
+
+constexpr auto CRC_TABLES = BuildCrcTables();
+
+}
+
+void Crc32::Update(const void *data, size_t size)
+{
+	const auto *current = static_cast<const uint8_t *>(data);
+	uint32_t crc = m_crc;
+
+	while (size >= 4)
+	{
+		crc ^= static_cast<uint32_t>(current[0]) | (static_cast<uint32_t>(current[1]) << 8)
+			| (static_cast<uint32_t>(current[2]) << 16) | (static_cast<uint32_t>(current[3]) << 24);
+		crc = CRC_TABLES[3][crc & 0xFF] ^ CRC_TABLES[2][(crc >> 8) & 0xFF]
+			^ CRC_TABLES[1][(crc >> 16) & 0xFF] ^ CRC_TABLES[0][crc >> 24];
+
+		current += 4;
+		size -= 4;
+	}
+
+	while (size > 0)
+	{
+		crc = (crc >> 8) ^ CRC_TABLES[0][(crc ^ *current) & 0xFF];
+
+		current++;
+		size--;
+	}
+
+	m_crc = crc;
+}
+
+uint32_t Crc32::GetValue() const
+{
+	return m_crc ^ 0xFFFFFFFF;
+}
@@ -0,0 +1,20 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Incrementally calculates a CRC-32 checksum (as used by zip, PNG, etc.), so that the checksum of
+// a large amount of data can be calculated a chunk at a time.
+class Crc32
+{
+public:
+	void Update(const void *data, size_t size);
+	uint32_t GetValue() const;
+
+private:
+	uint32_t m_crc = 0xFFFFFFFF;
+};
@@ -0,0 +1,74 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DirectoryEventLog.h"
+
+DirectoryEventLog::DirectoryEventLog(size_t capacity) : m_capacity(capacity)
+{
+}
+
+void DirectoryEventLog::Record(int watchId, const std::vector<DirectoryChange> &changes,
+	bool reconstructed)
+{
+	std::scoped_lock lock(m_mutex);
+
+	int batchId = m_batchIdCounter++;
+
+	for (const auto &change : changes)
+	{
+		m_events.push_back({ watchId, batchId, reconstructed, change });
+	}
+
+	while (m_events.size() > m_capacity)
+	{
+		m_events.pop_front();
+	}
+}
+
+std::vector<DirectoryEventLog::Event> DirectoryEventLog::GetEvents() const
+{
+	std::scoped_lock lock(m_mutex);
+
+	return { m_events.begin(), m_events.end() };
+}
+
+void DirectoryEventLog::Clear()
+{
+	std::scoped_lock lock(m_mutex);
+
+	m_events.clear();
+}
+
+void DirectoryEventLog::Replay(int watchId, OnDirectoryAltered onDirectoryAltered,
+	void *data) const
+{
+	// The events are copied first, so that the callback can safely use the log.
+	auto events = GetEvents();
+
+	std::vector<DirectoryChange> batch;
+	int currentBatchId = -1;
+
+	for (const auto &event : events)
+	{
+		if (event.watchId != watchId)
+		{
+			continue;
+		}
+
+		if (event.batchId != currentBatchId && !batch.empty())
+		{
+			onDirectoryAltered(batch, data);
+			batch.clear();
+		}
+
+		currentBatchId = event.batchId;
+		batch.push_back(event.change);
+	}
+
+	if (!batch.empty())
+	{
+		onDirectoryAltered(batch, data);
+	}
+}
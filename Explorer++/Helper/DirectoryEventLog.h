@@ -0,0 +1,53 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "iDirectoryMonitor.h"
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// Records the changes reported by a directory monitor. The recorded changes can later be replayed
+// through a callback, in the same batches they were originally delivered in. That allows a
+// sequence of changes (e.g. one that caused a problem) to be fed back into a client without
+// having to reproduce the original filesystem activity.
+//
+// Changes are recorded on the monitor's thread, so all methods are thread-safe.
+class DirectoryEventLog
+{
+public:
+	struct Event
+	{
+		int watchId;
+
+		// Changes that were delivered together share the same batch id.
+		int batchId;
+
+		// True if the change was reconstructed (by comparing the directory to a previous snapshot
+		// of it), rather than being reported by the system.
+		bool reconstructed;
+
+		DirectoryChange change;
+	};
+
+	static constexpr size_t DEFAULT_CAPACITY = 10000;
+
+	// Once the log is full, the oldest events are discarded.
+	explicit DirectoryEventLog(size_t capacity = DEFAULT_CAPACITY);
+
+	void Record(int watchId, const std::vector<DirectoryChange> &changes, bool reconstructed);
+	std::vector<Event> GetEvents() const;
+	void Clear();
+
+	// Invokes the callback once for each recorded batch of changes for the specified watch.
+	void Replay(int watchId, OnDirectoryAltered onDirectoryAltered, void *data) const;
+
+private:
+	const size_t m_capacity;
+
+	mutable std::mutex m_mutex;
+	std::deque<Event> m_events;
+	int m_batchIdCounter = 0;
+};
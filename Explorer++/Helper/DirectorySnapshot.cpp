@@ -0,0 +1,157 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "DirectorySnapshot.h"
+#include "StringHelper.h"
+#include <wil/resource.h>
+#include <algorithm>
+
+std::optional<DirectorySnapshot> DirectorySnapshot::Capture(const std::wstring &directory)
+{
+	std::wstring searchPath = directory;
+
+	if (!searchPath.empty() && searchPath.back() != '\\')
+	{
+		searchPath += '\\';
+	}
+
+	searchPath += '*';
+
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findHandle(FindFirstFileEx(searchPath.c_str(), FindExInfoBasic, &findData,
+		FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	if (!findHandle)
+	{
+		return std::nullopt;
+	}
+
+	DirectorySnapshot snapshot;
+
+	do
+	{
+		if (lstrcmp(findData.cFileName, L".") == 0 || lstrcmp(findData.cFileName, L"..") == 0)
+		{
+			continue;
+		}
+
+		snapshot.AddItem(findData);
+	} while (FindNextFile(findHandle.get(), &findData));
+
+	if (GetLastError() != ERROR_NO_MORE_FILES)
+	{
+		return std::nullopt;
+	}
+
+	return snapshot;
+}
+
+void DirectorySnapshot::AddItem(const WIN32_FIND_DATA &findData)
+{
+	WIN32_FILE_ATTRIBUTE_DATA details;
+	details.dwFileAttributes = findData.dwFileAttributes;
+	details.ftCreationTime = findData.ftCreationTime;
+	details.ftLastAccessTime = findData.ftLastAccessTime;
+	details.ftLastWriteTime = findData.ftLastWriteTime;
+	details.nFileSizeHigh = findData.nFileSizeHigh;
+	details.nFileSizeLow = findData.nFileSizeLow;
+
+	m_items.insert_or_assign(
+		FoldStringCase(findData.cFileName), Item{ findData.cFileName, details });
+}
+
+void DirectorySnapshot::ApplyChange(const DirectoryChange &change)
+{
+	switch (change.action)
+	{
+	case FILE_ACTION_ADDED:
+	case FILE_ACTION_RENAMED_NEW_NAME:
+	case FILE_ACTION_MODIFIED:
+		m_items.insert_or_assign(
+			FoldStringCase(change.fileName), Item{ change.fileName, std::nullopt });
+		break;
+
+	case FILE_ACTION_REMOVED:
+	case FILE_ACTION_RENAMED_OLD_NAME:
+		m_items.erase(FoldStringCase(change.fileName));
+		break;
+	}
+}
+
+std::vector<DirectoryChange> DirectorySnapshot::Compare(const DirectorySnapshot &other) const
+{
+	std::vector<std::wstring> removedItems;
+	std::vector<std::wstring> addedItems;
+	std::vector<std::wstring> modifiedItems;
+
+	for (const auto &[key, item] : m_items)
+	{
+		auto itr = other.m_items.find(key);
+
+		if (itr == other.m_items.end())
+		{
+			removedItems.push_back(item.name);
+		}
+		else if (item.name != itr->second.name)
+		{
+			// The case of the name has changed, which is only possible if the item was renamed.
+			removedItems.push_back(item.name);
+			addedItems.push_back(itr->second.name);
+		}
+		else if (!AreDetailsEqual(item.details, itr->second.details))
+		{
+			modifiedItems.push_back(item.name);
+		}
+	}
+
+	for (const auto &[key, item] : other.m_items)
+	{
+		if (!m_items.contains(key))
+		{
+			addedItems.push_back(item.name);
+		}
+	}
+
+	std::vector<DirectoryChange> changes;
+	changes.reserve(removedItems.size() + addedItems.size() + modifiedItems.size());
+
+	auto appendChanges = [&changes](std::vector<std::wstring> &names, DWORD action)
+	{
+		std::sort(names.begin(), names.end());
+
+		for (auto &name : names)
+		{
+			changes.push_back({ action, std::move(name) });
+		}
+	};
+
+	appendChanges(removedItems, FILE_ACTION_REMOVED);
+	appendChanges(addedItems, FILE_ACTION_ADDED);
+	appendChanges(modifiedItems, FILE_ACTION_MODIFIED);
+
+	return changes;
+}
+
+size_t DirectorySnapshot::GetNumItems() const
+{
+	return m_items.size();
+}
+
+// The last access time isn't compared, since reading a file (which doesn't generate a change
+// notification) can update it.
+bool DirectorySnapshot::AreDetailsEqual(const std::optional<WIN32_FILE_ATTRIBUTE_DATA> &details1,
+	const std::optional<WIN32_FILE_ATTRIBUTE_DATA> &details2)
+{
+	if (!details1 || !details2)
+	{
+		return false;
+	}
+
+	return details1->dwFileAttributes == details2->dwFileAttributes
+		&& CompareFileTime(&details1->ftCreationTime, &details2->ftCreationTime) == 0
+		&& CompareFileTime(&details1->ftLastWriteTime, &details2->ftLastWriteTime) == 0
+		&& details1->nFileSizeHigh == details2->nFileSizeHigh
+		&& details1->nFileSizeLow == details2->nFileSizeLow;
+}
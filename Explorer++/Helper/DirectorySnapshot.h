@@ -0,0 +1,48 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "iDirectoryMonitor.h"
+#include <windows.h>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A record of the items in a single directory. When changes to a directory are lost (because
+// they arrived faster than they could be read), a fresh snapshot can be compared with the previous
+// one to reconstruct the changes that were missed.
+class DirectorySnapshot
+{
+public:
+	static std::optional<DirectorySnapshot> Capture(const std::wstring &directory);
+
+	void AddItem(const WIN32_FIND_DATA &findData);
+
+	// Keeps the snapshot up to date as changes are reported. Since a change notification doesn't
+	// include any details about the item, the details of added or modified items are unknown from
+	// that point and the item will always be reported as modified in a later comparison.
+	void ApplyChange(const DirectoryChange &change);
+
+	// Returns the changes needed to go from this snapshot to the other snapshot. Removals are
+	// returned first, followed by additions and modifications. Within each group, the items are
+	// sorted by name. Renamed items are reported as a removal and an addition.
+	std::vector<DirectoryChange> Compare(const DirectorySnapshot &other) const;
+
+	size_t GetNumItems() const;
+
+private:
+	struct Item
+	{
+		std::wstring name;
+		std::optional<WIN32_FILE_ATTRIBUTE_DATA> details;
+	};
+
+	static bool AreDetailsEqual(const std::optional<WIN32_FILE_ATTRIBUTE_DATA> &details1,
+		const std::optional<WIN32_FILE_ATTRIBUTE_DATA> &details2);
+
+	// Filenames are case-insensitive, so the items are keyed by their case-folded names.
+	std::unordered_map<std::wstring, Item> m_items;
+};
@@ -11,7 +11,10 @@
 #include "ShellHelper.h"
 #include "StringHelper.h"
 #include <wil/com.h>
+#include <wil/resource.h>
 #include <list>
+#include <memory>
+#include <random>
 #include <sstream>
 
 enum class PasteType
@@ -19,8 +22,19 @@ enum class PasteType
 	HardLink
 };
 
+// Secure overwrites are performed in blocks of this size. The block size needs to be a multiple of
+// the volume sector size, since files are overwritten using unbuffered I/O.
+const DWORD SECURE_DELETE_BLOCK_SIZE = 1024 * 1024;
+const size_t SECURE_DELETE_BUFFER_ALIGNMENT = 4096;
+
 int PasteFilesFromClipboardSpecial(const TCHAR *szDestination, PasteType pasteType);
 BOOL GetFileClusterSize(const std::wstring &strFilename, PLARGE_INTEGER lpRealFileSize);
+std::vector<NFileOperations::OverwritePattern> GetOverwritePassPatterns(
+	NFileOperations::OverwriteMethod overwriteMethod);
+HRESULT OverwriteFileContents(HANDLE hFile, ULONGLONG fileSize,
+	NFileOperations::OverwriteMethod overwriteMethod,
+	const NFileOperations::SecureDeleteProgressCallback &progressCallback);
+void FillBufferWithRandomData(BYTE *buffer, DWORD size, std::mt19937_64 &randomEngine);
 
 HRESULT NFileOperations::RenameFile(IShellItem *item, const std::wstring &newName)
 {
@@ -633,95 +647,213 @@ BOOL GetFileClusterSize(const std::wstring &strFilename, PLARGE_INTEGER lpRealFi
 	return TRUE;
 }
 
-void NFileOperations::DeleteFileSecurely(const std::wstring &strFilename,
+ULONGLONG NFileOperations::GetSecureDeleteSize(const std::wstring &strFilename,
 	OverwriteMethod overwriteMethod)
 {
-	HANDLE hFile;
-	WIN32_FIND_DATA wfd;
-	HANDLE hFindFile;
-	HCRYPTPROV hProv;
 	LARGE_INTEGER lRealFileSize;
-	BYTE pass1Data;
-	BYTE pass2Data;
-	BYTE pass3Data;
-	DWORD nBytesWritten;
-	BOOL bFolder;
-	int i = 0;
+	BOOL bRet = GetFileClusterSize(strFilename, &lRealFileSize);
+
+	if (!bRet)
+	{
+		return 0;
+	}
 
-	hFindFile = FindFirstFile(strFilename.c_str(), &wfd);
+	return lRealFileSize.QuadPart * GetOverwritePassPatterns(overwriteMethod).size();
+}
+
+HRESULT NFileOperations::DeleteFileSecurely(const std::wstring &strFilename,
+	OverwriteMethod overwriteMethod, SecureDeleteProgressCallback progressCallback)
+{
+	WIN32_FIND_DATA wfd;
+	HANDLE hFindFile = FindFirstFile(strFilename.c_str(), &wfd);
 
 	if (hFindFile == INVALID_HANDLE_VALUE)
 	{
-		return;
+		return HRESULT_FROM_WIN32(GetLastError());
 	}
 
-	bFolder = (wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == FILE_ATTRIBUTE_DIRECTORY;
-
 	FindClose(hFindFile);
 
-	if (bFolder)
+	if (WI_IsFlagSet(wfd.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
 	{
-		return;
+		return E_INVALIDARG;
 	}
 
 	/* Determine the actual size of the file on disk
 	(i.e. how many clusters it is allocated). */
-	GetFileClusterSize(strFilename, &lRealFileSize);
+	LARGE_INTEGER lRealFileSize;
+	BOOL bRet = GetFileClusterSize(strFilename, &lRealFileSize);
+
+	if (!bRet)
+	{
+		return E_FAIL;
+	}
 
 	/* Open the file, block any sharing mode, to stop the file
-	been opened while it is overwritten. */
-	hFile =
-		CreateFile(strFilename.c_str(), FILE_WRITE_DATA, 0, nullptr, OPEN_EXISTING, NULL, nullptr);
+	been opened while it is overwritten. The data is written
+	directly to disk, bypassing the system cache, since
+	there's no benefit to caching data that's never going to
+	be read back. */
+	wil::unique_hfile file(CreateFile(strFilename.c_str(), FILE_WRITE_DATA, 0, nullptr,
+		OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH, nullptr));
 
-	if (hFile == INVALID_HANDLE_VALUE)
+	if (!file)
 	{
-		return;
+		/* Not all volumes (e.g. some network shares) support
+		unbuffered I/O. */
+		file.reset(CreateFile(strFilename.c_str(), FILE_WRITE_DATA, 0, nullptr, OPEN_EXISTING,
+			FILE_FLAG_WRITE_THROUGH, nullptr));
+	}
+
+	if (!file)
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
 	}
 
 	/* Extend the file out to the end of its last sector. */
-	SetFilePointerEx(hFile, lRealFileSize, nullptr, FILE_BEGIN);
-	SetEndOfFile(hFile);
+	bRet = SetFilePointerEx(file.get(), lRealFileSize, nullptr, FILE_BEGIN);
+
+	if (!bRet || !SetEndOfFile(file.get()))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	HRESULT hr = OverwriteFileContents(file.get(), lRealFileSize.QuadPart, overwriteMethod,
+		progressCallback);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
 
-	/* Start at the beginning of the file, and
-	write in the first-pass data, 0x00 over
-	the length of the whole file. */
-	SetFilePointer(hFile, 0, nullptr, FILE_BEGIN);
-	pass1Data = 0x00;
+	FlushFileBuffers(file.get());
+	file.reset();
 
-	for (i = 0; i < lRealFileSize.QuadPart; i++)
+	if (!DeleteFile(strFilename.c_str()))
 	{
-		WriteFile(hFile, (LPVOID) &pass1Data, 1, &nBytesWritten, nullptr);
+		return HRESULT_FROM_WIN32(GetLastError());
 	}
 
-	if (overwriteMethod == OverwriteMethod::ThreePass)
+	return S_OK;
+}
+
+std::vector<NFileOperations::OverwritePattern> GetOverwritePassPatterns(
+	NFileOperations::OverwriteMethod overwriteMethod)
+{
+	switch (overwriteMethod)
 	{
-		/* Start at the beginning of the file, and
-		write in the second-pass data, 0xFF over
-		the length of the whole file. */
-		SetFilePointer(hFile, 0, nullptr, FILE_BEGIN);
-		pass2Data = 0xFF;
+	case NFileOperations::OverwriteMethod::ThreePass:
+		return { NFileOperations::OverwritePattern::Zeros, NFileOperations::OverwritePattern::Ones,
+			NFileOperations::OverwritePattern::Random };
+
+	case NFileOperations::OverwriteMethod::OnePass:
+	default:
+		return { NFileOperations::OverwritePattern::Zeros };
+	}
+}
 
-		for (i = 0; i < lRealFileSize.QuadPart; i++)
+// Overwrites the first fileSize bytes of the file, once for each of the passes used by the
+// specified overwrite method. fileSize must be a multiple of the volume sector size, since the file
+// may have been opened for unbuffered I/O.
+HRESULT OverwriteFileContents(HANDLE hFile, ULONGLONG fileSize,
+	NFileOperations::OverwriteMethod overwriteMethod,
+	const NFileOperations::SecureDeleteProgressCallback &progressCallback)
+{
+	/* Unbuffered I/O requires that the buffer be aligned
+	on a sector boundary. Aligning on a page boundary
+	satisfies that requirement for any sector size. */
+	auto *rawBuffer = static_cast<BYTE *>(
+		_aligned_malloc(SECURE_DELETE_BLOCK_SIZE, SECURE_DELETE_BUFFER_ALIGNMENT));
+	std::unique_ptr<BYTE, decltype(&_aligned_free)> buffer(rawBuffer, &_aligned_free);
+
+	if (!buffer)
+	{
+		return E_OUTOFMEMORY;
+	}
+
+	auto passPatterns = GetOverwritePassPatterns(overwriteMethod);
+	ULONGLONG totalBytes = fileSize * passPatterns.size();
+	ULONGLONG totalBytesWritten = 0;
+
+	/* The random pass only needs to produce data that
+	doesn't resemble what was there previously, so a fast
+	pseudo-random generator (seeded from the system's
+	random number generator) is sufficient. Filling the
+	buffer a word at a time is substantially faster than
+	retrieving individual random bytes. */
+	std::random_device randomDevice;
+	std::mt19937_64 randomEngine(
+		(static_cast<ULONGLONG>(randomDevice()) << 32) | randomDevice());
+
+	for (auto pattern : passPatterns)
+	{
+		if (pattern == NFileOperations::OverwritePattern::Zeros)
 		{
-			WriteFile(hFile, (LPVOID) &pass2Data, 1, &nBytesWritten, nullptr);
+			memset(buffer.get(), 0x00, SECURE_DELETE_BLOCK_SIZE);
+		}
+		else if (pattern == NFileOperations::OverwritePattern::Ones)
+		{
+			memset(buffer.get(), 0xFF, SECURE_DELETE_BLOCK_SIZE);
 		}
 
-		SetFilePointer(hFile, 0, nullptr, FILE_BEGIN);
-
-		CryptAcquireContext(&hProv, _T("SecureDelete"), nullptr, PROV_RSA_AES, CRYPT_NEWKEYSET);
+		LARGE_INTEGER start = {};
 
-		for (i = 0; i < lRealFileSize.QuadPart; i++)
+		if (!SetFilePointerEx(hFile, start, nullptr, FILE_BEGIN))
 		{
-			CryptGenRandom(hProv, 1, (LPBYTE) &pass3Data);
-			WriteFile(hFile, (LPVOID) &pass3Data, 1, &nBytesWritten, nullptr);
+			return HRESULT_FROM_WIN32(GetLastError());
 		}
 
-		CryptAcquireContext(&hProv, _T("SecureDelete"), nullptr, PROV_RSA_AES, CRYPT_DELETEKEYSET);
+		ULONGLONG offset = 0;
+
+		while (offset < fileSize)
+		{
+			auto blockSize = static_cast<DWORD>(
+				(std::min)(fileSize - offset, static_cast<ULONGLONG>(SECURE_DELETE_BLOCK_SIZE)));
+
+			if (pattern == NFileOperations::OverwritePattern::Random)
+			{
+				FillBufferWithRandomData(buffer.get(), blockSize, randomEngine);
+			}
+
+			DWORD numBytesWritten;
+			BOOL res = WriteFile(hFile, buffer.get(), blockSize, &numBytesWritten, nullptr);
+
+			if (!res)
+			{
+				return HRESULT_FROM_WIN32(GetLastError());
+			}
+
+			if (numBytesWritten != blockSize)
+			{
+				return E_FAIL;
+			}
+
+			offset += blockSize;
+			totalBytesWritten += blockSize;
+
+			if (progressCallback && !progressCallback(totalBytesWritten, totalBytes))
+			{
+				return E_ABORT;
+			}
+		}
 	}
 
-	FlushFileBuffers(hFile);
+	return S_OK;
+}
 
-	CloseHandle(hFile);
+void FillBufferWithRandomData(BYTE *buffer, DWORD size, std::mt19937_64 &randomEngine)
+{
+	DWORD offset = 0;
 
-	DeleteFile(strFilename.c_str());
+	for (; offset + sizeof(ULONGLONG) <= size; offset += sizeof(ULONGLONG))
+	{
+		ULONGLONG value = randomEngine();
+		memcpy(buffer + offset, &value, sizeof(value));
+	}
+
+	if (offset < size)
+	{
+		ULONGLONG value = randomEngine();
+		memcpy(buffer + offset, &value, size - offset);
+	}
 }
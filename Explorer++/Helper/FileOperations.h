@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <ShObjIdl.h>
+#include <functional>
 #include <list>
 #include <vector>
 
@@ -15,10 +17,25 @@ namespace NFileOperations
 		ThreePass = 2
 	};
 
+	enum class OverwritePattern
+	{
+		Zeros,
+		Ones,
+		Random
+	};
+
+	// Called after each block is written during a secure delete. bytesWritten and totalBytes cover
+	// all passes. Returning false will cancel the operation, in which case the file will be left in
+	// place (partially overwritten).
+	using SecureDeleteProgressCallback =
+		std::function<bool(ULONGLONG bytesWritten, ULONGLONG totalBytes)>;
+
 	HRESULT RenameFile(IShellItem *item, const std::wstring &newName);
 	HRESULT DeleteFiles(HWND hwnd, std::vector<PCIDLIST_ABSOLUTE> &pidls, bool permanent,
 		bool silent);
-	void DeleteFileSecurely(const std::wstring &strFilename, OverwriteMethod overwriteMethod);
+	HRESULT DeleteFileSecurely(const std::wstring &strFilename, OverwriteMethod overwriteMethod,
+		SecureDeleteProgressCallback progressCallback = nullptr);
+	ULONGLONG GetSecureDeleteSize(const std::wstring &strFilename, OverwriteMethod overwriteMethod);
 	HRESULT CopyFilesToFolder(HWND hOwner, const std::wstring &strTitle,
 		std::vector<PCIDLIST_ABSOLUTE> &pidls, bool move);
 	HRESULT CopyFiles(HWND hwnd, IShellItem *destinationFolder,
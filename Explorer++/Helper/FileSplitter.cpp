@@ -0,0 +1,162 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FileSplitter.h"
+#include <algorithm>
+
+FileSplitter::FileSplitter(const std::wstring &inputFilePath, ULONGLONG splitSize,
+	OutputPathGenerator outputPathGenerator, DWORD chunkSize) :
+	m_inputFilePath(inputFilePath),
+	m_splitSize(splitSize),
+	m_outputPathGenerator(outputPathGenerator),
+	m_chunkSize(chunkSize)
+{
+	assert(m_splitSize > 0);
+}
+
+HRESULT FileSplitter::Split(ProgressCallback progressCallback,
+	std::chrono::milliseconds progressInterval)
+{
+	SequentialFileReader reader({ m_inputFilePath }, m_chunkSize);
+	HRESULT hr = reader.Open();
+
+	if (FAILED(hr))
+	{
+		m_failedPath = m_inputFilePath;
+		return hr;
+	}
+
+	ULONGLONG totalSize = reader.GetTotalSize();
+	ULONGLONG totalBytesWritten = 0;
+
+	wil::unique_hfile outputFile;
+	ULONGLONG remainingInPart = 0;
+
+	auto lastProgressTime = std::chrono::steady_clock::now();
+
+	while (true)
+	{
+		if (m_cancelled)
+		{
+			return E_ABORT;
+		}
+
+		const BYTE *data;
+		DWORD size;
+		hr = reader.ReadNextChunk(&data, &size);
+
+		if (FAILED(hr))
+		{
+			m_failedPath = m_inputFilePath;
+			return hr;
+		}
+
+		if (size == 0)
+		{
+			break;
+		}
+
+		// A chunk can span the boundary between two (or, if the split size is smaller than the
+		// chunk size, several) parts.
+		while (size > 0)
+		{
+			if (remainingInPart == 0)
+			{
+				RETURN_IF_FAILED(StartNextPart(outputFile, totalSize - totalBytesWritten));
+				remainingInPart = m_splitSize;
+			}
+
+			auto writeSize =
+				static_cast<DWORD>((std::min)(static_cast<ULONGLONG>(size), remainingInPart));
+			RETURN_IF_FAILED(WriteToPart(outputFile.get(), data, writeSize));
+
+			data += writeSize;
+			size -= writeSize;
+			remainingInPart -= writeSize;
+			totalBytesWritten += writeSize;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+
+		// Reporting progress after every chunk could flood the receiver (e.g. a dialog) with
+		// updates, so progress is only reported once each interval.
+		if (progressCallback && (now - lastProgressTime) >= progressInterval)
+		{
+			progressCallback(totalBytesWritten, totalSize);
+			lastProgressTime = now;
+		}
+	}
+
+	if (progressCallback)
+	{
+		progressCallback(totalBytesWritten, totalSize);
+	}
+
+	return S_OK;
+}
+
+HRESULT FileSplitter::StartNextPart(wil::unique_hfile &outputFile, ULONGLONG remainingBytes)
+{
+	outputFile.reset();
+
+	m_currentOutputPath = m_outputPathGenerator(m_numPartsWritten + 1);
+
+	outputFile.reset(CreateFile(m_currentOutputPath.c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_NEW, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+	if (!outputFile)
+	{
+		HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+		m_failedPath = m_currentOutputPath;
+		return hr;
+	}
+
+	m_numPartsWritten++;
+
+	// Allocating the space for the part up front allows it to be laid out contiguously on disk.
+	// This is only a hint, so it doesn't matter if it fails.
+	FILE_ALLOCATION_INFO allocationInfo;
+	allocationInfo.AllocationSize.QuadPart = (std::min)(m_splitSize, remainingBytes);
+	SetFileInformationByHandle(outputFile.get(), FileAllocationInfo, &allocationInfo,
+		sizeof(allocationInfo));
+
+	return S_OK;
+}
+
+HRESULT FileSplitter::WriteToPart(HANDLE outputFile, const BYTE *data, DWORD size)
+{
+	DWORD numBytesWritten;
+	BOOL res = WriteFile(outputFile, data, size, &numBytesWritten, nullptr);
+
+	if (!res)
+	{
+		HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
+		m_failedPath = m_currentOutputPath;
+		return hr;
+	}
+
+	if (numBytesWritten != size)
+	{
+		m_failedPath = m_currentOutputPath;
+		return E_FAIL;
+	}
+
+	return S_OK;
+}
+
+void FileSplitter::Cancel()
+{
+	m_cancelled = true;
+}
+
+int FileSplitter::GetNumPartsWritten() const
+{
+	return m_numPartsWritten;
+}
+
+const std::wstring &FileSplitter::GetFailedPath() const
+{
+	return m_failedPath;
+}
@@ -0,0 +1,59 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "SequentialFileReader.h"
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+
+// Splits a file into a series of parts, each of which (other than the last) is exactly splitSize
+// bytes. The input is streamed through a fixed pair of buffers (see SequentialFileReader), so the
+// amount of memory used doesn't depend on the split size and the next chunk of the input is read
+// while the current chunk is being written out.
+//
+// This class has no dependency on any UI. Split() is expected to be called from a background
+// thread, with Cancel() called from any other thread.
+class FileSplitter
+{
+public:
+	// Returns the full path of the output file for the specified part. Parts are numbered from 1.
+	using OutputPathGenerator = std::function<std::wstring(int partNumber)>;
+
+	// Called periodically (and once more when the split finishes) with the number of bytes that
+	// have been written so far.
+	using ProgressCallback = std::function<void(ULONGLONG bytesWritten, ULONGLONG totalBytes)>;
+
+	static constexpr std::chrono::milliseconds DEFAULT_PROGRESS_INTERVAL{ 100 };
+
+	FileSplitter(const std::wstring &inputFilePath, ULONGLONG splitSize,
+		OutputPathGenerator outputPathGenerator,
+		DWORD chunkSize = SequentialFileReader::DEFAULT_CHUNK_SIZE);
+
+	// Returns S_OK if the split completed, or E_ABORT if it was cancelled. If the input file, or
+	// one of the output files, couldn't be opened or written to, its path can be retrieved from
+	// GetFailedPath(). Any parts that have already been written are left in place.
+	HRESULT Split(ProgressCallback progressCallback = nullptr,
+		std::chrono::milliseconds progressInterval = DEFAULT_PROGRESS_INTERVAL);
+	void Cancel();
+
+	int GetNumPartsWritten() const;
+	const std::wstring &GetFailedPath() const;
+
+private:
+	HRESULT StartNextPart(wil::unique_hfile &outputFile, ULONGLONG remainingBytes);
+	HRESULT WriteToPart(HANDLE outputFile, const BYTE *data, DWORD size);
+
+	const std::wstring m_inputFilePath;
+	const ULONGLONG m_splitSize;
+	const OutputPathGenerator m_outputPathGenerator;
+	const DWORD m_chunkSize;
+
+	std::atomic_bool m_cancelled = false;
+	int m_numPartsWritten = 0;
+	std::wstring m_currentOutputPath;
+	std::wstring m_failedPath;
+};
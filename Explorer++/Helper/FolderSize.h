@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <windows.h>
+#include <cstdint>
+#include <string>
+
 struct FolderInfo
 {
 	std::uintmax_t size;
@@ -11,8 +15,6 @@ struct FolderInfo
 	int numFiles;
 };
 
-FolderInfo GetFolderInfo(const std::wstring &path);
-
 typedef struct
 {
 	TCHAR szPath[MAX_PATH];
@@ -0,0 +1,402 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "FolderSizeCache.h"
+#include "ParallelDirectoryWalker.h"
+#include "StringHelper.h"
+#include "WorkerPool.h"
+#include <wil/common.h>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+FolderSizeCache &FolderSizeCache::GetInstance()
+{
+	static FolderSizeCache folderSizeCache(
+		std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, MAX_SCAN_THREADS),
+		DEFAULT_MAX_FOLDERS, &WorkerPool::GetInstance());
+	return folderSizeCache;
+}
+
+FolderSizeCache::FolderSizeCache(int numThreads, size_t maxFolders, WorkerPool *workerPool) :
+	m_numThreads((std::max)(numThreads, 1)),
+	m_maxFolders((std::max)(maxFolders, size_t{ 1 })),
+	m_workerPool(workerPool)
+{
+}
+
+FolderInfo FolderSizeCache::GetFolderInfo(const std::wstring &path, std::stop_token stopToken)
+{
+	std::wstring rootKey = GetKey(path);
+	std::list<ActiveScan>::iterator activeScan;
+
+	{
+		std::unique_lock lock(m_mutex);
+
+		auto itr = m_folderInfo.find(rootKey);
+
+		if (itr != m_folderInfo.end())
+		{
+			MarkUsed(itr);
+			return itr->second.folderInfo;
+		}
+
+		activeScan = m_activeScans.insert(m_activeScans.end(), { rootKey, !m_changesMonitored });
+		UpdateInUse();
+	}
+
+	auto totals = ScanFolder(path, stopToken);
+
+	FolderInfo rootFolderInfo = {};
+	auto rootItr = totals.find(rootKey);
+
+	if (rootItr != totals.end())
+	{
+		rootFolderInfo = rootItr->second;
+	}
+
+	std::unique_lock lock(m_mutex);
+
+	if (!activeScan->invalidated && !stopToken.stop_requested())
+	{
+		for (auto &[key, folderInfo] : totals)
+		{
+			if (key != rootKey)
+			{
+				AddCachedFolder(key, folderInfo);
+			}
+		}
+
+		// The folder that was requested is added last, so that it's the last to be discarded.
+		if (rootItr != totals.end())
+		{
+			AddCachedFolder(rootKey, rootFolderInfo);
+		}
+	}
+
+	m_activeScans.erase(activeScan);
+	UpdateInUse();
+
+	return rootFolderInfo;
+}
+
+// Each directory in the tree is enumerated once (unless it's already cached), with the size and
+// number of items directly within it being recorded. Once the walk has finished, the totals are
+// propagated upwards, from the deepest directories to the root, so that the total for every
+// directory in the tree is known and can be cached.
+std::unordered_map<std::wstring, FolderInfo> FolderSizeCache::ScanFolder(
+	const std::wstring &path, std::stop_token stopToken) const
+{
+	struct ThreadState
+	{
+		// Keyed by the directory path, exactly as passed by the walker.
+		std::unordered_map<std::wstring, FolderInfo> directories;
+
+		// The directory currently being enumerated by the thread. Items within a directory are
+		// always reported consecutively, by the thread enumerating that directory.
+		FolderInfo *currentDirectory = nullptr;
+	};
+
+	std::vector<ThreadState> threadStates(m_numThreads);
+
+	ParallelDirectoryWalker walker(m_numThreads, true, m_workerPool);
+
+	// Subdirectories that are already cached aren't enumerated again. Their cached totals are
+	// added to the parent directory instead.
+	walker.SetSubdirectoryFilter(
+		[this, &threadStates](int threadIndex, const std::wstring &directory,
+			const WIN32_FIND_DATA &findData)
+		{
+			std::wstring subdirectoryKey =
+				GetKey(directory) + L"\\" + GetKey(findData.cFileName);
+
+			std::shared_lock lock(m_mutex);
+			auto itr = m_folderInfo.find(subdirectoryKey);
+
+			if (itr == m_folderInfo.end())
+			{
+				return true;
+			}
+
+			auto *currentDirectory = threadStates[threadIndex].currentDirectory;
+			const auto &folderInfo = itr->second.folderInfo;
+			currentDirectory->size += folderInfo.size;
+			currentDirectory->numFolders += folderInfo.numFolders;
+			currentDirectory->numFiles += folderInfo.numFiles;
+
+			return false;
+		});
+
+	std::stop_callback stopCallback(stopToken,
+		[&walker]()
+		{
+			walker.Cancel();
+		});
+
+	walker.Walk(
+		path,
+		[&threadStates](int threadIndex, const std::wstring &directory)
+		{
+			auto &threadState = threadStates[threadIndex];
+			threadState.currentDirectory = &threadState.directories[directory];
+		},
+		[&threadStates](int threadIndex, const std::wstring &directory,
+			const WIN32_FIND_DATA &findData)
+		{
+			UNREFERENCED_PARAMETER(directory);
+
+			auto *currentDirectory = threadStates[threadIndex].currentDirectory;
+
+			if (WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY))
+			{
+				currentDirectory->numFolders++;
+			}
+			else
+			{
+				currentDirectory->size +=
+					ULARGE_INTEGER{ findData.nFileSizeLow, findData.nFileSizeHigh }.QuadPart;
+				currentDirectory->numFiles++;
+			}
+		});
+
+	std::unordered_map<std::wstring, FolderInfo> totals;
+
+	for (const auto &threadState : threadStates)
+	{
+		for (const auto &[directory, folderInfo] : threadState.directories)
+		{
+			totals.insert({ GetKey(directory), folderInfo });
+		}
+	}
+
+	std::vector<std::pair<size_t, std::wstring>> keysByDepth;
+	keysByDepth.reserve(totals.size());
+
+	for (const auto &[key, folderInfo] : totals)
+	{
+		keysByDepth.emplace_back(std::count(key.begin(), key.end(), '\\'), key);
+	}
+
+	std::sort(keysByDepth.begin(), keysByDepth.end(),
+		[](const auto &entry1, const auto &entry2)
+		{
+			return entry1.first > entry2.first;
+		});
+
+	// The root directory is the shallowest directory, so it will never be updated here. Its parent
+	// also won't be found, since the parent isn't part of the walk.
+	for (const auto &[depth, key] : keysByDepth)
+	{
+		auto parentKey = GetParentKey(key);
+
+		if (!parentKey)
+		{
+			continue;
+		}
+
+		auto parentItr = totals.find(*parentKey);
+
+		if (parentItr == totals.end())
+		{
+			continue;
+		}
+
+		const auto &folderInfo = totals.at(key);
+		parentItr->second.size += folderInfo.size;
+		parentItr->second.numFolders += folderInfo.numFolders;
+		parentItr->second.numFiles += folderInfo.numFiles;
+	}
+
+	return totals;
+}
+
+std::optional<FolderInfo> FolderSizeCache::GetCachedFolderInfo(const std::wstring &path)
+{
+	std::wstring key = GetKey(path);
+
+	std::unique_lock lock(m_mutex);
+	auto itr = m_folderInfo.find(key);
+
+	if (itr == m_folderInfo.end())
+	{
+		return std::nullopt;
+	}
+
+	MarkUsed(itr);
+
+	return itr->second.folderInfo;
+}
+
+void FolderSizeCache::AddCachedFolder(const std::wstring &key, const FolderInfo &folderInfo)
+{
+	auto itr = m_folderInfo.find(key);
+
+	if (itr != m_folderInfo.end())
+	{
+		itr->second.folderInfo = folderInfo;
+		MarkUsed(itr);
+		return;
+	}
+
+	m_recentlyUsedKeys.push_front(key);
+	m_folderInfo.insert({ key, { folderInfo, m_recentlyUsedKeys.begin() } });
+
+	while (m_folderInfo.size() > m_maxFolders)
+	{
+		EraseCachedFolder(m_folderInfo.find(m_recentlyUsedKeys.back()));
+	}
+}
+
+void FolderSizeCache::MarkUsed(CachedFolderMap::iterator itr)
+{
+	m_recentlyUsedKeys.splice(m_recentlyUsedKeys.begin(), m_recentlyUsedKeys,
+		itr->second.recentlyUsedItr);
+}
+
+FolderSizeCache::CachedFolderMap::iterator FolderSizeCache::EraseCachedFolder(
+	CachedFolderMap::iterator itr)
+{
+	m_recentlyUsedKeys.erase(itr->second.recentlyUsedItr);
+	return m_folderInfo.erase(itr);
+}
+
+void FolderSizeCache::InvalidatePath(const std::wstring &path, bool includeDescendants)
+{
+	std::wstring key = GetKey(path);
+
+	std::unique_lock lock(m_mutex);
+
+	for (auto &activeScan : m_activeScans)
+	{
+		if (IsSameOrDescendant(key, activeScan.rootKey))
+		{
+			activeScan.invalidated = true;
+		}
+	}
+
+	if (includeDescendants)
+	{
+		std::wstring prefix = key + L"\\";
+		auto itr = m_folderInfo.lower_bound(prefix);
+
+		while (itr != m_folderInfo.end() && itr->first.compare(0, prefix.size(), prefix) == 0)
+		{
+			itr = EraseCachedFolder(itr);
+		}
+	}
+
+	std::optional<std::wstring> currentKey = key;
+
+	while (currentKey)
+	{
+		auto itr = m_folderInfo.find(*currentKey);
+
+		if (itr != m_folderInfo.end())
+		{
+			EraseCachedFolder(itr);
+		}
+
+		currentKey = GetParentKey(*currentKey);
+	}
+
+	UpdateInUse();
+}
+
+void FolderSizeCache::Clear()
+{
+	std::unique_lock lock(m_mutex);
+
+	m_folderInfo.clear();
+	m_recentlyUsedKeys.clear();
+
+	for (auto &activeScan : m_activeScans)
+	{
+		activeScan.invalidated = true;
+	}
+
+	UpdateInUse();
+}
+
+size_t FolderSizeCache::GetNumCachedFolders() const
+{
+	std::shared_lock lock(m_mutex);
+	return m_folderInfo.size();
+}
+
+void FolderSizeCache::SetInUseCallback(InUseCallback callback)
+{
+	std::unique_lock lock(m_mutex);
+	m_inUseCallback = callback;
+}
+
+bool FolderSizeCache::IsInUse() const
+{
+	std::shared_lock lock(m_mutex);
+	return m_inUse;
+}
+
+void FolderSizeCache::SetChangesMonitored(bool monitored)
+{
+	std::unique_lock lock(m_mutex);
+	m_changesMonitored = monitored;
+}
+
+// Folders are only ever added while a scan is active, so it's enough to check this whenever a scan
+// starts or finishes, or folders are removed.
+void FolderSizeCache::UpdateInUse()
+{
+	bool inUse = !m_folderInfo.empty() || !m_activeScans.empty();
+
+	if (inUse == m_inUse)
+	{
+		return;
+	}
+
+	m_inUse = inUse;
+
+	if (m_inUseCallback)
+	{
+		m_inUseCallback(inUse);
+	}
+}
+
+// Paths are case-insensitive, so they're folded before being used as a key. Any trailing
+// backslash is also removed, so that "C:\" and "C:" (for example) map to the same entry and the
+// parent of each key can be found by removing the last component.
+std::wstring FolderSizeCache::GetKey(const std::wstring &path)
+{
+	std::wstring key = path;
+
+	while (!key.empty() && key.back() == '\\')
+	{
+		key.pop_back();
+	}
+
+	return FoldStringCase(key);
+}
+
+std::optional<std::wstring> FolderSizeCache::GetParentKey(const std::wstring &key)
+{
+	auto index = key.find_last_of('\\');
+
+	if (index == std::wstring::npos || index == 0)
+	{
+		return std::nullopt;
+	}
+
+	return key.substr(0, index);
+}
+
+bool FolderSizeCache::IsSameOrDescendant(const std::wstring &key, const std::wstring &ancestorKey)
+{
+	if (key.size() < ancestorKey.size() || key.compare(0, ancestorKey.size(), ancestorKey) != 0)
+	{
+		return false;
+	}
+
+	return key.size() == ancestorKey.size() || key[ancestorKey.size()] == '\\';
+}
@@ -0,0 +1,138 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "FolderSize.h"
+#include <functional>
+#include <list>
+#include <map>
+#include <optional>
+#include <shared_mutex>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+
+class WorkerPool;
+
+// Calculates the size of folders and remembers the result for every directory that's scanned,
+// not just the top-level folder that was requested. That means that the size of a folder can be
+// returned immediately if it, or any of its subfolders, has been scanned before.
+//
+// When an item changes, the cached sizes for that item and each of its ancestors are discarded
+// (since the size of each ancestor includes the size of the item). The sizes of unrelated folders
+// remain cached, so rescanning an ancestor only requires the folders along the changed path to be
+// enumerated again.
+//
+// The number of cached folders is limited. Once the limit is reached, the folders that were least
+// recently used are discarded first.
+//
+// Changes only need to be monitored while the cache is in use (i.e. while it holds any folders, or
+// is scanning one). The owner can be told when that changes, so that it doesn't have to monitor
+// changes the rest of the time.
+//
+// All methods can be called from any thread.
+class FolderSizeCache
+{
+public:
+	using InUseCallback = std::function<void(bool inUse)>;
+
+	// The instance used by the application. Column retrieval, sorting and the display window all
+	// share this instance, so that a folder scanned by one of them doesn't need to be scanned again
+	// by another.
+	static FolderSizeCache &GetInstance();
+
+	static constexpr size_t DEFAULT_MAX_FOLDERS = 50000;
+
+	// If a WorkerPool is provided, scans are run on it, rather than on threads created for each
+	// scan.
+	explicit FolderSizeCache(int numThreads, size_t maxFolders = DEFAULT_MAX_FOLDERS,
+		WorkerPool *workerPool = nullptr);
+
+	// Returns the size of the specified folder, scanning any parts of the tree that haven't been
+	// cached yet. This can take a significant amount of time, so shouldn't be called from the UI
+	// thread. If a stop is requested while the folder is being scanned, the scan will end early.
+	// In that case, the size returned will be incomplete and won't be cached.
+	FolderInfo GetFolderInfo(const std::wstring &path, std::stop_token stopToken = {});
+
+	// Returns the size of the specified folder only if it's already cached. This never touches the
+	// disk, so is suitable for use from the UI thread (e.g. while sorting).
+	std::optional<FolderInfo> GetCachedFolderInfo(const std::wstring &path);
+
+	// Should be called whenever an item is created, deleted or modified. The cached size of the
+	// item (if it's a folder) and each of its ancestors will be discarded. If includeDescendants is
+	// true, the cached sizes of any folders within the item will also be discarded. That's needed
+	// when a folder is removed or renamed, since the paths within it are no longer valid.
+	void InvalidatePath(const std::wstring &path, bool includeDescendants = false);
+
+	void Clear();
+
+	size_t GetNumCachedFolders() const;
+
+	// The callback is invoked whenever the cache starts or stops being in use. It can be invoked on
+	// any thread and is invoked while the cache is locked, so it shouldn't call back into the
+	// cache.
+	void SetInUseCallback(InUseCallback callback);
+	bool IsInUse() const;
+
+	// A scan that starts while changes aren't being monitored still returns a result, but the
+	// result isn't cached, since a change made during the scan could be missed. Changes are assumed
+	// to be monitored unless this is called.
+	void SetChangesMonitored(bool monitored);
+
+private:
+	// Tracks a scan that's in progress. If a path within the tree being scanned is invalidated
+	// before the scan finishes, the results may be out of date and won't be cached.
+	struct ActiveScan
+	{
+		std::wstring rootKey;
+		bool invalidated = false;
+	};
+
+	struct CachedFolder
+	{
+		FolderInfo folderInfo;
+
+		// The folder's position in m_recentlyUsedKeys.
+		std::list<std::wstring>::iterator recentlyUsedItr;
+	};
+
+	using CachedFolderMap = std::map<std::wstring, CachedFolder>;
+
+	static const int MAX_SCAN_THREADS = 4;
+
+	static std::wstring GetKey(const std::wstring &path);
+	static std::optional<std::wstring> GetParentKey(const std::wstring &key);
+	static bool IsSameOrDescendant(const std::wstring &key, const std::wstring &ancestorKey);
+
+	// Returns the total size of each directory in the tree that was enumerated, keyed in the same
+	// way as m_folderInfo.
+	std::unordered_map<std::wstring, FolderInfo> ScanFolder(const std::wstring &path,
+		std::stop_token stopToken) const;
+
+	// These methods should only be called while an exclusive lock is held.
+	void AddCachedFolder(const std::wstring &key, const FolderInfo &folderInfo);
+	void MarkUsed(CachedFolderMap::iterator itr);
+	CachedFolderMap::iterator EraseCachedFolder(CachedFolderMap::iterator itr);
+	void UpdateInUse();
+
+	const int m_numThreads;
+	const size_t m_maxFolders;
+	WorkerPool *const m_workerPool;
+
+	mutable std::shared_mutex m_mutex;
+
+	// Keyed by the case-folded path of each folder (without a trailing backslash). The keys are
+	// ordered, so that all the descendants of a folder are stored contiguously.
+	CachedFolderMap m_folderInfo;
+
+	// The most recently used folder is at the front.
+	std::list<std::wstring> m_recentlyUsedKeys;
+
+	std::list<ActiveScan> m_activeScans;
+
+	InUseCallback m_inUseCallback;
+	bool m_inUse = false;
+	bool m_changesMonitored = true;
+};
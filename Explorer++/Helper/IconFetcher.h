@@ -4,16 +4,14 @@
 
 #pragma once
 
-#include "ShellHelper.h"
-#include "../ThirdParty/CTPL/cpl_stl.h"
+#include "WorkerPool.h"
 #include <ShlObj.h>
 #include <functional>
-#include <future>
 #include <optional>
-#include <unordered_map>
+#include <string>
+#include <string_view>
 
-class CachedIcons;
-class WindowSubclassWrapper;
+class IconService;
 
 class IconFetcherInterface
 {
@@ -25,62 +23,29 @@ public:
 	virtual void ClearQueue() = 0;
 };
 
+// Retrieves icons through the shared IconService on behalf of a single component. Each instance
+// can clear its own requests, without affecting the requests made by other components. Once an
+// instance has been destroyed, none of its callbacks will be invoked.
 class IconFetcher : public IconFetcherInterface
 {
 public:
-	IconFetcher(HWND hwnd, CachedIcons *cachedIcons);
-	virtual ~IconFetcher();
+	IconFetcher(IconService *iconService,
+		WorkerPool::Priority priority = WorkerPool::Priority::Interactive);
+	~IconFetcher();
+
+	IconFetcher(const IconFetcher &) = delete;
+	IconFetcher &operator=(const IconFetcher &) = delete;
 
 	void QueueIconTask(std::wstring_view path, Callback callback) override;
 	void QueueIconTask(PCIDLIST_ABSOLUTE pidl, Callback callback) override;
 	void ClearQueue() override;
 
-private:
-	static const UINT_PTR SUBCLASS_ID = 0;
-
-	// This is the end of the range that starts at WM_APP. This class subclasses the window that's
-	// passed to the constructor, so it's not possible to tell what other WM_APP messages are in
-	// use. To try to avoid clashes with other messages sent throughout the application, the last
-	// value in the range will be used.
-	static const UINT WM_APP_ICON_RESULT_READY = 0xBFFF;
-
-	struct BasicItemInfo
-	{
-		BasicItemInfo() = default;
-
-		BasicItemInfo(const BasicItemInfo &other)
-		{
-			pidl.reset(ILCloneFull(other.pidl.get()));
-		}
-
-		unique_pidl_absolute pidl;
-	};
+	std::optional<int> GetCachedIconIndex(const std::wstring &path);
 
-	struct IconResult
-	{
-		int iconIndex;
-		std::wstring path;
-	};
+	void SetPriority(WorkerPool::Priority priority);
 
-	struct FutureResult
-	{
-		Callback callback;
-		std::future<std::optional<IconResult>> iconResult;
-	};
-
-	static LRESULT CALLBACK WindowSubclassStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
-		UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
-	LRESULT CALLBACK WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
-
-	static std::optional<int> FindIconAsync(PCIDLIST_ABSOLUTE pidl);
-	void ProcessIconResult(int iconResultId);
-
-	const HWND m_hwnd;
-	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
-
-	ctpl::thread_pool m_iconThreadPool;
-	std::unordered_map<int, FutureResult> m_iconResults;
-	int m_iconResultIDCounter;
-	CachedIcons *m_cachedIcons;
-	std::function<void(int data)> m_callback;
+private:
+	IconService *m_iconService;
+	const int m_clientId;
+	WorkerPool::Priority m_priority;
 };
@@ -0,0 +1,544 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "IconService.h"
+#include "CachedIcons.h"
+#include "Logging.h"
+#include "Macros.h"
+#include "StringHelper.h"
+#include "WindowSubclassWrapper.h"
+#include <algorithm>
+#include <wil/common.h>
+#include <wil/resource.h>
+
+IconService::IconService(HWND hwnd, CachedIcons *cachedIcons) :
+	m_hwnd(hwnd),
+	m_cachedIcons(cachedIcons),
+	m_clientIdCounter(0),
+	m_lookupIdCounter(0),
+	m_interactiveTaskGroup(WorkerPool::GetInstance(), WorkerPool::Priority::Interactive),
+	m_backgroundTaskGroup(WorkerPool::GetInstance(), WorkerPool::Priority::Background)
+{
+	m_windowSubclasses.push_back(std::make_unique<WindowSubclassWrapper>(hwnd, WindowSubclassStub,
+		SUBCLASS_ID, reinterpret_cast<DWORD_PTR>(this)));
+}
+
+IconService::~IconService()
+{
+	// Lookups that haven't started yet don't need to run.
+	for (auto &[lookupId, lookup] : m_lookups)
+	{
+		lookup.state->stopSource.request_stop();
+	}
+
+	m_interactiveTaskGroup.Clear();
+	m_backgroundTaskGroup.Clear();
+
+	LOG(debug) << L"Icon service: " << m_stats.requests << L" requests, "
+			   << m_stats.coalescedRequests << L" coalesced, " << m_stats.cacheHits
+			   << L" cache hits, " << m_stats.cacheMisses << L" cache misses, " << m_stats.lookups
+			   << L" lookups, " << m_stats.extensionCacheHits << L" extension cache hits, "
+			   << m_stats.failedLookups << L" failed";
+}
+
+LRESULT CALLBACK IconService::WindowSubclassStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
+	UINT_PTR uIdSubclass, DWORD_PTR dwRefData)
+{
+	UNREFERENCED_PARAMETER(uIdSubclass);
+
+	auto *iconService = reinterpret_cast<IconService *>(dwRefData);
+
+	return iconService->WindowSubclass(hwnd, uMsg, wParam, lParam);
+}
+
+LRESULT CALLBACK IconService::WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+{
+	switch (msg)
+	{
+	case WM_APP_ICON_LOOKUP_COMPLETE:
+		ProcessLookupResult(static_cast<int>(wParam));
+		return 0;
+	}
+
+	return DefSubclassProc(hwnd, msg, wParam, lParam);
+}
+
+int IconService::RegisterClient()
+{
+	int clientId = m_clientIdCounter++;
+	m_clientGenerations.insert({ clientId, 0 });
+	return clientId;
+}
+
+void IconService::UnregisterClient(int clientId)
+{
+	CancelRequests(clientId);
+	m_clientGenerations.erase(clientId);
+}
+
+void IconService::QueueIconTask(int clientId, std::wstring_view path,
+	WorkerPool::Priority priority, Callback callback)
+{
+	QueueIconTaskInternal(clientId, std::wstring(path), nullptr, priority, std::move(callback));
+}
+
+void IconService::QueueIconTask(int clientId, PCIDLIST_ABSOLUTE pidl,
+	WorkerPool::Priority priority, Callback callback)
+{
+	// The path is used to identify the item, so that requests for the same item (which may be
+	// made using either a path or a pidl) can be combined. If the item doesn't have a parsing
+	// path, the icon can still be retrieved, though the lookup won't be shared with any other
+	// requests.
+	std::wstring path;
+	GetDisplayName(pidl, SHGDN_FORPARSING, path);
+
+	QueueIconTaskInternal(clientId, path, unique_pidl_absolute(ILCloneFull(pidl)), priority,
+		std::move(callback));
+}
+
+void IconService::QueueIconTaskInternal(int clientId, const std::wstring &path,
+	unique_pidl_absolute pidl, WorkerPool::Priority priority, Callback callback)
+{
+	auto clientItr = m_clientGenerations.find(clientId);
+
+	if (clientItr == m_clientGenerations.end())
+	{
+		return;
+	}
+
+	m_stats.requests++;
+
+	PendingRequest pendingRequest = { clientId, clientItr->second, priority, std::move(callback) };
+	std::wstring key = FoldStringCase(path);
+
+	if (!key.empty())
+	{
+		auto lookupIdItr = m_lookupIdsByKey.find(key);
+
+		if (lookupIdItr != m_lookupIdsByKey.end())
+		{
+			auto &existingLookup = m_lookups.at(lookupIdItr->second);
+			existingLookup.pendingRequests.push_back(std::move(pendingRequest));
+			m_stats.coalescedRequests++;
+
+			// An interactive request shouldn't have to wait for background work to be completed.
+			UpdateLookupPriority(lookupIdItr->second, existingLookup);
+
+			return;
+		}
+	}
+
+	Lookup lookup;
+	lookup.key = key;
+	lookup.request.pidl = std::move(pidl);
+	lookup.request.path = path;
+	lookup.priority = priority;
+	lookup.state = std::make_shared<LookupState>();
+	lookup.state->priority = priority;
+	lookup.result = lookup.state->promise.get_future();
+	lookup.pendingRequests.push_back(std::move(pendingRequest));
+
+	if (!key.empty())
+	{
+		const TCHAR *extension = PathFindExtension(key.c_str());
+
+		if (*extension != '\0')
+		{
+			lookup.request.extension = extension;
+
+			auto extensionItr = m_extensionIcons.find(lookup.request.extension);
+
+			if (extensionItr != m_extensionIcons.end())
+			{
+				lookup.request.extensionIconIndex = extensionItr->second;
+			}
+			else if (!m_fileSpecificExtensions.contains(lookup.request.extension))
+			{
+				lookup.request.classifyExtension = true;
+			}
+		}
+	}
+
+	int lookupId = m_lookupIdCounter++;
+	auto [lookupItr, inserted] = m_lookups.insert({ lookupId, std::move(lookup) });
+
+	if (!key.empty())
+	{
+		m_lookupIdsByKey.insert({ key, lookupId });
+	}
+
+	PostLookup(lookupId, lookupItr->second);
+}
+
+void IconService::PostLookup(int lookupId, const Lookup &lookup)
+{
+	auto priority = lookup.priority;
+	GetTaskGroup(priority).Post(
+		[hwnd = m_hwnd, lookupId, request = lookup.request, state = lookup.state, priority]()
+		{
+			RunLookup(hwnd, lookupId, request, state, priority);
+		});
+}
+
+// A lookup runs at the highest priority of the requests still waiting on it. If that changes before
+// the lookup has started, it's posted again at the new priority and the existing task is skipped.
+void IconService::UpdateLookupPriority(int lookupId, Lookup &lookup)
+{
+	if (lookup.pendingRequests.empty() || lookup.state->claimed)
+	{
+		return;
+	}
+
+	bool anyInteractive = std::ranges::any_of(lookup.pendingRequests,
+		[](const PendingRequest &pendingRequest)
+		{
+			return pendingRequest.priority == WorkerPool::Priority::Interactive;
+		});
+	auto priority =
+		anyInteractive ? WorkerPool::Priority::Interactive : WorkerPool::Priority::Background;
+
+	if (priority == lookup.priority)
+	{
+		return;
+	}
+
+	lookup.priority = priority;
+	lookup.state->priority = priority;
+	PostLookup(lookupId, lookup);
+}
+
+void IconService::RunLookup(HWND hwnd, int lookupId, const LookupRequest &request,
+	std::shared_ptr<LookupState> state, WorkerPool::Priority postedPriority)
+{
+	if (state->priority != postedPriority)
+	{
+		// The priority of the lookup has changed since this task was posted. The lookup will be
+		// run by the task that was posted at the new priority.
+		return;
+	}
+
+	if (state->claimed.exchange(true))
+	{
+		// The lookup was posted to more than one task group and has already been run.
+		return;
+	}
+
+	state->promise.set_value(PerformLookup(request, state->stopSource.get_token()));
+
+	PostMessage(hwnd, WM_APP_ICON_LOOKUP_COMPLETE, lookupId, 0);
+}
+
+std::optional<IconService::LookupResult> IconService::PerformLookup(const LookupRequest &request,
+	std::stop_token stopToken)
+{
+	if (stopToken.stop_requested())
+	{
+		return std::nullopt;
+	}
+
+	unique_pidl_absolute parsedPidl;
+	PCIDLIST_ABSOLUTE pidl = request.pidl.get();
+
+	if (!pidl)
+	{
+		// SHGetFileInfo will fail for non-filesystem paths that are passed in as strings. For
+		// example, attempting to retrieve the icon for the recycle bin will fail if you pass the
+		// parsing path (i.e. ::{645FF040-5081-101B-9F08-00AA002F954E}). If, however, you pass the
+		// pidl, the function will succeed. Therefore, paths will always be converted to pidls
+		// first here.
+		HRESULT hr = SHParseDisplayName(request.path.c_str(), nullptr,
+			wil::out_param(parsedPidl), 0, nullptr);
+
+		if (FAILED(hr))
+		{
+			return std::nullopt;
+		}
+
+		pidl = parsedPidl.get();
+	}
+
+	if (request.extensionIconIndex && IsFile(request.path))
+	{
+		auto overlayIndex = GetOverlayIndex(pidl);
+
+		if (overlayIndex)
+		{
+			LookupResult result;
+			result.iconIndex = *request.extensionIconIndex | (*overlayIndex << 24);
+			result.usedExtensionIcon = true;
+			return result;
+		}
+	}
+
+	// Must use SHGFI_ICON here, rather than SHGFI_SYSICONINDEX, or else icon overlays won't be
+	// applied.
+	SHFILEINFO shfi;
+	DWORD_PTR res = SHGetFileInfo(reinterpret_cast<LPCTSTR>(pidl), 0, &shfi, sizeof(shfi),
+		SHGFI_PIDL | SHGFI_ICON | SHGFI_OVERLAYINDEX);
+
+	if (res == 0)
+	{
+		return std::nullopt;
+	}
+
+	DestroyIcon(shfi.hIcon);
+
+	LookupResult result;
+	result.iconIndex = shfi.iIcon;
+
+	if (request.classifyExtension && IsFile(request.path))
+	{
+		result.extensionIconIsFileSpecific = IsIconFileSpecific(request.extension);
+	}
+
+	return result;
+}
+
+// Retrieving the overlay for an item is much cheaper than retrieving its icon, since there's no
+// need to resolve the file type or load the icon itself.
+std::optional<int> IconService::GetOverlayIndex(PCIDLIST_ABSOLUTE pidl)
+{
+	wil::com_ptr_nothrow<IShellIconOverlay> shellIconOverlay;
+	PCITEMID_CHILD child;
+	HRESULT hr = SHBindToParent(pidl, IID_PPV_ARGS(&shellIconOverlay), &child);
+
+	if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	int overlayIndex = 0;
+	hr = shellIconOverlay->GetOverlayIndex(child, &overlayIndex);
+
+	if (hr == S_FALSE)
+	{
+		// The item doesn't have an overlay.
+		return 0;
+	}
+	else if (FAILED(hr))
+	{
+		return std::nullopt;
+	}
+
+	return overlayIndex;
+}
+
+bool IconService::IsFile(const std::wstring &path)
+{
+	DWORD attributes = GetFileAttributes(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES
+		&& WI_IsFlagClear(attributes, FILE_ATTRIBUTE_DIRECTORY);
+}
+
+// Some file types (e.g. executables and shortcuts) can have a different icon for each file. That's
+// the case if the icon is extracted from the file itself (in which case the default icon for the
+// type will be "%1"), or if the type has an icon handler.
+bool IconService::IsIconFileSpecific(const std::wstring &extension)
+{
+	TCHAR defaultIcon[MAX_PATH];
+	DWORD size = SIZEOF_ARRAY(defaultIcon);
+	HRESULT hr = AssocQueryString(ASSOCF_NONE, ASSOCSTR_DEFAULTICON, extension.c_str(), nullptr,
+		defaultIcon, &size);
+
+	// If there's no default icon, it's not clear what icon will be used, so it's safest to assume
+	// the icon may be different for each file.
+	if (FAILED(hr) || StrStr(defaultIcon, _T("%1")) != nullptr)
+	{
+		return true;
+	}
+
+	auto hasIconHandler = [](HKEY key)
+	{
+		wil::unique_hkey iconHandlerKey;
+		LSTATUS res =
+			RegOpenKeyEx(key, _T("ShellEx\\IconHandler"), 0, KEY_READ, iconHandlerKey.put());
+		return res == ERROR_SUCCESS;
+	};
+
+	wil::unique_hkey extensionKey;
+	LSTATUS res =
+		RegOpenKeyEx(HKEY_CLASSES_ROOT, extension.c_str(), 0, KEY_READ, extensionKey.put());
+
+	if (res == ERROR_SUCCESS && hasIconHandler(extensionKey.get()))
+	{
+		return true;
+	}
+
+	wil::unique_hkey classKey;
+	hr = AssocQueryKey(ASSOCF_NONE, ASSOCKEY_CLASS, extension.c_str(), nullptr, classKey.put());
+
+	if (SUCCEEDED(hr) && hasIconHandler(classKey.get()))
+	{
+		return true;
+	}
+
+	return false;
+}
+
+void IconService::ProcessLookupResult(int lookupId)
+{
+	auto itr = m_lookups.find(lookupId);
+
+	if (itr == m_lookups.end())
+	{
+		return;
+	}
+
+	// The lookup is removed before any of the callbacks are invoked, since the callbacks may queue
+	// further requests.
+	Lookup lookup = std::move(itr->second);
+	m_lookups.erase(itr);
+
+	auto keyItr = m_lookupIdsByKey.find(lookup.key);
+
+	if (keyItr != m_lookupIdsByKey.end() && keyItr->second == lookupId)
+	{
+		m_lookupIdsByKey.erase(keyItr);
+	}
+
+	auto result = lookup.result.get();
+
+	if (!result)
+	{
+		if (!lookup.state->stopSource.stop_requested())
+		{
+			m_stats.failedLookups++;
+		}
+
+		return;
+	}
+
+	if (result->usedExtensionIcon)
+	{
+		m_stats.extensionCacheHits++;
+	}
+	else
+	{
+		m_stats.lookups++;
+	}
+
+	if (result->extensionIconIsFileSpecific)
+	{
+		if (*result->extensionIconIsFileSpecific)
+		{
+			m_fileSpecificExtensions.insert(lookup.request.extension);
+		}
+		else
+		{
+			m_extensionIcons.insert({ lookup.request.extension, result->iconIndex & 0x00FFFFFF });
+		}
+	}
+
+	if (!lookup.request.path.empty())
+	{
+		m_cachedIcons->addOrUpdateFileIcon(lookup.request.path, result->iconIndex);
+	}
+
+	for (auto &pendingRequest : lookup.pendingRequests)
+	{
+		// A client may have cancelled its requests (or been destroyed) within one of the earlier
+		// callbacks.
+		auto clientItr = m_clientGenerations.find(pendingRequest.clientId);
+
+		if (clientItr == m_clientGenerations.end()
+			|| clientItr->second != pendingRequest.clientGeneration)
+		{
+			continue;
+		}
+
+		pendingRequest.callback(result->iconIndex);
+	}
+}
+
+void IconService::CancelRequests(int clientId)
+{
+	auto clientItr = m_clientGenerations.find(clientId);
+
+	if (clientItr == m_clientGenerations.end())
+	{
+		return;
+	}
+
+	clientItr->second++;
+
+	for (auto &[lookupId, lookup] : m_lookups)
+	{
+		std::erase_if(lookup.pendingRequests,
+			[clientId](const PendingRequest &pendingRequest)
+			{
+				return pendingRequest.clientId == clientId;
+			});
+
+		if (!lookup.pendingRequests.empty())
+		{
+			// The remaining requests may not need the lookup to run as soon.
+			UpdateLookupPriority(lookupId, lookup);
+			continue;
+		}
+
+		// Nothing is waiting for this lookup anymore, so it can stop, if it hasn't started yet.
+		// Any later request for the same item will then start a new lookup.
+		lookup.state->stopSource.request_stop();
+
+		auto keyItr = m_lookupIdsByKey.find(lookup.key);
+
+		if (keyItr != m_lookupIdsByKey.end() && keyItr->second == lookupId)
+		{
+			m_lookupIdsByKey.erase(keyItr);
+		}
+	}
+}
+
+void IconService::SetClientPriority(int clientId, WorkerPool::Priority priority)
+{
+	for (auto &[lookupId, lookup] : m_lookups)
+	{
+		bool updated = false;
+
+		for (auto &pendingRequest : lookup.pendingRequests)
+		{
+			if (pendingRequest.clientId == clientId && pendingRequest.priority != priority)
+			{
+				pendingRequest.priority = priority;
+				updated = true;
+			}
+		}
+
+		if (updated)
+		{
+			UpdateLookupPriority(lookupId, lookup);
+		}
+	}
+}
+
+std::optional<int> IconService::GetCachedIconIndex(const std::wstring &path)
+{
+	auto cachedItr = m_cachedIcons->findByPath(path);
+
+	if (cachedItr == m_cachedIcons->end())
+	{
+		m_stats.cacheMisses++;
+		return std::nullopt;
+	}
+
+	m_stats.cacheHits++;
+
+	return cachedItr->iconIndex;
+}
+
+IconService::Stats IconService::GetStats() const
+{
+	return m_stats;
+}
+
+WorkerPool::TaskGroup &IconService::GetTaskGroup(WorkerPool::Priority priority)
+{
+	if (priority == WorkerPool::Priority::Interactive)
+	{
+		return m_interactiveTaskGroup;
+	}
+
+	return m_backgroundTaskGroup;
+}
@@ -0,0 +1,196 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "ShellHelper.h"
+#include "WorkerPool.h"
+#include <ShlObj.h>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class CachedIcons;
+class WindowSubclassWrapper;
+
+// Retrieves icons on behalf of every part of the application (e.g. the listview in each tab, the
+// treeview, the tabs themselves and bookmarks). Those components frequently need the same icon at
+// the same time (for example, when navigating to a folder, the folder icon is needed by the
+// treeview, the tab and possibly a bookmark). Rather than each component retrieving the icon
+// independently, a request for an icon that's already being retrieved will simply wait for the
+// existing lookup to finish.
+//
+// For file types whose icon doesn't depend on the individual file, the icon is also cached by
+// extension. Once the icon for one file of that type has been retrieved, retrieving the icon for
+// another file of the same type only requires the overlay for that file to be determined.
+//
+// Components don't normally use this class directly. Instead, each component has its own
+// IconFetcher, which allows the requests made by that component to be cancelled as a group.
+class IconService
+{
+public:
+	using Callback = std::function<void(int iconIndex)>;
+
+	struct Stats
+	{
+		ULONGLONG requests = 0;
+		ULONGLONG coalescedRequests = 0;
+		ULONGLONG cacheHits = 0;
+		ULONGLONG cacheMisses = 0;
+		ULONGLONG lookups = 0;
+		ULONGLONG extensionCacheHits = 0;
+		ULONGLONG failedLookups = 0;
+	};
+
+	IconService(HWND hwnd, CachedIcons *cachedIcons);
+	~IconService();
+
+	// Each client is identified by an id, which can be used to cancel all the requests made by
+	// that client. Once a client is unregistered, none of its callbacks will be invoked.
+	int RegisterClient();
+	void UnregisterClient(int clientId);
+
+	void QueueIconTask(int clientId, std::wstring_view path, WorkerPool::Priority priority,
+		Callback callback);
+	void QueueIconTask(int clientId, PCIDLIST_ABSOLUTE pidl, WorkerPool::Priority priority,
+		Callback callback);
+
+	// The callbacks for any requests made by the client won't be invoked. Lookups that were only
+	// needed by this client will stop, if they haven't started yet.
+	void CancelRequests(int clientId);
+
+	// Changes the priority of the requests the client has already made. Lookups that haven't
+	// started yet will run at the new priority, unless they're also needed at a higher priority by
+	// another client.
+	void SetClientPriority(int clientId, WorkerPool::Priority priority);
+
+	std::optional<int> GetCachedIconIndex(const std::wstring &path);
+
+	Stats GetStats() const;
+
+private:
+	static const UINT_PTR SUBCLASS_ID = 0;
+
+	// This is the end of the range that starts at WM_APP. This class subclasses the window that's
+	// passed to the constructor, so it's not possible to tell what other WM_APP messages are in
+	// use. To try to avoid clashes with other messages sent throughout the application, the last
+	// value in the range will be used.
+	static const UINT WM_APP_ICON_LOOKUP_COMPLETE = 0xBFFF;
+
+	struct LookupRequest
+	{
+		LookupRequest() = default;
+
+		LookupRequest(const LookupRequest &other) :
+			path(other.path),
+			extension(other.extension),
+			extensionIconIndex(other.extensionIconIndex),
+			classifyExtension(other.classifyExtension)
+		{
+			pidl.reset(ILCloneFull(other.pidl.get()));
+		}
+
+		// If a pidl isn't provided, the path will be parsed to retrieve one.
+		unique_pidl_absolute pidl;
+		std::wstring path;
+
+		std::wstring extension;
+		std::optional<int> extensionIconIndex;
+		bool classifyExtension = false;
+	};
+
+	struct LookupResult
+	{
+		int iconIndex;
+		bool usedExtensionIcon = false;
+
+		// Set if the extension needed to be classified and the item was a file.
+		std::optional<bool> extensionIconIsFileSpecific;
+	};
+
+	// The same lookup can be posted to more than one task group (if its priority changes while it's
+	// still waiting to run). A task that was posted at a priority other than the current one is
+	// skipped, and whichever of the remaining tasks runs first claims the lookup, so that it only
+	// runs once.
+	struct LookupState
+	{
+		std::atomic<WorkerPool::Priority> priority;
+		std::atomic<bool> claimed = false;
+		std::stop_source stopSource;
+		std::promise<std::optional<LookupResult>> promise;
+	};
+
+	struct PendingRequest
+	{
+		int clientId;
+
+		// Incremented each time a client cancels its requests. A callback is only invoked if the
+		// generation it was queued in is still current.
+		int clientGeneration;
+
+		WorkerPool::Priority priority;
+		Callback callback;
+	};
+
+	struct Lookup
+	{
+		std::wstring key;
+		LookupRequest request;
+		WorkerPool::Priority priority;
+		std::shared_ptr<LookupState> state;
+		std::future<std::optional<LookupResult>> result;
+		std::vector<PendingRequest> pendingRequests;
+	};
+
+	static LRESULT CALLBACK WindowSubclassStub(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam,
+		UINT_PTR uIdSubclass, DWORD_PTR dwRefData);
+	LRESULT CALLBACK WindowSubclass(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
+
+	void QueueIconTaskInternal(int clientId, const std::wstring &path, unique_pidl_absolute pidl,
+		WorkerPool::Priority priority, Callback callback);
+	void PostLookup(int lookupId, const Lookup &lookup);
+	void UpdateLookupPriority(int lookupId, Lookup &lookup);
+	static void RunLookup(HWND hwnd, int lookupId, const LookupRequest &request,
+		std::shared_ptr<LookupState> state, WorkerPool::Priority postedPriority);
+	static std::optional<LookupResult> PerformLookup(const LookupRequest &request,
+		std::stop_token stopToken);
+	static std::optional<int> GetOverlayIndex(PCIDLIST_ABSOLUTE pidl);
+	static bool IsFile(const std::wstring &path);
+	static bool IsIconFileSpecific(const std::wstring &extension);
+	void ProcessLookupResult(int lookupId);
+
+	WorkerPool::TaskGroup &GetTaskGroup(WorkerPool::Priority priority);
+
+	const HWND m_hwnd;
+	std::vector<std::unique_ptr<WindowSubclassWrapper>> m_windowSubclasses;
+	CachedIcons *m_cachedIcons;
+
+	int m_clientIdCounter;
+	std::unordered_map<int, int> m_clientGenerations;
+	int m_lookupIdCounter;
+	std::unordered_map<int, Lookup> m_lookups;
+
+	// Maps the key for each path to the lookup that's currently retrieving the icon for that path.
+	// Paths are case-insensitive, so the keys are case-folded.
+	std::unordered_map<std::wstring, int> m_lookupIdsByKey;
+
+	// The icon (without any overlay) for each extension whose icon isn't specific to each file, as
+	// well as the set of extensions whose icon is specific to each file.
+	std::unordered_map<std::wstring, int> m_extensionIcons;
+	std::unordered_set<std::wstring> m_fileSpecificExtensions;
+
+	Stats m_stats;
+
+	// Declared last, so that any running tasks have finished before the other members are
+	// destroyed.
+	WorkerPool::TaskGroup m_interactiveTaskGroup;
+	WorkerPool::TaskGroup m_backgroundTaskGroup;
+};
@@ -0,0 +1,235 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ParallelDirectoryWalker.h"
+#include "WorkerPool.h"
+#include <wil/resource.h>
+#include <algorithm>
+#include <thread>
+
+ParallelDirectoryWalker::ParallelDirectoryWalker(int numThreads, bool recursive,
+	WorkerPool *workerPool) :
+	m_numThreads((std::max)(numThreads, 1)),
+	m_recursive(recursive),
+	m_workerPool(workerPool)
+{
+	for (int i = 0; i < m_numThreads; i++)
+	{
+		m_workQueues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	m_threadStats.resize(m_numThreads);
+}
+
+void ParallelDirectoryWalker::Walk(const std::wstring &rootDirectory,
+	DirectoryCallback directoryCallback, ItemCallback itemCallback)
+{
+	m_directoryCallback = directoryCallback;
+	m_itemCallback = itemCallback;
+
+	QueueDirectory(0, rootDirectory);
+
+	std::vector<std::thread> threads;
+	std::optional<WorkerPool::TaskGroup> taskGroup;
+
+	if (m_workerPool)
+	{
+		taskGroup.emplace(*m_workerPool, WorkerPool::Priority::Background);
+	}
+
+	for (int i = 1; i < m_numThreads; i++)
+	{
+		if (taskGroup)
+		{
+			taskGroup->Post(std::bind_front(&ParallelDirectoryWalker::WorkerThread, this, i));
+		}
+		else
+		{
+			threads.emplace_back(&ParallelDirectoryWalker::WorkerThread, this, i);
+		}
+	}
+
+	// The calling thread does its share of the work as well, rather than simply waiting.
+	WorkerThread(0);
+
+	// Any tasks that haven't started by this point have nothing left to do. Destroying the group
+	// removes them and waits for the tasks that are still running.
+	taskGroup.reset();
+
+	for (auto &thread : threads)
+	{
+		thread.join();
+	}
+
+	// If the walk was cancelled, there may still be directories that were never enumerated.
+	for (auto &workQueue : m_workQueues)
+	{
+		workQueue->directories.clear();
+	}
+
+	m_numPendingDirectories = 0;
+}
+
+void ParallelDirectoryWalker::SetSubdirectoryFilter(SubdirectoryFilter subdirectoryFilter)
+{
+	m_subdirectoryFilter = subdirectoryFilter;
+}
+
+void ParallelDirectoryWalker::WorkerThread(int threadIndex)
+{
+	int numIdleIterations = 0;
+
+	while (!IsCancelled())
+	{
+		auto directory = GetNextDirectory(threadIndex);
+
+		if (!directory)
+		{
+			if (m_numPendingDirectories.load() == 0)
+			{
+				break;
+			}
+
+			// Other threads are still enumerating directories, so more work may become available.
+			// Initially, this thread will simply yield. If there's still no work after that, it
+			// will sleep, so that it doesn't compete with the threads that are doing useful work.
+			if (numIdleIterations++ < 64)
+			{
+				std::this_thread::yield();
+			}
+			else
+			{
+				Sleep(1);
+			}
+
+			continue;
+		}
+
+		numIdleIterations = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		EnumerateDirectory(threadIndex, *directory);
+		m_threadStats[threadIndex].busyTime += std::chrono::steady_clock::now() - start;
+
+		// This needs to happen after any subdirectories have been queued, so that other threads
+		// won't see the count reach 0 while there's still work left.
+		m_numPendingDirectories--;
+	}
+}
+
+std::optional<std::wstring> ParallelDirectoryWalker::GetNextDirectory(int threadIndex)
+{
+	{
+		auto &ownQueue = *m_workQueues[threadIndex];
+		std::scoped_lock lock(ownQueue.mutex);
+
+		if (!ownQueue.directories.empty())
+		{
+			std::wstring directory = std::move(ownQueue.directories.back());
+			ownQueue.directories.pop_back();
+			return directory;
+		}
+	}
+
+	for (int i = 1; i < m_numThreads; i++)
+	{
+		auto &victimQueue = *m_workQueues[(threadIndex + i) % m_numThreads];
+		std::scoped_lock lock(victimQueue.mutex);
+
+		if (!victimQueue.directories.empty())
+		{
+			std::wstring directory = std::move(victimQueue.directories.front());
+			victimQueue.directories.pop_front();
+			m_threadStats[threadIndex].directoriesStolen++;
+			return directory;
+		}
+	}
+
+	return std::nullopt;
+}
+
+void ParallelDirectoryWalker::EnumerateDirectory(int threadIndex, const std::wstring &directory)
+{
+	if (m_directoryCallback)
+	{
+		m_directoryCallback(threadIndex, directory);
+	}
+
+	std::wstring pathPrefix = directory;
+
+	if (!pathPrefix.empty() && pathPrefix.back() != '\\')
+	{
+		pathPrefix += '\\';
+	}
+
+	// FindExInfoBasic means that the short (8.3) name for each item won't be retrieved, while
+	// FIND_FIRST_EX_LARGE_FETCH allows more entries to be returned from each call into the file
+	// system. Both of these make enumeration faster.
+	WIN32_FIND_DATA findData;
+	wil::unique_hfind findHandle(FindFirstFileEx((pathPrefix + L"*").c_str(), FindExInfoBasic,
+		&findData, FindExSearchNameMatch, nullptr, FIND_FIRST_EX_LARGE_FETCH));
+
+	auto &stats = m_threadStats[threadIndex];
+	stats.directoriesEnumerated++;
+
+	if (!findHandle)
+	{
+		return;
+	}
+
+	do
+	{
+		if (lstrcmp(findData.cFileName, L".") == 0 || lstrcmp(findData.cFileName, L"..") == 0)
+		{
+			continue;
+		}
+
+		stats.entriesFound++;
+
+		if (m_itemCallback)
+		{
+			m_itemCallback(threadIndex, directory, findData);
+		}
+
+		// Reparse points (e.g. junctions) aren't followed, since they can point back to a parent
+		// directory, in which case the walk would never finish.
+		if (m_recursive && WI_IsFlagSet(findData.dwFileAttributes, FILE_ATTRIBUTE_DIRECTORY)
+			&& WI_IsFlagClear(findData.dwFileAttributes, FILE_ATTRIBUTE_REPARSE_POINT)
+			&& (!m_subdirectoryFilter || m_subdirectoryFilter(threadIndex, directory, findData)))
+		{
+			QueueDirectory(threadIndex, pathPrefix + findData.cFileName);
+		}
+	} while (!IsCancelled() && FindNextFile(findHandle.get(), &findData));
+}
+
+void ParallelDirectoryWalker::QueueDirectory(int threadIndex, std::wstring directory)
+{
+	m_numPendingDirectories++;
+
+	auto &queue = *m_workQueues[threadIndex];
+	std::scoped_lock lock(queue.mutex);
+	queue.directories.push_back(std::move(directory));
+}
+
+void ParallelDirectoryWalker::Cancel()
+{
+	m_cancelled.store(true, std::memory_order_relaxed);
+}
+
+bool ParallelDirectoryWalker::IsCancelled() const
+{
+	return m_cancelled.load(std::memory_order_relaxed);
+}
+
+int ParallelDirectoryWalker::GetNumThreads() const
+{
+	return m_numThreads;
+}
+
+const std::vector<ParallelDirectoryWalker::ThreadStats> &ParallelDirectoryWalker::GetThreadStats()
+	const
+{
+	return m_threadStats;
+}
@@ -0,0 +1,106 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <windows.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+class WorkerPool;
+
+// Enumerates the contents of a directory tree using multiple threads.
+//
+// Each thread has its own queue of directories that are waiting to be enumerated and any
+// subdirectories a thread finds are added to its own queue. A thread takes work from the back of
+// its own queue, so that it mostly works on directories it found recently (which are likely to be
+// close together on disk). Once a thread's queue is empty, it steals work from the front of another
+// thread's queue. The directories at the front of a queue are the oldest, so are likely to contain
+// the largest amount of remaining work. That keeps all threads busy, even when the tree is very
+// unbalanced.
+//
+// By default, the walker creates its own threads for each walk. If a WorkerPool is provided, the
+// additional threads are run as tasks on the pool instead. The calling thread always takes part
+// in the walk, so the walk will still finish if none of the pool's workers are free (e.g. because
+// the walk was itself started from one of them).
+class ParallelDirectoryWalker
+{
+public:
+	struct ThreadStats
+	{
+		ULONGLONG directoriesEnumerated = 0;
+		ULONGLONG entriesFound = 0;
+		ULONGLONG directoriesStolen = 0;
+		std::chrono::steady_clock::duration busyTime{};
+	};
+
+	// Called each time a thread starts enumerating a directory.
+	using DirectoryCallback = std::function<void(int threadIndex, const std::wstring &directory)>;
+
+	// Called for each item that's found (other than the "." and ".." entries). Note that, in both
+	// cases, the callback can be invoked concurrently from multiple threads.
+	using ItemCallback = std::function<void(int threadIndex, const std::wstring &directory,
+		const WIN32_FIND_DATA &findData)>;
+
+	// Called for each subdirectory that's found during a recursive walk. The subdirectory will only
+	// be enumerated if this returns true. This allows callers to skip parts of the tree they
+	// already have information about.
+	using SubdirectoryFilter = std::function<bool(int threadIndex, const std::wstring &directory,
+		const WIN32_FIND_DATA &findData)>;
+
+	ParallelDirectoryWalker(int numThreads, bool recursive, WorkerPool *workerPool = nullptr);
+
+	// Enumerates the tree, returning once every directory has been enumerated, or the walk has
+	// been cancelled.
+	void Walk(const std::wstring &rootDirectory, DirectoryCallback directoryCallback,
+		ItemCallback itemCallback);
+
+	// Must be called before Walk().
+	void SetSubdirectoryFilter(SubdirectoryFilter subdirectoryFilter);
+
+	// Can be called from any thread. Once cancelled, the walker can't be restarted.
+	void Cancel();
+	bool IsCancelled() const;
+
+	int GetNumThreads() const;
+
+	// Only valid once Walk() has returned.
+	const std::vector<ThreadStats> &GetThreadStats() const;
+
+private:
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<std::wstring> directories;
+	};
+
+	void WorkerThread(int threadIndex);
+	std::optional<std::wstring> GetNextDirectory(int threadIndex);
+	void EnumerateDirectory(int threadIndex, const std::wstring &directory);
+	void QueueDirectory(int threadIndex, std::wstring directory);
+
+	const int m_numThreads;
+	const bool m_recursive;
+	WorkerPool *const m_workerPool;
+
+	std::vector<std::unique_ptr<WorkQueue>> m_workQueues;
+	std::vector<ThreadStats> m_threadStats;
+
+	// The number of directories that have been queued, but haven't been fully enumerated yet. Once
+	// this reaches 0, there's no more work left to do.
+	std::atomic<size_t> m_numPendingDirectories = 0;
+
+	std::atomic<bool> m_cancelled = false;
+
+	DirectoryCallback m_directoryCallback;
+	ItemCallback m_itemCallback;
+	SubdirectoryFilter m_subdirectoryFilter;
+};
@@ -0,0 +1,155 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+
+// A hash table over a fixed set of strings that's built at compile time. The hash function is
+// seeded, with the seed chosen so that no two keys share a slot. Looking up a string therefore
+// takes a single hash and a single comparison.
+//
+// Find() returns the index of the key within the original array, which allows the table to be used
+// to dispatch on a string, with the case labels also generated at compile time. For example:
+//
+// constexpr std::array NAMES = { std::wstring_view(L"First"), std::wstring_view(L"Second") };
+// constexpr PerfectHashTable<NAMES.size()> TABLE(NAMES);
+//
+// switch (TABLE.Find(name).value_or(NAMES.size()))
+// {
+// case TABLE.GetIndex(L"First"):
+//     ...
+// }
+template <size_t N>
+class PerfectHashTable
+{
+public:
+	static_assert(N > 0 && N < UINT16_MAX);
+
+	consteval PerfectHashTable(const std::array<std::wstring_view, N> &keys) : m_keys(keys)
+	{
+		// Each key is only hashed once. The seed is then mixed into the resulting hash, which is
+		// much cheaper than rehashing the key for each seed that's tried.
+		std::array<uint32_t, N> keyHashes = {};
+
+		for (size_t i = 0; i < N; i++)
+		{
+			keyHashes[i] = HashKey(keys[i]);
+		}
+
+		for (uint32_t seed = 0; seed < MAX_SEED; seed++)
+		{
+			if (TryBuild(keyHashes, seed))
+			{
+				m_seed = seed;
+				return;
+			}
+		}
+
+		// Only reachable if there are duplicate keys, or if there's no collision-free seed (which
+		// is very unlikely, given the size of the table). Either way, this causes compilation to
+		// fail.
+		throw std::logic_error("Unable to build a perfect hash table");
+	}
+
+	constexpr std::optional<size_t> Find(std::wstring_view key) const
+	{
+		uint16_t slot = m_slots[GetSlot(HashKey(key), m_seed)];
+
+		if (slot == 0 || m_keys[slot - 1] != key)
+		{
+			return std::nullopt;
+		}
+
+		return slot - 1;
+	}
+
+	// Intended to be used in a constant expression (e.g. a case label), where the lookup of an
+	// unknown key will be reported as a compile error.
+	consteval size_t GetIndex(std::wstring_view key) const
+	{
+		auto index = Find(key);
+
+		if (!index)
+		{
+			throw std::invalid_argument("Key not present in table");
+		}
+
+		return *index;
+	}
+
+private:
+	// With N^2 / TABLE_SIZE kept small, a random seed is collision-free with a reasonable
+	// probability, so only a handful of seeds will typically need to be tried.
+	static constexpr size_t TABLE_SIZE = std::bit_ceil(N * 16);
+	static constexpr uint32_t MAX_SEED = 10000;
+
+	// FNV-1a.
+	static constexpr uint32_t HashKey(std::wstring_view key)
+	{
+		uint32_t hash = 2166136261u;
+
+		// The string is accessed directly, rather than through std::wstring_view, to keep down the
+		// number of steps taken when this is evaluated at compile time (which is limited).
+		const wchar_t *data = key.data();
+		const size_t size = key.size();
+
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<uint32_t>(data[i]);
+			hash *= 16777619u;
+		}
+
+		return hash;
+	}
+
+	// Mixes the seed into the hash, with a finalizer used to ensure that the low bits (which are
+	// used to select a slot) depend on all the bits of the hash.
+	static constexpr size_t GetSlot(uint32_t hash, uint32_t seed)
+	{
+		hash ^= seed * 0x9E3779B9u;
+		hash ^= hash >> 16;
+		hash *= 0x85EBCA6Bu;
+		hash ^= hash >> 13;
+		hash *= 0xC2B2AE35u;
+		hash ^= hash >> 16;
+
+		return hash & (TABLE_SIZE - 1);
+	}
+
+	constexpr bool TryBuild(const std::array<uint32_t, N> &keyHashes, uint32_t seed)
+	{
+		for (size_t i = 0; i < N; i++)
+		{
+			uint16_t &slot = m_slots[GetSlot(keyHashes[i], seed)];
+
+			if (slot != 0)
+			{
+				// Empty the slots that were filled by this attempt, so that the table is empty
+				// before the next seed is tried.
+				for (size_t j = 0; j < i; j++)
+				{
+					m_slots[GetSlot(keyHashes[j], seed)] = 0;
+				}
+
+				return false;
+			}
+
+			// Slots are stored offset by one, so that 0 can indicate an empty slot.
+			slot = static_cast<uint16_t>(i + 1);
+		}
+
+		return true;
+	}
+
+	std::array<std::wstring_view, N> m_keys;
+	uint32_t m_seed = 0;
+	std::array<uint16_t, TABLE_SIZE> m_slots = {};
+};
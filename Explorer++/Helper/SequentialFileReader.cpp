@@ -0,0 +1,211 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "SequentialFileReader.h"
+#include <algorithm>
+
+SequentialFileReader::SequentialFileReader(const std::vector<std::wstring> &filePaths,
+	DWORD chunkSize) :
+	m_chunkSize(chunkSize)
+{
+	for (const auto &filePath : filePaths)
+	{
+		InputFile inputFile;
+		inputFile.path = filePath;
+		m_files.push_back(std::move(inputFile));
+	}
+}
+
+SequentialFileReader::~SequentialFileReader()
+{
+	// The buffers can't be freed while a read into one of them is still outstanding.
+	CancelPendingRead();
+}
+
+HRESULT SequentialFileReader::Open(size_t *failedFileIndex)
+{
+	if (!m_readEvent.try_create(wil::EventOptions::ManualReset))
+	{
+		return HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	m_totalSize = 0;
+
+	for (size_t i = 0; i < m_files.size(); i++)
+	{
+		auto &inputFile = m_files[i];
+
+		inputFile.file.reset(CreateFile(inputFile.path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+			nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+		LARGE_INTEGER fileSize;
+
+		if (!inputFile.file || !GetFileSizeEx(inputFile.file.get(), &fileSize))
+		{
+			if (failedFileIndex)
+			{
+				*failedFileIndex = i;
+			}
+
+			return HRESULT_FROM_WIN32(GetLastError());
+		}
+
+		inputFile.size = fileSize.QuadPart;
+		m_totalSize += inputFile.size;
+	}
+
+	for (auto &buffer : m_buffers)
+	{
+		buffer = std::make_unique<BYTE[]>(m_chunkSize);
+	}
+
+	return S_OK;
+}
+
+ULONGLONG SequentialFileReader::GetTotalSize() const
+{
+	return m_totalSize;
+}
+
+HRESULT SequentialFileReader::ReadNextChunk(const BYTE **data, DWORD *size)
+{
+	*data = nullptr;
+	*size = 0;
+
+	// Other than for the first chunk, the read will already have been started by the previous
+	// call.
+	if (!m_readPending)
+	{
+		RETURN_IF_FAILED(StartRead());
+	}
+
+	DWORD numBytesRead = 0;
+
+	while (m_readPending)
+	{
+		RETURN_IF_FAILED(WaitForRead(&numBytesRead));
+
+		if (numBytesRead > 0)
+		{
+			break;
+		}
+
+		// The file was truncated after it was opened, so there was nothing left to read. In that
+		// case, reading will simply continue on from the next file.
+		RETURN_IF_FAILED(StartRead());
+	}
+
+	if (numBytesRead == 0)
+	{
+		return S_OK;
+	}
+
+	size_t completedBufferIndex = m_readBufferIndex;
+	m_readBufferIndex = 1 - m_readBufferIndex;
+
+	// The caller is now done with the other buffer, so the next chunk can be read into it while
+	// this chunk is being processed.
+	RETURN_IF_FAILED(StartRead());
+
+	*data = m_buffers[completedBufferIndex].get();
+	*size = numBytesRead;
+
+	return S_OK;
+}
+
+HRESULT SequentialFileReader::StartRead()
+{
+	while (m_fileIndex < m_files.size())
+	{
+		auto &inputFile = m_files[m_fileIndex];
+
+		if (m_fileOffset >= inputFile.size)
+		{
+			m_fileIndex++;
+			m_fileOffset = 0;
+			continue;
+		}
+
+		DWORD readSize = static_cast<DWORD>(
+			(std::min)(inputFile.size - m_fileOffset, static_cast<ULONGLONG>(m_chunkSize)));
+
+		m_overlapped = {};
+		m_overlapped.Offset = static_cast<DWORD>(m_fileOffset);
+		m_overlapped.OffsetHigh = static_cast<DWORD>(m_fileOffset >> 32);
+		m_overlapped.hEvent = m_readEvent.get();
+
+		BOOL res = ReadFile(inputFile.file.get(), m_buffers[m_readBufferIndex].get(), readSize,
+			nullptr, &m_overlapped);
+
+		if (!res)
+		{
+			DWORD error = GetLastError();
+
+			if (error == ERROR_HANDLE_EOF)
+			{
+				// The file has shrunk since it was opened.
+				inputFile.size = m_fileOffset;
+				continue;
+			}
+			else if (error != ERROR_IO_PENDING)
+			{
+				return HRESULT_FROM_WIN32(error);
+			}
+		}
+
+		m_readPending = true;
+		m_pendingReadFileIndex = m_fileIndex;
+		m_pendingReadSize = readSize;
+
+		return S_OK;
+	}
+
+	return S_OK;
+}
+
+HRESULT SequentialFileReader::WaitForRead(DWORD *numBytesRead)
+{
+	auto &inputFile = m_files[m_pendingReadFileIndex];
+
+	BOOL res = GetOverlappedResult(inputFile.file.get(), &m_overlapped, numBytesRead, TRUE);
+	m_readPending = false;
+
+	if (!res)
+	{
+		DWORD error = GetLastError();
+
+		if (error != ERROR_HANDLE_EOF)
+		{
+			return HRESULT_FROM_WIN32(error);
+		}
+
+		*numBytesRead = 0;
+	}
+
+	if (*numBytesRead < m_pendingReadSize)
+	{
+		inputFile.size = m_fileOffset + *numBytesRead;
+	}
+
+	m_fileOffset += *numBytesRead;
+
+	return S_OK;
+}
+
+void SequentialFileReader::CancelPendingRead()
+{
+	if (!m_readPending)
+	{
+		return;
+	}
+
+	auto &inputFile = m_files[m_pendingReadFileIndex];
+	CancelIoEx(inputFile.file.get(), &m_overlapped);
+
+	DWORD numBytesRead;
+	GetOverlappedResult(inputFile.file.get(), &m_overlapped, &numBytesRead, TRUE);
+
+	m_readPending = false;
+}
@@ -0,0 +1,69 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <wil/resource.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Reads a sequence of files as if they were a single, continuous stream of data.
+//
+// Data is read in fixed-size chunks, using two buffers. While the caller is processing one chunk,
+// the next chunk (which may come from the next file in the sequence) is read in the background
+// using overlapped I/O. That means that the amount of memory used doesn't depend on the size of the
+// files and that reading the input can proceed in parallel with whatever the caller is doing with
+// the data (e.g. writing it to another file).
+class SequentialFileReader
+{
+public:
+	static constexpr DWORD DEFAULT_CHUNK_SIZE = 1024 * 1024;
+
+	SequentialFileReader(const std::vector<std::wstring> &filePaths,
+		DWORD chunkSize = DEFAULT_CHUNK_SIZE);
+	~SequentialFileReader();
+
+	// Opens each of the files. This needs to be called before any data can be read. If one of the
+	// files can't be opened, its index will be returned in failedFileIndex.
+	HRESULT Open(size_t *failedFileIndex = nullptr);
+
+	// The combined size of all the files, as determined when the files were opened.
+	ULONGLONG GetTotalSize() const;
+
+	// Retrieves the next chunk of data. The data remains valid until the next call to this method.
+	// Once the end of the last file has been reached, size will be set to 0.
+	HRESULT ReadNextChunk(const BYTE **data, DWORD *size);
+
+private:
+	struct InputFile
+	{
+		std::wstring path;
+		wil::unique_hfile file;
+		ULONGLONG size = 0;
+	};
+
+	HRESULT StartRead();
+	HRESULT WaitForRead(DWORD *numBytesRead);
+	void CancelPendingRead();
+
+	std::vector<InputFile> m_files;
+	const DWORD m_chunkSize;
+	ULONGLONG m_totalSize = 0;
+
+	std::unique_ptr<BYTE[]> m_buffers[2];
+
+	// The buffer that the next (or currently pending) read targets.
+	size_t m_readBufferIndex = 0;
+
+	// The position the next read will start from.
+	size_t m_fileIndex = 0;
+	ULONGLONG m_fileOffset = 0;
+
+	OVERLAPPED m_overlapped = {};
+	wil::unique_event m_readEvent;
+	bool m_readPending = false;
+	size_t m_pendingReadFileIndex = 0;
+	DWORD m_pendingReadSize = 0;
+};
@@ -5,11 +5,9 @@
 #include "stdafx.h"
 #include "StringHelper.h"
 #include "Macros.h"
+#include <algorithm>
 #include <codecvt>
 
-BOOL CheckWildcardMatchInternal(const TCHAR *szWildcard, const TCHAR *szString,
-	BOOL bCaseSensitive);
-
 void FormatSizeString(ULARGE_INTEGER lFileSize, TCHAR *pszFileSize, size_t cchBuf)
 {
 	FormatSizeString(lFileSize, pszFileSize, cchBuf, FALSE, SizeDisplayFormat::None);
@@ -159,140 +157,237 @@ TCHAR *PrintCommaLargeNum(LARGE_INTEGER lPrint)
 	return p;
 }
 
-BOOL CheckWildcardMatch(const TCHAR *szWildcard, const TCHAR *szString, BOOL bCaseSensitive)
+namespace
 {
-	/* Handles multiple wildcard patterns. If the wildcard pattern contains ':',
-	split the pattern into multiple subpatterns.
-	For example "*.h: *.cpp" would match against "*.h" and "*.cpp" */
-	BOOL bMultiplePattern = FALSE;
 
-	for (int i = 0; i < lstrlen(szWildcard); i++)
-	{
-		if (szWildcard[i] == ':')
-		{
-			bMultiplePattern = TRUE;
-			break;
-		}
-	}
+// Lowercasing a character with LCMapString is relatively expensive, so the lowercase form of every
+// UTF-16 code unit is calculated once and stored in a table.
+std::vector<wchar_t> BuildLowercaseTable()
+{
+	std::vector<wchar_t> source(0x10000);
 
-	if (!bMultiplePattern)
+	for (size_t i = 0; i < source.size(); i++)
 	{
-		return CheckWildcardMatchInternal(szWildcard, szString, bCaseSensitive);
+		source[i] = static_cast<wchar_t>(i);
 	}
-	else
-	{
-		TCHAR szWildcardPattern[512];
-		TCHAR *szSinglePattern = nullptr;
-		TCHAR *szSearchPattern = nullptr;
-		TCHAR *szRemainingPattern = nullptr;
 
-		StringCchCopy(szWildcardPattern, SIZEOF_ARRAY(szWildcardPattern), szWildcard);
+	std::vector<wchar_t> table = source;
 
-		szSinglePattern = wcstok_s(szWildcardPattern, _T(":"), &szRemainingPattern);
-		PathRemoveBlanks(szSinglePattern);
+	// Surrogates only have a meaning when they appear as part of a pair, so they're left as-is.
+	// Each code unit is mapped independently, which is consistent with the way in which characters
+	// have always been compared here.
+	auto mapRange = [&source, &table](wchar_t first, wchar_t last)
+	{
+		int length = last - first + 1;
+		int res = LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, &source[first], length,
+			&table[first], length);
 
-		while (szSinglePattern != nullptr)
+		if (res != length)
 		{
-			if (CheckWildcardMatchInternal(szSinglePattern, szString, bCaseSensitive))
-			{
-				return TRUE;
-			}
-
-			szSearchPattern = szRemainingPattern;
-			szSinglePattern = wcstok_s(szSearchPattern, _T(":"), &szRemainingPattern);
-			PathRemoveBlanks(szSinglePattern);
+			std::copy_n(&source[first], length, &table[first]);
 		}
-	}
+	};
 
-	return FALSE;
+	mapRange(0x0001, 0xD7FF);
+	mapRange(0xE000, 0xFFFF);
+
+	return table;
 }
 
-BOOL CheckWildcardMatchInternal(const TCHAR *szWildcard, const TCHAR *szString, BOOL bCaseSensitive)
+const std::vector<wchar_t> &GetLowercaseTable()
 {
-	BOOL bMatched;
-	BOOL bCurrentMatch = TRUE;
+	static const std::vector<wchar_t> lowercaseTable = BuildLowercaseTable();
+	return lowercaseTable;
+}
 
-	while (*szWildcard != '\0' && *szString != '\0' && bCurrentMatch)
+// When a '*' is encountered, the position in both the pattern and the string is recorded. If the
+// rest of the pattern then fails to match, matching resumes from the character after the '*', with
+// the '*' consuming one more character from the string. Only the most recent '*' ever needs to be
+// revisited, since any later match for an earlier '*' would also be found by extending the most
+// recent one. That means matching doesn't require any recursion or allocations and the number of
+// comparisons is bounded by the product of the pattern and string lengths, rather than growing
+// exponentially with the number of '*' characters.
+// charMatches is used to compare a character in the pattern (other than '*') with a character in
+// the string.
+template <typename CharMatcher>
+bool MatchAlternative(std::wstring_view alternative, std::wstring_view str,
+	CharMatcher charMatches)
+{
+	size_t patternIndex = 0;
+	size_t strIndex = 0;
+	size_t starPatternIndex = std::wstring_view::npos;
+	size_t starStrIndex = 0;
+
+	while (strIndex < str.size())
 	{
-		switch (*szWildcard)
+		if (patternIndex < alternative.size())
 		{
-			/* Match against the next part of the wildcard string.
-			If there is a match, then return true, else consume
-			the next character, and check again. */
-		case '*':
-			bMatched = FALSE;
+			wchar_t patternChar = alternative[patternIndex];
 
-			if (*(szWildcard + 1) != '\0')
+			if (patternChar == '*')
 			{
-				bMatched = CheckWildcardMatch(++szWildcard, szString, bCaseSensitive);
+				starPatternIndex = patternIndex++;
+				starStrIndex = strIndex;
+				continue;
 			}
 
-			while (*szWildcard != '\0' && *szString != '\0' && !bMatched)
+			if (charMatches(patternChar, str[strIndex]))
 			{
-				/* Consume one more character on the input string,
-				and keep (recursively) trying to match. */
-				bMatched = CheckWildcardMatch(szWildcard, ++szString, bCaseSensitive);
+				patternIndex++;
+				strIndex++;
+				continue;
 			}
+		}
 
-			if (bMatched)
-			{
-				while (*szWildcard != '\0')
-				{
-					szWildcard++;
-				}
+		if (starPatternIndex == std::wstring_view::npos)
+		{
+			return false;
+		}
 
-				szWildcard--;
+		patternIndex = starPatternIndex + 1;
+		strIndex = ++starStrIndex;
+	}
+
+	while (patternIndex < alternative.size() && alternative[patternIndex] == '*')
+	{
+		patternIndex++;
+	}
+
+	return patternIndex == alternative.size();
+}
+
+}
+
+WildcardPattern::WildcardPattern(std::wstring_view pattern, bool caseSensitive) :
+	m_caseSensitive(caseSensitive)
+{
+	auto addAlternative = [this](std::wstring_view alternative)
+	{
+		std::wstring &added = m_alternatives.emplace_back(alternative);
 
-				while (*szString != '\0')
-				{
-					szString++;
-				}
+		if (!m_caseSensitive)
+		{
+			for (auto &c : added)
+			{
+				c = FoldCase(c);
 			}
+		}
+	};
 
-			bCurrentMatch = bMatched;
-			break;
+	if (pattern.find(':') == std::wstring_view::npos)
+	{
+		addAlternative(pattern);
+		return;
+	}
 
-		case '?':
-			szString++;
-			break;
+	size_t start = 0;
+
+	while (start <= pattern.size())
+	{
+		size_t end = pattern.find(':', start);
+
+		if (end == std::wstring_view::npos)
+		{
+			end = pattern.size();
+		}
+
+		// Empty alternatives (e.g. those that result from "*.h::*.cpp") are skipped.
+		if (end > start)
+		{
+			std::wstring_view alternative = pattern.substr(start, end - start);
 
-		default:
-			if (bCaseSensitive)
+			size_t first = alternative.find_first_not_of(' ');
+			size_t last = alternative.find_last_not_of(' ');
+
+			if (first == std::wstring_view::npos)
 			{
-				bCurrentMatch = (*szWildcard == *szString);
+				addAlternative({});
 			}
 			else
 			{
-				TCHAR szCharacter1[1];
-				LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, szWildcard, 1, szCharacter1,
-					SIZEOF_ARRAY(szCharacter1));
-
-				TCHAR szCharacter2[1];
-				LCMapString(LOCALE_USER_DEFAULT, LCMAP_LOWERCASE, szString, 1, szCharacter2,
-					SIZEOF_ARRAY(szCharacter2));
-
-				bCurrentMatch = (szCharacter1[0] == szCharacter2[0]);
+				addAlternative(alternative.substr(first, last - first + 1));
 			}
+		}
 
-			szString++;
-			break;
+		start = end + 1;
+	}
+}
+
+bool WildcardPattern::Matches(std::wstring_view str) const
+{
+	for (const auto &alternative : m_alternatives)
+	{
+		if (MatchesAlternative(alternative, str))
+		{
+			return true;
 		}
+	}
 
-		szWildcard++;
+	return false;
+}
+
+bool WildcardPattern::MatchesAlternative(std::wstring_view alternative,
+	std::wstring_view str) const
+{
+	return MatchAlternative(alternative, str,
+		[this](wchar_t patternChar, wchar_t strChar)
+		{
+			return patternChar == '?' || patternChar == FoldCase(strChar);
+		});
+}
+
+// This works by matching the other pattern against this one, as if this pattern were a regular
+// string. A '*' in the other pattern can consume any part of this pattern, while a '?' can only
+// consume a single character that isn't a '*'. Any other character only matches itself. If that
+// succeeds, every string matched by this pattern must also be matched by the other pattern. Note
+// that the reverse doesn't hold, so some refinements (e.g. "?*" of "*?") won't be detected.
+bool WildcardPattern::IsRefinementOf(const WildcardPattern &other) const
+{
+	if (m_caseSensitive != other.m_caseSensitive)
+	{
+		return false;
 	}
 
-	/* Skip past any trailing wildcards. */
-	while (*szWildcard == '*')
+	for (const auto &alternative : m_alternatives)
 	{
-		szWildcard++;
+		bool covered = std::any_of(other.m_alternatives.begin(), other.m_alternatives.end(),
+			[&alternative](const std::wstring &otherAlternative)
+			{
+				return MatchAlternative(otherAlternative, alternative,
+					[](wchar_t patternChar, wchar_t strChar)
+					{
+						if (patternChar == '?')
+						{
+							return strChar != '*';
+						}
+
+						return patternChar == strChar;
+					});
+			});
+
+		if (!covered)
+		{
+			return false;
+		}
 	}
 
-	if (*szWildcard == '\0' && *szString == '\0' && bCurrentMatch)
+	return true;
+}
+
+wchar_t WildcardPattern::FoldCase(wchar_t c) const
+{
+	if (m_caseSensitive)
 	{
-		return TRUE;
+		return c;
 	}
 
-	return FALSE;
+	return GetLowercaseTable()[c];
+}
+
+BOOL CheckWildcardMatch(const TCHAR *szWildcard, const TCHAR *szString, BOOL bCaseSensitive)
+{
+	WildcardPattern pattern(szWildcard, bCaseSensitive);
+	return pattern.Matches(szString);
 }
 
 void ReplaceCharacter(TCHAR *str, TCHAR ch, TCHAR chReplacement)
@@ -350,6 +445,28 @@ void TrimString(std::wstring &str, const std::wstring &strWhitespace)
 	TrimStringRight(str, strWhitespace);
 }
 
+std::wstring FoldStringCase(const std::wstring &str)
+{
+	if (str.empty())
+	{
+		return str;
+	}
+
+	std::wstring foldedStr(str.size(), '\0');
+	int res = LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, str.c_str(),
+		static_cast<int>(str.size()), foldedStr.data(), static_cast<int>(foldedStr.size()),
+		nullptr, nullptr, 0);
+
+	if (res == 0)
+	{
+		return str;
+	}
+
+	foldedStr.resize(res);
+
+	return foldedStr;
+}
+
 std::optional<std::string> wstrToStr(const std::wstring &source)
 {
 	int res = WideCharToMultiByte(CP_ACP, 0, source.c_str(), -1, nullptr, 0, nullptr, nullptr);
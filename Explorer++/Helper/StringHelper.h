@@ -7,6 +7,8 @@
 #include <windows.h>
 #include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 enum class SizeDisplayFormat
 {
@@ -24,6 +26,34 @@ void FormatSizeString(ULARGE_INTEGER lFileSize, TCHAR *pszFileSize, size_t cchBu
 	SizeDisplayFormat sdf);
 TCHAR *PrintComma(unsigned long nPrint);
 TCHAR *PrintCommaLargeNum(LARGE_INTEGER lPrint);
+
+// A wildcard pattern that has been processed in advance, so that it can be efficiently matched
+// against a large number of strings. Within the pattern, '*' matches any sequence of characters
+// (including an empty sequence) and '?' matches any single character.
+//
+// Multiple alternatives can be specified by separating them with ':' (e.g. "*.h: *.cpp"), in which
+// case a string matches if it matches any one of the alternatives. Leading and trailing spaces
+// around each alternative are ignored.
+class WildcardPattern
+{
+public:
+	WildcardPattern(std::wstring_view pattern, bool caseSensitive);
+
+	bool Matches(std::wstring_view str) const;
+
+	// Returns true if every string matched by this pattern is also matched by the other pattern
+	// (e.g. "*.txt" is a refinement of "*.t*"). This may return false for some patterns that are
+	// refinements, but won't ever return true for a pattern that isn't.
+	bool IsRefinementOf(const WildcardPattern &other) const;
+
+private:
+	bool MatchesAlternative(std::wstring_view alternative, std::wstring_view str) const;
+	wchar_t FoldCase(wchar_t c) const;
+
+	std::vector<std::wstring> m_alternatives;
+	bool m_caseSensitive;
+};
+
 BOOL CheckWildcardMatch(const TCHAR *szWildcard, const TCHAR *szString, BOOL bCaseSensitive);
 void ReplaceCharacter(TCHAR *str, TCHAR ch, TCHAR chReplacement);
 void ReplaceCharacterWithString(const TCHAR *szBaseString, TCHAR *szOutput, UINT cchMax,
@@ -31,6 +61,11 @@ void ReplaceCharacterWithString(const TCHAR *szBaseString, TCHAR *szOutput, UINT
 void TrimStringLeft(std::wstring &str, const std::wstring &strWhitespace);
 void TrimStringRight(std::wstring &str, const std::wstring &strWhitespace);
 void TrimString(std::wstring &str, const std::wstring &strWhitespace);
+
+// Returns a copy of the string that can be used as a key when strings should be matched without
+// regard to case (e.g. filesystem paths). The mapping doesn't depend on the user's locale.
+std::wstring FoldStringCase(const std::wstring &str);
+
 std::optional<std::string> wstrToStr(const std::wstring &source);
 std::optional<std::wstring> strToWstr(const std::string &source);
 std::string wstrToUtf8Str(const std::wstring &source);
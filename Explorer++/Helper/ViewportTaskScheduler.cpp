@@ -0,0 +1,301 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "ViewportTaskScheduler.h"
+#include <algorithm>
+#include <utility>
+
+ViewportTaskScheduler::ViewportTaskScheduler(WorkerPool &workerPool,
+	WorkerPool::Priority priority, RowResolver rowResolver) :
+	m_rowResolver(std::move(rowResolver)),
+	m_taskGroup(workerPool, priority)
+{
+}
+
+ViewportTaskScheduler::~ViewportTaskScheduler()
+{
+	CancelAll();
+}
+
+void ViewportTaskScheduler::QueueTask(int tag, std::optional<RowItem> rowItem, Task task,
+	DroppedCallback droppedCallback)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+
+		PendingTask pendingTask = { tag, rowItem, m_sequenceNumberCounter++, std::move(task),
+			std::move(droppedCallback), GetStopSource(tag).get_token(),
+			std::chrono::steady_clock::now() };
+		m_pendingTasks.push_back(std::move(pendingTask));
+		std::push_heap(m_pendingTasks.begin(), m_pendingTasks.end(), GetHeapComparator());
+
+		m_stats.tasksQueued++;
+	}
+
+	m_taskGroup.Post(std::bind_front(&ViewportTaskScheduler::RunNextTask, this));
+}
+
+void ViewportTaskScheduler::SetViewport(int firstVisibleRow, int lastVisibleRow)
+{
+	std::vector<DroppedCallback> droppedCallbacks;
+
+	{
+		std::scoped_lock lock(m_mutex);
+
+		ScrollDirection scrollDirection = ScrollDirection::None;
+
+		if (m_viewport)
+		{
+			if (m_viewport->firstVisibleRow == firstVisibleRow
+				&& m_viewport->lastVisibleRow == lastVisibleRow && !m_rowsInvalidated)
+			{
+				return;
+			}
+
+			if (firstVisibleRow > m_viewport->firstVisibleRow)
+			{
+				scrollDirection = ScrollDirection::Down;
+			}
+			else if (firstVisibleRow < m_viewport->firstVisibleRow)
+			{
+				scrollDirection = ScrollDirection::Up;
+			}
+			else
+			{
+				// The viewport has only been resized, so the direction remains the same.
+				scrollDirection = m_viewport->scrollDirection;
+			}
+		}
+
+		m_viewport = { firstVisibleRow, (std::max)(firstVisibleRow, lastVisibleRow),
+			scrollDirection };
+
+		bool updateRows = std::exchange(m_rowsInvalidated, false) && m_rowResolver;
+
+		std::vector<PendingTask> retainedTasks;
+		retainedTasks.reserve(m_pendingTasks.size());
+
+		for (auto &pendingTask : m_pendingTasks)
+		{
+			if ((!updateRows || UpdateRow(pendingTask)) && IsInPrefetchWindow(pendingTask))
+			{
+				retainedTasks.push_back(std::move(pendingTask));
+				continue;
+			}
+
+			if (pendingTask.droppedCallback)
+			{
+				droppedCallbacks.push_back(std::move(pendingTask.droppedCallback));
+			}
+
+			m_stats.tasksDropped++;
+		}
+
+		m_pendingTasks = std::move(retainedTasks);
+
+		std::make_heap(m_pendingTasks.begin(), m_pendingTasks.end(), GetHeapComparator());
+	}
+
+	// The callbacks are invoked without the lock held, so that they're free to queue further tasks.
+	for (auto &droppedCallback : droppedCallbacks)
+	{
+		droppedCallback();
+	}
+}
+
+void ViewportTaskScheduler::InvalidateRows()
+{
+	std::scoped_lock lock(m_mutex);
+	m_rowsInvalidated = true;
+}
+
+void ViewportTaskScheduler::Cancel(int tag)
+{
+	std::scoped_lock lock(m_mutex);
+
+	auto itr = std::remove_if(m_pendingTasks.begin(), m_pendingTasks.end(),
+		[tag](const PendingTask &pendingTask)
+		{
+			return pendingTask.tag == tag;
+		});
+
+	m_stats.tasksCancelled += std::distance(itr, m_pendingTasks.end()) + m_numRunningTasks[tag];
+	m_pendingTasks.erase(itr, m_pendingTasks.end());
+
+	std::make_heap(m_pendingTasks.begin(), m_pendingTasks.end(), GetHeapComparator());
+
+	// Any tasks that are currently running will see that a stop has been requested. A new stop
+	// source is used for tasks queued from this point on.
+	auto &stopSource = GetStopSource(tag);
+	stopSource.request_stop();
+	stopSource = std::stop_source();
+}
+
+void ViewportTaskScheduler::CancelAll()
+{
+	std::scoped_lock lock(m_mutex);
+
+	m_stats.tasksCancelled += m_pendingTasks.size();
+	m_pendingTasks.clear();
+
+	// Since there are no pending tasks left, the requests to run them can be discarded as well.
+	m_taskGroup.Clear();
+
+	for (auto &[tag, stopSource] : m_stopSources)
+	{
+		m_stats.tasksCancelled += m_numRunningTasks[tag];
+
+		stopSource.request_stop();
+		stopSource = std::stop_source();
+	}
+}
+
+ViewportTaskScheduler::Stats ViewportTaskScheduler::GetStats() const
+{
+	std::scoped_lock lock(m_mutex);
+
+	Stats stats = m_stats;
+	stats.queueDepth = m_pendingTasks.size();
+	return stats;
+}
+
+void ViewportTaskScheduler::SetPriority(WorkerPool::Priority priority)
+{
+	m_taskGroup.SetPriority(priority);
+}
+
+// There's one request to run a task for every task that was queued. However, tasks may have been
+// dropped or cancelled since then, so there may be nothing left to run.
+void ViewportTaskScheduler::RunNextTask()
+{
+	std::unique_lock lock(m_mutex);
+
+	if (m_pendingTasks.empty())
+	{
+		return;
+	}
+
+	std::pop_heap(m_pendingTasks.begin(), m_pendingTasks.end(), GetHeapComparator());
+	PendingTask pendingTask = std::move(m_pendingTasks.back());
+	m_pendingTasks.pop_back();
+
+	auto queueLatency = std::chrono::steady_clock::now() - pendingTask.queuedTime;
+	m_stats.tasksStarted++;
+	m_stats.totalQueueLatency += queueLatency;
+	m_stats.maxQueueLatency = (std::max)(m_stats.maxQueueLatency, queueLatency);
+
+	m_numRunningTasks[pendingTask.tag]++;
+
+	lock.unlock();
+
+	pendingTask.task(pendingTask.stopToken);
+
+	lock.lock();
+	m_numRunningTasks[pendingTask.tag]--;
+}
+
+// Tasks without a row always come first. Other tasks are ordered by their distance from the
+// visible area. Tasks for rows that have been scrolled past are treated as being twice as far
+// away as tasks for rows in the direction of scrolling. Tasks at the same distance are run in the
+// order they were queued.
+ViewportTaskScheduler::Priority ViewportTaskScheduler::GetPriority(
+	const PendingTask &pendingTask) const
+{
+	if (!pendingTask.rowItem)
+	{
+		return { 0, 0, pendingTask.sequenceNumber };
+	}
+
+	if (!m_viewport)
+	{
+		return { 1, 0, pendingTask.sequenceNumber };
+	}
+
+	int row = pendingTask.rowItem->row;
+	int distance = 0;
+	bool inScrollDirection = true;
+
+	if (row < m_viewport->firstVisibleRow)
+	{
+		distance = m_viewport->firstVisibleRow - row;
+		inScrollDirection = (m_viewport->scrollDirection != ScrollDirection::Down);
+	}
+	else if (row > m_viewport->lastVisibleRow)
+	{
+		distance = row - m_viewport->lastVisibleRow;
+		inScrollDirection = (m_viewport->scrollDirection != ScrollDirection::Up);
+	}
+
+	if (!inScrollDirection)
+	{
+		distance *= 2;
+	}
+
+	return { 1, distance, pendingTask.sequenceNumber };
+}
+
+// The prefetch window covers the visible rows, plus PREFETCH_PAGES pages in the direction of
+// scrolling. If the direction isn't known, the window extends in both directions.
+bool ViewportTaskScheduler::IsInPrefetchWindow(const PendingTask &pendingTask) const
+{
+	if (!pendingTask.rowItem || !m_viewport)
+	{
+		return true;
+	}
+
+	int pageSize = m_viewport->lastVisibleRow - m_viewport->firstVisibleRow + 1;
+	int prefetchSize = PREFETCH_PAGES * pageSize;
+
+	int windowStart = m_viewport->firstVisibleRow;
+	int windowEnd = m_viewport->lastVisibleRow;
+
+	if (m_viewport->scrollDirection != ScrollDirection::Down)
+	{
+		windowStart -= prefetchSize;
+	}
+
+	if (m_viewport->scrollDirection != ScrollDirection::Up)
+	{
+		windowEnd += prefetchSize;
+	}
+
+	return pendingTask.rowItem->row >= windowStart && pendingTask.rowItem->row <= windowEnd;
+}
+
+// Looks up the current row for the task's item. Returns false if the item is no longer shown.
+bool ViewportTaskScheduler::UpdateRow(PendingTask &pendingTask) const
+{
+	if (!pendingTask.rowItem)
+	{
+		return true;
+	}
+
+	auto row = m_rowResolver(pendingTask.rowItem->item);
+
+	if (!row)
+	{
+		return false;
+	}
+
+	pendingTask.rowItem->row = *row;
+	return true;
+}
+
+// The heap places the element that compares greatest at the front. The task with the highest
+// priority (i.e. the smallest priority value) therefore needs to compare greatest.
+std::function<bool(const ViewportTaskScheduler::PendingTask &,
+	const ViewportTaskScheduler::PendingTask &)>
+ViewportTaskScheduler::GetHeapComparator() const
+{
+	return [this](const PendingTask &pendingTask1, const PendingTask &pendingTask2)
+	{
+		return GetPriority(pendingTask1) > GetPriority(pendingTask2);
+	};
+}
+
+std::stop_source &ViewportTaskScheduler::GetStopSource(int tag)
+{
+	return m_stopSources.try_emplace(tag).first->second;
+}
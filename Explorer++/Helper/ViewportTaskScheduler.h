@@ -0,0 +1,161 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include "WorkerPool.h"
+#include <windows.h>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <unordered_map>
+#include <vector>
+
+// Runs background tasks that are associated with rows in a view (e.g. retrieving the text for a
+// column, or a thumbnail, for an item in a listview).
+//
+// Tasks aren't run in the order they're queued. Instead, tasks for rows that are currently visible
+// are run first, followed by tasks for rows that are closest to the visible area, with rows in the
+// direction of scrolling preferred over rows that have already been scrolled past. When the
+// viewport changes, any pending tasks whose rows are no longer within the prefetch window are
+// dropped, so that tasks for rows that are actually on screen don't have to wait behind them.
+//
+// Each task is queued along with the row it was for at the time, as well as a stable identifier for
+// the item shown in that row. If the rows are later reordered, InvalidateRows() can be called and
+// the row resolver will be used to find the current row for each item the next time the viewport
+// is set. Tasks for items that are no longer shown are dropped at that point.
+//
+// Tasks can also be cancelled, either by tag or all at once. Pending tasks are simply discarded,
+// while running tasks are notified through the stop token they're passed.
+//
+// The tasks are run on a WorkerPool, within a task group owned by this class. Each time a task is
+// queued, a request to run the next task is posted to the group. When that request runs, it picks
+// whichever pending task currently has the highest priority.
+class ViewportTaskScheduler
+{
+public:
+	using Task = std::function<void(std::stop_token stopToken)>;
+
+	// Called (on the thread that changed the viewport) when a task is dropped because its row has
+	// left the prefetch window, or its item is no longer shown. This isn't called when tasks are
+	// cancelled.
+	using DroppedCallback = std::function<void()>;
+
+	// Returns the row that the specified item is currently shown in, or nothing if the item is no
+	// longer shown. This is only called on the thread that sets the viewport.
+	using RowResolver = std::function<std::optional<int>(int item)>;
+
+	struct RowItem
+	{
+		int row;
+		int item;
+	};
+
+	struct Stats
+	{
+		size_t queueDepth = 0;
+		ULONGLONG tasksQueued = 0;
+		ULONGLONG tasksStarted = 0;
+		ULONGLONG tasksDropped = 0;
+		ULONGLONG tasksCancelled = 0;
+
+		// The time between a task being queued and it starting to run.
+		std::chrono::steady_clock::duration totalQueueLatency{};
+		std::chrono::steady_clock::duration maxQueueLatency{};
+	};
+
+	// The number of pages of rows beyond the visible area (in the direction of scrolling) whose
+	// tasks will be retained when the viewport changes.
+	static const int PREFETCH_PAGES = 1;
+
+	// If no row resolver is provided, the rows that tasks are queued for are assumed to stay
+	// fixed.
+	ViewportTaskScheduler(WorkerPool &workerPool, WorkerPool::Priority priority,
+		RowResolver rowResolver = nullptr);
+
+	// Cancels all tasks and waits for any running tasks to finish.
+	~ViewportTaskScheduler();
+
+	// Tasks without a row aren't tied to the viewport. They're run before all other tasks and are
+	// never dropped. The tag can be used to cancel a particular set of tasks.
+	void QueueTask(int tag, std::optional<RowItem> rowItem, Task task,
+		DroppedCallback droppedCallback = nullptr);
+
+	// Should be called whenever the visible range of rows changes.
+	void SetViewport(int firstVisibleRow, int lastVisibleRow);
+
+	// Should be called whenever rows are inserted, removed or reordered. The row for each pending
+	// task will be resolved again the next time the viewport is set.
+	void InvalidateRows();
+
+	void Cancel(int tag);
+	void CancelAll();
+
+	Stats GetStats() const;
+
+	// Sets the priority class of the task group that the tasks are run in.
+	void SetPriority(WorkerPool::Priority priority);
+
+private:
+	enum class ScrollDirection
+	{
+		None,
+		Up,
+		Down
+	};
+
+	struct Viewport
+	{
+		int firstVisibleRow;
+		int lastVisibleRow;
+		ScrollDirection scrollDirection;
+	};
+
+	struct PendingTask
+	{
+		int tag;
+		std::optional<RowItem> rowItem;
+		ULONGLONG sequenceNumber;
+		Task task;
+		DroppedCallback droppedCallback;
+		std::stop_token stopToken;
+		std::chrono::steady_clock::time_point queuedTime;
+	};
+
+	struct Priority
+	{
+		int taskClass;
+		int distance;
+		ULONGLONG sequenceNumber;
+
+		auto operator<=>(const Priority &) const = default;
+	};
+
+	void RunNextTask();
+	Priority GetPriority(const PendingTask &pendingTask) const;
+	bool IsInPrefetchWindow(const PendingTask &pendingTask) const;
+	bool UpdateRow(PendingTask &pendingTask) const;
+	std::function<bool(const PendingTask &, const PendingTask &)> GetHeapComparator() const;
+	std::stop_source &GetStopSource(int tag);
+
+	mutable std::mutex m_mutex;
+
+	// Maintained as a heap, ordered by priority. The heap is rebuilt whenever the viewport changes,
+	// since that's the only time the relative priority of tasks can change.
+	std::vector<PendingTask> m_pendingTasks;
+
+	std::optional<Viewport> m_viewport;
+	const RowResolver m_rowResolver;
+	bool m_rowsInvalidated = false;
+	std::unordered_map<int, std::stop_source> m_stopSources;
+	std::unordered_map<int, int> m_numRunningTasks;
+	ULONGLONG m_sequenceNumberCounter = 0;
+	Stats m_stats;
+
+	// This is declared last, so that it's destroyed first. Destroying the group waits for any
+	// running tasks to finish, and those tasks access the other members of this class.
+	WorkerPool::TaskGroup m_taskGroup;
+};
@@ -0,0 +1,338 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "WorkerPool.h"
+#include <algorithm>
+
+WorkerPool::TaskGroup::TaskGroup(WorkerPool &pool, Priority priority) :
+	m_pool(pool),
+	m_state(std::make_shared<GroupState>())
+{
+	m_state->priority = priority;
+	m_pool.AddGroup(m_state);
+}
+
+WorkerPool::TaskGroup::~TaskGroup()
+{
+	m_pool.RemoveGroup(m_state);
+}
+
+void WorkerPool::TaskGroup::Post(Task task)
+{
+	m_pool.PostTask(m_state, std::move(task));
+}
+
+void WorkerPool::TaskGroup::Clear()
+{
+	m_pool.ClearTasks(m_state);
+}
+
+void WorkerPool::TaskGroup::SetPriority(Priority priority)
+{
+	m_pool.SetGroupPriority(m_state, priority);
+}
+
+WorkerPool::Priority WorkerPool::TaskGroup::GetPriority() const
+{
+	return m_pool.GetGroupPriority(m_state);
+}
+
+WorkerPool &WorkerPool::GetInstance()
+{
+	static WorkerPool workerPool(
+		std::clamp(static_cast<int>(std::thread::hardware_concurrency()), MIN_THREADS, MAX_THREADS),
+		std::bind(CoInitializeEx, nullptr, COINIT_APARTMENTTHREADED), CoUninitialize);
+	return workerPool;
+}
+
+WorkerPool::WorkerPool(int numThreads, std::function<void()> threadInitializer,
+	std::function<void()> threadUninitializer)
+{
+	numThreads = (std::max)(numThreads, 1);
+
+	m_workerStates.resize(numThreads);
+	m_maxRunningBackgroundTasks = (std::max)(numThreads - RESERVED_INTERACTIVE_WORKERS, 1);
+	m_stats.numThreads = numThreads;
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		m_threads.emplace_back(&WorkerPool::WorkerThread, this, i, threadInitializer,
+			threadUninitializer);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::scoped_lock lock(m_mutex);
+
+		m_stopping = true;
+
+		for (auto &workerState : m_workerStates)
+		{
+			for (auto &group : workerState.groups)
+			{
+				group->tasks.clear();
+			}
+		}
+	}
+
+	m_taskAvailable.notify_all();
+
+	for (auto &thread : m_threads)
+	{
+		thread.join();
+	}
+}
+
+WorkerPool::Stats WorkerPool::GetStats() const
+{
+	std::scoped_lock lock(m_mutex);
+
+	Stats stats = m_stats;
+	stats.numGroups = 0;
+	stats.pendingTasks = 0;
+
+	for (const auto &workerState : m_workerStates)
+	{
+		stats.numGroups += static_cast<int>(workerState.groups.size());
+
+		for (const auto &group : workerState.groups)
+		{
+			stats.pendingTasks += group->tasks.size();
+		}
+	}
+
+	return stats;
+}
+
+void WorkerPool::WorkerThread(int workerIndex, std::function<void()> threadInitializer,
+	std::function<void()> threadUninitializer)
+{
+	if (threadInitializer)
+	{
+		threadInitializer();
+	}
+
+	while (true)
+	{
+		std::unique_lock lock(m_mutex);
+
+		std::optional<SelectedTask> selectedTask;
+		m_taskAvailable.wait(lock,
+			[this, workerIndex, &selectedTask]()
+			{
+				if (m_stopping)
+				{
+					return true;
+				}
+
+				selectedTask = SelectTask(workerIndex);
+				return selectedTask.has_value();
+			});
+
+		if (m_stopping)
+		{
+			break;
+		}
+
+		selectedTask->group->numRunningTasks++;
+		m_stats.tasksRun++;
+
+		if (selectedTask->priority == Priority::Background)
+		{
+			m_numRunningBackgroundTasks++;
+		}
+
+		lock.unlock();
+
+		selectedTask->task();
+
+		// The task is destroyed before the group is marked as idle, since the task may hold
+		// references to objects owned by the component that owns the group.
+		selectedTask->task = nullptr;
+
+		lock.lock();
+		selectedTask->group->numRunningTasks--;
+
+		bool backgroundTaskFinished = selectedTask->priority == Priority::Background;
+
+		if (backgroundTaskFinished)
+		{
+			m_numRunningBackgroundTasks--;
+		}
+
+		lock.unlock();
+
+		m_taskFinished.notify_all();
+
+		// Other workers may have been waiting for a background slot to become available.
+		if (backgroundTaskFinished)
+		{
+			m_taskAvailable.notify_all();
+		}
+	}
+
+	if (threadUninitializer)
+	{
+		threadUninitializer();
+	}
+}
+
+// Interactive tasks are preferred, except that a background task will be run periodically (if
+// there is one), so that background groups aren't starved completely. For each class, the worker
+// first looks at its own groups, then at the groups of the other workers. Background tasks are only
+// selected while fewer than m_maxRunningBackgroundTasks are running.
+std::optional<WorkerPool::SelectedTask> WorkerPool::SelectTask(int workerIndex)
+{
+	auto &ownWorkerState = m_workerStates[workerIndex];
+
+	std::vector<Priority> priorities = { Priority::Interactive, Priority::Background };
+
+	if (ownWorkerState.interactiveTasksSinceBackground >= BACKGROUND_SHARE)
+	{
+		std::reverse(priorities.begin(), priorities.end());
+	}
+
+	int numWorkers = static_cast<int>(m_workerStates.size());
+
+	for (auto priority : priorities)
+	{
+		if (priority == Priority::Background
+			&& m_numRunningBackgroundTasks >= m_maxRunningBackgroundTasks)
+		{
+			continue;
+		}
+
+		for (int i = 0; i < numWorkers; i++)
+		{
+			auto &workerState = m_workerStates[(workerIndex + i) % numWorkers];
+			auto group = FindGroupWithTasks(workerState, priority);
+
+			if (!group)
+			{
+				continue;
+			}
+
+			if (i != 0)
+			{
+				m_stats.tasksStolen++;
+			}
+
+			if (priority == Priority::Interactive)
+			{
+				ownWorkerState.interactiveTasksSinceBackground++;
+			}
+			else
+			{
+				ownWorkerState.interactiveTasksSinceBackground = 0;
+			}
+
+			SelectedTask selectedTask = { group, priority, std::move(group->tasks.front()) };
+			group->tasks.pop_front();
+			return selectedTask;
+		}
+	}
+
+	return std::nullopt;
+}
+
+// Groups are visited in round-robin order, starting from the group after the one that was last
+// selected. That way, each group with pending work gets a turn.
+std::shared_ptr<WorkerPool::GroupState> WorkerPool::FindGroupWithTasks(WorkerState &workerState,
+	Priority priority)
+{
+	size_t numGroups = workerState.groups.size();
+
+	for (size_t i = 0; i < numGroups; i++)
+	{
+		size_t index = (workerState.nextGroup + i) % numGroups;
+		auto &group = workerState.groups[index];
+
+		if (group->priority == priority && !group->tasks.empty())
+		{
+			workerState.nextGroup = (index + 1) % numGroups;
+			return group;
+		}
+	}
+
+	return nullptr;
+}
+
+// Groups are distributed across the workers as they're created.
+void WorkerPool::AddGroup(std::shared_ptr<GroupState> group)
+{
+	std::scoped_lock lock(m_mutex);
+
+	group->homeWorker = m_nextHomeWorker;
+	m_nextHomeWorker = (m_nextHomeWorker + 1) % static_cast<int>(m_workerStates.size());
+
+	m_workerStates[group->homeWorker].groups.push_back(group);
+}
+
+// Note that this shouldn't be called from one of the group's own tasks, since it would then wait
+// for itself to finish.
+void WorkerPool::RemoveGroup(std::shared_ptr<GroupState> group)
+{
+	// The tasks are destroyed once the lock has been released, since destroying a task can run
+	// arbitrary code (e.g. the destructors of any objects it captured).
+	std::deque<Task> removedTasks;
+
+	std::unique_lock lock(m_mutex);
+
+	removedTasks = std::move(group->tasks);
+	group->tasks.clear();
+
+	auto &workerState = m_workerStates[group->homeWorker];
+	std::erase(workerState.groups, group);
+	workerState.nextGroup = 0;
+
+	m_taskFinished.wait(lock,
+		[&group]()
+		{
+			return group->numRunningTasks == 0;
+		});
+}
+
+void WorkerPool::PostTask(const std::shared_ptr<GroupState> &group, Task task)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		group->tasks.push_back(std::move(task));
+	}
+
+	// Any worker may be able to run the task (by stealing it), so all waiting workers need to
+	// re-examine the queues. Only one of them will actually end up running the task.
+	m_taskAvailable.notify_all();
+}
+
+void WorkerPool::ClearTasks(const std::shared_ptr<GroupState> &group)
+{
+	std::deque<Task> removedTasks;
+
+	{
+		std::scoped_lock lock(m_mutex);
+		removedTasks = std::move(group->tasks);
+		group->tasks.clear();
+	}
+}
+
+void WorkerPool::SetGroupPriority(const std::shared_ptr<GroupState> &group, Priority priority)
+{
+	{
+		std::scoped_lock lock(m_mutex);
+		group->priority = priority;
+	}
+
+	// A worker that's waiting may have skipped the group's tasks because of its previous priority
+	// (e.g. a background group that was promoted while every background slot was in use).
+	m_taskAvailable.notify_all();
+}
+
+WorkerPool::Priority WorkerPool::GetGroupPriority(const std::shared_ptr<GroupState> &group) const
+{
+	std::scoped_lock lock(m_mutex);
+	return group->priority;
+}
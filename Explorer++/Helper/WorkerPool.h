@@ -0,0 +1,169 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <windows.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A set of worker threads that's shared by the whole application, so that the number of threads
+// doesn't grow with the number of tabs.
+//
+// Work is submitted through task groups. Each component (e.g. a tab) owns its own group, which it
+// can clear or destroy without affecting the work queued by other components. Each group also has
+// a priority class. Interactive groups (e.g. the selected tab) are serviced before background
+// groups, though background groups are still given a share of the workers, so that they
+// eventually finish their work. Background tasks are never allowed to occupy every worker, so
+// there's always a worker free to pick up interactive work as soon as it arrives.
+//
+// Every group is assigned to a home worker. Each worker services its own groups in round-robin
+// order, so a group with a large backlog can't monopolize a worker. When a worker has nothing left
+// to do, it steals work from the groups assigned to the other workers.
+class WorkerPool
+{
+public:
+	using Task = std::function<void()>;
+
+	enum class Priority
+	{
+		Interactive,
+		Background
+	};
+
+	struct Stats
+	{
+		int numThreads = 0;
+		int numGroups = 0;
+		size_t pendingTasks = 0;
+		ULONGLONG tasksRun = 0;
+		ULONGLONG tasksStolen = 0;
+	};
+
+private:
+	struct GroupState;
+
+public:
+	class TaskGroup
+	{
+	public:
+		TaskGroup(WorkerPool &pool, Priority priority);
+
+		// Removes any pending tasks and waits for tasks from this group that are currently
+		// running to finish.
+		~TaskGroup();
+
+		TaskGroup(const TaskGroup &) = delete;
+		TaskGroup &operator=(const TaskGroup &) = delete;
+
+		void Post(Task task);
+
+		template <typename Function>
+		std::future<std::invoke_result_t<Function>> Push(Function function)
+		{
+			using ResultType = std::invoke_result_t<Function>;
+
+			auto task = std::make_shared<std::packaged_task<ResultType()>>(std::move(function));
+			auto future = task->get_future();
+
+			Post(
+				[task]()
+				{
+					(*task)();
+				});
+
+			return future;
+		}
+
+		// Removes any tasks that haven't started yet. Tasks that are already running aren't
+		// affected.
+		void Clear();
+
+		void SetPriority(Priority priority);
+		Priority GetPriority() const;
+
+	private:
+		WorkerPool &m_pool;
+		std::shared_ptr<GroupState> m_state;
+	};
+
+	// The pool used by the application. Each of its threads is initialized for COM (using a
+	// single-threaded apartment).
+	static WorkerPool &GetInstance();
+
+	// threadInitializer and threadUninitializer (if provided) are called on each worker thread when
+	// it starts and before it exits.
+	WorkerPool(int numThreads, std::function<void()> threadInitializer = nullptr,
+		std::function<void()> threadUninitializer = nullptr);
+	~WorkerPool();
+
+	Stats GetStats() const;
+
+	// After this many interactive tasks have been run consecutively by a worker, it will run a
+	// background task (if there is one), before going back to interactive tasks.
+	static const int BACKGROUND_SHARE = 4;
+
+	// The number of workers that won't run background tasks. Only applies when there's more than
+	// one worker.
+	static const int RESERVED_INTERACTIVE_WORKERS = 1;
+
+private:
+	static const int MIN_THREADS = 2;
+	static const int MAX_THREADS = 8;
+
+	struct GroupState
+	{
+		Priority priority;
+		int homeWorker;
+		std::deque<Task> tasks;
+		int numRunningTasks = 0;
+	};
+
+	struct WorkerState
+	{
+		std::vector<std::shared_ptr<GroupState>> groups;
+		size_t nextGroup = 0;
+		int interactiveTasksSinceBackground = 0;
+	};
+
+	struct SelectedTask
+	{
+		std::shared_ptr<GroupState> group;
+		Priority priority;
+		Task task;
+	};
+
+	void WorkerThread(int workerIndex, std::function<void()> threadInitializer,
+		std::function<void()> threadUninitializer);
+	std::optional<SelectedTask> SelectTask(int workerIndex);
+	std::shared_ptr<GroupState> FindGroupWithTasks(WorkerState &workerState, Priority priority);
+
+	void AddGroup(std::shared_ptr<GroupState> group);
+	void RemoveGroup(std::shared_ptr<GroupState> group);
+	void PostTask(const std::shared_ptr<GroupState> &group, Task task);
+	void ClearTasks(const std::shared_ptr<GroupState> &group);
+	void SetGroupPriority(const std::shared_ptr<GroupState> &group, Priority priority);
+	Priority GetGroupPriority(const std::shared_ptr<GroupState> &group) const;
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_taskAvailable;
+	std::condition_variable m_taskFinished;
+
+	std::vector<WorkerState> m_workerStates;
+	int m_maxRunningBackgroundTasks;
+	int m_numRunningBackgroundTasks = 0;
+	int m_nextHomeWorker = 0;
+	bool m_stopping = false;
+	Stats m_stats;
+
+	std::vector<std::thread> m_threads;
+};
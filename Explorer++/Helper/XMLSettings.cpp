@@ -200,14 +200,8 @@ int NXMLSettings::DecodeIntValue(const WCHAR *wszValue)
 	return _wtoi(wszValue);
 }
 
-COLORREF NXMLSettings::ReadXMLColorData(IXMLDOMNode *pNode)
+COLORREF NXMLSettings::ReadXMLColorData(const XmlStreamReader::Element &element)
 {
-	wil::com_ptr_nothrow<IXMLDOMNamedNodeMap> am;
-	pNode->get_attributes(&am);
-
-	long lChildNodes;
-	am->get_length(&lChildNodes);
-
 	/* RGB data requires three attributes (R,G,B). */
 	/*if(lChildNodes != 3)*/
 
@@ -222,44 +216,29 @@ COLORREF NXMLSettings::ReadXMLColorData(IXMLDOMNode *pNode)
 	not need to be checked for, as each color
 	value is a byte, and can only hold values
 	between 0x00 and 0xFF. */
-	for (long i = 1; i < lChildNodes; i++)
+	for (size_t i = 1; i < element.attributes.size(); i++)
 	{
-		wil::com_ptr_nothrow<IXMLDOMNode> pChildNode;
-		am->get_item(i, &pChildNode);
-
-		/* Element name. */
-		wil::unique_bstr bstrName;
-		pChildNode->get_nodeName(&bstrName);
+		const auto &[name, value] = element.attributes[i];
 
-		/* Element value. */
-		wil::unique_bstr bstrValue;
-		pChildNode->get_text(&bstrValue);
-
-		if (lstrcmp(bstrName.get(), L"r") == 0)
+		if (name == L"r")
 		{
-			r = (BYTE) NXMLSettings::DecodeIntValue(bstrValue.get());
+			r = (BYTE) NXMLSettings::DecodeIntValue(value.c_str());
 		}
-		else if (lstrcmp(bstrName.get(), L"g") == 0)
+		else if (name == L"g")
 		{
-			g = (BYTE) NXMLSettings::DecodeIntValue(bstrValue.get());
+			g = (BYTE) NXMLSettings::DecodeIntValue(value.c_str());
 		}
-		else if (lstrcmp(bstrName.get(), L"b") == 0)
+		else if (name == L"b")
 		{
-			b = (BYTE) NXMLSettings::DecodeIntValue(bstrValue.get());
+			b = (BYTE) NXMLSettings::DecodeIntValue(value.c_str());
 		}
 	}
 
 	return RGB(r, g, b);
 }
 
-Gdiplus::Color NXMLSettings::ReadXMLColorData2(IXMLDOMNode *pNode)
+Gdiplus::Color NXMLSettings::ReadXMLColorData2(const XmlStreamReader::Element &element)
 {
-	wil::com_ptr_nothrow<IXMLDOMNamedNodeMap> am;
-	pNode->get_attributes(&am);
-
-	long lChildNodes;
-	am->get_length(&lChildNodes);
-
 	/* RGB data requires three attributes (R,G,B). */
 	/*if(lChildNodes != 3)*/
 
@@ -269,84 +248,62 @@ Gdiplus::Color NXMLSettings::ReadXMLColorData2(IXMLDOMNode *pNode)
 
 	/* Attribute name should be one of: r,g,b
 	Attribute value should be a value between 0x00 and 0xFF. */
-	for (long i = 1; i < lChildNodes; i++)
+	for (size_t i = 1; i < element.attributes.size(); i++)
 	{
-		wil::com_ptr_nothrow<IXMLDOMNode> pChildNode;
-		am->get_item(i, &pChildNode);
+		const auto &[name, value] = element.attributes[i];
 
-		/* Element name. */
-		wil::unique_bstr bstrName;
-		pChildNode->get_nodeName(&bstrName);
-
-		/* Element value. */
-		wil::unique_bstr bstrValue;
-		pChildNode->get_text(&bstrValue);
-
-		if (lstrcmp(bstrName.get(), L"r") == 0)
+		if (name == L"r")
 		{
-			r = (BYTE) NXMLSettings::DecodeIntValue(bstrValue.get());
+			r = (BYTE) NXMLSettings::DecodeIntValue(value.c_str());
 		}
-		else if (lstrcmp(bstrName.get(), L"g") == 0)
+		else if (name == L"g")
 		{
-			g = (BYTE) NXMLSettings::DecodeIntValue(bstrValue.get());
+			g = (BYTE) NXMLSettings::DecodeIntValue(value.c_str());
 		}
-		else if (lstrcmp(bstrName.get(), L"b") == 0)
+		else if (name == L"b")
 		{
-			b = (BYTE) NXMLSettings::DecodeIntValue(bstrValue.get());
+			b = (BYTE) NXMLSettings::DecodeIntValue(value.c_str());
 		}
 	}
 
 	return Gdiplus::Color(r, g, b);
 }
 
-HFONT NXMLSettings::ReadXMLFontData(IXMLDOMNode *pNode)
+HFONT NXMLSettings::ReadXMLFontData(const XmlStreamReader::Element &element)
 {
-	wil::com_ptr_nothrow<IXMLDOMNamedNodeMap> am;
-	pNode->get_attributes(&am);
-
-	long lChildNodes;
-	am->get_length(&lChildNodes);
-
 	LOGFONT fontInfo;
 
-	for (long i = 1; i < lChildNodes; i++)
+	for (size_t i = 1; i < element.attributes.size(); i++)
 	{
-		wil::com_ptr_nothrow<IXMLDOMNode> pChildNode;
-		am->get_item(i, &pChildNode);
-
-		wil::unique_bstr bstrName;
-		pChildNode->get_nodeName(&bstrName);
-
-		wil::unique_bstr bstrValue;
-		pChildNode->get_text(&bstrValue);
+		const auto &[name, value] = element.attributes[i];
 
-		if (lstrcmp(bstrName.get(), L"Height") == 0)
+		if (name == L"Height")
 		{
-			fontInfo.lfHeight = NXMLSettings::DecodeIntValue(bstrValue.get());
+			fontInfo.lfHeight = NXMLSettings::DecodeIntValue(value.c_str());
 		}
-		else if (lstrcmp(bstrName.get(), L"Width") == 0)
+		else if (name == L"Width")
 		{
-			fontInfo.lfWidth = NXMLSettings::DecodeIntValue(bstrValue.get());
+			fontInfo.lfWidth = NXMLSettings::DecodeIntValue(value.c_str());
 		}
-		else if (lstrcmp(bstrName.get(), L"Weight") == 0)
+		else if (name == L"Weight")
 		{
-			fontInfo.lfWeight = NXMLSettings::DecodeIntValue(bstrValue.get());
+			fontInfo.lfWeight = NXMLSettings::DecodeIntValue(value.c_str());
 		}
-		else if (lstrcmp(bstrName.get(), L"Italic") == 0)
+		else if (name == L"Italic")
 		{
-			fontInfo.lfItalic = (BYTE) NXMLSettings::DecodeBoolValue(bstrValue.get());
+			fontInfo.lfItalic = (BYTE) NXMLSettings::DecodeBoolValue(value.c_str());
 		}
-		else if (lstrcmp(bstrName.get(), L"Underline") == 0)
+		else if (name == L"Underline")
 		{
-			fontInfo.lfUnderline = (BYTE) NXMLSettings::DecodeBoolValue(bstrValue.get());
+			fontInfo.lfUnderline = (BYTE) NXMLSettings::DecodeBoolValue(value.c_str());
 		}
-		else if (lstrcmp(bstrName.get(), L"Strikeout") == 0)
+		else if (name == L"Strikeout")
 		{
-			fontInfo.lfStrikeOut = (BYTE) NXMLSettings::DecodeBoolValue(bstrValue.get());
+			fontInfo.lfStrikeOut = (BYTE) NXMLSettings::DecodeBoolValue(value.c_str());
 		}
-		else if (lstrcmp(bstrName.get(), L"Font") == 0)
+		else if (name == L"Font")
 		{
-			StringCchCopy(fontInfo.lfFaceName, SIZEOF_ARRAY(fontInfo.lfFaceName), bstrValue.get());
+			StringCchCopy(fontInfo.lfFaceName, SIZEOF_ARRAY(fontInfo.lfFaceName), value.c_str());
 		}
 	}
 
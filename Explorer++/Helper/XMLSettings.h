@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "XmlStreamReader.h"
 #include <MsXml2.h>
 #include <gdiplus.h>
 #include <objbase.h>
@@ -26,9 +27,9 @@ namespace NXMLSettings
 	BOOL DecodeBoolValue(const TCHAR *value);
 	WCHAR *EncodeIntValue(int iValue);
 	int DecodeIntValue(const WCHAR *wszValue);
-	COLORREF ReadXMLColorData(IXMLDOMNode *pNode);
-	Gdiplus::Color ReadXMLColorData2(IXMLDOMNode *pNode);
-	HFONT ReadXMLFontData(IXMLDOMNode *pNode);
+	COLORREF ReadXMLColorData(const XmlStreamReader::Element &element);
+	Gdiplus::Color ReadXMLColorData2(const XmlStreamReader::Element &element);
+	HFONT ReadXMLFontData(const XmlStreamReader::Element &element);
 
 	bool ReadDateTime(IXMLDOMNamedNodeMap *attributeMap, const std::wstring &baseKeyName,
 		FILETIME &dateTime);
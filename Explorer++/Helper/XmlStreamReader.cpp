@@ -0,0 +1,420 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "stdafx.h"
+#include "XmlStreamReader.h"
+#include "XMLSettings.h"
+#include <wil/com.h>
+#include <wil/resource.h>
+#include <wil/result.h>
+
+// Captured sections are written out using an MXXMLWriter, which acts as a SAX content handler, so
+// the events for a captured section can be forwarded to it unchanged.
+struct XmlStreamReader::Capture
+{
+	wil::com_ptr_nothrow<IMXWriter> writer;
+	wil::com_ptr_nothrow<ISAXContentHandler> contentHandler;
+	std::wstring *output = nullptr;
+};
+
+// Forwards the SAX events to the reader. The handler only exists for the duration of a single
+// parse, so it isn't reference counted.
+class XmlStreamReader::ContentHandler : public ISAXContentHandler
+{
+public:
+	ContentHandler(XmlStreamReader *reader) : m_reader(reader)
+	{
+	}
+
+	HRESULT __stdcall QueryInterface(REFIID iid, void **ppvObject) override
+	{
+		if (iid == __uuidof(ISAXContentHandler) || iid == IID_IUnknown)
+		{
+			*ppvObject = static_cast<ISAXContentHandler *>(this);
+			return S_OK;
+		}
+
+		*ppvObject = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	ULONG __stdcall AddRef() override
+	{
+		return 1;
+	}
+
+	ULONG __stdcall Release() override
+	{
+		return 1;
+	}
+
+	HRESULT __stdcall putDocumentLocator(ISAXLocator *locator) override
+	{
+		UNREFERENCED_PARAMETER(locator);
+
+		return S_OK;
+	}
+
+	HRESULT __stdcall startDocument() override
+	{
+		return m_reader->OnStartDocument();
+	}
+
+	HRESULT __stdcall endDocument() override
+	{
+		return m_reader->OnEndDocument();
+	}
+
+	HRESULT __stdcall startPrefixMapping(const wchar_t *prefix, int prefixLength,
+		const wchar_t *uri, int uriLength) override
+	{
+		UNREFERENCED_PARAMETER(prefix);
+		UNREFERENCED_PARAMETER(prefixLength);
+		UNREFERENCED_PARAMETER(uri);
+		UNREFERENCED_PARAMETER(uriLength);
+
+		return S_OK;
+	}
+
+	HRESULT __stdcall endPrefixMapping(const wchar_t *prefix, int prefixLength) override
+	{
+		UNREFERENCED_PARAMETER(prefix);
+		UNREFERENCED_PARAMETER(prefixLength);
+
+		return S_OK;
+	}
+
+	HRESULT __stdcall startElement(const wchar_t *namespaceUri, int namespaceUriLength,
+		const wchar_t *localName, int localNameLength, const wchar_t *qName, int qNameLength,
+		ISAXAttributes *attributes) override
+	{
+		return m_reader->OnStartElement(namespaceUri, namespaceUriLength, localName,
+			localNameLength, qName, qNameLength, attributes);
+	}
+
+	HRESULT __stdcall endElement(const wchar_t *namespaceUri, int namespaceUriLength,
+		const wchar_t *localName, int localNameLength, const wchar_t *qName,
+		int qNameLength) override
+	{
+		return m_reader->OnEndElement(namespaceUri, namespaceUriLength, localName, localNameLength,
+			qName, qNameLength);
+	}
+
+	HRESULT __stdcall characters(const wchar_t *chars, int length) override
+	{
+		return m_reader->OnCharacters(chars, length);
+	}
+
+	HRESULT __stdcall ignorableWhitespace(const wchar_t *chars, int length) override
+	{
+		UNREFERENCED_PARAMETER(chars);
+		UNREFERENCED_PARAMETER(length);
+
+		return S_OK;
+	}
+
+	HRESULT __stdcall processingInstruction(const wchar_t *target, int targetLength,
+		const wchar_t *data, int dataLength) override
+	{
+		UNREFERENCED_PARAMETER(target);
+		UNREFERENCED_PARAMETER(targetLength);
+		UNREFERENCED_PARAMETER(data);
+		UNREFERENCED_PARAMETER(dataLength);
+
+		return S_OK;
+	}
+
+	HRESULT __stdcall skippedEntity(const wchar_t *name, int length) override
+	{
+		UNREFERENCED_PARAMETER(name);
+		UNREFERENCED_PARAMETER(length);
+
+		return S_OK;
+	}
+
+private:
+	XmlStreamReader *const m_reader;
+};
+
+const std::wstring *XmlStreamReader::Element::GetAttribute(std::wstring_view attributeName) const
+{
+	for (const auto &[name, value] : attributes)
+	{
+		if (name == attributeName)
+		{
+			return &value;
+		}
+	}
+
+	return nullptr;
+}
+
+XmlStreamReader::~XmlStreamReader() = default;
+
+void XmlStreamReader::ReadSection(const std::wstring &sectionName, ElementCallback callback)
+{
+	m_readSections[sectionName] = std::move(callback);
+}
+
+void XmlStreamReader::CaptureSections(const std::vector<std::wstring> &sectionNames,
+	std::wstring *output)
+{
+	auto &capture = m_captures.emplace_back(std::make_unique<Capture>());
+	capture->output = output;
+
+	for (const auto &sectionName : sectionNames)
+	{
+		m_capturedSections[sectionName] = capture.get();
+	}
+}
+
+void XmlStreamReader::CaptureRemainingSections(std::wstring *output)
+{
+	auto &capture = m_captures.emplace_back(std::make_unique<Capture>());
+	capture->output = output;
+
+	m_remainingSectionsCapture = capture.get();
+}
+
+HRESULT XmlStreamReader::ReadFile(const std::wstring &filePath)
+{
+	return Read([&filePath](ISAXXMLReader *reader) { return reader->parseURL(filePath.c_str()); });
+}
+
+HRESULT XmlStreamReader::ReadString(const std::wstring &xml)
+{
+	return Read(
+		[&xml](ISAXXMLReader *reader)
+		{
+			wil::unique_variant input(NXMLSettings::VariantString(xml.c_str()));
+			return reader->parse(input);
+		});
+}
+
+HRESULT XmlStreamReader::Read(const std::function<HRESULT(ISAXXMLReader *reader)> &parse)
+{
+	wil::com_ptr_nothrow<ISAXXMLReader> reader;
+	HRESULT hr = CoCreateInstance(__uuidof(SAXXMLReader60), nullptr, CLSCTX_INPROC_SERVER,
+		IID_PPV_ARGS(&reader));
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	for (auto &capture : m_captures)
+	{
+		hr = CoCreateInstance(__uuidof(MXXMLWriter60), nullptr, CLSCTX_INPROC_SERVER,
+			IID_PPV_ARGS(&capture->writer));
+
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+
+		// The captured document is written to a string, so there's no need for a declaration
+		// (which would only serve to specify the encoding).
+		capture->writer->put_omitXMLDeclaration(VARIANT_TRUE);
+
+		hr = capture->writer.query_to(&capture->contentHandler);
+
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+	}
+
+	ContentHandler contentHandler(this);
+	hr = reader->putContentHandler(&contentHandler);
+
+	if (FAILED(hr))
+	{
+		return hr;
+	}
+
+	m_depth = 0;
+	m_currentReadSection = nullptr;
+	m_currentCapture = nullptr;
+	m_stopped = false;
+
+	hr = parse(reader.get());
+
+	reader->putContentHandler(nullptr);
+
+	if (m_stopped)
+	{
+		return S_OK;
+	}
+
+	return hr;
+}
+
+HRESULT XmlStreamReader::OnStartDocument()
+{
+	for (auto &capture : m_captures)
+	{
+		RETURN_IF_FAILED(capture->contentHandler->startDocument());
+	}
+
+	return S_OK;
+}
+
+HRESULT XmlStreamReader::OnStartElement(const wchar_t *namespaceUri, int namespaceUriLength,
+	const wchar_t *localName, int localNameLength, const wchar_t *qName, int qNameLength,
+	ISAXAttributes *attributes)
+{
+	int depth = m_depth++;
+
+	if (depth == 0)
+	{
+		// The root element is copied into each of the captured documents, so that each one has the
+		// same structure as the original document.
+		for (auto &capture : m_captures)
+		{
+			RETURN_IF_FAILED(capture->contentHandler->startElement(namespaceUri,
+				namespaceUriLength, localName, localNameLength, qName, qNameLength, attributes));
+		}
+
+		return S_OK;
+	}
+
+	if (depth == 1)
+	{
+		std::wstring sectionName(localName, localNameLength);
+
+		auto readItr = m_readSections.find(sectionName);
+		auto captureItr = m_capturedSections.find(sectionName);
+
+		if (readItr != m_readSections.end())
+		{
+			m_currentReadSection = &readItr->second;
+		}
+		else if (captureItr != m_capturedSections.end())
+		{
+			m_currentCapture = captureItr->second;
+		}
+		else
+		{
+			m_currentCapture = m_remainingSectionsCapture;
+		}
+	}
+
+	if (m_currentCapture)
+	{
+		return m_currentCapture->contentHandler->startElement(namespaceUri, namespaceUriLength,
+			localName, localNameLength, qName, qNameLength, attributes);
+	}
+
+	if (!m_currentReadSection || depth != 2)
+	{
+		return S_OK;
+	}
+
+	m_currentElement.name.assign(localName, localNameLength);
+	m_currentElement.attributes.clear();
+	m_currentElement.text.clear();
+
+	int numAttributes;
+	RETURN_IF_FAILED(attributes->getLength(&numAttributes));
+
+	for (int i = 0; i < numAttributes; i++)
+	{
+		const wchar_t *attributeName;
+		int attributeNameLength;
+		RETURN_IF_FAILED(attributes->getLocalName(i, &attributeName, &attributeNameLength));
+
+		const wchar_t *attributeValue;
+		int attributeValueLength;
+		RETURN_IF_FAILED(attributes->getValue(i, &attributeValue, &attributeValueLength));
+
+		m_currentElement.attributes.emplace_back(
+			std::wstring(attributeName, attributeNameLength),
+			std::wstring(attributeValue, attributeValueLength));
+	}
+
+	return S_OK;
+}
+
+HRESULT XmlStreamReader::OnEndElement(const wchar_t *namespaceUri, int namespaceUriLength,
+	const wchar_t *localName, int localNameLength, const wchar_t *qName, int qNameLength)
+{
+	int depth = --m_depth;
+
+	if (depth == 0)
+	{
+		for (auto &capture : m_captures)
+		{
+			RETURN_IF_FAILED(capture->contentHandler->endElement(namespaceUri, namespaceUriLength,
+				localName, localNameLength, qName, qNameLength));
+		}
+
+		return S_OK;
+	}
+
+	if (m_currentCapture)
+	{
+		HRESULT hr = m_currentCapture->contentHandler->endElement(namespaceUri, namespaceUriLength,
+			localName, localNameLength, qName, qNameLength);
+
+		if (depth == 1)
+		{
+			m_currentCapture = nullptr;
+		}
+
+		return hr;
+	}
+
+	if (!m_currentReadSection)
+	{
+		return S_OK;
+	}
+
+	if (depth == 1)
+	{
+		m_currentReadSection = nullptr;
+	}
+	else if (depth == 2 && !(*m_currentReadSection)(m_currentElement))
+	{
+		// Returning an error from the handler is the only way to stop the parser.
+		m_stopped = true;
+		return E_ABORT;
+	}
+
+	return S_OK;
+}
+
+HRESULT XmlStreamReader::OnCharacters(const wchar_t *chars, int length)
+{
+	if (m_currentCapture)
+	{
+		return m_currentCapture->contentHandler->characters(chars, length);
+	}
+
+	if (m_currentReadSection && m_depth > 2)
+	{
+		m_currentElement.text.append(chars, length);
+	}
+
+	return S_OK;
+}
+
+HRESULT XmlStreamReader::OnEndDocument()
+{
+	for (auto &capture : m_captures)
+	{
+		RETURN_IF_FAILED(capture->contentHandler->endDocument());
+
+		wil::unique_variant output;
+		RETURN_IF_FAILED(capture->writer->get_output(&output));
+
+		if (V_VT(&output) != VT_BSTR)
+		{
+			return E_UNEXPECTED;
+		}
+
+		capture->output->assign(V_BSTR(&output), SysStringLen(V_BSTR(&output)));
+	}
+
+	return S_OK;
+}
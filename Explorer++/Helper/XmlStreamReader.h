@@ -0,0 +1,84 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#pragma once
+
+#include <MsXml2.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Reads an XML document in a single forward pass, using the MSXML SAX parser. Unlike loading the
+// document into a DOM, no tree is built, so the cost of a section that isn't needed is limited to
+// parsing it.
+//
+// The document is treated as a root element containing a set of top-level sections. Each section
+// can be:
+//
+// - Read, in which case each element directly within the section is passed to a callback.
+// - Captured, in which case the section is written out (under a copy of the root element) as a
+//   separate XML document. That allows sections that are going to be loaded into a DOM to be
+//   loaded independently of the rest of the document (or not at all, if they're never needed).
+// - Ignored.
+class XmlStreamReader
+{
+public:
+	// An element within a section that's being read. Attributes are listed in document order.
+	struct Element
+	{
+		std::wstring name;
+		std::vector<std::pair<std::wstring, std::wstring>> attributes;
+
+		// The text within the element (including any text within nested elements).
+		std::wstring text;
+
+		const std::wstring *GetAttribute(std::wstring_view attributeName) const;
+	};
+
+	// Called once an element has been completely read. Returning false stops the document from
+	// being read any further (in which case, none of the captured sections are written out).
+	using ElementCallback = std::function<bool(const Element &element)>;
+
+	~XmlStreamReader();
+
+	void ReadSection(const std::wstring &sectionName, ElementCallback callback);
+	void CaptureSections(const std::vector<std::wstring> &sectionNames, std::wstring *output);
+
+	// Any section that isn't read or explicitly captured will be captured to the specified output.
+	void CaptureRemainingSections(std::wstring *output);
+
+	HRESULT ReadFile(const std::wstring &filePath);
+	HRESULT ReadString(const std::wstring &xml);
+
+private:
+	class ContentHandler;
+	struct Capture;
+
+	HRESULT Read(const std::function<HRESULT(ISAXXMLReader *reader)> &parse);
+
+	HRESULT OnStartDocument();
+	HRESULT OnStartElement(const wchar_t *namespaceUri, int namespaceUriLength,
+		const wchar_t *localName, int localNameLength, const wchar_t *qName, int qNameLength,
+		ISAXAttributes *attributes);
+	HRESULT OnEndElement(const wchar_t *namespaceUri, int namespaceUriLength,
+		const wchar_t *localName, int localNameLength, const wchar_t *qName, int qNameLength);
+	HRESULT OnCharacters(const wchar_t *chars, int length);
+	HRESULT OnEndDocument();
+
+	std::unordered_map<std::wstring, ElementCallback> m_readSections;
+	std::vector<std::unique_ptr<Capture>> m_captures;
+	std::unordered_map<std::wstring, Capture *> m_capturedSections;
+	Capture *m_remainingSectionsCapture = nullptr;
+
+	// The state of the current read.
+	int m_depth = 0;
+	const ElementCallback *m_currentReadSection = nullptr;
+	Capture *m_currentCapture = nullptr;
+	Element m_currentElement;
+	bool m_stopped = false;
+};
@@ -4,15 +4,23 @@
 
 #include "stdafx.h"
 #include "iDirectoryMonitor.h"
-#include "Macros.h"
-#include <list>
-
-DWORD WINAPI Thread_DirModifiedInternal(LPVOID Container);
-
+#include "DirectoryEventLog.h"
+#include "DirectorySnapshot.h"
+#include "Logging.h"
+#include <wil/resource.h>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// Every watched directory is associated with a single I/O completion port, which is serviced by
+// one thread. Completed reads are simply dequeued from the port, so any number of directories can
+// be watched without needing a thread (or an alertable wait) per directory.
 class DirectoryMonitor : public IDirectoryMonitor
 {
 public:
-	DirectoryMonitor();
+	DirectoryMonitor(DirectoryEventLog *eventLog);
 	~DirectoryMonitor();
 
 	HRESULT __stdcall QueryInterface(REFIID iid, void **ppvObject);
@@ -26,85 +34,107 @@ public:
 	BOOL StopDirectoryMonitor(int iStopId) override;
 
 private:
-#define PRIMARY_BUFFER_SIZE 1000 * sizeof(FILE_NOTIFY_INFORMATION)
-
-	/* These function are only ever queued as APC's. */
-	static void CALLBACK WatchAndCreateDirectoryInternal(ULONG_PTR dwParam);
-	static void CALLBACK CompletionRoutine(DWORD dwErrorCode, DWORD NumberOfBytesTransferred,
-		LPOVERLAPPED lpOverlapped);
-	static void CALLBACK StopDirectoryWatch(ULONG_PTR dwParam);
-
-	/* This function is called as an APC, and stops
-	the worker thread on exit. */
-	static void CALLBACK ExitWorkerThread(ULONG_PTR dwParam);
-
-	/* These are only called in the context of the
-	worker thread (i.e. they are called from APC's,
-	but are not queued as APC's themselves). */
-	static void CALLBACK WatchDirectoryInternal(ULONG_PTR dwParam);
-	static void DeleteRequest(ULONG_PTR dwParam);
-
-	class DirInfo
-	{
-	public:
-		OnDirectoryAltered m_OnDirectoryAltered;
-
-		DirectoryMonitor *m_pDirectoryMonitor;
-		FILE_NOTIFY_INFORMATION *m_FileNotifyBuffer;
-		HANDLE m_hThread;
-		HANDLE m_hDirectory;
-		OVERLAPPED m_Async;
-		LPVOID m_pData;
-		TCHAR m_DirPath[MAX_PATH];
-		UINT m_WatchFlags;
-		BOOL m_bWatchSubTree;
-		BOOL m_bMarkedForDeletion;
-		BOOL m_bDirMonitored;
-		int m_UniqueId;
+	// Large enough that a burst of changes can usually be returned by a single read. Note that
+	// reads fail on network shares if the buffer is larger than 64KB.
+	static constexpr DWORD BUFFER_SIZE = 64 * 1024;
+
+	// Buffers are reused once the changes in them have been processed. Most directories see
+	// little activity, so only a few spare buffers are kept.
+	static constexpr size_t MAX_POOLED_BUFFERS = 8;
+
+	// Commands are posted to the completion port without an OVERLAPPED structure. The command is
+	// passed as the number of bytes transferred and the watch id as the completion key.
+	enum class Command : DWORD
+	{
+		StartWatch,
+		StopWatch,
+		Exit
+	};
+
+	using Buffer = std::unique_ptr<std::byte[]>;
+
+	struct Watch
+	{
+		int id;
+		wil::unique_hfile directory;
+		std::wstring path;
+		UINT watchFlags;
+		BOOL watchSubtree;
+		OnDirectoryAltered onDirectoryAltered;
+		void *data;
+
+		OVERLAPPED overlapped;
+		Buffer buffer;
+		bool readPending = false;
+		bool stopping = false;
+
+		// Only kept for directories that aren't watched recursively. Allows any changes that are
+		// lost to be reconstructed. Since most directories never lose changes, the snapshot isn't
+		// taken until the first time they do.
+		std::optional<DirectorySnapshot> snapshot;
 	};
 
+	std::optional<int> AddWatch(std::unique_ptr<Watch> watch);
+	bool PostCommand(Command command, int watchId);
+
+	// These are only called on the worker thread.
+	void RunWorkerThread();
+	void ProcessCommand(Command command, int watchId);
+	void StartWatch(int watchId);
+	void StopWatch(Watch &watch);
+	void RemoveWatch(int watchId);
+	bool IssueRead(Watch &watch);
+	void OnReadCompleted(Watch &watch, DWORD error, DWORD numBytesTransferred);
+	void OnChangesLost(Watch &watch);
+	void DeliverChanges(const Watch &watch, const std::vector<DirectoryChange> &changes,
+		bool reconstructed);
+	static std::vector<DirectoryChange> ParseChanges(const std::byte *buffer,
+		DWORD numBytesTransferred);
+	Buffer AcquireBuffer();
+	void ReleaseBuffer(Buffer buffer);
+
 	int m_iRefCount;
-	DWORD m_ThreadId;
-	HANDLE m_hThread;
-	std::list<DirInfo> m_DirWatchInfoList;
-	CRITICAL_SECTION m_cs;
-	HANDLE m_hStopThreadEvent;
-	int m_UniqueId;
+	DirectoryEventLog *const m_eventLog;
+	wil::unique_handle m_completionPort;
+
+	std::mutex m_mutex;
+	int m_watchIdCounter;
+
+	// Watches that have been added, but haven't yet been started by the worker thread.
+	std::unordered_map<int, std::unique_ptr<Watch>> m_newWatches;
+
+	// Only accessed on the worker thread.
+	std::unordered_map<int, std::unique_ptr<Watch>> m_watches;
+	std::vector<Buffer> m_bufferPool;
+	bool m_exiting;
+
+	std::thread m_workerThread;
 };
 
-HRESULT CreateDirectoryMonitor(IDirectoryMonitor **pDirectoryMonitor)
+HRESULT CreateDirectoryMonitor(IDirectoryMonitor **pDirectoryMonitor,
+	DirectoryEventLog *eventLog)
 {
-	*pDirectoryMonitor = new DirectoryMonitor();
+	*pDirectoryMonitor = new DirectoryMonitor(eventLog);
 
 	return S_OK;
 }
 
-DirectoryMonitor::DirectoryMonitor()
+DirectoryMonitor::DirectoryMonitor(DirectoryEventLog *eventLog) :
+	m_iRefCount(1),
+	m_eventLog(eventLog),
+	m_completionPort(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1)),
+	m_watchIdCounter(0),
+	m_exiting(false)
 {
-	m_iRefCount = 1;
-	m_UniqueId = 0;
-	m_hThread = CreateThread(nullptr, 0, Thread_DirModifiedInternal, nullptr, 0, &m_ThreadId);
-
-	InitializeCriticalSection(&m_cs);
-
-	m_hStopThreadEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+	m_workerThread = std::thread(&DirectoryMonitor::RunWorkerThread, this);
 }
 
 DirectoryMonitor::~DirectoryMonitor()
 {
-	/* Queue the APC that will stop the worker
-	thread. */
-	QueueUserAPC(ExitWorkerThread, m_hThread, (ULONG_PTR) this);
-	CloseHandle(m_hThread);
-
-	/* Wait for the worker thread to stop. Once it
-	has been stopped, delete any dependent data
-	(such as any critical sections). */
-	WaitForSingleObject(m_hStopThreadEvent, INFINITE);
-
-	DeleteCriticalSection(&m_cs);
-	m_DirWatchInfoList.clear();
-	CloseHandle(m_hStopThreadEvent);
+	// The worker thread will stop each of the remaining watches and will only exit once all of
+	// the outstanding reads have been cancelled.
+	PostCommand(Command::Exit, 0);
+	m_workerThread.join();
 }
 
 /* IUnknown interface members. */
@@ -144,291 +174,411 @@ ULONG __stdcall DirectoryMonitor::Release()
 	return m_iRefCount;
 }
 
-DWORD WINAPI Thread_DirModifiedInternal(LPVOID lpParameter)
-{
-	UNREFERENCED_PARAMETER(lpParameter);
-
-	/* This is the main thread. Sleeps until woken up by a
-	change notification, and then goes back to sleep. */
-
-	SetErrorMode(SEM_FAILCRITICALERRORS);
-
-/* Warning C4127 (conditional expression is
-constant) temporarily disabled for this function. */
-#pragma warning(push)
-#pragma warning(disable : 4127)
-	while (TRUE)
-	{
-		SleepEx(INFINITE, TRUE);
-	}
-#pragma warning(pop)
-
-	return 0;
-}
-
-void CALLBACK DirectoryMonitor::ExitWorkerThread(ULONG_PTR dwParam)
-{
-	DirectoryMonitor *pdm = nullptr;
-
-	pdm = (DirectoryMonitor *) dwParam;
-
-	/* Set the event indicating that it is now
-	safe to destroy data that is shared between
-	threads. */
-	SetEvent(pdm->m_hStopThreadEvent);
-
-	ExitThread(0);
-}
-
 std::optional<int> DirectoryMonitor::WatchDirectory(const TCHAR *Directory, UINT WatchFlags,
 	OnDirectoryAltered onDirectoryAltered, BOOL bWatchSubTree, void *pData)
 {
-	DirInfo pDirInfo;
-
 	if (Directory == nullptr)
 	{
 		return std::nullopt;
 	}
 
-	pDirInfo.m_pDirectoryMonitor = this;
-	pDirInfo.m_hThread = m_hThread;
-	pDirInfo.m_WatchFlags = WatchFlags;
-	pDirInfo.m_UniqueId = m_UniqueId;
-	pDirInfo.m_OnDirectoryAltered = onDirectoryAltered;
-	pDirInfo.m_pData = pData;
-	pDirInfo.m_bWatchSubTree = bWatchSubTree;
-	pDirInfo.m_bMarkedForDeletion = FALSE;
-
 	/* This suppresses crtical error message boxes, such as the one
 	that mey arise from CreateFile() when opening attempting to
 	open a floppy drive that doesn't have a floppy disk (also
 	CD/DVD drives etc). */
 	SetErrorMode(SEM_FAILCRITICALERRORS);
 
-	StringCchCopy(pDirInfo.m_DirPath, SIZEOF_ARRAY(pDirInfo.m_DirPath), Directory);
-
-	pDirInfo.m_hDirectory = CreateFile(pDirInfo.m_DirPath, FILE_LIST_DIRECTORY,
+	HANDLE hDirectory = CreateFile(Directory, FILE_LIST_DIRECTORY,
 		FILE_SHARE_READ | FILE_SHARE_DELETE | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
 		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
 
-	if (pDirInfo.m_hDirectory == INVALID_HANDLE_VALUE)
+	if (hDirectory == INVALID_HANDLE_VALUE)
 	{
 		free(pData);
 		return std::nullopt;
 	}
 
-	EnterCriticalSection(&m_cs);
-
-	/* TODO: This operation alters the list, including the
-	previously inserted item (e.g by updating list pointers).
-	Therefore, need to lock access between this function and
-	other reads of the inserted item. */
-	m_DirWatchInfoList.push_back(pDirInfo);
-
-	m_DirWatchInfoList.back().m_Async.hEvent = &m_DirWatchInfoList.back();
-	QueueUserAPC(WatchDirectoryInternal, m_hThread, (ULONG_PTR) &m_DirWatchInfoList.back());
-
-	LeaveCriticalSection(&m_cs);
-
-	return m_UniqueId++;
+	return WatchDirectory(hDirectory, Directory, WatchFlags, onDirectoryAltered, bWatchSubTree,
+		pData);
 }
 
+// Note that the monitor takes ownership of the directory handle (which must have been opened with
+// FILE_FLAG_OVERLAPPED) and the data, both of which will be freed once the watch stops.
 std::optional<int> DirectoryMonitor::WatchDirectory(HANDLE hDirectory, const TCHAR *Directory,
 	UINT WatchFlags, OnDirectoryAltered onDirectoryAltered, BOOL bWatchSubTree, void *pData)
 {
-	DirInfo pDirInfo;
-
 	if (Directory == nullptr)
 	{
+		CloseHandle(hDirectory);
+		free(pData);
 		return std::nullopt;
 	}
 
-	pDirInfo.m_pDirectoryMonitor = this;
-	pDirInfo.m_hThread = m_hThread;
-	pDirInfo.m_WatchFlags = WatchFlags;
-	pDirInfo.m_UniqueId = m_UniqueId;
-	pDirInfo.m_OnDirectoryAltered = onDirectoryAltered;
-	pDirInfo.m_pData = pData;
-	pDirInfo.m_bWatchSubTree = bWatchSubTree;
-	pDirInfo.m_bMarkedForDeletion = FALSE;
+	auto watch = std::make_unique<Watch>();
+	watch->directory.reset(hDirectory);
+	watch->path = Directory;
+	watch->watchFlags = WatchFlags;
+	watch->watchSubtree = bWatchSubTree;
+	watch->onDirectoryAltered = onDirectoryAltered;
+	watch->data = pData;
 
-	/* This suppresses crtical error message boxes, such as the one
-	that mey arise from CreateFile() when opening attempting to
-	open a floppy drive that doesn't have a floppy disk (also
-	CD/DVD drives etc). */
-	SetErrorMode(SEM_FAILCRITICALERRORS);
+	return AddWatch(std::move(watch));
+}
+
+std::optional<int> DirectoryMonitor::AddWatch(std::unique_ptr<Watch> watch)
+{
+	int watchId;
 
-	StringCchCopy(pDirInfo.m_DirPath, SIZEOF_ARRAY(pDirInfo.m_DirPath), Directory);
+	{
+		std::scoped_lock lock(m_mutex);
 
-	pDirInfo.m_hDirectory = hDirectory;
+		watchId = m_watchIdCounter++;
+		watch->id = watchId;
+		m_newWatches.insert({ watchId, std::move(watch) });
+	}
 
-	EnterCriticalSection(&m_cs);
+	if (!PostCommand(Command::StartWatch, watchId))
+	{
+		std::scoped_lock lock(m_mutex);
 
-	m_DirWatchInfoList.push_back(pDirInfo);
-	m_DirWatchInfoList.back().m_Async.hEvent = &m_DirWatchInfoList.back();
-	// QueueUserAPC(WatchAndCreateDirectoryInternal,m_hThread,(ULONG_PTR)&m_DirWatchInfoList.back());
-	QueueUserAPC(WatchDirectoryInternal, m_hThread, (ULONG_PTR) &m_DirWatchInfoList.back());
+		auto itr = m_newWatches.find(watchId);
+		free(itr->second->data);
+		m_newWatches.erase(itr);
 
-	LeaveCriticalSection(&m_cs);
+		return std::nullopt;
+	}
 
-	return m_UniqueId++;
+	return watchId;
 }
 
-/* These functions (CreateFile and ReadDirectoryChangesW) DO NOT appear
-to put the thread in an alertable wait state. */
-void CALLBACK DirectoryMonitor::WatchAndCreateDirectoryInternal(ULONG_PTR dwParam)
+BOOL DirectoryMonitor::StopDirectoryMonitor(int iStopId)
 {
-	DirInfo *pDirInfo = nullptr;
+	return PostCommand(Command::StopWatch, iStopId);
+}
 
-	pDirInfo = reinterpret_cast<DirInfo *>(dwParam);
+bool DirectoryMonitor::PostCommand(Command command, int watchId)
+{
+	return PostQueuedCompletionStatus(m_completionPort.get(), static_cast<DWORD>(command),
+		static_cast<ULONG_PTR>(watchId), nullptr);
+}
 
-	pDirInfo->m_hDirectory = CreateFile(pDirInfo->m_DirPath, FILE_LIST_DIRECTORY,
-		FILE_SHARE_READ | FILE_SHARE_DELETE | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
-		FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+void DirectoryMonitor::RunWorkerThread()
+{
+	SetThreadErrorMode(SEM_FAILCRITICALERRORS, nullptr);
+
+	while (!m_exiting || !m_watches.empty())
+	{
+		DWORD numBytesTransferred;
+		ULONG_PTR completionKey;
+		OVERLAPPED *overlapped;
+		BOOL res = GetQueuedCompletionStatus(m_completionPort.get(), &numBytesTransferred,
+			&completionKey, &overlapped, INFINITE);
+		DWORD error = res ? ERROR_SUCCESS : GetLastError();
+
+		int watchId = static_cast<int>(completionKey);
+
+		if (!overlapped)
+		{
+			if (!res)
+			{
+				// The completion port itself has failed, so there's no way to continue.
+				LOG(error) << L"Directory monitor completion port failed with error " << error;
+				break;
+			}
 
-	WatchDirectoryInternal(dwParam);
+			ProcessCommand(static_cast<Command>(numBytesTransferred), watchId);
+			continue;
+		}
+
+		auto itr = m_watches.find(watchId);
+
+		if (itr == m_watches.end())
+		{
+			continue;
+		}
+
+		OnReadCompleted(*itr->second, error, numBytesTransferred);
+	}
 }
 
-void DirectoryMonitor::WatchDirectoryInternal(ULONG_PTR dwParam)
+void DirectoryMonitor::ProcessCommand(Command command, int watchId)
 {
-	DirInfo *pDirInfo = nullptr;
-
-	pDirInfo = reinterpret_cast<DirInfo *>(dwParam);
+	switch (command)
+	{
+	case Command::StartWatch:
+		StartWatch(watchId);
+		break;
 
-	if (pDirInfo->m_hDirectory == INVALID_HANDLE_VALUE)
+	case Command::StopWatch:
 	{
-		free(pDirInfo->m_pData);
+		auto itr = m_watches.find(watchId);
 
-		return;
+		if (itr != m_watches.end())
+		{
+			StopWatch(*itr->second);
+		}
 	}
+	break;
 
-	pDirInfo->m_FileNotifyBuffer = (FILE_NOTIFY_INFORMATION *) malloc(PRIMARY_BUFFER_SIZE);
+	case Command::Exit:
+	{
+		m_exiting = true;
 
-	pDirInfo->m_bDirMonitored = ReadDirectoryChangesW(pDirInfo->m_hDirectory,
-		pDirInfo->m_FileNotifyBuffer, PRIMARY_BUFFER_SIZE, pDirInfo->m_bWatchSubTree,
-		pDirInfo->m_WatchFlags, nullptr, &pDirInfo->m_Async, CompletionRoutine);
+		std::vector<int> watchIds;
 
-	if (!pDirInfo->m_bDirMonitored)
-	{
-		free(pDirInfo->m_FileNotifyBuffer);
-		CancelIo(pDirInfo->m_hDirectory);
-		CloseHandle(pDirInfo->m_hDirectory);
+		for (const auto &[id, watch] : m_watches)
+		{
+			watchIds.push_back(id);
+		}
+
+		for (int id : watchIds)
+		{
+			StopWatch(*m_watches.at(id));
+		}
+	}
+	break;
 	}
 }
 
-void CALLBACK DirectoryMonitor::CompletionRoutine(DWORD dwErrorCode, DWORD NumberOfBytesTransferred,
-	LPOVERLAPPED lpOverlapped)
+void DirectoryMonitor::StartWatch(int watchId)
 {
-	DirInfo *pDirInfo = nullptr;
-	FILE_NOTIFY_INFORMATION *pfni = nullptr;
-	TCHAR szFileName[MAX_PATH];
+	std::unique_ptr<Watch> watch;
 
-	if ((dwErrorCode == ERROR_SUCCESS) && (NumberOfBytesTransferred != 0))
 	{
-		if (lpOverlapped->hEvent == nullptr)
+		std::scoped_lock lock(m_mutex);
+
+		auto itr = m_newWatches.find(watchId);
+
+		if (itr == m_newWatches.end())
 		{
 			return;
 		}
 
-		pDirInfo = reinterpret_cast<DirInfo *>(lpOverlapped->hEvent);
-
-		pfni = pDirInfo->m_FileNotifyBuffer;
-		int i = 0;
+		watch = std::move(itr->second);
+		m_newWatches.erase(itr);
+	}
 
-		do
-		{
-			if (i != 0)
-			{
-				pfni = (FILE_NOTIFY_INFORMATION *) ((LPBYTE) pfni + pfni->NextEntryOffset);
-			}
+	auto [itr, inserted] = m_watches.insert({ watchId, std::move(watch) });
+	Watch &insertedWatch = *itr->second;
 
-			/* FileNameLength is size in bytes NOT characters. */
-			StringCchCopyN(szFileName, SIZEOF_ARRAY(szFileName), pfni->FileName,
-				pfni->FileNameLength / sizeof(TCHAR));
-			pDirInfo->m_OnDirectoryAltered(szFileName, pfni->Action, pDirInfo->m_pData);
+	HANDLE port = CreateIoCompletionPort(insertedWatch.directory.get(), m_completionPort.get(),
+		static_cast<ULONG_PTR>(watchId), 0);
 
-			i++;
-		} while (pfni->NextEntryOffset != 0);
+	if (!port || !IssueRead(insertedWatch))
+	{
+		LOG(warning) << L"Couldn't monitor directory \"" << insertedWatch.path
+					 << L"\" for changes.";
+		RemoveWatch(watchId);
+	}
+}
 
-		free(pDirInfo->m_FileNotifyBuffer);
+void DirectoryMonitor::StopWatch(Watch &watch)
+{
+	if (watch.stopping)
+	{
+		return;
+	}
 
-		pDirInfo->m_FileNotifyBuffer = nullptr;
+	watch.stopping = true;
 
-		/* Rewatch the directory. */
-		WatchDirectoryInternal((ULONG_PTR) pDirInfo);
+	if (!watch.readPending)
+	{
+		RemoveWatch(watch.id);
+		return;
 	}
-	else if (dwErrorCode == ERROR_OPERATION_ABORTED)
+
+	// The watch will be removed once the cancelled read has completed, since the buffer and
+	// OVERLAPPED structure are in use until that point.
+	CancelIoEx(watch.directory.get(), &watch.overlapped);
+}
+
+void DirectoryMonitor::RemoveWatch(int watchId)
+{
+	auto itr = m_watches.find(watchId);
+
+	if (itr == m_watches.end())
 	{
-		pDirInfo = reinterpret_cast<DirInfo *>(lpOverlapped->hEvent);
+		return;
+	}
+
+	free(itr->second->data);
+	ReleaseBuffer(std::move(itr->second->buffer));
+	m_watches.erase(itr);
+}
 
-		/* The specified directory has stop been watched.
-		Remove its entry from the queue. */
-		DeleteRequest((ULONG_PTR) pDirInfo);
+bool DirectoryMonitor::IssueRead(Watch &watch)
+{
+	if (!watch.buffer)
+	{
+		watch.buffer = AcquireBuffer();
 	}
+
+	ZeroMemory(&watch.overlapped, sizeof(watch.overlapped));
+
+	watch.readPending = ReadDirectoryChangesW(watch.directory.get(), watch.buffer.get(),
+		BUFFER_SIZE, watch.watchSubtree, watch.watchFlags, nullptr, &watch.overlapped, nullptr);
+
+	return watch.readPending;
 }
 
-void DirectoryMonitor::DeleteRequest(ULONG_PTR dwParam)
+void DirectoryMonitor::OnReadCompleted(Watch &watch, DWORD error, DWORD numBytesTransferred)
 {
-	DirInfo *pDirInfo = nullptr;
-	DirectoryMonitor *pDirectoryMonitor = nullptr;
-	std::list<DirInfo>::iterator itr;
+	watch.readPending = false;
+
+	if (watch.stopping)
+	{
+		RemoveWatch(watch.id);
+		return;
+	}
+
+	// If more changes occur than can fit in the buffer, the read still succeeds, but no changes
+	// are returned.
+	if (error == ERROR_NOTIFY_ENUM_DIR || (error == ERROR_SUCCESS && numBytesTransferred == 0))
+	{
+		bool readIssued = IssueRead(watch);
 
-	pDirInfo = reinterpret_cast<DirInfo *>(dwParam);
+		OnChangesLost(watch);
 
-	pDirectoryMonitor = pDirInfo->m_pDirectoryMonitor;
+		if (!readIssued)
+		{
+			RemoveWatch(watch.id);
+		}
 
-	free(pDirInfo->m_FileNotifyBuffer);
-	free(pDirInfo->m_pData);
+		return;
+	}
 
-	EnterCriticalSection(&pDirectoryMonitor->m_cs);
+	if (error != ERROR_SUCCESS)
+	{
+		// This can happen if the directory has been deleted, or the drive it's on has been
+		// removed.
+		LOG(info) << L"Stopped monitoring directory \"" << watch.path << L"\" (error " << error
+				  << L")";
+		RemoveWatch(watch.id);
+		return;
+	}
+
+	// The next read is issued (using a different buffer) before the changes are processed, so
+	// that changes made while the callback is running will still be picked up.
+	Buffer completedBuffer = std::move(watch.buffer);
+	bool readIssued = IssueRead(watch);
+
+	auto changes = ParseChanges(completedBuffer.get(), numBytesTransferred);
+	ReleaseBuffer(std::move(completedBuffer));
 
-	for (itr = pDirectoryMonitor->m_DirWatchInfoList.begin();
-		 itr != pDirectoryMonitor->m_DirWatchInfoList.end(); itr++)
+	if (watch.snapshot)
 	{
-		if (itr->m_UniqueId == pDirInfo->m_UniqueId)
+		for (const auto &change : changes)
 		{
-			pDirectoryMonitor->m_DirWatchInfoList.erase(itr);
-			break;
+			watch.snapshot->ApplyChange(change);
 		}
 	}
 
-	LeaveCriticalSection(&pDirectoryMonitor->m_cs);
+	DeliverChanges(watch, changes, false);
+
+	if (!readIssued)
+	{
+		RemoveWatch(watch.id);
+	}
 }
 
-BOOL DirectoryMonitor::StopDirectoryMonitor(int iStopId)
+void DirectoryMonitor::OnChangesLost(Watch &watch)
 {
-	std::list<DirInfo>::iterator itr;
-
-	EnterCriticalSection(&m_cs);
-
-	for (itr = m_DirWatchInfoList.begin(); itr != m_DirWatchInfoList.end(); itr++)
+	if (watch.snapshot)
 	{
-		if (itr->m_UniqueId == iStopId)
+		auto currentSnapshot = DirectorySnapshot::Capture(watch.path);
+
+		if (currentSnapshot)
 		{
-			/* Only stop monitoring the directory if it was
-			actually monitored in the first place! */
-			if (itr->m_bDirMonitored)
+			auto changes = watch.snapshot->Compare(*currentSnapshot);
+			watch.snapshot = std::move(currentSnapshot);
+
+			LOG(debug) << L"Changes lost for directory \"" << watch.path << L"\", "
+					   << changes.size() << L" changes reconstructed";
+
+			if (!changes.empty())
 			{
-				QueueUserAPC(StopDirectoryWatch, m_hThread, (ULONG_PTR) itr->m_hDirectory);
+				DeliverChanges(watch, changes, true);
 			}
 
-			break;
+			return;
 		}
+
+		watch.snapshot.reset();
 	}
 
-	LeaveCriticalSection(&m_cs);
+	LOG(debug) << L"Changes lost for directory \"" << watch.path << L"\", resync required";
+
+	DeliverChanges(watch, { { DIRECTORY_MONITOR_ACTION_RESYNC, {} } }, true);
 
-	return TRUE;
+	// Changes have been lost once, so they may well be lost again. Taking a snapshot now means any
+	// further losses can be reconstructed. The next read has already been issued at this point, so
+	// changes made while the snapshot is being taken will still be reported.
+	if (!watch.watchSubtree && watch.readPending)
+	{
+		watch.snapshot = DirectorySnapshot::Capture(watch.path);
+	}
 }
 
-void CALLBACK DirectoryMonitor::StopDirectoryWatch(ULONG_PTR dwParam)
+void DirectoryMonitor::DeliverChanges(const Watch &watch,
+	const std::vector<DirectoryChange> &changes, bool reconstructed)
 {
-	HANDLE hDirectory;
+	if (changes.empty())
+	{
+		return;
+	}
 
-	hDirectory = reinterpret_cast<HANDLE>(dwParam);
+	if (m_eventLog)
+	{
+		m_eventLog->Record(watch.id, changes, reconstructed);
+	}
+
+	watch.onDirectoryAltered(changes, watch.data);
+}
+
+std::vector<DirectoryChange> DirectoryMonitor::ParseChanges(const std::byte *buffer,
+	DWORD numBytesTransferred)
+{
+	std::vector<DirectoryChange> changes;
+	DWORD offset = 0;
 
-	CancelIo(hDirectory);
-	CloseHandle(hDirectory);
+	while (offset + offsetof(FILE_NOTIFY_INFORMATION, FileName) <= numBytesTransferred)
+	{
+		auto *notifyInfo = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(buffer + offset);
+
+		/* FileNameLength is size in bytes NOT characters. */
+		changes.push_back({ notifyInfo->Action,
+			std::wstring(notifyInfo->FileName, notifyInfo->FileNameLength / sizeof(WCHAR)) });
+
+		if (notifyInfo->NextEntryOffset == 0)
+		{
+			break;
+		}
+
+		offset += notifyInfo->NextEntryOffset;
+	}
+
+	return changes;
+}
+
+DirectoryMonitor::Buffer DirectoryMonitor::AcquireBuffer()
+{
+	if (m_bufferPool.empty())
+	{
+		return std::make_unique_for_overwrite<std::byte[]>(BUFFER_SIZE);
+	}
+
+	Buffer buffer = std::move(m_bufferPool.back());
+	m_bufferPool.pop_back();
+
+	return buffer;
+}
+
+void DirectoryMonitor::ReleaseBuffer(Buffer buffer)
+{
+	if (!buffer || m_bufferPool.size() >= MAX_POOLED_BUFFERS)
+	{
+		return;
+	}
 
-	hDirectory = nullptr;
+	m_bufferPool.push_back(std::move(buffer));
 }
@@ -6,8 +6,28 @@
 
 #include <windows.h>
 #include <optional>
+#include <string>
+#include <vector>
 
-typedef void (*OnDirectoryAltered)(const TCHAR *szFileName, DWORD dwAction, void *pData);
+class DirectoryEventLog;
+
+// Sent (with an empty filename) when changes to a directory were lost and couldn't be
+// reconstructed. That can happen if changes arrive faster than they can be read, for a directory
+// that's being watched recursively. Anything shown from the directory should be checked against
+// what's currently on disk.
+constexpr DWORD DIRECTORY_MONITOR_ACTION_RESYNC = 0x1000;
+
+struct DirectoryChange
+{
+	// One of the FILE_ACTION_* values, or DIRECTORY_MONITOR_ACTION_RESYNC.
+	DWORD action;
+
+	// Relative to the directory being watched.
+	std::wstring fileName;
+};
+
+// All of the changes reported by a single read are passed to the callback together.
+typedef void (*OnDirectoryAltered)(const std::vector<DirectoryChange> &changes, void *pData);
 
 /* Main exported interface. */
 __interface IDirectoryMonitor : IUnknown
@@ -19,4 +39,6 @@ __interface IDirectoryMonitor : IUnknown
 	BOOL StopDirectoryMonitor(int iStopIndex);
 };
 
-HRESULT CreateDirectoryMonitor(IDirectoryMonitor **pDirectoryMonitor);
+// If an event log is provided, every change reported by the monitor will be recorded in it.
+HRESULT CreateDirectoryMonitor(IDirectoryMonitor **pDirectoryMonitor,
+	DirectoryEventLog *eventLog = nullptr);
@@ -0,0 +1,287 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "Bookmarks/BookmarkJournal.h"
+#include "BookmarkStorageHelper.h"
+#include "Bookmarks/BookmarkTree.h"
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+namespace
+{
+
+class BookmarkJournalTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		TCHAR tempPath[MAX_PATH];
+		DWORD res = GetTempPath(MAX_PATH, tempPath);
+		ASSERT_NE(res, 0U);
+
+		TCHAR tempFile[MAX_PATH];
+		UINT uniqueRes = GetTempFileName(tempPath, L"exp", 0, tempFile);
+		ASSERT_NE(uniqueRes, 0U);
+		m_snapshotPath = tempFile;
+
+		uniqueRes = GetTempFileName(tempPath, L"exp", 0, tempFile);
+		ASSERT_NE(uniqueRes, 0U);
+		m_journalPath = tempFile;
+	}
+
+	void TearDown() override
+	{
+		DeleteFile(m_snapshotPath.c_str());
+		DeleteFile((m_snapshotPath + L".tmp").c_str());
+		DeleteFile(m_journalPath.c_str());
+	}
+
+	std::unique_ptr<BookmarkJournal> CreateJournal(BookmarkTree *bookmarkTree,
+		int compactionThreshold = BookmarkJournal::DEFAULT_COMPACTION_THRESHOLD)
+	{
+		return std::make_unique<BookmarkJournal>(bookmarkTree, m_snapshotPath, m_journalPath,
+			compactionThreshold);
+	}
+
+	// Makes a set of changes that covers each of the different types of journal record.
+	void ModifyTree(BookmarkTree *bookmarkTree)
+	{
+		auto folder = std::make_unique<BookmarkItem>(std::nullopt, L"New folder", std::nullopt);
+		auto bookmark = std::make_unique<BookmarkItem>(std::nullopt, L"Nested", L"C:\\Windows");
+		folder->AddChild(std::move(bookmark));
+		auto *rawFolder = bookmarkTree->AddBookmarkItem(bookmarkTree->GetBookmarksToolbarFolder(),
+			std::move(folder), 1);
+
+		auto *menuFolder = bookmarkTree->GetBookmarksMenuFolder();
+		menuFolder->GetChildren()[0]->SetName(L"Renamed folder");
+		menuFolder->GetChildren()[2]->SetLocation(L"D:\\");
+
+		bookmarkTree->MoveBookmarkItem(menuFolder->GetChildren()[0].get(), menuFolder, 3);
+		bookmarkTree->MoveBookmarkItem(menuFolder->GetChildren()[0].get(), rawFolder, 0);
+
+		bookmarkTree->RemoveBookmarkItem(
+			bookmarkTree->GetOtherBookmarksFolder()->GetChildren()[0].get());
+	}
+
+	ULONGLONG GetJournalSize() const
+	{
+		WIN32_FILE_ATTRIBUTE_DATA fileData;
+		BOOL res = GetFileAttributesEx(m_journalPath.c_str(), GetFileExInfoStandard, &fileData);
+		EXPECT_TRUE(res);
+
+		ULARGE_INTEGER size;
+		size.LowPart = fileData.nFileSizeLow;
+		size.HighPart = fileData.nFileSizeHigh;
+		return size.QuadPart;
+	}
+
+	std::string ReadJournalContents() const
+	{
+		std::ifstream file(m_journalPath, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(file), {});
+	}
+
+	std::wstring m_snapshotPath;
+	std::wstring m_journalPath;
+};
+
+TEST_F(BookmarkJournalTest, SaveLoad)
+{
+	BookmarkTree bookmarkTree;
+	BuildV2LoadSaveReferenceTree(&bookmarkTree);
+
+	auto journal = CreateJournal(&bookmarkTree);
+
+	// There's no saved state yet, so starting the journal should write an initial snapshot.
+	EXPECT_FALSE(journal->Load());
+	ASSERT_TRUE(journal->Start());
+	EXPECT_TRUE(journal->IsActive());
+
+	ModifyTree(&bookmarkTree);
+	EXPECT_EQ(journal->GetNumJournalRecords(), 6);
+	journal.reset();
+
+	BookmarkTree loadedBookmarkTree;
+	auto loadedJournal = CreateJournal(&loadedBookmarkTree);
+	ASSERT_TRUE(loadedJournal->Load());
+	EXPECT_EQ(loadedJournal->GetNumJournalRecords(), 6);
+
+	CompareBookmarkTrees(&loadedBookmarkTree, &bookmarkTree, true);
+}
+
+TEST_F(BookmarkJournalTest, ContinueAfterLoad)
+{
+	BookmarkTree bookmarkTree;
+	BuildV2LoadSaveReferenceTree(&bookmarkTree);
+
+	auto journal = CreateJournal(&bookmarkTree);
+	ASSERT_TRUE(journal->Start());
+	ModifyTree(&bookmarkTree);
+	journal.reset();
+
+	BookmarkTree loadedBookmarkTree;
+	auto loadedJournal = CreateJournal(&loadedBookmarkTree);
+	ASSERT_TRUE(loadedJournal->Load());
+	ASSERT_TRUE(loadedJournal->Start());
+
+	auto bookmark = std::make_unique<BookmarkItem>(std::nullopt, L"New bookmark", L"C:\\");
+	loadedBookmarkTree.AddBookmarkItem(loadedBookmarkTree.GetOtherBookmarksFolder(),
+		std::move(bookmark), 0);
+	loadedJournal.reset();
+
+	BookmarkTree reloadedBookmarkTree;
+	auto reloadedJournal = CreateJournal(&reloadedBookmarkTree);
+	ASSERT_TRUE(reloadedJournal->Load());
+
+	CompareBookmarkTrees(&reloadedBookmarkTree, &loadedBookmarkTree, true);
+}
+
+TEST_F(BookmarkJournalTest, Compaction)
+{
+	BookmarkTree bookmarkTree;
+	BuildV2LoadSaveReferenceTree(&bookmarkTree);
+
+	auto journal = CreateJournal(&bookmarkTree, 3);
+	ASSERT_TRUE(journal->Start());
+
+	ModifyTree(&bookmarkTree);
+	EXPECT_LT(journal->GetNumJournalRecords(), 3);
+	journal.reset();
+
+	BookmarkTree loadedBookmarkTree;
+	auto loadedJournal = CreateJournal(&loadedBookmarkTree);
+	ASSERT_TRUE(loadedJournal->Load());
+
+	CompareBookmarkTrees(&loadedBookmarkTree, &bookmarkTree, true);
+}
+
+// Once the tree has been saved in full, the journal no longer has anything to add, so it shouldn't
+// be loaded. It still matches the full save though, so it should be appended to, rather than
+// having a new snapshot written.
+TEST_F(BookmarkJournalTest, SavedInFull)
+{
+	BookmarkTree bookmarkTree;
+	BuildV2LoadSaveReferenceTree(&bookmarkTree);
+
+	auto journal = CreateJournal(&bookmarkTree);
+	ASSERT_TRUE(journal->Start());
+
+	// There are no changes at this point, since the tree was loaded from a full save.
+	journal.reset();
+	std::string journalContents = ReadJournalContents();
+
+	journal = CreateJournal(&bookmarkTree);
+	EXPECT_FALSE(journal->Load());
+	ASSERT_TRUE(journal->Start());
+	EXPECT_EQ(ReadJournalContents(), journalContents);
+
+	ModifyTree(&bookmarkTree);
+	journal->OnTreeSaved();
+	EXPECT_EQ(journal->GetNumJournalRecords(), 7);
+	journal.reset();
+
+	journal = CreateJournal(&bookmarkTree);
+	EXPECT_FALSE(journal->Load());
+	ASSERT_TRUE(journal->Start());
+	EXPECT_EQ(journal->GetNumJournalRecords(), 7);
+
+	// This change was made after the full save, so the journal should be loaded again.
+	auto bookmark = std::make_unique<BookmarkItem>(std::nullopt, L"New bookmark", L"C:\\");
+	bookmarkTree.AddBookmarkItem(bookmarkTree.GetOtherBookmarksFolder(), std::move(bookmark), 0);
+	journal.reset();
+
+	BookmarkTree loadedBookmarkTree;
+	auto loadedJournal = CreateJournal(&loadedBookmarkTree);
+	ASSERT_TRUE(loadedJournal->Load());
+	EXPECT_EQ(loadedJournal->GetNumJournalRecords(), 8);
+
+	CompareBookmarkTrees(&loadedBookmarkTree, &bookmarkTree, true);
+}
+
+TEST_F(BookmarkJournalTest, UsedByAnotherInstance)
+{
+	BookmarkTree bookmarkTree;
+	BuildV2LoadSaveReferenceTree(&bookmarkTree);
+
+	auto journal = CreateJournal(&bookmarkTree);
+	ASSERT_TRUE(journal->Start());
+	ModifyTree(&bookmarkTree);
+
+	// The files are in use, so the second journal shouldn't be able to load or record anything.
+	BookmarkTree otherBookmarkTree;
+	auto otherJournal = CreateJournal(&otherBookmarkTree);
+	EXPECT_FALSE(otherJournal->Load());
+	EXPECT_FALSE(otherJournal->Start());
+	EXPECT_FALSE(otherJournal->IsActive());
+	otherJournal.reset();
+
+	EXPECT_TRUE(journal->IsActive());
+	journal.reset();
+
+	// Once the first journal has been closed, the files are available again.
+	BookmarkTree loadedBookmarkTree;
+	auto loadedJournal = CreateJournal(&loadedBookmarkTree);
+	ASSERT_TRUE(loadedJournal->Load());
+
+	CompareBookmarkTrees(&loadedBookmarkTree, &bookmarkTree, true);
+}
+
+// Simulates a crash that occurs while a record is being written. The partial record should be
+// ignored, with the state being restored to what it was after the previous record.
+TEST_F(BookmarkJournalTest, PartialRecord)
+{
+	BookmarkTree bookmarkTree;
+	auto journal = CreateJournal(&bookmarkTree);
+	ASSERT_TRUE(journal->Start());
+
+	auto bookmark = std::make_unique<BookmarkItem>(std::nullopt, L"Original name", L"C:\\");
+	auto *rawBookmark = bookmarkTree.AddBookmarkItem(bookmarkTree.GetBookmarksMenuFolder(),
+		std::move(bookmark), 0);
+	std::wstring guid = rawBookmark->GetGUID();
+	ULONGLONG journalSize = GetJournalSize();
+
+	rawBookmark->SetName(L"Updated name");
+	journal.reset();
+
+	{
+		wil::unique_hfile file(CreateFile(m_journalPath.c_str(), GENERIC_WRITE, 0, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+		ASSERT_TRUE(file);
+
+		LARGE_INTEGER distance;
+		distance.QuadPart = journalSize + 3;
+		ASSERT_TRUE(SetFilePointerEx(file.get(), distance, nullptr, FILE_BEGIN));
+		ASSERT_TRUE(SetEndOfFile(file.get()));
+	}
+
+	BookmarkTree loadedBookmarkTree;
+	auto loadedJournal = CreateJournal(&loadedBookmarkTree);
+	ASSERT_TRUE(loadedJournal->Load());
+	EXPECT_EQ(loadedJournal->GetNumJournalRecords(), 1);
+
+	auto *loadedBookmark = loadedBookmarkTree.GetBookmarkItemById(guid);
+	ASSERT_NE(loadedBookmark, nullptr);
+	EXPECT_EQ(loadedBookmark->GetName(), L"Original name");
+
+	// The partial record should be discarded once the journal is started again, so that any
+	// further records aren't lost behind it.
+	ASSERT_TRUE(loadedJournal->Start());
+	EXPECT_EQ(GetJournalSize(), journalSize);
+
+	loadedBookmark->SetName(L"Second name");
+	loadedJournal.reset();
+
+	BookmarkTree reloadedBookmarkTree;
+	auto reloadedJournal = CreateJournal(&reloadedBookmarkTree);
+	ASSERT_TRUE(reloadedJournal->Load());
+
+	auto *reloadedBookmark = reloadedBookmarkTree.GetBookmarkItemById(guid);
+	ASSERT_NE(reloadedBookmark, nullptr);
+	EXPECT_EQ(reloadedBookmark->GetName(), L"Second name");
+}
+
+}
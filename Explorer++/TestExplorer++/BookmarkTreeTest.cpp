@@ -138,6 +138,83 @@ TEST(BookmarkTreeTest, RemoveChildren)
 	EXPECT_EQ(bookmarkTree.GetOtherBookmarksFolder()->GetChildren().size(), 0);
 }
 
+TEST(BookmarkTreeTest, GetBookmarkItemById)
+{
+	BookmarkTree bookmarkTree;
+
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(bookmarkTree.GetRoot()->GetGUID()),
+		bookmarkTree.GetRoot());
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(bookmarkTree.GetBookmarksMenuFolder()->GetGUID()),
+		bookmarkTree.GetBookmarksMenuFolder());
+
+	auto folder = std::make_unique<BookmarkItem>(std::nullopt, L"Test folder", std::nullopt);
+	auto rawFolder = folder.get();
+
+	auto bookmark = std::make_unique<BookmarkItem>(std::nullopt, L"Test bookmark", L"C:\\");
+	auto rawBookmark = bookmark.get();
+	folder->AddChild(std::move(bookmark));
+
+	// Items that are nested within an added folder should be indexed as well.
+	bookmarkTree.AddBookmarkItem(bookmarkTree.GetBookmarksMenuFolder(), std::move(folder), 0);
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(rawFolder->GetGUID()), rawFolder);
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(rawBookmark->GetGUID()), rawBookmark);
+
+	bookmarkTree.MoveBookmarkItem(rawFolder, bookmarkTree.GetOtherBookmarksFolder(), 0);
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(rawBookmark->GetGUID()), rawBookmark);
+
+	std::wstring folderGuid = rawFolder->GetGUID();
+	std::wstring bookmarkGuid = rawBookmark->GetGUID();
+	bookmarkTree.RemoveBookmarkItem(rawFolder);
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(folderGuid), nullptr);
+	EXPECT_EQ(bookmarkTree.GetBookmarkItemById(bookmarkGuid), nullptr);
+}
+
+TEST(BookmarkTreeTest, ChildIndexes)
+{
+	BookmarkTree bookmarkTree;
+	BookmarkItem *folder = bookmarkTree.GetBookmarksToolbarFolder();
+	std::vector<BookmarkItem *> rawBookmarks;
+
+	for (int i = 0; i < 10; i++)
+	{
+		auto bookmark = std::make_unique<BookmarkItem>(std::nullopt,
+			L"Test bookmark " + std::to_wstring(i), L"C:\\");
+		rawBookmarks.insert(rawBookmarks.begin(), bookmark.get());
+		bookmarkTree.AddBookmarkItem(folder, std::move(bookmark), 0);
+	}
+
+	auto verifyIndexes = [folder, &rawBookmarks]()
+	{
+		for (size_t i = 0; i < rawBookmarks.size(); i++)
+		{
+			EXPECT_EQ(folder->GetChildIndex(rawBookmarks[i]), i);
+			EXPECT_EQ(folder->GetChildren()[i].get(), rawBookmarks[i]);
+		}
+	};
+
+	verifyIndexes();
+
+	bookmarkTree.MoveBookmarkItem(rawBookmarks[2], folder, 7);
+	std::rotate(rawBookmarks.begin() + 2, rawBookmarks.begin() + 3, rawBookmarks.begin() + 7);
+	verifyIndexes();
+
+	bookmarkTree.MoveBookmarkItem(rawBookmarks[8], folder, 0);
+	std::rotate(rawBookmarks.begin(), rawBookmarks.begin() + 8, rawBookmarks.begin() + 9);
+	verifyIndexes();
+
+	bookmarkTree.RemoveBookmarkItem(rawBookmarks[4]);
+	rawBookmarks.erase(rawBookmarks.begin() + 4);
+	verifyIndexes();
+
+	BookmarkItem *movedBookmark = rawBookmarks[5];
+	bookmarkTree.MoveBookmarkItem(movedBookmark, bookmarkTree.GetOtherBookmarksFolder(), 0);
+	rawBookmarks.erase(rawBookmarks.begin() + 5);
+	verifyIndexes();
+
+	EXPECT_EQ(bookmarkTree.GetOtherBookmarksFolder()->GetChildIndex(movedBookmark), 0);
+	EXPECT_THROW(folder->GetChildIndex(movedBookmark), std::invalid_argument);
+}
+
 TEST_F(BookmarkTreeObserverTest, Add)
 {
 	m_bookmarkTree.bookmarkItemAddedSignal.AddObserver(
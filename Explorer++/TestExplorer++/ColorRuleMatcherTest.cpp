@@ -0,0 +1,95 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/ColorRuleMatcher.h"
+#include <gtest/gtest.h>
+
+using namespace NColorRuleHelper;
+
+namespace
+{
+
+ColorRule MakeColorRule(const std::wstring &pattern, BOOL caseInsensitive, DWORD attributes,
+	COLORREF color)
+{
+	return { L"", pattern, caseInsensitive, attributes, color };
+}
+
+}
+
+TEST(ColorRuleMatcherTest, ExtensionPatterns)
+{
+	ColorRuleMatcher matcher({ MakeColorRule(L"*.h: *.cpp :*.txt", FALSE, 0, RGB(255, 0, 0)) });
+
+	EXPECT_EQ(matcher.GetMatchingColor(L"main.cpp", 0), RGB(255, 0, 0));
+	EXPECT_EQ(matcher.GetMatchingColor(L"file.h", 0), RGB(255, 0, 0));
+	EXPECT_EQ(matcher.GetMatchingColor(L"archive.old.txt", 0), RGB(255, 0, 0));
+	EXPECT_EQ(matcher.GetMatchingColor(L".txt", 0), RGB(255, 0, 0));
+
+	EXPECT_EQ(matcher.GetMatchingColor(L"main.cpp.bak", 0), std::nullopt);
+	EXPECT_EQ(matcher.GetMatchingColor(L"cpp", 0), std::nullopt);
+	EXPECT_EQ(matcher.GetMatchingColor(L"file.", 0), std::nullopt);
+}
+
+TEST(ColorRuleMatcherTest, CaseSensitivity)
+{
+	ColorRuleMatcher caseSensitiveMatcher({ MakeColorRule(L"*.TXT", FALSE, 0, RGB(1, 2, 3)) });
+	EXPECT_EQ(caseSensitiveMatcher.GetMatchingColor(L"readme.TXT", 0), RGB(1, 2, 3));
+	EXPECT_EQ(caseSensitiveMatcher.GetMatchingColor(L"readme.txt", 0), std::nullopt);
+
+	ColorRuleMatcher caseInsensitiveMatcher(
+		{ MakeColorRule(L"*.TXT:Read*", TRUE, 0, RGB(1, 2, 3)) });
+	EXPECT_EQ(caseInsensitiveMatcher.GetMatchingColor(L"notes.txt", 0), RGB(1, 2, 3));
+	EXPECT_EQ(caseInsensitiveMatcher.GetMatchingColor(L"notes.TxT", 0), RGB(1, 2, 3));
+	EXPECT_EQ(caseInsensitiveMatcher.GetMatchingColor(L"README", 0), RGB(1, 2, 3));
+	EXPECT_EQ(caseInsensitiveMatcher.GetMatchingColor(L"notes.doc", 0), std::nullopt);
+}
+
+TEST(ColorRuleMatcherTest, WildcardPatterns)
+{
+	ColorRuleMatcher matcher({ MakeColorRule(L"*.tar.gz: file?.log", FALSE, 0, RGB(0, 0, 1)) });
+
+	EXPECT_EQ(matcher.GetMatchingColor(L"backup.tar.gz", 0), RGB(0, 0, 1));
+	EXPECT_EQ(matcher.GetMatchingColor(L"file1.log", 0), RGB(0, 0, 1));
+
+	EXPECT_EQ(matcher.GetMatchingColor(L"backup.gz", 0), std::nullopt);
+	EXPECT_EQ(matcher.GetMatchingColor(L"file10.log", 0), std::nullopt);
+}
+
+TEST(ColorRuleMatcherTest, Attributes)
+{
+	ColorRuleMatcher matcher(
+		{ MakeColorRule(L"", FALSE, FILE_ATTRIBUTE_COMPRESSED, RGB(0, 0, 255)),
+			MakeColorRule(L"*.exe", FALSE, FILE_ATTRIBUTE_HIDDEN, RGB(255, 0, 0)) });
+
+	EXPECT_EQ(matcher.GetMatchingColor(L"anything", FILE_ATTRIBUTE_COMPRESSED), RGB(0, 0, 255));
+	EXPECT_EQ(matcher.GetMatchingColor(L"anything", FILE_ATTRIBUTE_NORMAL), std::nullopt);
+
+	// Both the name and the attributes need to match.
+	EXPECT_EQ(matcher.GetMatchingColor(L"app.exe", FILE_ATTRIBUTE_HIDDEN), RGB(255, 0, 0));
+	EXPECT_EQ(matcher.GetMatchingColor(L"app.exe", FILE_ATTRIBUTE_NORMAL), std::nullopt);
+	EXPECT_EQ(matcher.GetMatchingColor(L"app.dll", FILE_ATTRIBUTE_HIDDEN), std::nullopt);
+}
+
+TEST(ColorRuleMatcherTest, FirstMatchingRuleWins)
+{
+	ColorRuleMatcher matcher({ MakeColorRule(L"*.txt", FALSE, 0, RGB(1, 1, 1)),
+		MakeColorRule(L"", FALSE, 0, RGB(2, 2, 2)) });
+
+	EXPECT_EQ(matcher.GetMatchingColor(L"file.txt", 0), RGB(1, 1, 1));
+	EXPECT_EQ(matcher.GetMatchingColor(L"file.doc", 0), RGB(2, 2, 2));
+}
+
+TEST(ColorRuleMatcherTest, NoRules)
+{
+	ColorRuleMatcher matcher({});
+	EXPECT_EQ(matcher.GetMatchingColor(L"file.txt", FILE_ATTRIBUTE_NORMAL), std::nullopt);
+}
+
+TEST(ColorRuleMatcherTest, UniqueIds)
+{
+	ColorRuleMatcher matcher1({});
+	ColorRuleMatcher matcher2({});
+	EXPECT_NE(matcher1.GetId(), matcher2.GetId());
+}
@@ -0,0 +1,39 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/Crc32.h"
+#include <gtest/gtest.h>
+#include <string>
+
+TEST(Crc32Test, Empty)
+{
+	Crc32 crc;
+	EXPECT_EQ(crc.GetValue(), 0U);
+}
+
+TEST(Crc32Test, KnownValue)
+{
+	std::string data = "123456789";
+
+	Crc32 crc;
+	crc.Update(data.data(), data.size());
+	EXPECT_EQ(crc.GetValue(), 0xCBF43926U);
+}
+
+TEST(Crc32Test, Incremental)
+{
+	std::string data = "The quick brown fox jumps over the lazy dog";
+
+	Crc32 crcWhole;
+	crcWhole.Update(data.data(), data.size());
+	EXPECT_EQ(crcWhole.GetValue(), 0x414FA339U);
+
+	// Splitting the data at points that aren't a multiple of four bytes should give the same
+	// result.
+	Crc32 crcParts;
+	crcParts.Update(data.data(), 3);
+	crcParts.Update(data.data() + 3, 10);
+	crcParts.Update(data.data() + 13, data.size() - 13);
+	EXPECT_EQ(crcParts.GetValue(), crcWhole.GetValue());
+}
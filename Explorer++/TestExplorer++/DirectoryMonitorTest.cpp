@@ -0,0 +1,203 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/DirectoryEventLog.h"
+#include "../Helper/DirectorySnapshot.h"
+#include "../Helper/iDirectoryMonitor.h"
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+WIN32_FIND_DATA BuildFindData(const std::wstring &name, DWORD size)
+{
+	WIN32_FIND_DATA findData = {};
+	wcscpy_s(findData.cFileName, name.c_str());
+	findData.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+	findData.nFileSizeLow = size;
+	findData.ftLastWriteTime = { 1, 2 };
+	return findData;
+}
+
+std::vector<std::pair<DWORD, std::wstring>> ToPairs(const std::vector<DirectoryChange> &changes)
+{
+	std::vector<std::pair<DWORD, std::wstring>> pairs;
+
+	for (const auto &change : changes)
+	{
+		pairs.emplace_back(change.action, change.fileName);
+	}
+
+	return pairs;
+}
+
+void RecordBatch(const std::vector<DirectoryChange> &changes, void *data)
+{
+	auto *batches = static_cast<std::vector<std::vector<DirectoryChange>> *>(data);
+	batches->push_back(changes);
+}
+
+void IgnoreChanges(const std::vector<DirectoryChange> &changes, void *data)
+{
+	UNREFERENCED_PARAMETER(changes);
+	UNREFERENCED_PARAMETER(data);
+}
+
+}
+
+TEST(DirectorySnapshotTest, Compare)
+{
+	DirectorySnapshot before;
+	before.AddItem(BuildFindData(L"a.txt", 1));
+	before.AddItem(BuildFindData(L"b.txt", 1));
+	before.AddItem(BuildFindData(L"c.txt", 1));
+
+	DirectorySnapshot after;
+	after.AddItem(BuildFindData(L"a.txt", 2));
+	after.AddItem(BuildFindData(L"C.TXT", 1));
+	after.AddItem(BuildFindData(L"d.txt", 1));
+
+	std::vector<std::pair<DWORD, std::wstring>> expectedChanges = {
+		{ FILE_ACTION_REMOVED, L"b.txt" }, { FILE_ACTION_REMOVED, L"c.txt" },
+		{ FILE_ACTION_ADDED, L"C.TXT" }, { FILE_ACTION_ADDED, L"d.txt" },
+		{ FILE_ACTION_MODIFIED, L"a.txt" }
+	};
+	EXPECT_EQ(ToPairs(before.Compare(after)), expectedChanges);
+
+	EXPECT_TRUE(after.Compare(after).empty());
+}
+
+TEST(DirectorySnapshotTest, ApplyChange)
+{
+	DirectorySnapshot snapshot;
+	snapshot.AddItem(BuildFindData(L"a.txt", 1));
+	snapshot.AddItem(BuildFindData(L"b.txt", 1));
+
+	snapshot.ApplyChange({ FILE_ACTION_RENAMED_OLD_NAME, L"b.txt" });
+	snapshot.ApplyChange({ FILE_ACTION_RENAMED_NEW_NAME, L"c.txt" });
+	snapshot.ApplyChange({ FILE_ACTION_ADDED, L"d.txt" });
+	snapshot.ApplyChange({ FILE_ACTION_REMOVED, L"d.txt" });
+	EXPECT_EQ(snapshot.GetNumItems(), 2U);
+
+	DirectorySnapshot current;
+	current.AddItem(BuildFindData(L"a.txt", 1));
+	current.AddItem(BuildFindData(L"c.txt", 1));
+
+	// The details of the renamed item aren't known, so it's always reported as modified.
+	std::vector<std::pair<DWORD, std::wstring>> expectedChanges = { { FILE_ACTION_MODIFIED,
+		L"c.txt" } };
+	EXPECT_EQ(ToPairs(snapshot.Compare(current)), expectedChanges);
+}
+
+TEST(DirectoryEventLogTest, Replay)
+{
+	DirectoryEventLog eventLog;
+	eventLog.Record(1, { { FILE_ACTION_ADDED, L"a" }, { FILE_ACTION_ADDED, L"b" } }, false);
+	eventLog.Record(2, { { FILE_ACTION_ADDED, L"c" } }, false);
+	eventLog.Record(1, { { FILE_ACTION_REMOVED, L"a" } }, true);
+
+	auto events = eventLog.GetEvents();
+	ASSERT_EQ(events.size(), 4U);
+	EXPECT_FALSE(events[0].reconstructed);
+	EXPECT_TRUE(events[3].reconstructed);
+
+	std::vector<std::vector<DirectoryChange>> batches;
+	eventLog.Replay(1, RecordBatch, &batches);
+
+	ASSERT_EQ(batches.size(), 2U);
+
+	std::vector<std::pair<DWORD, std::wstring>> expectedBatch1 = { { FILE_ACTION_ADDED, L"a" },
+		{ FILE_ACTION_ADDED, L"b" } };
+	EXPECT_EQ(ToPairs(batches[0]), expectedBatch1);
+
+	std::vector<std::pair<DWORD, std::wstring>> expectedBatch2 = { { FILE_ACTION_REMOVED, L"a" } };
+	EXPECT_EQ(ToPairs(batches[1]), expectedBatch2);
+}
+
+TEST(DirectoryEventLogTest, Capacity)
+{
+	DirectoryEventLog eventLog(2);
+	eventLog.Record(1, { { FILE_ACTION_ADDED, L"a" } }, false);
+	eventLog.Record(1, { { FILE_ACTION_ADDED, L"b" }, { FILE_ACTION_ADDED, L"c" } }, false);
+	eventLog.Record(1, { { FILE_ACTION_ADDED, L"d" } }, false);
+
+	auto events = eventLog.GetEvents();
+	ASSERT_EQ(events.size(), 2U);
+	EXPECT_EQ(events[0].change.fileName, L"c");
+	EXPECT_EQ(events[1].change.fileName, L"d");
+
+	eventLog.Clear();
+	EXPECT_TRUE(eventLog.GetEvents().empty());
+}
+
+TEST(DirectoryMonitorTest, ReportsChanges)
+{
+	TCHAR tempPath[MAX_PATH];
+	DWORD res = GetTempPath(MAX_PATH, tempPath);
+	ASSERT_NE(res, 0U);
+
+	auto directory = std::filesystem::path(tempPath)
+		/ (L"DirectoryMonitorTest" + std::to_wstring(GetCurrentProcessId()));
+	std::filesystem::remove_all(directory);
+	ASSERT_TRUE(std::filesystem::create_directory(directory));
+
+	DirectoryEventLog eventLog;
+
+	{
+		IDirectoryMonitor *directoryMonitor = nullptr;
+		HRESULT hr = CreateDirectoryMonitor(&directoryMonitor, &eventLog);
+		ASSERT_HRESULT_SUCCEEDED(hr);
+
+		auto releaseMonitor = wil::scope_exit(
+			[directoryMonitor]()
+			{
+				directoryMonitor->Release();
+			});
+
+		auto watchId = directoryMonitor->WatchDirectory(directory.c_str(),
+			FILE_NOTIFY_CHANGE_FILE_NAME, IgnoreChanges, FALSE, nullptr);
+		ASSERT_TRUE(watchId.has_value());
+
+		// The watch is started asynchronously, so the file is created repeatedly until the change
+		// is reported.
+		auto filePath = directory / L"file.txt";
+		bool changeReported = false;
+
+		for (int i = 0; i < 50 && !changeReported; i++)
+		{
+			wil::unique_hfile file(CreateFile(filePath.c_str(), GENERIC_WRITE, 0, nullptr,
+				CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+			ASSERT_TRUE(file);
+			file.reset();
+
+			std::this_thread::sleep_for(100ms);
+
+			for (const auto &event : eventLog.GetEvents())
+			{
+				if (event.watchId == *watchId && event.change.action == FILE_ACTION_ADDED
+					&& event.change.fileName == L"file.txt")
+				{
+					changeReported = true;
+				}
+			}
+
+			DeleteFile(filePath.c_str());
+		}
+
+		EXPECT_TRUE(changeReported);
+
+		directoryMonitor->StopDirectoryMonitor(*watchId);
+	}
+
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+}
@@ -0,0 +1,146 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FileOperations.h"
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+class DeleteFileSecurelyTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		TCHAR tempPath[MAX_PATH];
+		DWORD res = GetTempPath(MAX_PATH, tempPath);
+		ASSERT_NE(res, 0U);
+
+		TCHAR tempFile[MAX_PATH];
+		UINT uniqueRes = GetTempFileName(tempPath, L"exp", 0, tempFile);
+		ASSERT_NE(uniqueRes, 0U);
+
+		m_filePath = tempFile;
+	}
+
+	void TearDown() override
+	{
+		DeleteFile(m_filePath.c_str());
+	}
+
+	void WriteTestFile(ULONGLONG size)
+	{
+		wil::unique_hfile file(CreateFile(m_filePath.c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+		ASSERT_TRUE(file);
+
+		std::vector<BYTE> data(1024 * 1024, 0xAB);
+		ULONGLONG remaining = size;
+
+		while (remaining > 0)
+		{
+			auto blockSize =
+				static_cast<DWORD>((std::min)(remaining, static_cast<ULONGLONG>(data.size())));
+			DWORD numBytesWritten;
+			BOOL res = WriteFile(file.get(), data.data(), blockSize, &numBytesWritten, nullptr);
+			ASSERT_TRUE(res);
+			remaining -= numBytesWritten;
+		}
+	}
+
+	bool FileExists() const
+	{
+		return GetFileAttributes(m_filePath.c_str()) != INVALID_FILE_ATTRIBUTES;
+	}
+
+	std::wstring m_filePath;
+};
+
+}
+
+TEST_F(DeleteFileSecurelyTest, OnePass)
+{
+	WriteTestFile(3 * 1024 * 1024 + 123);
+
+	ULONGLONG expectedTotal =
+		NFileOperations::GetSecureDeleteSize(m_filePath, NFileOperations::OverwriteMethod::OnePass);
+	EXPECT_GE(expectedTotal, 3ULL * 1024 * 1024 + 123);
+
+	ULONGLONG lastBytesWritten = 0;
+	ULONGLONG lastTotalBytes = 0;
+	HRESULT hr = NFileOperations::DeleteFileSecurely(m_filePath,
+		NFileOperations::OverwriteMethod::OnePass,
+		[&](ULONGLONG bytesWritten, ULONGLONG totalBytes)
+		{
+			EXPECT_GT(bytesWritten, lastBytesWritten);
+			lastBytesWritten = bytesWritten;
+			lastTotalBytes = totalBytes;
+			return true;
+		});
+	EXPECT_HRESULT_SUCCEEDED(hr);
+
+	EXPECT_EQ(lastTotalBytes, expectedTotal);
+	EXPECT_EQ(lastBytesWritten, expectedTotal);
+	EXPECT_FALSE(FileExists());
+}
+
+TEST_F(DeleteFileSecurelyTest, ThreePass)
+{
+	WriteTestFile(2 * 1024 * 1024);
+
+	ULONGLONG onePassTotal =
+		NFileOperations::GetSecureDeleteSize(m_filePath, NFileOperations::OverwriteMethod::OnePass);
+	ULONGLONG threePassTotal = NFileOperations::GetSecureDeleteSize(m_filePath,
+		NFileOperations::OverwriteMethod::ThreePass);
+	EXPECT_EQ(threePassTotal, onePassTotal * 3);
+
+	ULONGLONG lastBytesWritten = 0;
+	HRESULT hr = NFileOperations::DeleteFileSecurely(m_filePath,
+		NFileOperations::OverwriteMethod::ThreePass,
+		[&](ULONGLONG bytesWritten, ULONGLONG totalBytes)
+		{
+			UNREFERENCED_PARAMETER(totalBytes);
+			lastBytesWritten = bytesWritten;
+			return true;
+		});
+	EXPECT_HRESULT_SUCCEEDED(hr);
+
+	EXPECT_EQ(lastBytesWritten, threePassTotal);
+	EXPECT_FALSE(FileExists());
+}
+
+TEST_F(DeleteFileSecurelyTest, EmptyFile)
+{
+	WriteTestFile(0);
+
+	HRESULT hr =
+		NFileOperations::DeleteFileSecurely(m_filePath, NFileOperations::OverwriteMethod::OnePass);
+	EXPECT_HRESULT_SUCCEEDED(hr);
+	EXPECT_FALSE(FileExists());
+}
+
+TEST_F(DeleteFileSecurelyTest, Cancel)
+{
+	WriteTestFile(4 * 1024 * 1024);
+
+	int numCallbacks = 0;
+	HRESULT hr = NFileOperations::DeleteFileSecurely(m_filePath,
+		NFileOperations::OverwriteMethod::ThreePass,
+		[&numCallbacks](ULONGLONG bytesWritten, ULONGLONG totalBytes)
+		{
+			UNREFERENCED_PARAMETER(bytesWritten);
+			UNREFERENCED_PARAMETER(totalBytes);
+			numCallbacks++;
+			return false;
+		});
+	EXPECT_EQ(hr, E_ABORT);
+	EXPECT_EQ(numCallbacks, 1);
+
+	// When cancelled, the file should be left in place.
+	EXPECT_TRUE(FileExists());
+}
@@ -0,0 +1,198 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FileSplitter.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+class FileSplitterTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		TCHAR tempPath[MAX_PATH];
+		DWORD res = GetTempPath(MAX_PATH, tempPath);
+		ASSERT_NE(res, 0U);
+
+		TCHAR tempFile[MAX_PATH];
+		UINT uniqueRes = GetTempFileName(tempPath, L"exp", 0, tempFile);
+		ASSERT_NE(uniqueRes, 0U);
+
+		m_inputFilePath = tempFile;
+	}
+
+	void TearDown() override
+	{
+		DeleteFile(m_inputFilePath.c_str());
+
+		for (int i = 1; i <= MAX_PARTS; i++)
+		{
+			DeleteFile(GetOutputPath(i).c_str());
+		}
+	}
+
+	void WriteInputFile(size_t size)
+	{
+		m_inputData.resize(size);
+
+		for (size_t i = 0; i < size; i++)
+		{
+			m_inputData[i] = static_cast<BYTE>(i % 251);
+		}
+
+		wil::unique_hfile file(CreateFile(m_inputFilePath.c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+		ASSERT_TRUE(file);
+
+		DWORD numBytesWritten;
+		BOOL res = WriteFile(file.get(), m_inputData.data(), static_cast<DWORD>(size),
+			&numBytesWritten, nullptr);
+		ASSERT_TRUE(res);
+	}
+
+	std::wstring GetOutputPath(int partNumber) const
+	{
+		return m_inputFilePath + L".part" + std::to_wstring(partNumber);
+	}
+
+	std::vector<BYTE> ReadFileContents(const std::wstring &path) const
+	{
+		wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+		EXPECT_TRUE(file);
+
+		LARGE_INTEGER fileSize = {};
+		GetFileSizeEx(file.get(), &fileSize);
+
+		std::vector<BYTE> data(static_cast<size_t>(fileSize.QuadPart));
+
+		if (!data.empty())
+		{
+			DWORD numBytesRead;
+			BOOL res = ReadFile(file.get(), data.data(), static_cast<DWORD>(data.size()),
+				&numBytesRead, nullptr);
+			EXPECT_TRUE(res);
+		}
+
+		return data;
+	}
+
+	// Splits the input file, then checks that each part has the expected size and that the parts
+	// combine to give the original file.
+	void SplitAndVerify(ULONGLONG splitSize, DWORD chunkSize,
+		const std::vector<size_t> &expectedPartSizes)
+	{
+		FileSplitter splitter(m_inputFilePath, splitSize,
+			[this](int partNumber) { return GetOutputPath(partNumber); }, chunkSize);
+
+		ULONGLONG lastBytesWritten = 0;
+		HRESULT hr = splitter.Split(
+			[&lastBytesWritten](ULONGLONG bytesWritten, ULONGLONG totalBytes)
+			{
+				EXPECT_GE(bytesWritten, lastBytesWritten);
+				EXPECT_LE(bytesWritten, totalBytes);
+				lastBytesWritten = bytesWritten;
+			},
+			std::chrono::milliseconds(0));
+		ASSERT_HRESULT_SUCCEEDED(hr);
+
+		EXPECT_EQ(lastBytesWritten, m_inputData.size());
+		ASSERT_EQ(splitter.GetNumPartsWritten(), static_cast<int>(expectedPartSizes.size()));
+
+		std::vector<BYTE> combinedData;
+
+		for (size_t i = 0; i < expectedPartSizes.size(); i++)
+		{
+			auto partData = ReadFileContents(GetOutputPath(static_cast<int>(i + 1)));
+			EXPECT_EQ(partData.size(), expectedPartSizes[i]);
+			combinedData.insert(combinedData.end(), partData.begin(), partData.end());
+		}
+
+		EXPECT_EQ(combinedData, m_inputData);
+	}
+
+	static constexpr int MAX_PARTS = 16;
+
+	std::wstring m_inputFilePath;
+	std::vector<BYTE> m_inputData;
+};
+
+}
+
+TEST_F(FileSplitterTest, SplitSizeSmallerThanChunk)
+{
+	WriteInputFile(10000);
+	SplitAndVerify(3000, 4096, { 3000, 3000, 3000, 1000 });
+}
+
+TEST_F(FileSplitterTest, SplitSizeLargerThanChunk)
+{
+	WriteInputFile(25000);
+	SplitAndVerify(10000, 4096, { 10000, 10000, 5000 });
+}
+
+TEST_F(FileSplitterTest, ExactMultiple)
+{
+	WriteInputFile(8192);
+	SplitAndVerify(4096, 1024, { 4096, 4096 });
+}
+
+TEST_F(FileSplitterTest, SplitSizeLargerThan4GB)
+{
+	// The split size doesn't fit in 32 bits. The file is smaller than a single part, so it should
+	// simply be copied.
+	WriteInputFile(5000);
+	SplitAndVerify(5ULL * 1024 * 1024 * 1024, 4096, { 5000 });
+}
+
+TEST_F(FileSplitterTest, EmptyFile)
+{
+	WriteInputFile(0);
+	SplitAndVerify(1000, 4096, {});
+}
+
+TEST_F(FileSplitterTest, Cancel)
+{
+	WriteInputFile(10000);
+
+	FileSplitter splitter(m_inputFilePath, 1000,
+		[this](int partNumber) { return GetOutputPath(partNumber); });
+	splitter.Cancel();
+
+	EXPECT_EQ(splitter.Split(), E_ABORT);
+	EXPECT_EQ(splitter.GetNumPartsWritten(), 0);
+}
+
+TEST_F(FileSplitterTest, OutputFileExists)
+{
+	WriteInputFile(10000);
+
+	// Parts are never overwritten, so the split should fail when it reaches this part.
+	wil::unique_hfile existingFile(CreateFile(GetOutputPath(2).c_str(), GENERIC_WRITE, 0, nullptr,
+		CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr));
+	ASSERT_TRUE(existingFile);
+	existingFile.reset();
+
+	FileSplitter splitter(m_inputFilePath, 4000,
+		[this](int partNumber) { return GetOutputPath(partNumber); });
+
+	EXPECT_HRESULT_FAILED(splitter.Split());
+	EXPECT_EQ(splitter.GetNumPartsWritten(), 1);
+	EXPECT_EQ(splitter.GetFailedPath(), GetOutputPath(2));
+}
+
+TEST_F(FileSplitterTest, MissingInputFile)
+{
+	std::wstring missingFile = m_inputFilePath + L".missing";
+
+	FileSplitter splitter(missingFile, 1000,
+		[this](int partNumber) { return GetOutputPath(partNumber); });
+
+	EXPECT_HRESULT_FAILED(splitter.Split());
+	EXPECT_EQ(splitter.GetFailedPath(), missingFile);
+}
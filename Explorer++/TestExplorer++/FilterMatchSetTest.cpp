@@ -0,0 +1,80 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/ShellBrowser/FilterMatchSet.h"
+#include "../Helper/StringHelper.h"
+#include <gtest/gtest.h>
+#include <stop_token>
+#include <string>
+#include <vector>
+
+TEST(FilterMatchSetTest, AddRemove)
+{
+	FilterMatchSet set;
+
+	EXPECT_EQ(set.GetCount(), 0U);
+	EXPECT_FALSE(set.Contains(0));
+	EXPECT_FALSE(set.Contains(-1));
+
+	set.Add(0);
+	set.Add(63);
+	set.Add(64);
+	set.Add(1000);
+
+	// Adding an item that's already in the set shouldn't change the count.
+	set.Add(64);
+
+	EXPECT_EQ(set.GetCount(), 4U);
+	EXPECT_TRUE(set.Contains(0));
+	EXPECT_TRUE(set.Contains(63));
+	EXPECT_TRUE(set.Contains(64));
+	EXPECT_TRUE(set.Contains(1000));
+	EXPECT_FALSE(set.Contains(1));
+	EXPECT_FALSE(set.Contains(999));
+	EXPECT_FALSE(set.Contains(100000));
+
+	set.Remove(63);
+
+	// Removing an item that isn't in the set should have no effect.
+	set.Remove(63);
+	set.Remove(5000);
+
+	EXPECT_EQ(set.GetCount(), 3U);
+	EXPECT_FALSE(set.Contains(63));
+	EXPECT_TRUE(set.Contains(64));
+}
+
+TEST(FilterMatchSetTest, Evaluate)
+{
+	std::vector<FilterItem> items = { { 0, L"readme.txt" }, { 1, L"main.cpp" },
+		{ 5, L"notes.TXT" }, { 200, L"archive.txt.bak" } };
+
+	auto result = EvaluateFilter(items, WildcardPattern(L"*.txt", false), {});
+	ASSERT_TRUE(result.has_value());
+
+	EXPECT_EQ(result->evaluated.GetCount(), 4U);
+	EXPECT_TRUE(result->evaluated.Contains(200));
+
+	EXPECT_EQ(result->matches.GetCount(), 2U);
+	EXPECT_TRUE(result->matches.Contains(0));
+	EXPECT_TRUE(result->matches.Contains(5));
+	EXPECT_FALSE(result->matches.Contains(1));
+	EXPECT_FALSE(result->matches.Contains(200));
+}
+
+TEST(FilterMatchSetTest, EvaluateCancelled)
+{
+	std::vector<FilterItem> items;
+
+	for (int i = 0; i < 10000; i++)
+	{
+		items.push_back({ i, L"file" + std::to_wstring(i) });
+	}
+
+	std::stop_source stopSource;
+	stopSource.request_stop();
+
+	auto result = EvaluateFilter(items, WildcardPattern(L"*", false), stopSource.get_token());
+	EXPECT_FALSE(result.has_value());
+}
@@ -0,0 +1,256 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/FolderSizeCache.h"
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+class FolderSizeCacheTest : public testing::Test
+{
+protected:
+	FolderSizeCacheTest() : m_folderSizeCache(4)
+	{
+	}
+
+	void SetUp() override
+	{
+		TCHAR tempPath[MAX_PATH];
+		DWORD res = GetTempPath(MAX_PATH, tempPath);
+		ASSERT_NE(res, 0U);
+
+		m_rootDirectory = std::filesystem::path(tempPath)
+			/ (L"FolderSizeCacheTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::remove_all(m_rootDirectory);
+		ASSERT_TRUE(std::filesystem::create_directory(m_rootDirectory));
+
+		// The resulting tree is:
+		//
+		// root (10 bytes)
+		// - a (20 bytes)
+		//   - a1 (30 bytes)
+		//   - a2 (empty)
+		// - b (40 bytes)
+		CreateFileWithSize(m_rootDirectory / L"root.txt", 10);
+
+		ASSERT_TRUE(std::filesystem::create_directory(m_rootDirectory / L"a"));
+		CreateFileWithSize(m_rootDirectory / L"a" / L"a.txt", 20);
+
+		ASSERT_TRUE(std::filesystem::create_directory(m_rootDirectory / L"a" / L"a1"));
+		CreateFileWithSize(m_rootDirectory / L"a" / L"a1" / L"a1.txt", 30);
+
+		ASSERT_TRUE(std::filesystem::create_directory(m_rootDirectory / L"a" / L"a2"));
+
+		ASSERT_TRUE(std::filesystem::create_directory(m_rootDirectory / L"b"));
+		CreateFileWithSize(m_rootDirectory / L"b" / L"b.txt", 40);
+	}
+
+	void TearDown() override
+	{
+		std::error_code error;
+		std::filesystem::remove_all(m_rootDirectory, error);
+	}
+
+	void CreateFileWithSize(const std::filesystem::path &path, DWORD size)
+	{
+		wil::unique_hfile file(CreateFile(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL, nullptr));
+		ASSERT_TRUE(file);
+
+		std::string data(size, 'x');
+		DWORD numBytesWritten;
+		BOOL res = WriteFile(file.get(), data.data(), size, &numBytesWritten, nullptr);
+		ASSERT_TRUE(res);
+		ASSERT_EQ(numBytesWritten, size);
+	}
+
+	FolderSizeCache m_folderSizeCache;
+	std::filesystem::path m_rootDirectory;
+};
+
+void ExpectFolderInfo(const FolderInfo &folderInfo, std::uintmax_t size, int numFolders,
+	int numFiles)
+{
+	EXPECT_EQ(folderInfo.size, size);
+	EXPECT_EQ(folderInfo.numFolders, numFolders);
+	EXPECT_EQ(folderInfo.numFiles, numFiles);
+}
+
+}
+
+TEST_F(FolderSizeCacheTest, Totals)
+{
+	auto folderInfo = m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+	ExpectFolderInfo(folderInfo, 100, 4, 4);
+
+	folderInfo = m_folderSizeCache.GetFolderInfo((m_rootDirectory / L"a").wstring());
+	ExpectFolderInfo(folderInfo, 50, 2, 2);
+
+	folderInfo = m_folderSizeCache.GetFolderInfo((m_rootDirectory / L"a" / L"a2").wstring());
+	ExpectFolderInfo(folderInfo, 0, 0, 0);
+}
+
+TEST_F(FolderSizeCacheTest, SubfoldersCached)
+{
+	EXPECT_FALSE(m_folderSizeCache.GetCachedFolderInfo(m_rootDirectory.wstring()));
+
+	m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+
+	// Every folder within the tree should have been cached, not just the root.
+	EXPECT_EQ(m_folderSizeCache.GetNumCachedFolders(), 5U);
+
+	auto folderInfo = m_folderSizeCache.GetCachedFolderInfo((m_rootDirectory / L"a").wstring());
+	ASSERT_TRUE(folderInfo);
+	ExpectFolderInfo(*folderInfo, 50, 2, 2);
+
+	folderInfo = m_folderSizeCache.GetCachedFolderInfo((m_rootDirectory / L"b").wstring());
+	ASSERT_TRUE(folderInfo);
+	ExpectFolderInfo(*folderInfo, 40, 0, 1);
+}
+
+TEST_F(FolderSizeCacheTest, KeysNormalized)
+{
+	m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+
+	std::wstring path = (m_rootDirectory / L"A").wstring();
+	auto folderInfo = m_folderSizeCache.GetCachedFolderInfo(path);
+	ASSERT_TRUE(folderInfo);
+	ExpectFolderInfo(*folderInfo, 50, 2, 2);
+
+	folderInfo = m_folderSizeCache.GetCachedFolderInfo(path + L"\\");
+	ASSERT_TRUE(folderInfo);
+	ExpectFolderInfo(*folderInfo, 50, 2, 2);
+}
+
+TEST_F(FolderSizeCacheTest, CachedResultReused)
+{
+	m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+
+	// Without an invalidation, the cached result should continue to be returned, which shows that
+	// the tree isn't being scanned again.
+	CreateFileWithSize(m_rootDirectory / L"b" / L"new.txt", 5);
+
+	auto folderInfo = m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+	ExpectFolderInfo(folderInfo, 100, 4, 4);
+}
+
+TEST_F(FolderSizeCacheTest, InvalidateAncestors)
+{
+	m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+
+	auto newFilePath = m_rootDirectory / L"a" / L"a1" / L"new.txt";
+	CreateFileWithSize(newFilePath, 5);
+	m_folderSizeCache.InvalidatePath(newFilePath.wstring());
+
+	// The folder containing the file and each of its ancestors should have been invalidated.
+	EXPECT_FALSE(m_folderSizeCache.GetCachedFolderInfo(m_rootDirectory.wstring()));
+	EXPECT_FALSE(m_folderSizeCache.GetCachedFolderInfo((m_rootDirectory / L"a").wstring()));
+	EXPECT_FALSE(
+		m_folderSizeCache.GetCachedFolderInfo((m_rootDirectory / L"a" / L"a1").wstring()));
+
+	// Folders that aren't along the path should be unaffected.
+	EXPECT_TRUE(m_folderSizeCache.GetCachedFolderInfo((m_rootDirectory / L"a" / L"a2").wstring()));
+	EXPECT_TRUE(m_folderSizeCache.GetCachedFolderInfo((m_rootDirectory / L"b").wstring()));
+
+	auto folderInfo = m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+	ExpectFolderInfo(folderInfo, 105, 4, 5);
+
+	folderInfo = m_folderSizeCache.GetFolderInfo((m_rootDirectory / L"a" / L"a1").wstring());
+	ExpectFolderInfo(folderInfo, 35, 0, 2);
+}
+
+TEST_F(FolderSizeCacheTest, InvalidateDescendants)
+{
+	m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+
+	m_folderSizeCache.InvalidatePath((m_rootDirectory / L"a").wstring(), true);
+
+	EXPECT_FALSE(m_folderSizeCache.GetCachedFolderInfo(m_rootDirectory.wstring()));
+	EXPECT_FALSE(m_folderSizeCache.GetCachedFolderInfo((m_rootDirectory / L"a").wstring()));
+	EXPECT_FALSE(
+		m_folderSizeCache.GetCachedFolderInfo((m_rootDirectory / L"a" / L"a1").wstring()));
+	EXPECT_FALSE(
+		m_folderSizeCache.GetCachedFolderInfo((m_rootDirectory / L"a" / L"a2").wstring()));
+	EXPECT_TRUE(m_folderSizeCache.GetCachedFolderInfo((m_rootDirectory / L"b").wstring()));
+}
+
+TEST_F(FolderSizeCacheTest, LeastRecentlyUsedDiscarded)
+{
+	FolderSizeCache folderSizeCache(4, 2);
+
+	auto a1Path = (m_rootDirectory / L"a" / L"a1").wstring();
+	auto a2Path = (m_rootDirectory / L"a" / L"a2").wstring();
+	auto bPath = (m_rootDirectory / L"b").wstring();
+
+	folderSizeCache.GetFolderInfo(a1Path);
+	folderSizeCache.GetFolderInfo(bPath);
+	EXPECT_EQ(folderSizeCache.GetNumCachedFolders(), 2U);
+
+	// Retrieving the cached size of a1 marks it as used, so b will be discarded instead.
+	EXPECT_TRUE(folderSizeCache.GetCachedFolderInfo(a1Path));
+
+	folderSizeCache.GetFolderInfo(a2Path);
+	EXPECT_EQ(folderSizeCache.GetNumCachedFolders(), 2U);
+	EXPECT_TRUE(folderSizeCache.GetCachedFolderInfo(a1Path));
+	EXPECT_TRUE(folderSizeCache.GetCachedFolderInfo(a2Path));
+	EXPECT_FALSE(folderSizeCache.GetCachedFolderInfo(bPath));
+
+	// The folder that was requested is kept, even if the scan finds more folders than the limit.
+	auto folderInfo = folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+	ExpectFolderInfo(folderInfo, 100, 4, 4);
+	EXPECT_EQ(folderSizeCache.GetNumCachedFolders(), 2U);
+	EXPECT_TRUE(folderSizeCache.GetCachedFolderInfo(m_rootDirectory.wstring()));
+}
+
+TEST_F(FolderSizeCacheTest, Clear)
+{
+	m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+	EXPECT_GT(m_folderSizeCache.GetNumCachedFolders(), 0U);
+
+	m_folderSizeCache.Clear();
+	EXPECT_EQ(m_folderSizeCache.GetNumCachedFolders(), 0U);
+}
+
+TEST_F(FolderSizeCacheTest, InUseCallback)
+{
+	std::vector<bool> inUseChanges;
+	m_folderSizeCache.SetInUseCallback(
+		[&inUseChanges](bool inUse)
+		{
+			inUseChanges.push_back(inUse);
+		});
+
+	EXPECT_FALSE(m_folderSizeCache.IsInUse());
+
+	m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+	EXPECT_TRUE(m_folderSizeCache.IsInUse());
+
+	// The cache is in use from the point the scan starts, so there shouldn't be any change once
+	// it finishes.
+	EXPECT_EQ(inUseChanges, std::vector<bool>{ true });
+
+	m_folderSizeCache.Clear();
+	EXPECT_FALSE(m_folderSizeCache.IsInUse());
+	EXPECT_EQ(inUseChanges, (std::vector<bool>{ true, false }));
+}
+
+TEST_F(FolderSizeCacheTest, UnmonitoredScanNotCached)
+{
+	m_folderSizeCache.SetChangesMonitored(false);
+
+	auto folderInfo = m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+	ExpectFolderInfo(folderInfo, 100, 4, 4);
+	EXPECT_EQ(m_folderSizeCache.GetNumCachedFolders(), 0U);
+	EXPECT_FALSE(m_folderSizeCache.IsInUse());
+
+	m_folderSizeCache.SetChangesMonitored(true);
+
+	m_folderSizeCache.GetFolderInfo(m_rootDirectory.wstring());
+	EXPECT_EQ(m_folderSizeCache.GetNumCachedFolders(), 5U);
+}
@@ -0,0 +1,219 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/IconService.h"
+#include "../Helper/CachedIcons.h"
+#include <boost/algorithm/string.hpp>
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <CommCtrl.h>
+
+using namespace std::chrono_literals;
+
+class IconServiceTest : public testing::Test
+{
+protected:
+	IconServiceTest() : m_cachedIcons(100)
+	{
+		CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+	}
+
+	~IconServiceTest()
+	{
+		std::error_code error;
+		std::filesystem::remove_all(m_directory, error);
+
+		CoUninitialize();
+	}
+
+	void SetUp() override
+	{
+		TCHAR tempPath[MAX_PATH];
+		DWORD res = GetTempPath(MAX_PATH, tempPath);
+		ASSERT_NE(res, 0U);
+
+		m_directory = std::filesystem::path(tempPath)
+			/ (L"IconServiceTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::remove_all(m_directory);
+		ASSERT_TRUE(std::filesystem::create_directory(m_directory));
+
+		m_hwnd.reset(CreateWindow(WC_STATIC, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, nullptr,
+			GetModuleHandle(nullptr), nullptr));
+		ASSERT_NE(m_hwnd, nullptr);
+
+		m_iconService = std::make_unique<IconService>(m_hwnd.get(), &m_cachedIcons);
+	}
+
+	void TearDown() override
+	{
+		// The service has to be destroyed before the window it's attached to.
+		m_iconService.reset();
+	}
+
+	std::wstring CreateTestFile(const std::wstring &name)
+	{
+		auto path = m_directory / name;
+		std::ofstream stream(path);
+		return path.wstring();
+	}
+
+	// Results are delivered to the window, so messages need to be processed until the callbacks
+	// have run.
+	template <typename Predicate>
+	bool PumpMessagesUntil(Predicate predicate)
+	{
+		auto end = std::chrono::steady_clock::now() + 10s;
+
+		while (!predicate())
+		{
+			if (std::chrono::steady_clock::now() > end)
+			{
+				return false;
+			}
+
+			PumpMessages();
+			Sleep(10);
+		}
+
+		return true;
+	}
+
+	void PumpMessages()
+	{
+		MSG msg;
+
+		while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+		{
+			TranslateMessage(&msg);
+			DispatchMessage(&msg);
+		}
+	}
+
+	CachedIcons m_cachedIcons;
+	std::filesystem::path m_directory;
+	wil::unique_hwnd m_hwnd;
+	std::unique_ptr<IconService> m_iconService;
+};
+
+TEST_F(IconServiceTest, CoalescesRequests)
+{
+	auto path = CreateTestFile(L"file.txt");
+
+	int client1 = m_iconService->RegisterClient();
+	int client2 = m_iconService->RegisterClient();
+
+	std::optional<int> iconIndex1;
+	std::optional<int> iconIndex2;
+
+	m_iconService->QueueIconTask(client1, path, WorkerPool::Priority::Background,
+		[&iconIndex1](int iconIndex)
+		{
+			iconIndex1 = iconIndex;
+		});
+
+	// The case of the path shouldn't matter.
+	m_iconService->QueueIconTask(client2, boost::to_upper_copy(path),
+		WorkerPool::Priority::Interactive,
+		[&iconIndex2](int iconIndex)
+		{
+			iconIndex2 = iconIndex;
+		});
+
+	ASSERT_TRUE(PumpMessagesUntil(
+		[&]
+		{
+			return iconIndex1 && iconIndex2;
+		}));
+
+	EXPECT_EQ(*iconIndex1, *iconIndex2);
+
+	auto stats = m_iconService->GetStats();
+	EXPECT_EQ(stats.requests, 2U);
+	EXPECT_EQ(stats.coalescedRequests, 1U);
+	EXPECT_EQ(stats.lookups, 1U);
+}
+
+TEST_F(IconServiceTest, ExtensionCache)
+{
+	auto path1 = CreateTestFile(L"file1.txt");
+	auto path2 = CreateTestFile(L"file2.txt");
+
+	int client = m_iconService->RegisterClient();
+
+	std::optional<int> iconIndex1;
+	m_iconService->QueueIconTask(client, path1, WorkerPool::Priority::Interactive,
+		[&iconIndex1](int iconIndex)
+		{
+			iconIndex1 = iconIndex;
+		});
+
+	ASSERT_TRUE(PumpMessagesUntil(
+		[&]
+		{
+			return iconIndex1.has_value();
+		}));
+
+	// The icon for the second file should be derived from the icon retrieved for the first file,
+	// since the icon for a text file doesn't depend on the file itself.
+	std::optional<int> iconIndex2;
+	m_iconService->QueueIconTask(client, path2, WorkerPool::Priority::Interactive,
+		[&iconIndex2](int iconIndex)
+		{
+			iconIndex2 = iconIndex;
+		});
+
+	ASSERT_TRUE(PumpMessagesUntil(
+		[&]
+		{
+			return iconIndex2.has_value();
+		}));
+
+	EXPECT_EQ(*iconIndex1 & 0x00FFFFFF, *iconIndex2 & 0x00FFFFFF);
+
+	auto stats = m_iconService->GetStats();
+	EXPECT_EQ(stats.lookups, 1U);
+	EXPECT_EQ(stats.extensionCacheHits, 1U);
+}
+
+TEST_F(IconServiceTest, SetClientPriority)
+{
+	auto path = CreateTestFile(L"file.txt");
+
+	int client = m_iconService->RegisterClient();
+
+	int numCallbacks = 0;
+	m_iconService->QueueIconTask(client, path, WorkerPool::Priority::Background,
+		[&numCallbacks](int iconIndex)
+		{
+			UNREFERENCED_PARAMETER(iconIndex);
+
+			numCallbacks++;
+		});
+
+	// The lookup may be posted more than once as its priority changes, but should only run once.
+	m_iconService->SetClientPriority(client, WorkerPool::Priority::Interactive);
+	m_iconService->SetClientPriority(client, WorkerPool::Priority::Background);
+	m_iconService->SetClientPriority(client, WorkerPool::Priority::Interactive);
+
+	ASSERT_TRUE(PumpMessagesUntil(
+		[&]
+		{
+			return numCallbacks > 0;
+		}));
+
+	// Give any other copies of the lookup the chance to run.
+	Sleep(100);
+	PumpMessages();
+
+	EXPECT_EQ(numCallbacks, 1);
+
+	auto stats = m_iconService->GetStats();
+	EXPECT_EQ(stats.lookups, 1U);
+	EXPECT_EQ(stats.failedLookups, 0U);
+}
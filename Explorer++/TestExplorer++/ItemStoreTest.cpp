@@ -0,0 +1,222 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/ShellBrowser/ItemStore.h"
+#include "../Helper/ShellHelper.h"
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const std::wstring FOLDER_PATH = L"C:\\Folder";
+
+ItemInfo_t BuildItem(const std::wstring &name, ULONGLONG size = 0)
+{
+	ItemInfo_t itemInfo;
+
+	itemInfo.parsingName = FOLDER_PATH + L"\\" + name;
+	HRESULT hr = CreateSimplePidl(itemInfo.parsingName, wil::out_param(itemInfo.pidlComplete));
+	EXPECT_HRESULT_SUCCEEDED(hr);
+
+	StringCchCopy(itemInfo.wfd.cFileName, SIZEOF_ARRAY(itemInfo.wfd.cFileName), name.c_str());
+	itemInfo.wfd.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+	itemInfo.wfd.nFileSizeLow = static_cast<DWORD>(size);
+	itemInfo.wfd.nFileSizeHigh = static_cast<DWORD>(size >> 32);
+	itemInfo.wfd.ftLastWriteTime = { 1, 2 };
+	itemInfo.isFindDataValid = true;
+	itemInfo.displayName = name;
+	itemInfo.editingName = name;
+
+	return itemInfo;
+}
+
+}
+
+TEST(ItemStoreTest, AddAndRetrieve)
+{
+	ItemStore itemStore;
+
+	ULONGLONG size = 0x100000005;
+	int internalIndex = itemStore.Add(BuildItem(L"file.txt", size));
+
+	EXPECT_TRUE(itemStore.Contains(internalIndex));
+	EXPECT_EQ(itemStore.GetCount(), 1);
+	EXPECT_EQ(itemStore.GetFileName(internalIndex), L"file.txt");
+	EXPECT_EQ(itemStore.GetDisplayName(internalIndex), L"file.txt");
+	EXPECT_EQ(itemStore.GetEditingName(internalIndex), L"file.txt");
+	EXPECT_EQ(itemStore.GetParsingName(internalIndex), FOLDER_PATH + L"\\file.txt");
+	EXPECT_EQ(itemStore.GetFileSize(internalIndex), size);
+	EXPECT_EQ(itemStore.GetAttributes(internalIndex), static_cast<DWORD>(FILE_ATTRIBUTE_NORMAL));
+	EXPECT_TRUE(itemStore.IsFindDataValid(internalIndex));
+	EXPECT_FALSE(itemStore.IsDrive(internalIndex));
+
+	WIN32_FIND_DATA wfd = itemStore.GetFindData(internalIndex);
+	EXPECT_STREQ(wfd.cFileName, L"file.txt");
+	EXPECT_EQ(wfd.nFileSizeLow, 5U);
+	EXPECT_EQ(wfd.nFileSizeHigh, 1U);
+	EXPECT_EQ(wfd.ftLastWriteTime.dwLowDateTime, 1U);
+	EXPECT_EQ(wfd.ftLastWriteTime.dwHighDateTime, 2U);
+
+	EXPECT_EQ(itemStore.GetChildPidl(internalIndex),
+		ILFindLastID(itemStore.GetPidl(internalIndex)));
+
+	auto basicItemInfo = itemStore.GetBasicItemInfo(internalIndex);
+	EXPECT_TRUE(ArePidlsEquivalent(basicItemInfo.pidlComplete.get(),
+		itemStore.GetPidl(internalIndex)));
+	EXPECT_STREQ(basicItemInfo.szDisplayName, L"file.txt");
+}
+
+TEST(ItemStoreTest, SlotsReused)
+{
+	ItemStore itemStore;
+
+	int internalIndex1 = itemStore.Add(BuildItem(L"item1"));
+	int internalIndex2 = itemStore.Add(BuildItem(L"item2"));
+	itemStore.SetRelativeSort(internalIndex1, 5);
+	itemStore.SetCachedColor(internalIndex1, {});
+
+	uint32_t generation1 = itemStore.GetGeneration(internalIndex1);
+	itemStore.Remove(internalIndex1);
+
+	EXPECT_FALSE(itemStore.Contains(internalIndex1));
+	EXPECT_FALSE(itemStore.Contains(internalIndex1, generation1));
+
+	int internalIndex3 = itemStore.Add(BuildItem(L"item3"));
+
+	// The slot freed above should be reused, without anything from the previous item carrying
+	// over.
+	EXPECT_EQ(internalIndex3, internalIndex1);
+	EXPECT_TRUE(itemStore.Contains(internalIndex3));
+	EXPECT_EQ(itemStore.GetFileName(internalIndex2), L"item2");
+	EXPECT_EQ(itemStore.GetFileName(internalIndex3), L"item3");
+	EXPECT_EQ(itemStore.GetRelativeSort(internalIndex3), 0);
+	EXPECT_FALSE(itemStore.GetCachedColor(internalIndex3).has_value());
+	EXPECT_EQ(itemStore.GetCount(), 2);
+	EXPECT_EQ(itemStore.GetSlotCount(), 2);
+
+	// The new item is in the same slot, but isn't the item that was removed.
+	EXPECT_NE(itemStore.GetGeneration(internalIndex3), generation1);
+	EXPECT_FALSE(itemStore.Contains(internalIndex3, generation1));
+	EXPECT_TRUE(itemStore.Contains(internalIndex3, itemStore.GetGeneration(internalIndex3)));
+
+	EXPECT_EQ(itemStore.Add(BuildItem(L"item4")), 2);
+	EXPECT_EQ(itemStore.GetSlotCount(), 3);
+
+	itemStore.Clear();
+
+	EXPECT_EQ(itemStore.GetCount(), 0);
+	EXPECT_EQ(itemStore.GetSlotCount(), 0);
+	EXPECT_EQ(itemStore.Add(BuildItem(L"item4")), 0);
+}
+
+TEST(ItemStoreTest, ParsingNameOutsideFolder)
+{
+	ItemStore itemStore;
+
+	// The parsing name here doesn't end with the filename, so can't share the filename storage.
+	auto itemInfo = BuildItem(L"item");
+	itemInfo.parsingName = L"::{20D04FE0-3AEA-1069-A2D8-08002B30309D}";
+
+	int internalIndex1 = itemStore.Add(std::move(itemInfo));
+	int internalIndex2 = itemStore.Add(BuildItem(L"item"));
+
+	EXPECT_EQ(itemStore.GetParsingName(internalIndex1),
+		L"::{20D04FE0-3AEA-1069-A2D8-08002B30309D}");
+	EXPECT_EQ(itemStore.GetParsingName(internalIndex2), FOLDER_PATH + L"\\item");
+}
+
+TEST(ItemStoreTest, Replace)
+{
+	ItemStore itemStore;
+
+	int internalIndex = itemStore.Add(BuildItem(L"before", 10));
+	itemStore.SetCachedColor(internalIndex, { 1, RGB(255, 0, 0) });
+	itemStore.SetRelativeSort(internalIndex, 5);
+
+	itemStore.Replace(internalIndex, BuildItem(L"after", 20));
+
+	EXPECT_EQ(itemStore.GetFileName(internalIndex), L"after");
+	EXPECT_EQ(itemStore.GetParsingName(internalIndex), FOLDER_PATH + L"\\after");
+	EXPECT_EQ(itemStore.GetFileSize(internalIndex), 20U);
+	EXPECT_FALSE(itemStore.GetCachedColor(internalIndex).has_value());
+	EXPECT_EQ(itemStore.GetRelativeSort(internalIndex), 5);
+	EXPECT_EQ(itemStore.GetCount(), 1);
+}
+
+TEST(ItemStoreTest, SetDisplayName)
+{
+	ItemStore itemStore;
+
+	int internalIndex = itemStore.Add(BuildItem(L"item"));
+	itemStore.SetDisplayName(internalIndex, L"New name");
+
+	EXPECT_EQ(itemStore.GetDisplayName(internalIndex), L"New name");
+	EXPECT_EQ(itemStore.GetEditingName(internalIndex), L"item");
+	EXPECT_EQ(itemStore.GetFileName(internalIndex), L"item");
+}
+
+TEST(ItemStoreTest, NamesPreservedAfterCompaction)
+{
+	ItemStore itemStore;
+
+	std::vector<int> internalIndexes;
+
+	for (int i = 0; i < 2000; i++)
+	{
+		internalIndexes.push_back(itemStore.Add(BuildItem(L"item" + std::to_wstring(i))));
+	}
+
+	// Removing half the items will leave enough unused name storage that the names will be
+	// compacted.
+	for (int i = 0; i < 2000; i += 2)
+	{
+		itemStore.Remove(internalIndexes[i]);
+	}
+
+	for (int i = 1; i < 2000; i += 2)
+	{
+		std::wstring name = L"item" + std::to_wstring(i);
+		EXPECT_EQ(itemStore.GetFileName(internalIndexes[i]), name);
+		EXPECT_EQ(itemStore.GetDisplayName(internalIndexes[i]), name);
+		EXPECT_EQ(itemStore.GetParsingName(internalIndexes[i]), FOLDER_PATH + L"\\" + name);
+	}
+}
+
+TEST(ItemStoreTest, OutOfRange)
+{
+	ItemStore itemStore;
+
+	int internalIndex = itemStore.Add(BuildItem(L"item"));
+	itemStore.Remove(internalIndex);
+
+	EXPECT_THROW(itemStore.GetPidl(internalIndex), std::out_of_range);
+	EXPECT_THROW(itemStore.GetFileName(-1), std::out_of_range);
+	EXPECT_THROW(itemStore.Remove(internalIndex), std::out_of_range);
+	EXPECT_THROW(itemStore.Replace(10, BuildItem(L"item")), std::out_of_range);
+}
+
+TEST(ItemStoreTest, MemoryUsage)
+{
+	ItemStore itemStore;
+
+	const int numItems = 1000;
+
+	for (int i = 0; i < numItems; i++)
+	{
+		itemStore.Add(BuildItem(L"document " + std::to_wstring(i) + L".txt"));
+	}
+
+	auto memoryUsage = itemStore.GetMemoryUsage();
+	EXPECT_EQ(memoryUsage.numItems, numItems);
+
+	// Previously, each item embedded a full WIN32_FIND_DATA structure, in addition to the names
+	// and pidls. The columns and names together should now take up less than that structure did
+	// on its own.
+	EXPECT_LT((memoryUsage.columnBytes + memoryUsage.nameBytes) / numItems,
+		sizeof(WIN32_FIND_DATA));
+}
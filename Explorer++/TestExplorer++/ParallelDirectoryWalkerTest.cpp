@@ -0,0 +1,267 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ParallelDirectoryWalker.h"
+#include "../Helper/WorkerPool.h"
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace
+{
+
+class ParallelDirectoryWalkerTest : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		TCHAR tempPath[MAX_PATH];
+		DWORD res = GetTempPath(MAX_PATH, tempPath);
+		ASSERT_NE(res, 0U);
+
+		m_rootDirectory = std::filesystem::path(tempPath)
+			/ (L"ParallelDirectoryWalkerTest" + std::to_wstring(GetCurrentProcessId()));
+		std::filesystem::remove_all(m_rootDirectory);
+		ASSERT_TRUE(std::filesystem::create_directory(m_rootDirectory));
+
+		CreateTree(m_rootDirectory, 0);
+	}
+
+	void TearDown() override
+	{
+		std::error_code error;
+		std::filesystem::remove_all(m_rootDirectory, error);
+	}
+
+	// Builds a tree where each directory contains a few files and (up to the maximum depth) a few
+	// subdirectories. The directories are deliberately uneven, so that threads will need to steal
+	// work from each other.
+	void CreateTree(const std::filesystem::path &directory, int depth)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			auto filePath = directory / (L"file" + std::to_wstring(i) + L".txt");
+			wil::unique_hfile file(CreateFile(filePath.c_str(), GENERIC_WRITE, 0, nullptr,
+				CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr));
+			ASSERT_TRUE(file);
+
+			m_expectedPaths.insert(filePath.wstring());
+		}
+
+		if (depth == MAX_DEPTH)
+		{
+			return;
+		}
+
+		int numSubdirectories = (depth % 2 == 0) ? 4 : 2;
+
+		for (int i = 0; i < numSubdirectories; i++)
+		{
+			auto subdirectory = directory / (L"folder" + std::to_wstring(i));
+			ASSERT_TRUE(std::filesystem::create_directory(subdirectory));
+
+			m_expectedPaths.insert(subdirectory.wstring());
+
+			if (depth == 0)
+			{
+				m_expectedTopLevelPaths.insert(subdirectory.wstring());
+			}
+
+			CreateTree(subdirectory, depth + 1);
+		}
+	}
+
+	std::set<std::wstring> Walk(ParallelDirectoryWalker &walker)
+	{
+		std::mutex mutex;
+		std::set<std::wstring> foundPaths;
+		bool duplicateFound = false;
+
+		walker.Walk(m_rootDirectory.wstring(), nullptr,
+			[&](int threadIndex, const std::wstring &directory, const WIN32_FIND_DATA &findData)
+			{
+				EXPECT_GE(threadIndex, 0);
+				EXPECT_LT(threadIndex, walker.GetNumThreads());
+
+				auto path = (std::filesystem::path(directory) / findData.cFileName).wstring();
+
+				std::scoped_lock lock(mutex);
+				auto [itr, inserted] = foundPaths.insert(path);
+
+				if (!inserted)
+				{
+					duplicateFound = true;
+				}
+			});
+
+		EXPECT_FALSE(duplicateFound);
+
+		return foundPaths;
+	}
+
+	static constexpr int MAX_DEPTH = 4;
+
+	std::filesystem::path m_rootDirectory;
+	std::set<std::wstring> m_expectedPaths;
+	std::set<std::wstring> m_expectedTopLevelPaths;
+};
+
+}
+
+TEST_F(ParallelDirectoryWalkerTest, Recursive)
+{
+	ParallelDirectoryWalker walker(4, true);
+	auto foundPaths = Walk(walker);
+	EXPECT_EQ(foundPaths, m_expectedPaths);
+
+	ULONGLONG totalEntries = 0;
+	ULONGLONG totalDirectories = 0;
+
+	for (const auto &stats : walker.GetThreadStats())
+	{
+		totalEntries += stats.entriesFound;
+		totalDirectories += stats.directoriesEnumerated;
+	}
+
+	EXPECT_EQ(totalEntries, m_expectedPaths.size());
+
+	// Every subdirectory is enumerated, along with the root directory.
+	ULONGLONG expectedDirectories = 1;
+
+	for (const auto &path : m_expectedPaths)
+	{
+		if (std::filesystem::is_directory(path))
+		{
+			expectedDirectories++;
+		}
+	}
+
+	EXPECT_EQ(totalDirectories, expectedDirectories);
+}
+
+TEST_F(ParallelDirectoryWalkerTest, SingleThread)
+{
+	ParallelDirectoryWalker walker(1, true);
+	auto foundPaths = Walk(walker);
+	EXPECT_EQ(foundPaths, m_expectedPaths);
+}
+
+TEST_F(ParallelDirectoryWalkerTest, SharedWorkerPool)
+{
+	WorkerPool workerPool(2);
+	ParallelDirectoryWalker walker(4, true, &workerPool);
+	auto foundPaths = Walk(walker);
+	EXPECT_EQ(foundPaths, m_expectedPaths);
+}
+
+// The walk is started from the pool's only worker, so none of the walker's tasks can run. The
+// calling thread should still complete the walk by itself.
+TEST_F(ParallelDirectoryWalkerTest, SharedWorkerPoolBusy)
+{
+	WorkerPool workerPool(1);
+	WorkerPool::TaskGroup taskGroup(workerPool, WorkerPool::Priority::Interactive);
+
+	ParallelDirectoryWalker walker(4, true, &workerPool);
+	auto future = taskGroup.Push(
+		[this, &walker]()
+		{
+			return Walk(walker);
+		});
+	EXPECT_EQ(future.get(), m_expectedPaths);
+}
+
+TEST_F(ParallelDirectoryWalkerTest, NonRecursive)
+{
+	ParallelDirectoryWalker walker(4, false);
+	auto foundPaths = Walk(walker);
+
+	std::set<std::wstring> expectedPaths = m_expectedTopLevelPaths;
+
+	for (int i = 0; i < 3; i++)
+	{
+		auto filePath = m_rootDirectory / (L"file" + std::to_wstring(i) + L".txt");
+		expectedPaths.insert(filePath.wstring());
+	}
+
+	EXPECT_EQ(foundPaths, expectedPaths);
+}
+
+TEST_F(ParallelDirectoryWalkerTest, SubdirectoryFilter)
+{
+	auto excludedDirectory = m_rootDirectory / L"folder0";
+
+	ParallelDirectoryWalker walker(4, true);
+	walker.SetSubdirectoryFilter(
+		[&excludedDirectory](int threadIndex, const std::wstring &directory,
+			const WIN32_FIND_DATA &findData)
+		{
+			UNREFERENCED_PARAMETER(threadIndex);
+
+			return std::filesystem::path(directory) / findData.cFileName != excludedDirectory;
+		});
+
+	auto foundPaths = Walk(walker);
+
+	// The excluded directory itself should still be reported, but nothing within it.
+	std::set<std::wstring> expectedPaths;
+	std::wstring excludedPrefix = excludedDirectory.wstring() + L"\\";
+
+	for (const auto &path : m_expectedPaths)
+	{
+		if (path.compare(0, excludedPrefix.size(), excludedPrefix) != 0)
+		{
+			expectedPaths.insert(path);
+		}
+	}
+
+	EXPECT_TRUE(expectedPaths.contains(excludedDirectory.wstring()));
+	EXPECT_EQ(foundPaths, expectedPaths);
+}
+
+TEST_F(ParallelDirectoryWalkerTest, Cancel)
+{
+	ParallelDirectoryWalker walker(4, true);
+
+	std::atomic<int> numItems = 0;
+
+	walker.Walk(m_rootDirectory.wstring(), nullptr,
+		[&walker, &numItems](int threadIndex, const std::wstring &directory,
+			const WIN32_FIND_DATA &findData)
+		{
+			UNREFERENCED_PARAMETER(threadIndex);
+			UNREFERENCED_PARAMETER(directory);
+			UNREFERENCED_PARAMETER(findData);
+
+			numItems++;
+			walker.Cancel();
+		});
+
+	EXPECT_TRUE(walker.IsCancelled());
+
+	// Each thread can process at most one item after the walk has been cancelled.
+	EXPECT_LE(numItems.load(), walker.GetNumThreads());
+}
+
+TEST_F(ParallelDirectoryWalkerTest, MissingDirectory)
+{
+	ParallelDirectoryWalker walker(2, true);
+
+	int numItems = 0;
+	walker.Walk((m_rootDirectory / L"missing").wstring(), nullptr,
+		[&numItems](int threadIndex, const std::wstring &directory,
+			const WIN32_FIND_DATA &findData)
+		{
+			UNREFERENCED_PARAMETER(threadIndex);
+			UNREFERENCED_PARAMETER(directory);
+			UNREFERENCED_PARAMETER(findData);
+
+			numItems++;
+		});
+
+	EXPECT_EQ(numItems, 0);
+}
@@ -0,0 +1,65 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/PerfectHashTable.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+constexpr auto KEYS = std::to_array<std::wstring_view>({ L"Alpha", L"Beta", L"Gamma", L"Delta",
+	L"Epsilon", L"Zeta", L"Eta", L"Theta", L"Iota", L"Kappa" });
+
+constexpr PerfectHashTable<KEYS.size()> TABLE(KEYS);
+
+// The table is built at compile time, so lookups can also be performed at compile time.
+static_assert(TABLE.Find(L"Gamma") == 2);
+static_assert(!TABLE.Find(L"Omega"));
+
+}
+
+TEST(PerfectHashTableTest, Find)
+{
+	for (size_t i = 0; i < KEYS.size(); i++)
+	{
+		// A copy is used here, to ensure that the lookup compares the contents of the string,
+		// rather than its address.
+		std::wstring key(KEYS[i]);
+		EXPECT_EQ(TABLE.Find(key), i);
+	}
+}
+
+TEST(PerfectHashTableTest, FindMissing)
+{
+	EXPECT_EQ(TABLE.Find(L""), std::nullopt);
+	EXPECT_EQ(TABLE.Find(L"Omega"), std::nullopt);
+	EXPECT_EQ(TABLE.Find(L"alpha"), std::nullopt);
+	EXPECT_EQ(TABLE.Find(L"Alphabet"), std::nullopt);
+}
+
+TEST(PerfectHashTableTest, Dispatch)
+{
+	auto dispatch = [](std::wstring_view key)
+	{
+		switch (TABLE.Find(key).value_or(KEYS.size()))
+		{
+		case TABLE.GetIndex(L"Beta"):
+			return 1;
+
+		case TABLE.GetIndex(L"Kappa"):
+			return 2;
+
+		default:
+			return 0;
+		}
+	};
+
+	EXPECT_EQ(dispatch(L"Beta"), 1);
+	EXPECT_EQ(dispatch(L"Kappa"), 2);
+	EXPECT_EQ(dispatch(L"Alpha"), 0);
+	EXPECT_EQ(dispatch(L"Omega"), 0);
+}
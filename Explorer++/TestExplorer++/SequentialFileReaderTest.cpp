@@ -0,0 +1,121 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/SequentialFileReader.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+class SequentialFileReaderTest : public testing::Test
+{
+protected:
+	void TearDown() override
+	{
+		for (const auto &filePath : m_filePaths)
+		{
+			DeleteFile(filePath.c_str());
+		}
+	}
+
+	// Creates a temporary file of the specified size. Each byte in the file is set based on its
+	// position across all of the files created so far, so that the combined output can be checked.
+	std::wstring CreateTestFile(size_t size)
+	{
+		TCHAR tempPath[MAX_PATH];
+		DWORD res = GetTempPath(MAX_PATH, tempPath);
+		EXPECT_NE(res, 0U);
+
+		TCHAR tempFile[MAX_PATH];
+		UINT uniqueRes = GetTempFileName(tempPath, L"exp", 0, tempFile);
+		EXPECT_NE(uniqueRes, 0U);
+
+		m_filePaths.push_back(tempFile);
+
+		std::vector<BYTE> data(size);
+
+		for (auto &byte : data)
+		{
+			byte = static_cast<BYTE>(m_expectedData.size() % 251);
+			m_expectedData.push_back(byte);
+		}
+
+		wil::unique_hfile file(CreateFile(tempFile, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+			FILE_ATTRIBUTE_NORMAL, nullptr));
+		EXPECT_TRUE(file);
+
+		DWORD numBytesWritten;
+		BOOL writeRes = WriteFile(file.get(), data.data(), static_cast<DWORD>(data.size()),
+			&numBytesWritten, nullptr);
+		EXPECT_TRUE(writeRes);
+
+		return tempFile;
+	}
+
+	std::vector<BYTE> ReadAll(SequentialFileReader &reader, DWORD chunkSize)
+	{
+		std::vector<BYTE> output;
+
+		while (true)
+		{
+			const BYTE *data;
+			DWORD size;
+			HRESULT hr = reader.ReadNextChunk(&data, &size);
+			EXPECT_HRESULT_SUCCEEDED(hr);
+
+			if (FAILED(hr) || size == 0)
+			{
+				break;
+			}
+
+			EXPECT_LE(size, chunkSize);
+			output.insert(output.end(), data, data + size);
+		}
+
+		return output;
+	}
+
+	std::vector<std::wstring> m_filePaths;
+	std::vector<BYTE> m_expectedData;
+};
+
+}
+
+TEST_F(SequentialFileReaderTest, ReadsFilesInOrder)
+{
+	const DWORD CHUNK_SIZE = 4096;
+
+	// The file sizes are chosen so that chunk boundaries and file boundaries don't line up.
+	std::vector<std::wstring> files = { CreateTestFile(10000), CreateTestFile(0),
+		CreateTestFile(4096), CreateTestFile(1) };
+
+	SequentialFileReader reader(files, CHUNK_SIZE);
+	ASSERT_HRESULT_SUCCEEDED(reader.Open());
+	EXPECT_EQ(reader.GetTotalSize(), m_expectedData.size());
+
+	EXPECT_EQ(ReadAll(reader, CHUNK_SIZE), m_expectedData);
+}
+
+TEST_F(SequentialFileReaderTest, NoFiles)
+{
+	SequentialFileReader reader({});
+	ASSERT_HRESULT_SUCCEEDED(reader.Open());
+	EXPECT_EQ(reader.GetTotalSize(), 0U);
+
+	EXPECT_TRUE(ReadAll(reader, SequentialFileReader::DEFAULT_CHUNK_SIZE).empty());
+}
+
+TEST_F(SequentialFileReaderTest, MissingFile)
+{
+	std::wstring existingFile = CreateTestFile(100);
+	std::wstring missingFile = existingFile + L".missing";
+
+	SequentialFileReader reader({ existingFile, missingFile });
+
+	size_t failedFileIndex = 0;
+	EXPECT_HRESULT_FAILED(reader.Open(&failedFileIndex));
+	EXPECT_EQ(failedFileIndex, 1U);
+}
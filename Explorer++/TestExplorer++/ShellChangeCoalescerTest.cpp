@@ -0,0 +1,267 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/ShellBrowser/ShellChangeCoalescer.h"
+#include "../Helper/ShellHelper.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+
+class ShellChangeCoalescerTest : public testing::Test
+{
+protected:
+	PCIDLIST_ABSOLUTE GetPidl(const std::wstring &name)
+	{
+		auto itr = m_pidls.find(name);
+
+		if (itr != m_pidls.end())
+		{
+			return itr->second.get();
+		}
+
+		unique_pidl_absolute pidl;
+		HRESULT hr = CreateSimplePidl(L"C:\\" + name, wil::out_param(pidl));
+		EXPECT_HRESULT_SUCCEEDED(hr);
+
+		auto [insertedItr, inserted] = m_pidls.insert({ name, std::move(pidl) });
+		return insertedItr->second.get();
+	}
+
+	void AddItemAdded(const std::wstring &name)
+	{
+		m_coalescer.AddItemAdded(name, GetPidl(name));
+	}
+
+	void AddItemRemoved(const std::wstring &name)
+	{
+		m_coalescer.AddItemRemoved(name, GetPidl(name));
+	}
+
+	void AddItemUpdated(const std::wstring &name)
+	{
+		m_coalescer.AddItemUpdated(name, GetPidl(name));
+	}
+
+	void AddItemRenamed(const std::wstring &oldName, const std::wstring &newName)
+	{
+		m_coalescer.AddItemRenamed(oldName, GetPidl(oldName), newName, GetPidl(newName));
+	}
+
+	void ExpectChange(const ShellChangeCoalescer::Change &change,
+		ShellChangeCoalescer::ChangeType expectedType, const std::wstring &expectedName1,
+		const std::wstring &expectedName2 = {})
+	{
+		EXPECT_EQ(change.type, expectedType);
+		ASSERT_NE(change.pidl1, nullptr);
+		EXPECT_TRUE(ArePidlsEquivalent(change.pidl1.get(), GetPidl(expectedName1)));
+
+		if (expectedName2.empty())
+		{
+			EXPECT_EQ(change.pidl2, nullptr);
+		}
+		else
+		{
+			ASSERT_NE(change.pidl2, nullptr);
+			EXPECT_TRUE(ArePidlsEquivalent(change.pidl2.get(), GetPidl(expectedName2)));
+		}
+	}
+
+	ShellChangeCoalescer m_coalescer;
+	std::unordered_map<std::wstring, unique_pidl_absolute> m_pidls;
+};
+
+}
+
+TEST_F(ShellChangeCoalescerTest, CreateThenDeleteCancels)
+{
+	AddItemAdded(L"temp.obj");
+	AddItemUpdated(L"temp.obj");
+	AddItemRemoved(L"temp.obj");
+
+	EXPECT_FALSE(m_coalescer.HasPendingChanges());
+	EXPECT_TRUE(m_coalescer.TakeChanges(SIZE_MAX).empty());
+
+	EXPECT_EQ(m_coalescer.GetStats().rawEvents, 3U);
+	EXPECT_EQ(m_coalescer.GetStats().appliedChanges, 0U);
+}
+
+TEST_F(ShellChangeCoalescerTest, RepeatedUpdatesCollapse)
+{
+	for (int i = 0; i < 10; i++)
+	{
+		AddItemUpdated(L"log.txt");
+	}
+
+	auto changes = m_coalescer.TakeChanges(SIZE_MAX);
+	ASSERT_EQ(changes.size(), 1U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Updated, L"log.txt");
+
+	EXPECT_EQ(m_coalescer.GetStats().rawEvents, 10U);
+	EXPECT_EQ(m_coalescer.GetStats().appliedChanges, 1U);
+}
+
+TEST_F(ShellChangeCoalescerTest, RenameChainCollapses)
+{
+	AddItemRenamed(L"a", L"b");
+	AddItemUpdated(L"b");
+	AddItemRenamed(L"b", L"c");
+
+	auto changes = m_coalescer.TakeChanges(SIZE_MAX);
+	ASSERT_EQ(changes.size(), 1U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Renamed, L"a", L"c");
+}
+
+TEST_F(ShellChangeCoalescerTest, RenameBackBecomesUpdate)
+{
+	AddItemRenamed(L"a", L"b");
+	AddItemRenamed(L"b", L"a");
+
+	auto changes = m_coalescer.TakeChanges(SIZE_MAX);
+	ASSERT_EQ(changes.size(), 1U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Updated, L"a");
+}
+
+TEST_F(ShellChangeCoalescerTest, RenamedThenDeletedRemovesOriginal)
+{
+	AddItemRenamed(L"a", L"b");
+	AddItemRemoved(L"b");
+
+	auto changes = m_coalescer.TakeChanges(SIZE_MAX);
+	ASSERT_EQ(changes.size(), 1U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Removed, L"a");
+}
+
+TEST_F(ShellChangeCoalescerTest, AddedThenRenamed)
+{
+	AddItemAdded(L"New Folder");
+	AddItemRenamed(L"New Folder", L"Photos");
+
+	auto changes = m_coalescer.TakeChanges(SIZE_MAX);
+	ASSERT_EQ(changes.size(), 1U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Added, L"Photos");
+}
+
+TEST_F(ShellChangeCoalescerTest, DeleteThenCreateReplaces)
+{
+	AddItemRemoved(L"file");
+	AddItemAdded(L"file");
+
+	auto changes = m_coalescer.TakeChanges(SIZE_MAX);
+	ASSERT_EQ(changes.size(), 2U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Removed, L"file");
+	ExpectChange(changes[1], ShellChangeCoalescer::ChangeType::Added, L"file");
+}
+
+TEST_F(ShellChangeCoalescerTest, OrderPreserved)
+{
+	AddItemAdded(L"1");
+	AddItemRemoved(L"2");
+	AddItemUpdated(L"3");
+	AddItemUpdated(L"1");
+
+	auto changes = m_coalescer.TakeChanges(SIZE_MAX);
+	ASSERT_EQ(changes.size(), 3U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Added, L"1");
+	ExpectChange(changes[1], ShellChangeCoalescer::ChangeType::Removed, L"2");
+	ExpectChange(changes[2], ShellChangeCoalescer::ChangeType::Updated, L"3");
+}
+
+TEST_F(ShellChangeCoalescerTest, RenameOntoPendingItemIsNotMerged)
+{
+	AddItemRemoved(L"b");
+	AddItemRenamed(L"a", L"b");
+
+	auto changes = m_coalescer.TakeChanges(SIZE_MAX);
+	ASSERT_EQ(changes.size(), 2U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Removed, L"b");
+	ExpectChange(changes[1], ShellChangeCoalescer::ChangeType::Renamed, L"a", L"b");
+
+	EXPECT_FALSE(m_coalescer.HasPendingChangeForItem(L"a"));
+	EXPECT_FALSE(m_coalescer.HasPendingChangeForItem(L"b"));
+}
+
+TEST_F(ShellChangeCoalescerTest, PendingChangeForItem)
+{
+	AddItemRenamed(L"a", L"b");
+
+	EXPECT_TRUE(m_coalescer.HasPendingChangeForItem(L"a"));
+	EXPECT_TRUE(m_coalescer.HasPendingChangeForItem(L"b"));
+	EXPECT_FALSE(m_coalescer.HasPendingChangeForItem(L"c"));
+}
+
+TEST_F(ShellChangeCoalescerTest, DirectoryUpdateSupersedesItemChanges)
+{
+	AddItemAdded(L"1");
+	AddItemRemoved(L"2");
+	m_coalescer.AddDirectoryUpdated();
+	AddItemUpdated(L"3");
+
+	auto changes = m_coalescer.TakeChanges(SIZE_MAX);
+	ASSERT_EQ(changes.size(), 1U);
+	EXPECT_EQ(changes[0].type, ShellChangeCoalescer::ChangeType::DirectoryUpdated);
+	EXPECT_FALSE(m_coalescer.HasPendingChanges());
+}
+
+TEST_F(ShellChangeCoalescerTest, WorkIsCapped)
+{
+	for (int i = 0; i < 10; i++)
+	{
+		AddItemAdded(std::to_wstring(i));
+	}
+
+	auto changes = m_coalescer.TakeChanges(4);
+	EXPECT_EQ(changes.size(), 4U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Added, L"0");
+	EXPECT_TRUE(m_coalescer.HasPendingChanges());
+
+	changes = m_coalescer.TakeChanges(4);
+	EXPECT_EQ(changes.size(), 4U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Added, L"4");
+
+	changes = m_coalescer.TakeChanges(4);
+	EXPECT_EQ(changes.size(), 2U);
+	EXPECT_FALSE(m_coalescer.HasPendingChanges());
+}
+
+TEST_F(ShellChangeCoalescerTest, ReplacementSplitAtLimit)
+{
+	AddItemAdded(L"a");
+	AddItemRemoved(L"file");
+	AddItemAdded(L"file");
+
+	// The replacement results in two changes, but there's only room for one of them.
+	auto changes = m_coalescer.TakeChanges(2);
+	ASSERT_EQ(changes.size(), 2U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Added, L"a");
+	ExpectChange(changes[1], ShellChangeCoalescer::ChangeType::Removed, L"file");
+	EXPECT_TRUE(m_coalescer.HasPendingChangeForItem(L"file"));
+
+	changes = m_coalescer.TakeChanges(2);
+	ASSERT_EQ(changes.size(), 1U);
+	ExpectChange(changes[0], ShellChangeCoalescer::ChangeType::Added, L"file");
+	EXPECT_FALSE(m_coalescer.HasPendingChanges());
+}
+
+TEST_F(ShellChangeCoalescerTest, BatchWindowAdapts)
+{
+	EXPECT_EQ(m_coalescer.GetBatchWindow(), ShellChangeCoalescer::MIN_BATCH_WINDOW);
+
+	for (int i = 0; i < 1000; i++)
+	{
+		AddItemUpdated(L"file");
+	}
+
+	m_coalescer.TakeChanges(SIZE_MAX);
+	EXPECT_GT(m_coalescer.GetBatchWindow(), ShellChangeCoalescer::MIN_BATCH_WINDOW);
+
+	for (int i = 0; i < 10; i++)
+	{
+		m_coalescer.TakeChanges(SIZE_MAX);
+	}
+
+	EXPECT_EQ(m_coalescer.GetBatchWindow(), ShellChangeCoalescer::MIN_BATCH_WINDOW);
+}
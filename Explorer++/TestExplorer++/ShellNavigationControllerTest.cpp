@@ -14,6 +14,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <ShlObj.h>
+#include <optional>
 
 using namespace testing;
 
@@ -22,20 +23,40 @@ class NavigatorFake : public NavigatorInterface
 public:
 	HRESULT BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry = true) override
 	{
-		m_navigationStartedSignal(pidlDirectory);
-		m_navigationCommittedSignal(pidlDirectory, addHistoryEntry);
-		m_navigationCompletedSignal(pidlDirectory);
-
-		return S_OK;
+		return StartNavigation(pidlDirectory, addHistoryEntry);
 	}
 
 	HRESULT BrowseFolder(const HistoryEntry &entry) override
 	{
-		m_navigationStartedSignal(entry.GetPidl().get());
-		m_navigationCommittedSignal(entry.GetPidl().get(), false);
-		m_navigationCompletedSignal(entry.GetPidl().get());
+		return StartNavigation(entry.GetPidl().get(), false);
+	}
 
-		return S_OK;
+	// By default, navigations complete before BrowseFolder() returns. When asynchronous, a
+	// navigation will remain pending until it's explicitly completed or failed, which mirrors the
+	// behavior of ShellBrowser.
+	void SetAsynchronous(bool asynchronous)
+	{
+		m_asynchronous = asynchronous;
+	}
+
+	void CompletePendingNavigation()
+	{
+		ASSERT_TRUE(m_pendingNavigation);
+
+		auto navigation = std::move(*m_pendingNavigation);
+		m_pendingNavigation.reset();
+
+		m_navigationCommittedSignal(navigation.pidlDirectory.get(), navigation.addHistoryEntry);
+		m_navigationCompletedSignal(navigation.pidlDirectory.get());
+	}
+
+	void FailPendingNavigation()
+	{
+		ASSERT_TRUE(m_pendingNavigation);
+
+		m_pendingNavigation.reset();
+
+		m_navigationFailedSignal();
 	}
 
 	boost::signals2::connection AddNavigationStartedObserver(
@@ -66,11 +87,52 @@ public:
 		return m_navigationFailedSignal.connect(observer, position);
 	}
 
+	boost::signals2::connection AddNavigationCancelledObserver(
+		const NavigationCancelledSignal::slot_type &observer,
+		boost::signals2::connect_position position = boost::signals2::at_back) override
+	{
+		return m_navigationCancelledSignal.connect(observer, position);
+	}
+
 private:
+	struct PendingNavigation
+	{
+		unique_pidl_absolute pidlDirectory;
+		bool addHistoryEntry;
+	};
+
+	HRESULT StartNavigation(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry)
+	{
+		if (m_pendingNavigation)
+		{
+			m_pendingNavigation.reset();
+
+			m_navigationCancelledSignal();
+		}
+
+		m_navigationStartedSignal(pidlDirectory);
+
+		if (m_asynchronous)
+		{
+			m_pendingNavigation = { unique_pidl_absolute(ILCloneFull(pidlDirectory)),
+				addHistoryEntry };
+			return S_OK;
+		}
+
+		m_navigationCommittedSignal(pidlDirectory, addHistoryEntry);
+		m_navigationCompletedSignal(pidlDirectory);
+
+		return S_OK;
+	}
+
 	NavigationStartedSignal m_navigationStartedSignal;
 	NavigationCommittedSignal m_navigationCommittedSignal;
 	NavigationCompletedSignal m_navigationCompletedSignal;
 	NavigationFailedSignal m_navigationFailedSignal;
+	NavigationCancelledSignal m_navigationCancelledSignal;
+
+	bool m_asynchronous = false;
+	std::optional<PendingNavigation> m_pendingNavigation;
 };
 
 class NavigatorMock : public NavigatorInterface
@@ -123,6 +185,14 @@ public:
 				{
 					return m_fake.AddNavigationFailedObserver(observer, position);
 				});
+
+		ON_CALL(*this, AddNavigationCancelledObserverImpl)
+			.WillByDefault(
+				[this](const NavigationCancelledSignal::slot_type &observer,
+					boost::signals2::connect_position position)
+				{
+					return m_fake.AddNavigationCancelledObserver(observer, position);
+				});
 	}
 
 	MOCK_METHOD(HRESULT, BrowseFolderImpl, (PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry));
@@ -139,6 +209,9 @@ public:
 	MOCK_METHOD(boost::signals2::connection, AddNavigationFailedObserverImpl,
 		(const NavigationFailedSignal::slot_type &observer,
 			boost::signals2::connect_position position));
+	MOCK_METHOD(boost::signals2::connection, AddNavigationCancelledObserverImpl,
+		(const NavigationCancelledSignal::slot_type &observer,
+			boost::signals2::connect_position position));
 
 	HRESULT BrowseFolder(PCIDLIST_ABSOLUTE pidlDirectory, bool addHistoryEntry = true) override
 	{
@@ -178,6 +251,13 @@ public:
 		return AddNavigationFailedObserverImpl(observer, position);
 	}
 
+	boost::signals2::connection AddNavigationCancelledObserver(
+		const NavigationCancelledSignal::slot_type &observer,
+		boost::signals2::connect_position position = boost::signals2::at_back) override
+	{
+		return AddNavigationCancelledObserverImpl(observer, position);
+	}
+
 private:
 	NavigatorFake m_fake;
 };
@@ -271,6 +351,33 @@ protected:
 	std::vector<std::unique_ptr<PreservedHistoryEntry>> m_preservedEntries;
 };
 
+class ShellNavigationControllerAsyncTest : public Test
+{
+protected:
+	ShellNavigationControllerAsyncTest() :
+		m_navigationController(&m_navigator, &m_tabNavigation, &m_iconFetcher)
+	{
+		m_navigator.SetAsynchronous(true);
+	}
+
+	HRESULT StartNavigationToFolder(const std::wstring &path)
+	{
+		unique_pidl_absolute pidl(SHSimpleIDListFromPath(path.c_str()));
+
+		if (!pidl)
+		{
+			return E_FAIL;
+		}
+
+		return m_navigationController.BrowseFolder(pidl.get());
+	}
+
+	NavigatorFake m_navigator;
+	TabNavigationMock m_tabNavigation;
+	IconFetcherMock m_iconFetcher;
+	ShellNavigationController m_navigationController;
+};
+
 TEST_F(ShellNavigationControllerTest, Refresh)
 {
 	// Shouldn't be able to refresh when no navigation has occurred yet.
@@ -542,3 +649,82 @@ TEST_F(ShellNavigationControllerPreservedTest, CheckEntries)
 		EXPECT_TRUE(ArePidlsEquivalent(entry->GetPidl().get(), m_preservedEntries[i]->pidl.get()));
 	}
 }
+
+TEST_F(ShellNavigationControllerAsyncTest, BackForward)
+{
+	HRESULT hr = StartNavigationToFolder(L"C:\\Fake1");
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	// The history entry should only be added once the navigation has been committed.
+	EXPECT_EQ(m_navigationController.GetNumHistoryEntries(), 0);
+	m_navigator.CompletePendingNavigation();
+	EXPECT_EQ(m_navigationController.GetNumHistoryEntries(), 1);
+
+	hr = StartNavigationToFolder(L"C:\\Fake2");
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	m_navigator.CompletePendingNavigation();
+
+	hr = m_navigationController.GoBack();
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	// Likewise, the current index should only change once the navigation has been committed.
+	EXPECT_EQ(m_navigationController.GetCurrentIndex(), 1);
+	m_navigator.CompletePendingNavigation();
+	EXPECT_EQ(m_navigationController.GetCurrentIndex(), 0);
+
+	hr = m_navigationController.GoForward();
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	m_navigator.CompletePendingNavigation();
+	EXPECT_EQ(m_navigationController.GetCurrentIndex(), 1);
+	EXPECT_EQ(m_navigationController.GetNumHistoryEntries(), 2);
+}
+
+TEST_F(ShellNavigationControllerAsyncTest, FailedHistoryNavigation)
+{
+	HRESULT hr = StartNavigationToFolder(L"C:\\Fake1");
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	m_navigator.CompletePendingNavigation();
+
+	hr = StartNavigationToFolder(L"C:\\Fake2");
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	m_navigator.CompletePendingNavigation();
+
+	hr = m_navigationController.GoBack();
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	m_navigator.FailPendingNavigation();
+
+	EXPECT_EQ(m_navigationController.GetCurrentIndex(), 1);
+
+	// The failed navigation shouldn't have any effect on later navigations.
+	hr = StartNavigationToFolder(L"C:\\Fake3");
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	m_navigator.CompletePendingNavigation();
+
+	EXPECT_EQ(m_navigationController.GetCurrentIndex(), 2);
+	EXPECT_EQ(m_navigationController.GetNumHistoryEntries(), 3);
+}
+
+TEST_F(ShellNavigationControllerAsyncTest, CancelledHistoryNavigation)
+{
+	HRESULT hr = StartNavigationToFolder(L"C:\\Fake1");
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	m_navigator.CompletePendingNavigation();
+
+	hr = StartNavigationToFolder(L"C:\\Fake2");
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	m_navigator.CompletePendingNavigation();
+
+	hr = m_navigationController.GoBack();
+	ASSERT_HRESULT_SUCCEEDED(hr);
+
+	// This will cancel the navigation to the previous entry. The new entry should then be added
+	// after the current entry, as the current entry never changed.
+	hr = StartNavigationToFolder(L"C:\\Fake3");
+	ASSERT_HRESULT_SUCCEEDED(hr);
+	m_navigator.CompletePendingNavigation();
+
+	EXPECT_EQ(m_navigationController.GetCurrentIndex(), 2);
+	EXPECT_EQ(m_navigationController.GetNumHistoryEntries(), 3);
+	EXPECT_TRUE(m_navigationController.CanGoBack());
+	EXPECT_FALSE(m_navigationController.CanGoForward());
+}
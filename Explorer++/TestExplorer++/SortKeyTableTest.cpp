@@ -0,0 +1,197 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/ShellBrowser/SortKeyTable.h"
+#include "../Explorer++/ShellBrowser/ItemData.h"
+#include "../Explorer++/ShellBrowser/SortHelper.h"
+#include "../Helper/FolderSizeCache.h"
+#include "../Helper/ShellHelper.h"
+#include <gtest/gtest.h>
+#include <wil/resource.h>
+#include <filesystem>
+#include <string>
+
+namespace
+{
+
+BasicItemInfo_t BuildItem(const std::wstring &name, bool isFolder, ULONGLONG size = 0,
+	ULONGLONG modifiedTime = 0)
+{
+	BasicItemInfo_t itemInfo;
+
+	std::wstring path = L"C:\\" + name;
+	HRESULT hr = CreateSimplePidl(path, wil::out_param(itemInfo.pidlComplete));
+	EXPECT_HRESULT_SUCCEEDED(hr);
+
+	if (itemInfo.pidlComplete)
+	{
+		itemInfo.pridl.reset(ILCloneChild(ILFindLastID(itemInfo.pidlComplete.get())));
+	}
+
+	itemInfo.wfd = {};
+	StringCchCopy(itemInfo.wfd.cFileName, SIZEOF_ARRAY(itemInfo.wfd.cFileName), name.c_str());
+	itemInfo.wfd.dwFileAttributes = isFolder ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+	itemInfo.wfd.nFileSizeLow = static_cast<DWORD>(size);
+	itemInfo.wfd.nFileSizeHigh = static_cast<DWORD>(size >> 32);
+	itemInfo.wfd.ftLastWriteTime.dwLowDateTime = static_cast<DWORD>(modifiedTime);
+	itemInfo.wfd.ftLastWriteTime.dwHighDateTime = static_cast<DWORD>(modifiedTime >> 32);
+	itemInfo.isFindDataValid = true;
+	StringCchCopy(itemInfo.szDisplayName, SIZEOF_ARRAY(itemInfo.szDisplayName), name.c_str());
+	itemInfo.isRoot = false;
+
+	return itemInfo;
+}
+
+GlobalFolderSettings BuildGlobalFolderSettings()
+{
+	GlobalFolderSettings globalFolderSettings = {};
+	globalFolderSettings.showExtensions = TRUE;
+	globalFolderSettings.useNaturalSortOrder = TRUE;
+	return globalFolderSettings;
+}
+
+}
+
+TEST(SortKeyTableTest, NameNaturalOrder)
+{
+	auto globalFolderSettings = BuildGlobalFolderSettings();
+	SortKeyTable sortKeyTable(SortMode::Name, true, true, globalFolderSettings);
+
+	sortKeyTable.AddItem(0, BuildItem(L"file10.txt", false));
+	sortKeyTable.AddItem(1, BuildItem(L"file2.txt", false));
+	sortKeyTable.AddItem(2, BuildItem(L"Folder", true));
+	sortKeyTable.AddItem(3, BuildItem(L"file1.txt", false));
+
+	std::vector<int> expected = { 2, 3, 1, 0 };
+	EXPECT_EQ(sortKeyTable.Sort(), expected);
+}
+
+TEST(SortKeyTableTest, NameDescendingMixed)
+{
+	auto globalFolderSettings = BuildGlobalFolderSettings();
+	globalFolderSettings.useNaturalSortOrder = FALSE;
+	SortKeyTable sortKeyTable(SortMode::Name, false, false, globalFolderSettings);
+
+	sortKeyTable.AddItem(0, BuildItem(L"b", false));
+	sortKeyTable.AddItem(1, BuildItem(L"C", true));
+	sortKeyTable.AddItem(2, BuildItem(L"a", false));
+
+	std::vector<int> expected = { 1, 0, 2 };
+	EXPECT_EQ(sortKeyTable.Sort(), expected);
+}
+
+TEST(SortKeyTableTest, SizeFallsBackToName)
+{
+	auto globalFolderSettings = BuildGlobalFolderSettings();
+	SortKeyTable sortKeyTable(SortMode::Size, true, true, globalFolderSettings);
+
+	sortKeyTable.AddItem(0, BuildItem(L"large", false, 0x100000000));
+	sortKeyTable.AddItem(1, BuildItem(L"small", false, 10));
+	sortKeyTable.AddItem(2, BuildItem(L"b", false, 10));
+	sortKeyTable.AddItem(3, BuildItem(L"folder2", true));
+	sortKeyTable.AddItem(4, BuildItem(L"folder1", true));
+
+	// Folder sizes aren't being shown, so the folders don't have a size and are ordered by name.
+	std::vector<int> expected = { 4, 3, 2, 1, 0 };
+	EXPECT_EQ(sortKeyTable.Sort(), expected);
+}
+
+TEST(SortKeyTableTest, SizeUsesCachedFolderSizes)
+{
+	TCHAR tempPath[MAX_PATH];
+	DWORD res = GetTempPath(MAX_PATH, tempPath);
+	ASSERT_NE(res, 0U);
+
+	auto rootDirectory = std::filesystem::path(tempPath)
+		/ (L"SortKeyTableTest" + std::to_wstring(GetCurrentProcessId()));
+	std::filesystem::remove_all(rootDirectory);
+	ASSERT_TRUE(std::filesystem::create_directory(rootDirectory));
+
+	auto createFolder = [&rootDirectory](const std::wstring &name, DWORD size)
+	{
+		auto folder = rootDirectory / name;
+		EXPECT_TRUE(std::filesystem::create_directory(folder));
+
+		wil::unique_hfile file(CreateFile((folder / L"file").c_str(), GENERIC_WRITE, 0, nullptr,
+			CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr));
+		EXPECT_TRUE(file);
+
+		std::string data(size, 'x');
+		DWORD numBytesWritten;
+		EXPECT_TRUE(WriteFile(file.get(), data.data(), size, &numBytesWritten, nullptr));
+
+		return folder;
+	};
+
+	auto largeFolder = createFolder(L"a", 300);
+	auto smallFolder = createFolder(L"b", 100);
+	auto uncachedFolder = createFolder(L"c", 200);
+
+	FolderSizeCache::GetInstance().GetFolderInfo(largeFolder.wstring());
+	FolderSizeCache::GetInstance().GetFolderInfo(smallFolder.wstring());
+
+	auto globalFolderSettings = BuildGlobalFolderSettings();
+	globalFolderSettings.showFolderSizes = TRUE;
+	SortKeyTable sortKeyTable(SortMode::Size, true, true, globalFolderSettings);
+
+	int internalIndex = 0;
+
+	for (const auto &folder : { largeFolder, smallFolder, uncachedFolder })
+	{
+		BasicItemInfo_t itemInfo = BuildItem(folder.filename().wstring(), true);
+		HRESULT hr = CreateSimplePidl(folder.wstring(), wil::out_param(itemInfo.pidlComplete));
+		EXPECT_HRESULT_SUCCEEDED(hr);
+
+		sortKeyTable.AddItem(internalIndex++, itemInfo);
+	}
+
+	// Folders that don't have a cached size are placed first, with the remaining folders being
+	// ordered by size.
+	std::vector<int> expected = { 2, 1, 0 };
+	EXPECT_EQ(sortKeyTable.Sort(), expected);
+
+	FolderSizeCache::GetInstance().InvalidatePath(rootDirectory.wstring(), true);
+
+	std::error_code error;
+	std::filesystem::remove_all(rootDirectory, error);
+}
+
+TEST(SortKeyTableTest, MatchesExistingComparison)
+{
+	auto globalFolderSettings = BuildGlobalFolderSettings();
+
+	std::vector<BasicItemInfo_t> items;
+	items.push_back(BuildItem(L"report 2.docx", false, 300, 5));
+	items.push_back(BuildItem(L"report 10.docx", false, 100, 7));
+	items.push_back(BuildItem(L"Report 1.docx", false, 200, 7));
+	items.push_back(BuildItem(L"archive", true, 0, 1));
+
+	SortKeyTable nameTable(SortMode::Name, true, false, globalFolderSettings);
+	SortKeyTable dateTable(SortMode::DateModified, true, false, globalFolderSettings);
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		nameTable.AddItem(static_cast<int>(i), items[i]);
+		dateTable.AddItem(static_cast<int>(i), items[i]);
+	}
+
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		for (size_t j = 0; j < items.size(); j++)
+		{
+			int expectedName = SortByName(items[i], items[j], globalFolderSettings);
+			int actualName = nameTable.CompareItems(i, j);
+			EXPECT_EQ(expectedName < 0, actualName < 0);
+			EXPECT_EQ(expectedName > 0, actualName > 0);
+
+			int expectedDate = SortByDate(items[i], items[j], DateType::Modified);
+			int actualDate = dateTable.CompareItems(i, j);
+
+			if (expectedDate != 0)
+			{
+				EXPECT_EQ(expectedDate < 0, actualDate < 0);
+			}
+		}
+	}
+}
@@ -6,6 +6,7 @@
 #include "../Helper/Macros.h"
 #include <gtest/gtest.h>
 #include <tchar.h>
+#include <string>
 
 TEST(CheckWildcardMatch, SimpleMatches)
 {
@@ -35,6 +36,94 @@ http://connect.microsoft.com/VisualStudio/feedback/details/431433/unicode-string
 #pragma warning(pop)
 }
 
+TEST(CheckWildcardMatch, MultiplePatterns)
+{
+	EXPECT_EQ(CheckWildcardMatch(_T("*.h: *.cpp"), _T("main.cpp"), TRUE), TRUE);
+	EXPECT_EQ(CheckWildcardMatch(_T("*.h: *.cpp"), _T("main.h"), TRUE), TRUE);
+	EXPECT_EQ(CheckWildcardMatch(_T("*.h: *.cpp"), _T("main.c"), TRUE), FALSE);
+}
+
+TEST(WildcardPattern, Basic)
+{
+	EXPECT_TRUE(WildcardPattern(L"*", true).Matches(L"anything"));
+	EXPECT_TRUE(WildcardPattern(L"*", true).Matches(L""));
+	EXPECT_TRUE(WildcardPattern(L"", true).Matches(L""));
+	EXPECT_FALSE(WildcardPattern(L"", true).Matches(L"a"));
+	EXPECT_TRUE(WildcardPattern(L"a**b", true).Matches(L"ab"));
+	EXPECT_TRUE(WildcardPattern(L"*a*", true).Matches(L"a"));
+	EXPECT_FALSE(WildcardPattern(L"?", true).Matches(L""));
+	EXPECT_FALSE(WildcardPattern(L"a?", true).Matches(L"a"));
+	EXPECT_TRUE(WildcardPattern(L"*.txt", true).Matches(L"archive.txt.txt"));
+	EXPECT_FALSE(WildcardPattern(L"*.txt", true).Matches(L"archive.txt.bak"));
+	EXPECT_TRUE(WildcardPattern(L"*ab*ab", true).Matches(L"xabyabab"));
+}
+
+TEST(WildcardPattern, CaseSensitivity)
+{
+	WildcardPattern caseSensitive(L"*.TXT", true);
+	EXPECT_TRUE(caseSensitive.Matches(L"file.TXT"));
+	EXPECT_FALSE(caseSensitive.Matches(L"file.txt"));
+
+	WildcardPattern caseInsensitive(L"*.TXT", false);
+	EXPECT_TRUE(caseInsensitive.Matches(L"file.TXT"));
+	EXPECT_TRUE(caseInsensitive.Matches(L"FILE.txt"));
+	EXPECT_FALSE(caseInsensitive.Matches(L"file.txt2"));
+}
+
+TEST(WildcardPattern, Alternatives)
+{
+	WildcardPattern pattern(L" *.h :*.cpp::  file?  ", true);
+	EXPECT_TRUE(pattern.Matches(L"main.h"));
+	EXPECT_TRUE(pattern.Matches(L"main.cpp"));
+	EXPECT_TRUE(pattern.Matches(L"file1"));
+
+	EXPECT_FALSE(pattern.Matches(L""));
+	EXPECT_FALSE(pattern.Matches(L"main.h "));
+	EXPECT_FALSE(pattern.Matches(L"file12"));
+
+	// A pattern that consists solely of separators doesn't match anything.
+	EXPECT_FALSE(WildcardPattern(L"::", true).Matches(L""));
+	EXPECT_FALSE(WildcardPattern(L"::", true).Matches(L"a"));
+}
+
+// Patterns like this would previously take an amount of time that grew exponentially with the
+// number of '*' characters.
+TEST(WildcardPattern, ManyStars)
+{
+	WildcardPattern pattern(L"*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*a*b", true);
+	EXPECT_FALSE(pattern.Matches(std::wstring(200, 'a')));
+	EXPECT_TRUE(pattern.Matches(std::wstring(200, 'a') + L"b"));
+}
+
+TEST(WildcardPattern, Refinement)
+{
+	// Typing additional characters into a filter will typically result in a refinement.
+	EXPECT_TRUE(WildcardPattern(L"*fo*", false).IsRefinementOf(WildcardPattern(L"*f*", false)));
+	EXPECT_TRUE(WildcardPattern(L"foo*", false).IsRefinementOf(WildcardPattern(L"fo*", false)));
+	EXPECT_TRUE(WildcardPattern(L"*a.txt", true).IsRefinementOf(WildcardPattern(L"*.txt", true)));
+	EXPECT_TRUE(WildcardPattern(L"file?", true).IsRefinementOf(WildcardPattern(L"file*", true)));
+	EXPECT_TRUE(WildcardPattern(L"a?c", true).IsRefinementOf(WildcardPattern(L"a?c", true)));
+
+	// Since patterns are anchored at both ends, extending a pattern that doesn't end in a '*'
+	// doesn't produce a refinement.
+	EXPECT_FALSE(WildcardPattern(L"*.txt2", true).IsRefinementOf(WildcardPattern(L"*.txt", true)));
+	EXPECT_FALSE(WildcardPattern(L"fo*", true).IsRefinementOf(WildcardPattern(L"foo*", true)));
+
+	// A '?' can match any character, so it's not a refinement of a specific character, and a '*'
+	// isn't a refinement of a '?'.
+	EXPECT_FALSE(WildcardPattern(L"a?", true).IsRefinementOf(WildcardPattern(L"ab", true)));
+	EXPECT_FALSE(WildcardPattern(L"a*", true).IsRefinementOf(WildcardPattern(L"a?", true)));
+
+	// Patterns with different case sensitivity are never treated as refinements.
+	EXPECT_FALSE(WildcardPattern(L"*a*", true).IsRefinementOf(WildcardPattern(L"*", false)));
+
+	// Each alternative needs to be covered by one of the other pattern's alternatives.
+	EXPECT_TRUE(WildcardPattern(L"*.h:*.cpp", true)
+					.IsRefinementOf(WildcardPattern(L"*.c*:*.h", true)));
+	EXPECT_FALSE(WildcardPattern(L"*.h:*.cpp", true).IsRefinementOf(WildcardPattern(L"*.h", true)));
+	EXPECT_TRUE(WildcardPattern(L"::", true).IsRefinementOf(WildcardPattern(L"a", true)));
+}
+
 TEST(FormatSizeString, Simple)
 {
 	ULARGE_INTEGER size;
@@ -121,3 +210,23 @@ TEST(TrimString, Simple)
 	TrimString(text, L" ");
 	EXPECT_EQ(text, L"Test text");
 }
+
+TEST(FoldStringCase, Simple)
+{
+	EXPECT_EQ(FoldStringCase(L""), L"");
+	EXPECT_EQ(FoldStringCase(L"C:\\Windows\\notepad.exe"),
+		FoldStringCase(L"c:\\WINDOWS\\Notepad.EXE"));
+	EXPECT_NE(FoldStringCase(L"C:\\Windows"), FoldStringCase(L"C:\\Windows2"));
+}
+
+TEST(FoldStringCase, Unicode)
+{
+#pragma warning(push)
+#pragma warning(disable : 4566)
+
+	EXPECT_EQ(FoldStringCase(L"привет"), FoldStringCase(L"ПРИВЕТ"));
+	EXPECT_EQ(FoldStringCase(L"été"), FoldStringCase(L"ÉTÉ"));
+	EXPECT_NE(FoldStringCase(L"привет"), FoldStringCase(L"пока"));
+
+#pragma warning(pop)
+}
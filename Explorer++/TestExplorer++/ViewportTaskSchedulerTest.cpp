@@ -0,0 +1,323 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/ViewportTaskScheduler.h"
+#include <gtest/gtest.h>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+using namespace testing;
+
+namespace
+{
+
+// Uses a pool with a single worker thread, which is blocked while tasks are queued. That way, the
+// order in which the queued tasks are run is deterministic.
+//
+// Unless a test moves an item, each item is shown in the row with the same number.
+class ViewportTaskSchedulerTest : public Test
+{
+protected:
+	ViewportTaskSchedulerTest() :
+		m_workerPool(1),
+		m_scheduler(m_workerPool, WorkerPool::Priority::Interactive,
+			std::bind_front(&ViewportTaskSchedulerTest::ResolveRow, this))
+	{
+	}
+
+	std::optional<int> ResolveRow(int item)
+	{
+		auto itr = m_movedItems.find(item);
+
+		if (itr == m_movedItems.end())
+		{
+			return item;
+		}
+
+		return itr->second;
+	}
+
+	void BlockWorker()
+	{
+		std::promise<void> blockingTaskStarted;
+		auto blockingTaskStartedFuture = blockingTaskStarted.get_future();
+		auto releaseFuture = m_release.get_future().share();
+
+		m_scheduler.QueueTask(BLOCKING_TAG, std::nullopt,
+			[&blockingTaskStarted, releaseFuture](std::stop_token stopToken)
+			{
+				UNREFERENCED_PARAMETER(stopToken);
+
+				blockingTaskStarted.set_value();
+				releaseFuture.wait();
+			});
+
+		blockingTaskStartedFuture.wait();
+	}
+
+	void QueueRowTask(int row, ViewportTaskScheduler::DroppedCallback droppedCallback = nullptr)
+	{
+		m_scheduler.QueueTask(ROW_TAG, ViewportTaskScheduler::RowItem{ row, row },
+			[this, row](std::stop_token stopToken)
+			{
+				UNREFERENCED_PARAMETER(stopToken);
+
+				std::scoped_lock lock(m_mutex);
+				m_itemsRun.push_back(row);
+			},
+			droppedCallback);
+	}
+
+	// Releases the worker and waits until every task queued before this call has finished.
+	void ReleaseWorkerAndWait()
+	{
+		std::promise<void> finished;
+		auto finishedFuture = finished.get_future();
+
+		// Tasks without a row are run first, so this marker task is queued with a row that's
+		// further away than any other row used in these tests.
+		m_scheduler.QueueTask(BLOCKING_TAG,
+			ViewportTaskScheduler::RowItem{ MARKER_ROW, MARKER_ROW },
+			[&finished](std::stop_token stopToken)
+			{
+				UNREFERENCED_PARAMETER(stopToken);
+
+				finished.set_value();
+			});
+
+		m_release.set_value();
+		finishedFuture.wait();
+	}
+
+	std::vector<int> GetItemsRun()
+	{
+		std::scoped_lock lock(m_mutex);
+		return m_itemsRun;
+	}
+
+	static const int BLOCKING_TAG = 0;
+	static const int ROW_TAG = 1;
+	static const int MARKER_ROW = 1000000;
+
+	std::promise<void> m_release;
+	std::mutex m_mutex;
+	std::vector<int> m_itemsRun;
+
+	// Maps items that have been moved to their new row. Items that have been removed map to
+	// nothing.
+	std::unordered_map<int, std::optional<int>> m_movedItems;
+
+	WorkerPool m_workerPool;
+	ViewportTaskScheduler m_scheduler;
+};
+
+}
+
+TEST_F(ViewportTaskSchedulerTest, VisibleRowsFirst)
+{
+	BlockWorker();
+
+	m_scheduler.SetViewport(10, 12);
+
+	QueueRowTask(14);
+	QueueRowTask(11);
+	QueueRowTask(13);
+	QueueRowTask(10);
+	QueueRowTask(12);
+
+	ReleaseWorkerAndWait();
+
+	// Visible rows are run in the order they were queued, followed by rows ordered by their
+	// distance from the visible area.
+	EXPECT_EQ(GetItemsRun(), (std::vector<int>{ 11, 10, 12, 13, 14 }));
+}
+
+TEST_F(ViewportTaskSchedulerTest, ScrollDirectionPreferred)
+{
+	BlockWorker();
+
+	// Scroll down.
+	m_scheduler.SetViewport(10, 19);
+	m_scheduler.SetViewport(11, 20);
+
+	// Rows below the visible area should now be preferred over rows above it, even if they're
+	// slightly further away.
+	QueueRowTask(8);
+	QueueRowTask(24);
+
+	ReleaseWorkerAndWait();
+
+	EXPECT_EQ(GetItemsRun(), (std::vector<int>{ 24, 8 }));
+}
+
+TEST_F(ViewportTaskSchedulerTest, TasksOutsidePrefetchWindowDropped)
+{
+	BlockWorker();
+
+	m_scheduler.SetViewport(0, 9);
+
+	int numDropped = 0;
+	auto droppedCallback = [&numDropped]()
+	{
+		numDropped++;
+	};
+
+	QueueRowTask(0, droppedCallback);
+	QueueRowTask(5, droppedCallback);
+	QueueRowTask(15, droppedCallback);
+	QueueRowTask(35, droppedCallback);
+
+	// Scroll down by a page. The prefetch window is now rows 10-29, since the window only extends
+	// in the direction of scrolling.
+	m_scheduler.SetViewport(10, 19);
+
+	EXPECT_EQ(numDropped, 3);
+
+	ReleaseWorkerAndWait();
+
+	EXPECT_EQ(GetItemsRun(), (std::vector<int>{ 15 }));
+
+	auto stats = m_scheduler.GetStats();
+	EXPECT_EQ(stats.tasksDropped, 3U);
+}
+
+TEST_F(ViewportTaskSchedulerTest, TasksWithoutRowNeverDropped)
+{
+	BlockWorker();
+
+	bool taskRun = false;
+	m_scheduler.QueueTask(ROW_TAG, std::nullopt,
+		[&taskRun](std::stop_token stopToken)
+		{
+			UNREFERENCED_PARAMETER(stopToken);
+
+			taskRun = true;
+		});
+
+	m_scheduler.SetViewport(0, 9);
+	m_scheduler.SetViewport(1000, 1009);
+
+	ReleaseWorkerAndWait();
+
+	EXPECT_TRUE(taskRun);
+}
+
+TEST_F(ViewportTaskSchedulerTest, RowsResolvedAfterInvalidation)
+{
+	BlockWorker();
+
+	m_scheduler.SetViewport(0, 9);
+
+	int numDropped = 0;
+	auto droppedCallback = [&numDropped]()
+	{
+		numDropped++;
+	};
+
+	QueueRowTask(3, droppedCallback);
+	QueueRowTask(5, droppedCallback);
+	QueueRowTask(8, droppedCallback);
+	QueueRowTask(15, droppedCallback);
+
+	// Item 15 is moved to the top, item 3 is moved just below the visible area, item 8 is moved
+	// outside the prefetch window and item 5 is removed.
+	m_movedItems[15] = 0;
+	m_movedItems[3] = 12;
+	m_movedItems[8] = 40;
+	m_movedItems[5] = std::nullopt;
+
+	// Until the rows are invalidated, the rows the tasks were queued for are used.
+	m_scheduler.SetViewport(0, 9);
+	EXPECT_EQ(numDropped, 0);
+
+	m_scheduler.InvalidateRows();
+	m_scheduler.SetViewport(0, 9);
+	EXPECT_EQ(numDropped, 2);
+
+	ReleaseWorkerAndWait();
+
+	// Item 15 is now visible, so it should be run first, even though it was queued last.
+	EXPECT_EQ(GetItemsRun(), (std::vector<int>{ 15, 3 }));
+}
+
+TEST_F(ViewportTaskSchedulerTest, CancelPending)
+{
+	BlockWorker();
+
+	m_scheduler.SetViewport(0, 9);
+
+	QueueRowTask(0);
+	QueueRowTask(1);
+
+	m_scheduler.Cancel(ROW_TAG);
+
+	QueueRowTask(2);
+
+	ReleaseWorkerAndWait();
+
+	// Only tasks queued after the cancellation should have run.
+	EXPECT_EQ(GetItemsRun(), (std::vector<int>{ 2 }));
+	EXPECT_EQ(m_scheduler.GetStats().tasksCancelled, 2U);
+}
+
+TEST_F(ViewportTaskSchedulerTest, CancelRunning)
+{
+	std::promise<void> taskStarted;
+	auto taskStartedFuture = taskStarted.get_future();
+
+	std::promise<bool> stopRequested;
+	auto stopRequestedFuture = stopRequested.get_future();
+
+	m_scheduler.QueueTask(ROW_TAG, std::nullopt,
+		[&taskStarted, &stopRequested](std::stop_token stopToken)
+		{
+			std::promise<void> stopped;
+			auto stoppedFuture = stopped.get_future();
+
+			std::stop_callback stopCallback(stopToken,
+				[&stopped]()
+				{
+					stopped.set_value();
+				});
+
+			taskStarted.set_value();
+
+			stoppedFuture.wait();
+			stopRequested.set_value(stopToken.stop_requested());
+		});
+
+	taskStartedFuture.wait();
+	m_scheduler.CancelAll();
+
+	EXPECT_TRUE(stopRequestedFuture.get());
+}
+
+TEST_F(ViewportTaskSchedulerTest, Stats)
+{
+	BlockWorker();
+
+	m_scheduler.SetViewport(0, 9);
+
+	QueueRowTask(0);
+	QueueRowTask(1);
+
+	auto stats = m_scheduler.GetStats();
+	EXPECT_EQ(stats.queueDepth, 2U);
+	EXPECT_EQ(stats.tasksStarted, 1U);
+
+	ReleaseWorkerAndWait();
+
+	stats = m_scheduler.GetStats();
+	EXPECT_EQ(stats.queueDepth, 0U);
+
+	// The blocking task, the two row tasks and the marker task.
+	EXPECT_EQ(stats.tasksQueued, 4U);
+	EXPECT_EQ(stats.tasksStarted, 4U);
+	EXPECT_GE(stats.maxQueueLatency, std::chrono::steady_clock::duration::zero());
+	EXPECT_GE(stats.totalQueueLatency, stats.maxQueueLatency);
+}
@@ -0,0 +1,97 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Explorer++/ShellBrowser/VirtualItemList.h"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+TEST(VirtualItemListTest, Append)
+{
+	VirtualItemList list;
+
+	EXPECT_EQ(list.Insert(0, 0), 0);
+	EXPECT_EQ(list.Insert(1, 1), 1);
+
+	// Positions past the end should result in the item being appended.
+	EXPECT_EQ(list.Insert(100, 2), 2);
+
+	EXPECT_EQ(list.GetCount(), 3);
+	EXPECT_EQ(list.GetItems(), (std::vector<int>{ 0, 1, 2 }));
+	EXPECT_EQ(list.GetPosition(2), 2);
+}
+
+TEST(VirtualItemListTest, InsertShiftsPositions)
+{
+	VirtualItemList list;
+	list.Insert(0, 0);
+	list.Insert(1, 1);
+	list.Insert(2, 2);
+
+	EXPECT_EQ(list.GetPosition(1), 1);
+
+	list.Insert(1, 3);
+
+	EXPECT_EQ(list.GetItems(), (std::vector<int>{ 0, 3, 1, 2 }));
+	EXPECT_EQ(list.GetPosition(0), 0);
+	EXPECT_EQ(list.GetPosition(3), 1);
+	EXPECT_EQ(list.GetPosition(1), 2);
+	EXPECT_EQ(list.GetPosition(2), 3);
+	EXPECT_EQ(list.GetInternalIndex(1), 3);
+}
+
+TEST(VirtualItemListTest, Remove)
+{
+	VirtualItemList list;
+	list.Insert(0, 0);
+	list.Insert(1, 1);
+	list.Insert(2, 2);
+
+	EXPECT_EQ(list.Remove(1), 1);
+	EXPECT_EQ(list.Remove(1), std::nullopt);
+	EXPECT_EQ(list.Remove(10), std::nullopt);
+
+	EXPECT_EQ(list.GetItems(), (std::vector<int>{ 0, 2 }));
+	EXPECT_EQ(list.GetPosition(1), std::nullopt);
+	EXPECT_EQ(list.GetPosition(2), 1);
+}
+
+TEST(VirtualItemListTest, SetOrder)
+{
+	VirtualItemList list;
+	list.Insert(0, 0);
+	list.Insert(1, 1);
+	list.Insert(2, 2);
+
+	list.SetOrder({ 2, 0, 4 });
+
+	EXPECT_EQ(list.GetCount(), 3);
+	EXPECT_EQ(list.GetPosition(2), 0);
+	EXPECT_EQ(list.GetPosition(0), 1);
+	EXPECT_EQ(list.GetPosition(4), 2);
+
+	// The item wasn't included in the new order, so should have been removed.
+	EXPECT_EQ(list.GetPosition(1), std::nullopt);
+}
+
+TEST(VirtualItemListTest, OutOfRange)
+{
+	VirtualItemList list;
+	list.Insert(0, 0);
+
+	EXPECT_THROW(list.GetInternalIndex(1), std::out_of_range);
+	EXPECT_EQ(list.GetPosition(-1), std::nullopt);
+}
+
+TEST(VirtualItemListTest, Clear)
+{
+	VirtualItemList list;
+	list.Insert(0, 0);
+	list.Insert(1, 1);
+
+	list.Clear();
+
+	EXPECT_EQ(list.GetCount(), 0);
+	EXPECT_EQ(list.GetPosition(0), std::nullopt);
+}
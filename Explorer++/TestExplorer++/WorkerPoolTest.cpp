@@ -0,0 +1,303 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/WorkerPool.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+
+// Uses a pool with a single worker thread. The worker is blocked while tasks are queued, so that
+// the order in which the tasks are subsequently run is deterministic.
+class WorkerPoolTest : public testing::Test
+{
+protected:
+	WorkerPoolTest() :
+		m_workerPool(1),
+		m_blockingGroup(m_workerPool, WorkerPool::Priority::Interactive)
+	{
+	}
+
+	void BlockWorker()
+	{
+		std::promise<void> blockingTaskStarted;
+		auto blockingTaskStartedFuture = blockingTaskStarted.get_future();
+		auto releaseFuture = m_release.get_future().share();
+
+		m_blockingGroup.Post(
+			[&blockingTaskStarted, releaseFuture]()
+			{
+				blockingTaskStarted.set_value();
+				releaseFuture.wait();
+			});
+
+		blockingTaskStartedFuture.wait();
+	}
+
+	void PostRecordingTask(WorkerPool::TaskGroup &group, const std::wstring &name)
+	{
+		group.Post(
+			[this, name]()
+			{
+				std::scoped_lock lock(m_mutex);
+				m_tasksRun.push_back(name);
+			});
+	}
+
+	// Releases the worker and waits until every task has finished.
+	void ReleaseWorkerAndWait()
+	{
+		m_release.set_value();
+
+		while (m_workerPool.GetStats().pendingTasks > 0)
+		{
+			std::this_thread::sleep_for(1ms);
+		}
+
+		// The last task may still be running, so a final task is queued and waited on.
+		m_blockingGroup.Push([]() {}).wait();
+	}
+
+	std::vector<std::wstring> GetTasksRun()
+	{
+		std::scoped_lock lock(m_mutex);
+		return m_tasksRun;
+	}
+
+	std::promise<void> m_release;
+	std::mutex m_mutex;
+	std::vector<std::wstring> m_tasksRun;
+	WorkerPool m_workerPool;
+	WorkerPool::TaskGroup m_blockingGroup;
+};
+
+}
+
+TEST_F(WorkerPoolTest, PushReturnsResult)
+{
+	WorkerPool::TaskGroup group(m_workerPool, WorkerPool::Priority::Interactive);
+
+	auto future = group.Push(
+		[]()
+		{
+			return 42;
+		});
+
+	EXPECT_EQ(future.get(), 42);
+}
+
+TEST_F(WorkerPoolTest, InteractiveBeforeBackground)
+{
+	WorkerPool::TaskGroup interactiveGroup(m_workerPool, WorkerPool::Priority::Interactive);
+	WorkerPool::TaskGroup backgroundGroup(m_workerPool, WorkerPool::Priority::Background);
+
+	BlockWorker();
+
+	PostRecordingTask(backgroundGroup, L"background");
+	PostRecordingTask(interactiveGroup, L"interactive");
+
+	ReleaseWorkerAndWait();
+
+	EXPECT_EQ(GetTasksRun(), (std::vector<std::wstring>{ L"interactive", L"background" }));
+}
+
+TEST_F(WorkerPoolTest, BackgroundNotStarved)
+{
+	WorkerPool::TaskGroup interactiveGroup(m_workerPool, WorkerPool::Priority::Interactive);
+	WorkerPool::TaskGroup backgroundGroup(m_workerPool, WorkerPool::Priority::Background);
+
+	BlockWorker();
+
+	PostRecordingTask(backgroundGroup, L"background");
+
+	for (int i = 0; i < WorkerPool::BACKGROUND_SHARE * 2; i++)
+	{
+		PostRecordingTask(interactiveGroup, L"interactive");
+	}
+
+	ReleaseWorkerAndWait();
+
+	// The background task should have been run before all the interactive tasks were finished.
+	auto tasksRun = GetTasksRun();
+	ASSERT_EQ(tasksRun.size(), static_cast<size_t>(WorkerPool::BACKGROUND_SHARE * 2 + 1));
+	EXPECT_NE(tasksRun.front(), L"background");
+	EXPECT_NE(tasksRun.back(), L"background");
+}
+
+TEST_F(WorkerPoolTest, GroupsShareFairly)
+{
+	WorkerPool::TaskGroup group1(m_workerPool, WorkerPool::Priority::Interactive);
+	WorkerPool::TaskGroup group2(m_workerPool, WorkerPool::Priority::Interactive);
+
+	BlockWorker();
+
+	// Even though the first group has a larger backlog, the groups should take turns.
+	PostRecordingTask(group1, L"group1");
+	PostRecordingTask(group1, L"group1");
+	PostRecordingTask(group1, L"group1");
+	PostRecordingTask(group2, L"group2");
+	PostRecordingTask(group2, L"group2");
+
+	ReleaseWorkerAndWait();
+
+	EXPECT_EQ(GetTasksRun(),
+		(std::vector<std::wstring>{ L"group1", L"group2", L"group1", L"group2", L"group1" }));
+}
+
+TEST_F(WorkerPoolTest, PriorityChange)
+{
+	WorkerPool::TaskGroup group1(m_workerPool, WorkerPool::Priority::Interactive);
+	WorkerPool::TaskGroup group2(m_workerPool, WorkerPool::Priority::Background);
+
+	BlockWorker();
+
+	PostRecordingTask(group1, L"group1");
+	PostRecordingTask(group2, L"group2");
+
+	group1.SetPriority(WorkerPool::Priority::Background);
+	group2.SetPriority(WorkerPool::Priority::Interactive);
+	EXPECT_EQ(group1.GetPriority(), WorkerPool::Priority::Background);
+
+	ReleaseWorkerAndWait();
+
+	EXPECT_EQ(GetTasksRun(), (std::vector<std::wstring>{ L"group2", L"group1" }));
+}
+
+TEST_F(WorkerPoolTest, Clear)
+{
+	WorkerPool::TaskGroup group1(m_workerPool, WorkerPool::Priority::Interactive);
+	WorkerPool::TaskGroup group2(m_workerPool, WorkerPool::Priority::Interactive);
+
+	BlockWorker();
+
+	PostRecordingTask(group1, L"group1");
+	PostRecordingTask(group2, L"group2");
+
+	// Only the tasks in the first group should be removed.
+	group1.Clear();
+
+	ReleaseWorkerAndWait();
+
+	EXPECT_EQ(GetTasksRun(), (std::vector<std::wstring>{ L"group2" }));
+}
+
+TEST_F(WorkerPoolTest, GroupDestroyed)
+{
+	BlockWorker();
+
+	{
+		WorkerPool::TaskGroup group(m_workerPool, WorkerPool::Priority::Interactive);
+		PostRecordingTask(group, L"group");
+
+		EXPECT_EQ(m_workerPool.GetStats().numGroups, 2);
+	}
+
+	EXPECT_EQ(m_workerPool.GetStats().numGroups, 1);
+	EXPECT_EQ(m_workerPool.GetStats().pendingTasks, 0U);
+
+	ReleaseWorkerAndWait();
+
+	EXPECT_TRUE(GetTasksRun().empty());
+}
+
+TEST(WorkerPoolStealingTest, IdleWorkerStealsTasks)
+{
+	WorkerPool workerPool(2);
+
+	std::promise<void> release;
+	auto releaseFuture = release.get_future().share();
+
+	std::promise<void> task1Started;
+	std::promise<void> task2Started;
+	auto task1StartedFuture = task1Started.get_future();
+	auto task2StartedFuture = task2Started.get_future();
+
+	// The group is assigned to a single worker. For both of the tasks below to run concurrently,
+	// the other worker has to steal one of them.
+	WorkerPool::TaskGroup group(workerPool, WorkerPool::Priority::Interactive);
+
+	group.Post(
+		[&task1Started, releaseFuture]()
+		{
+			task1Started.set_value();
+			releaseFuture.wait();
+		});
+	group.Post(
+		[&task2Started, releaseFuture]()
+		{
+			task2Started.set_value();
+			releaseFuture.wait();
+		});
+
+	EXPECT_EQ(task1StartedFuture.wait_for(10s), std::future_status::ready);
+	EXPECT_EQ(task2StartedFuture.wait_for(10s), std::future_status::ready);
+
+	release.set_value();
+
+	EXPECT_GE(workerPool.GetStats().tasksStolen, 1U);
+}
+
+TEST(WorkerPoolReservationTest, InteractiveTaskRunsWhenBackgroundSaturated)
+{
+	const int numThreads = 3;
+	WorkerPool workerPool(numThreads);
+
+	std::promise<void> release;
+	auto releaseFuture = release.get_future().share();
+
+	std::mutex mutex;
+	std::condition_variable backgroundTaskStarted;
+	int numBackgroundTasksStarted = 0;
+
+	// Queue more background work than there are workers, with every task blocking until it's
+	// released.
+	WorkerPool::TaskGroup backgroundGroup(workerPool, WorkerPool::Priority::Background);
+
+	for (int i = 0; i < numThreads * 2; i++)
+	{
+		backgroundGroup.Post(
+			[&mutex, &backgroundTaskStarted, &numBackgroundTasksStarted, releaseFuture]()
+			{
+				{
+					std::scoped_lock lock(mutex);
+					numBackgroundTasksStarted++;
+				}
+
+				backgroundTaskStarted.notify_all();
+				releaseFuture.wait();
+			});
+	}
+
+	const int maxBackgroundTasks = numThreads - WorkerPool::RESERVED_INTERACTIVE_WORKERS;
+
+	{
+		std::unique_lock lock(mutex);
+		EXPECT_TRUE(backgroundTaskStarted.wait_for(lock, 10s,
+			[&numBackgroundTasksStarted, maxBackgroundTasks]()
+			{
+				return numBackgroundTasksStarted == maxBackgroundTasks;
+			}));
+	}
+
+	// Even though there's still background work queued, a worker should be free to run this task.
+	WorkerPool::TaskGroup interactiveGroup(workerPool, WorkerPool::Priority::Interactive);
+	auto interactiveFuture = interactiveGroup.Push([]() {});
+	EXPECT_EQ(interactiveFuture.wait_for(10s), std::future_status::ready);
+
+	{
+		std::scoped_lock lock(mutex);
+		EXPECT_EQ(numBackgroundTasksStarted, maxBackgroundTasks);
+	}
+
+	release.set_value();
+}
@@ -0,0 +1,193 @@
+// Copyright (C) Explorer++ Project
+// SPDX-License-Identifier: GPL-3.0-only
+// See LICENSE in the top level directory
+
+#include "../Helper/XmlStreamReader.h"
+#include "BookmarkStorageHelper.h"
+#include "Bookmarks/BookmarkTree.h"
+#include "Bookmarks/BookmarkXmlStorage.h"
+#include "ResourceHelper.h"
+#include "../Helper/XMLSettings.h"
+#include <gtest/gtest.h>
+#include <wil/com.h>
+#include <wil/resource.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const wchar_t TEST_XML[] = LR"(<?xml version="1.0"?>
+<ExplorerPlusPlus>
+	<Settings>
+		<Setting name="ShowStatusBar">yes</Setting>
+		<Setting name="DisplayTextColor" r="1" g="2" b="3"/>
+		<Setting name="NewTabDirectory">C:\Windows</Setting>
+	</Settings>
+	<Tabs>
+		<Tab name="0" Directory="C:\"/>
+	</Tabs>
+	<Bookmarksv2>
+		<PermanentItem name="BookmarksToolbar"/>
+	</Bookmarksv2>
+</ExplorerPlusPlus>
+)";
+
+wil::com_ptr_nothrow<IXMLDOMDocument> LoadXmlString(const std::wstring &xml)
+{
+	wil::com_ptr_nothrow<IXMLDOMDocument> xmlDocument;
+	xmlDocument.attach(NXMLSettings::DomFromCOM());
+
+	if (!xmlDocument)
+	{
+		return nullptr;
+	}
+
+	auto xmlString = wil::make_bstr_nothrow(xml.c_str());
+	VARIANT_BOOL status;
+	xmlDocument->loadXML(xmlString.get(), &status);
+
+	if (status != VARIANT_TRUE)
+	{
+		return nullptr;
+	}
+
+	return xmlDocument;
+}
+
+bool DoesNodeExist(IXMLDOMDocument *xmlDocument, const std::wstring &query)
+{
+	wil::com_ptr_nothrow<IXMLDOMNode> node;
+	auto queryString = wil::make_bstr_nothrow(query.c_str());
+	return xmlDocument->selectSingleNode(queryString.get(), &node) == S_OK;
+}
+
+class XmlStreamReaderTest : public testing::Test
+{
+protected:
+	XmlStreamReaderTest()
+	{
+		CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+	}
+
+	~XmlStreamReaderTest()
+	{
+		CoUninitialize();
+	}
+};
+
+TEST_F(XmlStreamReaderTest, ReadSection)
+{
+	std::vector<XmlStreamReader::Element> settings;
+
+	XmlStreamReader reader;
+	reader.ReadSection(L"Settings",
+		[&settings](const XmlStreamReader::Element &element)
+		{
+			settings.push_back(element);
+			return true;
+		});
+
+	ASSERT_HRESULT_SUCCEEDED(reader.ReadString(TEST_XML));
+	ASSERT_EQ(settings.size(), 3U);
+
+	EXPECT_EQ(settings[0].name, L"Setting");
+	ASSERT_EQ(settings[0].attributes.size(), 1U);
+	EXPECT_EQ(settings[0].attributes[0].first, L"name");
+	EXPECT_EQ(settings[0].attributes[0].second, L"ShowStatusBar");
+	EXPECT_EQ(settings[0].text, L"yes");
+
+	// Attributes should be returned in document order.
+	ASSERT_EQ(settings[1].attributes.size(), 4U);
+	EXPECT_EQ(settings[1].attributes[1].first, L"r");
+	EXPECT_EQ(settings[1].attributes[2].first, L"g");
+	EXPECT_EQ(settings[1].attributes[3].first, L"b");
+	EXPECT_TRUE(settings[1].text.empty());
+
+	const std::wstring *green = settings[1].GetAttribute(L"g");
+	ASSERT_NE(green, nullptr);
+	EXPECT_EQ(*green, L"2");
+	EXPECT_EQ(settings[1].GetAttribute(L"a"), nullptr);
+
+	EXPECT_EQ(settings[2].text, L"C:\\Windows");
+}
+
+TEST_F(XmlStreamReaderTest, StopReading)
+{
+	int numSettings = 0;
+	std::wstring remainingXml;
+
+	XmlStreamReader reader;
+	reader.ReadSection(L"Settings",
+		[&numSettings](const XmlStreamReader::Element &element)
+		{
+			UNREFERENCED_PARAMETER(element);
+
+			numSettings++;
+			return false;
+		});
+	reader.CaptureRemainingSections(&remainingXml);
+
+	EXPECT_HRESULT_SUCCEEDED(reader.ReadString(TEST_XML));
+	EXPECT_EQ(numSettings, 1);
+
+	// The document wasn't read in full, so nothing should have been captured.
+	EXPECT_TRUE(remainingXml.empty());
+}
+
+TEST_F(XmlStreamReaderTest, CaptureSections)
+{
+	std::wstring bookmarksXml;
+	std::wstring remainingXml;
+
+	XmlStreamReader reader;
+	reader.ReadSection(L"Settings",
+		[](const XmlStreamReader::Element &element)
+		{
+			UNREFERENCED_PARAMETER(element);
+
+			return true;
+		});
+	reader.CaptureSections({ L"Bookmarksv2" }, &bookmarksXml);
+	reader.CaptureRemainingSections(&remainingXml);
+
+	ASSERT_HRESULT_SUCCEEDED(reader.ReadString(TEST_XML));
+
+	auto bookmarksDocument = LoadXmlString(bookmarksXml);
+	ASSERT_TRUE(bookmarksDocument);
+	EXPECT_TRUE(DoesNodeExist(bookmarksDocument.get(),
+		L"/ExplorerPlusPlus/Bookmarksv2/PermanentItem[@name='BookmarksToolbar']"));
+	EXPECT_FALSE(DoesNodeExist(bookmarksDocument.get(), L"/ExplorerPlusPlus/Tabs"));
+	EXPECT_FALSE(DoesNodeExist(bookmarksDocument.get(), L"/ExplorerPlusPlus/Settings"));
+
+	auto remainingDocument = LoadXmlString(remainingXml);
+	ASSERT_TRUE(remainingDocument);
+	EXPECT_TRUE(DoesNodeExist(remainingDocument.get(),
+		L"/ExplorerPlusPlus/Tabs/Tab[@Directory='C:\\']"));
+	EXPECT_FALSE(DoesNodeExist(remainingDocument.get(), L"/ExplorerPlusPlus/Bookmarksv2"));
+	EXPECT_FALSE(DoesNodeExist(remainingDocument.get(), L"/ExplorerPlusPlus/Settings"));
+}
+
+// The bookmarks loaded from a captured section should be identical to those loaded from the
+// original file.
+TEST_F(XmlStreamReaderTest, CaptureBookmarks)
+{
+	std::wstring bookmarksXml;
+
+	XmlStreamReader reader;
+	reader.CaptureSections({ L"Bookmarksv2" }, &bookmarksXml);
+	ASSERT_HRESULT_SUCCEEDED(reader.ReadFile(GetResourcePath(L"bookmarks-v2-config.xml")));
+
+	auto bookmarksDocument = LoadXmlString(bookmarksXml);
+	ASSERT_TRUE(bookmarksDocument);
+
+	BookmarkTree loadedBookmarkTree;
+	BookmarkXmlStorage::Load(bookmarksDocument.get(), &loadedBookmarkTree);
+
+	BookmarkTree referenceBookmarkTree;
+	BuildV2LoadSaveReferenceTree(&referenceBookmarkTree);
+
+	CompareBookmarkTrees(&loadedBookmarkTree, &referenceBookmarkTree, true);
+}
+
+}